@@ -26,6 +26,7 @@ import android.database.Cursor;
 import android.graphics.PixelFormat;
 import android.net.Uri;
 import android.os.Bundle;
+import android.os.PowerManager;
 import android.provider.OpenableColumns;
 import android.provider.Settings.Secure;
 import android.text.Editable;
@@ -720,6 +721,30 @@ public class MainActivity extends Activity
 	}
 
 	public int getWindowState() { return fullscreen ? 1 : 0; }
+	
+	// getCurrentThermalStatus - API level 29
+	// getThermalHeadroom - API level 30
+	// (called through reflection, as compileSdkVersion is older than this)
+	public int getThermalLevel() {
+		try {
+			PowerManager pm = (PowerManager)getSystemService(Context.POWER_SERVICE);
+			
+			if (android.os.Build.VERSION.SDK_INT >= 30) {
+				// Forecast 10 seconds ahead, so rendering can be reduced before throttling starts
+				// (1.0 means severe throttling, NaN if forecast is unavailable or called too often)
+				float h = (Float)PowerManager.class.getMethod("getThermalHeadroom", int.class).invoke(pm, 10);
+				if (!Float.isNaN(h)) return h >= 1.0f ? 3 : (h >= 0.85f ? 2 : (h >= 0.7f ? 1 : 0));
+			}
+			if (android.os.Build.VERSION.SDK_INT >= 29) {
+				// THERMAL_STATUS_NONE (0), LIGHT (1), MODERATE (2), SEVERE (3) and higher
+				int status = (Integer)PowerManager.class.getMethod("getCurrentThermalStatus").invoke(pm);
+				return Math.min(status, 3);
+			}
+		} catch (Exception ex) {
+			ex.printStackTrace();
+		}
+		return 0;
+	}
 	// SYSTEM_UI_FLAG_HIDE_NAVIGATION - API level 14
 	// SYSTEM_UI_FLAG_FULLSCREEN - API level 16
 	// SYSTEM_UI_FLAG_IMMERSIVE_STICKY - API level 19
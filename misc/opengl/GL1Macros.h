@@ -42,6 +42,7 @@
 #define _glTexImage2D     glTexImage2D
 #define _glTexSubImage2D  glTexSubImage2D
 #define _glTexParameteri  glTexParameteri
+#define _glCopyTexSubImage2D glCopyTexSubImage2D
 
 /* State get functions */
 #define _glGetError    glGetError
@@ -31,6 +31,8 @@ GL_FUNC(void,   glVertexAttribPointer,      (GLuint index, GLint size, GLenum ty
 
 GL_FUNC(GLint,  glGetUniformLocation, (GLuint program, const char* name))
 GL_FUNC(void,   glUniform1f,          (GLint location, GLfloat v0))
+GL_FUNC(void,   glUniform1fv,         (GLint location, GLsizei count, const GLfloat* value))
 GL_FUNC(void,   glUniform2f,          (GLint location, GLfloat v0, GLfloat v1))
 GL_FUNC(void,   glUniform3f,          (GLint location, GLfloat v0, GLfloat v1, GLfloat v2))
+GL_FUNC(void,   glUniform4fv,         (GLint location, GLsizei count, const GLfloat* value))
 GL_FUNC(void,   glUniformMatrix4fv,   (GLint location, GLsizei count, GLboolean transpose, const GLfloat* value))
\ No newline at end of file
@@ -44,9 +44,11 @@ typedef cc_uintptr GLpointer;
 #define GL_ONE_MINUS_SRC_ALPHA   0x0303
 
 #define GL_UNSIGNED_BYTE         0x1401
+#define GL_SHORT                 0x1402
 #define GL_UNSIGNED_SHORT        0x1403
 #define GL_UNSIGNED_INT          0x1405
 #define GL_FLOAT                 0x1406
+#define GL_RGB                   0x1907
 #define GL_RGBA                  0x1908
 
 #define GL_FOG                   0x0B60
@@ -86,6 +88,8 @@ typedef cc_uintptr GLpointer;
 #define GL_NEAREST_MIPMAP_LINEAR 0x2702
 #define GL_TEXTURE_MAG_FILTER    0x2800
 #define GL_TEXTURE_MIN_FILTER    0x2801
+#define GL_TEXTURE_WRAP_S        0x2802
+#define GL_TEXTURE_WRAP_T        0x2803
 
 #define GL_VERTEX_ARRAY          0x8074
 #define GL_COLOR_ARRAY           0x8076
@@ -94,6 +98,7 @@ typedef cc_uintptr GLpointer;
 /* Not present in gl.h on Windows (only up to OpenGL 1.1) */
 #define GL_ARRAY_BUFFER          0x8892
 #define GL_ELEMENT_ARRAY_BUFFER  0x8893
+#define GL_CLAMP_TO_EDGE         0x812F
 #define GL_STATIC_DRAW           0x88E4
 #define GL_DYNAMIC_DRAW          0x88E8
 
@@ -11,9 +11,10 @@
 #include "ExtMath.h"
 #include "Options.h"
 #include "Logger.h"
+#include "MapRenderer.h"
 
 #ifndef CC_DISABLE_ANIMATIONS
-static void Animations_Update(int loc, struct Bitmap* bmp, int stride);
+static void Animations_Update(int loc, struct Bitmap* bmp, int stride, cc_bool layered);
 
 #ifdef CC_BUILD_LOWMEM
 	#define LIQUID_ANIM_MAX 16
@@ -38,15 +39,11 @@ static float L_flameHeat[LIQUID_ANIM_MAX * LIQUID_ANIM_MAX];
 static RNGState L_rnd;
 static cc_bool  L_rndInited;
 
-static void LavaAnimation_Tick(void) {
-	BitmapCol pixels[LIQUID_ANIM_MAX * LIQUID_ANIM_MAX];
-	BitmapCol* ptr = pixels;
+static void LavaAnimation_Simulate(BitmapCol* ptr, int size) {
 	float soupHeat, potHeat, color;
-	int size, mask, shift;
+	int mask, shift;
 	int x, y, i = 0;
-	struct Bitmap bmp;
 
-	size  = min(Atlas2D.TileSize, LIQUID_ANIM_MAX);
 	mask  = size - 1;
 	shift = Math_ilog2(size);
 
@@ -105,8 +102,6 @@ static void LavaAnimation_Tick(void) {
 		}
 	}
 
-	Bitmap_Init(bmp, size, size, pixels);
-	Animations_Update(LAVA_TEX_LOC, &bmp, size);
 }
 
 
@@ -119,15 +114,11 @@ static float W_flameHeat[LIQUID_ANIM_MAX * LIQUID_ANIM_MAX];
 static RNGState W_rnd;
 static cc_bool  W_rndInited;
 
-static void WaterAnimation_Tick(void) {
-	BitmapCol pixels[LIQUID_ANIM_MAX * LIQUID_ANIM_MAX];
-	BitmapCol* ptr = pixels;
+static void WaterAnimation_Simulate(BitmapCol* ptr, int size) {
 	float soupHeat, color;
-	int size, mask, shift;
+	int mask, shift;
 	int x, y, i = 0;
-	struct Bitmap bmp;
 
-	size  = min(Atlas2D.TileSize, LIQUID_ANIM_MAX);
 	mask  = size - 1;
 	shift = Math_ilog2(size);
 
@@ -167,8 +158,82 @@ static void WaterAnimation_Tick(void) {
 		}
 	}
 
+}
+
+
+/*########################################################################################################################*
+*---------------------------------------------------Precomputed liquids---------------------------------------------------*
+*#########################################################################################################################*/
+/* Number of liquid animation frames to precompute and then cycle through (0 = simulate every tick) */
+static int liquid_framesCount;
+typedef void (*LiquidSimulateFunc)(BitmapCol* pixels, int size);
+
+struct LiquidFrames {
+	BitmapCol* pixels; /* Pixels of all the precomputed frames */
+	int size;          /* Size of each frame, 0 if not precomputed yet */
+	int cur;           /* Index of the next frame to show */
+};
+static struct LiquidFrames lavaFrames, waterFrames;
+
+static BitmapCol LiquidFrames_Lerp(BitmapCol a, BitmapCol b, int t) {
+	return BitmapCol_Make(
+		(BitmapCol_R(a) * (256 - t) + BitmapCol_R(b) * t) >> 8,
+		(BitmapCol_G(a) * (256 - t) + BitmapCol_G(b) * t) >> 8,
+		(BitmapCol_B(a) * (256 - t) + BitmapCol_B(b) * t) >> 8,
+		(BitmapCol_A(a) * (256 - t) + BitmapCol_A(b) * t) >> 8);
+}
+
+static cc_bool LiquidFrames_Generate(struct LiquidFrames* frames, LiquidSimulateFunc simulate, int size) {
+	BitmapCol next[LIQUID_ANIM_MAX * LIQUID_ANIM_MAX];
+	int count = liquid_framesCount, blended = count / 4;
+	int i, j, t, pixels = size * size;
+	BitmapCol* dst;
+
+	Mem_Free(frames->pixels);
+	frames->size   = 0;
+	frames->pixels = (BitmapCol*)Mem_TryAlloc(count * pixels, BITMAPCOLOR_SIZE);
+	if (!frames->pixels) return false;
+
+	for (i = 0; i < count; i++) 
+	{
+		simulate(frames->pixels + i * pixels, size);
+	}
+
+	/* Blend the first frames with the frames that would have come after the last frame, */
+	/*  so that there isn't a noticeable jump when looping back around to the first frame */
+	for (i = 0; i < blended; i++) 
+	{
+		simulate(next, size);
+		dst = frames->pixels + i * pixels;
+		t   = (i + 1) * 256 / (blended + 1);
+
+		for (j = 0; j < pixels; j++) dst[j] = LiquidFrames_Lerp(next[j], dst[j], t);
+	}
+
+	frames->size = size;
+	frames->cur  = 0;
+	return true;
+}
+
+static void LiquidFrames_Free(struct LiquidFrames* frames) {
+	Mem_Free(frames->pixels);
+	frames->pixels = NULL;
+	frames->size   = 0;
+}
+
+static void LiquidAnimation_Tick(struct LiquidFrames* frames, LiquidSimulateFunc simulate, int texLoc) {
+	BitmapCol pixels[LIQUID_ANIM_MAX * LIQUID_ANIM_MAX];
+	int size = min(Atlas2D.TileSize, LIQUID_ANIM_MAX);
+	struct Bitmap bmp;
 	Bitmap_Init(bmp, size, size, pixels);
-	Animations_Update(WATER_TEX_LOC, &bmp, size);
+
+	if (liquid_framesCount && (frames->size == size || LiquidFrames_Generate(frames, simulate, size))) {
+		bmp.scan0   = frames->pixels + frames->cur * size * size;
+		frames->cur = (frames->cur + 1) % liquid_framesCount;
+	} else {
+		simulate(pixels, size);
+	}
+	Animations_Update(texLoc, &bmp, size, false);
 }
 #endif
 
@@ -184,11 +249,15 @@ struct AnimationData {
 	cc_uint16 statesCount;    /* Total number of animation frames */
 	cc_uint16 delay;          /* Delay in ticks until next frame is drawn */
 	cc_uint16 frameDelay;     /* Delay between each frame */
+	cc_int16  layer;          /* Index of the texture array layer holding all frames, -1 if none */
 };
 
 static struct Bitmap anims_bmp;
 static struct AnimationData anims_list[ATLAS1D_MAX_ATLASES];
 static int anims_count;
+/* Chunks draw animations that have all their frames in a texture array layer by just offsetting V coords */
+static float anims_layerOffsets[GFX_MAX_LAYER_OFFSETS];
+static int anims_firstLayer, anims_layersCount;
 static cc_bool anims_validated, useLavaAnim, useWaterAnim, alwaysLavaAnim, alwaysWaterAnim;
 #define ANIM_MIN_ARGS 7
 
@@ -245,23 +314,30 @@ static void Animations_ReadDescription(struct Stream* stream, const cc_string* p
 		}
 
 		data.texLoc = tileX + (tileY * ATLAS2D_TILES_PER_ROW);
+		data.layer  = -1;
 		anims_list[anims_count++] = data;
 	}
 }
 
-static void Animations_Update(int texLoc, struct Bitmap* bmp, int stride) {
+static void Animations_Update(int texLoc, struct Bitmap* bmp, int stride, cc_bool layered) {
 	int dstX = Atlas1D_Index(texLoc);
 	int dstY = Atlas1D_RowId(texLoc) * Atlas2D.TileSize;
 	GfxResourceID tex;
 
 	tex = Atlas1D.TexIds[dstX];
 	if (tex) Gfx_UpdateTexture(tex, 0, dstY, bmp, stride, Gfx.Mipmaps);
+
+	/* Frame is instead selected by Gfx_SetLayerOffsets when drawing chunks */
+	if (layered) return;
+	tex = Atlas1D.ArrayTexId;
+	if (tex) Gfx_UpdateTextureLayer(tex, dstX, 0, dstY, bmp, stride, Gfx.Mipmaps);
 }
 
-static void Animations_Apply(struct AnimationData* data) {
+/* Returns whether the state of the animation changed */
+static cc_bool Animations_Apply(struct AnimationData* data) {
 	struct Bitmap frame;
 	int loc, size;
-	if (data->delay) { data->delay--; return; }
+	if (data->delay) { data->delay--; return false; }
 
 	data->state++;
 	data->state %= data->statesCount;
@@ -269,8 +345,8 @@ static void Animations_Apply(struct AnimationData* data) {
 
 	loc = data->texLoc;
 #ifndef CC_BUILD_WEB
-	if (loc == LAVA_TEX_LOC  && useLavaAnim)  return;
-	if (loc == WATER_TEX_LOC && useWaterAnim) return;
+	if (loc == LAVA_TEX_LOC  && useLavaAnim)  return false;
+	if (loc == WATER_TEX_LOC && useWaterAnim) return false;
 #endif
 
 	size = data->frameSize;
@@ -279,7 +355,82 @@ static void Animations_Apply(struct AnimationData* data) {
 	frame.scan0 = anims_bmp.scan0 
 				+ data->frameY * anims_bmp.width
 				+ (data->frameX + data->state * size);
-	Animations_Update(loc, &frame, anims_bmp.width);
+	Animations_Update(loc, &frame, anims_bmp.width, data->layer >= 0);
+
+	if (data->layer < 0) return false;
+	anims_layerOffsets[data->layer] = data->state * Atlas1D.InvTileSize;
+	return true;
+}
+
+static cc_bool Animations_CanUseLayer(struct AnimationData* data) {
+	int i;
+	if (data->frameSize != Atlas2D.TileSize)         return false;
+	if (data->statesCount > Atlas1D.TilesPerAtlas)   return false;
+	if (anims_layersCount == GFX_MAX_LAYER_OFFSETS) return false;
+#ifndef CC_BUILD_WEB
+	if (data->texLoc == LAVA_TEX_LOC  && useLavaAnim)  return false;
+	if (data->texLoc == WATER_TEX_LOC && useWaterAnim) return false;
+#endif
+
+	/* Only one animation can be drawn from a layer per tile */
+	for (i = 0; i < anims_count; i++) 
+	{
+		if (anims_list[i].texLoc == data->texLoc && anims_list[i].layer >= 0) return false;
+	}
+	return true;
+}
+
+/* Uploads all frames of animations into extra texture array layers, one layer per animation */
+static void Animations_LoadLayers(void) {
+	struct AnimationData* data;
+	struct Bitmap frame;
+	int i, j, size, first;
+	if (!MapRenderer_TextureArray) return;
+
+	for (i = 0; i < anims_count; i++) 
+	{
+		data = &anims_list[i];
+		if (Animations_CanUseLayer(data)) data->layer = anims_layersCount++;
+	}
+	if (!anims_layersCount) return;
+
+	first = Atlas1D_AddLayers(anims_layersCount);
+	if (first < 0) {
+		for (i = 0; i < anims_count; i++) anims_list[i].layer = -1;
+		anims_layersCount = 0; return;
+	}
+
+	for (i = 0; i < anims_count; i++) 
+	{
+		data = &anims_list[i];
+		if (data->layer < 0) continue;
+		size = data->frameSize;
+
+		/* Frame N is stored at the position of tile N in the layer */
+		for (j = 0; j < data->statesCount; j++) 
+		{
+			Bitmap_Init(frame, size, size, anims_bmp.scan0 
+				+ data->frameY * anims_bmp.width + (data->frameX + j * size));
+			Gfx_UpdateTextureLayer(Atlas1D.ArrayTexId, first + data->layer, 0, j * size, 
+									&frame, anims_bmp.width, Gfx.Mipmaps);
+		}
+
+		Atlas1D.LayerV[data->texLoc] = (first + data->layer) * 2;
+		anims_layerOffsets[data->layer] = data->state * Atlas1D.InvTileSize;
+	}
+
+	anims_firstLayer = first;
+	Gfx_SetLayerOffsets(first, anims_layerOffsets, anims_layersCount);
+	MapRenderer_RefreshAll();
+}
+
+static void Animations_ClearLayers(void) {
+	if (!anims_layersCount) return;
+	anims_layersCount = 0;
+
+	Atlas1D_ResetLayerV();
+	Gfx_SetLayerOffsets(0, NULL, 0);
+	MapRenderer_RefreshAll();
 }
 
 static cc_bool Animations_IsDefaultZip(void) {
@@ -292,6 +443,10 @@ static cc_bool Animations_IsDefaultZip(void) {
 }
 
 static void Animations_Clear(void) {
+#ifndef CC_BUILD_WEB
+	LiquidFrames_Free(&lavaFrames);
+	LiquidFrames_Free(&waterFrames);
+#endif
 	Mem_Free(anims_bmp.scan0);
 	anims_count = 0;
 	anims_bmp.scan0 = NULL;
@@ -334,10 +489,11 @@ static void Animations_Validate(void) {
 }
 
 static void Animations_Tick(struct ScheduledTask* task) {
+	cc_bool changed = false;
 	int i;
 #ifndef CC_BUILD_WEB
-	if (useLavaAnim)  LavaAnimation_Tick();
-	if (useWaterAnim) WaterAnimation_Tick();
+	if (useLavaAnim)  LiquidAnimation_Tick(&lavaFrames,  LavaAnimation_Simulate,  LAVA_TEX_LOC);
+	if (useWaterAnim) LiquidAnimation_Tick(&waterFrames, WaterAnimation_Simulate, WATER_TEX_LOC);
 #endif
 
 	if (!anims_count) return;
@@ -348,10 +504,15 @@ static void Animations_Tick(struct ScheduledTask* task) {
 	}
 
 	/* deferred, because when reading animations.txt, might not have read animations.png yet */
-	if (!anims_validated) Animations_Validate();
+	if (!anims_validated) {
+		Animations_Validate();
+		Animations_LoadLayers();
+	}
+
 	for (i = 0; i < anims_count; i++) {
-		Animations_Apply(&anims_list[i]);
+		changed |= Animations_Apply(&anims_list[i]);
 	}
+	if (changed) Gfx_SetLayerOffsets(anims_firstLayer, anims_layerOffsets, anims_layersCount);
 }
 
 
@@ -383,7 +544,13 @@ static struct TextureEntry lava_entry = { "uselavaanim", UseLavaProcess };
 
 
 static void OnPackChanged(void* obj) {
+	/* Animations are reset for each texture pack, so must be extracted again even if unchanged */
+	TextureEntry_Forget(animations_entry.filename);
+	TextureEntry_Forget(animations_txt.filename);
+	TextureEntry_Forget(water_entry.filename);
+	TextureEntry_Forget(lava_entry.filename);
 	Animations_Clear();
+	Animations_ClearLayers();
 	useLavaAnim     = Animations_IsDefaultZip();
 	useWaterAnim    = useLavaAnim;
 	alwaysLavaAnim  = false;
@@ -396,6 +563,9 @@ static void OnInit(void) {
 	TextureEntry_Register(&lava_entry);
 
 	ScheduledTask_Add(GAME_DEF_TICKS, Animations_Tick);
+#ifndef CC_BUILD_WEB
+	liquid_framesCount = Options_GetInt(OPT_LIQUID_ANIM_FRAMES, 0, 1024, 0);
+#endif
 	Event_Register_(&TextureEvents.PackChanged, NULL, OnPackChanged);
 }
 #else
@@ -13,6 +13,8 @@
 #include "Utils.h"
 #include "Options.h"
 #include "Deflate.h"
+#include "Camera.h"
+#include "Vectors.h"
 #ifdef CC_BUILD_ANDROID
 /* TODO: Refactor maybe to not rely on checking WinInfo.Handle != NULL */
 #include "Window.h"
@@ -25,6 +27,7 @@ static const cc_string audio_dir = String_FromConst("audio");
 
 struct Sound {
 	int channels, sampleRate;
+	int rate; /* Playback rate already applied to the sample data (100 = unchanged) */
 	struct AudioChunk chunk;
 };
 
@@ -51,7 +54,10 @@ struct SoundGroup {
 	int count;
 	struct Sound sounds[AUDIO_MAX_SOUNDS];
 };
-struct Soundboard { struct SoundGroup groups[SOUND_COUNT]; };
+struct Soundboard { 
+	struct SoundGroup groups[SOUND_COUNT]; 
+	struct SoundGroup metal; /* Stone sounds converted for metal playback rate */
+};
 
 static struct Soundboard digBoard, stepBoard;
 static RNGState sounds_rnd;
@@ -86,6 +92,7 @@ static cc_result Sound_ReadWaveData(struct Stream* stream, struct Sound* snd) {
 
 			snd->channels   = Stream_GetU16_LE(tmp + 2);
 			snd->sampleRate = Stream_GetU32_LE(tmp + 4);
+			snd->rate       = 100;
 			/* tmp[8] (6) alignment data and stuff */
 
 			bitsPerSample = Stream_GetU16_LE(tmp + 14);
@@ -106,6 +113,89 @@ static cc_result Sound_ReadWaveData(struct Stream* stream, struct Sound* snd) {
 	}
 }
 
+/* https://minecraft.wiki/w/Block_of_Gold#Sounds */
+/* https://minecraft.wiki/w/Grass#Sounds */
+static int Soundboard_PlaybackRate(struct Soundboard* board, int type) {
+	if (board == &digBoard) return type == SOUND_METAL ? 120 : 80;
+	return type == SOUND_METAL ? 140 : 100;
+}
+
+/* Not worth the extra memory on systems with very little of it */
+#ifndef CC_BUILD_LOWMEM
+/* Sounds are converted when loaded to this sample rate, with their playback rate already applied */
+/* This way playing sounds never needs a context's format to change, or the backend to resample */
+#define SOUNDS_SAMPLE_RATE 44100
+#define SOUND_FRAC_BITS 16
+#define SOUND_FRAC_MASK ((1 << SOUND_FRAC_BITS) - 1)
+
+/* Resamples the sample data of src into a new chunk, with linear interpolation */
+static cc_result Sound_Resample(const struct Sound* src, struct Sound* dst, int rate) {
+	const cc_int16* data = (const cc_int16*)src->chunk.data;
+	int channels  = src->channels;
+	int srcFrames = channels > 0 ? src->chunk.size / (2 * channels) : 0;
+	cc_uint64 step, pos;
+	int i, j, frames, idx, frac, a, b;
+	cc_int16* out;
+	cc_result res;
+
+	step = ((cc_uint64)src->sampleRate * rate << SOUND_FRAC_BITS) / (100 * SOUNDS_SAMPLE_RATE);
+	if (srcFrames < 2 || !step) return ERR_INVALID_ARGUMENT;
+	/* Last output sample must still have a source sample after it to interpolate towards */
+	frames = (int)((((cc_uint64)srcFrames - 1) << SOUND_FRAC_BITS) / step);
+
+	if ((res = Audio_AllocChunks(frames * channels * 2, &dst->chunk, 1))) return res;
+	out = (cc_int16*)dst->chunk.data;
+
+	for (i = 0, pos = 0; i < frames; i++, pos += step) 
+	{
+		idx  = (int)(pos >> SOUND_FRAC_BITS) * channels;
+		frac = (int)(pos &  SOUND_FRAC_MASK);
+
+		for (j = 0; j < channels; j++) 
+		{
+			a = data[idx + j]; b = data[idx + channels + j];
+			*out++ = (cc_int16)(a + (int)(((cc_int64)(b - a) * frac) >> SOUND_FRAC_BITS));
+		}
+	}
+
+	dst->chunk.size = frames * channels * 2;
+	dst->channels   = channels;
+	dst->sampleRate = SOUNDS_SAMPLE_RATE;
+	dst->rate       = rate;
+	return 0;
+}
+
+/* Converts the given sound so that it can be played at the given playback rate as is */
+static void Sound_Convert(struct Sound* snd, const cc_string* file, int rate) {
+	struct Sound src = *snd;
+	cc_result res;
+	if (snd->sampleRate == SOUNDS_SAMPLE_RATE && rate == 100) return;
+
+	res = Sound_Resample(&src, snd, rate);
+	if (res) { 
+		/* Sound can still be played without being converted */
+		Logger_SysWarn2(res, "converting", file);
+		*snd = src; return;
+	}
+	Audio_FreeChunks(&src.chunk, 1);
+}
+
+static void Soundboard_Convert(struct Soundboard* board, struct SoundGroup* group, const cc_string* file) {
+	struct Sound* snd = &group->sounds[group->count];
+	int type = (int)(group - board->groups);
+	struct Sound* metal;
+
+	/* Metal sounds are stone sounds played at a different rate */
+	if (type == SOUND_STONE) {
+		metal = &board->metal.sounds[board->metal.count];
+		if (!Sound_Resample(snd, metal, Soundboard_PlaybackRate(board, SOUND_METAL))) board->metal.count++;
+	}
+	Sound_Convert(snd, file, Soundboard_PlaybackRate(board, type));
+}
+#else
+static void Soundboard_Convert(struct Soundboard* board, struct SoundGroup* group, const cc_string* file) { }
+#endif
+
 static struct SoundGroup* Soundboard_FindGroup(struct Soundboard* board, const cc_string* name) {
 	struct SoundGroup* groups = board->groups;
 	int i;
@@ -150,7 +240,10 @@ static void Soundboard_Load(struct Soundboard* board, const cc_string* boardName
 		Audio_FreeChunks(&snd->chunk, 1);
 		snd->chunk.data = NULL;
 		snd->chunk.size = 0;
-	} else { group->count++; }
+	} else { 
+		Soundboard_Convert(board, group, file);
+		group->count++; 
+	}
 }
 
 static const struct Sound* Soundboard_PickRandom(struct Soundboard* board, cc_uint8 type) {
@@ -158,9 +251,12 @@ static const struct Sound* Soundboard_PickRandom(struct Soundboard* board, cc_ui
 	int idx;
 
 	if (type == SOUND_NONE || type >= SOUND_COUNT) return NULL;
-	if (type == SOUND_METAL) type = SOUND_STONE;
-
-	group = &board->groups[type];
+	if (type == SOUND_METAL && board->metal.count) {
+		group = &board->metal;
+	} else {
+		if (type == SOUND_METAL) type = SOUND_STONE;
+		group = &board->groups[type];
+	}
 	if (!group->count) return NULL;
 
 	idx = Random_Next(&sounds_rnd, group->count);
@@ -168,48 +264,315 @@ static const struct Sound* Soundboard_PickRandom(struct Soundboard* board, cc_ui
 }
 
 
+/*########################################################################################################################*
+*------------------------------------------------------Sound mixer--------------------------------------------------------*
+*#########################################################################################################################*/
+/* Mixing needs the raw samples of sounds, and a thread that isn't starved by the game thread */
+#if !defined CC_BUILD_WEBAUDIO && !defined CC_BUILD_COOPTHREADED
+/* Mixes all playing sounds into a single stream of audio, instead of playing each on its own context */
+/* This way playing lots of sounds at once doesn't run out of contexts or need contexts to be recreated */
+#define MIXER_MAX_VOICES 16
+#define MIXER_SAMPLE_RATE 44100
+#define MIXER_CHANNELS 2
+/* Number of stereo samples in each chunk (about 23 milliseconds of audio) */
+#define MIXER_CHUNK_FRAMES 1024
+#define MIXER_BUFFERS 3
+#define MIXER_POLL_INTERVAL 10
+/* Voice positions are fixed point, to allow resampling sounds for playback rate changes */
+#define MIXER_FRAC_BITS 12
+#define MIXER_FRAC_MASK ((1 << MIXER_FRAC_BITS) - 1)
+
+struct MixerVoice {
+	const cc_int16* data; /* NULL when voice isn't playing anything */
+	int frames, channels;
+	cc_uint32 pos, step;
+	int left, right; /* Volume of each channel, 256 = normal volume */
+	int priority; /* Voices with lower priority are replaced first */
+};
+
+static struct MixerVoice mixer_voices[MIXER_MAX_VOICES];
+static struct AudioChunk mixer_chunks[MIXER_BUFFERS];
+static void* mixer_thread;
+static void* mixer_mutex;
+static void* mixer_waitable;
+static volatile cc_bool mixer_stopping, mixer_failed;
+static cc_bool mixer_enabled;
+
+static void Mixer_AddVoice(struct MixerVoice* v, cc_int32* accum) {
+	const cc_int16* src = v->data;
+	cc_uint32 pos = v->pos;
+	int i, idx, frac, l, r;
+
+	for (i = 0; i < MIXER_CHUNK_FRAMES; i++, pos += v->step) 
+	{
+		idx = (int)(pos >> MIXER_FRAC_BITS);
+		if (idx >= v->frames - 1) { v->data = NULL; return; }
+		frac = (int)(pos & MIXER_FRAC_MASK);
+
+		/* Linearly interpolate between the two nearest samples */
+		if (v->channels == 1) {
+			l = src[idx]     + (((src[idx + 1]     - src[idx])     * frac) >> MIXER_FRAC_BITS);
+			r = l;
+		} else {
+			l = src[idx * 2] + (((src[idx * 2 + 2] - src[idx * 2]) * frac) >> MIXER_FRAC_BITS);
+			r = src[idx*2+1] + (((src[idx * 2 + 3] - src[idx*2+1]) * frac) >> MIXER_FRAC_BITS);
+		}
+
+		accum[i * 2 + 0] += (l * v->left)  >> 8;
+		accum[i * 2 + 1] += (r * v->right) >> 8;
+	}
+	v->pos = pos;
+}
+
+/* Mixes the next chunk of audio from all playing voices, returning whether any voices were playing */
+static cc_bool Mixer_MixChunk(struct AudioChunk* chunk) {
+	cc_int32 accum[MIXER_CHUNK_FRAMES * MIXER_CHANNELS] = { 0 };
+	cc_int16* dst = (cc_int16*)chunk->data;
+	cc_bool playing = false;
+	int i, sample;
+
+	Mutex_Lock(mixer_mutex);
+	for (i = 0; i < MIXER_MAX_VOICES; i++) 
+	{
+		if (!mixer_voices[i].data) continue;
+		Mixer_AddVoice(&mixer_voices[i], accum);
+		playing = true;
+	}
+	Mutex_Unlock(mixer_mutex);
+
+	for (i = 0; i < MIXER_CHUNK_FRAMES * MIXER_CHANNELS; i++) 
+	{
+		sample = accum[i];
+		Math_Clamp(sample, -32768, 32767);
+		dst[i] = (cc_int16)sample;
+	}
+	chunk->size = MIXER_CHUNK_FRAMES * MIXER_CHANNELS * 2;
+	return playing;
+}
+
+static cc_bool Mixer_AnyPlaying(void) {
+	cc_bool playing = false;
+	int i;
+
+	Mutex_Lock(mixer_mutex);
+	for (i = 0; i < MIXER_MAX_VOICES; i++) 
+	{
+		if (mixer_voices[i].data) playing = true;
+	}
+	Mutex_Unlock(mixer_mutex);
+	return playing;
+}
+
+/* Plays audio until no voices have been playing for a few chunks */
+static cc_result Mixer_PlayVoices(void) {
+	int i, inUse, cur = 0, silent = 0;
+	cc_result res;
+
+	for (i = 0; i < MIXER_BUFFERS; i++) 
+	{
+		Mixer_MixChunk(&mixer_chunks[i]);
+		if ((res = Audio_QueueChunk(&mixer_ctx, &mixer_chunks[i]))) return res;
+	}
+	if ((res = Audio_Play(&mixer_ctx))) return res;
+
+	while (!mixer_stopping && silent < MIXER_BUFFERS) {
+		if ((res = Audio_Poll(&mixer_ctx, &inUse))) return res;
+
+		if (inUse >= MIXER_BUFFERS) {
+			Waitable_WaitFor(mixer_waitable, MIXER_POLL_INTERVAL); continue;
+		}
+
+		silent = Mixer_MixChunk(&mixer_chunks[cur]) ? 0 : silent + 1;
+		if ((res = Audio_QueueChunk(&mixer_ctx, &mixer_chunks[cur]))) return res;
+		cur = (cur + 1) % MIXER_BUFFERS;
+	}
+
+	/* Let the queued chunks finish, so playback can be restarted the same way later */
+	while (!mixer_stopping) {
+		if ((res = Audio_Poll(&mixer_ctx, &inUse))) return res;
+		if (!inUse) break;
+		Waitable_WaitFor(mixer_waitable, MIXER_POLL_INTERVAL);
+	}
+	return 0;
+}
+
+static void Mixer_RunLoop(void) {
+	cc_result res;
+
+	res = Audio_Init(&mixer_ctx, MIXER_BUFFERS);
+	if (!res) res = Audio_SetFormat(&mixer_ctx, MIXER_CHANNELS, MIXER_SAMPLE_RATE, 100);
+	if (!res) res = Audio_AllocChunks(MIXER_CHUNK_FRAMES * MIXER_CHANNELS * 2, mixer_chunks, MIXER_BUFFERS);
+	if (!res) Audio_SetVolume(&mixer_ctx, 100);
+
+	while (!res && !mixer_stopping) {
+		/* Sleep until a sound is played */
+		Waitable_Wait(mixer_waitable);
+		if (mixer_stopping || !Mixer_AnyPlaying()) continue;
+		res = Mixer_PlayVoices();
+	}
+
+	if (res) {
+		Audio_Warn(res, "mixing sounds");
+		mixer_failed = true;
+	}
+	/* Must close the context first, as it may still reference chunk data */
+	Audio_Close(&mixer_ctx);
+	if (mixer_chunks[0].data) Audio_FreeChunks(mixer_chunks, MIXER_BUFFERS);
+	Mem_Set(mixer_chunks, 0, sizeof(mixer_chunks));
+}
+
+static void Mixer_Start(void) {
+	mixer_stopping = false;
+	mixer_mutex    = Mutex_Create("Sound mixer voices");
+	mixer_waitable = Waitable_Create("Sound mixer sleep");
+	Thread_Run(&mixer_thread, Mixer_RunLoop, 64 * 1024, "Sound mixer");
+}
+
+static void Mixer_Stop(void) {
+	if (!mixer_thread) return;
+	mixer_stopping = true;
+	Waitable_Signal(mixer_waitable);
+
+	Thread_Join(mixer_thread);
+	mixer_thread = NULL;
+	Mem_Set(mixer_voices, 0, sizeof(mixer_voices));
+
+	Mutex_Free(mixer_mutex);
+	Waitable_Free(mixer_waitable);
+}
+
+/* Returns the voice that a new sound with the given priority should be played on, or NULL if none */
+static struct MixerVoice* Mixer_FindVoice(int priority) {
+	struct MixerVoice* best = NULL;
+	struct MixerVoice* v;
+	int i;
+
+	for (i = 0; i < MIXER_MAX_VOICES; i++) 
+	{
+		v = &mixer_voices[i];
+		if (!v->data) return v;
+		if (v->priority > priority) continue;
+
+		/* Replace the lowest priority voice, preferring voices that are closest to finishing */
+		if (!best || v->priority < best->priority || 
+			(v->priority == best->priority && v->pos / v->frames > best->pos / best->frames)) best = v;
+	}
+	return best;
+}
+
+/* Attempts to play the given sound using the mixer, returning false if the mixer can't be used */
+/* pan ranges from -100 (only left channel) to 100 (only right channel) */
+static cc_bool Mixer_Play(const struct AudioData* data, int priority, int pan) {
+	struct MixerVoice* v;
+	int frames, volume = data->volume * 256 / 100;
+	if (!mixer_enabled || mixer_failed || data->channels < 1 || data->channels > 2) return false;
+
+	if (!mixer_thread) Mixer_Start();
+	frames = data->chunk.size / (2 * data->channels);
+	if (frames < 2) return true;
+
+	Mutex_Lock(mixer_mutex);
+	v = Mixer_FindVoice(priority);
+	if (v) {
+		v->data     = (const cc_int16*)data->chunk.data;
+		v->frames   = frames;
+		v->channels = data->channels;
+		v->pos      = 0;
+		v->step     = (cc_uint32)(((cc_uint64)data->sampleRate * data->rate << MIXER_FRAC_BITS) / (100 * MIXER_SAMPLE_RATE));
+		v->left     = pan > 0 ? volume * (100 - pan) / 100 : volume;
+		v->right    = pan < 0 ? volume * (100 + pan) / 100 : volume;
+		v->priority = priority;
+	}
+	Mutex_Unlock(mixer_mutex);
+
+	Waitable_Signal(mixer_waitable);
+	return true;
+}
+#else
+static void Mixer_Stop(void) { }
+static cc_bool Mixer_Play(const struct AudioData* data, int priority, int pan) { return false; }
+#endif
+
+
 CC_NOINLINE static void Sounds_Fail(cc_result res) {
 	Audio_Warn(res, "playing sounds");
 	Chat_AddRaw("&cDisabling sounds");
 	Audio_SetSounds(0);
 }
 
-static void Sounds_Play(cc_uint8 type, struct Soundboard* board) {
+static cc_bool sounds_loaded, sounds_deferred;
+static void Sounds_Load(void);
+
+/* volume is percentage of normal volume to play at, pan is as in Mixer_Play */
+static void Sounds_Play(cc_uint8 type, struct Soundboard* board, int volume, int pan) {
 	const struct Sound* snd;
 	struct AudioData data;
 	cc_result res;
 
 	if (type == SOUND_NONE || !Audio_SoundsVolume) return;
+	/* Sound played before the deferred loading has happened */
+	if (!sounds_loaded) Sounds_Load();
+	data.volume = Audio_SoundsVolume * volume / 100;
+	if (board == &stepBoard) data.volume /= 2;
+	if (!data.volume) return;
+
 	snd = Soundboard_PickRandom(board, type);
 	if (!snd) return;
 
 	data.chunk      = snd->chunk;
 	data.channels   = snd->channels;
 	data.sampleRate = snd->sampleRate;
-	data.rate       = 100;
-	data.volume     = Audio_SoundsVolume;
-
-	/* https://minecraft.wiki/w/Block_of_Gold#Sounds */
-	/* https://minecraft.wiki/w/Grass#Sounds */
-	if (board == &digBoard) {
-		if (type == SOUND_METAL) data.rate = 120;
-		else data.rate = 80;
-	} else {
-		data.volume /= 2;
-		if (type == SOUND_METAL) data.rate = 140;
-	}
+
+	/* Usually 100, as playback rate was already applied when the sound was loaded */
+	data.rate = Soundboard_PlaybackRate(board, type) * 100 / snd->rate;
+	/* Dig sounds are more important than footsteps when there's too many sounds playing */
+	/* NOTE: Only the mixer can pan sounds, the audio backends just play them as is */
+	if (Mixer_Play(&data, board == &digBoard, pan)) return;
 	
 	res = AudioPool_Play(&data);
 	if (res) Sounds_Fail(res);
 }
 
+/* Sounds are played at full volume up to this distance from the camera, then fade out */
+#define SOUNDS_FULL_DISTANCE 4.0f
+/* Sounds further than this distance from the camera aren't played at all */
+#define SOUNDS_MAX_DISTANCE 16.0f
+
+/* Calculates volume and panning a sound at the given block is heard with, returning false if too far away */
+static cc_bool Sounds_Locate(IVec3 coords, int* volume, int* pan) {
+	Vec3 delta;
+	Vec2 rot;
+	float dist, side;
+
+	delta.x = coords.x + 0.5f - Camera.CurrentPos.x;
+	delta.y = coords.y + 0.5f - Camera.CurrentPos.y;
+	delta.z = coords.z + 0.5f - Camera.CurrentPos.z;
+	dist    = Math_SqrtF(Vec3_LengthSquared(&delta));
+	if (dist >= SOUNDS_MAX_DISTANCE) return false;
+
+	*volume = 100;
+	if (dist > SOUNDS_FULL_DISTANCE) {
+		*volume = (int)(100 * (SOUNDS_MAX_DISTANCE - dist) / (SOUNDS_MAX_DISTANCE - SOUNDS_FULL_DISTANCE));
+	}
+	if (dist < 0.01f) { *pan = 0; return true; }
+
+	/* Project onto the camera's right direction, so sounds to the left come more from the left channel */
+	rot   = Camera.Active->GetOrientation();
+	side  = delta.x * Math_CosF(rot.x) + delta.z * Math_SinF(rot.x);
+	*pan  = (int)(100 * side / dist);
+	return true;
+}
+
 static void Audio_PlayBlockSound(void* obj, IVec3 coords, BlockID old, BlockID now) {
+	int volume, pan;
+	if (!Audio_SoundsVolume || !Sounds_Locate(coords, &volume, &pan)) return;
+
 	if (now == BLOCK_AIR) {
-		Audio_PlayDigSound(Blocks.DigSounds[old]);
+		Sounds_Play(Blocks.DigSounds[old], &digBoard, volume, pan);
 	} else if (!Game_ClassicMode) {
 		/* use StepSounds instead when placing, as don't want */
 		/*  to play glass break sound when placing glass */
-		Audio_PlayDigSound(Blocks.StepSounds[now]);
+		Sounds_Play(Blocks.StepSounds[now], &digBoard, volume, pan);
 	}
 }
 
@@ -228,7 +591,7 @@ static cc_result Sounds_ExtractZip(const cc_string* path) {
 	struct Stream stream;
 	cc_result res;
 
-	res = Stream_OpenFile(&stream, path);
+	res = Stream_OpenSequentialFile(&stream, path);
 	if (res) { Logger_SysWarn2(res, "opening", path); return res; }
 
 	res = Zip_Extract(&stream, SelectZipEntry, ProcessZipEntry,
@@ -274,21 +637,15 @@ static void InitWebSounds(void) {
 			board = &digBoard;
 		} else {
 			group = &board->groups[sounds_list[i].group];
+			group->sounds[group->count].rate = 100;
 			group->sounds[group->count++].chunk.data = sounds_list[i].name;
 		}
 	}
 }
 #endif
 
-static cc_bool sounds_loaded;
-static void Sounds_Start(void) {
+static void Sounds_Load(void) {
 	cc_result res;
-	if (!AudioBackend_Init()) { 
-		AudioBackend_Free(); 
-		Audio_SoundsVolume = 0; 
-		return; 
-	}
-
 	if (sounds_loaded) return;
 	sounds_loaded = true;
 #ifdef CC_BUILD_WEBAUDIO
@@ -300,17 +657,36 @@ static void Sounds_Start(void) {
 #endif
 }
 
-static void Sounds_Stop(void) { AudioPool_Close(); }
+static void Sounds_Start(void) {
+	if (!AudioBackend_Init()) { 
+		AudioBackend_Free(); 
+		Audio_SoundsVolume = 0; 
+		return; 
+	}
+
+	/* Decoding all the sounds takes a while, so avoid delaying startup with it */
+	if (sounds_loaded || sounds_deferred) return;
+	sounds_deferred = true;
+	Game_DeferTask(Sounds_Load, "Loading sounds");
+}
+
+static void Sounds_Stop(void) { 
+	Mixer_Stop();
+	AudioPool_Close(); 
+}
 
 static void Sounds_Init(void) {
 	int volume = Options_GetInt(OPT_SOUND_VOLUME, 0, 100, DEFAULT_SOUNDS_VOLUME);
+#if !defined CC_BUILD_WEBAUDIO && !defined CC_BUILD_COOPTHREADED
+	mixer_enabled = Options_GetBool(OPT_SOUNDS_MIXER, false);
+#endif
 	Audio_SetSounds(volume);
 	Event_Register_(&UserEvents.BlockChanged, NULL, Audio_PlayBlockSound);
 }
 static void Sounds_Free(void) { Sounds_Stop(); }
 
-void Audio_PlayDigSound(cc_uint8 type)  { Sounds_Play(type, &digBoard); }
-void Audio_PlayStepSound(cc_uint8 type) { Sounds_Play(type, &stepBoard); }
+void Audio_PlayDigSound(cc_uint8 type)  { Sounds_Play(type, &digBoard,  100, 0); }
+void Audio_PlayStepSound(cc_uint8 type) { Sounds_Play(type, &stepBoard, 100, 0); }
 #endif
 
 
@@ -326,17 +702,26 @@ static void Music_Start(void) {
 	Chat_AddRaw("&cMusic is not supported currently");
 	Audio_MusicVolume = 0;
 }
+
+void Audio_BenchmarkVorbis(cc_bool save) {
+	Chat_AddRaw("&cMusic is not supported currently");
+}
 #else
 static void* music_thread;
 static void* music_waitable;
 static volatile cc_bool music_stopping, music_joining;
 static int music_minDelay, music_maxDelay;
+/* Number of chunks of music decoded ahead of what is currently playing */
+static int music_buffers;
+/* Each chunk holds about a second of audio, so there's no need to check for finished chunks often */
+#define MUSIC_POLL_INTERVAL 250
 
 static cc_result Music_Buffer(struct AudioChunk* chunk, int maxSamples, struct VorbisState* ctx) {
 	int samples = 0;
 	cc_int16* cur;
 	cc_result res = 0, res2;
 	cc_int16* data = (cc_int16*)chunk->data;
+	Tracer_Begin("Music_Buffer");
 
 	while (samples < maxSamples) {
 		if ((res = Vorbis_DecodeFrame(ctx))) break;
@@ -344,6 +729,7 @@ static cc_result Music_Buffer(struct AudioChunk* chunk, int maxSamples, struct V
 		cur = &data[samples];
 		samples += Vorbis_OutputFrame(ctx, cur);
 	}
+	Tracer_End();
 
 	chunk->size = samples * 2;
 	res2 = Audio_QueueChunk(&music_ctx, chunk);
@@ -358,6 +744,7 @@ static cc_result Music_PlayOgg(struct Stream* source) {
 
 	int chunkSize, samplesPerSecond;
 	struct AudioChunk chunks[AUDIO_MAX_BUFFERS] = { 0 };
+	int buffers = music_buffers;
 	int inUse, i, cur;
 	cc_result res;
 
@@ -375,12 +762,12 @@ static cc_result Music_PlayOgg(struct Stream* source) {
 	chunkSize        = channels * (sampleRate + vorbis.blockSizes[1]);
 	samplesPerSecond = channels * sampleRate;
 
-	if ((res = Audio_AllocChunks(chunkSize * 2, chunks, AUDIO_MAX_BUFFERS))) goto cleanup;
+	if ((res = Audio_AllocChunks(chunkSize * 2, chunks, buffers))) goto cleanup;
     volume = Audio_MusicVolume;
     Audio_SetVolume(&music_ctx, volume);	
 
 	/* fill up with some samples before playing */
-	for (i = 0; i < AUDIO_MAX_BUFFERS && !res; i++) 
+	for (i = 0; i < buffers && !res; i++) 
 	{
 		res = Music_Buffer(&chunks[i], samplesPerSecond, &vorbis);
 	}
@@ -397,7 +784,7 @@ static cc_result Music_PlayOgg(struct Stream* source) {
     	if (!Window_Main.Handle.ptr) {
     		Audio_Pause(&music_ctx);
     		while (!Window_Main.Handle.ptr && !music_stopping) {
-    			Thread_Sleep(10); continue;
+    			Waitable_WaitFor(music_waitable, MUSIC_POLL_INTERVAL);
     		}
     		Audio_Play(&music_ctx);
     	}
@@ -410,12 +797,13 @@ static cc_result Music_PlayOgg(struct Stream* source) {
 		res = Audio_Poll(&music_ctx, &inUse);
 		if (res) { music_stopping = true; break; }
 
-		if (inUse >= AUDIO_MAX_BUFFERS) {
-			Thread_Sleep(10); continue;
+		/* Music_Stop signals the waitable, so stopping still happens immediately */
+		if (inUse >= buffers) {
+			Waitable_WaitFor(music_waitable, MUSIC_POLL_INTERVAL); continue;
 		}
 
 		res = Music_Buffer(&chunks[cur], samplesPerSecond, &vorbis);
-		cur = (cur + 1) % AUDIO_MAX_BUFFERS;
+		cur = (cur + 1) % buffers;
 
 		/* need to specially handle last bit of audio */
 		if (res) break;
@@ -430,12 +818,12 @@ static cc_result Music_PlayOgg(struct Stream* source) {
 		/* Wait until the buffers finished playing */
 		for (;;) {
 			if (Audio_Poll(&music_ctx, &inUse) || inUse == 0) break;
-			Thread_Sleep(10);
+			Waitable_WaitFor(music_waitable, MUSIC_POLL_INTERVAL);
 		}
 	}
 
 cleanup:
-	Audio_FreeChunks(chunks, AUDIO_MAX_BUFFERS);
+	Audio_FreeChunks(chunks, buffers);
 	Vorbis_Free(&vorbis);
 	return res == ERR_END_OF_STREAM ? 0 : res;
 }
@@ -472,7 +860,7 @@ static void Music_RunLoop(void) {
 		path = StringsBuffer_UNSAFE_Get(&files, idx);
 		Platform_Log1("playing music file: %s", &path);
 
-		res = Stream_OpenFile(&stream, &path);
+		res = Stream_OpenSequentialFile(&stream, &path);
 		if (res) { Logger_SysWarn2(res, "opening", &path); break; }
 
 		res = Music_PlayOgg(&stream);
@@ -526,6 +914,7 @@ static void Music_Init(void) {
 	/* music is delayed between 2 - 7 minutes by default */
 	music_minDelay = Options_GetInt(OPT_MIN_MUSIC_DELAY, 0, 3600, 120) * MILLIS_PER_SEC;
 	music_maxDelay = Options_GetInt(OPT_MAX_MUSIC_DELAY, 0, 3600, 420) * MILLIS_PER_SEC;
+	music_buffers  = Options_GetInt(OPT_MUSIC_BUFFERS, 2, AUDIO_MAX_BUFFERS, AUDIO_MAX_BUFFERS);
 	music_waitable = Waitable_Create("Music sleep");
 
 	volume = Options_GetInt(OPT_MUSIC_VOLUME, 0, 100, DEFAULT_MUSIC_VOLUME);
@@ -536,6 +925,125 @@ static void Music_Free(void) {
 	Music_Stop();
 	Waitable_Free(music_waitable);
 }
+
+
+/*########################################################################################################################*
+*----------------------------------------------------Vorbis benchmark-----------------------------------------------------*
+*#########################################################################################################################*/
+/* Stores the expected CRC32 of the decoded samples of each file */
+#define VORBIS_HASHES_FILE "audio/vorbis-hashes.txt"
+
+/* Decodes the entirety of the given file, calculating the CRC32 of the decoded samples */
+static cc_result VorbisBench_Decode(struct Stream* source, cc_uint32* crc, cc_uint64* samples, cc_uint64* elapsed) {
+	struct OggState ogg;
+	struct VorbisState vorbis;
+	cc_int16* data = NULL;
+	cc_uint64 beg;
+	cc_result res;
+	int count;
+
+	Ogg_Init(&ogg, source);
+	Vorbis_Init(&vorbis);
+	vorbis.source = &ogg;
+	*crc = 0xFFFFFFFFUL;
+	*samples = 0; *elapsed = 0;
+
+	beg = Stopwatch_Measure();
+	if ((res = Vorbis_DecodeHeaders(&vorbis))) goto cleanup;
+	*elapsed += Stopwatch_ElapsedMicroseconds(beg, Stopwatch_Measure());
+
+	/* largest possible vorbis frame decodes to blocksize1 * channels samples */
+	data = (cc_int16*)Mem_TryAlloc(vorbis.channels * vorbis.blockSizes[1], 2);
+	if (!data) { res = ERR_OUT_OF_MEMORY; goto cleanup; }
+
+	for (;;) {
+		/* Only decoding is timed, not calculating the CRC32 */
+		beg = Stopwatch_Measure();
+		if ((res = Vorbis_DecodeFrame(&vorbis))) break;
+		count = Vorbis_OutputFrame(&vorbis, data);
+		*elapsed += Stopwatch_ElapsedMicroseconds(beg, Stopwatch_Measure());
+
+		*samples += count;
+		*crc = Utils_UpdateCRC32(*crc, (cc_uint8*)data, count * 2);
+	}
+
+cleanup:
+	*crc ^= 0xFFFFFFFFUL;
+	Mem_Free(data);
+	Vorbis_Free(&vorbis);
+	return res == ERR_END_OF_STREAM ? 0 : res;
+}
+
+static void VorbisBench_File(struct StringsBuffer* hashes, const cc_string* path, cc_bool save) {
+	cc_string hash; char hashBuffer[16];
+	cc_string expected;
+	struct Stream stream;
+	cc_uint64 samples, elapsed;
+	cc_uint32 crc;
+	int rate;
+	cc_result res;
+
+	res = Stream_OpenFile(&stream, path);
+	if (res) { Logger_SysWarn2(res, "opening", path); return; }
+
+	res = VorbisBench_Decode(&stream, &crc, &samples, &elapsed);
+	/* No point logging error for closing readonly file */
+	(void)stream.Close(&stream);
+	if (res) { Logger_SysWarn2(res, "decoding", path); return; }
+
+	String_InitArray(hash, hashBuffer);
+	String_Format1(&hash, "%h", &crc);
+	rate = (int)(samples * 1000 / (elapsed ? elapsed : 1));
+
+	if (save) {
+		EntryList_Set(hashes, path, &hash, '=');
+		Chat_Add3("&f%s: &e%i &fK samples/s, CRC32 &e%s &f(saved)", path, &rate, &hash);
+		return;
+	}
+
+	expected = EntryList_UNSAFE_Get(hashes, path, '=');
+	if (!expected.length) {
+		Chat_Add3("&f%s: &e%i &fK samples/s, CRC32 &e%s &7(no reference)", path, &rate, &hash);
+	} else if (String_CaselessEquals(&expected, &hash)) {
+		Chat_Add3("&f%s: &e%i &fK samples/s, CRC32 &e%s &a(matches)", path, &rate, &hash);
+	} else {
+		Chat_Add4("&f%s: &e%i &fK samples/s, CRC32 &e%s &c(expected %s)", path, &rate, &hash, &expected);
+	}
+}
+
+void Audio_BenchmarkVorbis(cc_bool save) {
+	struct StringsBuffer files, hashes;
+	cc_uint64 beg;
+	cc_string path;
+	int i, elapsed;
+
+	StringsBuffer_SetLengthBits(&files, STRINGSBUFFER_DEF_LEN_SHIFT);
+	StringsBuffer_Init(&files);
+	StringsBuffer_Init(&hashes);
+
+	Directory_Enum(&audio_dir, &files, Music_AddFile);
+	if (!save) EntryList_Load(&hashes, VORBIS_HASHES_FILE, '=', NULL);
+	if (!files.count) Chat_AddRaw("&cNo .ogg files found in audio folder");
+
+	beg = Stopwatch_Measure();
+	for (i = 0; i < files.count; i++) 
+	{
+		path = StringsBuffer_UNSAFE_Get(&files, i);
+		VorbisBench_File(&hashes, &path, save);
+	}
+	elapsed = Stopwatch_ElapsedMS(beg, Stopwatch_Measure());
+
+	if (files.count) {
+		Chat_Add2("&eDecoded &f%i &efiles in &f%i &ems", &files.count, &elapsed);
+	}
+	if (save && files.count) {
+		EntryList_Save(&hashes, VORBIS_HASHES_FILE);
+		Chat_AddRaw("&eSaved reference CRC32s to &f" VORBIS_HASHES_FILE);
+	}
+
+	StringsBuffer_Clear(&files);
+	StringsBuffer_Clear(&hashes);
+}
 #endif
 
 
@@ -50,6 +50,9 @@ void Audio_SetMusic(int volume);
 void Audio_SetSounds(int volume);
 void Audio_PlayDigSound(cc_uint8 type);
 void Audio_PlayStepSound(cc_uint8 type);
+/* Decodes every .ogg file in the audio folder, reporting decode speed and CRC32 of the output samples. */
+/* If save is true, the CRC32s are saved as reference, otherwise they're compared against saved reference. */
+void Audio_BenchmarkVorbis(cc_bool save);
 #define AUDIO_MAX_BUFFERS 4
 
 cc_bool AudioBackend_Init(void);
@@ -85,6 +88,8 @@ cc_result Audio_AllocChunks(cc_uint32 size, struct AudioChunk* chunks, int numCh
 void Audio_FreeChunks(struct AudioChunk* chunks, int numChunks);
 
 extern struct AudioContext music_ctx;
+/* Audio context used to play sounds mixed together by the sound mixer */
+extern struct AudioContext mixer_ctx;
 void Audio_Warn(cc_result res, const char* action);
 
 cc_result AudioPool_Play(struct AudioData* data);
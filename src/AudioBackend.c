@@ -1824,6 +1824,7 @@ static void AudioBase_FreeChunks(struct AudioChunk* chunks, int numChunks) {
 *---------------------------------------------------Audio context code----------------------------------------------------*
 *#########################################################################################################################*/
 struct AudioContext music_ctx;
+struct AudioContext mixer_ctx;
 #define POOL_MAX_CONTEXTS 8
 static struct AudioContext context_pool[POOL_MAX_CONTEXTS];
 
@@ -1,4 +1,19 @@
 #include "Bitmap.h"
+#if defined CC_BUILD_SSE2
+	#include <emmintrin.h>
+	#define PNG_SSE2
+#elif defined CC_BUILD_NEON
+	#include <arm_neon.h>
+	#define PNG_NEON
+#endif
+
+/* Expanding with SIMD only supports 32 bpp BGRA or RGBA bitmaps */
+#if defined BITMAP_16BPP || BITMAPCOLOR_A_SHIFT != 24
+#elif BITMAPCOLOR_R_SHIFT == 16 && BITMAPCOLOR_B_SHIFT == 0
+	#define PNG_EXPAND_BGRA
+#elif BITMAPCOLOR_R_SHIFT == 0 && BITMAPCOLOR_B_SHIFT == 16
+	#define PNG_EXPAND_RGBA
+#endif
 #include "Platform.h"
 #include "ExtMath.h"
 #include "Deflate.h"
@@ -33,14 +48,146 @@ void Bitmap_UNSAFE_CopyBlock(int srcX, int srcY, int dstX, int dstY,
 	}
 }
 
+
+/*########################################################################################################################*
+*-------------------------------------------------------Bitmap pool-------------------------------------------------------*
+*#########################################################################################################################*/
+/* Pixel buffers are pooled in size classes from 8 KB up to 1 MB, with 4 classes */
+/*  between each power of two (so at most 25% of a buffer is wasted by rounding up) */
+#define BITMAPPOOL_MIN_SHIFT 13
+#define BITMAPPOOL_CLASSES   (7 * 4 + 1)
+#define BITMAPPOOL_ClassSize(i) ((cc_uint32)(4 + ((i) & 3)) << (BITMAPPOOL_MIN_SHIFT - 2 + ((i) >> 2)))
+/* Smaller buffers aren't worth pooling */
+#define BITMAPPOOL_MIN_SIZE  4096
+#define BITMAPPOOL_PER_CLASS 4
+#ifdef CC_BUILD_LOWMEM
+#define BITMAPPOOL_MAX_BYTES (1024 * 1024)
+#else
+#define BITMAPPOOL_MAX_BYTES (4096 * 1024)
+#endif
+
+static struct BitmapPoolClass {
+	void* buffers[BITMAPPOOL_PER_CLASS];
+	int count;
+	cc_bool used; /* Whether a buffer was taken from this class since the last trim */
+} pool_classes[BITMAPPOOL_CLASSES];
+static cc_uint32 pool_bytes;
+/* NULL when the pool isn't enabled (e.g. in the launcher) */
+static void* pool_mutex;
+
+/* Returns the size class which a buffer of the given size is allocated from, or -1 if not pooled */
+static int BitmapPool_Class(cc_uint32 size) {
+	int i;
+	if (size < BITMAPPOOL_MIN_SIZE) return -1;
+
+	for (i = 0; i < BITMAPPOOL_CLASSES; i++) 
+	{
+		if (BITMAPPOOL_ClassSize(i) >= size) return i;
+	}
+	return -1;
+}
+
+/* NOTE: Sizes are always rounded up to their class, even when the pool isn't enabled, */
+/*  so that any buffer passed to Bitmap_Free is known to be the full size of its class */
+static void* BitmapPool_TryAlloc(cc_uint32 size) {
+	struct BitmapPoolClass* pool;
+	void* buffer = NULL;
+	int i = BitmapPool_Class(size);
+
+	if (i == -1) return Mem_TryAlloc(size, 1);
+	pool = &pool_classes[i];
+
+	if (pool_mutex) {
+		Mutex_Lock(pool_mutex);
+		{
+			pool->used = true;
+			if (pool->count) {
+				buffer      = pool->buffers[--pool->count];
+				pool_bytes -= BITMAPPOOL_ClassSize(i);
+			}
+		}
+		Mutex_Unlock(pool_mutex);
+	}
+	return buffer ? buffer : Mem_TryAlloc(BITMAPPOOL_ClassSize(i), 1);
+}
+
+void Bitmap_Free(struct Bitmap* bmp) {
+	struct BitmapPoolClass* pool;
+	void* buffer = bmp->scan0;
+	cc_uint32 size;
+	int i;
+
+	bmp->scan0 = NULL;
+	if (!buffer) return;
+	/* Buffer may be larger than this (e.g. from Png_Decode), but never smaller */
+	i = BitmapPool_Class((cc_uint32)bmp->width * bmp->height * BITMAPCOLOR_SIZE);
+	if (!pool_mutex || i == -1) { Mem_Free(buffer); return; }
+
+	pool = &pool_classes[i];
+	size = BITMAPPOOL_ClassSize(i);
+
+	Mutex_Lock(pool_mutex);
+	{
+		if (pool->count < BITMAPPOOL_PER_CLASS && pool_bytes + size <= BITMAPPOOL_MAX_BYTES) {
+			pool->buffers[pool->count++] = buffer;
+			pool_bytes += size;
+			buffer      = NULL;
+		}
+	}
+	Mutex_Unlock(pool_mutex);
+	Mem_Free(buffer);
+}
+
+void BitmapPool_Init(void) {
+	if (!pool_mutex) pool_mutex = Mutex_Create("Bitmap pool");
+}
+
+/* Frees all the buffers in the given size class */
+static void BitmapPool_FreeClassBuffers(int i) {
+	struct BitmapPoolClass* pool = &pool_classes[i];
+	while (pool->count) 
+	{
+		Mem_Free(pool->buffers[--pool->count]);
+		pool_bytes -= BITMAPPOOL_ClassSize(i);
+	}
+}
+
+void BitmapPool_Trim(void) {
+	int i;
+	if (!pool_mutex) return;
+
+	Mutex_Lock(pool_mutex);
+	for (i = 0; i < BITMAPPOOL_CLASSES; i++) 
+	{
+		if (!pool_classes[i].used) BitmapPool_FreeClassBuffers(i);
+		pool_classes[i].used = false;
+	}
+	Mutex_Unlock(pool_mutex);
+}
+
+void BitmapPool_Free(void) {
+	int i;
+	if (!pool_mutex) return;
+
+	for (i = 0; i < BITMAPPOOL_CLASSES; i++) 
+	{
+		BitmapPool_FreeClassBuffers(i);
+		pool_classes[i].used = false;
+	}
+	Mutex_Free(pool_mutex);
+	pool_mutex = NULL;
+}
+
 void Bitmap_Allocate(struct Bitmap* bmp, int width, int height) {
 	bmp->width = width; bmp->height = height;
-	bmp->scan0 = (BitmapCol*)Mem_Alloc(width * height, BITMAPCOLOR_SIZE, "bitmap data");
+	bmp->scan0 = (BitmapCol*)BitmapPool_TryAlloc((cc_uint32)width * height * BITMAPCOLOR_SIZE);
+	/* Let Mem_Alloc report the failure */
+	if (!bmp->scan0) bmp->scan0 = (BitmapCol*)Mem_Alloc(width * height, BITMAPCOLOR_SIZE, "bitmap data");
 }
 
 void Bitmap_TryAllocate(struct Bitmap* bmp, int width, int height) {
 	bmp->width = width; bmp->height = height;
-	bmp->scan0 = (BitmapCol*)Mem_TryAlloc(width * height, BITMAPCOLOR_SIZE);
+	bmp->scan0 = (BitmapCol*)BitmapPool_TryAlloc((cc_uint32)width * height * BITMAPCOLOR_SIZE);
 }
 
 void Bitmap_Scale(struct Bitmap* dst, struct Bitmap* src, 
@@ -89,10 +236,200 @@ cc_bool Png_Detect(const cc_uint8* data, cc_uint32 len) {
 
 /* 9 Filtering */
 /* 13.9 Filtering */
+#if defined PNG_SSE2
+/* Each pixel is reconstructed at once, as the bytes of a pixel only depend on the previous pixel */
+/* NOTE: Only 3 or 4 bytes per pixel are supported */
+static CC_INLINE __m128i Png_LoadPixel(const cc_uint8* src, int bpp) {
+	cc_uint32 value = src[0] | (src[1] << 8) | (src[2] << 16);
+	if (bpp == 4) value |= (cc_uint32)src[3] << 24;
+	return _mm_cvtsi32_si128((int)value);
+}
+
+static CC_INLINE void Png_StorePixel(cc_uint8* dst, __m128i pixel, int bpp) {
+	cc_uint32 value = (cc_uint32)_mm_cvtsi128_si32(pixel);
+	dst[0] = (cc_uint8)value; dst[1] = (cc_uint8)(value >> 8); dst[2] = (cc_uint8)(value >> 16);
+	if (bpp == 4) dst[3] = (cc_uint8)(value >> 24);
+}
+
+static void Png_ReconstructUp_SIMD(cc_uint8* line, cc_uint8* prior, cc_uint32 lineLen) {
+	cc_uint32 i;
+	for (i = 0; i + 16 <= lineLen; i += 16) 
+	{
+		__m128i x = _mm_loadu_si128((const __m128i*)(line  + i));
+		__m128i b = _mm_loadu_si128((const __m128i*)(prior + i));
+		_mm_storeu_si128((__m128i*)(line + i), _mm_add_epi8(x, b));
+	}
+	for (; i < lineLen; i++) line[i] += prior[i];
+}
+
+static void Png_ReconstructSub_SIMD(int bpp, cc_uint8* line, cc_uint32 lineLen) {
+	__m128i a = _mm_setzero_si128(), x;
+	cc_uint32 i = 0;
+
+	/* With 4 bytes per pixel, a running sum of 4 pixels can be computed at once */
+	if (bpp == 4) {
+		for (; i + 16 <= lineLen; i += 16) 
+		{
+			x = _mm_loadu_si128((const __m128i*)(line + i));
+			x = _mm_add_epi8(x, _mm_slli_si128(x, 4));
+			x = _mm_add_epi8(x, _mm_slli_si128(x, 8));
+			x = _mm_add_epi8(x, a);
+			_mm_storeu_si128((__m128i*)(line + i), x);
+			a = _mm_shuffle_epi32(x, _MM_SHUFFLE(3, 3, 3, 3));
+		}
+	}
+
+	for (; i < lineLen; i += bpp) 
+	{
+		x = _mm_add_epi8(Png_LoadPixel(line + i, bpp), a);
+		Png_StorePixel(line + i, x, bpp);
+		a = x;
+	}
+}
+
+static void Png_ReconstructAverage_SIMD(int bpp, cc_uint8* line, cc_uint8* prior, cc_uint32 lineLen) {
+	__m128i ones = _mm_set1_epi8(1);
+	__m128i a = _mm_setzero_si128(), b, x, avg;
+	cc_uint32 i;
+
+	for (i = 0; i < lineLen; i += bpp) 
+	{
+		b   = Png_LoadPixel(prior + i, bpp);
+		/* _mm_avg_epu8 rounds up, whereas the average filter rounds down */
+		avg = _mm_avg_epu8(a, b);
+		avg = _mm_sub_epi8(avg, _mm_and_si128(_mm_xor_si128(a, b), ones));
+
+		x = _mm_add_epi8(Png_LoadPixel(line + i, bpp), avg);
+		Png_StorePixel(line + i, x, bpp);
+		a = x;
+	}
+}
+
+static CC_INLINE __m128i Png_Abs16(__m128i x) {
+	return _mm_max_epi16(x, _mm_sub_epi16(_mm_setzero_si128(), x));
+}
+
+static CC_INLINE __m128i Png_Select(__m128i mask, __m128i a, __m128i b) {
+	return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+}
+
+static void Png_ReconstructPaeth_SIMD(int bpp, cc_uint8* line, cc_uint8* prior, cc_uint32 lineLen) {
+	__m128i zero = _mm_setzero_si128();
+	__m128i a = zero, c = zero, b, x;
+	__m128i pa, pb, pc, smallest, nearest;
+	cc_uint32 i;
+
+	/* Components are widened to 16 bits, as the predictor calculations need signed values */
+	for (i = 0; i < lineLen; i += bpp) 
+	{
+		b  = _mm_unpacklo_epi8(Png_LoadPixel(prior + i, bpp), zero);
+		x  = _mm_unpacklo_epi8(Png_LoadPixel(line  + i, bpp), zero);
+
+		pa = _mm_sub_epi16(b, c);   /* p - a = b - c */
+		pb = _mm_sub_epi16(a, c);   /* p - b = a - c */
+		pc = _mm_add_epi16(pa, pb); /* p - c = a + b - 2c */
+		pa = Png_Abs16(pa); pb = Png_Abs16(pb); pc = Png_Abs16(pc);
+
+		/* Ties are broken in the order a, b, c */
+		smallest = _mm_min_epi16(pc, _mm_min_epi16(pa, pb));
+		nearest  = Png_Select(_mm_cmpeq_epi16(smallest, pb), b, c);
+		nearest  = Png_Select(_mm_cmpeq_epi16(smallest, pa), a, nearest);
+
+		x = _mm_and_si128(_mm_add_epi16(x, nearest), _mm_set1_epi16(0xFF));
+		Png_StorePixel(line + i, _mm_packus_epi16(x, x), bpp);
+		a = x; c = b;
+	}
+}
+#define PNG_RECONSTRUCT_SIMD
+#elif defined PNG_NEON
+/* Each pixel is reconstructed at once, as the bytes of a pixel only depend on the previous pixel */
+/* NOTE: Only 3 or 4 bytes per pixel are supported */
+static CC_INLINE uint8x8_t Png_LoadPixel(const cc_uint8* src, int bpp) {
+	cc_uint32 value = src[0] | (src[1] << 8) | (src[2] << 16);
+	if (bpp == 4) value |= (cc_uint32)src[3] << 24;
+	return vreinterpret_u8_u32(vdup_n_u32(value));
+}
+
+static CC_INLINE void Png_StorePixel(cc_uint8* dst, uint8x8_t pixel, int bpp) {
+	cc_uint32 value = vget_lane_u32(vreinterpret_u32_u8(pixel), 0);
+	dst[0] = (cc_uint8)value; dst[1] = (cc_uint8)(value >> 8); dst[2] = (cc_uint8)(value >> 16);
+	if (bpp == 4) dst[3] = (cc_uint8)(value >> 24);
+}
+
+static void Png_ReconstructUp_SIMD(cc_uint8* line, cc_uint8* prior, cc_uint32 lineLen) {
+	cc_uint32 i;
+	for (i = 0; i + 16 <= lineLen; i += 16) 
+	{
+		vst1q_u8(line + i, vaddq_u8(vld1q_u8(line + i), vld1q_u8(prior + i)));
+	}
+	for (; i < lineLen; i++) line[i] += prior[i];
+}
+
+static void Png_ReconstructSub_SIMD(int bpp, cc_uint8* line, cc_uint32 lineLen) {
+	uint8x8_t a = vdup_n_u8(0), x;
+	cc_uint32 i;
+
+	for (i = 0; i < lineLen; i += bpp) 
+	{
+		x = vadd_u8(Png_LoadPixel(line + i, bpp), a);
+		Png_StorePixel(line + i, x, bpp);
+		a = x;
+	}
+}
+
+static void Png_ReconstructAverage_SIMD(int bpp, cc_uint8* line, cc_uint8* prior, cc_uint32 lineLen) {
+	uint8x8_t a = vdup_n_u8(0), x;
+	cc_uint32 i;
+
+	for (i = 0; i < lineLen; i += bpp) 
+	{
+		/* vhadd_u8 rounds down, same as the average filter */
+		x = vadd_u8(Png_LoadPixel(line + i, bpp), vhadd_u8(a, Png_LoadPixel(prior + i, bpp)));
+		Png_StorePixel(line + i, x, bpp);
+		a = x;
+	}
+}
+
+static void Png_ReconstructPaeth_SIMD(int bpp, cc_uint8* line, cc_uint8* prior, cc_uint32 lineLen) {
+	int16x8_t a = vdupq_n_s16(0), c = vdupq_n_s16(0), b, x;
+	int16x8_t pa, pb, pc, smallest, nearest;
+	cc_uint32 i;
+
+	/* Components are widened to 16 bits, as the predictor calculations need signed values */
+	for (i = 0; i < lineLen; i += bpp) 
+	{
+		b  = vreinterpretq_s16_u16(vmovl_u8(Png_LoadPixel(prior + i, bpp)));
+		x  = vreinterpretq_s16_u16(vmovl_u8(Png_LoadPixel(line  + i, bpp)));
+
+		pa = vsubq_s16(b, c);   /* p - a = b - c */
+		pb = vsubq_s16(a, c);   /* p - b = a - c */
+		pc = vaddq_s16(pa, pb); /* p - c = a + b - 2c */
+		pa = vabsq_s16(pa); pb = vabsq_s16(pb); pc = vabsq_s16(pc);
+
+		/* Ties are broken in the order a, b, c */
+		smallest = vminq_s16(pc, vminq_s16(pa, pb));
+		nearest  = vbslq_s16(vceqq_s16(smallest, pb), b, c);
+		nearest  = vbslq_s16(vceqq_s16(smallest, pa), a, nearest);
+
+		x = vandq_s16(vaddq_s16(x, nearest), vdupq_n_s16(0xFF));
+		Png_StorePixel(line + i, vmovn_u16(vreinterpretq_u16_s16(x)), bpp);
+		a = x; c = b;
+	}
+}
+#define PNG_RECONSTRUCT_SIMD
+#endif
+
 static void Png_ReconstructFirst(cc_uint8 type, cc_uint8 bytesPerPixel, cc_uint8* line, cc_uint32 lineLen) {
 	/* First scanline is a special case, where all values in prior array are 0 */
 	cc_uint32 i, j;
 
+#ifdef PNG_RECONSTRUCT_SIMD
+	/* With no prior pixels, paeth always predicts the pixel to the left */
+	if ((type == PNG_FILTER_SUB || type == PNG_FILTER_PAETH) && (bytesPerPixel == 3 || bytesPerPixel == 4)) {
+		Png_ReconstructSub_SIMD(bytesPerPixel, line, lineLen); return;
+	}
+#endif
+
 	switch (type) {
 	case PNG_FILTER_SUB:
 		for (i = bytesPerPixel, j = 0; i < lineLen; i++, j++) {
@@ -117,6 +454,23 @@ static void Png_ReconstructFirst(cc_uint8 type, cc_uint8 bytesPerPixel, cc_uint8
 static void Png_Reconstruct(cc_uint8 type, cc_uint8 bytesPerPixel, cc_uint8* line, cc_uint8* prior, cc_uint32 lineLen) {
 	cc_uint32 i, j;
 
+#ifdef PNG_RECONSTRUCT_SIMD
+	if (type == PNG_FILTER_UP) {
+		Png_ReconstructUp_SIMD(line, prior, lineLen); return;
+	}
+
+	if (bytesPerPixel == 3 || bytesPerPixel == 4) {
+		switch (type) {
+		case PNG_FILTER_SUB:
+			Png_ReconstructSub_SIMD(bytesPerPixel, line, lineLen); return;
+		case PNG_FILTER_AVERAGE:
+			Png_ReconstructAverage_SIMD(bytesPerPixel, line, prior, lineLen); return;
+		case PNG_FILTER_PAETH:
+			Png_ReconstructPaeth_SIMD(bytesPerPixel, line, prior, lineLen); return;
+		}
+	}
+#endif
+
 	switch (type) {
 	case PNG_FILTER_SUB:
 		for (i = bytesPerPixel, j = 0; i < lineLen; i++, j++) {
@@ -204,6 +558,25 @@ static void Png_Expand_GRAYSCALE_8(int width, BitmapCol* palette, cc_uint8* src,
 }
 
 static void Png_Expand_RGB_8(int width, BitmapCol* palette, cc_uint8* src, BitmapCol* dst) {
+#if defined PNG_NEON && (defined PNG_EXPAND_BGRA || defined PNG_EXPAND_RGBA)
+	/* Processed in backwards blocks of 16 pixels, as the source data may overlap the destination */
+	/* Each block is completely loaded before being stored, so it doesn't overwrite its own source */
+	uint8x16x3_t rgb;
+	uint8x16x4_t px;
+
+	for (; width >= 16; width -= 16) 
+	{
+		rgb = vld3q_u8(src + (width - 16) * 3);
+	#ifdef PNG_EXPAND_BGRA
+		px.val[0] = rgb.val[2]; px.val[1] = rgb.val[1]; px.val[2] = rgb.val[0];
+	#else
+		px.val[0] = rgb.val[0]; px.val[1] = rgb.val[1]; px.val[2] = rgb.val[2];
+	#endif
+		px.val[3] = vdupq_n_u8(255);
+		vst4q_u8((cc_uint8*)(dst + width - 16), px);
+	}
+	if (!width) return;
+#endif
 	src += (width - 1) * 3;
 	dst += (width - 1);
 
@@ -254,6 +627,40 @@ static void Png_Expand_GRAYSCALE_A_8(int width, BitmapCol* palette, cc_uint8* sr
 
 static void Png_Expand_RGB_A_8(int width, BitmapCol* palette, cc_uint8* src, BitmapCol* dst) {
 	/* Processed in forward order */
+	/* (the destination is always before the source, so loading a block before storing it is safe) */
+#if defined PNG_SSE2 && defined PNG_EXPAND_BGRA
+	__m128i x, rb;
+	__m128i agMask = _mm_set1_epi32(0xFF00FF00);
+
+	for (; width >= 4; width -= 4, src += 16, dst += 4) 
+	{
+		x  = _mm_loadu_si128((const __m128i*)src);
+		/* Swap R and B components of each pixel */
+		rb = _mm_andnot_si128(agMask, x);
+		rb = _mm_or_si128(_mm_slli_epi32(rb, 16), _mm_srli_epi32(rb, 16));
+		x  = _mm_or_si128(_mm_and_si128(x, agMask), rb);
+		_mm_storeu_si128((__m128i*)dst, x);
+	}
+#elif defined PNG_SSE2 && defined PNG_EXPAND_RGBA
+	for (; width >= 4; width -= 4, src += 16, dst += 4) 
+	{
+		_mm_storeu_si128((__m128i*)dst, _mm_loadu_si128((const __m128i*)src));
+	}
+#elif defined PNG_NEON && (defined PNG_EXPAND_BGRA || defined PNG_EXPAND_RGBA)
+	uint8x16x4_t px;
+	#ifdef PNG_EXPAND_BGRA
+	uint8x16_t tmp;
+	#endif
+
+	for (; width >= 16; width -= 16, src += 64, dst += 16) 
+	{
+		px = vld4q_u8(src);
+	#ifdef PNG_EXPAND_BGRA
+		tmp = px.val[0]; px.val[0] = px.val[2]; px.val[2] = tmp;
+	#endif
+		vst4q_u8((cc_uint8*)dst, px);
+	}
+#endif
 
 	for (; width >= 4; width -= 4) {
 		PNG_Do_RGB_A__8(); PNG_Do_RGB_A__8();
@@ -329,6 +736,35 @@ static BitmapCol ExpandRGB(cc_uint8 bitsPerSample, int r, int g, int b) {
 	return BitmapCol_Make(r, g, b, 0);
 }
 
+static cc_result Png_DecodedRead(struct Stream* s, cc_uint8* data, cc_uint32 count, cc_uint32* modified) {
+	count = min(count, s->meta.decoded.left);
+	Mem_Copy(data, s->meta.decoded.cur, count);
+
+	s->meta.decoded.cur  += count;
+	s->meta.decoded.left -= count;
+	*modified = count;
+	return 0;
+}
+
+void Png_MakeDecodedStream(struct Stream* s, void* data, cc_uint32 len, struct PngDecoded* decoded) {
+	Stream_ReadonlyMemory(s, data, len);
+	s->Read = Png_DecodedRead;
+	s->meta.decoded.result = decoded;
+}
+
+/* Hands over the already decoded bitmap, if it hasn't been handed over before */
+static cc_bool Png_TakeDecoded(struct Bitmap* bmp, struct Stream* stream, cc_result* res) {
+	struct PngDecoded* decoded = stream->meta.decoded.result;
+	/* Only if nothing has been read yet, otherwise the caller expects the data to be decoded from there */
+	if (decoded->taken || stream->meta.decoded.cur != stream->meta.decoded.base) return false;
+
+	*bmp = decoded->bmp;
+	*res = decoded->res;
+	decoded->bmp.scan0 = NULL;
+	decoded->taken     = true;
+	return true;
+}
+
 #ifdef CC_BUILD_32X
 cc_result Png_Decode(struct Bitmap* bmp, struct Stream* stream) {
 	return ERR_NOT_SUPPORTED;
@@ -365,6 +801,7 @@ cc_result Png_Decode(struct Bitmap* bmp, struct Stream* stream) {
 
 	bmp->width = 0; bmp->height = 0;
 	bmp->scan0 = NULL;
+	if (stream->Read == Png_DecodedRead && Png_TakeDecoded(bmp, stream, &res)) return res;
 
 	res = Stream_Read(stream, tmp, PNG_SIG_SIZE);
 	if (res) return res;
@@ -409,7 +846,7 @@ cc_result Png_Decode(struct Bitmap* bmp, struct Stream* stream) {
 			scanlineSize  = ((samplesPerPixel[colorspace] * bitsPerSample * bmp->width) + 7) >> 3;
 			scanlineBytes = scanlineSize + 1; /* Add 1 byte for filter byte of each scanline */
 
-			data = (cc_uint8*)Mem_TryAlloc(bmp->height, max(scanlineBytes, bmp->width * 4));
+			data = (cc_uint8*)BitmapPool_TryAlloc(bmp->height * max(scanlineBytes, bmp->width * 4));
 			bmp->scan0 = (BitmapCol*)data;
 			if (!bmp->scan0) return ERR_OUT_OF_MEMORY;
 
@@ -115,6 +115,16 @@ void Bitmap_Allocate(struct Bitmap* bmp, int width, int height);
 /* Attemps to allocates a new bitmap of the given dimensions. */
 /* NOTE: You are responsible for freeing its memory! */
 void Bitmap_TryAllocate(struct Bitmap* bmp, int width, int height);
+/* Frees the pixels of a bitmap, keeping the buffer around to be reused by later allocations if possible. */
+/* NOTE: Bitmaps from Bitmap_Allocate, Bitmap_TryAllocate or Png_Decode can still just be freed with Mem_Free */
+void Bitmap_Free(struct Bitmap* bmp);
+
+/* Enables reusing pixel buffers freed by Bitmap_Free (until BitmapPool_Free is called) */
+void BitmapPool_Init(void);
+/* Frees pooled buffers of sizes that haven't been allocated since the last call to BitmapPool_Trim */
+void BitmapPool_Trim(void);
+/* Frees all pooled buffers, and disables pooling */
+void BitmapPool_Free(void);
 /* Scales a region of the source bitmap to occupy the entirety of the destination bitmap. */
 /* The pixels from the region are scaled upwards or downwards depending on destination width and height. */
 CC_API void Bitmap_Scale(struct Bitmap* dst, struct Bitmap* src, 
@@ -137,6 +147,13 @@ typedef BitmapCol* (*Png_RowGetter)(struct Bitmap* bmp, int row, void* ctx);
      https://github.com/nothings/stb/blob/master/stb_image.h
 */
 CC_API cc_result Png_Decode(struct Bitmap* bmp, struct Stream* stream);
+
+/* Result of decoding PNG data ahead of time (e.g. on another thread) */
+struct PngDecoded { struct Bitmap bmp; cc_result res; cc_bool taken; };
+/* Wraps PNG data that has already been decoded in a readonly memory stream */
+/* The first Png_Decode on the stream hands over the decoded bitmap instead of decoding the data again */
+/* NOTE: Whoever made decoded must free decoded->bmp.scan0 afterwards, if it was never handed over */
+void Png_MakeDecodedStream(struct Stream* s, void* data, cc_uint32 len, struct PngDecoded* decoded);
 /* Encodes a bitmap in PNG format. */
 /* getRow is optional. Can be used to modify how rows are encoded. (e.g. flip image) */
 /* if alpha is non-zero, RGBA channels are saved, otherwise only RGB channels are. */
@@ -346,23 +346,18 @@ static cc_bool Block_MightCull(BlockID block, BlockID other) {
 	return (bType == COLLIDE_SOLID && oType == COLLIDE_SOLID) || bType != COLLIDE_SOLID;
 }
 
-static void Block_CalcCulling(BlockID block, BlockID other) {
+/* Calculates which faces of the given block are hidden by the other block */
+static cc_uint8 Block_CalcCulling(BlockID block, BlockID other) {
 	Vec3 bMin, bMax, oMin, oMax;
 	cc_bool occludedX, occludedY, occludedZ, bothLiquid;
 	int f;
 
 	/* Fast path: Full opaque neighbouring blocks will always have all shared faces hidden */
-	if (Blocks.FullOpaque[block] && Blocks.FullOpaque[other]) {
-		Blocks.Hidden[(block * BLOCK_COUNT) + other] = 0x3F;
-		return;
-	}
+	if (Blocks.FullOpaque[block] && Blocks.FullOpaque[other]) return 0x3F;
 
 	/* Some blocks may not cull 'other' block, in which case just skip detailed check */
 	/* e.g. sprite blocks, default leaves, will not cull any other blocks */
-	if (!Block_MightCull(block, other)) {	
-		Blocks.Hidden[(block * BLOCK_COUNT) + other] = 0;
-		return;
-	}
+	if (!Block_MightCull(block, other)) return 0;
 
 	bMin = Blocks.MinBB[block]; bMax = Blocks.MaxBB[block];
 	oMin = Blocks.MinBB[other]; oMax = Blocks.MaxBB[other];
@@ -386,31 +381,67 @@ static void Block_CalcCulling(BlockID block, BlockID other) {
 	f |= occludedZ && oMin.z == 0.0f && bMax.z == 1.0f ? FACE_BIT_ZMAX : 0;
 	f |= occludedY && (bothLiquid || (oMax.y == 1.0f && bMin.y == 0.0f)) ? FACE_BIT_YMIN : 0;
 	f |= occludedY && (bothLiquid || (oMin.y == 0.0f && bMax.y == 1.0f)) ? FACE_BIT_YMAX : 0;
-	Blocks.Hidden[(block * BLOCK_COUNT) + other] = f;
+	return f;
+}
+
+/* Whether a block culls itself differently to how it culls other blocks with the same properties */
+/*  (e.g. glass hides faces of glass next to it, but not of other transparent blocks) */
+static cc_bool Block_UniqueCulling(BlockID block) {
+	cc_uint8 draw = Blocks.Draw[block];
+	/* Water and lava are special cased in Block_MightCull */
+	if (block >= BLOCK_WATER && block <= BLOCK_STILL_LAVA) return true;
+
+	return draw == DRAW_TRANSPARENT || draw == DRAW_GAS || (draw == DRAW_OPAQUE && Blocks.IsLiquid[block]);
+}
+
+/* Whether all the properties Block_CalcCulling depends on are the same for both blocks */
+static cc_bool Block_SameCulling(BlockID a, BlockID b) {
+	return Blocks.Draw[a] == Blocks.Draw[b] && Blocks.FullOpaque[a] == Blocks.FullOpaque[b]
+		&& Blocks.IsLiquid[a] == Blocks.IsLiquid[b] && Blocks.Collide[a] == Blocks.Collide[b]
+		&& Vec3_Equals(&Blocks.MinBB[a], &Blocks.MinBB[b]) && Vec3_Equals(&Blocks.MaxBB[a], &Blocks.MaxBB[b]);
+}
+
+/* Groups blocks that hide and are hidden by other blocks in the same way into classes, */
+/*  then recalculates which faces are hidden between every pair of classes */
+/* Since there are usually only a few dozen classes, the table then easily fits in cache during meshing */
+static void Block_UpdateCullClasses(void) {
+	static BlockID classBlocks[BLOCK_COUNT];
+	int block, i, j, count = 0;
+
+	for (block = BLOCK_AIR; block < BLOCK_COUNT; block++) {
+		i = count;
+		if (!Block_UniqueCulling((BlockID)block)) {
+			for (i = 0; i < count; i++) {
+				if (!Block_UniqueCulling(classBlocks[i]) && Block_SameCulling(classBlocks[i], (BlockID)block)) break;
+			}
+		}
+
+		if (i == count) classBlocks[count++] = (BlockID)block;
+		Blocks.CullClass[block] = (cc_uint16)i;
+	}
+
+	for (i = 0; i < count; i++) {
+		for (j = 0; j < count; j++) {
+			Blocks.Hidden[i * count + j] = Block_CalcCulling(classBlocks[i], classBlocks[j]);
+		}
+	}
+	Blocks.CullClassesCount = count;
 }
 
 /* Updates culling data of all blocks */
 static void Block_UpdateAllCulling(void) {
-	int block, neighbour;
-
+	int block;
 	for (block = BLOCK_AIR; block < BLOCK_COUNT; block++) {
 		Block_CalcStretch((BlockID)block);
-		for (neighbour = BLOCK_AIR; neighbour < BLOCK_COUNT; neighbour++) {
-			Block_CalcCulling((BlockID)block, (BlockID)neighbour);
-		}
 	}
+	Block_UpdateCullClasses();
 }
 
 /* Updates culling data just for this block */
 /* (e.g. whether block can be stretched, visibility with other blocks) */
 static void Block_UpdateCulling(BlockID block) {
-	int neighbour;
 	Block_CalcStretch(block);
-	
-	for (neighbour = BLOCK_AIR; neighbour < BLOCK_COUNT; neighbour++) {
-		Block_CalcCulling(block, (BlockID)neighbour);
-		Block_CalcCulling((BlockID)neighbour, block);
-	}
+	Block_UpdateCullClasses();
 }
 
 
@@ -434,6 +465,53 @@ static void Block_SetCustomDefined(BlockID block, cc_bool defined) {
 	}
 }
 
+static cc_bool defineBatching;
+/* Blocks defined or undefined during the current batch, and those whose sprite bounding box may need recalculating */
+static cc_uint32 pendingCulling[BLOCK_COUNT >> 5], pendingSpriteBB[BLOCK_COUNT >> 5];
+static int pendingCount;
+#define Block_BitGet(bits, block) (bits[(block) >> 5] & (1u << ((block) & 0x1F)))
+#define Block_BitSet(bits, block)  bits[(block) >> 5] |= (1u << ((block) & 0x1F))
+
+void Block_BeginDefineBatch(void) { defineBatching = true; }
+
+void Block_EndDefineBatch(void) {
+	int block, i;
+	defineBatching = false;
+	if (!pendingCount) return;
+
+	for (block = BLOCK_AIR; block < BLOCK_COUNT; block++) {
+		if (Block_BitGet(pendingSpriteBB, block) && Blocks.Draw[block] == DRAW_SPRITE) Block_RecalculateBB((BlockID)block);
+	}
+
+	for (block = BLOCK_AIR; block < BLOCK_COUNT; block++) {
+		if (Block_BitGet(pendingCulling, block)) Block_CalcStretch((BlockID)block);
+	}
+	/* Culling classes only need to be recalculated once for all the changed blocks */
+	Block_UpdateCullClasses();
+
+	for (i = 0; i < Array_Elems(pendingCulling); i++) {
+		pendingCulling[i]  = 0;
+		pendingSpriteBB[i] = 0;
+	}
+	pendingCount = 0;
+	Event_RaiseVoid(&BlockEvents.BlockDefChanged);
+}
+
+/* Updates culling and sprite bounding box, then raises event after the given block was defined or undefined */
+static void Block_FinishDefine(BlockID block, cc_bool checkSprite) {
+	if (defineBatching) {
+		if (!Block_BitGet(pendingCulling, block)) pendingCount++;
+		Block_BitSet(pendingCulling, block);
+		if (checkSprite) Block_BitSet(pendingSpriteBB, block);
+		return;
+	}
+
+	/* Update sprite BoundingBox if necessary */
+	if (checkSprite && Blocks.Draw[block] == DRAW_SPRITE) Block_RecalculateBB(block);
+	Block_UpdateCulling(block);
+	Event_RaiseVoid(&BlockEvents.BlockDefChanged);
+}
+
 void Block_DefineCustom(BlockID block, cc_bool checkSprite) {
 	PackedCol black  = PackedCol_Make(0, 0, 0, 255);
 	cc_string name   = Block_UNSAFE_GetName(block);
@@ -444,30 +522,21 @@ void Block_DefineCustom(BlockID block, cc_bool checkSprite) {
 	Block_SetCollide(block,  collide);
 	Block_SetDrawType(block, Blocks.Draw[block]);
 	Block_CalcRenderBounds(block);
-	Block_UpdateCulling(block);
 	Block_CalcLightOffset(block);
 
 	Inventory_AddDefault(block);
 	Block_SetCustomDefined(block, true);
-	Event_RaiseVoid(&BlockEvents.BlockDefChanged);
-
-	if (!checkSprite) return; /* TODO eliminate this */
-	/* Update sprite BoundingBox if necessary */
-	if (Blocks.Draw[block] == DRAW_SPRITE) Block_RecalculateBB(block);
+	Block_FinishDefine(block, checkSprite); /* TODO eliminate checkSprite */
 }
 
 void Block_UndefineCustom(BlockID block) {
 	Block_ResetProps(block);
-	Block_UpdateCulling(block);
 
 	Inventory_Remove(block);
 	if (block <= BLOCK_MAX_CPE) { Inventory_AddDefault(block); }
 
 	Block_SetCustomDefined(block, false);
-	Event_RaiseVoid(&BlockEvents.BlockDefChanged);
-
-	/* Update sprite BoundingBox if necessary */
-	if (Blocks.Draw[block] == DRAW_SPRITE) Block_RecalculateBB(block);
+	Block_FinishDefine(block, true);
 }
 
 void Block_ResetProps(BlockID block) {
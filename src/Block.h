@@ -98,8 +98,13 @@ CC_VAR extern struct _BlockLists {
 	/* Whether this block is allowed to be deleted. */
 	cc_bool CanDelete[BLOCK_COUNT];
 
-	/* Bit flags of faces hidden of two neighbouring blocks. */
+	/* Bit flags of faces hidden of two neighbouring blocks, indexed by the culling classes of the blocks. */
+	/* NOTE: Only the first CullClassesCount x CullClassesCount entries are used, see Block_IsFaceHidden */
 	cc_uint8 Hidden[BLOCK_COUNT * BLOCK_COUNT];
+	/* Culling class of this block. Blocks in the same class hide and are hidden by other blocks the same way. */
+	cc_uint16 CullClass[BLOCK_COUNT];
+	/* Number of culling classes blocks are currently grouped into. */
+	int CullClassesCount;
 	/* Bit flags of which faces of this block can stretch with greedy meshing. */
 	cc_uint8 CanStretch[BLOCK_COUNT];
 	/* Gravity of particles spawned when this block is broken */
@@ -123,6 +128,12 @@ cc_bool Block_IsCustomDefined(BlockID block);
 void Block_DefineCustom(BlockID block, cc_bool checkSprite);
 /* Resets the given block to default */
 void Block_UndefineCustom(BlockID block);
+/* Starts deferring the expensive parts of Block_DefineCustom and Block_UndefineCustom until Block_EndDefineBatch */
+/*  (e.g. when a server sends many block definitions at once) */
+/* NOTE: Culling state may be out of date until the batch is ended */
+void Block_BeginDefineBatch(void);
+/* Ends a batch started by Block_BeginDefineBatch, updating culling and raising BlockDefChanged just once */
+void Block_EndDefineBatch(void);
 /* Resets all the properties of the given block to default */
 void Block_ResetProps(BlockID block);
 
@@ -144,7 +155,7 @@ void Block_SetSide(TextureLoc texLoc, BlockID blockId);
 #define Block_Tex(block, face) Blocks.Textures[(block) * FACE_COUNT + (face)]
 
 /* Whether the given face of this block is occluded/hidden */
-#define Block_IsFaceHidden(block, other, face) (Blocks.Hidden[((block) * BLOCK_COUNT) + (other)] & (1 << (face)))
+#define Block_IsFaceHidden(block, other, face) (Blocks.Hidden[Blocks.CullClass[block] * Blocks.CullClassesCount + Blocks.CullClass[other]] & (1 << (face)))
 
 /* Whether blocks can be automatically rotated */
 extern cc_bool AutoRotate_Enabled;
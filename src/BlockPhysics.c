@@ -13,101 +13,268 @@
 #include "Logger.h"
 #include "Vectors.h"
 #include "Chat.h"
+#include "Queue.h"
 
-/* Data for a resizable queue, used for liquid physic tick entries. */
-struct TickQueue {
-	cc_uint32* entries; /* Buffer holding the items in the tick queue */
-	int capacity; /* Max number of elements in the buffer */
-	int mask;     /* capacity - 1, as capacity is always a power of two */
-	int count;    /* Number of used elements */
-	int head;     /* Head index into the buffer */
-	int tail;     /* Tail index into the buffer */
-};
+/* Liquid physic tick entries are the packed block index, plus the delay in the upper bits */
+static void TickQueue_Enqueue(struct Queue* queue, cc_uint32 item) {
+	Queue_Enqueue(queue, &item);
+}
+
+
+#ifdef CC_BUILD_PALETTEWORLD
+#define Physics_RawBlock(index) ((BlockRaw)World_GetRawBlock(index))
+#else
+#define Physics_RawBlock(index) World.Blocks[index]
+#endif
+
+struct Physics_ Physics;
+static RNGState physics_rnd;
+static int physics_tickCount;
+static int physics_maxWaterX, physics_maxWaterY, physics_maxWaterZ;
+static struct Queue lavaQ, waterQ;
+
+#define PHYSICS_DELAY_MASK 0xF8000000UL
+#define PHYSICS_POS_MASK   0x07FFFFFFUL
+#define PHYSICS_DELAY_SHIFT 27
+#define PHYSICS_ONE_DELAY   (1U << PHYSICS_DELAY_SHIFT)
+#define PHYSICS_LAVA_DELAY (30U << PHYSICS_DELAY_SHIFT)
+#define PHYSICS_WATER_DELAY (5U << PHYSICS_DELAY_SHIFT)
 
-static void TickQueue_Init(struct TickQueue* queue) {
-	queue->entries  = NULL;
-	queue->capacity = 0;
-	queue->mask  = 0;
-	queue->count = 0;
-	queue->head  = 0;
-	queue->tail  = 0;
+/* Only one entry per block is kept in a tick queue (e.g. water that spreads into */
+/*  a block is queued again by Physics_PlaceWater when the block is changed to water) */
+static cc_uint64 TickQueue_Key(const void* item) {
+	return *(const cc_uint32*)item & PHYSICS_POS_MASK;
+}
+
+
+/*########################################################################################################################*
+*------------------------------------------------------Physics thread-----------------------------------------------------*
+*#########################################################################################################################*/
+#ifdef CC_BUILD_PHYSICSTHREAD
+/* Singleplayer physics ticks run on a separate thread, which owns the tick queues and random tick counts */
+/* The physics thread never reads or changes the world itself. It instead works on its own copy of the */
+/*  world's blocks, which the main thread keeps up to date by passing on every block change as an input */
+/* Block changes made by the physics thread are also recorded, and then applied to the world by the */
+/*  main thread in between ticks */
+struct PhysicsChange { int index; BlockRaw old, block; };
+enum PHYSICS_INPUT { INPUT_CHANGED, INPUT_UPDATED, INPUT_LIT };
+/* Sent from the main thread to the physics thread. For INPUT_LIT, 'now' is whether the block is lit */
+struct PhysicsInput { int type, x, y, z; BlockID old, now; };
+/* Maximum number of ticks queued up while the physics thread is busy, before the main thread waits for it */
+#define PHYSICS_MAX_QUEUED_TICKS 20
+
+/* Physics thread's copy of the world's blocks, which also includes the changes it has made */
+static BlockRaw* physics_blocks;
+static cc_bool physics_blocksFailed;
+static struct PhysicsChange* changes_list; /* Blocks changed since last applied, in order of first change */
+static int changes_count, changes_capacity;
+static int* changes_table; /* Open addressing hash table of 1 + position in changes_list, 0 for empty slots */
+static int changes_tableSize;
+
+static CC_THREADLOCAL cc_bool physics_onThread;
+static void* physics_thread;
+static void* physics_mutex;
+static void* physics_tickSignal;
+static void* physics_doneSignal;
+static volatile cc_bool physics_quit;
+/* Number of ticks the physics thread still has to run, 0 when it is idle */
+static int physics_pendingTicks;
+/* Whether the physics thread currently owns the physics state */
+static cc_bool physics_useThread;
+/* Inputs queued by the main thread, and inputs being processed by the physics thread */
+static struct Queue inputsQ, takenQ;
+/* Blocks whose lighting must be checked by the main thread, before they can be randomly ticked */
+static struct Queue litQ;
+static int physics_litIndex = -1;
+static cc_bool physics_lit;
+/* Physics handlers when physics was initialised, see PhysicsThread_CanUse */
+static struct Physics_ physics_defaults;
+
+static int Changes_Find(int index) {
+	cc_uint32 hash = (cc_uint32)index * 2654435761U;
+	int mask = changes_tableSize - 1;
+	int i    = (int)((hash ^ (hash >> 15)) & mask);
+	int pos;
+
+	for (; (pos = changes_table[i]); i = (i + 1) & mask) {
+		if (changes_list[pos - 1].index == index) break;
+	}
+	return i;
 }
 
-static void TickQueue_Clear(struct TickQueue* queue) {
-	if (!queue->entries) return;
-	Mem_Free(queue->entries);
-	TickQueue_Init(queue);
+static void Changes_Resize(void) {
+	int i;
+	changes_tableSize = changes_tableSize ? changes_tableSize * 2 : 1024;
+	Mem_Free(changes_table);
+	changes_table = (int*)Mem_AllocCleared(changes_tableSize, sizeof(int), "physics changes table");
+
+	for (i = 0; i < changes_count; i++) {
+		changes_table[Changes_Find(changes_list[i].index)] = i + 1;
+	}
 }
 
-static void TickQueue_Resize(struct TickQueue* queue) {
-	cc_uint32* entries;
-	int i, idx, capacity;
+/* NOTE: 'old' is the block before the physics thread first changed it, i.e. the block in the world */
+/*  as of the last input the physics thread processed. So if the world no longer contains that block */
+/*  when the change is applied, the main thread must have changed the block since then */
+static void Changes_Set(int index, BlockRaw block) {
+	struct PhysicsChange* change;
+	int slot;
+	/* Keep the table at most half full, so probe sequences stay short */
+	if ((changes_count + 1) * 2 > changes_tableSize) Changes_Resize();
 
-	if (queue->capacity >= (Int32_MaxValue / 4)) {
-		Chat_AddRaw("&cToo many physics entries, clearing");
-		TickQueue_Clear(queue);
+	slot = Changes_Find(index);
+	if (changes_table[slot]) {
+		changes_list[changes_table[slot] - 1].block = block; return;
 	}
 
-	capacity = queue->capacity * 2;
-	if (capacity < 32) capacity = 32;
-	entries = (cc_uint32*)Mem_Alloc(capacity, 4, "physics tick queue");
+	if (changes_count == changes_capacity) {
+		changes_capacity = changes_capacity ? changes_capacity * 2 : 512;
+		changes_list     = (struct PhysicsChange*)Mem_Realloc(changes_list, changes_capacity, 
+								sizeof(struct PhysicsChange), "physics changes");
+	}
+	change = &changes_list[changes_count++];
+	change->index = index;
+	change->old   = physics_blocks[index];
+	change->block = block;
+	changes_table[slot] = changes_count;
+}
 
-	/* Elements must be readjusted to avoid index wrapping issues */
-	/* https://stackoverflow.com/questions/55343683/resizing-of-the-circular-queue-using-dynamic-array */
-	for (i = 0; i < queue->count; i++) {
-		idx = (queue->head + i) & queue->mask;
-		entries[i] = queue->entries[idx];
+static void Changes_Clear(void) {
+	if (!changes_count) return;
+	Mem_Set(changes_table, 0, changes_tableSize * sizeof(int));
+	changes_count = 0;
+}
+
+#define Physics_GetBlock(index) (physics_onThread ? physics_blocks[index] : World.Blocks[index])
+
+static void Physics_SetBlock(int x, int y, int z, BlockID block) {
+	int index;
+	if (physics_onThread) {
+		index = World_Pack(x, y, z);
+		Changes_Set(index, (BlockRaw)block);
+		physics_blocks[index] = (BlockRaw)block;
+	} else {
+		Game_UpdateBlock(x, y, z, block);
 	}
-	Mem_Free(queue->entries);
+}
+
+/* Passes on a change made by the main thread, if the physics thread owns the physics state */
+static cc_bool PhysicsThread_Send(int type, int x, int y, int z, BlockID old, BlockID now) {
+	struct PhysicsInput input;
+	if (!physics_useThread) return false;
+
+	input.type = type;
+	input.x = x; input.y = y; input.z = z;
+	input.old = old; input.now = now;
 
-	queue->entries  = entries;
-	queue->capacity = capacity;
-	queue->mask     = capacity - 1; /* capacity is power of two */
-	queue->head = 0;
-	queue->tail = queue->count;
+	Mutex_Lock(physics_mutex);
+	Queue_Enqueue(&inputsQ, &input);
+	Mutex_Unlock(physics_mutex);
+	return true;
 }
 
-/* Appends an entry to the end of the queue, resizing if necessary. */
-static void TickQueue_Enqueue(struct TickQueue* queue, cc_uint32 item) {
-	if (queue->count == queue->capacity)
-		TickQueue_Resize(queue);
+static int PhysicsThread_PendingTicks(void) {
+	int pending;
+	Mutex_Lock(physics_mutex);
+	pending = physics_pendingTicks;
+	Mutex_Unlock(physics_mutex);
+	return pending;
+}
 
-	queue->entries[queue->tail] = item;
-	queue->tail = (queue->tail + 1) & queue->mask;
-	queue->count++;
+/* Blocks until the physics thread has finished all of its queued ticks */
+static void PhysicsThread_Wait(void) {
+	if (!physics_thread) return;
+
+	while (PhysicsThread_PendingTicks()) {
+		Waitable_Wait(physics_doneSignal);
+	}
 }
 
-/* Retrieves the entry from the front of the queue. */
-static cc_uint32 TickQueue_Dequeue(struct TickQueue* queue) {
-	cc_uint32 result = queue->entries[queue->head];
-	queue->head = (queue->head + 1) & queue->mask;
-	queue->count--;
-	return result;
+static void PhysicsThread_FreeBlocks(void) {
+	Mem_Free(physics_blocks);
+	physics_blocks       = NULL;
+	physics_blocksFailed = false;
+}
+
+/* Discards all changes and inputs not yet exchanged between the threads, */
+/*  and returns ownership of the physics state to the main thread */
+static void PhysicsThread_Discard(void) {
+	PhysicsThread_Wait();
+	Changes_Clear();
+	Queue_Clear(&litQ);
+	Queue_Clear(&inputsQ);
+	Queue_Clear(&takenQ);
+	PhysicsThread_FreeBlocks();
+	physics_useThread = false;
+}
+#else
+#define Physics_GetBlock(index) Physics_RawBlock(index)
+#define Physics_SetBlock(x, y, z, block) Game_UpdateBlock(x, y, z, block)
+#endif
+
+/* Lighting can only be checked on the main thread, so the physics thread instead asks the main thread */
+/*  to check the block's lighting, and then randomly ticks the block again once it has the result */
+static cc_bool Physics_CheckLit(int index, int x, int y, int z, cc_bool* lit) {
+#ifdef CC_BUILD_PHYSICSTHREAD
+	if (physics_onThread) {
+		if (index == physics_litIndex) { *lit = physics_lit; return true; }
+
+		Queue_Enqueue(&litQ, &index);
+		return false;
+	}
+#endif
+	*lit = Lighting.IsLit(x, y, z);
+	return true;
 }
 
+/* Maximum time spent processing each liquid tick queue per tick, so large floods don't stall the game */
+/* Entries not processed in time stay at the front of the queue until the next tick */
+#define PHYSICS_LIQUID_BUDGET 3000 /* microseconds */
+/* Liquids can be given much more time on the physics thread, since that doesn't stall rendering */
+#define PHYSICS_THREAD_LIQUID_BUDGET 15000
+/* Number of entries processed between checking the elapsed time */
+#define PHYSICS_BUDGET_CHECK  64
 
-struct Physics_ Physics;
-static RNGState physics_rnd;
-static int physics_tickCount;
-static int physics_maxWaterX, physics_maxWaterY, physics_maxWaterZ;
-static struct TickQueue lavaQ, waterQ;
+static cc_bool Physics_OverBudget(int processed, cc_uint64 beg) {
+	int budget = PHYSICS_LIQUID_BUDGET;
+	if (processed % PHYSICS_BUDGET_CHECK) return false;
+#ifdef CC_BUILD_PHYSICSTHREAD
+	if (physics_onThread) budget = PHYSICS_THREAD_LIQUID_BUDGET;
+#endif
+	return Stopwatch_ElapsedMicroseconds(beg, Stopwatch_Measure()) >= budget;
+}
 
-#define PHYSICS_DELAY_MASK 0xF8000000UL
-#define PHYSICS_POS_MASK   0x07FFFFFFUL
-#define PHYSICS_DELAY_SHIFT 27
-#define PHYSICS_ONE_DELAY   (1U << PHYSICS_DELAY_SHIFT)
-#define PHYSICS_LAVA_DELAY (30U << PHYSICS_DELAY_SHIFT)
-#define PHYSICS_WATER_DELAY (5U << PHYSICS_DELAY_SHIFT)
+/* Number of blocks with random tick handlers in each chunk, or RANDOMTICK_UNKNOWN if not counted yet */
+/* NOTE: Counts assume Physics.OnRandomTick doesn't change while a map is loaded */
+static cc_uint16* physics_tickCounts;
+static cc_bool physics_countsFailed;
+#define RANDOMTICK_UNKNOWN 0xFFFF
+/* Maximum number of chunks counted each tick, to avoid stalling after a map is loaded */
+#define RANDOMTICK_MAX_COUNTS 32
+
+static void RandomTicks_Free(void) {
+	Mem_Free(physics_tickCounts);
+	physics_tickCounts   = NULL;
+	physics_countsFailed = false;
+}
 
 static void Physics_OnNewMapLoaded(void* obj) {
-	TickQueue_Clear(&lavaQ);
-	TickQueue_Clear(&waterQ);
+#ifdef CC_BUILD_PHYSICSTHREAD
+	PhysicsThread_Discard();
+#endif
+	Queue_Clear(&lavaQ);
+	Queue_Clear(&waterQ);
+	RandomTicks_Free();
 
 	physics_maxWaterX = World.MaxX - 2;
 	physics_maxWaterY = World.MaxY - 2;
 	physics_maxWaterZ = World.MaxZ - 2;
 
+#ifdef CC_BUILD_PALETTEWORLD
+	Tree_Blocks = NULL;
+#else
 	Tree_Blocks = World.Blocks;
+#endif
 	Random_SeedFromCurrentTime(&physics_rnd);
 	Tree_Rnd = &physics_rnd;
 }
@@ -118,7 +285,7 @@ void Physics_SetEnabled(cc_bool enabled) {
 }
 
 static void Physics_Activate(int index) {
-	BlockID block = World.Blocks[index];
+	BlockID block = Physics_GetBlock(index);
 	PhysicsHandler activate = Physics.OnActivate[block];
 	if (activate) activate(index, block);
 }
@@ -140,16 +307,9 @@ static cc_bool Physics_IsEdgeWater(int x, int y, int z) {
 }
 
 
-void Physics_OnBlockChanged(int x, int y, int z, BlockID old, BlockID now) {
+static void Physics_HandleChange(int x, int y, int z, BlockID old, BlockID now) {
 	PhysicsHandler handler;
-	int index;
-	if (!Physics.Enabled) return;
-
-	if (now == BLOCK_AIR && Physics_IsEdgeWater(x, y, z)) {
-		now = BLOCK_STILL_WATER;
-		Game_UpdateBlock(x, y, z, BLOCK_STILL_WATER);
-	}
-	index = World_Pack(x, y, z);
+	int index = World_Pack(x, y, z);
 
 	/* User can place/delete blocks over ID 256 */
 	if (now == BLOCK_AIR) {
@@ -162,11 +322,76 @@ void Physics_OnBlockChanged(int x, int y, int z, BlockID old, BlockID now) {
 	Physics_ActivateNeighbours(x, y, z, index);
 }
 
+void Physics_OnBlockChanged(int x, int y, int z, BlockID old, BlockID now) {
+	if (!Physics.Enabled) return;
+
+	if (now == BLOCK_AIR && Physics_IsEdgeWater(x, y, z)) {
+		now = BLOCK_STILL_WATER;
+		Game_UpdateBlock(x, y, z, BLOCK_STILL_WATER);
+	}
+#ifdef CC_BUILD_PHYSICSTHREAD
+	if (PhysicsThread_Send(INPUT_CHANGED, x, y, z, old, now)) return;
+#endif
+	Physics_HandleChange(x, y, z, old, now);
+}
+
+static int RandomTicks_Delta(BlockID old, BlockID now) {
+	return (Physics.OnRandomTick[(BlockRaw)now] != NULL) - (Physics.OnRandomTick[(BlockRaw)old] != NULL);
+}
+
+static void RandomTicks_Update(int x, int y, int z, int delta) {
+	int index;
+	if (!physics_tickCounts) return;
+	index = World_ChunkPack(x >> CHUNK_SHIFT, y >> CHUNK_SHIFT, z >> CHUNK_SHIFT);
+
+	if (physics_tickCounts[index] == RANDOMTICK_UNKNOWN) return;
+	physics_tickCounts[index] = (cc_uint16)(physics_tickCounts[index] + delta);
+}
+
+void Physics_OnBlockUpdated(int x, int y, int z, BlockID old, BlockID now) {
+	int delta;
+#ifdef CC_BUILD_PHYSICSTHREAD
+	/* Every change is passed on, so the physics thread's copy of the world stays up to date */
+	if (PhysicsThread_Send(INPUT_UPDATED, x, y, z, old, now)) return;
+#endif
+	delta = RandomTicks_Delta(old, now);
+	if (delta) RandomTicks_Update(x, y, z, delta);
+}
+
+static int RandomTicks_Count(int x1, int y1, int z1, int x2, int y2, int z2) {
+	int x, y, z, i, count = 0;
+
+	for (y = y1; y <= y2; y++)
+		for (z = z1; z <= z2; z++)
+		{
+			i = World_Pack(x1, y, z);
+			for (x = x1; x <= x2; x++, i++) 
+			{
+				if (Physics.OnRandomTick[Physics_GetBlock(i)]) count++;
+			}
+		}
+	return count;
+}
+
+/* Randomly ticks a block within the given region */
+static void Physics_RandomTick(int x, int y, int z, int width, int height, int length) {
+	int i     = Random_Next(&physics_rnd, width * height * length);
+	int index = World_Pack(x + i % width, y + i / (width * length), z + (i / width) % length);
+
+	BlockID block = Physics_GetBlock(index);
+	PhysicsHandler tick = Physics.OnRandomTick[block];
+	if (tick) tick(index, block);
+}
+
 static void Physics_TickRandomBlocks(void) {
-	int lo, hi, index;
-	BlockID block;
-	PhysicsHandler tick;
 	int x, y, z, x2, y2, z2;
+	int index, count, counted = 0;
+
+	if (!physics_tickCounts && !physics_countsFailed) {
+		physics_tickCounts   = (cc_uint16*)Mem_TryAlloc(World.ChunksCount, 2);
+		physics_countsFailed = !physics_tickCounts;
+		if (physics_tickCounts) Mem_Set(physics_tickCounts, 0xFF, World.ChunksCount * 2);
+	}
 
 	for (y = 0; y < World.Height; y += CHUNK_SIZE) {
 		y2 = min(y + CHUNK_MAX, World.MaxY);
@@ -175,24 +400,23 @@ static void Physics_TickRandomBlocks(void) {
 			for (x = 0; x < World.Width; x += CHUNK_SIZE) {
 				x2 = min(x + CHUNK_MAX, World.MaxX);
 
-				/* Inlined 3 random ticks for this chunk */
-				lo = World_Pack( x,  y,  z);
-				hi = World_Pack(x2, y2, z2);
-				
-				index = Random_Range(&physics_rnd, lo, hi);
-				block = World.Blocks[index];
-				tick = Physics.OnRandomTick[block];
-				if (tick) tick(index, block);
-
-				index = Random_Range(&physics_rnd, lo, hi);
-				block = World.Blocks[index];
-				tick = Physics.OnRandomTick[block];
-				if (tick) tick(index, block);
-
-				index = Random_Range(&physics_rnd, lo, hi);
-				block = World.Blocks[index];
-				tick = Physics.OnRandomTick[block];
-				if (tick) tick(index, block);
+				/* Skip chunks without any blocks that do anything when randomly ticked */
+				/* Chunks that haven't been counted yet are still ticked as normal */
+				if (physics_tickCounts) {
+					index = World_ChunkPack(x >> CHUNK_SHIFT, y >> CHUNK_SHIFT, z >> CHUNK_SHIFT);
+					count = physics_tickCounts[index];
+
+					if (count == RANDOMTICK_UNKNOWN && counted < RANDOMTICK_MAX_COUNTS) {
+						count = RandomTicks_Count(x, y, z, x2, y2, z2);
+						physics_tickCounts[index] = count;
+						counted++;
+					}
+					if (!count) continue;
+				}
+
+				Physics_RandomTick(x, y, z, x2 - x + 1, y2 - y + 1, z2 - z + 1);
+				Physics_RandomTick(x, y, z, x2 - x + 1, y2 - y + 1, z2 - z + 1);
+				Physics_RandomTick(x, y, z, x2 - x + 1, y2 - y + 1, z2 - z + 1);
 			}
 		}
 	}
@@ -207,7 +431,7 @@ static void Physics_DoFalling(int index, BlockID block) {
 	/* Find lowest block can fall into */
 	while (index >= World.OneY) {
 		index -= World.OneY;
-		other  = World.Blocks[index];
+		other  = Physics_GetBlock(index);
 
 		if (other == BLOCK_AIR || (other >= BLOCK_WATER && other <= BLOCK_STILL_LAVA))
 			found = index;
@@ -217,15 +441,15 @@ static void Physics_DoFalling(int index, BlockID block) {
 
 	if (found == -1) return;
 	World_Unpack(found, x, y, z);
-	Game_UpdateBlock(x, y, z, block);
+	Physics_SetBlock(x, y, z, block);
 
 	World_Unpack(start, x, y, z);
-	Game_UpdateBlock(x, y, z, BLOCK_AIR);
+	Physics_SetBlock(x, y, z, BLOCK_AIR);
 	Physics_ActivateNeighbours(x, y, z, start);
 }
 
-static cc_bool Physics_CheckItem(struct TickQueue* queue, int* posIndex) {
-	cc_uint32 item = TickQueue_Dequeue(queue);
+static cc_bool Physics_CheckItem(struct Queue* queue, int* posIndex) {
+	cc_uint32 item = *(cc_uint32*)Queue_Dequeue(queue);
 	*posIndex     = (int)(item & PHYSICS_POS_MASK);
 
 	if (item >= PHYSICS_ONE_DELAY) {
@@ -247,75 +471,87 @@ static void Physics_HandleSapling(int index, BlockID block) {
 	World_Unpack(index, x, y, z);
 
 	below = BLOCK_AIR;
-	if (y > 0) below = World.Blocks[index - World.OneY];
+	if (y > 0) below = Physics_GetBlock(index - World.OneY);
 	if (below != BLOCK_GRASS) return;
 
 	height = 5 + Random_Next(&physics_rnd, 3);
-	Game_UpdateBlock(x, y, z, BLOCK_AIR);
+	Physics_SetBlock(x, y, z, BLOCK_AIR);
+#ifdef CC_BUILD_PHYSICSTHREAD
+	/* Trees must be checked against the physics thread's copy, which has the sapling removed above */
+	Tree_Blocks = physics_onThread ? physics_blocks : World.Blocks;
+#endif
 
 	if (TreeGen_CanGrow(x, y, z, height)) {	
 		count = TreeGen_Grow(x, y, z, height, coords, blocks);
 
 		for (i = 0; i < count; i++) {
-			Game_UpdateBlock(coords[i].x, coords[i].y, coords[i].z, blocks[i]);
+			Physics_SetBlock(coords[i].x, coords[i].y, coords[i].z, blocks[i]);
 		}
 	} else {
-		Game_UpdateBlock(x, y, z, BLOCK_SAPLING);
+		Physics_SetBlock(x, y, z, BLOCK_SAPLING);
 	}
 }
 
 static void Physics_HandleDirt(int index, BlockID block) {
+	cc_bool lit;
 	int x, y, z;
 	World_Unpack(index, x, y, z);
 
-	if (Lighting.IsLit(x, y, z)) {
-		Game_UpdateBlock(x, y, z, BLOCK_GRASS);
+	if (!Physics_CheckLit(index, x, y, z, &lit)) return;
+	if (lit) {
+		Physics_SetBlock(x, y, z, BLOCK_GRASS);
 	}
 }
 
 static void Physics_HandleGrass(int index, BlockID block) {
+	cc_bool lit;
 	int x, y, z;
 	World_Unpack(index, x, y, z);
 
-	if (!Lighting.IsLit(x, y, z)) {
-		Game_UpdateBlock(x, y, z, BLOCK_DIRT);
+	if (!Physics_CheckLit(index, x, y, z, &lit)) return;
+	if (!lit) {
+		Physics_SetBlock(x, y, z, BLOCK_DIRT);
 	}
 }
 
 static void Physics_HandleFlower(int index, BlockID block) {
 	BlockID below;
+	cc_bool lit;
 	int x, y, z;
 	World_Unpack(index, x, y, z);
 
-	if (!Lighting.IsLit(x, y, z)) {
-		Game_UpdateBlock(x, y, z, BLOCK_AIR);
+	if (!Physics_CheckLit(index, x, y, z, &lit)) return;
+	if (!lit) {
+		Physics_SetBlock(x, y, z, BLOCK_AIR);
 		Physics_ActivateNeighbours(x, y, z, index);
 		return;
 	}
 
 	below = BLOCK_DIRT;
-	if (y > 0) below = World.Blocks[index - World.OneY];
+	if (y > 0) below = Physics_GetBlock(index - World.OneY);
 	if (!(below == BLOCK_DIRT || below == BLOCK_GRASS)) {
-		Game_UpdateBlock(x, y, z, BLOCK_AIR);
+		Physics_SetBlock(x, y, z, BLOCK_AIR);
 		Physics_ActivateNeighbours(x, y, z, index);
 	}
 }
 
 static void Physics_HandleMushroom(int index, BlockID block) {
 	BlockID below;
+	cc_bool lit;
 	int x, y, z;
 	World_Unpack(index, x, y, z);
 
-	if (Lighting.IsLit(x, y, z)) {
-		Game_UpdateBlock(x, y, z, BLOCK_AIR);
+	if (!Physics_CheckLit(index, x, y, z, &lit)) return;
+	if (lit) {
+		Physics_SetBlock(x, y, z, BLOCK_AIR);
 		Physics_ActivateNeighbours(x, y, z, index);
 		return;
 	}
 
 	below = BLOCK_STONE;
-	if (y > 0) below = World.Blocks[index - World.OneY];
+	if (y > 0) below = Physics_GetBlock(index - World.OneY);
 	if (!(below == BLOCK_STONE || below == BLOCK_COBBLE)) {
-		Game_UpdateBlock(x, y, z, BLOCK_AIR);
+		Physics_SetBlock(x, y, z, BLOCK_AIR);
 		Physics_ActivateNeighbours(x, y, z, index);
 	}
 }
@@ -326,16 +562,16 @@ static void Physics_PlaceLava(int index, BlockID block) {
 }
 
 static void Physics_PropagateLava(int posIndex, int x, int y, int z) {
-	BlockID block = World.Blocks[posIndex];
+	BlockID block = Physics_GetBlock(posIndex);
 
 	if (block >= BLOCK_WATER && block <= BLOCK_STILL_LAVA) {
 		/* Lava spreading into water turns the water solid */
 		if (block == BLOCK_WATER || block == BLOCK_STILL_WATER) {
-			Game_UpdateBlock(x, y, z, BLOCK_STONE);
+			Physics_SetBlock(x, y, z, BLOCK_STONE);
 		}
 	} else if (Blocks.Collide[block] == COLLIDE_NONE) {
 		TickQueue_Enqueue(&lavaQ, PHYSICS_LAVA_DELAY | posIndex);
-		Game_UpdateBlock(x, y, z, BLOCK_LAVA);
+		Physics_SetBlock(x, y, z, BLOCK_LAVA);
 	}
 }
 
@@ -351,11 +587,14 @@ static void Physics_ActivateLava(int index, BlockID block) {
 }
 
 static void Physics_TickLava(void) {
+	cc_uint64 beg = Stopwatch_Measure();
 	int i, count = lavaQ.count;
 	for (i = 0; i < count; i++) {
 		int index;
+		if (i && Physics_OverBudget(i, beg)) return;
+
 		if (Physics_CheckItem(&lavaQ, &index)) {
-			BlockID block = World.Blocks[index];
+			BlockID block = Physics_GetBlock(index);
 			if (!(block == BLOCK_LAVA || block == BLOCK_STILL_LAVA)) continue;
 			Physics_ActivateLava(index, block);
 		}
@@ -368,27 +607,27 @@ static void Physics_PlaceWater(int index, BlockID block) {
 }
 
 static void Physics_PropagateWater(int posIndex, int x, int y, int z) {
-	BlockID block = World.Blocks[posIndex];
+	BlockID block = Physics_GetBlock(posIndex);
 	int xx, yy, zz;
 
 	if (block >= BLOCK_WATER && block <= BLOCK_STILL_LAVA) {
 		/* Water spreading into lava turns the lava solid */
 		if (block == BLOCK_LAVA || block == BLOCK_STILL_LAVA) {
-			Game_UpdateBlock(x, y, z, BLOCK_STONE);
+			Physics_SetBlock(x, y, z, BLOCK_STONE);
 		}
 	} else if (Blocks.Collide[block] == COLLIDE_NONE) {
 		/* Sponge check */		
 		for (yy = (y < 2 ? 0 : y - 2); yy <= (y > physics_maxWaterY ? World.MaxY : y + 2); yy++) {
 			for (zz = (z < 2 ? 0 : z - 2); zz <= (z > physics_maxWaterZ ? World.MaxZ : z + 2); zz++) {
 				for (xx = (x < 2 ? 0 : x - 2); xx <= (x > physics_maxWaterX ? World.MaxX : x + 2); xx++) {
-					block = World_GetBlock(xx, yy, zz);
+					block = Physics_GetBlock(World_Pack(xx, yy, zz));
 					if (block == BLOCK_SPONGE) return;
 				}
 			}
 		}
 
 		TickQueue_Enqueue(&waterQ, PHYSICS_WATER_DELAY | posIndex);
-		Game_UpdateBlock(x, y, z, BLOCK_WATER);
+		Physics_SetBlock(x, y, z, BLOCK_WATER);
 	}
 }
 
@@ -404,11 +643,14 @@ static void Physics_ActivateWater(int index, BlockID block) {
 }
 
 static void Physics_TickWater(void) {
+	cc_uint64 beg = Stopwatch_Measure();
 	int i, count = waterQ.count;
 	for (i = 0; i < count; i++) {
 		int index;
+		if (i && Physics_OverBudget(i, beg)) return;
+
 		if (Physics_CheckItem(&waterQ, &index)) {
-			BlockID block = World.Blocks[index];
+			BlockID block = Physics_GetBlock(index);
 			if (!(block == BLOCK_WATER || block == BLOCK_STILL_WATER)) continue;
 			Physics_ActivateWater(index, block);
 		}
@@ -425,9 +667,9 @@ static void Physics_PlaceSponge(int index, BlockID block) {
 			for (xx = x - 2; xx <= x + 2; xx++) {
 				if (!World_Contains(xx, yy, zz)) continue;
 
-				block = World_GetBlock(xx, yy, zz);
+				block = Physics_GetBlock(World_Pack(xx, yy, zz));
 				if (block == BLOCK_WATER || block == BLOCK_STILL_WATER) {
-					Game_UpdateBlock(xx, yy, zz, BLOCK_AIR);
+					Physics_SetBlock(xx, yy, zz, BLOCK_AIR);
 				}
 			}
 		}
@@ -445,7 +687,7 @@ static void Physics_DeleteSponge(int index, BlockID block) {
 					if (!World_Contains(xx, yy, zz)) continue;
 
 					index = World_Pack(xx, yy, zz);
-					block = World.Blocks[index];
+					block = Physics_GetBlock(index);
 					if (block == BLOCK_WATER || block == BLOCK_STILL_WATER) {
 						TickQueue_Enqueue(&waterQ, index | PHYSICS_ONE_DELAY);
 					}
@@ -461,9 +703,9 @@ static void Physics_HandleSlab(int index, BlockID block) {
 	World_Unpack(index, x, y, z);
 	if (index < World.OneY) return;
 
-	if (World.Blocks[index - World.OneY] != BLOCK_SLAB) return;
-	Game_UpdateBlock(x, y,     z, BLOCK_AIR);
-	Game_UpdateBlock(x, y - 1, z, BLOCK_DOUBLE_SLAB);
+	if (Physics_GetBlock(index - World.OneY) != BLOCK_SLAB) return;
+	Physics_SetBlock(x, y,     z, BLOCK_AIR);
+	Physics_SetBlock(x, y - 1, z, BLOCK_DOUBLE_SLAB);
 }
 
 static void Physics_HandleCobblestoneSlab(int index, BlockID block) {
@@ -471,9 +713,9 @@ static void Physics_HandleCobblestoneSlab(int index, BlockID block) {
 	World_Unpack(index, x, y, z);
 	if (index < World.OneY) return;
 
-	if (World.Blocks[index - World.OneY] != BLOCK_COBBLE_SLAB) return;
-	Game_UpdateBlock(x, y,     z, BLOCK_AIR);
-	Game_UpdateBlock(x, y - 1, z, BLOCK_COBBLE);
+	if (Physics_GetBlock(index - World.OneY) != BLOCK_COBBLE_SLAB) return;
+	Physics_SetBlock(x, y,     z, BLOCK_AIR);
+	Physics_SetBlock(x, y - 1, z, BLOCK_COBBLE);
 }
 
 
@@ -492,7 +734,7 @@ static void Physics_HandleTnt(int index, BlockID block) {
 	int dx, dy, dz, xx, yy, zz;
 
 	World_Unpack(index, x, y, z);
-	Game_UpdateBlock(x, y, z, BLOCK_AIR);
+	Physics_SetBlock(x, y, z, BLOCK_AIR);
 	Physics_ActivateNeighbours(x, y, z, index);
 	
 	for (dy = -TNT_POWER; dy <= TNT_POWER; dy++) {
@@ -504,10 +746,10 @@ static void Physics_HandleTnt(int index, BlockID block) {
 				if (!World_Contains(xx, yy, zz)) continue;
 				index = World_Pack(xx, yy, zz);
 
-				block = World.Blocks[index];
+				block = Physics_GetBlock(index);
 				if (BlocksTNT(block)) continue;
 
-				Game_UpdateBlock(xx, yy, zz, BLOCK_AIR);
+				Physics_SetBlock(xx, yy, zz, BLOCK_AIR);
 				Physics_ActivateNeighbours(xx, yy, zz, index);
 			}
 		}
@@ -517,8 +759,10 @@ static void Physics_HandleTnt(int index, BlockID block) {
 void Physics_Init(void) {
 	Event_Register_(&WorldEvents.MapLoaded,    NULL, Physics_OnNewMapLoaded);
 	Physics.Enabled = Options_GetBool(OPT_BLOCK_PHYSICS, true);
-	TickQueue_Init(&lavaQ);
-	TickQueue_Init(&waterQ);
+	Queue_Init(&lavaQ,  sizeof(cc_uint32));
+	Queue_Init(&waterQ, sizeof(cc_uint32));
+	Queue_SetDedupe(&lavaQ,  TickQueue_Key);
+	Queue_SetDedupe(&waterQ, TickQueue_Key);
 
 	Physics.OnPlace[BLOCK_SAND]        = Physics_DoFalling;
 	Physics.OnPlace[BLOCK_GRAVEL]      = Physics_DoFalling;
@@ -552,18 +796,19 @@ void Physics_Init(void) {
 	Physics.OnRandomTick[BLOCK_STILL_LAVA]  = Physics_ActivateLava;
 
 	Physics.OnPlace[BLOCK_SLAB]        = Physics_HandleSlab;
-	if (Game_ClassicMode) return;
-	Physics.OnPlace[BLOCK_COBBLE_SLAB] = Physics_HandleCobblestoneSlab;
-	Physics.OnPlace[BLOCK_TNT]         = Physics_HandleTnt;
-}
-
-void Physics_Free(void) {
-	Event_Unregister_(&WorldEvents.MapLoaded,    NULL, Physics_OnNewMapLoaded);
+	if (!Game_ClassicMode) {
+		Physics.OnPlace[BLOCK_COBBLE_SLAB] = Physics_HandleCobblestoneSlab;
+		Physics.OnPlace[BLOCK_TNT]         = Physics_HandleTnt;
+	}
+#ifdef CC_BUILD_PHYSICSTHREAD
+	Queue_Init(&inputsQ, sizeof(struct PhysicsInput));
+	Queue_Init(&takenQ,  sizeof(struct PhysicsInput));
+	Queue_Init(&litQ,    sizeof(int));
+	physics_defaults = Physics;
+#endif
 }
 
-void Physics_Tick(void) {
-	if (!Physics.Enabled || !World.Blocks) return;
-
+static void Physics_DoTick(void) {
 	/*if ((tickCount % 5) == 0) {*/
 	Physics_TickLava();
 	Physics_TickWater();
@@ -571,3 +816,200 @@ void Physics_Tick(void) {
 	physics_tickCount++;
 	Physics_TickRandomBlocks();
 }
+
+#ifdef CC_BUILD_PHYSICSTHREAD
+/* Physics handlers replaced by plugins may change the world directly, so must run on the main thread */
+static cc_bool PhysicsThread_CanUse(void) {
+	return
+		Mem_Equal(Physics.OnActivate,   physics_defaults.OnActivate,   sizeof(Physics.OnActivate))   &&
+		Mem_Equal(Physics.OnRandomTick, physics_defaults.OnRandomTick, sizeof(Physics.OnRandomTick)) &&
+		Mem_Equal(Physics.OnPlace,      physics_defaults.OnPlace,      sizeof(Physics.OnPlace))      &&
+		Mem_Equal(Physics.OnDelete,     physics_defaults.OnDelete,     sizeof(Physics.OnDelete));
+}
+
+static void PhysicsThread_ProcessInputs(struct Queue* inputs) {
+	struct PhysicsInput input;
+	PhysicsHandler handler;
+	BlockID block;
+	int index;
+
+	while (inputs->count) {
+		input = *(struct PhysicsInput*)Queue_Dequeue(inputs);
+
+		switch (input.type) {
+		case INPUT_CHANGED:
+			Physics_HandleChange(input.x, input.y, input.z, input.old, input.now);
+			break;
+		case INPUT_UPDATED:
+			if (physics_onThread) {
+				physics_blocks[World_Pack(input.x, input.y, input.z)] = (BlockRaw)input.now;
+			}
+			RandomTicks_Update(input.x, input.y, input.z, RandomTicks_Delta(input.old, input.now));
+			break;
+		case INPUT_LIT:
+			index   = World_Pack(input.x, input.y, input.z);
+			block   = Physics_GetBlock(index);
+			handler = Physics.OnRandomTick[block];
+			if (!handler) break;
+
+			physics_litIndex = index;
+			physics_lit      = (cc_bool)input.now;
+			handler(index, block);
+			physics_litIndex = -1;
+			break;
+		}
+	}
+}
+
+/* Applies the block changes made by the physics thread's last ticks to the world, */
+/*  and checks the lighting of the blocks that the physics thread asked about */
+static void PhysicsThread_ApplyChanges(void) {
+	struct PhysicsChange* change;
+	int i, index, x, y, z;
+	cc_bool lit;
+
+	Lighting_BeginBatch();
+	for (i = 0; i < changes_count; i++) {
+		change = &changes_list[i];
+		if (change->old == change->block) continue;
+		/* Player changed the block while the physics thread was ticking, so the player's change wins */
+		if (World.Blocks[change->index] != change->old) continue;
+
+		World_Unpack(change->index, x, y, z);
+		Game_UpdateBlock(x, y, z, change->block);
+	}
+	Lighting_EndBatch();
+	Changes_Clear();
+
+	while (litQ.count) {
+		index = *(int*)Queue_Dequeue(&litQ);
+		World_Unpack(index, x, y, z);
+
+		lit = Lighting.IsLit(x, y, z);
+		PhysicsThread_Send(INPUT_LIT, x, y, z, 0, lit);
+	}
+}
+
+static void PhysicsThread_Loop(void) {
+	struct Queue inputs;
+	int pending;
+
+	for (;;) {
+		Waitable_Wait(physics_tickSignal);
+		if (physics_quit) return;
+
+		/* Run ticks queued up while this thread was busy back to back, so physics keeps its fixed rate */
+		do {
+			/* Take the queued inputs, so the main thread can keep queueing inputs while they're being processed */
+			Mutex_Lock(physics_mutex);
+			inputs  = takenQ;
+			takenQ  = inputsQ;
+			inputsQ = inputs;
+			Mutex_Unlock(physics_mutex);
+
+			physics_onThread = true;
+			PhysicsThread_ProcessInputs(&takenQ);
+			Physics_DoTick();
+			physics_onThread = false;
+
+			Mutex_Lock(physics_mutex);
+			pending = --physics_pendingTicks;
+			Mutex_Unlock(physics_mutex);
+		} while (pending);
+
+		Waitable_Signal(physics_doneSignal);
+	}
+}
+
+static void PhysicsThread_Start(void) {
+	physics_mutex      = Mutex_Create("Physics inputs");
+	physics_tickSignal = Waitable_Create("Physics tick");
+	physics_doneSignal = Waitable_Create("Physics done");
+	physics_quit       = false;
+	Thread_Run(&physics_thread, PhysicsThread_Loop, 256 * 1024, "Block physics");
+}
+
+static void PhysicsThread_Stop(void) {
+	if (!physics_thread) return;
+	PhysicsThread_Discard();
+	physics_quit = true;
+
+	Waitable_Signal(physics_tickSignal);
+	Thread_Join(physics_thread);
+	physics_thread = NULL;
+
+	Waitable_Free(physics_tickSignal);
+	Waitable_Free(physics_doneSignal);
+	Mutex_Free(physics_mutex);
+}
+
+/* Moves the physics state back to the main thread, applying any changes and inputs not yet processed */
+static void PhysicsThread_Finish(void) {
+	if (!physics_useThread) return;
+	PhysicsThread_Wait();
+	PhysicsThread_ApplyChanges();
+
+	physics_useThread = false;
+	PhysicsThread_ProcessInputs(&inputsQ);
+	Mem_Free(physics_blocks);
+	physics_blocks = NULL;
+}
+
+/* Gives the physics thread its own copy of the world's blocks, returning false if out of memory */
+static cc_bool PhysicsThread_CopyBlocks(void) {
+	if (physics_blocksFailed) return false;
+
+	physics_blocks = (BlockRaw*)Mem_TryAlloc(World.Volume, 1);
+	if (!physics_blocks) { physics_blocksFailed = true; return false; }
+
+	Mem_Copy(physics_blocks, World.Blocks, World.Volume);
+	return true;
+}
+
+/* Returns false if the tick must instead be run on the main thread */
+static cc_bool PhysicsThread_Tick(void) {
+	cc_bool queued = false;
+	if (!PhysicsThread_CanUse()) { PhysicsThread_Finish(); return false; }
+	if (!physics_useThread && !PhysicsThread_CopyBlocks()) return false;
+	if (!physics_thread) PhysicsThread_Start();
+
+	/* Queue up the tick when the physics thread falls behind, rather than stalling the main thread */
+	Mutex_Lock(physics_mutex);
+	if (physics_pendingTicks && physics_pendingTicks < PHYSICS_MAX_QUEUED_TICKS) {
+		physics_pendingTicks++; queued = true;
+	}
+	Mutex_Unlock(physics_mutex);
+	if (queued) return true;
+
+	/* Physics thread is either idle, or too far behind and must be waited for to catch up */
+	PhysicsThread_Wait();
+	PhysicsThread_ApplyChanges();
+	physics_useThread = true;
+
+	Mutex_Lock(physics_mutex);
+	physics_pendingTicks = 1;
+	Mutex_Unlock(physics_mutex);
+	Waitable_Signal(physics_tickSignal);
+	return true;
+}
+
+void Physics_WaitForThread(void) { PhysicsThread_Wait(); }
+#else
+void Physics_WaitForThread(void) { }
+#endif
+
+void Physics_Free(void) {
+	Event_Unregister_(&WorldEvents.MapLoaded,    NULL, Physics_OnNewMapLoaded);
+#ifdef CC_BUILD_PHYSICSTHREAD
+	PhysicsThread_Stop();
+#endif
+	RandomTicks_Free();
+}
+
+void Physics_Tick(void) {
+	if (!Physics.Enabled || !World_HasBlocks()) return;
+#ifdef CC_BUILD_PHYSICSTHREAD
+	if (PhysicsThread_Tick()) return;
+#endif
+	Physics_DoTick();
+}
@@ -25,9 +25,14 @@ CC_VAR extern struct Physics_ {
 
 void Physics_SetEnabled(cc_bool enabled);
 void Physics_OnBlockChanged(int x, int y, int z, BlockID old, BlockID now);
+/* Called whenever any block in the world changes (including changes made by physics) */
+void Physics_OnBlockUpdated(int x, int y, int z, BlockID old, BlockID now);
 void Physics_Init(void);
 void Physics_Free(void);
 void Physics_Tick(void);
+/* Blocks until the background physics thread (if any) has finished all of its queued ticks */
+/* NOTE: Must be called before the world's blocks are freed or replaced */
+void Physics_WaitForThread(void);
 
 CC_END_HEADER
 #endif
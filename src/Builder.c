@@ -13,6 +13,13 @@
 #include "TexturePack.h"
 #include "Game.h"
 #include "Options.h"
+#include "Server.h"
+#include "String.h"
+#include "Utils.h"
+#include "Stream.h"
+#include "Logger.h"
+#include "Errors.h"
+#include "Event.h"
 
 int Builder_SidesLevel, Builder_EdgeLevel;
 /* Packs an index into the 16x16x16 count array. Coordinates range from 0 to 15. */
@@ -20,14 +27,17 @@ int Builder_SidesLevel, Builder_EdgeLevel;
 /* Packs an index into the 18x18x18 chunk array. Coordinates range from -1 to 16. */
 #define Builder_PackChunk(xx, yy, zz) (((yy) + 1) * EXTCHUNK_SIZE_2 + ((zz) + 1) * EXTCHUNK_SIZE + ((xx) + 1))
 
-static BlockID* Builder_Chunk;
-static cc_uint8* Builder_Counts;
-static int* Builder_BitFlags;
-static int Builder_X, Builder_Y, Builder_Z;
-static BlockID Builder_Block;
-static int Builder_ChunkIndex;
-static cc_bool Builder_FullBright;
-static int Builder_ChunkEndX, Builder_ChunkEndZ;
+/* NOTE: Per chunk build state is thread local, as chunks may be built on multiple threads at once */
+static CC_THREADLOCAL BlockID* Builder_Chunk;
+static CC_THREADLOCAL cc_uint8* Builder_Counts;
+static CC_THREADLOCAL int* Builder_BitFlags;
+static CC_THREADLOCAL int Builder_X, Builder_Y, Builder_Z;
+static CC_THREADLOCAL BlockID Builder_Block;
+static CC_THREADLOCAL int Builder_ChunkIndex;
+static CC_THREADLOCAL cc_bool Builder_FullBright;
+static CC_THREADLOCAL int Builder_ChunkEndX, Builder_ChunkEndZ;
+/* Whether the chunk being built contains any sprite or liquid blocks */
+static CC_THREADLOCAL cc_bool Builder_MixedChunk;
 static int Builder_Offsets[FACE_COUNT] = { -1,1, -EXTCHUNK_SIZE,EXTCHUNK_SIZE, -EXTCHUNK_SIZE_2,EXTCHUNK_SIZE_2 };
 
 static int (*Builder_StretchXLiquid)(int countIndex, int x, int y, int z, int chunkIndex, BlockID block);
@@ -36,6 +46,12 @@ static int (*Builder_StretchZ)(int countIndex, int x, int y, int z, int chunkInd
 static void (*Builder_RenderBlock)(int countsIndex, int x, int y, int z);
 static void (*Builder_PrePrepareChunk)(void);
 static void (*Builder_PostPrepareChunk)(void);
+static void (*Builder_MergeChunk)(int x1, int y1, int z1);
+
+/* Marks a face that was merged into the same face of the block in the row before it */
+#define FACE_MERGED 0xFF
+/* Whether any faces in the current chunk were merged across rows by Builder_MergeChunk */
+static CC_THREADLOCAL cc_bool Builder_MergedRows;
 
 /* Contains state for vertices for a portion of a chunk mesh (vertices that are in a 1D atlas) */
 struct Builder1DPart {
@@ -49,8 +65,12 @@ struct Builder1DPart {
 
 /* Part builder data, for both normal and translucent parts.
 The first ATLAS1D_MAX_ATLASES parts are for normal parts, remainder are for translucent parts. */
-static struct Builder1DPart Builder_Parts[ATLAS1D_MAX_ATLASES * 2];
-static struct VertexTextured* Builder_Vertices;
+static CC_THREADLOCAL struct Builder1DPart* Builder_Parts;
+static CC_THREADLOCAL struct VertexTextured* Builder_Vertices;
+#define BUILDER_PARTS_SIZE (ATLAS1D_MAX_ATLASES * 2 * sizeof(struct Builder1DPart))
+static struct Builder1DPart builder_parts[ATLAS1D_MAX_ATLASES * 2];
+/* All vertices go into the first part when chunks are drawn using a texture array */
+#define Builder_AtlasIndex(texLoc) (MapRenderer_TextureArray ? 0 : Atlas1D_Index(texLoc))
 
 static int Builder1DPart_VerticesCount(struct Builder1DPart* part) {
 	int i, count = part->sCount;
@@ -90,14 +110,14 @@ static int Builder_TotalVerticesCount(void) {
 *----------------------------------------------------Base mesh builder----------------------------------------------------*
 *#########################################################################################################################*/
 static void AddSpriteVertices(BlockID block) {
-	int i = Atlas1D_Index(Block_Tex(block, FACE_XMAX));
+	int i = Builder_AtlasIndex(Block_Tex(block, FACE_XMAX));
 	struct Builder1DPart* part = &Builder_Parts[i];
 	part->sCount += 4 * 4;
 }
 
 static void AddVertices(BlockID block, Face face) {
 	int baseOffset = (Blocks.Draw[block] == DRAW_TRANSLUCENT) * ATLAS1D_MAX_ATLASES;
-	int i = Atlas1D_Index(Block_Tex(block, face));
+	int i = Builder_AtlasIndex(Block_Tex(block, face));
 	struct Builder1DPart* part = &Builder_Parts[baseOffset + i];
 	part->faces.count[face] += 4;
 }
@@ -112,6 +132,8 @@ static void BuildPartVbs(struct ChunkPartInfo* info) {
 		if (count) {
 			info->vbs[i] = Gfx_CreateVb2(&Builder_Vertices[offset], VERTEX_FORMAT_TEXTURED, count);
 			offset += count;
+			MapRenderer_CurStats->vertices    += count;
+			MapRenderer_CurStats->uploadBytes += count * SIZEOF_VERTEX_TEXTURED;
 		} else {
 			info->vbs[i] = 0;
 		}
@@ -121,6 +143,8 @@ static void BuildPartVbs(struct ChunkPartInfo* info) {
 	offset = info->offset;
 	if (count) {
 		info->vbs[i] = Gfx_CreateVb2(&Builder_Vertices[offset], VERTEX_FORMAT_TEXTURED, count);
+		MapRenderer_CurStats->vertices    += count;
+		MapRenderer_CurStats->uploadBytes += count * SIZEOF_VERTEX_TEXTURED;
 	} else {
 		info->vbs[i] = 0;
 	}
@@ -146,102 +170,106 @@ static cc_bool SetPartInfo(struct Builder1DPart* part, int* offset, struct Chunk
 }
 
 
-static void PrepareChunk(int x1, int y1, int z1) {
+/* Calculates which faces of each block in the chunk are visible, and how far they can be stretched */
+/* NOTE: When mixed is false, the chunk must not contain any sprite or liquid blocks */
+#define PrepareChunkBody(mixed)\
+for (y = y1, yy = 0; y < yMax; y++, yy++) {\
+	for (z = z1, zz = 0; z < zMax; z++, zz++) {\
+		cIndex = Builder_PackChunk(0, yy, zz);\
+\
+		for (x = x1, xx = 0; x < xMax; x++, xx++, cIndex++) {\
+			b = Builder_Chunk[cIndex];\
+			if (Blocks.Draw[b] == DRAW_GAS) continue;\
+			index = Builder_PackCount(xx, yy, zz);\
+\
+			/* Sprites can't be stretched, nor can then be they hidden by other blocks. */\
+			/* Note sprites are drawn using DrawSprite and not with any of the DrawXFace. */\
+			if (mixed && Blocks.Draw[b] == DRAW_SPRITE) { AddSpriteVertices(b); continue; }\
+\
+			Builder_X = x; Builder_Y = y; Builder_Z = z;\
+			Builder_FullBright = Blocks.Brightness[b];\
+			tileIdx = Blocks.CullClass[b] * Blocks.CullClassesCount;\
+			/* All of these function calls are inlined as they can be called tens of millions to hundreds of millions of times. */\
+\
+			if (Builder_Counts[index] == 0 ||\
+				(x == 0 && (y < Builder_SidesLevel || (mixed && b >= BLOCK_WATER && b <= BLOCK_STILL_LAVA && y < Builder_EdgeLevel))) ||\
+				(x != 0 && (Blocks.Hidden[tileIdx + Blocks.CullClass[Builder_Chunk[cIndex - 1]]] & FACE_BIT_XMIN) != 0)) {\
+				Builder_Counts[index] = 0;\
+			} else {\
+				Builder_Counts[index] = Builder_StretchZ(index, x, y, z, cIndex, b, FACE_XMIN);\
+			}\
+\
+			index++;\
+			if (Builder_Counts[index] == 0 ||\
+				(x == World.MaxX && (y < Builder_SidesLevel || (mixed && b >= BLOCK_WATER && b <= BLOCK_STILL_LAVA && y < Builder_EdgeLevel))) ||\
+				(x != World.MaxX && (Blocks.Hidden[tileIdx + Blocks.CullClass[Builder_Chunk[cIndex + 1]]] & FACE_BIT_XMAX) != 0)) {\
+				Builder_Counts[index] = 0;\
+			} else {\
+				Builder_Counts[index] = Builder_StretchZ(index, x, y, z, cIndex, b, FACE_XMAX);\
+			}\
+\
+			index++;\
+			if (Builder_Counts[index] == 0 ||\
+				(z == 0 && (y < Builder_SidesLevel || (mixed && b >= BLOCK_WATER && b <= BLOCK_STILL_LAVA && y < Builder_EdgeLevel))) ||\
+				(z != 0 && (Blocks.Hidden[tileIdx + Blocks.CullClass[Builder_Chunk[cIndex - EXTCHUNK_SIZE]]] & FACE_BIT_ZMIN) != 0)) {\
+				Builder_Counts[index] = 0;\
+			} else {\
+				Builder_Counts[index] = Builder_StretchX(index, x, y, z, cIndex, b, FACE_ZMIN);\
+			}\
+\
+			index++;\
+			if (Builder_Counts[index] == 0 ||\
+				(z == World.MaxZ && (y < Builder_SidesLevel || (mixed && b >= BLOCK_WATER && b <= BLOCK_STILL_LAVA && y < Builder_EdgeLevel))) ||\
+				(z != World.MaxZ && (Blocks.Hidden[tileIdx + Blocks.CullClass[Builder_Chunk[cIndex + EXTCHUNK_SIZE]]] & FACE_BIT_ZMAX) != 0)) {\
+				Builder_Counts[index] = 0;\
+			} else {\
+				Builder_Counts[index] = Builder_StretchX(index, x, y, z, cIndex, b, FACE_ZMAX);\
+			}\
+\
+			index++;\
+			if (Builder_Counts[index] == 0 || y == 0 ||\
+				(Blocks.Hidden[tileIdx + Blocks.CullClass[Builder_Chunk[cIndex - EXTCHUNK_SIZE_2]]] & FACE_BIT_YMIN) != 0) {\
+				Builder_Counts[index] = 0;\
+			} else {\
+				Builder_Counts[index] = Builder_StretchX(index, x, y, z, cIndex, b, FACE_YMIN);\
+			}\
+\
+			index++;\
+			if (Builder_Counts[index] == 0 ||\
+				(Blocks.Hidden[tileIdx + Blocks.CullClass[Builder_Chunk[cIndex + EXTCHUNK_SIZE_2]]] & FACE_BIT_YMAX) != 0) {\
+				Builder_Counts[index] = 0;\
+			} else if (!mixed || b < BLOCK_WATER || b > BLOCK_STILL_LAVA) {\
+				Builder_Counts[index] = Builder_StretchX(index, x, y, z, cIndex, b, FACE_YMAX);\
+			} else {\
+				Builder_Counts[index] = Builder_StretchXLiquid(index, x, y, z, cIndex, b);\
+			}\
+		}\
+	}\
+}
+
+/* Whether the given block needs the extra checks of PrepareMixedChunk */
+#define Builder_IsMixedBlock(b) (Blocks.Draw[b] == DRAW_SPRITE || ((b) >= BLOCK_WATER && (b) <= BLOCK_STILL_LAVA))
+
+/* Specialised for chunks with only full and partial blocks, which most chunks are */
+/*  (e.g. near the surface, or underground), so checks for sprites and liquids are compiled out */
+static void PrepareSimpleChunk(int x1, int y1, int z1) {
 	int xMax = min(World.Width,  x1 + CHUNK_SIZE);
 	int yMax = min(World.Height, y1 + CHUNK_SIZE);
 	int zMax = min(World.Length, z1 + CHUNK_SIZE);
-
 	int cIndex, index, tileIdx;
 	BlockID b;
 	int x, y, z, xx, yy, zz;
+	PrepareChunkBody(false)
+}
 
-#ifdef OCCLUSION
-	int flags = ComputeOcclusion();
-#endif
-#ifdef DEBUG_OCCLUSION
-	FastColour col = new FastColour(60, 60, 60, 255);
-	if (flags & 1) col.R = 255; /* x */
-	if (flags & 4) col.G = 255; /* y */
-	if (flags & 2) col.B = 255; /* z */
-	map.Sunlight = map.Shadowlight = col;
-	map.SunlightXSide = map.ShadowlightXSide = col;
-	map.SunlightZSide = map.ShadowlightZSide = col;
-	map.SunlightYBottom = map.ShadowlightYBottom = col;
-#endif
-	
-	for (y = y1, yy = 0; y < yMax; y++, yy++) {
-		for (z = z1, zz = 0; z < zMax; z++, zz++) {
-			cIndex = Builder_PackChunk(0, yy, zz);
-
-			for (x = x1, xx = 0; x < xMax; x++, xx++, cIndex++) {
-				b = Builder_Chunk[cIndex];
-				if (Blocks.Draw[b] == DRAW_GAS) continue;
-				index = Builder_PackCount(xx, yy, zz);
-
-				/* Sprites can't be stretched, nor can then be they hidden by other blocks. */
-				/* Note sprites are drawn using DrawSprite and not with any of the DrawXFace. */
-				if (Blocks.Draw[b] == DRAW_SPRITE) { AddSpriteVertices(b); continue; }
-
-				Builder_X = x; Builder_Y = y; Builder_Z = z;
-				Builder_FullBright = Blocks.Brightness[b];
-				tileIdx = b * BLOCK_COUNT;
-				/* All of these function calls are inlined as they can be called tens of millions to hundreds of millions of times. */
-
-				if (Builder_Counts[index] == 0 ||
-					(x == 0 && (y < Builder_SidesLevel || (b >= BLOCK_WATER && b <= BLOCK_STILL_LAVA && y < Builder_EdgeLevel))) ||
-					(x != 0 && (Blocks.Hidden[tileIdx + Builder_Chunk[cIndex - 1]] & FACE_BIT_XMIN) != 0)) {
-					Builder_Counts[index] = 0;
-				} else {
-					Builder_Counts[index] = Builder_StretchZ(index, x, y, z, cIndex, b, FACE_XMIN);
-				}
-
-				index++;
-				if (Builder_Counts[index] == 0 ||
-					(x == World.MaxX && (y < Builder_SidesLevel || (b >= BLOCK_WATER && b <= BLOCK_STILL_LAVA && y < Builder_EdgeLevel))) ||
-					(x != World.MaxX && (Blocks.Hidden[tileIdx + Builder_Chunk[cIndex + 1]] & FACE_BIT_XMAX) != 0)) {
-					Builder_Counts[index] = 0;
-				} else {
-					Builder_Counts[index] = Builder_StretchZ(index, x, y, z, cIndex, b, FACE_XMAX);
-				}
-
-				index++;
-				if (Builder_Counts[index] == 0 ||
-					(z == 0 && (y < Builder_SidesLevel || (b >= BLOCK_WATER && b <= BLOCK_STILL_LAVA && y < Builder_EdgeLevel))) ||
-					(z != 0 && (Blocks.Hidden[tileIdx + Builder_Chunk[cIndex - EXTCHUNK_SIZE]] & FACE_BIT_ZMIN) != 0)) {
-					Builder_Counts[index] = 0;
-				} else {
-					Builder_Counts[index] = Builder_StretchX(index, x, y, z, cIndex, b, FACE_ZMIN);
-				}
-
-				index++;
-				if (Builder_Counts[index] == 0 ||
-					(z == World.MaxZ && (y < Builder_SidesLevel || (b >= BLOCK_WATER && b <= BLOCK_STILL_LAVA && y < Builder_EdgeLevel))) ||
-					(z != World.MaxZ && (Blocks.Hidden[tileIdx + Builder_Chunk[cIndex + EXTCHUNK_SIZE]] & FACE_BIT_ZMAX) != 0)) {
-					Builder_Counts[index] = 0;
-				} else {
-					Builder_Counts[index] = Builder_StretchX(index, x, y, z, cIndex, b, FACE_ZMAX);
-				}
-
-				index++;
-				if (Builder_Counts[index] == 0 || y == 0 ||
-					(Blocks.Hidden[tileIdx + Builder_Chunk[cIndex - EXTCHUNK_SIZE_2]] & FACE_BIT_YMIN) != 0) {
-					Builder_Counts[index] = 0;
-				} else {
-					Builder_Counts[index] = Builder_StretchX(index, x, y, z, cIndex, b, FACE_YMIN);
-				}
-
-				index++;
-				if (Builder_Counts[index] == 0 ||
-					(Blocks.Hidden[tileIdx + Builder_Chunk[cIndex + EXTCHUNK_SIZE_2]] & FACE_BIT_YMAX) != 0) {
-					Builder_Counts[index] = 0;
-				} else if (b < BLOCK_WATER || b > BLOCK_STILL_LAVA) {
-					Builder_Counts[index] = Builder_StretchX(index, x, y, z, cIndex, b, FACE_YMAX);
-				} else {
-					Builder_Counts[index] = Builder_StretchXLiquid(index, x, y, z, cIndex, b);
-				}
-			}
-		}
-	}
+static void PrepareMixedChunk(int x1, int y1, int z1) {
+	int xMax = min(World.Width,  x1 + CHUNK_SIZE);
+	int yMax = min(World.Height, y1 + CHUNK_SIZE);
+	int zMax = min(World.Length, z1 + CHUNK_SIZE);
+	int cIndex, index, tileIdx;
+	BlockID b;
+	int x, y, z, xx, yy, zz;
+	PrepareChunkBody(true)
 }
 
 #define ReadChunkBody(get_block)\
@@ -256,20 +284,25 @@ for (yy = -1; yy < 17; ++yy) {\
 			block    = get_block;\
 			allAir   = allAir   && Blocks.Draw[block] == DRAW_GAS;\
 			allSolid = allSolid && Blocks.FullOpaque[block];\
+			mixed    = mixed    || Builder_IsMixedBlock(block);\
 			Builder_Chunk[cIndex] = block;\
 		}\
 	}\
 }
 
 static cc_bool ReadChunkData(int x1, int y1, int z1, cc_bool* outAllAir) {
+#ifndef CC_BUILD_PALETTEWORLD
 	BlockRaw* blocks = World.Blocks;
 	BlockRaw* blocks2;
-	cc_bool allAir = true, allSolid = true;
+#endif
+	cc_bool allAir = true, allSolid = true, mixed = false;
 	int index, cIndex;
 	BlockID block;
 	int xx, yy, zz, y;
 
-#ifndef EXTENDED_BLOCKS
+#if defined CC_BUILD_PALETTEWORLD
+	ReadChunkBody(World_GetBlock(x1 + xx, y, z1 + zz));
+#elif !defined EXTENDED_BLOCKS
 	ReadChunkBody(blocks[index]);
 #else
 	if (World.IDMask <= 0xFF) {
@@ -280,6 +313,7 @@ static cc_bool ReadChunkData(int x1, int y1, int z1, cc_bool* outAllAir) {
 	}
 #endif
 
+	Builder_MixedChunk = mixed;
 	*outAllAir = allAir;
 	return allSolid;
 }
@@ -305,20 +339,25 @@ for (yy = -1; yy < 17; ++yy) {\
 \
 			block  = get_block;\
 			allAir = allAir && Blocks.Draw[block] == DRAW_GAS;\
+			mixed  = mixed  || Builder_IsMixedBlock(block);\
 			Builder_Chunk[cIndex] = block;\
 		}\
 	}\
 }
 
 static cc_bool ReadBorderChunkData(int x1, int y1, int z1, cc_bool* outAllAir) {
+#ifndef CC_BUILD_PALETTEWORLD
 	BlockRaw* blocks = World.Blocks;
 	BlockRaw* blocks2;
-	cc_bool allAir = true;
+#endif
+	cc_bool allAir = true, mixed = false;
 	int index, cIndex;
 	BlockID block;
 	int xx, yy, zz, x, y, z;
 
-#ifndef EXTENDED_BLOCKS
+#if defined CC_BUILD_PALETTEWORLD
+	ReadBorderChunkBody(World_GetBlock(x, y, z));
+#elif !defined EXTENDED_BLOCKS
 	ReadBorderChunkBody(blocks[index]);
 #else
 	if (World.IDMask <= 0xFF) {
@@ -329,6 +368,7 @@ static cc_bool ReadBorderChunkData(int x1, int y1, int z1, cc_bool* outAllAir) {
 	}
 #endif
 
+	Builder_MixedChunk = mixed;
 	*outAllAir = allAir;
 	return false;
 }
@@ -359,75 +399,105 @@ static void OutputChunkPartsMeta(int x, int y, int z, struct ChunkInfo* info) {
 	}
 }
 
-void Builder_MakeChunk(struct ChunkInfo* info) {
-#ifdef CC_BUILD_TINYSTACK
-	/* The Saturn build only has 16 kb stack, not large enough */
-	static BlockID chunk[EXTCHUNK_SIZE_3]; 
-	static cc_uint8 counts[CHUNK_SIZE_3 * FACE_COUNT]; 
-#else
-	BlockID chunk[EXTCHUNK_SIZE_3]; 
-	cc_uint8 counts[CHUNK_SIZE_3 * FACE_COUNT]; 
-#endif
-
-#ifdef CC_BUILD_ADVLIGHTING
-	int bitFlags[EXTCHUNK_SIZE_3];
-#else
-	int bitFlags[1];
-#endif
-
+/* Reads the blocks of the given chunk into Builder_Chunk, returning whether a mesh needs to be built for it */
+static cc_bool ReadChunk(struct ChunkInfo* info, int x1, int y1, int z1) {
 	cc_bool allAir, allSolid, onBorder;
-	int xMax, yMax, zMax, totalVerts;
-	int cIndex, index;
-	int x, y, z, xx, yy, zz;
-	int x1 = info->centreX - 8, y1 = info->centreY - 8, z1 = info->centreZ - 8;
 
-	Builder_Chunk  = chunk;
-	Builder_Counts = counts;
-	Builder_BitFlags = bitFlags;
-	Builder_PrePrepareChunk();
-	
 	onBorder = 
 		x1 == 0 || y1 == 0 || z1 == 0   || x1 + CHUNK_SIZE >= World.Width ||
 		y1 + CHUNK_SIZE >= World.Height || z1 + CHUNK_SIZE >= World.Length;
 
 	if (onBorder) {
 		/* less optimal case here */
-		Mem_Set(chunk, BLOCK_AIR, EXTCHUNK_SIZE_3 * sizeof(BlockID));
+		Mem_Set(Builder_Chunk, BLOCK_AIR, EXTCHUNK_SIZE_3 * sizeof(BlockID));
 		allSolid = ReadBorderChunkData(x1, y1, z1, &allAir);
 	} else {
 		allSolid = ReadChunkData(x1, y1, z1, &allAir);
 	}
 
 	info->allAir = allAir;
-	if (allAir || allSolid) return;
-	Lighting.LightHint(x1 - 1, y1 - 1, z1 - 1);
-
-	Mem_Set(counts, 1, CHUNK_SIZE_3 * FACE_COUNT);
-	xMax = min(World.Width,  x1 + CHUNK_SIZE);
-	yMax = min(World.Height, y1 + CHUNK_SIZE);
-	zMax = min(World.Length, z1 + CHUNK_SIZE);
+	/* Completely solid chunks can't be seen through, completely air chunks can be seen through from anywhere */
+	Mem_Set(info->connected, allSolid ? 0 : FACE_BITS_ALL, FACE_COUNT);
+	if (allAir || allSolid) return false;
 
-	Builder_ChunkEndX = xMax; Builder_ChunkEndZ = zMax;
-	PrepareChunk(x1, y1, z1);
+	Lighting.LightHint(x1 - 1, y1 - 1, z1 - 1);
+	return true;
+}
 
-	totalVerts = Builder_TotalVerticesCount();
-	if (!totalVerts) return;
-	
-	OutputChunkPartsMeta(x1, y1, z1, info);
-#ifdef OCCLUSION
-	if (info.NormalParts != null || info.TranslucentParts != null)
-		info.occlusionFlags = (cc_uint8)ComputeOcclusion();
-#endif
+#define Connectivity_Visit(i) if (!visited[i]) { visited[i] = true; stack[count++] = (i); }
 
-#ifndef CC_BUILD_GL11
-	/* add an extra element to fix crashing on some GPUs */
-	Builder_Vertices = (struct VertexTextured*)Gfx_RecreateAndLockVb(&info->vb,
-													VERTEX_FORMAT_TEXTURED, totalVerts + 1);
+/* Flood fills through non-opaque blocks in the chunk, to calculate which faces of the */
+/*  chunk can be seen from which other faces of the chunk (used for occlusion culling) */
+static void CalcConnectivity(struct ChunkInfo* info) {
+#ifdef CC_BUILD_TINYSTACK
+	static cc_uint16 stack[CHUNK_SIZE_3];
+	static cc_uint8 visited[CHUNK_SIZE_3];
 #else
-	/* NOTE: Relies on assumption vb is ignored by GL11 Gfx_LockVb implementation */
-	Builder_Vertices = (struct VertexTextured*)Gfx_LockVb(0, 
-													VERTEX_FORMAT_TEXTURED, totalVerts + 1);
+	cc_uint16 stack[CHUNK_SIZE_3];
+	cc_uint8 visited[CHUNK_SIZE_3];
 #endif
+	int i, index, count, faces, face;
+	int x, y, z;
+
+	for (i = 0, y = 0; y < CHUNK_SIZE; y++) {
+		for (z = 0; z < CHUNK_SIZE; z++) {
+			for (x = 0; x < CHUNK_SIZE; x++, i++) {
+				visited[i] = Blocks.FullOpaque[Builder_Chunk[Builder_PackChunk(x, y, z)]];
+			}
+		}
+	}
+	Mem_Set(info->connected, 0, FACE_COUNT);
+
+	for (i = 0; i < CHUNK_SIZE_3; i++) {
+		if (visited[i]) continue;
+		visited[i] = true;
+		stack[0]   = i;
+		count = 1; faces = 0;
+
+		while (count) {
+			index = stack[--count];
+			x = index & CHUNK_MASK; z = (index >> 4) & CHUNK_MASK; y = index >> 8;
+
+			if (x == 0)         { faces |= FACE_BIT_XMIN; } else { Connectivity_Visit(index - 1); }
+			if (x == CHUNK_MAX) { faces |= FACE_BIT_XMAX; } else { Connectivity_Visit(index + 1); }
+			if (z == 0)         { faces |= FACE_BIT_ZMIN; } else { Connectivity_Visit(index - CHUNK_SIZE); }
+			if (z == CHUNK_MAX) { faces |= FACE_BIT_ZMAX; } else { Connectivity_Visit(index + CHUNK_SIZE); }
+			if (y == 0)         { faces |= FACE_BIT_YMIN; } else { Connectivity_Visit(index - CHUNK_SIZE_2); }
+			if (y == CHUNK_MAX) { faces |= FACE_BIT_YMAX; } else { Connectivity_Visit(index + CHUNK_SIZE_2); }
+		}
+
+		for (face = 0; face < FACE_COUNT; face++) {
+			if (faces & (1 << face)) info->connected[face] |= faces;
+		}
+	}
+}
+
+/* Calculates which faces in the chunk are visible, returning the total number of vertices in the chunk mesh */
+static int CountChunk(int x1, int y1, int z1) {
+	Mem_Set(Builder_Counts, 1, CHUNK_SIZE_3 * FACE_COUNT);
+	Builder_ChunkEndX = min(World.Width,  x1 + CHUNK_SIZE);
+	Builder_ChunkEndZ = min(World.Length, z1 + CHUNK_SIZE);
+
+	/* Chosen once per chunk, so that the per block loop doesn't check for sprites and liquids when unnecessary */
+	if (Builder_MixedChunk) {
+		PrepareMixedChunk(x1, y1, z1);
+	} else {
+		PrepareSimpleChunk(x1, y1, z1);
+	}
+
+	Builder_MergedRows = false;
+	if (Builder_MergeChunk) Builder_MergeChunk(x1, y1, z1);
+	return Builder_TotalVerticesCount();
+}
+
+/* Outputs the vertices of all the visible faces in the chunk into Builder_Vertices */
+static void RenderChunk(int x1, int y1, int z1) {
+	int xMax = min(World.Width,  x1 + CHUNK_SIZE);
+	int yMax = min(World.Height, y1 + CHUNK_SIZE);
+	int zMax = min(World.Length, z1 + CHUNK_SIZE);
+	int cIndex, index;
+	int x, y, z, xx, yy, zz;
+
 	Builder_PostPrepareChunk();
 	/* now render the chunk */
 
@@ -436,7 +506,7 @@ void Builder_MakeChunk(struct ChunkInfo* info) {
 			cIndex = Builder_PackChunk(0, yy, zz);
 
 			for (x = x1, xx = 0; x < xMax; x++, xx++, cIndex++) {
-				Builder_Block = chunk[cIndex];
+				Builder_Block = Builder_Chunk[cIndex];
 				if (Blocks.Draw[Builder_Block] == DRAW_GAS) continue;
 
 				index = Builder_PackCount(xx, yy, zz);
@@ -445,21 +515,919 @@ void Builder_MakeChunk(struct ChunkInfo* info) {
 			}
 		}
 	}
+}
 
 #ifdef CC_BUILD_GL11
-	cIndex = World_ChunkPack(x1 >> CHUNK_SHIFT, y1 >> CHUNK_SHIFT, z1 >> CHUNK_SHIFT);
+static void BuildChunkVbs(int x1, int y1, int z1) {
+	int i, curIdx, partsIndex;
+	partsIndex = World_ChunkPack(x1 >> CHUNK_SHIFT, y1 >> CHUNK_SHIFT, z1 >> CHUNK_SHIFT);
 
-	for (index = 0; index < MapRenderer_1DUsedCount; index++) {
-		int curIdx = cIndex + index * World.ChunksCount;
+	for (i = 0; i < MapRenderer_1DUsedCount; i++) {
+		curIdx = partsIndex + i * World.ChunksCount;
 
 		BuildPartVbs(&MapRenderer_PartsNormal[curIdx]);
 		BuildPartVbs(&MapRenderer_PartsTranslucent[curIdx]);
 	}
+}
+#endif
+
+#ifndef CC_BUILD_GL11
+/* Converts vertices to the compact chunk vertex format in place */
+/* NOTE: Safe since a compact vertex is smaller than a normal vertex */
+static void PackVertices(struct VertexTextured* vertices, int count, int x1, int y1, int z1) {
+	struct VertexChunk* dst = (struct VertexChunk*)vertices;
+	struct VertexTextured v;
+	int i, layer = 0;
+
+	for (i = 0; i < count; i++, dst++) {
+		v = vertices[i];
+		/* V coords of a texture array layer range from 2 * layer to 2 * layer + 1 */
+		if (MapRenderer_TextureArray) {
+			layer = (int)((v.V + 0.5f) * 0.5f);
+			v.V  -= layer * 2;
+		}
+
+		dst->x   = (cc_int16)Math_Floor((v.x - x1) * CHUNKVERTEX_POS_SCALE + 0.5f);
+		dst->y   = (cc_int16)Math_Floor((v.y - y1) * CHUNKVERTEX_POS_SCALE + 0.5f);
+		dst->z   = (cc_int16)Math_Floor((v.z - z1) * CHUNKVERTEX_POS_SCALE + 0.5f);
+		dst->layer = (cc_int16)layer;
+		dst->U   = (cc_int16)Math_Floor(v.U * CHUNKVERTEX_U_SCALE + 0.5f);
+		dst->V   = (cc_int16)Math_Floor(v.V * CHUNKVERTEX_V_SCALE + 0.5f);
+		dst->Col = v.Col;
+	}
+	/* Extra vertex to fix crashing on some GPUs */
+	Mem_Set(dst, 0, sizeof(struct VertexChunk));
+}
+
+/* Uploads the given vertices (already packed if using compact vertices) to the chunk's VB */
+static void UploadChunkVb(struct ChunkInfo* info, void* vertices, int count) {
+	VertexFormat fmt = MapRenderer_CompactVertices ? VERTEX_FORMAT_CHUNK : VERTEX_FORMAT_TEXTURED;
+	int stride       = MapRenderer_CompactVertices ? SIZEOF_VERTEX_CHUNK : SIZEOF_VERTEX_TEXTURED;
+	void* data;
+
+	data = Gfx_RecreateAndLockVb(&info->vb, fmt, count);
+	Mem_Copy(data, vertices, count * stride);
+	Gfx_UnlockVb(info->vb);
+
+	MapRenderer_CurStats->vertices    += count;
+	MapRenderer_CurStats->uploadBytes += count * stride;
+}
+#endif
+
+
+/*########################################################################################################################*
+*-----------------------------------------------------Chunk mesh cache----------------------------------------------------*
+*#########################################################################################################################*/
+#ifndef CC_BUILD_GL11
+#define MESHCACHE_MAGIC   0x434D4343UL /* "CCMC" */
+#define MESHCACHE_VERSION 1
+#define MESHCACHE_HEADER_SIZE 16
+#define MESHCACHE_ENTRY_SIZE  20
+
+/* A previously built chunk mesh, along with a hash of everything the mesh was built from */
+struct CachedMesh {
+	cc_uint32 hash;
+	cc_uint32 size; /* Size of vertices in bytes */
+	cc_uint8 connected[FACE_COUNT];
+	cc_uint8 partsCount;
+	/* Normal then translucent part for each 1D atlas, or NULL if no mesh cached */
+	struct ChunkPartInfo* parts;
+	void* vertices;
+};
+
+/* Whether finished chunk meshes are saved to and reused from disk */
+static cc_bool meshCacheEnabled;
+/* Whether chunk meshes can currently be reused (e.g. not with fancy lighting) */
+static cc_bool meshCacheActive;
+/* Whether the cache file for the current map still needs to be read */
+static cc_bool meshCachePending;
+static struct CachedMesh* meshCache;
+static int meshCacheCount;
+/* Hash of all the global state that affects how chunk meshes are built */
+static cc_uint32 meshCacheSettings;
+static cc_string meshCachePath; static char meshCachePathBuffer[FILENAME_SIZE];
+
+static cc_uint32 MeshCache_Crc(cc_uint32 crc, const void* data, int length) {
+	const cc_uint8* src = (const cc_uint8*)data;
+	int i;
+
+	for (i = 0; i < length; i++) {
+		crc = Utils_Crc32Table[(crc ^ src[i]) & 0xFF] ^ (crc >> 8);
+	}
+	return crc;
+}
+
+/* Hashes block definitions, environment colours and builder settings */
+static void MeshCache_LoadFile(void);
+static void MeshCache_Begin(void) {
+	int state[11];
+	cc_uint32 crc = 0xFFFFFFFFUL;
+
+	if (meshCachePending) {
+		meshCachePending = false;
+		MeshCache_LoadFile();
+	}
+	meshCacheActive = meshCache && Lighting_Mode == LIGHTING_MODE_CLASSIC;
+	if (!meshCacheActive) return;
+
+	state[0] = MESHCACHE_VERSION;          state[1] = Builder_SmoothLighting;
+	state[2] = MapRenderer_CompactVertices; state[3] = MapRenderer_1DUsedCount;
+	state[4] = Atlas1D.TilesPerAtlas;       state[5] = Builder_SidesLevel;
+	state[6] = Builder_EdgeLevel;           state[7] = World.Width;
+	state[8] = World.Height;                state[9] = World.Length;
+	state[10] = MapRenderer_TextureArray;
+
+	crc = MeshCache_Crc(crc, state, sizeof(state));
+	crc = MeshCache_Crc(crc, &Lighting_MeshCols, sizeof(Lighting_MeshCols));
+	crc = MeshCache_Crc(crc, Blocks.Draw,         sizeof(Blocks.Draw));
+	crc = MeshCache_Crc(crc, Atlas1D.LayerV,      sizeof(Atlas1D.LayerV));
+	crc = MeshCache_Crc(crc, Blocks.Brightness,   sizeof(Blocks.Brightness));
+	crc = MeshCache_Crc(crc, Blocks.LightOffset,  sizeof(Blocks.LightOffset));
+	crc = MeshCache_Crc(crc, Blocks.FullOpaque,   sizeof(Blocks.FullOpaque));
+	crc = MeshCache_Crc(crc, Blocks.Tinted,       sizeof(Blocks.Tinted));
+	crc = MeshCache_Crc(crc, Blocks.FogCol,       sizeof(Blocks.FogCol));
+	crc = MeshCache_Crc(crc, Blocks.SpriteOffset, sizeof(Blocks.SpriteOffset));
+	crc = MeshCache_Crc(crc, Blocks.CanStretch,   sizeof(Blocks.CanStretch));
+	crc = MeshCache_Crc(crc, Blocks.MinBB,        sizeof(Blocks.MinBB));
+	crc = MeshCache_Crc(crc, Blocks.MaxBB,        sizeof(Blocks.MaxBB));
+	crc = MeshCache_Crc(crc, Blocks.RenderMinBB,  sizeof(Blocks.RenderMinBB));
+	crc = MeshCache_Crc(crc, Blocks.RenderMaxBB,  sizeof(Blocks.RenderMaxBB));
+	crc = MeshCache_Crc(crc, Blocks.Textures,     sizeof(Blocks.Textures));
+	meshCacheSettings = crc;
+}
+
+/* Hashes the blocks read into Builder_Chunk, along with which of those blocks are in sunlight */
+static cc_uint32 MeshCache_HashChunk(int x1, int y1, int z1) {
+	int xMax = min(World.Width,  x1 + CHUNK_SIZE + 1);
+	int zMax = min(World.Length, z1 + CHUNK_SIZE + 1);
+	cc_uint32 crc = MeshCache_Crc(meshCacheSettings, Builder_Chunk, EXTCHUNK_SIZE_3 * sizeof(BlockID));
+	int x, z, height;
+
+	for (z = max(0, z1 - 1); z < zMax; z++) {
+		for (x = max(0, x1 - 1); x < xMax; x++) {
+			/* Heights outside the chunk only matter as being entirely above or below it */
+			height = ClassicLighting_GetLightHeight(x, z) - y1;
+			Math_Clamp(height, -2, CHUNK_SIZE);
+			crc = Utils_Crc32Table[(crc ^ (height + 2)) & 0xFF] ^ (crc >> 8);
+		}
+	}
+	return crc ^ 0xFFFFFFFFUL;
+}
+
+/* Restores the chunk's mesh from the cache, if the cached mesh was built from the same blocks */
+/* NOTE: Also outputs the hash of the chunk, for storing the mesh in the cache after it is built */
+static cc_bool MeshCache_Restore(struct ChunkInfo* info, int x1, int y1, int z1, cc_uint32* hash) {
+	int index = World_ChunkPack(x1 >> CHUNK_SHIFT, y1 >> CHUNK_SHIFT, z1 >> CHUNK_SHIFT);
+	struct CachedMesh* mesh;
+	int i, curIdx, stride;
+
+	if (!meshCacheActive) return false;
+	*hash = MeshCache_HashChunk(x1, y1, z1);
+	mesh  = &meshCache[index];
+	if (!mesh->parts || mesh->hash != *hash || mesh->partsCount != MapRenderer_1DUsedCount) return false;
+
+	Mem_Copy(info->connected, mesh->connected, FACE_COUNT);
+	if (!mesh->size) return true;
+
+	for (i = 0; i < MapRenderer_1DUsedCount; i++) {
+		curIdx = index + i * World.ChunksCount;
+		MapRenderer_PartsNormal[curIdx]      = mesh->parts[i * 2 + 0];
+		MapRenderer_PartsTranslucent[curIdx] = mesh->parts[i * 2 + 1];
+
+		if (mesh->parts[i * 2 + 0].offset >= 0) info->normalParts      = &MapRenderer_PartsNormal[index];
+		if (mesh->parts[i * 2 + 1].offset >= 0) info->translucentParts = &MapRenderer_PartsTranslucent[index];
+	}
+
+	stride = MapRenderer_CompactVertices ? SIZEOF_VERTEX_CHUNK : SIZEOF_VERTEX_TEXTURED;
+	UploadChunkVb(info, mesh->vertices, mesh->size / stride);
+	return true;
+}
+
+static void MeshCache_FreeMesh(struct CachedMesh* mesh) {
+	Mem_Free(mesh->parts);
+	Mem_Free(mesh->vertices);
+	mesh->parts    = NULL;
+	mesh->vertices = NULL;
+}
+
+/* Stores the newly built mesh of the given chunk in the cache */
+/* NOTE: Takes ownership of the vertices, which are freed if they can't be cached */
+static void MeshCache_Store(struct ChunkInfo* info, cc_uint32 hash, void* vertices, int count) {
+	int index = World_ChunkPack(info->centreX >> CHUNK_SHIFT, info->centreY >> CHUNK_SHIFT, info->centreZ >> CHUNK_SHIFT);
+	struct CachedMesh* mesh;
+	int i, curIdx, stride;
+
+	if (!meshCacheActive) { Mem_Free(vertices); return; }
+	mesh = &meshCache[index];
+	MeshCache_FreeMesh(mesh);
+
+	mesh->parts = (struct ChunkPartInfo*)Mem_TryAlloc(MapRenderer_1DUsedCount * 2, sizeof(struct ChunkPartInfo));
+	if (!mesh->parts) { Mem_Free(vertices); return; }
+
+	stride = MapRenderer_CompactVertices ? SIZEOF_VERTEX_CHUNK : SIZEOF_VERTEX_TEXTURED;
+	mesh->hash       = hash;
+	mesh->size       = count * stride;
+	mesh->partsCount = MapRenderer_1DUsedCount;
+	mesh->vertices   = vertices;
+	Mem_Copy(mesh->connected, info->connected, FACE_COUNT);
+
+	for (i = 0; i < MapRenderer_1DUsedCount; i++) {
+		curIdx = index + i * World.ChunksCount;
+		mesh->parts[i * 2 + 0] = MapRenderer_PartsNormal[curIdx];
+		mesh->parts[i * 2 + 1] = MapRenderer_PartsTranslucent[curIdx];
+	}
+}
+
+/* Whether the parts of the given mesh only refer to vertices within the mesh */
+static cc_bool MeshCache_ValidParts(struct CachedMesh* mesh, int stride) {
+	struct ChunkPartInfo* part;
+	cc_uint32 i, j, end, vertices = mesh->size / stride;
+
+	for (i = 0; i < mesh->partsCount * 2; i++) {
+		part = &mesh->parts[i];
+		if (part->offset == -1) continue;
+		if (part->offset < 0 || part->spriteCount < 0) return false;
+
+		end = (cc_uint32)part->offset + (cc_uint32)part->spriteCount;
+		for (j = 0; j < FACE_COUNT; j++) end += part->counts[j];
+		if (end > vertices) return false;
+	}
+	return true;
+}
+
+static cc_result MeshCache_ReadFrom(struct Stream* s) {
+	cc_uint8 header[MESHCACHE_HEADER_SIZE];
+	struct CachedMesh* mesh;
+	cc_uint32 i, count, index;
+	cc_result res;
+	int stride = MapRenderer_CompactVertices ? SIZEOF_VERTEX_CHUNK : SIZEOF_VERTEX_TEXTURED;
+
+	if ((res = Stream_Read(s, header, MESHCACHE_HEADER_SIZE))) return res;
+	/* Cache from an older version or a different world is silently ignored */
+	if (Stream_GetU32_LE(&header[0]) != MESHCACHE_MAGIC)   return 0;
+	if (Stream_GetU32_LE(&header[4]) != MESHCACHE_VERSION) return 0;
+	if (Stream_GetU32_LE(&header[8]) != meshCacheCount)    return 0;
+	count = Stream_GetU32_LE(&header[12]);
+
+	for (i = 0; i < count; i++) {
+		if ((res = Stream_Read(s, header, MESHCACHE_ENTRY_SIZE))) return res;
+		index = Stream_GetU32_LE(&header[0]);
+		if (index >= meshCacheCount) return ERR_INVALID_ARGUMENT;
+
+		mesh = &meshCache[index];
+		MeshCache_FreeMesh(mesh);
+		mesh->hash       = Stream_GetU32_LE(&header[4]);
+		mesh->size       = Stream_GetU32_LE(&header[8]);
+		mesh->partsCount = header[18];
+		Mem_Copy(mesh->connected, &header[12], FACE_COUNT);
+
+		/* Cache written with a different terrain atlas, or from a corrupted file */
+		if (mesh->partsCount != MapRenderer_1DUsedCount || mesh->size % stride) return 0;
+
+		mesh->parts = (struct ChunkPartInfo*)Mem_TryAlloc(mesh->partsCount * 2, sizeof(struct ChunkPartInfo));
+		if (!mesh->parts) return ERR_OUT_OF_MEMORY;
+		res = Stream_Read(s, (cc_uint8*)mesh->parts, mesh->partsCount * 2 * sizeof(struct ChunkPartInfo));
+		if (res) return res;
+		if (!MeshCache_ValidParts(mesh, stride)) { MeshCache_FreeMesh(mesh); return ERR_INVALID_ARGUMENT; }
+
+		if (!mesh->size) continue;
+		mesh->vertices = Mem_TryAlloc(mesh->size, 1);
+		if (!mesh->vertices) return ERR_OUT_OF_MEMORY;
+		if ((res = Stream_Read(s, (cc_uint8*)mesh->vertices, mesh->size))) return res;
+	}
+	return 0;
+}
+
+static cc_result MeshCache_WriteTo(struct Stream* s) {
+	cc_uint8 header[MESHCACHE_HEADER_SIZE];
+	struct CachedMesh* mesh;
+	int i, count = 0;
+	cc_result res;
+
+	for (i = 0; i < meshCacheCount; i++) {
+		if (meshCache[i].parts) count++;
+	}
+	Stream_SetU32_LE(&header[0],  MESHCACHE_MAGIC);
+	Stream_SetU32_LE(&header[4],  MESHCACHE_VERSION);
+	Stream_SetU32_LE(&header[8],  meshCacheCount);
+	Stream_SetU32_LE(&header[12], count);
+	if ((res = Stream_Write(s, header, MESHCACHE_HEADER_SIZE))) return res;
+
+	for (i = 0; i < meshCacheCount; i++) {
+		mesh = &meshCache[i];
+		if (!mesh->parts) continue;
+
+		Stream_SetU32_LE(&header[0], i);
+		Stream_SetU32_LE(&header[4], mesh->hash);
+		Stream_SetU32_LE(&header[8], mesh->size);
+		Mem_Copy(&header[12], mesh->connected, FACE_COUNT);
+		header[18] = mesh->partsCount;
+		header[19] = 0;
+		if ((res = Stream_Write(s, header, MESHCACHE_ENTRY_SIZE))) return res;
+
+		res = Stream_Write(s, (cc_uint8*)mesh->parts, mesh->partsCount * 2 * sizeof(struct ChunkPartInfo));
+		if (res) return res;
+		if (mesh->size && (res = Stream_Write(s, (const cc_uint8*)mesh->vertices, mesh->size))) return res;
+	}
+	return 0;
+}
+
+/* NOTE: World.Uuid is regenerated every time a map is loaded, so can't be used to identify the map */
+static void MeshCache_MakePath(void) {
+	cc_string key; char keyBuffer[STRING_SIZE * 4];
+	String_InitArray(key, keyBuffer);
+	String_Format2(&key, "%s:%i", &Server.Address, &Server.Port);
+	/* Singleplayer maps all have the same address, so are told apart by their name and seed instead */
+	String_Format2(&key, ":%s:%i", &World.Name, &World.Seed);
+	String_Format3(&key, ":%i,%i,%i", &World.Width, &World.Height, &World.Length);
+
+	String_InitArray(meshCachePath, meshCachePathBuffer);
+	String_AppendConst(&meshCachePath, "meshcache/");
+	String_AppendUInt32(&meshCachePath, Utils_CRC32((const cc_uint8*)key.buffer, key.length));
+	String_AppendConst(&meshCachePath, ".bin");
+}
+
+static void MeshCache_LoadFile(void) {
+	cc_uint8 buffer[8192];
+	struct Stream stream, buffered;
+	cc_result res;
+
+	if (!meshCacheEnabled || !World.ChunksCount) return;
+	meshCache = (struct CachedMesh*)Mem_TryAllocCleared(World.ChunksCount, sizeof(struct CachedMesh));
+	if (!meshCache) return;
+
+	meshCacheCount = World.ChunksCount;
+	MeshCache_MakePath();
+
+	res = Stream_OpenFile(&stream, &meshCachePath);
+	if (res == ReturnCode_FileNotFound) return;
+	if (res) { Logger_SysWarn2(res, "opening", &meshCachePath); return; }
+
+	Stream_ReadonlyBuffered(&buffered, &stream, buffer, sizeof(buffer));
+	res = MeshCache_ReadFrom(&buffered);
+	if (res) Logger_SysWarn2(res, "reading", &meshCachePath);
+	(void)stream.Close(&stream);
+}
+
+/* The cache file is only read when chunks are first built, */
+/*  because a map's name and seed are only set after the map has been loaded */
+static void MeshCache_Load(void) { meshCachePending = meshCacheEnabled; }
+
+static void MeshCache_Save(void) {
+	struct Stream stream;
+	cc_result res;
+	int i;
+
+	meshCachePending = false;
+	if (!meshCache) return;
+
+	if (Utils_EnsureDirectory("meshcache")) {
+		res = Stream_CreateFile(&stream, &meshCachePath);
+
+		if (res) {
+			Logger_SysWarn2(res, "creating", &meshCachePath);
+		} else {
+			res = MeshCache_WriteTo(&stream);
+			if (res) Logger_SysWarn2(res, "writing", &meshCachePath);
+			(void)stream.Close(&stream);
+		}
+	}
+
+	for (i = 0; i < meshCacheCount; i++) {
+		MeshCache_FreeMesh(&meshCache[i]);
+	}
+	Mem_Free(meshCache);
+	meshCache       = NULL;
+	meshCacheCount  = 0;
+	meshCacheActive = false;
+}
+#else
+static void MeshCache_Begin(void) { }
+static cc_bool MeshCache_Restore(struct ChunkInfo* info, int x1, int y1, int z1, cc_uint32* hash) { return false; }
+static void MeshCache_Store(struct ChunkInfo* info, cc_uint32 hash, void* vertices, int count) { Mem_Free(vertices); }
+static void MeshCache_Load(void) { }
+static void MeshCache_Save(void) { }
+#endif
+
+
+/*########################################################################################################################*
+*-------------------------------------------------Smooth lighting cache---------------------------------------------------*
+*#########################################################################################################################*/
+#ifdef CC_BUILD_ADVLIGHTING
+/* Must be more than the number of chunks that can be built in one batch */
+#define ADVCACHE_COUNT 80
+#define ADVCACHE_UNCALCULATED -1
+
+/* Smooth lighting flags of the blocks in a chunk, from the last time the chunk was built */
+/* The blocks and light heights the flags were calculated from are also kept, so that */
+/*  only the flags around blocks/light heights that have changed need to be calculated again */
+struct AdvLightCache {
+	int x1, y1, z1, edgeLevel;
+	cc_bool valid;
+	cc_uint32 lastBatch;
+	BlockID blocks[EXTCHUNK_SIZE_3];
+	cc_int16 heights[EXTCHUNK_SIZE * EXTCHUNK_SIZE];
+	int flags[EXTCHUNK_SIZE_3];
+};
+
+static struct AdvLightCache* advCache;
+static cc_bool advCacheActive;
+static cc_uint32 advCacheBatch;
+static CC_THREADLOCAL struct AdvLightCache* adv_cache;
+static CC_THREADLOCAL cc_bool adv_cacheValidated;
+
+static void AdvCache_Begin(void) { advCacheBatch++; }
+
+static void AdvCache_Invalidate(void) {
+	int i;
+	if (!advCache) return;
+	for (i = 0; i < ADVCACHE_COUNT; i++) advCache[i].valid = false;
+}
+
+static void AdvCache_Free(void) {
+	Mem_Free(advCache);
+	advCache = NULL;
+}
+
+/* Returns the cache entry to use when building the given chunk, or NULL if no entry is available */
+static struct AdvLightCache* AdvCache_Acquire(int x1, int y1, int z1) {
+	struct AdvLightCache* entry;
+	struct AdvLightCache* oldest = NULL;
+	int i;
+	if (!advCacheActive) return NULL;
+
+	if (!advCache) {
+		advCache = (struct AdvLightCache*)Mem_TryAllocCleared(ADVCACHE_COUNT, sizeof(struct AdvLightCache));
+		if (!advCache) { advCacheActive = false; return NULL; }
+	}
+
+	for (i = 0; i < ADVCACHE_COUNT; i++) {
+		entry = &advCache[i];
+		if (entry->valid && entry->x1 == x1 && entry->y1 == y1 && entry->z1 == z1) {
+			entry->lastBatch = advCacheBatch;
+			return entry;
+		}
+		/* Entries being used by other chunks in the current batch can't be replaced */
+		if (entry->lastBatch == advCacheBatch) continue;
+		if (!oldest || entry->lastBatch < oldest->lastBatch) oldest = entry;
+	}
+	if (!oldest) return NULL;
+
+	oldest->valid = false;
+	oldest->x1 = x1; oldest->y1 = y1; oldest->z1 = z1;
+	oldest->lastBatch = advCacheBatch;
+	return oldest;
+}
+
+static void AdvCache_Uncalculate(struct AdvLightCache* entry, int xx1, int xx2, int yy1, int yy2, int zz1, int zz2) {
+	int xx, yy, zz;
+	xx1 = max(xx1, 0); xx2 = min(xx2, EXTCHUNK_SIZE - 1);
+	yy1 = max(yy1, 0); yy2 = min(yy2, EXTCHUNK_SIZE - 1);
+	zz1 = max(zz1, 0); zz2 = min(zz2, EXTCHUNK_SIZE - 1);
+
+	for (yy = yy1; yy <= yy2; yy++) {
+		for (zz = zz1; zz <= zz2; zz++) {
+			for (xx = xx1; xx <= xx2; xx++) {
+				entry->flags[(yy * EXTCHUNK_SIZE + zz) * EXTCHUNK_SIZE + xx] = ADVCACHE_UNCALCULATED;
+			}
+		}
+	}
+}
+
+/* Marks the flags that depend on blocks or light heights which have changed since the chunk was last built */
+/* NOTE: Coordinates here are for the 18x18x18 chunk array, and range from 0 to 17 */
+static void AdvCache_Validate(struct AdvLightCache* entry) {
+	int xx, yy, zz, x, z, i, height, oldHeight;
+	int x1 = entry->x1 - 1, y1 = entry->y1 - 1, z1 = entry->z1 - 1;
+	cc_bool reset = !entry->valid || entry->edgeLevel != Builder_EdgeLevel;
+
+	if (reset) Mem_Set(entry->flags, 0xFF, sizeof(entry->flags));
+	entry->valid     = true;
+	entry->edgeLevel = Builder_EdgeLevel;
+
+	/* Flags of a block depend on the blocks around it */
+	for (i = 0, yy = 0; yy < EXTCHUNK_SIZE; yy++) {
+		for (zz = 0; zz < EXTCHUNK_SIZE; zz++) {
+			for (xx = 0; xx < EXTCHUNK_SIZE; xx++, i++) {
+				if (entry->blocks[i] == Builder_Chunk[i]) continue;
+
+				entry->blocks[i] = Builder_Chunk[i];
+				if (!reset) AdvCache_Uncalculate(entry, xx - 1, xx + 1, yy - 1, yy + 1, zz - 1, zz + 1);
+			}
+		}
+	}
+
+	/* Flags of a block depend on whether the blocks above/below it in the surrounding columns are lit */
+	for (i = 0, zz = 0; zz < EXTCHUNK_SIZE; zz++) {
+		for (xx = 0; xx < EXTCHUNK_SIZE; xx++, i++) {
+			x = x1 + xx; z = z1 + zz;
+			if (!World_ContainsXZ(x, z)) continue;
+
+			height    = ClassicLighting_GetLightHeight(x, z);
+			oldHeight = entry->heights[i];
+			if (height == oldHeight) continue;
+
+			entry->heights[i] = (cc_int16)height;
+			if (reset) continue;
+			AdvCache_Uncalculate(entry, xx - 1, xx + 1, min(height, oldHeight) - y1 - 1, 
+								max(height, oldHeight) - y1 + 1, zz - 1, zz + 1);
+		}
+	}
+}
+#else
+static void AdvCache_Begin(void) { }
+static void AdvCache_Invalidate(void) { }
+static void AdvCache_Free(void) { }
+#endif
+
+
+static void MakeChunk(struct ChunkInfo* info) {
+#ifdef CC_BUILD_TINYSTACK
+	/* The Saturn build only has 16 kb stack, not large enough */
+	static BlockID chunk[EXTCHUNK_SIZE_3]; 
+	static cc_uint8 counts[CHUNK_SIZE_3 * FACE_COUNT]; 
+#else
+	BlockID chunk[EXTCHUNK_SIZE_3]; 
+	cc_uint8 counts[CHUNK_SIZE_3 * FACE_COUNT]; 
+#endif
+
+#ifdef CC_BUILD_ADVLIGHTING
+	int bitFlags[EXTCHUNK_SIZE_3];
+#else
+	int bitFlags[1];
+#endif
+
+	int totalVerts;
+	int x1 = info->centreX - 8, y1 = info->centreY - 8, z1 = info->centreZ - 8;
+	cc_uint32 hash = 0;
+
+	Builder_Chunk  = chunk;
+	Builder_Counts = counts;
+	Builder_BitFlags = bitFlags;
+	Builder_Parts    = builder_parts;
+	Builder_PrePrepareChunk();
+
+	if (!ReadChunk(info, x1, y1, z1)) return;
+	if (MeshCache_Restore(info, x1, y1, z1, &hash)) return;
+#ifdef CC_BUILD_ADVLIGHTING
+	adv_cache = AdvCache_Acquire(x1, y1, z1);
+	adv_cacheValidated = false;
+#endif
+
+	CalcConnectivity(info);
+	totalVerts = CountChunk(x1, y1, z1);
+	if (!totalVerts) { MeshCache_Store(info, hash, NULL, 0); return; }
+	
+	OutputChunkPartsMeta(x1, y1, z1, info);
+
+#ifndef CC_BUILD_GL11
+	if (MapRenderer_CompactVertices || meshCacheActive) {
+		/* Mesh is built into a temp buffer, then converted into the VB */
+		Builder_Vertices = (struct VertexTextured*)Mem_TryAlloc(totalVerts + 1, sizeof(struct VertexTextured));
+		if (!Builder_Vertices) return;
+
+		RenderChunk(x1, y1, z1);
+		if (MapRenderer_CompactVertices) {
+			PackVertices(Builder_Vertices, totalVerts, x1, y1, z1);
+		} else {
+			Mem_Set(&Builder_Vertices[totalVerts], 0, sizeof(struct VertexTextured));
+		}
+
+		UploadChunkVb(info, Builder_Vertices, totalVerts + 1);
+		MeshCache_Store(info, hash, Builder_Vertices, totalVerts + 1);
+		return;
+	}
+
+	/* add an extra element to fix crashing on some GPUs */
+	Builder_Vertices = (struct VertexTextured*)Gfx_RecreateAndLockVb(&info->vb,
+													VERTEX_FORMAT_TEXTURED, totalVerts + 1);
+#else
+	/* NOTE: Relies on assumption vb is ignored by GL11 Gfx_LockVb implementation */
+	Builder_Vertices = (struct VertexTextured*)Gfx_LockVb(0, 
+													VERTEX_FORMAT_TEXTURED, totalVerts + 1);
+#endif
+	RenderChunk(x1, y1, z1);
+
+#ifdef CC_BUILD_GL11
+	BuildChunkVbs(x1, y1, z1);
 #else
 	Gfx_UnlockVb(info->vb);
+	MapRenderer_CurStats->vertices    += totalVerts + 1;
+	MapRenderer_CurStats->uploadBytes += (totalVerts + 1) * SIZEOF_VERTEX_TEXTURED;
+#endif
+}
+
+void Builder_MakeChunk(struct ChunkInfo* info) {
+	Tracer_Begin("Builder_MakeChunk");
+	MakeChunk(info);
+	Tracer_End();
+}
+
+/* Same as Builder_MakeChunk, except the mesh is always built from scratch and then discarded */
+static int Builder_BenchmarkChunk(struct ChunkInfo* info) {
+#ifdef CC_BUILD_TINYSTACK
+	static BlockID chunk[EXTCHUNK_SIZE_3]; 
+	static cc_uint8 counts[CHUNK_SIZE_3 * FACE_COUNT]; 
+#else
+	BlockID chunk[EXTCHUNK_SIZE_3]; 
+	cc_uint8 counts[CHUNK_SIZE_3 * FACE_COUNT]; 
+#endif
+
+#ifdef CC_BUILD_ADVLIGHTING
+	int bitFlags[EXTCHUNK_SIZE_3];
+#else
+	int bitFlags[1];
+#endif
+
+	int totalVerts;
+	int x1 = info->centreX - 8, y1 = info->centreY - 8, z1 = info->centreZ - 8;
+
+	Builder_Chunk  = chunk;
+	Builder_Counts = counts;
+	Builder_BitFlags = bitFlags;
+	Builder_Parts    = builder_parts;
+	Builder_PrePrepareChunk();
+
+	if (!ReadChunk(info, x1, y1, z1)) return 0;
+#ifdef CC_BUILD_ADVLIGHTING
+	adv_cache = AdvCache_Acquire(x1, y1, z1);
+	adv_cacheValidated = false;
+#endif
+
+	CalcConnectivity(info);
+	totalVerts = CountChunk(x1, y1, z1);
+	if (!totalVerts) return 0;
+	OutputChunkPartsMeta(x1, y1, z1, info);
+
+	Builder_Vertices = (struct VertexTextured*)Mem_TryAlloc(totalVerts + 1, sizeof(struct VertexTextured));
+	if (!Builder_Vertices) return 0;
+
+	RenderChunk(x1, y1, z1);
+	Mem_Free(Builder_Vertices);
+	return totalVerts + 1;
+}
+
+cc_uint32 Builder_BenchmarkAll(int* maxVertices) {
+	struct ChunkInfo info;
+	cc_uint32 total = 0;
+	int cx, cy, cz, verts;
+
+	*maxVertices = 0;
+	AdvCache_Begin();
+
+	for (cy = 0; cy < World.ChunksY; cy++)
+		for (cz = 0; cz < World.ChunksZ; cz++)
+			for (cx = 0; cx < World.ChunksX; cx++)
+	{
+		Mem_Set(&info, 0, sizeof(info));
+		info.centreX = (cx << CHUNK_SHIFT) + HALF_CHUNK_SIZE;
+		info.centreY = (cy << CHUNK_SHIFT) + HALF_CHUNK_SIZE;
+		info.centreZ = (cz << CHUNK_SHIFT) + HALF_CHUNK_SIZE;
+
+		verts  = Builder_BenchmarkChunk(&info);
+		total += verts;
+		*maxVertices = max(*maxVertices, verts);
+	}
+	return total;
+}
+
+
+/*########################################################################################################################*
+*------------------------------------------------Multithreaded mesh building----------------------------------------------*
+*#########################################################################################################################*/
+#ifdef CC_BUILD_BUILDERTHREADS
+#define BUILDER_MAX_THREADS 16
+#define BUILDER_MAX_JOBS    64
+
+/* A chunk whose blocks have been read on the main thread, and which needs its mesh built */
+struct BuilderJob {
+	struct ChunkInfo* info;
+	struct VertexTextured* vertices;
+	int verticesCount;
+	cc_uint32 hash;
+	cc_bool mixed;
+#ifdef CC_BUILD_ADVLIGHTING
+	struct AdvLightCache* lightCache;
+#endif
+	BlockID chunk[EXTCHUNK_SIZE_3];
+};
+
+static struct BuilderJob* builder_jobs;
+static int builder_jobsCount, builder_nextJob;
+static void* builder_mutex;
+static void* builder_doneSignal;
+static int builder_busyThreads;
+static cc_bool builder_quit;
+
+static void* builder_threads[BUILDER_MAX_THREADS];
+static void* builder_signals[BUILDER_MAX_THREADS];
+static int builder_threadsCount, builder_startedCount;
+
+/* Counts and outputs the vertices of the given job's chunk mesh into a temp buffer */
+static void MeshJob(struct BuilderJob* job) {
+	struct ChunkInfo* info = job->info;
+	int x1 = info->centreX - 8, y1 = info->centreY - 8, z1 = info->centreZ - 8;
+	int totalVerts;
+
+	Builder_Chunk = job->chunk;
+	Builder_MixedChunk = job->mixed;
+	Builder_PrePrepareChunk();
+#ifdef CC_BUILD_ADVLIGHTING
+	adv_cache = job->lightCache;
+	adv_cacheValidated = false;
+#endif
+
+	CalcConnectivity(info);
+	totalVerts = CountChunk(x1, y1, z1);
+	job->verticesCount = totalVerts;
+	if (!totalVerts) return;
+
+	/* add an extra element to fix crashing on some GPUs */
+	Builder_Vertices = (struct VertexTextured*)Mem_TryAlloc(totalVerts + 1, sizeof(struct VertexTextured));
+	if (!Builder_Vertices) return;
+
+	OutputChunkPartsMeta(x1, y1, z1, info);
+	RenderChunk(x1, y1, z1);
+#ifndef CC_BUILD_GL11
+	if (MapRenderer_CompactVertices) PackVertices(Builder_Vertices, totalVerts, x1, y1, z1);
+#endif
+
+	job->vertices      = Builder_Vertices;
+	job->verticesCount = totalVerts + 1;
+}
+
+/* Builds the meshes of jobs in the current batch, until there are no jobs left */
+static void RunJobs(void) {
+	cc_uint8 counts[CHUNK_SIZE_3 * FACE_COUNT];
+	struct Builder1DPart parts[ATLAS1D_MAX_ATLASES * 2];
+#ifdef CC_BUILD_ADVLIGHTING
+	int bitFlags[EXTCHUNK_SIZE_3];
+#else
+	int bitFlags[1];
+#endif
+	int i;
+
+	Builder_Counts   = counts;
+	Builder_BitFlags = bitFlags;
+	Builder_Parts    = parts;
+
+	for (;;) {
+		Mutex_Lock(builder_mutex);
+		i = builder_nextJob++;
+		Mutex_Unlock(builder_mutex);
+
+		if (i >= builder_jobsCount) return;
+		Tracer_Begin("Builder_MakeChunk");
+		MeshJob(&builder_jobs[i]);
+		Tracer_End();
+	}
+}
+
+static void WorkerLoop(void) {
+	cc_bool done;
+	void* signal;
+
+	Mutex_Lock(builder_mutex);
+	signal = builder_signals[builder_startedCount++];
+	Mutex_Unlock(builder_mutex);
+
+	for (;;) {
+		Waitable_Wait(signal);
+		if (builder_quit) return;
+		RunJobs();
+
+		Mutex_Lock(builder_mutex);
+		done = --builder_busyThreads == 0;
+		Mutex_Unlock(builder_mutex);
+		if (done) Waitable_Signal(builder_doneSignal);
+	}
+}
+
+/* Builds the meshes of all jobs in the current batch, using the main thread and worker threads */
+static void RunBatch(void) {
+	int i, count = min(builder_threadsCount, builder_jobsCount - 1);
+	cc_bool busy;
+
+	Mutex_Lock(builder_mutex);
+	builder_nextJob     = 0;
+	builder_busyThreads = count;
+	Mutex_Unlock(builder_mutex);
+
+	for (i = 0; i < count; i++) Waitable_Signal(builder_signals[i]);
+	RunJobs();
+
+	for (;;) {
+		Mutex_Lock(builder_mutex);
+		busy = builder_busyThreads > 0;
+		Mutex_Unlock(builder_mutex);
+
+		if (!busy) break;
+		Waitable_Wait(builder_doneSignal);
+	}
+}
+
+/* Uploads the vertices of the given job's chunk mesh to the GPU */
+static void UploadJob(struct BuilderJob* job) {
+	struct ChunkInfo* info = job->info;
+	/* Meshes with no vertices are still cached, to avoid needing to count them again */
+	if (!job->vertices) {
+		if (!job->verticesCount) MeshCache_Store(info, job->hash, NULL, 0);
+		return;
+	}
+
+#ifdef CC_BUILD_GL11
+	Builder_Vertices = job->vertices;
+	BuildChunkVbs(info->centreX - 8, info->centreY - 8, info->centreZ - 8);
+	Mem_Free(job->vertices);
+#else
+	UploadChunkVb(info, job->vertices, job->verticesCount);
+	MeshCache_Store(info, job->hash, job->vertices, job->verticesCount);
 #endif
 }
 
+void Builder_MakeChunks(struct ChunkInfo** chunks, int count) {
+	struct BuilderJob* job;
+	struct ChunkInfo* info;
+	int i = 0, j;
+	MeshCache_Begin();
+	AdvCache_Begin();
+
+	if (!builder_threadsCount) {
+		for (; i < count; i++) Builder_MakeChunk(chunks[i]);
+		return;
+	}
+
+	while (i < count) {
+		/* Blocks are read and lighting is calculated on the main thread, */
+		/*  as lighting state is lazily calculated and so not thread safe */
+		for (builder_jobsCount = 0; i < count && builder_jobsCount < BUILDER_MAX_JOBS; i++) {
+			job  = &builder_jobs[builder_jobsCount];
+			info = chunks[i];
+
+			Builder_Chunk = job->chunk;
+			if (!ReadChunk(info, info->centreX - 8, info->centreY - 8, info->centreZ - 8)) continue;
+			if (MeshCache_Restore(info, info->centreX - 8, info->centreY - 8, info->centreZ - 8, &job->hash)) continue;
+
+			job->info     = info;
+			job->vertices = NULL;
+			job->mixed    = Builder_MixedChunk;
+#ifdef CC_BUILD_ADVLIGHTING
+			job->lightCache = AdvCache_Acquire(info->centreX - 8, info->centreY - 8, info->centreZ - 8);
+#endif
+			builder_jobsCount++;
+		}
+		if (!builder_jobsCount) continue;
+
+		RunBatch();
+		for (j = 0; j < builder_jobsCount; j++) UploadJob(&builder_jobs[j]);
+	}
+}
+
+static void InitThreads(void) {
+	int i;
+	builder_threadsCount = Options_GetInt(OPT_BUILDER_THREADS, 0, BUILDER_MAX_THREADS, 3);
+	if (!builder_threadsCount) return;
+
+	builder_jobs = (struct BuilderJob*)Mem_Alloc(BUILDER_MAX_JOBS, sizeof(struct BuilderJob), "builder jobs");
+	builder_mutex      = Mutex_Create("Builder jobs");
+	builder_doneSignal = Waitable_Create("Builder done");
+
+	for (i = 0; i < builder_threadsCount; i++) {
+		builder_signals[i] = Waitable_Create("Builder worker");
+	}
+	for (i = 0; i < builder_threadsCount; i++) {
+		Thread_Run(&builder_threads[i], WorkerLoop, 256 * 1024, "Chunk builder");
+	}
+}
+
+static void FreeThreads(void) {
+	int i;
+	if (!builder_threadsCount) return;
+	builder_quit = true;
+
+	for (i = 0; i < builder_threadsCount; i++) {
+		Waitable_Signal(builder_signals[i]);
+		Thread_Join(builder_threads[i]);
+		Waitable_Free(builder_signals[i]);
+	}
+
+	Waitable_Free(builder_doneSignal);
+	Mutex_Free(builder_mutex);
+	Mem_Free(builder_jobs);
+	builder_threadsCount = 0;
+}
+#else
+void Builder_MakeChunks(struct ChunkInfo** chunks, int count) {
+	int i;
+	MeshCache_Begin();
+	AdvCache_Begin();
+	for (i = 0; i < count; i++) Builder_MakeChunk(chunks[i]);
+}
+
+static void InitThreads(void) { }
+static void FreeThreads(void) { }
+#endif
+
 static cc_bool Builder_OccludedLiquid(int chunkIndex) {
 	chunkIndex += EXTCHUNK_SIZE_2; /* Checking y above */
 	return
@@ -471,7 +1439,7 @@ static cc_bool Builder_OccludedLiquid(int chunkIndex) {
 }
 
 static void DefaultPrePrepateChunk(void) {
-	Mem_Set(Builder_Parts, 0, sizeof(Builder_Parts));
+	Mem_Set(Builder_Parts, 0, BUILDER_PARTS_SIZE);
 }
 
 static void DefaultPostStretchChunk(void) {
@@ -485,7 +1453,7 @@ static void DefaultPostStretchChunk(void) {
 	}
 }
 
-static RNGState spriteRng;
+static CC_THREADLOCAL RNGState spriteRng;
 static void Builder_DrawSprite(int x, int y, int z) {
 	struct Builder1DPart* part;
 	struct VertexTextured* v;
@@ -506,7 +1474,7 @@ static void Builder_DrawSprite(int x, int y, int z) {
 #define s_u1 0.0f
 #define s_u2 UV2_Scale
 	loc = Block_Tex(Builder_Block, FACE_XMAX);
-	v1  = Atlas1D_RowId(loc) * Atlas1D.InvTileSize;
+	v1  = Atlas1D_TileV(loc, MapRenderer_TextureArray);
 	v2  = v1 + Atlas1D.InvTileSize * UV2_Scale;
 
 	offsetType = Blocks.SpriteOffset[Builder_Block];
@@ -522,7 +1490,7 @@ static void Builder_DrawSprite(int x, int y, int z) {
 	}
 	
 	bright = Blocks.Brightness[Builder_Block];
-	part   = &Builder_Parts[Atlas1D_Index(loc)];
+	part   = &Builder_Parts[Builder_AtlasIndex(loc)];
 	color  = bright ? PACKEDCOL_WHITE : Lighting.Color_Sprite_Fast(x, y, z);
 	Block_Tint(color, Builder_Block);
 
@@ -566,13 +1534,13 @@ static PackedCol Normal_LightColor(int x, int y, int z, Face face, BlockID block
 
 	switch (face) {
 	case FACE_XMIN:
-		return x < offset                ? Env.SunXSide : Lighting.Color_XSide_Fast(x - offset, y, z);
+		return x < offset                ? Lighting_MeshCols.SunXSide : Lighting.Color_XSide_Fast(x - offset, y, z);
 	case FACE_XMAX:
-		return x > (World.MaxX - offset) ? Env.SunXSide : Lighting.Color_XSide_Fast(x + offset, y, z);
+		return x > (World.MaxX - offset) ? Lighting_MeshCols.SunXSide : Lighting.Color_XSide_Fast(x + offset, y, z);
 	case FACE_ZMIN:
-		return z < offset                ? Env.SunZSide : Lighting.Color_ZSide_Fast(x, y, z - offset);
+		return z < offset                ? Lighting_MeshCols.SunZSide : Lighting.Color_ZSide_Fast(x, y, z - offset);
 	case FACE_ZMAX:
-		return z > (World.MaxZ - offset) ? Env.SunZSide : Lighting.Color_ZSide_Fast(x, y, z + offset);
+		return z > (World.MaxZ - offset) ? Lighting_MeshCols.SunZSide : Lighting.Color_ZSide_Fast(x, y, z + offset);
 
 	case FACE_YMIN:
 		return Lighting.Color_YMin_Fast(x, y - offset, z);		
@@ -652,21 +1620,137 @@ static int NormalBuilder_StretchZ(int countIndex, int x, int y, int z, int chunk
 	return count;
 }
 
+/* Faces can only be merged across rows when the 1D atlas has one tile, as otherwise */
+/*  the V texture coordinate would bleed into the next tile instead of wrapping around */
+#define Greedy_Supported() (Atlas1D.TilesPerAtlas == 1)
+
+static cc_bool Greedy_CoversY(BlockID b) {
+	return Blocks.MinBB[b].y == 0.0f       && Blocks.MaxBB[b].y == 1.0f
+		&& Blocks.RenderMinBB[b].y == 0.0f && Blocks.RenderMaxBB[b].y == 1.0f;
+}
+
+static cc_bool Greedy_CoversZ(BlockID b) {
+	return Blocks.MinBB[b].z == 0.0f       && Blocks.MaxBB[b].z == 1.0f
+		&& Blocks.RenderMinBB[b].z == 0.0f && Blocks.RenderMaxBB[b].z == 1.0f;
+}
+
+/* Merges the faces in following rows into the given face, when they have the same length, block and light */
+/* Rows are along the Y axis for side faces, and along the Z axis for top/bottom faces */
+static void Greedy_MergeFace(int index, int cIndex, int x, int y, int z, Face face, int rowsLeft) {
+	BlockID block = Builder_Chunk[cIndex];
+	int count = Builder_Counts[index];
+	int baseOffset, countStride, chunkStride, dy = 0, dz = 0;
+	struct Builder1DPart* part;
+	PackedCol col;
+
+	if (!count || count == FACE_MERGED || rowsLeft <= 0) return;
+	if (!(Blocks.CanStretch[block] & (1 << face))) return;
+
+	if (face == FACE_YMIN || face == FACE_YMAX) {
+		if (!Greedy_CoversZ(block)) return;
+		countStride = CHUNK_SIZE * FACE_COUNT;
+		chunkStride = EXTCHUNK_SIZE; dz = 1;
+	} else {
+		if (!Greedy_CoversY(block)) return;
+		countStride = CHUNK_SIZE_2 * FACE_COUNT;
+		chunkStride = EXTCHUNK_SIZE_2; dy = 1;
+	}
+
+	baseOffset = (Blocks.Draw[block] == DRAW_TRANSLUCENT) * ATLAS1D_MAX_ATLASES;
+	part = &Builder_Parts[baseOffset + Builder_AtlasIndex(Block_Tex(block, face))];
+	col  = Normal_LightColor(x, y, z, face, block);
+
+	for (; rowsLeft > 0; rowsLeft--) {
+		index += countStride; cIndex += chunkStride;
+		y     += dy;          z      += dz;
+
+		if (Builder_Counts[index] != count || Builder_Chunk[cIndex] != block) return;
+		if (!Blocks.Brightness[block] && Normal_LightColor(x, y, z, face, block) != col) return;
+
+		Builder_Counts[index] = FACE_MERGED;
+		part->faces.count[face] -= 4;
+		Builder_MergedRows = true;
+	}
+}
+
+/* Merges faces stretched along one axis by PrepareChunk into faces spanning two axes */
+static void Greedy_MergeChunk(int x1, int y1, int z1) {
+	int xMax = min(World.Width,  x1 + CHUNK_SIZE);
+	int yMax = min(World.Height, y1 + CHUNK_SIZE);
+	int zMax = min(World.Length, z1 + CHUNK_SIZE);
+	int cIndex, index;
+	int x, y, z, xx, yy, zz;
+	BlockID b;
+
+	Builder_MergedRows = false;
+	if (!Greedy_Supported()) return;
+
+	for (y = y1, yy = 0; y < yMax; y++, yy++) {
+		for (z = z1, zz = 0; z < zMax; z++, zz++) {
+			cIndex = Builder_PackChunk(0, yy, zz);
+
+			for (x = x1, xx = 0; x < xMax; x++, xx++, cIndex++) {
+				b = Builder_Chunk[cIndex];
+				if (Blocks.Draw[b] == DRAW_GAS || Blocks.Draw[b] == DRAW_SPRITE) continue;
+				index = Builder_PackCount(xx, yy, zz);
+
+				Greedy_MergeFace(index + FACE_XMIN, cIndex, x, y, z, FACE_XMIN, yMax - y - 1);
+				Greedy_MergeFace(index + FACE_XMAX, cIndex, x, y, z, FACE_XMAX, yMax - y - 1);
+				Greedy_MergeFace(index + FACE_ZMIN, cIndex, x, y, z, FACE_ZMIN, yMax - y - 1);
+				Greedy_MergeFace(index + FACE_ZMAX, cIndex, x, y, z, FACE_ZMAX, yMax - y - 1);
+				Greedy_MergeFace(index + FACE_YMIN, cIndex, x, y, z, FACE_YMIN, zMax - z - 1);
+				Greedy_MergeFace(index + FACE_YMAX, cIndex, x, y, z, FACE_YMAX, zMax - z - 1);
+			}
+		}
+	}
+}
+
+/* Returns the number of rows that the given face was merged across */
+static int Greedy_RowsCount(int index, int stride, int rowsLeft) {
+	int rows = 1;
+	if (!Builder_MergedRows) return 1;
+
+	for (index += stride; rowsLeft > 0 && Builder_Counts[index] == FACE_MERGED; index += stride, rowsLeft--) {
+		rows++;
+	}
+	return rows;
+}
+
+/* Extends the top edge of a side face's vertices upwards, so the face covers the given number of rows */
+static void Greedy_ExtendY(struct VertexTextured* v, float y2, int rows) {
+	int i;
+	for (i = 0; i < 4; i++, v++) {
+		if (v->y != y2) continue;
+		v->y += rows - 1; v->V -= (rows - 1) * Atlas1D.InvTileSize;
+	}
+}
+
+/* Extends the far edge of a top/bottom face's vertices along Z, so the face covers the given number of rows */
+static void Greedy_ExtendZ(struct VertexTextured* v, float z2, int rows) {
+	int i;
+	for (i = 0; i < 4; i++, v++) {
+		if (v->z != z2) continue;
+		v->z += rows - 1; v->V += (rows - 1) * Atlas1D.InvTileSize;
+	}
+}
+
 static void NormalBuilder_RenderBlock(int index, int x, int y, int z) {	
 	/* counters */
 	int count_XMin, count_XMax, count_ZMin;
 	int count_ZMax, count_YMin, count_YMax;
 
 	/* block state */
+	struct _DrawerData drawer;
 	Vec3 min, max;
 	int baseOffset, lightFlags;
 	cc_bool fullBright;
 
 	/* per-face state */
 	struct Builder1DPart* part;
+	struct VertexTextured* v;
 	TextureLoc loc;
 	PackedCol col;
-	int offset;
+	int offset, rows;
 
 	if (Blocks.Draw[Builder_Block] == DRAW_SPRITE) {
 		Builder_DrawSprite(x, y, z); return;
@@ -679,6 +1763,15 @@ static void NormalBuilder_RenderBlock(int index, int x, int y, int z) {
 	count_YMin = Builder_Counts[index + FACE_YMIN];
 	count_YMax = Builder_Counts[index + FACE_YMAX];
 
+	if (Builder_MergedRows) {
+		if (count_XMin == FACE_MERGED) count_XMin = 0;
+		if (count_XMax == FACE_MERGED) count_XMax = 0;
+		if (count_ZMin == FACE_MERGED) count_ZMin = 0;
+		if (count_ZMax == FACE_MERGED) count_ZMax = 0;
+		if (count_YMin == FACE_MERGED) count_YMin = 0;
+		if (count_YMax == FACE_MERGED) count_YMax = 0;
+	}
+
 	if (!count_XMin && !count_XMax && !count_ZMin &&
 		!count_ZMax && !count_YMin && !count_YMax) return;
 
@@ -686,76 +1779,104 @@ static void NormalBuilder_RenderBlock(int index, int x, int y, int z) {
 	baseOffset = (Blocks.Draw[Builder_Block] == DRAW_TRANSLUCENT) * ATLAS1D_MAX_ATLASES;
 	lightFlags = Blocks.LightOffset[Builder_Block];
 
-	Drawer.MinBB = Blocks.MinBB[Builder_Block]; Drawer.MinBB.y = 1.0f - Drawer.MinBB.y;
-	Drawer.MaxBB = Blocks.MaxBB[Builder_Block]; Drawer.MaxBB.y = 1.0f - Drawer.MaxBB.y;
+	drawer.MinBB = Blocks.MinBB[Builder_Block]; drawer.MinBB.y = 1.0f - drawer.MinBB.y;
+	drawer.MaxBB = Blocks.MaxBB[Builder_Block]; drawer.MaxBB.y = 1.0f - drawer.MaxBB.y;
 
 	min = Blocks.RenderMinBB[Builder_Block]; max = Blocks.RenderMaxBB[Builder_Block];
-	Drawer.X1 = x + min.x; Drawer.Y1 = y + min.y; Drawer.Z1 = z + min.z;
-	Drawer.X2 = x + max.x; Drawer.Y2 = y + max.y; Drawer.Z2 = z + max.z;
+	drawer.X1 = x + min.x; drawer.Y1 = y + min.y; drawer.Z1 = z + min.z;
+	drawer.X2 = x + max.x; drawer.Y2 = y + max.y; drawer.Z2 = z + max.z;
 
-	Drawer.Tinted  = Blocks.Tinted[Builder_Block];
-	Drawer.TintCol = Blocks.FogCol[Builder_Block];
+	drawer.Tinted  = Blocks.Tinted[Builder_Block];
+	drawer.Layered = MapRenderer_TextureArray;
+	drawer.TintCol = Blocks.FogCol[Builder_Block];
 
 	if (count_XMin) {
 		loc    = Block_Tex(Builder_Block, FACE_XMIN);
 		offset = (lightFlags >> FACE_XMIN) & 1;
-		part   = &Builder_Parts[baseOffset + Atlas1D_Index(loc)];
+		part   = &Builder_Parts[baseOffset + Builder_AtlasIndex(loc)];
 
 		col = fullBright ? PACKEDCOL_WHITE :
-			x >= offset ? Lighting.Color_XSide_Fast(x - offset, y, z) : Env.SunXSide;
-		Drawer_XMin(count_XMin, col, loc, &part->faces.vertices[FACE_XMIN]);
+			x >= offset ? Lighting.Color_XSide_Fast(x - offset, y, z) : Lighting_MeshCols.SunXSide;
+		v = part->faces.vertices[FACE_XMIN];
+		Drawer_XMinEx(&drawer, count_XMin, col, loc, &part->faces.vertices[FACE_XMIN]);
+
+		rows = Greedy_RowsCount(index + FACE_XMIN, CHUNK_SIZE_2 * FACE_COUNT, CHUNK_MASK - (y & CHUNK_MASK));
+		if (rows > 1) Greedy_ExtendY(v, drawer.Y2, rows);
 	}
 
 	if (count_XMax) {
 		loc    = Block_Tex(Builder_Block, FACE_XMAX);
 		offset = (lightFlags >> FACE_XMAX) & 1;
-		part   = &Builder_Parts[baseOffset + Atlas1D_Index(loc)];
+		part   = &Builder_Parts[baseOffset + Builder_AtlasIndex(loc)];
 
 		col = fullBright ? PACKEDCOL_WHITE :
-			x <= (World.MaxX - offset) ? Lighting.Color_XSide_Fast(x + offset, y, z) : Env.SunXSide;
-		Drawer_XMax(count_XMax, col, loc, &part->faces.vertices[FACE_XMAX]);
+			x <= (World.MaxX - offset) ? Lighting.Color_XSide_Fast(x + offset, y, z) : Lighting_MeshCols.SunXSide;
+		v = part->faces.vertices[FACE_XMAX];
+		Drawer_XMaxEx(&drawer, count_XMax, col, loc, &part->faces.vertices[FACE_XMAX]);
+
+		rows = Greedy_RowsCount(index + FACE_XMAX, CHUNK_SIZE_2 * FACE_COUNT, CHUNK_MASK - (y & CHUNK_MASK));
+		if (rows > 1) Greedy_ExtendY(v, drawer.Y2, rows);
 	}
 
 	if (count_ZMin) {
 		loc    = Block_Tex(Builder_Block, FACE_ZMIN);
 		offset = (lightFlags >> FACE_ZMIN) & 1;
-		part   = &Builder_Parts[baseOffset + Atlas1D_Index(loc)];
+		part   = &Builder_Parts[baseOffset + Builder_AtlasIndex(loc)];
 
 		col = fullBright ? PACKEDCOL_WHITE :
-			z >= offset ? Lighting.Color_ZSide_Fast(x, y, z - offset) : Env.SunZSide;
-		Drawer_ZMin(count_ZMin, col, loc, &part->faces.vertices[FACE_ZMIN]);
+			z >= offset ? Lighting.Color_ZSide_Fast(x, y, z - offset) : Lighting_MeshCols.SunZSide;
+		v = part->faces.vertices[FACE_ZMIN];
+		Drawer_ZMinEx(&drawer, count_ZMin, col, loc, &part->faces.vertices[FACE_ZMIN]);
+
+		rows = Greedy_RowsCount(index + FACE_ZMIN, CHUNK_SIZE_2 * FACE_COUNT, CHUNK_MASK - (y & CHUNK_MASK));
+		if (rows > 1) Greedy_ExtendY(v, drawer.Y2, rows);
 	}
 
 	if (count_ZMax) {
 		loc    = Block_Tex(Builder_Block, FACE_ZMAX);
 		offset = (lightFlags >> FACE_ZMAX) & 1;
-		part   = &Builder_Parts[baseOffset + Atlas1D_Index(loc)];
+		part   = &Builder_Parts[baseOffset + Builder_AtlasIndex(loc)];
 
 		col = fullBright ? PACKEDCOL_WHITE :
-			z <= (World.MaxZ - offset) ? Lighting.Color_ZSide_Fast(x, y, z + offset) : Env.SunZSide;
-		Drawer_ZMax(count_ZMax, col, loc, &part->faces.vertices[FACE_ZMAX]);
+			z <= (World.MaxZ - offset) ? Lighting.Color_ZSide_Fast(x, y, z + offset) : Lighting_MeshCols.SunZSide;
+		v = part->faces.vertices[FACE_ZMAX];
+		Drawer_ZMaxEx(&drawer, count_ZMax, col, loc, &part->faces.vertices[FACE_ZMAX]);
+
+		rows = Greedy_RowsCount(index + FACE_ZMAX, CHUNK_SIZE_2 * FACE_COUNT, CHUNK_MASK - (y & CHUNK_MASK));
+		if (rows > 1) Greedy_ExtendY(v, drawer.Y2, rows);
 	}
 
 	if (count_YMin) {
 		loc    = Block_Tex(Builder_Block, FACE_YMIN);
 		offset = (lightFlags >> FACE_YMIN) & 1;
-		part   = &Builder_Parts[baseOffset + Atlas1D_Index(loc)];
+		part   = &Builder_Parts[baseOffset + Builder_AtlasIndex(loc)];
 
 		col = fullBright ? PACKEDCOL_WHITE : Lighting.Color_YMin_Fast(x, y - offset, z);
-		Drawer_YMin(count_YMin, col, loc, &part->faces.vertices[FACE_YMIN]);
+		v = part->faces.vertices[FACE_YMIN];
+		Drawer_YMinEx(&drawer, count_YMin, col, loc, &part->faces.vertices[FACE_YMIN]);
+
+		rows = Greedy_RowsCount(index + FACE_YMIN, CHUNK_SIZE * FACE_COUNT, CHUNK_MASK - (z & CHUNK_MASK));
+		if (rows > 1) Greedy_ExtendZ(v, drawer.Z2, rows);
 	}
 
 	if (count_YMax) {
 		loc    = Block_Tex(Builder_Block, FACE_YMAX);
 		offset = (lightFlags >> FACE_YMAX) & 1;
-		part   = &Builder_Parts[baseOffset + Atlas1D_Index(loc)];
+		part   = &Builder_Parts[baseOffset + Builder_AtlasIndex(loc)];
 
 		col = fullBright ? PACKEDCOL_WHITE : Lighting.Color_YMax_Fast(x, y + offset, z);
-		Drawer_YMax(count_YMax, col, loc, &part->faces.vertices[FACE_YMAX]);
+		v = part->faces.vertices[FACE_YMAX];
+		Drawer_YMaxEx(&drawer, count_YMax, col, loc, &part->faces.vertices[FACE_YMAX]);
+
+		rows = Greedy_RowsCount(index + FACE_YMAX, CHUNK_SIZE * FACE_COUNT, CHUNK_MASK - (z & CHUNK_MASK));
+		if (rows > 1) Greedy_ExtendZ(v, drawer.Z2, rows);
 	}
 }
 
 static void Builder_SetDefault(void) {
+#ifdef CC_BUILD_ADVLIGHTING
+	advCacheActive = false;
+#endif
 	Builder_StretchXLiquid = NULL;
 	Builder_StretchX       = NULL;
 	Builder_StretchZ       = NULL;
@@ -763,6 +1884,7 @@ static void Builder_SetDefault(void) {
 
 	Builder_PrePrepareChunk  = DefaultPrePrepateChunk;
 	Builder_PostPrepareChunk = DefaultPostStretchChunk;
+	Builder_MergeChunk       = NULL;
 }
 
 static void NormalBuilder_SetActive(void) {
@@ -771,6 +1893,7 @@ static void NormalBuilder_SetActive(void) {
 	Builder_StretchX       = NormalBuilder_StretchX;
 	Builder_StretchZ       = NormalBuilder_StretchZ;
 	Builder_RenderBlock    = NormalBuilder_RenderBlock;
+	Builder_MergeChunk     = Greedy_MergeChunk;
 }
 
 
@@ -778,12 +1901,12 @@ static void NormalBuilder_SetActive(void) {
 *-------------------------------------------------Advanced mesh builder---------------------------------------------------*
 *#########################################################################################################################*/
 #ifdef CC_BUILD_ADVLIGHTING
-static Vec3 adv_minBB, adv_maxBB;
-static int adv_initBitFlags, adv_baseOffset;
-static int* adv_bitFlags;
-static float adv_x1, adv_y1, adv_z1, adv_x2, adv_y2, adv_z2;
-static PackedCol adv_lerp[5], adv_lerpX[5], adv_lerpZ[5], adv_lerpY[5];
-static cc_bool adv_tinted;
+static CC_THREADLOCAL Vec3 adv_minBB, adv_maxBB;
+static CC_THREADLOCAL int adv_initBitFlags, adv_baseOffset;
+static CC_THREADLOCAL int* adv_bitFlags;
+static CC_THREADLOCAL float adv_x1, adv_y1, adv_z1, adv_x2, adv_y2, adv_z2;
+static CC_THREADLOCAL PackedCol adv_lerp[5], adv_lerpX[5], adv_lerpZ[5], adv_lerpY[5];
+static CC_THREADLOCAL cc_bool adv_tinted;
 
 enum ADV_MASK {
 	/* z-1 cube points */
@@ -845,8 +1968,6 @@ static int Adv_Lit(int x, int y, int z, int cIndex) {
 }
 
 static int Adv_ComputeLightFlags(int x, int y, int z, int cIndex) {
-	if (Builder_FullBright) return (1 << xP1_yP1_zP1) - 1; /* all faces fully bright */
-
 	return
 		Adv_Lit(x - 1, y, z - 1, cIndex - 1 - 18) << xM1_yM1_zM1 |
 		Adv_Lit(x - 1, y, z,     cIndex - 1)      << xM1_yM1_zCC |
@@ -859,6 +1980,25 @@ static int Adv_ComputeLightFlags(int x, int y, int z, int cIndex) {
 		Adv_Lit(x + 1, y, z + 1, cIndex + 1 + 18) << xP1_yM1_zP1;
 }
 
+/* Returns the light flags of the given block, reusing the flags from when the chunk was last built if possible */
+static int Adv_LightFlags(int x, int y, int z, int cIndex) {
+	int flags;
+	if (Builder_FullBright) return (1 << xP1_yP1_zP1) - 1; /* all faces fully bright */
+	if (!adv_cache) return Adv_ComputeLightFlags(x, y, z, cIndex);
+
+	if (!adv_cacheValidated) {
+		AdvCache_Validate(adv_cache);
+		adv_cacheValidated = true;
+	}
+
+	flags = adv_cache->flags[cIndex];
+	if (flags != ADVCACHE_UNCALCULATED) return flags;
+
+	flags = Adv_ComputeLightFlags(x, y, z, cIndex);
+	adv_cache->flags[cIndex] = flags;
+	return flags;
+}
+
 static int adv_masks[FACE_COUNT] = {
 	/* XMin face */
 	(1 << xM1_yM1_zM1) | (1 << xM1_yM1_zCC) | (1 << xM1_yM1_zP1) |
@@ -889,7 +2029,7 @@ static int adv_masks[FACE_COUNT] = {
 
 static cc_bool Adv_CanStretch(BlockID initial, int chunkIndex, int x, int y, int z, Face face) {
 	BlockID cur = Builder_Chunk[chunkIndex];
-	adv_bitFlags[chunkIndex] = Adv_ComputeLightFlags(x, y, z, chunkIndex);
+	adv_bitFlags[chunkIndex] = Adv_LightFlags(x, y, z, chunkIndex);
 
 	return cur == initial
 		&& !Block_IsFaceHidden(cur, Builder_Chunk[chunkIndex + Builder_Offsets[face]], face)
@@ -901,7 +2041,7 @@ static cc_bool Adv_CanStretch(BlockID initial, int chunkIndex, int x, int y, int
 static int Adv_StretchXLiquid(int countIndex, int x, int y, int z, int chunkIndex, BlockID block) {
 	int count = 1; cc_bool stretchTile;
 	if (Builder_OccludedLiquid(chunkIndex)) return 0;
-	adv_initBitFlags = Adv_ComputeLightFlags(x, y, z, chunkIndex);
+	adv_initBitFlags = Adv_LightFlags(x, y, z, chunkIndex);
 	adv_bitFlags[chunkIndex] = adv_initBitFlags;
 
 	x++;
@@ -922,7 +2062,7 @@ static int Adv_StretchXLiquid(int countIndex, int x, int y, int z, int chunkInde
 
 static int Adv_StretchX(int countIndex, int x, int y, int z, int chunkIndex, BlockID block, Face face) {
 	int count = 1; cc_bool stretchTile;
-	adv_initBitFlags = Adv_ComputeLightFlags(x, y, z, chunkIndex);
+	adv_initBitFlags = Adv_LightFlags(x, y, z, chunkIndex);
 	adv_bitFlags[chunkIndex] = adv_initBitFlags;
 	
 	x++;
@@ -943,7 +2083,7 @@ static int Adv_StretchX(int countIndex, int x, int y, int z, int chunkIndex, Blo
 
 static int Adv_StretchZ(int countIndex, int x, int y, int z, int chunkIndex, BlockID block, Face face) {
 	int count = 1; cc_bool stretchTile;
-	adv_initBitFlags = Adv_ComputeLightFlags(x, y, z, chunkIndex);
+	adv_initBitFlags = Adv_LightFlags(x, y, z, chunkIndex);
 	adv_bitFlags[chunkIndex] = adv_initBitFlags;
 
 	z++;
@@ -967,12 +2107,12 @@ static int Adv_StretchZ(int countIndex, int x, int y, int z, int chunkIndex, Blo
 
 static void Adv_DrawXMin(int count) {
 	TextureLoc texLoc = Block_Tex(Builder_Block, FACE_XMIN);
-	float vOrigin = Atlas1D_RowId(texLoc) * Atlas1D.InvTileSize;
+	float vOrigin = Atlas1D_TileV(texLoc, MapRenderer_TextureArray);
 
 	float u1 = adv_minBB.z, u2 = (count - 1) + adv_maxBB.z * UV2_Scale;
 	float v1 = vOrigin + adv_maxBB.y * Atlas1D.InvTileSize;
 	float v2 = vOrigin + adv_minBB.y * Atlas1D.InvTileSize * UV2_Scale;
-	struct Builder1DPart* part = &Builder_Parts[adv_baseOffset + Atlas1D_Index(texLoc)];
+	struct Builder1DPart* part = &Builder_Parts[adv_baseOffset + Builder_AtlasIndex(texLoc)];
 
 	int F = adv_bitFlags[Builder_ChunkIndex];
 	int aY0_Z0 = Adv_CountBits(F, xM1_yM1_zM1, xM1_yCC_zM1, xM1_yM1_zCC, xM1_yCC_zCC);
@@ -1009,12 +2149,12 @@ static void Adv_DrawXMin(int count) {
 
 static void Adv_DrawXMax(int count) {
 	TextureLoc texLoc = Block_Tex(Builder_Block, FACE_XMAX);
-	float vOrigin = Atlas1D_RowId(texLoc) * Atlas1D.InvTileSize;
+	float vOrigin = Atlas1D_TileV(texLoc, MapRenderer_TextureArray);
 
 	float u1 = (count - adv_minBB.z), u2 = (1 - adv_maxBB.z) * UV2_Scale;
 	float v1 = vOrigin + adv_maxBB.y * Atlas1D.InvTileSize;
 	float v2 = vOrigin + adv_minBB.y * Atlas1D.InvTileSize * UV2_Scale;
-	struct Builder1DPart* part = &Builder_Parts[adv_baseOffset + Atlas1D_Index(texLoc)];
+	struct Builder1DPart* part = &Builder_Parts[adv_baseOffset + Builder_AtlasIndex(texLoc)];
 
 	int F = adv_bitFlags[Builder_ChunkIndex];
 	int aY0_Z0 = Adv_CountBits(F, xP1_yM1_zM1, xP1_yCC_zM1, xP1_yM1_zCC, xP1_yCC_zCC);
@@ -1051,12 +2191,12 @@ static void Adv_DrawXMax(int count) {
 
 static void Adv_DrawZMin(int count) {
 	TextureLoc texLoc = Block_Tex(Builder_Block, FACE_ZMIN);
-	float vOrigin = Atlas1D_RowId(texLoc) * Atlas1D.InvTileSize;
+	float vOrigin = Atlas1D_TileV(texLoc, MapRenderer_TextureArray);
 
 	float u1 = (count - adv_minBB.x), u2 = (1 - adv_maxBB.x) * UV2_Scale;
 	float v1 = vOrigin + adv_maxBB.y * Atlas1D.InvTileSize;
 	float v2 = vOrigin + adv_minBB.y * Atlas1D.InvTileSize * UV2_Scale;
-	struct Builder1DPart* part = &Builder_Parts[adv_baseOffset + Atlas1D_Index(texLoc)];
+	struct Builder1DPart* part = &Builder_Parts[adv_baseOffset + Builder_AtlasIndex(texLoc)];
 
 	int F = adv_bitFlags[Builder_ChunkIndex];
 	int aX0_Y0 = Adv_CountBits(F, xM1_yM1_zM1, xM1_yCC_zM1, xCC_yM1_zM1, xCC_yCC_zM1);
@@ -1093,12 +2233,12 @@ static void Adv_DrawZMin(int count) {
 
 static void Adv_DrawZMax(int count) {
 	TextureLoc texLoc = Block_Tex(Builder_Block, FACE_ZMAX);
-	float vOrigin = Atlas1D_RowId(texLoc) * Atlas1D.InvTileSize;
+	float vOrigin = Atlas1D_TileV(texLoc, MapRenderer_TextureArray);
 
 	float u1 = adv_minBB.x, u2 = (count - 1) + adv_maxBB.x * UV2_Scale;
 	float v1 = vOrigin + adv_maxBB.y * Atlas1D.InvTileSize;
 	float v2 = vOrigin + adv_minBB.y * Atlas1D.InvTileSize * UV2_Scale;
-	struct Builder1DPart* part = &Builder_Parts[adv_baseOffset + Atlas1D_Index(texLoc)];
+	struct Builder1DPart* part = &Builder_Parts[adv_baseOffset + Builder_AtlasIndex(texLoc)];
 
 	int F = adv_bitFlags[Builder_ChunkIndex];
 	int aX0_Y0 = Adv_CountBits(F, xM1_yM1_zP1, xM1_yCC_zP1, xCC_yM1_zP1, xCC_yCC_zP1);
@@ -1135,12 +2275,12 @@ static void Adv_DrawZMax(int count) {
 
 static void Adv_DrawYMin(int count) {
 	TextureLoc texLoc = Block_Tex(Builder_Block, FACE_YMIN);
-	float vOrigin = Atlas1D_RowId(texLoc) * Atlas1D.InvTileSize;
+	float vOrigin = Atlas1D_TileV(texLoc, MapRenderer_TextureArray);
 
 	float u1 = adv_minBB.x, u2 = (count - 1) + adv_maxBB.x * UV2_Scale;
 	float v1 = vOrigin + adv_minBB.z * Atlas1D.InvTileSize;
 	float v2 = vOrigin + adv_maxBB.z * Atlas1D.InvTileSize * UV2_Scale;
-	struct Builder1DPart* part = &Builder_Parts[adv_baseOffset + Atlas1D_Index(texLoc)];
+	struct Builder1DPart* part = &Builder_Parts[adv_baseOffset + Builder_AtlasIndex(texLoc)];
 
 	int F = adv_bitFlags[Builder_ChunkIndex];
 	int aX0_Z0 = Adv_CountBits(F, xM1_yM1_zM1, xM1_yM1_zCC, xCC_yM1_zM1, xCC_yM1_zCC);
@@ -1177,12 +2317,12 @@ static void Adv_DrawYMin(int count) {
 
 static void Adv_DrawYMax(int count) {
 	TextureLoc texLoc = Block_Tex(Builder_Block, FACE_YMAX);
-	float vOrigin = Atlas1D_RowId(texLoc) * Atlas1D.InvTileSize;
+	float vOrigin = Atlas1D_TileV(texLoc, MapRenderer_TextureArray);
 
 	float u1 = adv_minBB.x, u2 = (count - 1) + adv_maxBB.x * UV2_Scale;
 	float v1 = vOrigin + adv_minBB.z * Atlas1D.InvTileSize;
 	float v2 = vOrigin + adv_maxBB.z * Atlas1D.InvTileSize * UV2_Scale;
-	struct Builder1DPart* part = &Builder_Parts[adv_baseOffset + Atlas1D_Index(texLoc)];
+	struct Builder1DPart* part = &Builder_Parts[adv_baseOffset + Builder_AtlasIndex(texLoc)];
 
 	int F = adv_bitFlags[Builder_ChunkIndex];
 	int aX0_Z0 = Adv_CountBits(F, xM1_yP1_zM1, xM1_yP1_zCC, xCC_yP1_zM1, xCC_yP1_zCC);
@@ -1255,16 +2395,23 @@ static void Adv_RenderBlock(int index, int x, int y, int z) {
 	if (count_YMax) Adv_DrawYMax(count_YMax);
 }
 
+/* Unlike PackedCol_Lerp, also interpolates alpha (which selects the light when lit by Gfx_SetChunkLightColors) */
+static PackedCol Adv_LerpLight(PackedCol a, PackedCol b, float t) {
+	cc_uint8 A = (cc_uint8)Math_Lerp(PackedCol_A(a), PackedCol_A(b), t);
+	return (PackedCol_Lerp(a, b, t) & ~PACKEDCOL_A_MASK) | PackedCol_A_Bits(A);
+}
+
 static void Adv_PrePrepareChunk(void) {
+	struct _LightingMeshCols* c = &Lighting_MeshCols;
 	int i;
 	DefaultPrePrepateChunk();
 	adv_bitFlags = Builder_BitFlags;
 
 	for (i = 0; i <= 4; i++) {
-		adv_lerp[i]  = PackedCol_Lerp(Env.ShadowCol,   Env.SunCol,   i / 4.0f);
-		adv_lerpX[i] = PackedCol_Lerp(Env.ShadowXSide, Env.SunXSide, i / 4.0f);
-		adv_lerpZ[i] = PackedCol_Lerp(Env.ShadowZSide, Env.SunZSide, i / 4.0f);
-		adv_lerpY[i] = PackedCol_Lerp(Env.ShadowYMin,  Env.SunYMin,  i / 4.0f);
+		adv_lerp[i]  = Adv_LerpLight(c->Shadow,      c->Sun,      i / 4.0f);
+		adv_lerpX[i] = Adv_LerpLight(c->ShadowXSide, c->SunXSide, i / 4.0f);
+		adv_lerpZ[i] = Adv_LerpLight(c->ShadowZSide, c->SunZSide, i / 4.0f);
+		adv_lerpY[i] = Adv_LerpLight(c->ShadowYMin,  c->SunYMin,  i / 4.0f);
 	}
 }
 
@@ -1275,6 +2422,7 @@ static void AdvBuilder_SetActive(void) {
 	Builder_StretchZ        = Adv_StretchZ;
 	Builder_RenderBlock     = Adv_RenderBlock;
 	Builder_PrePrepareChunk = Adv_PrePrepareChunk;
+	advCacheActive          = true;
 }
 #else
 static void AdvBuilder_SetActive(void) { NormalBuilder_SetActive(); }
@@ -1337,12 +2485,12 @@ static PackedCol Modern_GetColorX(PackedCol orig, int x, int y, int z, int oY, i
 }
 static void Modern_DrawXMin(int count, int x, int y, int z) {
 	TextureLoc texLoc = Block_Tex(Builder_Block, FACE_XMIN);
-	float vOrigin = Atlas1D_RowId(texLoc) * Atlas1D.InvTileSize;
+	float vOrigin = Atlas1D_TileV(texLoc, MapRenderer_TextureArray);
 
 	float u1 = adv_minBB.z, u2 = (count - 1) + adv_maxBB.z * UV2_Scale;
 	float v1 = vOrigin + adv_maxBB.y * Atlas1D.InvTileSize;
 	float v2 = vOrigin + adv_minBB.y * Atlas1D.InvTileSize * UV2_Scale;
-	struct Builder1DPart* part = &Builder_Parts[adv_baseOffset + Atlas1D_Index(texLoc)];
+	struct Builder1DPart* part = &Builder_Parts[adv_baseOffset + Builder_AtlasIndex(texLoc)];
 
 	PackedCol tint, white = PACKEDCOL_WHITE;
 	int offset = 1;// (Blocks.LightOffset[Builder_Block] >> FACE_XMIN) & 1;
@@ -1370,12 +2518,12 @@ static void Modern_DrawXMin(int count, int x, int y, int z) {
 
 static void Modern_DrawXMax(int count, int x, int y, int z) {
 	TextureLoc texLoc = Block_Tex(Builder_Block, FACE_XMAX);
-	float vOrigin = Atlas1D_RowId(texLoc) * Atlas1D.InvTileSize;
+	float vOrigin = Atlas1D_TileV(texLoc, MapRenderer_TextureArray);
 
 	float u1 = (count - adv_minBB.z), u2 = (1 - adv_maxBB.z) * UV2_Scale;
 	float v1 = vOrigin + adv_maxBB.y * Atlas1D.InvTileSize;
 	float v2 = vOrigin + adv_minBB.y * Atlas1D.InvTileSize * UV2_Scale;
-	struct Builder1DPart* part = &Builder_Parts[adv_baseOffset + Atlas1D_Index(texLoc)];
+	struct Builder1DPart* part = &Builder_Parts[adv_baseOffset + Builder_AtlasIndex(texLoc)];
 
 	PackedCol tint, white = PACKEDCOL_WHITE;
 	int offset = 1;// (Blocks.LightOffset[Builder_Block] >> FACE_XMAX) & 1;
@@ -1416,12 +2564,12 @@ static PackedCol Modern_GetColorZ(PackedCol orig, int x, int y, int z, int oX, i
 }
 static void Modern_DrawZMin(int count, int x, int y, int z) {
 	TextureLoc texLoc = Block_Tex(Builder_Block, FACE_ZMIN);
-	float vOrigin = Atlas1D_RowId(texLoc) * Atlas1D.InvTileSize;
+	float vOrigin = Atlas1D_TileV(texLoc, MapRenderer_TextureArray);
 
 	float u1 = (count - adv_minBB.x), u2 = (1 - adv_maxBB.x) * UV2_Scale;
 	float v1 = vOrigin + adv_maxBB.y * Atlas1D.InvTileSize;
 	float v2 = vOrigin + adv_minBB.y * Atlas1D.InvTileSize * UV2_Scale;
-	struct Builder1DPart* part = &Builder_Parts[adv_baseOffset + Atlas1D_Index(texLoc)];
+	struct Builder1DPart* part = &Builder_Parts[adv_baseOffset + Builder_AtlasIndex(texLoc)];
 
 	PackedCol tint, white = PACKEDCOL_WHITE;
 	int offset = 1;// (Blocks.LightOffset[Builder_Block] >> FACE_ZMIN) & 1;
@@ -1449,12 +2597,12 @@ static void Modern_DrawZMin(int count, int x, int y, int z) {
 
 static void Modern_DrawZMax(int count, int x, int y, int z) {
 	TextureLoc texLoc = Block_Tex(Builder_Block, FACE_ZMAX);
-	float vOrigin = Atlas1D_RowId(texLoc) * Atlas1D.InvTileSize;
+	float vOrigin = Atlas1D_TileV(texLoc, MapRenderer_TextureArray);
 
 	float u1 = adv_minBB.x, u2 = (count - 1) + adv_maxBB.x * UV2_Scale;
 	float v1 = vOrigin + adv_maxBB.y * Atlas1D.InvTileSize;
 	float v2 = vOrigin + adv_minBB.y * Atlas1D.InvTileSize * UV2_Scale;
-	struct Builder1DPart* part = &Builder_Parts[adv_baseOffset + Atlas1D_Index(texLoc)];
+	struct Builder1DPart* part = &Builder_Parts[adv_baseOffset + Builder_AtlasIndex(texLoc)];
 
 	PackedCol tint, white = PACKEDCOL_WHITE;
 	int offset = 1;// (Blocks.LightOffset[Builder_Block] >> FACE_ZMAX) & 1;
@@ -1495,12 +2643,12 @@ static PackedCol Modern_GetColorYMin(PackedCol orig, int x, int y, int z, int oX
 }
 static void Modern_DrawYMin(int count, int x, int y, int z) {
 	TextureLoc texLoc = Block_Tex(Builder_Block, FACE_YMIN);
-	float vOrigin = Atlas1D_RowId(texLoc) * Atlas1D.InvTileSize;
+	float vOrigin = Atlas1D_TileV(texLoc, MapRenderer_TextureArray);
 
 	float u1 = adv_minBB.x, u2 = (count - 1) + adv_maxBB.x * UV2_Scale;
 	float v1 = vOrigin + adv_minBB.z * Atlas1D.InvTileSize;
 	float v2 = vOrigin + adv_maxBB.z * Atlas1D.InvTileSize * UV2_Scale;
-	struct Builder1DPart* part = &Builder_Parts[adv_baseOffset + Atlas1D_Index(texLoc)];
+	struct Builder1DPart* part = &Builder_Parts[adv_baseOffset + Builder_AtlasIndex(texLoc)];
 
 	PackedCol tint, white = PACKEDCOL_WHITE;
 	int offset = 1;// (Blocks.LightOffset[Builder_Block] >> FACE_YMIN) & 1;
@@ -1541,12 +2689,12 @@ static PackedCol Modern_GetColorYMax(PackedCol orig, int x, int y, int z, int oX
 }
 static void Modern_DrawYMax(int count, int x, int y, int z) {
 	TextureLoc texLoc = Block_Tex(Builder_Block, FACE_YMAX);
-	float vOrigin = Atlas1D_RowId(texLoc) * Atlas1D.InvTileSize;
+	float vOrigin = Atlas1D_TileV(texLoc, MapRenderer_TextureArray);
 
 	float u1 = adv_minBB.x, u2 = (count - 1) + adv_maxBB.x * UV2_Scale;
 	float v1 = vOrigin + adv_minBB.z * Atlas1D.InvTileSize;
 	float v2 = vOrigin + adv_maxBB.z * Atlas1D.InvTileSize * UV2_Scale;
-	struct Builder1DPart* part = &Builder_Parts[adv_baseOffset + Atlas1D_Index(texLoc)];
+	struct Builder1DPart* part = &Builder_Parts[adv_baseOffset + Builder_AtlasIndex(texLoc)];
 
 	PackedCol tint, white = PACKEDCOL_WHITE;
 	int offset = 1;// (Blocks.LightOffset[Builder_Block] >> FACE_YMAX) & 1;
@@ -1633,6 +2781,8 @@ static void ModernBuilder_SetActive(void) { NormalBuilder_SetActive(); }
 *#########################################################################################################################*/
 cc_bool Builder_SmoothLighting;
 void Builder_ApplyActive(void) {
+	/* Cached light flags may have been computed with a different lighting mode */
+	AdvCache_Invalidate();
 	if (Builder_SmoothLighting) {
 		if (Lighting_Mode != LIGHTING_MODE_CLASSIC) {
 			ModernBuilder_SetActive();
@@ -1645,6 +2795,8 @@ void Builder_ApplyActive(void) {
 	}
 }
 
+static void OnBlockDefChanged(void* obj) { AdvCache_Invalidate(); }
+
 static void OnInit(void) {
 	Builder_Offsets[FACE_XMIN] = -1;
 	Builder_Offsets[FACE_XMAX] =  1;
@@ -1655,17 +2807,34 @@ static void OnInit(void) {
 
 	if (!Game_ClassicMode) Builder_SmoothLighting = Options_GetBool(OPT_SMOOTH_LIGHTING, false);
 	Builder_ApplyActive();
+	InitThreads();
+	Event_Register_(&BlockEvents.BlockDefChanged, NULL, OnBlockDefChanged);
+#ifndef CC_BUILD_GL11
+	meshCacheEnabled = Options_GetBool(OPT_MESH_CACHE, false);
+#endif
+}
+
+static void OnFree(void) {
+	FreeThreads();
+	MeshCache_Save();
+	AdvCache_Free();
+}
+
+static void OnNewMap(void) {
+	MeshCache_Save();
+	AdvCache_Invalidate();
 }
 
 static void OnNewMapLoaded(void) {
 	Builder_SidesLevel = max(0, Env_SidesHeight);
 	Builder_EdgeLevel  = max(0, Env.EdgeHeight);
+	MeshCache_Load();
 }
 
 struct IGameComponent Builder_Component = {
 	OnInit, /* Init */
-	NULL, /* Free */
+	OnFree, /* Free */
 	NULL, /* Reset */
-	NULL, /* OnNewMap */
+	OnNewMap, /* OnNewMap */
 	OnNewMapLoaded /* OnNewMapLoaded */
 };
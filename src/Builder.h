@@ -21,6 +21,13 @@ extern cc_bool Builder_SmoothLighting;
 
 /* Builds the mesh of vertices for the given chunk. */
 void Builder_MakeChunk(struct ChunkInfo* info);
+/* Builds the meshes of vertices for the given chunks. */
+/* NOTE: When supported, meshes are built in parallel across multiple threads. */
+void Builder_MakeChunks(struct ChunkInfo** chunks, int count);
+/* Builds the meshes of vertices for every chunk in the world, without uploading them to the GPU. */
+/* Returns total number of vertices, and sets maxVertices to the most vertices built for a single chunk. */
+/* NOTE: Used for benchmarking, and leaves the map renderer's state invalid until it is refreshed */
+cc_uint32 Builder_BenchmarkAll(int* maxVertices);
 
 void Builder_ApplyActive(void);
 
@@ -13,6 +13,7 @@
 #include "Picking.h"
 #include "Platform.h"
 #include "Protocol.h"
+#include "MapRenderer.h"
 
 struct _CameraData Camera;
 static struct RayTracer cameraClipPos;
@@ -50,7 +51,8 @@ void Camera_KeyLookUpdate(float delta) {
 static void PerspectiveCamera_GetProjection(struct Matrix* proj) {
 	float fovy = Camera.Fov * MATH_DEG2RAD;
 	float aspectRatio = (float)Game.Width / (float)Game.Height;
-	Gfx_CalcPerspectiveMatrix(proj, fovy, aspectRatio, (float)Game_ViewDistance);
+	/* Far plane also has to include distant terrain drawn past the view distance */
+	Gfx_CalcPerspectiveMatrix(proj, fovy, aspectRatio, (float)(Game_ViewDistance + MapRenderer_LodDistance));
 }
 
 static void PerspectiveCamera_GetView(struct Matrix* mat) {
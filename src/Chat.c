@@ -51,6 +51,9 @@ static cc_string logPath = String_FromArray(logPathBuffer);
 
 static struct Stream logStream;
 static int lastLogDay, lastLogMonth, lastLogYear;
+/* Lines are written to the log file in large chunks, rather than one small write per line */
+static cc_uint8 logBuffer[8192];
+static int logBuffered;
 
 /* Resets log name to empty and resets last log date */
 static void ResetLogFile(void) {
@@ -58,9 +61,26 @@ static void ResetLogFile(void) {
 	lastLogYear    = -123;
 }
 
+/* Writes any buffered lines to the chat log file */
+static void FlushLogFile(void) {
+	int count = logBuffered;
+	cc_result res;
+	/* Reset first, as Chat_DisableLogging below calls this again through CloseLogFile */
+	logBuffered = 0;
+	if (!count || !logStream.meta.file) return;
+
+	res = Stream_Write(&logStream, logBuffer, count);
+	if (!res) return;
+	Chat_DisableLogging();
+	Logger_SysWarn2(res, "writing to", &logPath);
+}
+
+static void FlushLogTask(struct ScheduledTask* task) { FlushLogFile(); }
+
 /* Closes handle to the chat log file */
 static void CloseLogFile(void) {
 	cc_result res;
+	FlushLogFile();
 	if (!logStream.meta.file) return;
 
 	res = logStream.Close(&logStream);
@@ -155,7 +175,8 @@ static void OpenChatLog(struct cc_datetime* now) {
 static void AppendChatLog(const cc_string* text) {
 	cc_string str; char strBuffer[DRAWER2D_MAX_TEXT_LENGTH];
 	struct cc_datetime now;
-	cc_result res;	
+	const char* nl;
+	int i;
 
 	if (!logName.length || !Chat_Logging) return;
 	DateTime_CurrentLocal(&now);
@@ -173,10 +194,17 @@ static void AppendChatLog(const cc_string* text) {
 	String_Format3(&str, "[%p2:%p2:%p2] ", &now.hour, &now.minute, &now.second);
 	Drawer2D_WithoutColors(&str, text);
 
-	res = Stream_WriteLine(&logStream, &str);
-	if (!res) return;
-	Chat_DisableLogging();
-	Logger_SysWarn2(res, "writing to", &logPath);
+	/* Each character is at most 3 bytes in UTF8 */
+	if (logBuffered + str.length * 3 + 2 > sizeof(logBuffer)) FlushLogFile();
+
+	for (i = 0; i < str.length; i++) 
+	{
+		logBuffered += Convert_CP437ToUtf8(str.buffer[i], &logBuffer[logBuffered]);
+	}
+	for (nl = _NL; *nl; nl++) 
+	{
+		logBuffer[logBuffered++] = *nl;
+	}
 }
 
 void Chat_Add1(const char* format, const void* a1) {
@@ -278,6 +306,8 @@ static void OnInit(void) {
 #else
 	Chat_Logging = Options_GetBool(OPT_CHAT_LOGGING, true);
 #endif
+	ScheduledTask_Add(1.0, FlushLogTask);
+	Logger_CrashHook = FlushLogFile;
 }
 
 static void ClearCPEMessages(void) {
@@ -299,6 +329,7 @@ static void OnReset(void) {
 }
 
 static void OnFree(void) {
+	Logger_CrashHook = NULL;
 	CloseLogFile();
 	ClearCPEMessages();
 
@@ -17,6 +17,15 @@
 #include "TexturePack.h"
 #include "Options.h"
 #include "Drawer2D.h"
+#include "MapRenderer.h"
+#include "Audio.h"
+#include "Deflate.h"
+#include "Stream.h"
+#include "Bitmap.h"
+#include "Errors.h"
+#include "Builder.h"
+#include "Lighting.h"
+#include "ExtMath.h"
 
 #define COMMANDS_PREFIX "/client"
 #define COMMANDS_PREFIX_SPACE "/client "
@@ -467,6 +476,7 @@ static void CuboidCommand_Draw(IVec3 min, IVec3 max) {
 	toPlace = (BlockID)cuboid_block;
 	if (cuboid_block == -1) toPlace = Inventory_SelectedBlock;
 
+	Game_BeginBlockEdit();
 	for (y = min.y; y <= max.y; y++) {
 		for (z = min.z; z <= max.z; z++) {
 			for (x = min.x; x <= max.x; x++) {
@@ -474,6 +484,7 @@ static void CuboidCommand_Draw(IVec3 min, IVec3 max) {
 			}
 		}
 	}
+	Game_EndBlockEdit();
 }
 
 static void CuboidCommand_Execute(const cc_string* args, int argsCount) {
@@ -520,6 +531,7 @@ static void ReplaceCommand_Draw(IVec3 min, IVec3 max) {
 	toPlace = (BlockID)replace_target;
 	if (replace_target == -1) toPlace = Inventory_SelectedBlock;
 
+	Game_BeginBlockEdit();
 	for (y = min.y; y <= max.y; y++) {
 		for (z = min.z; z <= max.z; z++) {
 			for (x = min.x; x <= max.x; x++) {
@@ -529,6 +541,7 @@ static void ReplaceCommand_Draw(IVec3 min, IVec3 max) {
 			}
 		}
 	}
+	Game_EndBlockEdit();
 }
 
 static void ReplaceCommand_Execute(const cc_string* args, int argsCount) {
@@ -792,6 +805,1081 @@ static struct ChatCommand BlockEditCommand = {
 };
 
 
+/*########################################################################################################################*
+*-----------------------------------------------------ChunkStatsCommand---------------------------------------------------*
+*#########################################################################################################################*/
+static void ChunkStatsCommand_PrintStat(const char* name, int total, int maximum, int frames, float scale) {
+	float avg = total * scale / frames, peak = maximum * scale;
+	Chat_Add3("&e  %c: &f%f2 &eper frame, max &f%f2", name, &avg, &peak);
+}
+
+static void ChunkStatsCommand_Execute(const cc_string* args, int argsCount) {
+	struct ChunkStats total, maximum;
+	int buckets[CHUNKSTATS_BUCKETS];
+	int i, frames = CHUNKSTATS_HISTORY - 1, limit = 1;
+
+	if (argsCount && String_CaselessEqualsConst(args, "overlay")) {
+		MapRenderer_ShowStats = !MapRenderer_ShowStats;
+		Chat_Add1("&e/client: &fChunk stats overlay is now %c.", MapRenderer_ShowStats ? "on" : "off");
+		return;
+	}
+
+	MapRenderer_GetStats(frames, &total, &maximum);
+	Chat_Add1("&eChunk building over the last &f%i &eframes:", &frames);
+	ChunkStatsCommand_PrintStat("Chunks built",   total.built,       maximum.built,       frames, 1.0f);
+	ChunkStatsCommand_PrintStat("Vertices",       total.vertices,    maximum.vertices,    frames, 1.0f);
+	ChunkStatsCommand_PrintStat("Build time (ms)", total.buildTime,  maximum.buildTime,   frames, 1.0f / 1000.0f);
+	ChunkStatsCommand_PrintStat("Uploaded (KB)",  total.uploadBytes, maximum.uploadBytes, frames, 1.0f / 1024.0f);
+	ChunkStatsCommand_PrintStat("Sort time (ms)", total.sortTime,    maximum.sortTime,    frames, 1.0f / 1000.0f);
+	ChunkStatsCommand_PrintStat("Texture binds",  total.textureBinds, maximum.textureBinds, frames, 1.0f);
+
+	MapRenderer_GetBuildHistogram(buckets);
+	for (i = 0; i < CHUNKSTATS_BUCKETS - 1; i++, limit *= 2) {
+		Chat_Add2("&e  Frames building for under &f%i ms&e: &f%i", &limit, &buckets[i]);
+	}
+	limit /= 2;
+	Chat_Add2("&e  Frames building for &f%i ms &eor more: &f%i", &limit, &buckets[i]);
+}
+
+static struct ChatCommand ChunkStatsCommand = {
+	"ChunkStats", ChunkStatsCommand_Execute,
+	COMMAND_FLAG_UNSPLIT_ARGS,
+	{
+		"&a/client chunkstats",
+		"&eShows how long was spent building chunk meshes recently",
+		"&a/client chunkstats overlay",
+		"&eToggles showing chunk building stats in the top left",
+	}
+};
+
+
+/*########################################################################################################################*
+*------------------------------------------------------NetStatsCommand----------------------------------------------------*
+*#########################################################################################################################*/
+/* Number of opcodes with the most total handler time to list */
+#define NETSTATS_TOP_OPCODES 5
+
+static void NetStatsCommand_PrintOpcodes(void) {
+	cc_bool listed[256] = { 0 };
+	int i, j, best, count;
+	float totalMS, avgMS;
+	cc_uint8 opcode;
+
+	for (i = 0; i < NETSTATS_TOP_OPCODES; i++) {
+		best = -1;
+		for (j = 0; j < 256; j++) {
+			if (listed[j] || !Server_Stats.opcodeCounts[j]) continue;
+			if (best == -1 || Server_Stats.opcodeTimes[j] > Server_Stats.opcodeTimes[best]) best = j;
+		}
+		if (best == -1) return;
+		listed[best] = true;
+
+		opcode  = (cc_uint8)best;
+		count   = (int)Server_Stats.opcodeCounts[best];
+		totalMS = Server_Stats.opcodeTimes[best] / 1000.0f;
+		avgMS   = totalMS / count;
+		Chat_Add4("&e  Opcode &f%b&e: &f%i &epackets, &f%f2 ms &etotal, &f%f3 ms &eeach", 
+			&opcode, &count, &totalMS, &avgMS);
+	}
+}
+
+static void NetStatsCommand_Execute(const cc_string* args, int argsCount) {
+	float secs, recvKB, sentKB;
+	int i, recv, sent, limit = 16;
+
+	if (argsCount && String_CaselessEqualsConst(args, "reset")) {
+		Server_ResetStats();
+		Chat_AddRaw("&e/client: &fNetwork statistics reset.");
+		return;
+	} else if (argsCount == 2 && String_CaselessEqualsConst(&args[0], "log")) {
+		if (!Convert_ParseInt(&args[1], &Server_StatsLogInterval) || Server_StatsLogInterval < 0) {
+			Chat_AddRaw("&e/client: &cInterval must be a number of seconds (0 to disable)");
+			Server_StatsLogInterval = 0;
+		}
+		Options_SetInt(OPT_NET_STATS_LOG, Server_StatsLogInterval);
+		Chat_Add1("&e/client: &fLogging network stats every &e%i &fseconds.", &Server_StatsLogInterval);
+		return;
+	}
+
+	if (Server.IsSinglePlayer) {
+		Chat_AddRaw("&e/client: &fNetwork statistics are only tracked in multiplayer.");
+		return;
+	}
+
+	secs   = (float)(Game.Time - Server_Stats.startTime);
+	recvKB = Server_Stats.bytesRecv / 1024.0f;
+	sentKB = Server_Stats.bytesSent / 1024.0f;
+	recv   = (int)Server_Stats.packetsRecv;
+	sent   = (int)Server_Stats.packetsSent;
+
+	Chat_Add1("&eNetwork traffic over the last &f%f1 &eseconds:", &secs);
+	Chat_Add2("&e  Received &f%f2 KB &ein &f%i &epackets", &recvKB, &recv);
+	Chat_Add2("&e  Sent &f%f2 KB &ein &f%i &epackets", &sentKB, &sent);
+
+	Chat_Add3("&e  Predicted &f%i &eblock changes (&f%i &ecorrected, &f%i &eignored replies)", 
+		&Server_Stats.blocksPredicted, &Server_Stats.blocksCorrected, &Server_Stats.blocksIgnored);
+
+	Chat_AddRaw("&eSlowest packet handlers:");
+	NetStatsCommand_PrintOpcodes();
+
+	Chat_AddRaw("&ePing round trip times:");
+	for (i = 0; i < NETSTATS_PING_BUCKETS - 1; i++, limit *= 2) {
+		Chat_Add2("&e  Under &f%i ms&e: &f%i", &limit, &Server_Stats.pingBuckets[i]);
+	}
+	limit /= 2;
+	Chat_Add2("&e  &f%i ms &eor more: &f%i", &limit, &Server_Stats.pingBuckets[i]);
+}
+
+static void NetCaptureCommand_Execute(const cc_string* args, int argsCount) {
+	if (!argsCount) {
+		Options_Set(OPT_NET_CAPTURE, &String_Empty);
+		Chat_AddRaw("&e/client: &fNo longer capturing data received from servers.");
+	} else {
+		Options_Set(OPT_NET_CAPTURE, args);
+		Chat_Add1("&e/client: &fData received from servers will be captured to &e%s", args);
+		Chat_AddRaw("&e  This takes effect the next time you connect to a server");
+	}
+}
+
+static struct ChatCommand NetCaptureCommand = {
+	"NetCapture", NetCaptureCommand_Execute,
+	COMMAND_FLAG_UNSPLIT_ARGS,
+	{
+		"&a/client netcapture [file]",
+		"&eCaptures all data received from servers to the given file",
+		"&eCapture can be replayed by starting the game with &a--replay [file] <speed>",
+		"&a/client netcapture",
+		"&eStops capturing data received from servers",
+	}
+};
+
+static struct ChatCommand NetStatsCommand = {
+	"NetStats", NetStatsCommand_Execute,
+	0,
+	{
+		"&a/client netstats <reset>",
+		"&eShows network traffic and packet handling time since connecting",
+		"&a/client netstats log [seconds]",
+		"&eLogs a summary of network stats every [seconds] (0 disables)",
+	}
+};
+
+
+/*########################################################################################################################*
+*------------------------------------------------------ProfilerCommand----------------------------------------------------*
+*#########################################################################################################################*/
+static void ProfilerCommand_PrintAverages(void) {
+	float cpuMS, gpuMS, cpuTotal = 0, gpuTotal = 0;
+	int i, pass, frames = FRAMEPROFILER_HISTORY;
+	int applied = 0, skipped = 0;
+	char code;
+
+	Chat_Add1("&eAverage time per frame over the last &f%i &eframes:", &frames);
+	for (pass = 0; pass < FRAMEPASS_COUNT; pass++) {
+		cpuMS = 0; gpuMS = 0;
+		for (i = 0; i < FRAMEPROFILER_HISTORY; i++) {
+			cpuMS += FrameProfiler_History[i].cpuMS[pass];
+			gpuMS += FrameProfiler_History[i].gpuMS[pass];
+		}
+		cpuMS /= frames; cpuTotal += cpuMS;
+		gpuMS /= frames; gpuTotal += gpuMS;
+
+		code = FramePass_Colors[pass];
+		Chat_Add4("&%r  %c&e: CPU &f%f2 ms&e, GPU &f%f2 ms", &code, FramePass_Names[pass], &cpuMS, &gpuMS);
+	}
+	Chat_Add2("&e  Total: CPU &f%f2 ms&e, GPU &f%f2 ms", &cpuTotal, &gpuTotal);
+
+	for (i = 0; i < FRAMEPROFILER_HISTORY; i++) {
+		applied += FrameProfiler_History[i].statesApplied;
+		skipped += FrameProfiler_History[i].statesSkipped;
+	}
+	applied /= frames; skipped /= frames;
+	Chat_Add2("&e  State changes: &f%i &eapplied, &f%i &eredundant skipped", &applied, &skipped);
+	if (!Gfx.SupportsTimestamps) Chat_AddRaw("&e  GPU timings aren't supported by this graphics backend");
+}
+
+static void ProfilerCommand_Execute(const cc_string* args, int argsCount) {
+	static const cc_string defaultPath = String_FromConst("frameprofile.csv");
+	cc_result res;
+
+	if (argsCount && String_CaselessEqualsConst(&args[0], "on")) {
+		FrameProfiler_SetEnabled(true);
+		Chat_AddRaw("&e/client: &fFrame profiler is now on.");
+	} else if (argsCount && String_CaselessEqualsConst(&args[0], "off")) {
+		FrameProfiler_SetEnabled(false);
+		Chat_AddRaw("&e/client: &fFrame profiler is now off.");
+	} else if (!FrameProfiler_Enabled) {
+		Chat_AddRaw("&e/client: &cFrame profiler is off, type &a/client profiler on &cfirst.");
+	} else if (argsCount && String_CaselessEqualsConst(&args[0], "graph")) {
+		FrameProfiler_ShowGraph = !FrameProfiler_ShowGraph;
+		Chat_Add1("&e/client: &fFrame profiler graph is now %c.", FrameProfiler_ShowGraph ? "on" : "off");
+	} else if (argsCount && String_CaselessEqualsConst(&args[0], "dump")) {
+		const cc_string* path = argsCount > 1 ? &args[1] : &defaultPath;
+		res = FrameProfiler_Dump(path);
+
+		if (res) { Logger_SysWarn2(res, "writing", path); return; }
+		Chat_Add1("&e/client: &fSaved frame timings to &e%s", path);
+	} else {
+		ProfilerCommand_PrintAverages();
+	}
+}
+
+static struct ChatCommand ProfilerCommand = {
+	"Profiler", ProfilerCommand_Execute,
+	0,
+	{
+		"&a/client profiler [on/off]",
+		"&eStarts or stops timing each render pass on the CPU and GPU",
+		"&a/client profiler <graph>",
+		"&eShows average pass timings, or toggles the graph in the bottom left",
+		"&a/client profiler dump [file] &esaves recent frame timings as CSV",
+	}
+};
+
+
+/*########################################################################################################################*
+*----------------------------------------------------VorbisBenchCommand---------------------------------------------------*
+*#########################################################################################################################*/
+static void VorbisBenchCommand_Execute(const cc_string* args, int argsCount) {
+	cc_bool save = argsCount && String_CaselessEqualsConst(args, "save");
+	Audio_BenchmarkVorbis(save);
+}
+
+static struct ChatCommand VorbisBenchCommand = {
+	"VorbisBench", VorbisBenchCommand_Execute,
+	COMMAND_FLAG_UNSPLIT_ARGS,
+	{
+		"&a/client vorbisbench",
+		"&eDecodes all .ogg files in the audio folder, showing decode speed",
+		"&e  and whether the decoded samples match the saved reference CRC32s",
+		"&a/client vorbisbench save",
+		"&eDecodes all .ogg files and saves their CRC32s as reference",
+	}
+};
+
+
+/*########################################################################################################################*
+*---------------------------------------------------CompressBenchCommand--------------------------------------------------*
+*#########################################################################################################################*/
+/* Caps how much decompressed map data is kept around for the deflate and CRC32 tests */
+#define COMPRESSBENCH_MAX_DATA (16 * 1024 * 1024)
+#define COMPRESSBENCH_CHUNK 65536
+#define COMPRESSBENCH_CRC_ROUNDS 4
+
+enum CompressBenchTest {
+	CB_INFLATE_MAPS, CB_INFLATE_TEXPACKS, CB_DEFLATE_FAST, CB_DEFLATE_NORMAL, CB_DEFLATE_MAX, CB_CRC32,
+	CB_PNG /* CB_PNG + PNG colour type */, CB_COUNT = CB_PNG + 7
+};
+struct CompressBenchResult {
+	const char* name; /* NULL for PNG colour types that don't exist */
+	cc_uint32 input, output; /* Size of data before and after processing */
+	cc_uint32 processed;     /* Number of uncompressed bytes or decoded pixels */
+	cc_uint32 elapsed;       /* Microseconds */
+};
+
+static struct CompressBenchResult cb_results[CB_COUNT];
+static const char* const cb_names[CB_COUNT] = {
+	"inflate_maps", "inflate_texpacks", "deflate_fast", "deflate_normal", "deflate_max", "crc32",
+	"png_gray", NULL, "png_rgb", "png_palette", "png_gray_alpha", NULL, "png_rgba"
+};
+static cc_uint8* cb_data;
+static cc_uint32 cb_dataLen;
+static cc_uint8 cb_chunk[COMPRESSBENCH_CHUNK];
+
+/* Reads all the remaining data in the stream, keeping it for the other tests if there's room */
+static cc_result CompressBench_ReadAll(struct Stream* s, cc_uint32* total, cc_bool keep) {
+	cc_uint8* dst;
+	cc_uint32 read, left;
+	cc_result res;
+
+	for (;;) {
+		left = COMPRESSBENCH_MAX_DATA - cb_dataLen;
+		dst  = keep && left >= COMPRESSBENCH_CHUNK ? cb_data + cb_dataLen : cb_chunk;
+
+		if ((res = s->Read(s, dst, COMPRESSBENCH_CHUNK, &read))) return res;
+		if (!read) return 0;
+
+		*total += read;
+		if (dst != cb_chunk) cb_dataLen += read;
+	}
+}
+
+static void CompressBench_Map(const cc_string* path, void* obj, int isDirectory) {
+	struct CompressBenchResult* r = &cb_results[CB_INFLATE_MAPS];
+	struct GZipHeader gzHeader;
+	struct InflateState state;
+	struct Stream stream, compStream;
+	cc_uint8* data;
+	cc_uint32 length;
+	cc_uint64 beg;
+	cc_result res;
+
+	if (isDirectory) return;
+	if ((res = Stream_ReadAllFrom(path, &data, &length))) { Logger_SysWarn2(res, "reading", path); return; }
+	/* Only .cw and .lvl maps are entirely GZIP compressed */
+	if (length < 2 || data[0] != 0x1F || data[1] != 0x8B) { Mem_Free(data); return; }
+
+	Stream_ReadonlyMemory(&stream, data, length);
+	Inflate_MakeStream2(&compStream, &state, &stream);
+	GZipHeader_Init(&gzHeader);
+
+	beg = Stopwatch_Measure();
+	for (res = 0; !res && !gzHeader.done; ) 
+	{
+		res = GZipHeader_Read(&stream, &gzHeader);
+	}
+	if (!res) res = CompressBench_ReadAll(&compStream, &r->output, true);
+	r->elapsed += (cc_uint32)Stopwatch_ElapsedMicroseconds(beg, Stopwatch_Measure());
+
+	if (res) Logger_SysWarn2(res, "decompressing", path);
+	r->input += length;
+	Mem_Free(data);
+}
+
+static void CompressBench_Png(cc_uint8* data, cc_uint32 length) {
+	struct CompressBenchResult* r;
+	struct Bitmap bmp;
+	struct Stream stream;
+	cc_uint64 beg;
+	cc_result res;
+	/* Colour type is stored in the IHDR chunk, which must be the first chunk */
+	if (length < 26 || data[25] >= 7 || !cb_names[CB_PNG + data[25]]) return;
+	r = &cb_results[CB_PNG + data[25]];
+
+	Stream_ReadonlyMemory(&stream, data, length);
+	beg = Stopwatch_Measure();
+	res = Png_Decode(&bmp, &stream);
+	r->elapsed += (cc_uint32)Stopwatch_ElapsedMicroseconds(beg, Stopwatch_Measure());
+
+	if (res) return;
+	r->input     += length;
+	r->output    += (cc_uint32)(bmp.width * bmp.height) * 4;
+	r->processed += (cc_uint32)(bmp.width * bmp.height);
+	Mem_Free(bmp.scan0);
+}
+
+static cc_bool CompressBench_SelectEntry(const cc_string* path) { return true; }
+static cc_result CompressBench_ProcessEntry(const cc_string* path, struct Stream* stream, struct ZipEntry* source) {
+	static const cc_string png = String_FromConst(".png");
+	struct CompressBenchResult* r = &cb_results[CB_INFLATE_TEXPACKS];
+	cc_uint8* data;
+	cc_uint64 beg;
+	cc_result res;
+
+	if (!String_CaselessEnds(path, &png)) {
+		beg = Stopwatch_Measure();
+		res = CompressBench_ReadAll(stream, &r->output, false);
+		r->elapsed += (cc_uint32)Stopwatch_ElapsedMicroseconds(beg, Stopwatch_Measure());
+		r->input   += source->CompressedSize;
+		return res;
+	}
+
+	/* PNG files are decompressed into memory first, so decoding them can be timed separately */
+	data = (cc_uint8*)Mem_TryAlloc(source->UncompressedSize, 1);
+	if (!data) return ERR_OUT_OF_MEMORY;
+
+	beg = Stopwatch_Measure();
+	res = Stream_Read(stream, data, source->UncompressedSize);
+	r->elapsed += (cc_uint32)Stopwatch_ElapsedMicroseconds(beg, Stopwatch_Measure());
+	r->input   += source->CompressedSize;
+	r->output  += source->UncompressedSize;
+
+	if (!res) CompressBench_Png(data, source->UncompressedSize);
+	Mem_Free(data);
+	return res;
+}
+
+static void CompressBench_TexturePack(const cc_string* path, void* obj, int isDirectory) {
+	static const cc_string zip = String_FromConst(".zip");
+	struct ZipEntry entries[512];
+	struct Stream stream;
+	cc_uint8* data;
+	cc_uint32 length;
+	cc_result res;
+
+	if (isDirectory || !String_CaselessEnds(path, &zip)) return;
+	if ((res = Stream_ReadAllFrom(path, &data, &length))) { Logger_SysWarn2(res, "reading", path); return; }
+
+	Stream_ReadonlyMemory(&stream, data, length);
+	res = Zip_Extract(&stream, CompressBench_SelectEntry, CompressBench_ProcessEntry,
+						entries, Array_Elems(entries));
+	if (res) Logger_SysWarn2(res, "extracting", path);
+	Mem_Free(data);
+}
+
+static cc_result CompressBench_CountWrite(struct Stream* s, const cc_uint8* data, cc_uint32 count, cc_uint32* modified) {
+	s->meta.mem.length += count;
+	*modified = count; return 0;
+}
+
+static void CompressBench_Deflate(struct DeflateState* state, int level) {
+	struct CompressBenchResult* r = &cb_results[CB_DEFLATE_FAST + level];
+	struct Stream stream, sink;
+	cc_uint32 i, count;
+	cc_uint64 beg;
+	cc_result res = 0;
+
+	Stream_Init(&sink);
+	sink.Write = CompressBench_CountWrite;
+	sink.meta.mem.length = 0;
+
+	beg = Stopwatch_Measure();
+	Deflate_MakeStream(&stream, state, &sink);
+	state->Level = level;
+
+	for (i = 0; i < cb_dataLen && !res; i += count) 
+	{
+		count = min(COMPRESSBENCH_CHUNK, cb_dataLen - i);
+		res   = Stream_Write(&stream, cb_data + i, count);
+	}
+	if (!res) res = stream.Close(&stream);
+	r->elapsed = (cc_uint32)Stopwatch_ElapsedMicroseconds(beg, Stopwatch_Measure());
+
+	if (res) { Logger_SysWarn(res, "compressing"); return; }
+	r->input     = cb_dataLen;
+	r->processed = cb_dataLen;
+	r->output    = sink.meta.mem.length;
+}
+
+static void CompressBench_Crc32(void) {
+	struct CompressBenchResult* r = &cb_results[CB_CRC32];
+	cc_uint32 crc = 0xFFFFFFFFUL;
+	cc_uint64 beg;
+	int i;
+
+	beg = Stopwatch_Measure();
+	for (i = 0; i < COMPRESSBENCH_CRC_ROUNDS; i++) 
+	{
+		crc = Utils_UpdateCRC32(crc, cb_data, cb_dataLen);
+	}
+	r->elapsed   = (cc_uint32)Stopwatch_ElapsedMicroseconds(beg, Stopwatch_Measure());
+	r->processed = cb_dataLen * COMPRESSBENCH_CRC_ROUNDS;
+	r->input     = r->processed;
+	r->output    = r->processed;
+}
+
+static cc_result CompressBench_WriteTo(struct Stream* s) {
+	cc_string line; char lineBuffer[256];
+	struct CompressBenchResult* r;
+	float rate;
+	int i;
+	cc_result res;
+
+	String_InitArray(line, lineBuffer);
+	String_AppendConst(&line, "test,input,output,processed,microseconds,rate");
+	if ((res = Stream_WriteLine(s, &line))) return res;
+
+	for (i = 0; i < CB_COUNT; i++) 
+	{
+		r = &cb_results[i];
+		if (!r->name || !r->elapsed) continue;
+		rate = (float)r->processed / r->elapsed;
+		line.length = 0;
+
+		String_Format1(&line, "%c,", r->name);
+		String_AppendUInt32(&line, r->input);     String_Append(&line, ',');
+		String_AppendUInt32(&line, r->output);    String_Append(&line, ',');
+		String_AppendUInt32(&line, r->processed); String_Append(&line, ',');
+		String_AppendUInt32(&line, r->elapsed);
+		String_Format1(&line, ",%f3", &rate);
+		if ((res = Stream_WriteLine(s, &line))) return res;
+	}
+	return 0;
+}
+
+static void CompressBench_Print(void) {
+	struct CompressBenchResult* r;
+	float rate, ratio;
+	int i;
+
+	for (i = 0; i < CB_COUNT; i++) 
+	{
+		r = &cb_results[i];
+		if (!r->name || !r->elapsed) continue;
+		rate = (float)r->processed / r->elapsed;
+
+		if (i >= CB_PNG) {
+			Chat_Add2("&e  %c: &f%f2 &eMpix/s", r->name, &rate);
+		} else if (i >= CB_DEFLATE_FAST && i <= CB_DEFLATE_MAX) {
+			ratio = r->input ? (float)r->output / r->input : 0.0f;
+			Chat_Add3("&e  %c: &f%f2 &eMB/s, compression ratio &f%f3", r->name, &rate, &ratio);
+		} else {
+			Chat_Add2("&e  %c: &f%f2 &eMB/s", r->name, &rate);
+		}
+	}
+}
+
+static void CompressBenchCommand_Execute(const cc_string* args, int argsCount) {
+	static const cc_string defaultPath = String_FromConst("compressbench.csv");
+	static const cc_string maps = String_FromConst("maps");
+	static const cc_string texs = String_FromConst("texpacks");
+	const cc_string* path = argsCount ? args : &defaultPath;
+	struct DeflateState* state;
+	struct CompressBenchResult* r;
+	struct Stream stream;
+	cc_result res;
+	int i;
+
+	cb_data = (cc_uint8*)Mem_TryAlloc(COMPRESSBENCH_MAX_DATA, 1);
+	state   = (struct DeflateState*)Mem_TryAlloc(1, sizeof(struct DeflateState));
+	if (!cb_data || !state) {
+		Chat_AddRaw("&e/client: &cNot enough memory to run benchmark");
+		Mem_Free(cb_data); Mem_Free(state); return;
+	}
+
+	Mem_Set(cb_results, 0, sizeof(cb_results));
+	for (i = 0; i < CB_COUNT; i++) cb_results[i].name = cb_names[i];
+	cb_dataLen = 0;
+
+	Directory_Enum(&maps, NULL, CompressBench_Map);
+	Directory_Enum(&texs, NULL, CompressBench_TexturePack);
+	r = &cb_results[CB_INFLATE_MAPS];     r->processed = r->output;
+	r = &cb_results[CB_INFLATE_TEXPACKS]; r->processed = r->output;
+
+	if (cb_dataLen) {
+		for (i = 0; i < DEFLATE_LEVEL_COUNT; i++) CompressBench_Deflate(state, i);
+		CompressBench_Crc32();
+	} else {
+		Chat_AddRaw("&e/client: &cNo .cw or .lvl maps found, so skipping deflate and CRC32 tests");
+	}
+
+	Chat_AddRaw("&eCompression benchmark results:");
+	CompressBench_Print();
+	Mem_Free(cb_data);
+	Mem_Free(state);
+
+	res = Stream_CreateFile(&stream, path);
+	if (!res) {
+		res = CompressBench_WriteTo(&stream);
+		(void)stream.Close(&stream);
+	}
+
+	if (res) { Logger_SysWarn2(res, "writing", path); return; }
+	Chat_Add1("&e/client: &fSaved benchmark results to &e%s", path);
+}
+
+static struct ChatCommand CompressBenchCommand = {
+	"CompressBench", CompressBenchCommand_Execute,
+	COMMAND_FLAG_UNSPLIT_ARGS,
+	{
+		"&a/client compressbench [file]",
+		"&eTimes inflating maps in the maps folder and texture packs in the",
+		"&e  texpacks folder, deflating at each level, CRC32 and PNG decoding",
+		"&eResults are also saved as CSV to [file], or compressbench.csv if not given",
+	}
+};
+
+
+/*########################################################################################################################*
+*-----------------------------------------------------MeshBenchCommand----------------------------------------------------*
+*#########################################################################################################################*/
+static void MeshBenchCommand_Run(const char* name, cc_bool smooth, cc_uint8 mode) {
+	cc_uint32 vertices;
+	cc_uint64 beg;
+	int maxVertices, elapsed, peakKB;
+	float chunksPerSec;
+
+	Builder_SmoothLighting = smooth;
+	if (Lighting_Mode != mode) Lighting_SetMode(mode, false);
+	Builder_ApplyActive();
+
+	beg      = Stopwatch_Measure();
+	vertices = Builder_BenchmarkAll(&maxVertices);
+	elapsed  = Stopwatch_ElapsedMS(beg, Stopwatch_Measure());
+
+	chunksPerSec = World.ChunksCount * 1000.0f / max(elapsed, 1);
+	peakKB       = maxVertices * SIZEOF_VERTEX_TEXTURED / 1024;
+	Chat_Add4("&e  %c: &f%i &ems, &f%f1 &echunks/s, &f%i &evertices", name, &elapsed, &chunksPerSec, &vertices);
+	Chat_Add1("&e    largest chunk mesh: &f%i &eKB", &peakKB);
+}
+
+static void MeshBenchCommand_Execute(const cc_string* args, int argsCount) {
+	cc_bool oldSmooth = Builder_SmoothLighting;
+	cc_uint8 oldMode  = Lighting_Mode;
+
+	if (!World.Loaded) { Chat_AddRaw("&e/client: &cNo map is loaded"); return; }
+	Chat_Add1("&eBuilding all &f%i &echunk meshes, without uploading to the GPU:", &World.ChunksCount);
+
+	MeshBenchCommand_Run("Normal builder, classic lighting", false, LIGHTING_MODE_CLASSIC);
+	MeshBenchCommand_Run("Normal builder, fancy lighting",   false, LIGHTING_MODE_FANCY);
+	MeshBenchCommand_Run("Smooth builder, classic lighting", true,  LIGHTING_MODE_CLASSIC);
+	MeshBenchCommand_Run("Modern builder, fancy lighting",   true,  LIGHTING_MODE_FANCY);
+
+	Builder_SmoothLighting = oldSmooth;
+	if (Lighting_Mode != oldMode) Lighting_SetMode(oldMode, false);
+	Builder_ApplyActive();
+	MapRenderer_Refresh();
+}
+
+static struct ChatCommand MeshBenchCommand = {
+	"MeshBench", MeshBenchCommand_Execute,
+	0,
+	{
+		"&a/client meshbench",
+		"&eTimes building the mesh of every chunk in the current map,",
+		"&e  for each mesh builder and lighting mode",
+		"&eNOTE: All chunks are rebuilt afterwards",
+	}
+};
+
+
+/*########################################################################################################################*
+*----------------------------------------------------LightBenchCommand----------------------------------------------------*
+*#########################################################################################################################*/
+#define LIGHTBENCH_EDITS 1000
+struct LightBenchEdit { int x, y, z; BlockID old; };
+static struct LightBenchEdit* lb_edits;
+
+/* Calculates lighting for every chunk in the map, like building every chunk mesh does */
+static void LightBench_LightAll(void) {
+	int cx, cy, cz;
+	for (cy = 0; cy < World.ChunksY; cy++)
+		for (cz = 0; cz < World.ChunksZ; cz++)
+			for (cx = 0; cx < World.ChunksX; cx++)
+	{
+		Lighting.LightHint(cx * CHUNK_SIZE - 1, cy * CHUNK_SIZE - 1, cz * CHUNK_SIZE - 1);
+	}
+}
+
+/* Calculates CRC32 of the light colour of every block in the map */
+static cc_uint32 LightBench_HashColors(void) {
+	cc_uint32 crc = 0xFFFFFFFFUL;
+	PackedCol* row;
+	int x, y, z;
+
+	row = (PackedCol*)Mem_Alloc(World.Width, sizeof(PackedCol), "light row");
+	for (y = 0; y < World.Height; y++)
+		for (z = 0; z < World.Length; z++)
+	{
+		for (x = 0; x < World.Width; x++) row[x] = Lighting.Color(x, y, z);
+		crc = Utils_UpdateCRC32(crc, (cc_uint8*)row, World.Width * sizeof(PackedCol));
+	}
+
+	Mem_Free(row);
+	return crc ^ 0xFFFFFFFFUL;
+}
+
+static void LightBench_Change(int x, int y, int z, BlockID old, BlockID now) {
+	World_SetBlock(x, y, z, now);
+	Lighting.OnBlockChanged(x, y, z, old, now);
+}
+
+/* Returns average time in microseconds to change a block, when changing random blocks to 'block' */
+/*  (or to air, when the block already is 'block') and then changing them back again */
+static float LightBench_Edits(RNGState* rnd, BlockID block) {
+	struct LightBenchEdit* e;
+	cc_uint64 beg, elapsed;
+	BlockID now;
+	int i;
+
+	/* Most changes take much less than a microsecond, so the whole loop is timed instead */
+	beg = Stopwatch_Measure();
+	for (i = 0; i < LIGHTBENCH_EDITS; i++) 
+	{
+		e = &lb_edits[i];
+		e->x = Random_Next(rnd, World.Width);
+		e->y = Random_Next(rnd, World.Height);
+		e->z = Random_Next(rnd, World.Length);
+		e->old = World_GetBlock(e->x, e->y, e->z);
+
+		now = e->old == block ? BLOCK_AIR : block;
+		LightBench_Change(e->x, e->y, e->z, e->old, now);
+	}
+
+	/* Undo in reverse order, so the map ends up exactly as it was */
+	for (i = LIGHTBENCH_EDITS - 1; i >= 0; i--) 
+	{
+		e = &lb_edits[i];
+		now = World_GetBlock(e->x, e->y, e->z);
+		LightBench_Change(e->x, e->y, e->z, now, e->old);
+	}
+
+	elapsed = Stopwatch_ElapsedMicroseconds(beg, Stopwatch_Measure());
+	return elapsed / (2.0f * LIGHTBENCH_EDITS);
+}
+
+/* Returns a block that emits lamp light, or lava light if no blocks emit lamp light */
+static BlockID LightBench_FindLamp(void) {
+	int i;
+	for (i = 1; i < BLOCK_COUNT; i++) 
+	{
+		if (Blocks.Brightness[i] >> FANCY_LIGHTING_LAMP_SHIFT) return (BlockID)i;
+	}
+	return BLOCK_LAVA;
+}
+
+static cc_uint32 LightBench_Run(cc_uint8 mode, BlockID lamp) {
+	RNGState rnd;
+	cc_uint64 beg;
+	float editUS, lampUS;
+	int elapsed, memKB;
+	cc_uint32 crc;
+
+	if (Lighting_Mode != mode) Lighting_SetMode(mode, false);
+	Lighting.FreeState();
+
+	beg = Stopwatch_Measure();
+	Lighting.AllocState();
+	LightBench_LightAll();
+	elapsed = Stopwatch_ElapsedMS(beg, Stopwatch_Measure());
+	memKB   = (int)(Lighting_MemoryUsage() / 1024);
+
+	/* Same edits for every lighting mode */
+	Random_Seed(&rnd, 0x4C494748);
+	editUS = LightBench_Edits(&rnd, BLOCK_STONE);
+	lampUS = LightBench_Edits(&rnd, lamp);
+	crc    = LightBench_HashColors();
+
+	Chat_Add4("&e  %c lighting: &finit %i &ems, &f%i &eKB, colours &f%h",
+				LightingMode_Names[mode], &elapsed, &memKB, &crc);
+	Chat_Add2("&e    block change &f%f2 &eus, lamp change &f%f2 &eus", &editUS, &lampUS);
+	return crc;
+}
+
+static void LightBench_Save(const cc_string* path, const cc_uint32* crcs) {
+	cc_string line; char lineBuffer[128];
+	struct Stream stream;
+	cc_result res;
+	int i;
+
+	res = Stream_CreateFile(&stream, path);
+	if (res) { Logger_SysWarn2(res, "creating", path); return; }
+
+	for (i = 0; i < LIGHTING_MODE_COUNT && !res; i++) 
+	{
+		String_InitArray(line, lineBuffer);
+		String_Format2(&line, "%c,%h", LightingMode_Names[i], &crcs[i]);
+		res = Stream_WriteLine(&stream, &line);
+	}
+	(void)stream.Close(&stream);
+
+	if (res) { Logger_SysWarn2(res, "writing", path); return; }
+	Chat_Add1("&e/client: &fSaved light colour hashes to &e%s", path);
+}
+
+/* Compares against a file of 'mode,hash' lines saved by LightBench_Save */
+static void LightBench_Compare(const cc_string* path, const cc_uint32* crcs) {
+	cc_string line; char lineBuffer[128];
+	cc_string cur;  char curBuffer[128];
+	cc_string parts[2];
+	cc_uint8 buffer[1024];
+	struct Stream stream, buffered;
+	cc_result res;
+	int i;
+
+	res = Stream_OpenFile(&stream, path);
+	if (res) { Logger_SysWarn2(res, "opening", path); return; }
+	Stream_ReadonlyBuffered(&buffered, &stream, buffer, sizeof(buffer));
+
+	for (;;) {
+		String_InitArray(line, lineBuffer);
+		res = Stream_ReadLine(&buffered, &line);
+		if (res) break;
+		if (String_UNSAFE_Split(&line, ',', parts, 2) != 2) continue;
+
+		for (i = 0; i < LIGHTING_MODE_COUNT; i++) 
+		{
+			if (!String_CaselessEqualsConst(&parts[0], LightingMode_Names[i])) continue;
+			String_InitArray(cur, curBuffer);
+			String_Format1(&cur, "%h", &crcs[i]);
+
+			if (String_CaselessEquals(&parts[1], &cur)) {
+				Chat_Add1("&e  %c lighting: &amatches reference", LightingMode_Names[i]);
+			} else {
+				Chat_Add3("&e  %c lighting: &cdiffers from reference (&f%s &cvs &f%s&c)", 
+							LightingMode_Names[i], &cur, &parts[1]);
+			}
+		}
+	}
+	/* No point logging error for closing readonly file */
+	(void)stream.Close(&stream);
+	if (res != ERR_END_OF_STREAM) Logger_SysWarn2(res, "reading", path);
+}
+
+static void LightBenchCommand_Execute(const cc_string* args, int argsCount) {
+	cc_uint8 oldMode = Lighting_Mode;
+	cc_uint32 crcs[LIGHTING_MODE_COUNT];
+	int i, edits = LIGHTBENCH_EDITS;
+	BlockID lamp;
+
+	if (!World.Loaded) { Chat_AddRaw("&e/client: &cNo map is loaded"); return; }
+	if (argsCount == 1 || (argsCount > 1 && !String_CaselessEqualsConst(&args[0], "save") 
+									 && !String_CaselessEqualsConst(&args[0], "compare"))) {
+		Chat_AddRaw("&e/client lightbench: &cExpected save [file] or compare [file]"); return;
+	}
+
+	lamp     = LightBench_FindLamp();
+	lb_edits = (struct LightBenchEdit*)Mem_Alloc(LIGHTBENCH_EDITS, sizeof(struct LightBenchEdit), "light edits");
+	Chat_Add1("&eTiming lighting, with &f%i &erandom block and lamp changes:", &edits);
+
+	for (i = 0; i < LIGHTING_MODE_COUNT; i++) 
+	{
+		crcs[i] = LightBench_Run((cc_uint8)i, lamp);
+	}
+	Mem_Free(lb_edits);
+	lb_edits = NULL;
+
+	if (Lighting_Mode != oldMode) Lighting_SetMode(oldMode, false);
+	MapRenderer_Refresh();
+
+	if (argsCount < 2) return;
+	if (String_CaselessEqualsConst(&args[0], "save")) {
+		LightBench_Save(&args[1], crcs);
+	} else {
+		LightBench_Compare(&args[1], crcs);
+	}
+}
+
+static struct ChatCommand LightBenchCommand = {
+	"LightBench", LightBenchCommand_Execute,
+	0,
+	{
+		"&a/client lightbench <save/compare [file]>",
+		"&eTimes calculating lighting for the whole map, and changing random",
+		"&e  blocks and lamps, for each lighting mode. Also shows memory used",
+		"&eHashes of the light colour of every block are saved to or compared",
+		"&e  against [file]. NOTE: All chunks are rebuilt afterwards",
+	}
+};
+
+
+/*########################################################################################################################*
+*-----------------------------------------------------FlyBenchCommand-----------------------------------------------------*
+*#########################################################################################################################*/
+static void FlyBenchCommand_Execute(const cc_string* args, int argsCount) {
+	static const cc_string defaultOutput = String_FromConst("flybench.csv");
+	const cc_string* output = argsCount > 1 ? &args[1] : &defaultOutput;
+	cc_result res;
+
+	if (!argsCount) {
+		Chat_AddRaw("&e/client flybench: &cYou didn't specify a camera path file."); return;
+	}
+	if (!World.Loaded) { Chat_AddRaw("&e/client: &cNo map is loaded"); return; }
+	if (CrowdBench_Running) { Chat_AddRaw("&e/client: &cCrowd benchmark is already running"); return; }
+
+	res = FlyBench_Start(&args[0], output);
+	if (res) { Logger_SysWarn2(res, "loading camera path", &args[0]); return; }
+	Chat_Add1("&e/client: &fFlying along camera path &e%s&f, press escape to cancel", &args[0]);
+}
+
+static struct ChatCommand FlyBenchCommand = {
+	"FlyBench", FlyBenchCommand_Execute,
+	COMMAND_FLAG_SINGLEPLAYER_ONLY,
+	{
+		"&a/client flybench [path] <output>",
+		"&eFlies the camera along the path in the given file, where each line",
+		"&e  is '&ftime x y z yaw pitch&e' (in seconds, blocks and degrees)",
+		"&eMean, p50, p95 and p99 frame, CPU and GPU times and draw calls",
+		"&e  are then saved as CSV to <output>, or flybench.csv if not given",
+	}
+};
+
+
+/*########################################################################################################################*
+*-------------------------------------------------------TraceCommand------------------------------------------------------*
+*#########################################################################################################################*/
+static void TraceCommand_Execute(const cc_string* args, int argsCount) {
+	static const cc_string defaultPath = String_FromConst("trace.json");
+	const cc_string* path = argsCount > 1 ? &args[1] : &defaultPath;
+	cc_result res;
+
+	if (argsCount && String_CaselessEqualsConst(&args[0], "start")) {
+		res = Tracer_Start();
+		if (res) { Chat_AddRaw("&e/client: &cEvent tracing is not supported on this platform."); return; }
+		Chat_AddRaw("&e/client: &fEvent tracing is now on.");
+	} else if (argsCount && String_CaselessEqualsConst(&args[0], "stop")) {
+		if (!Tracer_Enabled) { Chat_AddRaw("&e/client: &cEvent tracing is not on."); return; }
+		res = Tracer_Stop(path);
+
+		if (res) { Logger_SysWarn2(res, "writing", path); return; }
+		Chat_Add1("&e/client: &fSaved trace events to &e%s", path);
+	} else {
+		Chat_AddRaw("&e/client trace: &cYou didn't specify start or stop.");
+	}
+}
+
+static struct ChatCommand TraceCommand = {
+	"Trace", TraceCommand_Execute,
+	0,
+	{
+		"&a/client trace start",
+		"&eStarts recording when the main parts of the game begin and end,",
+		"&e  such as frames, chunk builds and HTTP requests, on every thread",
+		"&a/client trace stop [file] &estops recording, then saves the events",
+		"&e  in Chrome trace JSON format to [file], or trace.json if not given",
+	}
+};
+
+
+/*########################################################################################################################*
+*-----------------------------------------------------MemStatsCommand-----------------------------------------------------*
+*#########################################################################################################################*/
+/* Number of places using the most memory to list */
+#define MEMSTATS_LIST_COUNT 10
+
+static void MemStatsCommand_Execute(const cc_string* args, int argsCount) {
+	struct MemStatsPlace places[MEMSTATS_LIST_COUNT];
+	int i, count, curKB, peakKB;
+
+	count = MemStats_Get(places, MEMSTATS_LIST_COUNT);
+	if (!count) { Chat_AddRaw("&e/client: &cMemory accounting is not supported in this build."); return; }
+
+	if (argsCount && String_CaselessEqualsConst(args, "overlay")) {
+		MemStats_ShowOverlay = !MemStats_ShowOverlay;
+		Chat_Add1("&e/client: &fMemory stats overlay is now %c.", MemStats_ShowOverlay ? "on" : "off");
+		return;
+	}
+
+	Chat_Add1("&eTop &f%i &eplaces by memory currently used:", &count);
+	for (i = 0; i < count; i++) {
+		curKB  = (int)(places[i].curBytes  / 1024);
+		peakKB = (int)(places[i].peakBytes / 1024);
+		Chat_Add4("&e  %c: &f%i KB &e(peak &f%i KB&e, &f%i &ealive)", places[i].name, &curKB, &peakKB, &places[i].count);
+	}
+}
+
+static struct ChatCommand MemStatsCommand = {
+	"MemStats", MemStatsCommand_Execute,
+	COMMAND_FLAG_UNSPLIT_ARGS,
+	{
+		"&a/client memstats",
+		"&eShows which places have allocated the most memory, including",
+		"&e  estimates for textures and vertex buffers on the GPU",
+		"&a/client memstats overlay",
+		"&eToggles showing the top memory user in the top left",
+	}
+};
+
+
+/*########################################################################################################################*
+*----------------------------------------------------HandlerCostCommand---------------------------------------------------*
+*#########################################################################################################################*/
+/* Number of callbacks or components taking the most time to list */
+#define HANDLERCOST_LIST_COUNT 10
+static cc_uint64 handlerCostBeg;
+
+static const char* HandlerCostCommand_Owner(void* owner) {
+	return owner ? Game_ComponentName((struct IGameComponent*)owner) : "Unknown";
+}
+
+static void HandlerCostCommand_Print(cc_bool byOwner) {
+	struct HandlerCost costs[HANDLERCOST_LIST_COUNT];
+	cc_string str; char strBuffer[STRING_SIZE];
+	const char* owner;
+	float totalMS, eachMS, secs;
+	int i, count;
+
+	count = HandlerCost_Get(costs, HANDLERCOST_LIST_COUNT, byOwner);
+	secs  = Stopwatch_ElapsedMicroseconds(handlerCostBeg, Stopwatch_Measure()) / (1000.0f * 1000.0f);
+	if (!count) { Chat_AddRaw("&e/client: &fNo event handlers or tasks have been timed yet."); return; }
+
+	Chat_Add3("&eTop &f%i &e%c by time spent over the last &f%f1 &eseconds:", 
+		&count, byOwner ? "components" : "callbacks", &secs);
+
+	for (i = 0; i < count; i++) {
+		owner   = HandlerCostCommand_Owner(costs[i].owner);
+		totalMS = costs[i].elapsed / 1000.0f;
+		eachMS  = totalMS / costs[i].calls;
+
+		if (byOwner) {
+			Chat_Add3("&e  %c: &f%f2 ms &etotal over &f%i &ecalls", owner, &totalMS, &costs[i].calls);
+		} else {
+			String_InitArray(str, strBuffer);
+			String_Format3(&str, "&e  %c %c &f%x&e: ", owner, costs[i].isTask ? "task" : "handler", &costs[i].func);
+			String_Format3(&str, "&f%f2 ms &e(&f%f3 ms &eeach, &f%i &ecalls)", &totalMS, &eachMS, &costs[i].calls);
+			Chat_Add(&str);
+		}
+	}
+}
+
+static void HandlerCostCommand_Execute(const cc_string* args, int argsCount) {
+	if (argsCount && String_CaselessEqualsConst(&args[0], "on")) {
+		HandlerCost_Reset();
+		handlerCostBeg      = Stopwatch_Measure();
+		HandlerCost_Enabled = true;
+		Chat_AddRaw("&e/client: &fNow timing event handlers and scheduled tasks.");
+	} else if (argsCount && String_CaselessEqualsConst(&args[0], "off")) {
+		HandlerCost_Enabled = false;
+		Chat_AddRaw("&e/client: &fNo longer timing event handlers and scheduled tasks.");
+	} else if (!HandlerCost_Enabled) {
+		Chat_AddRaw("&e/client: &cHandler timing is off, type &a/client handlercost on &cfirst.");
+	} else if (argsCount && String_CaselessEqualsConst(&args[0], "reset")) {
+		HandlerCost_Reset();
+		handlerCostBeg = Stopwatch_Measure();
+		Chat_AddRaw("&e/client: &fReset handler timings.");
+	} else if (argsCount && String_CaselessEqualsConst(&args[0], "all")) {
+		HandlerCostCommand_Print(false);
+	} else {
+		HandlerCostCommand_Print(true);
+	}
+}
+
+static struct ChatCommand HandlerCostCommand = {
+	"HandlerCost", HandlerCostCommand_Execute,
+	0,
+	{
+		"&a/client handlercost [on/off/reset]",
+		"&eStarts or stops timing each event handler and scheduled task",
+		"&a/client handlercost",
+		"&eShows which components (including plugins) took the most time",
+		"&a/client handlercost all &eshows the slowest individual callbacks",
+	}
+};
+
+
+/*########################################################################################################################*
+*------------------------------------------------------StartupCommand-----------------------------------------------------*
+*#########################################################################################################################*/
+static void StartupCommand_Execute(const cc_string* args, int argsCount) {
+	const struct StartupStep* steps;
+	int i, count = Game_GetStartupSteps(&steps);
+	float ms;
+
+	Chat_AddRaw("&eTime spent starting the game:");
+	for (i = 0; i < count; i++) {
+		ms = steps[i].micros / 1000.0f;
+		Chat_Add2("&e  %c: &f%f2 ms", steps[i].name, &ms);
+	}
+}
+
+static struct ChatCommand StartupCommand = {
+	"Startup", StartupCommand_Execute,
+	0,
+	{
+		"&a/client startup",
+		"&eShows how long initialising each part of the game took,",
+		"&e  as well as any work that was deferred until after the first frame",
+	}
+};
+
+
+/*########################################################################################################################*
+*----------------------------------------------------CrowdBenchCommand----------------------------------------------------*
+*#########################################################################################################################*/
+static void CrowdBenchCommand_Execute(const cc_string* args, int argsCount) {
+	static const cc_string defaultOutput = String_FromConst("crowdbench.csv");
+	const cc_string* output = argsCount ? &args[0] : &defaultOutput;
+
+	if (!World.Loaded)    { Chat_AddRaw("&e/client: &cNo map is loaded"); return; }
+	if (FlyBench_Running) { Chat_AddRaw("&e/client: &cFly-through benchmark is already running"); return; }
+
+	CrowdBench_Start(output);
+	Chat_AddRaw("&e/client: &fSpawning players for crowd benchmark, press escape to cancel");
+}
+
+static struct ChatCommand CrowdBenchCommand = {
+	"CrowdBench", CrowdBenchCommand_Execute,
+	COMMAND_FLAG_SINGLEPLAYER_ONLY,
+	{
+		"&a/client crowdbench <output>",
+		"&eSpawns from 10 up to 254 players walking around you,",
+		"&e  with varying models and skins",
+		"&eAverage tick, model, shadow, name and frame times for each",
+		"&e  number of players are saved as CSV to <output> (crowdbench.csv)",
+	}
+};
+
+
 /*########################################################################################################################*
 *------------------------------------------------------Commands component-------------------------------------------------*
 *#########################################################################################################################*/
@@ -809,6 +1897,20 @@ static void OnInit(void) {
 	Commands_Register(&BlockEditCommand);
 	Commands_Register(&CuboidCommand);
 	Commands_Register(&ReplaceCommand);
+	Commands_Register(&ChunkStatsCommand);
+	Commands_Register(&NetStatsCommand);
+	Commands_Register(&ProfilerCommand);
+	Commands_Register(&NetCaptureCommand);
+	Commands_Register(&VorbisBenchCommand);
+	Commands_Register(&CompressBenchCommand);
+	Commands_Register(&MeshBenchCommand);
+	Commands_Register(&LightBenchCommand);
+	Commands_Register(&FlyBenchCommand);
+	Commands_Register(&CrowdBenchCommand);
+	Commands_Register(&TraceCommand);
+	Commands_Register(&MemStatsCommand);
+	Commands_Register(&HandlerCostCommand);
+	Commands_Register(&StartupCommand);
 }
 
 static void OnFree(void) {
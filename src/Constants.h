@@ -55,7 +55,8 @@ enum FACE_CONSTS {
 	FACE_ZMAX = 3, FACE_BIT_ZMAX = 1 << FACE_ZMAX, /* Face Z = 1 */
 	FACE_YMIN = 4, FACE_BIT_YMIN = 1 << FACE_YMIN, /* Face Y = 0 */
 	FACE_YMAX = 5, FACE_BIT_YMAX = 1 << FACE_YMAX, /* Face Y = 1 */
-	FACE_COUNT= 6  /* Number of faces on a cube */
+	FACE_COUNT= 6, /* Number of faces on a cube */
+	FACE_BITS_ALL = 0x3F /* Bitmask of all faces on a cube */
 };
 
 enum SKIN_TYPE { SKIN_64x32, SKIN_64x64, SKIN_64x64_SLIM, SKIN_INVALID = 0xF0 };
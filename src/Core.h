@@ -356,6 +356,10 @@ typedef cc_uint8  cc_bool;
 	#undef  CC_BUILD_RESOURCES
 	#undef  CC_BUILD_PLUGINS
 	#define DEFAULT_GFX_BACKEND CC_GFX_BACKEND_GL2
+	/* Compiled with -pthread (see 'web-threads' in Makefile) */
+	#ifdef __EMSCRIPTEN_PTHREADS__
+		#define CC_BUILD_WEBTHREADS
+	#endif
 #elif defined __psp__
 	#define CC_BUILD_PSP
 	#define CC_BUILD_CONSOLE
@@ -541,6 +545,51 @@ typedef cc_uint8  cc_bool;
 #undef CC_BUILD_PLUGINS
 #endif
 
+/* Chunk meshes can be built across multiple threads when both threads and cheap thread local storage are available */
+#if !defined CC_BUILD_COOPTHREADED && !defined CC_BUILD_CONSOLE && !defined CC_BUILD_LOWMEM
+	#if defined _MSC_VER
+		#define CC_THREADLOCAL __declspec(thread)
+		#define CC_BUILD_BUILDERTHREADS
+	#elif defined __GNUC__ && (defined CC_BUILD_LINUX || defined CC_BUILD_BSD)
+		#define CC_THREADLOCAL __thread
+		#define CC_BUILD_BUILDERTHREADS
+	#endif
+#elif defined CC_BUILD_WEBTHREADS
+	/* Rest of the web client still runs cooperatively on the browser main thread */
+	#define CC_THREADLOCAL __thread
+	#define CC_BUILD_BUILDERTHREADS
+#endif
+#ifndef CC_THREADLOCAL
+#define CC_THREADLOCAL
+#endif
+/* Event tracing records into a separate buffer for each thread, so also relies on thread local storage */
+#ifdef CC_BUILD_BUILDERTHREADS
+	#define CC_BUILD_TRACING
+#endif
+/* Log messages are written out by a background thread on desktop platforms, */
+/*  so that slow consoles and terminals don't block the thread that is logging */
+#if defined CC_BUILD_BUILDERTHREADS && !defined CC_BUILD_ANDROID && !defined CC_BUILD_UWP
+	#if defined CC_BUILD_WIN || defined CC_BUILD_LINUX || defined CC_BUILD_BSD
+		#define CC_BUILD_ASYNCLOG
+	#endif
+#endif
+/* Singleplayer block physics are simulated on a background thread, which needs real threads */
+#if defined CC_BUILD_BUILDERTHREADS && !defined CC_BUILD_WEBTHREADS && !defined CC_BUILD_PALETTEWORLD
+	#define CC_BUILD_PHYSICSTHREAD
+#endif
+/* SIMD instruction sets that the compiler targets, so can be used without checking the CPU at runtime */
+#if defined __SSE2__ || defined _M_X64 || (defined _M_IX86_FP && _M_IX86_FP >= 2)
+	#define CC_BUILD_SSE2
+	/* 32 bit x86 may still use x87 for float math, which gives slightly different results to SSE2 */
+	#if !defined __i386__ || defined __SSE2_MATH__
+		#define CC_BUILD_SSE2_MATH
+	#endif
+#elif defined __ARM_NEON && defined __aarch64__
+	#define CC_BUILD_NEON
+#endif
+/* Per place memory accounting (CC_BUILD_MEMSTATS) adds a hash table update to every allocation and free, */
+/*  so is only compiled in when explicitly defined, e.g. with -DCC_BUILD_MEMSTATS */
+
 #ifdef CC_BUILD_NETWORKING
 #define CUSTOM_MODELS
 #endif
@@ -1,4 +1,8 @@
 #include "Deflate.h"
+#if defined CC_BUILD_SSE2
+	#include <emmintrin.h>
+	#define ADLER32_SSE2
+#endif
 #include "String.h"
 #include "Logger.h"
 #include "Funcs.h"
@@ -152,7 +156,7 @@ enum INFLATE_STATE_ {
 };
 
 /* Insert next byte into the bit buffer */
-#define Inflate_GetByte(state) state->AvailIn--; state->Bits |= (cc_uint32)(*state->NextIn++) << state->NumBits; state->NumBits += 8;
+#define Inflate_GetByte(state) state->AvailIn--; state->Bits |= (cc_uintptr)(*state->NextIn++) << state->NumBits; state->NumBits += 8;
 /* Retrieves bits from the bit buffer */
 #define Inflate_PeekBits(state, bits) (state->Bits & ((1UL << (bits)) - 1UL))
 /* Consumes/eats up bits from the bit buffer */
@@ -165,6 +169,26 @@ enum INFLATE_STATE_ {
 #define Inflate_UNSAFE_EnsureBits(state, bitsCount) while (state->NumBits < bitsCount) { Inflate_GetByte(state); }
 /* Peeks then consumes given bits */
 #define Inflate_ReadBits(state, bitsCount) Inflate_PeekBits(state, bitsCount); Inflate_ConsumeBits(state, bitsCount);
+
+#define INFLATE_WORD_BITS (sizeof(cc_uintptr) * 8)
+#if defined __GNUC__ && (defined __i386__ || defined __x86_64__ || defined __aarch64__)
+/* Little endian and unaligned loads are cheap, so can read/copy a whole word at once */
+#define INFLATE_FAST_WORDS
+/* Tops up the bit buffer to at least (INFLATE_WORD_BITS - 8) bits, by loading a whole word of input */
+/* Bits above NumBits are then just the bits of the next input bytes, so ORing them in again later is harmless */
+#define Inflate_UNSAFE_Refill(state) \
+{\
+	cc_uintptr word; cc_uint32 used;\
+	__builtin_memcpy(&word, state->NextIn, sizeof(word));\
+	state->Bits    |= word << state->NumBits;\
+	used            = (INFLATE_WORD_BITS - 1 - state->NumBits) >> 3;\
+	state->NextIn  += used; state->AvailIn -= used;\
+	state->NumBits += used << 3;\
+}
+#else
+/* Loading bytes one at a time, so only load what's needed for the next huffman code */
+#define Inflate_UNSAFE_Refill(state) Inflate_UNSAFE_EnsureBits(state, INFLATE_MAX_BITS)
+#endif
 /* Sets to given result and sets state to DONE */
 #define Inflate_Fail(state, res) state->result = res; state->State = INFLATE_STATE_DONE;
 
@@ -175,6 +199,7 @@ enum INFLATE_STATE_ {
 /* The maximum amount of bytes that can be output is 258 */
 #define INFLATE_FASTINF_OUT 258
 /* The most input bytes required for huffman codes and extra data is 16 + 5 + 16 + 13 bits. Add 3 extra bytes to account for putting data into the bit buffer. */
+/* (this is also enough for Inflate_UNSAFE_Refill to always be able to load a whole word) */
 #define INFLATE_FASTINF_IN 10
 
 static cc_uint32 Huffman_ReverseBits(cc_uint32 n, cc_uint8 bits) {
@@ -306,15 +331,15 @@ static int Huffman_Decode(struct InflateState* state, struct HuffmanTable* table
 	return -1;
 }
 
-/* Inline the common <= 9 bits case */
+/* Inline the common <= INFLATE_FAST_BITS bits case */
 #define Huffman_UNSAFE_Decode(state, table, result) \
 {\
 	Inflate_UNSAFE_EnsureBits(state, INFLATE_MAX_BITS);\
 	packed = table.fast[Inflate_PeekBits(state, INFLATE_FAST_BITS)];\
 	if (packed >= 0) {\
-		consumedBits = packed >> INFLATE_FAST_BITS;\
+		consumedBits = packed >> INFLATE_FAST_LEN_SHIFT;\
 		Inflate_ConsumeBits(state, consumedBits);\
-		result = packed & 0x1FF;\
+		result = packed & INFLATE_FAST_VAL_MASK;\
 	} else {\
 		result = Huffman_UNSAFE_Decode_Slow(state, &table);\
 	}\
@@ -399,9 +424,56 @@ static const cc_uint8 codelens_order[INFLATE_MAX_CODELENS] = {
 	16,17,18,0,8,7,9,6,10,5,11,4,12,3,13,2,14,1,15 
 };
 
+/* Computes the lookup table for decoding two literals at once */
+static void Inflate_BuildLitPairs(struct InflateState* s) {
+	struct HuffmanTable* table = &s->Table.Lits;
+	int i, first, second, bits;
+
+	for (i = 0; i < (1 << INFLATE_FAST_BITS); i++) {
+		s->LitPairs[i] = 0;
+		first = table->fast[i];
+		if (first < 0 || (first & INFLATE_FAST_VAL_MASK) >= 256) continue;
+
+		/* Only the lowest 'INFLATE_FAST_BITS - first length' bits of the index are from the second codeword */
+		/* So the second codeword can only be decoded here if it isn't longer than that */
+		bits   = first >> INFLATE_FAST_LEN_SHIFT;
+		second = table->fast[i >> bits];
+		if (second < 0 || (second & INFLATE_FAST_VAL_MASK) >= 256) continue;
+
+		bits += second >> INFLATE_FAST_LEN_SHIFT;
+		if (bits > INFLATE_FAST_BITS) continue;
+		s->LitPairs[i] = (first & 0xFF) | ((second & 0xFF) << 8) | (bits << 16);
+	}
+}
+
+/* Copies 'len' bytes from 'dist' bytes back, where the copy may overlap with the bytes being written */
+static void Inflate_CopyMatch(cc_uint8* dst, cc_uint32 dist, cc_uint32 len) {
+	cc_uint8* end = dst + len;
+#ifdef INFLATE_FAST_WORDS
+	cc_uintptr word;
+	cc_uint32 i, step = dist;
+
+	/* Data repeats every 'dist' bytes, so it also repeats every multiple of 'dist' bytes */
+	/* Once there is at least a word of repeats, can copy a whole word at once without overlapping */
+	while (step < sizeof(word)) step *= 2;
+	for (i = dist; i < step && dst < end; i++, dst++) { *dst = dst[-(int)dist]; }
+
+	for (; dst + sizeof(word) <= end; dst += sizeof(word)) {
+		__builtin_memcpy(&word, dst - step, sizeof(word));
+		__builtin_memcpy(dst, &word, sizeof(word));
+	}
+#else
+	for (; dst + 4 <= end; dst += 4) {
+		dst[0] = dst[0 - (int)dist]; dst[1] = dst[1 - (int)dist];
+		dst[2] = dst[2 - (int)dist]; dst[3] = dst[3 - (int)dist];
+	}
+#endif
+	for (; dst < end; dst++) { *dst = dst[-(int)dist]; }
+}
+
 static void Inflate_InflateFast(struct InflateState* s) {
 	/* huffman variables */
-	cc_uint32 lit, len, dist;
+	cc_uint32 lit, len, dist, pair;
 	cc_uint32 bits, lenIdx, distIdx;
 	int packed, consumedBits;
 
@@ -417,6 +489,19 @@ static void Inflate_InflateFast(struct InflateState* s) {
 
 #define INFLATE_FAST_COPY_MAX (INFLATE_WINDOW_SIZE - INFLATE_FASTINF_OUT)
 	while (s->AvailOut >= INFLATE_FASTINF_OUT && s->AvailIn >= INFLATE_FASTINF_IN && copyLen < INFLATE_FAST_COPY_MAX) {
+		/* With a 64 bit buffer, there are now enough bits for a whole length + distance pair */
+		Inflate_UNSAFE_Refill(s);
+
+		pair = s->LitPairs[Inflate_PeekBits(s, INFLATE_FAST_BITS)];
+		if (pair) {
+			window[curIdx] = (cc_uint8)pair;
+			window[(curIdx + 1) & INFLATE_WINDOW_MASK] = (cc_uint8)(pair >> 8);
+			Inflate_ConsumeBits(s, pair >> 16);
+
+			s->AvailOut -= 2; copyLen += 2;
+			curIdx = (curIdx + 2) & INFLATE_WINDOW_MASK;
+			continue;
+		}
 		Huffman_UNSAFE_Decode(s, s->Table.Lits, lit);
 
 		if (lit <= 256) {
@@ -441,15 +526,10 @@ static void Inflate_InflateFast(struct InflateState* s) {
 	
 			/* Window infinitely repeats like ...xyz|uvwxyz|uvwxyz|uvw... */
 			/* If start and end don't cross a boundary, can avoid masking index */
+			/* (invalid distance codes give a distance of 0, which also has to go the slow way) */
 			startIdx = (curIdx - dist) & INFLATE_WINDOW_MASK;
-			if (curIdx >= startIdx && (curIdx + len) < INFLATE_WINDOW_SIZE) {
-				cc_uint8* src = &window[startIdx]; 
-				cc_uint8* dst = &window[curIdx];
-
-				for (i = 0; i < (len & ~0x3); i += 4) {
-					*dst++ = *src++; *dst++ = *src++; *dst++ = *src++; *dst++ = *src++;
-				}
-				for (; i < len; i++) { *dst++ = *src++; }
+			if (curIdx > startIdx && (curIdx + len) < INFLATE_WINDOW_SIZE) {
+				Inflate_CopyMatch(&window[curIdx], dist, len);
 			} else {
 				for (i = 0; i < len; i++) {
 					window[(curIdx + i) & INFLATE_WINDOW_MASK] = window[(startIdx + i) & INFLATE_WINDOW_MASK];
@@ -459,7 +539,6 @@ static void Inflate_InflateFast(struct InflateState* s) {
 			s->AvailOut -= len; copyLen += len;
 		}
 	}
-
 	s->WindowIndex = curIdx;
 	if (!copyLen) return;
 
@@ -507,6 +586,7 @@ void Inflate_Process(struct InflateState* s) {
 			case 1: { /* Fixed/static huffman compressed */
 				(void)Huffman_Build(&s->Table.Lits, fixed_lits,  INFLATE_MAX_LITS);
 				(void)Huffman_Build(&s->TableDists, fixed_dists, INFLATE_MAX_DISTS);
+				Inflate_BuildLitPairs(s);
 				s->State = Inflate_NextCompressState(s);
 			} break;
 
@@ -619,6 +699,7 @@ void Inflate_Process(struct InflateState* s) {
 				if (res) { Inflate_Fail(s, res); return; }
 				res = Huffman_Build(&s->TableDists, s->Buffer + s->NumLits, s->NumDists);
 				if (res) { Inflate_Fail(s, res); return; }
+				Inflate_BuildLitPairs(s);
 			}
 			break;
 		}
@@ -808,8 +889,8 @@ static const cc_uint16 deflate_dist[31] = {
 #define Deflate_PushBits(state, value, bits) state->Bits |= (value) << state->NumBits; state->NumBits += (bits);
 /* Pushes bits of the huffman codeword bits for the given literal, but does not write them */
 #define Deflate_PushLit(state, value) Deflate_PushBits(state, state->LitsCodewords[value], state->LitsLens[value])
-/* Pushes given bits (reversing for huffman code), but does not write them */
-#define Deflate_PushHuff(state, value, bits) Deflate_PushBits(state, Huffman_ReverseBits(value, bits), bits)
+/* Pushes bits of the huffman codeword bits for the given distance code, but does not write them */
+#define Deflate_PushDist(state, value) Deflate_PushBits(state, state->DistsCodewords[value], state->DistsLens[value])
 /* Writes given byte to output */
 #define Deflate_WriteByte(state) *state->NextOut++ = state->Bits; state->AvailOut--; state->Bits >>= 8; state->NumBits -= 8;
 /* Flushes bits in buffer to output buffer */
@@ -817,11 +898,49 @@ static const cc_uint16 deflate_dist[31] = {
 
 #define MIN_MATCH_LEN 3
 #define MAX_MATCH_LEN 258
+/* Marks an entry in Symbols as being a length (minus MIN_MATCH_LEN), followed by a distance entry */
+#define DEFLATE_SYM_MATCH 0x8000
+/* Max number of bits in a codeword for the code lengths huffman table */
+#define DEFLATE_MAX_CODELEN_BITS 7
+/* Max number of bits in a codeword for the literals/lengths and distances huffman tables */
+#define DEFLATE_MAX_CODE_BITS 15
+
+struct DeflateLevel {
+	cc_uint16 maxChain; /* Max number of previous matches to explore */
+	cc_uint16 niceLen;  /* Stop searching for a longer match once a match is at least this long */
+	cc_bool lazy;       /* Whether to check if a longer match starts at the next byte */
+	cc_bool insertAll;  /* Whether to insert every byte within a match into the hash chains */
+};
+static const struct DeflateLevel deflate_levels[DEFLATE_LEVEL_COUNT] = {
+	{    4,  32, false, false }, /* DEFLATE_LEVEL_FAST */
+	{   16, 128, true,  true  }, /* DEFLATE_LEVEL_NORMAL */
+	{ 1024, 258, true,  true  }  /* DEFLATE_LEVEL_MAX */
+};
+
+/* Length code (minus 257) for each match length */
+static cc_uint8 deflate_lenCodes[MAX_MATCH_LEN + 1];
+/* Distance code for distances 1 to 256, then distances 257 and above in steps of 128 */
+static cc_uint8 deflate_distCodes[512];
+#define Deflate_DistCode(dist) ((dist) <= 256 ? deflate_distCodes[(dist) - 1] : deflate_distCodes[256 + (((dist) - 1) >> 7)])
+
+static cc_uint16 deflate_fixedLitsCodewords[INFLATE_MAX_LITS];
+static cc_uint8  deflate_fixedLitsLens[INFLATE_MAX_LITS];
+static cc_uint16 deflate_fixedDistsCodewords[INFLATE_MAX_DISTS];
+static cc_uint8  deflate_fixedDistsLens[INFLATE_MAX_DISTS];
 
 /* Number of bytes that match (are the same) from a and b */
 static int Deflate_MatchLen(cc_uint8* a, cc_uint8* b, int maxLen) {
 	int i = 0;
-	while (i < maxLen && *a == *b) { i++; a++; b++; }
+#if defined __GNUC__ && (defined __i386__ || defined __x86_64__ || defined __aarch64__)
+	/* Compare 8 bytes at once, using the lowest differing byte to find where the match ends */
+	cc_uint64 x, y;
+	for (; i + 8 <= maxLen; i += 8) {
+		__builtin_memcpy(&x, a + i, 8);
+		__builtin_memcpy(&y, b + i, 8);
+		if (x != y) return i + (__builtin_ctzll(x ^ y) >> 3);
+	}
+#endif
+	while (i < maxLen && a[i] == b[i]) i++;
 	return i;
 }
 
@@ -839,15 +958,14 @@ static void Deflate_Lit(struct DeflateState* state, int lit) {
 /* Writes a length-distance pair to state->Output */
 static void Deflate_LenDist(struct DeflateState* state, int len, int dist) {
 	int j;
-	/* TODO: Do we actually need the if (len_bits[j]) ????????? does writing 0 bits matter??? */
 
-	for (j = 0; len >= deflate_len[j + 1]; j++);
+	j = deflate_lenCodes[len];
 	Deflate_PushLit(state, j + 257);
 	if (len_bits[j]) { Deflate_PushBits(state, len - deflate_len[j], len_bits[j]); }
 	Deflate_FlushBits(state);
 
-	for (j = 0; dist >= deflate_dist[j + 1]; j++);
-	Deflate_PushHuff(state, j, 5);
+	j = Deflate_DistCode(dist);
+	Deflate_PushDist(state, j);
 	if (dist_bits[j]) { Deflate_PushBits(state, dist - deflate_dist[j], dist_bits[j]); }
 	Deflate_FlushBits(state);
 }
@@ -867,91 +985,361 @@ static void Deflate_MoveBlock(struct DeflateState* state) {
 	}
 }
 
-/* Compresses current block of data */
-static cc_result Deflate_FlushBlock(struct DeflateState* state, int len) {
-	cc_uint32 hash, nextHash;
-	int bestLen, maxLen, matchLen, depth;
-	int bestPos, pos, nextPos;
-	cc_uint16 oldHead;
-	cc_uint8* input;
-	cc_uint8* cur;
-	cc_result res;
+/* Inserts the given position into the hash chains */
+static void Deflate_Insert(struct DeflateState* state, cc_uint8* cur) {
+	cc_uint32 hash = Deflate_Hash(cur);
+	int pos = (int)(cur - state->Input);
 
-	if (!state->WroteHeader) {
-		state->WroteHeader = true;
-		Deflate_PushBits(state, 3, 3); /* final block TRUE, block type FIXED */
+	state->Prev[pos]  = state->Head[hash];
+	state->Head[hash] = pos;
+}
+
+/* Finds the longest previous match for the data at cur, returning its length */
+static int Deflate_FindMatch(struct DeflateState* state, const struct DeflateLevel* level,
+							cc_uint8* cur, int maxLen, int bestLen, int* bestPos) {
+	cc_uint8* input = state->Input;
+	int pos, depth, matchLen;
+	int niceLen = min(maxLen, level->niceLen);
+
+	pos = state->Head[Deflate_Hash(cur)];
+	for (depth = 0; pos != 0 && depth < level->maxChain; depth++) {
+		/* Quickly skip over hash collisions and matches that can't be longer */
+		if (input[pos + bestLen] == cur[bestLen] && input[pos] == cur[0]) {
+			matchLen = Deflate_MatchLen(&input[pos], cur, maxLen);
+			if (matchLen > bestLen) {
+				bestLen = matchLen; *bestPos = pos;
+				if (bestLen >= niceLen) break;
+			}
+		}
+		pos = state->Prev[pos];
 	}
+	return bestLen;
+}
+
+/* Finds matches within the current block of data, and stores the resulting symbols in state->Symbols */
+static void Deflate_CompressBlock(struct DeflateState* state, int len) {
+	const struct DeflateLevel* level = &deflate_levels[state->Level];
+	cc_uint16* syms = state->Symbols;
+	int bestLen, maxLen, bestPos, nextPos, i;
+	cc_uint8* input = state->Input;
+	cc_uint8* cur   = input + DEFLATE_BLOCK_SIZE;
 
 	/* Based off descriptions from http://www.gzip.org/algorithm.txt and
 	https://github.com/nothings/stb/blob/master/stb_image_write.h */
-	input = state->Input;
-	cur   = input + DEFLATE_BLOCK_SIZE;
-
-	/* Compress current block of data */
 	/* Use > instead of >=, because also try match at one byte after current */
 	while (len > MIN_MATCH_LEN) {
-		hash   = Deflate_Hash(cur);
-		maxLen = min(len, MAX_MATCH_LEN);
-
-		bestLen = MIN_MATCH_LEN - 1; /* Match must be at least 3 bytes */
+		maxLen  = min(len, MAX_MATCH_LEN);
 		bestPos = 0;
-
-		/* Find longest match starting at this byte */
-		/* Only explore up to 5 previous matches, to avoid slow performance */
-		/* (i.e prefer quickly saving maps/screenshots to completely optimal filesize) */
-		pos = state->Head[hash];
-		for (depth = 0; pos != 0 && depth < 5; depth++) {
-			matchLen = Deflate_MatchLen(&input[pos], cur, maxLen);
-			if (matchLen > bestLen) { bestLen = matchLen; bestPos = pos; }
-			pos = state->Prev[pos];
-		}
-
-		/* Insert this entry into the hash chain */
-		pos = (int)(cur - input);
-		oldHead = state->Head[hash];
-		state->Head[hash] = pos;
-		state->Prev[pos]  = oldHead;
+		/* Match must be at least 3 bytes */
+		bestLen = Deflate_FindMatch(state, level, cur, maxLen, MIN_MATCH_LEN - 1, &bestPos);
+		Deflate_Insert(state, cur);
 
 		/* Lazy evaluation: Find longest match starting at next byte */
 		/* If that's longer than the longest match at current byte, throwaway this match */
-		if (bestPos) {
-			nextHash = Deflate_Hash(cur + 1);
-			nextPos  = state->Head[nextHash];
-			maxLen   = min(len - 1, MAX_MATCH_LEN);
-
-			for (depth = 0; nextPos != 0 && depth < 5; depth++) {
-				matchLen = Deflate_MatchLen(&input[nextPos], cur + 1, maxLen);
-				if (matchLen > bestLen) { bestPos = 0; break; }
-				nextPos = state->Prev[nextPos];
-			}
+		maxLen = min(len - 1, MAX_MATCH_LEN);
+		if (bestPos && level->lazy && bestLen < level->niceLen && bestLen < maxLen) {
+			nextPos = 0;
+			Deflate_FindMatch(state, level, cur + 1, maxLen, bestLen, &nextPos);
+			if (nextPos) bestPos = 0;
 		}
 
 		if (bestPos) {
-			Deflate_LenDist(state, bestLen, pos - bestPos);
+			*syms++ = DEFLATE_SYM_MATCH | (bestLen - MIN_MATCH_LEN);
+			*syms++ = (cc_uint16)((int)(cur - input) - bestPos);
+
+			if (level->insertAll) {
+				for (i = 1; i < bestLen && len - i > MIN_MATCH_LEN; i++) Deflate_Insert(state, cur + i);
+			}
 			len -= bestLen; cur += bestLen;
 		} else {
-			Deflate_Lit(state, *cur);
+			*syms++ = *cur;
 			len--; cur++;
 		}
-
-		/* leave room for a few bytes and literals at end */
-		if (state->AvailOut >= 20) continue;
-		res = Stream_Write(state->Dest, state->Output, DEFLATE_OUT_SIZE - state->AvailOut);
-		state->NextOut  = state->Output;
-		state->AvailOut = DEFLATE_OUT_SIZE;
-		if (res) return res;
 	}
 
 	/* literals for last few bytes */
 	while (len > 0) {
-		Deflate_Lit(state, *cur);
+		*syms++ = *cur;
 		len--; cur++;
 	}
+	state->NumSymbols = (int)(syms - state->Symbols);
+}
+
+/* Calculates optimal huffman codeword lengths for the given value frequencies, limited to maxBits */
+static void Deflate_BuildLengths(const cc_uint32* freqs, int count, int maxBits, cc_uint8* lens) {
+	int values[INFLATE_MAX_LITS], blCount[INFLATE_MAX_LITS];
+	cc_uint32 weights[INFLATE_MAX_LITS * 2];
+	int parents[INFLATE_MAX_LITS * 2];
+	int i, j, n = 0, value, leaf, node, next, child, maxDepth;
+
+	Mem_Set(lens, 0, count);
+	for (i = 0; i < count; i++) {
+		if (freqs[i]) values[n++] = i;
+	}
+
+	/* Decoders may not accept a tree with less than two codewords */
+	if (n < 2) {
+		value = n ? values[0] : 0;
+		lens[value] = 1; lens[value ? 0 : 1] = 1;
+		return;
+	}
+
+	/* Sort values by ascending frequency (insertion sort is fine, as count <= 288) */
+	for (i = 1; i < n; i++) {
+		value = values[i];
+		for (j = i; j > 0 && freqs[values[j - 1]] > freqs[value]; j--) {
+			values[j] = values[j - 1];
+		}
+		values[j] = value;
+	}
+	for (i = 0; i < n; i++) weights[i] = freqs[values[i]];
+
+	/* Combine the two lowest weight nodes until only the root is left */
+	/* Leaves are 0 to n-1 and internal nodes from n, both of which are ordered by weight */
+	leaf = 0; node = n;
+	for (next = n; next < 2 * n - 1; next++) {
+		weights[next] = 0;
+		for (j = 0; j < 2; j++) {
+			if (leaf < n && (node >= next || weights[leaf] <= weights[node])) {
+				child = leaf++;
+			} else {
+				child = node++;
+			}
+			weights[next] += weights[child];
+			parents[child] = next;
+		}
+	}
+
+	/* Parents always come after their children, so depths can be calculated from the root down */
+	parents[2 * n - 2] = 0;
+	for (i = 2 * n - 3; i >= 0; i--) {
+		parents[i] = parents[parents[i]] + 1;
+	}
+
+	for (i = 0; i < n; i++) blCount[i] = 0;
+	maxDepth = 0;
+	for (i = 0; i < n; i++) {
+		blCount[parents[i]]++;
+		maxDepth = max(maxDepth, parents[i]);
+	}
+
+	/* Move codewords deeper than maxBits up the tree (see JPEG spec, Annex K.3) */
+	for (i = maxDepth; i > maxBits; i--) {
+		while (blCount[i]) {
+			for (j = i - 2; !blCount[j]; j--) { }
+			blCount[i] -= 2;
+			blCount[i - 1]++;
+			blCount[j + 1] += 2;
+			blCount[j]--;
+		}
+	}
+
+	/* Least frequent values get the longest codewords */
+	for (i = min(maxDepth, maxBits), j = 0; i > 0; i--) {
+		for (value = 0; value < blCount[i]; value++) lens[values[j++]] = i;
+	}
+}
 
-	res = Stream_Write(state->Dest, state->Output, DEFLATE_OUT_SIZE - state->AvailOut);
+/* Constructs a huffman encoding table (for values to codewords) */
+static void Deflate_BuildTable(const cc_uint8* lens, int count, cc_uint16* codewords, cc_uint8* bitlens) {
+	int i, j, offset, codeword;
+	struct HuffmanTable table;
+
+	/* NOTE: Can ignore since lens table is not user controlled */
+	(void)Huffman_Build(&table, lens, count);
+	Mem_Set(bitlens, 0, count);
+
+	for (i = 0; i < INFLATE_MAX_BITS; i++) {
+		if (!table.endCodewords[i]) continue;
+		count = table.endCodewords[i] - table.firstCodewords[i];
+
+		for (j = 0; j < count; j++) {
+			offset   = table.values[table.firstOffsets[i] + j];
+			codeword = table.firstCodewords[i] + j;
+			bitlens[offset]   = i;
+			codewords[offset] = Huffman_ReverseBits(codeword, i);
+		}
+	}
+}
+
+/* Run length encodes the given codeword lengths, using the code lengths alphabet */
+/* Each code is stored in the lower 5 bits, with any extra repeat count bits above that */
+static int Deflate_EncodeLens(const cc_uint8* lens, int count, cc_uint16* codes) {
+	int i = 0, run, n, numCodes = 0;
+	int cur;
+
+	while (i < count) {
+		cur = lens[i];
+		for (run = 1; i + run < count && lens[i + run] == cur; run++) { }
+
+		if (!cur) {
+			for (; run >= 11; run -= n, i += n) {
+				n = min(run, 138);
+				codes[numCodes++] = 18 | ((n - 11) << 5);
+			}
+			if (run >= 3) {
+				codes[numCodes++] = 17 | ((run - 3) << 5);
+				i += run; run = 0;
+			}
+		} else {
+			codes[numCodes++] = cur;
+			i++; run--;
+
+			for (; run >= 3; run -= n, i += n) {
+				n = min(run, 6);
+				codes[numCodes++] = 16 | ((n - 3) << 5);
+			}
+		}
+
+		for (; run > 0; run--, i++) codes[numCodes++] = cur;
+	}
+	return numCodes;
+}
+
+static const cc_uint8 codelens_extraBits[3] = { 2, 3, 7 };
+
+/* Writes the header of a dynamic huffman block, returning the size of the header in bits */
+static cc_uint32 Deflate_DynamicHeader(struct DeflateState* state, cc_uint8* lens, int numLits, int numDists, cc_bool write) {
+	cc_uint16 codes[INFLATE_MAX_LITS_DISTS];
+	cc_uint32 freqs[INFLATE_MAX_CODELENS];
+	cc_uint8 clLens[INFLATE_MAX_CODELENS], clBitLens[INFLATE_MAX_CODELENS];
+	cc_uint16 clCodewords[INFLATE_MAX_CODELENS];
+	int i, code, numCodes, numCodeLens;
+	cc_uint32 bits;
+
+	numCodes = Deflate_EncodeLens(lens, numLits + numDists, codes);
+	Mem_Set(freqs, 0, sizeof(freqs));
+	for (i = 0; i < numCodes; i++) freqs[codes[i] & 0x1F]++;
+
+	Deflate_BuildLengths(freqs, INFLATE_MAX_CODELENS, DEFLATE_MAX_CODELEN_BITS, clLens);
+	for (numCodeLens = INFLATE_MAX_CODELENS; numCodeLens > 4; numCodeLens--) {
+		if (clLens[codelens_order[numCodeLens - 1]]) break;
+	}
+
+	bits = 3 + 5 + 5 + 4 + numCodeLens * 3;
+	for (i = 0; i < numCodes; i++) {
+		code  = codes[i] & 0x1F;
+		bits += clLens[code] + (code >= 16 ? codelens_extraBits[code - 16] : 0);
+	}
+	if (!write) return bits;
+	Deflate_BuildTable(clLens, INFLATE_MAX_CODELENS, clCodewords, clBitLens);
+
+	Deflate_PushBits(state, numLits  - 257, 5);
+	Deflate_PushBits(state, numDists - 1,   5);
+	Deflate_PushBits(state, numCodeLens - 4, 4);
+	Deflate_FlushBits(state);
+
+	for (i = 0; i < numCodeLens; i++) {
+		Deflate_PushBits(state, clLens[codelens_order[i]], 3);
+		Deflate_FlushBits(state);
+	}
+
+	for (i = 0; i < numCodes; i++) {
+		code = codes[i] & 0x1F;
+		Deflate_PushBits(state, clCodewords[code], clLens[code]);
+		if (code >= 16) { Deflate_PushBits(state, codes[i] >> 5, codelens_extraBits[code - 16]); }
+		Deflate_FlushBits(state);
+	}
+	return bits;
+}
+
+/* Writes the current contents of the Output buffer to the destination stream */
+static cc_result Deflate_FlushOutput(struct DeflateState* state) {
+	cc_result res = Stream_Write(state->Dest, state->Output, DEFLATE_OUT_SIZE - state->AvailOut);
 	state->NextOut  = state->Output;
 	state->AvailOut = DEFLATE_OUT_SIZE;
+	return res;
+}
+
+/* Picks whichever of fixed or dynamic huffman codes results in the smaller block, then writes the block header */
+static void Deflate_WriteHeader(struct DeflateState* state, cc_bool final) {
+	cc_uint32 litFreqs[INFLATE_MAX_LITS], distFreqs[INFLATE_MAX_DISTS];
+	cc_uint8 lens[INFLATE_MAX_LITS_DISTS];
+	cc_uint16* syms = state->Symbols;
+	cc_uint32 fixedBits, dynamicBits;
+	int i, numLits, numDists;
+
+	Mem_Set(litFreqs,  0, sizeof(litFreqs));
+	Mem_Set(distFreqs, 0, sizeof(distFreqs));
+	for (i = 0; i < state->NumSymbols; i++) {
+		if (syms[i] & DEFLATE_SYM_MATCH) {
+			litFreqs[257 + deflate_lenCodes[(syms[i] & 0xFF) + MIN_MATCH_LEN]]++;
+			i++;
+			distFreqs[Deflate_DistCode(syms[i])]++;
+		} else {
+			litFreqs[syms[i]]++;
+		}
+	}
+	litFreqs[256] = 1; /* End of block */
+
+	Deflate_BuildLengths(litFreqs,  INFLATE_MAX_LITS,  DEFLATE_MAX_CODE_BITS, lens);
+	Deflate_BuildLengths(distFreqs, INFLATE_MAX_DISTS, DEFLATE_MAX_CODE_BITS, lens + INFLATE_MAX_LITS);
+	for (numLits  = INFLATE_MAX_LITS;  numLits  > 257 && !lens[numLits - 1]; numLits--) { }
+	for (numDists = INFLATE_MAX_DISTS; numDists > 1   && !lens[INFLATE_MAX_LITS + numDists - 1]; numDists--) { }
+	/* Distance lengths must directly follow literal lengths */
+	Mem_Move(lens + numLits, lens + INFLATE_MAX_LITS, numDists);
+
+	/* Extra bits of lengths and distances are the same for both kinds of blocks, so can be ignored */
+	fixedBits   = 3;
+	dynamicBits = Deflate_DynamicHeader(state, lens, numLits, numDists, false);
+	for (i = 0; i < INFLATE_MAX_LITS; i++) {
+		fixedBits   += litFreqs[i] * fixed_lits[i];
+		dynamicBits += litFreqs[i] * (i < numLits ? lens[i] : 0);
+	}
+	for (i = 0; i < INFLATE_MAX_DISTS; i++) {
+		fixedBits   += distFreqs[i] * fixed_dists[i];
+		dynamicBits += distFreqs[i] * (i < numDists ? lens[numLits + i] : 0);
+	}
+
+	if (fixedBits <= dynamicBits) {
+		Deflate_PushBits(state, final | (1 << 1), 3); /* block type FIXED */
+		Mem_Copy(state->LitsCodewords,  deflate_fixedLitsCodewords,  sizeof(state->LitsCodewords));
+		Mem_Copy(state->LitsLens,       deflate_fixedLitsLens,       sizeof(state->LitsLens));
+		Mem_Copy(state->DistsCodewords, deflate_fixedDistsCodewords, sizeof(state->DistsCodewords));
+		Mem_Copy(state->DistsLens,      deflate_fixedDistsLens,      sizeof(state->DistsLens));
+	} else {
+		Deflate_PushBits(state, final | (2 << 1), 3); /* block type DYNAMIC */
+		Deflate_DynamicHeader(state, lens, numLits, numDists, true);
+		Deflate_BuildTable(lens,           numLits,  state->LitsCodewords,  state->LitsLens);
+		Deflate_BuildTable(lens + numLits, numDists, state->DistsCodewords, state->DistsLens);
+	}
+	Deflate_FlushBits(state);
+}
+
+/* Compresses current block of data */
+static cc_result Deflate_FlushBlock(struct DeflateState* state, int len, cc_bool final) {
+	cc_uint16* syms = state->Symbols;
+	cc_result res;
+	int i;
 
+	Deflate_CompressBlock(state, len);
+	/* Dynamic block header can be several hundred bytes */
+	if (state->AvailOut < 1024 && (res = Deflate_FlushOutput(state))) return res;
+	Deflate_WriteHeader(state, final);
+
+	for (i = 0; i < state->NumSymbols; i++) {
+		if (syms[i] & DEFLATE_SYM_MATCH) {
+			Deflate_LenDist(state, (syms[i] & 0xFF) + MIN_MATCH_LEN, syms[i + 1]);
+			i++;
+		} else {
+			Deflate_Lit(state, syms[i]);
+		}
+
+		/* leave room for a few bytes and literals at end */
+		if (state->AvailOut >= 20) continue;
+		if ((res = Deflate_FlushOutput(state))) return res;
+	}
+
+	/* Write huffman encoded "literal 256" to terminate symbols */
+	Deflate_Lit(state, 256);
+
+	/* In case last byte still has a few extra bits */
+	if (final && state->NumBits) {
+		while (state->NumBits < 8) { Deflate_PushBits(state, 0, 1); }
+		Deflate_FlushBits(state);
+	}
+
+	res = Deflate_FlushOutput(state);
 	Deflate_MoveBlock(state);
 	return res;
 }
@@ -978,53 +1366,37 @@ static cc_result Deflate_StreamWrite(struct Stream* stream, const cc_uint8* data
 		data += len;
 
 		if (state->InputPosition == DEFLATE_BUFFER_SIZE) {
-			res = Deflate_FlushBlock(state, DEFLATE_BLOCK_SIZE);
+			res = Deflate_FlushBlock(state, DEFLATE_BLOCK_SIZE, false);
 			if (res) return res;
 		}
 	}
 	return 0;
 }
 
-/* Flushes any buffered data, then writes terminating symbol */
+/* Flushes any buffered data as the final block */
 static cc_result Deflate_StreamClose(struct Stream* stream) {
-	struct DeflateState* state;
-	cc_result res;
-
-	state = (struct DeflateState*)stream->meta.inflate;
-	res   = Deflate_FlushBlock(state, state->InputPosition - DEFLATE_BLOCK_SIZE);
-	if (res) return res;
-
-	/* Write huffman encoded "literal 256" to terminate symbols */
-	Deflate_PushLit(state, 256);
-	Deflate_FlushBits(state);
-
-	/* In case last byte still has a few extra bits */
-	if (state->NumBits) {
-		while (state->NumBits < 8) { Deflate_PushBits(state, 0, 1); }
-		Deflate_FlushBits(state);
-	}
-
-	return Stream_Write(state->Dest, state->Output, DEFLATE_OUT_SIZE - state->AvailOut);
+	struct DeflateState* state = (struct DeflateState*)stream->meta.inflate;
+	return Deflate_FlushBlock(state, state->InputPosition - DEFLATE_BLOCK_SIZE, true);
 }
 
-/* Constructs a huffman encoding table (for values to codewords) */
-static void Deflate_BuildTable(const cc_uint8* lens, int count, cc_uint16* codewords, cc_uint8* bitlens) {
-	int i, j, offset, codeword;
-	struct HuffmanTable table;
-
-	/* NOTE: Can ignore since lens table is not user controlled */
-	(void)Huffman_Build(&table, lens, count);
-	for (i = 0; i < INFLATE_MAX_BITS; i++) {
-		if (!table.endCodewords[i]) continue;
-		count = table.endCodewords[i] - table.firstCodewords[i];
+static void Deflate_InitTables(void) {
+	static cc_bool inited;
+	int i, j;
+	if (inited) return;
 
-		for (j = 0; j < count; j++) {
-			offset   = table.values[table.firstOffsets[i] + j];
-			codeword = table.firstCodewords[i] + j;
-			bitlens[offset]   = i;
-			codewords[offset] = Huffman_ReverseBits(codeword, i);
-		}
+	for (i = MIN_MATCH_LEN, j = 0; i <= MAX_MATCH_LEN; i++) {
+		if (i >= deflate_len[j + 1]) j++;
+		deflate_lenCodes[i] = j;
+	}
+	for (i = 1, j = 0; i <= 32768; i++) {
+		if (i >= deflate_dist[j + 1]) j++;
+		if (i <= 256) { deflate_distCodes[i - 1] = j; }
+		else          { deflate_distCodes[256 + ((i - 1) >> 7)] = j; }
 	}
+
+	Deflate_BuildTable(fixed_lits,  INFLATE_MAX_LITS,  deflate_fixedLitsCodewords,  deflate_fixedLitsLens);
+	Deflate_BuildTable(fixed_dists, INFLATE_MAX_DISTS, deflate_fixedDistsCodewords, deflate_fixedDistsLens);
+	inited = true;
 }
 
 void Deflate_MakeStream(struct Stream* stream, struct DeflateState* state, struct Stream* underlying) {
@@ -1041,11 +1413,11 @@ void Deflate_MakeStream(struct Stream* stream, struct DeflateState* state, struc
 	state->NextOut  = state->Output;
 	state->AvailOut = DEFLATE_OUT_SIZE;
 	state->Dest     = underlying;
-	state->WroteHeader = false;
+	state->Level    = DEFLATE_LEVEL_NORMAL;
 
 	Mem_Set(state->Head, 0, sizeof(state->Head));
 	Mem_Set(state->Prev, 0, sizeof(state->Prev));
-	Deflate_BuildTable(fixed_lits, INFLATE_MAX_LITS, state->LitsCodewords, state->LitsLens);
+	Deflate_InitTables();
 }
 
 
@@ -1065,15 +1437,8 @@ static cc_result GZip_StreamClose(struct Stream* stream) {
 
 static cc_result GZip_StreamWrite(struct Stream* stream, const cc_uint8* data, cc_uint32 count, cc_uint32* modified) {
 	struct GZipState* state = (struct GZipState*)stream->meta.inflate;
-	cc_uint32 i, crc32 = state->Crc32;
 	state->Size += count;
-
-	/* TODO: Optimise this calculation */
-	for (i = 0; i < count; i++) {
-		crc32 = Utils_Crc32Table[(crc32 ^ data[i]) & 0xFF] ^ (crc32 >> 8);
-	}
-
-	state->Crc32 = crc32;
+	state->Crc32 = Utils_UpdateCRC32(state->Crc32, data, count);
 	return Deflate_StreamWrite(stream, data, count, modified);
 }
 
@@ -1096,6 +1461,296 @@ void GZip_MakeStream(struct Stream* stream, struct GZipState* state, struct Stre
 }
 
 
+/*########################################################################################################################*
+*-------------------------------------------------Parallel GZip (compress)------------------------------------------------*
+*#########################################################################################################################*/
+#ifdef CC_BUILD_BUILDERTHREADS
+#define PGZIP_MAX_THREADS 16
+/* Amount of input data compressed independently by a worker thread */
+#define PGZIP_PART_SIZE (1024 * 1024)
+/* Each block is at worst written with fixed codes (9 bits per byte), then a few bytes to end the part */
+#define PGZIP_OUTPUT_SIZE (PGZIP_PART_SIZE / 8 * 9 + (PGZIP_PART_SIZE / DEFLATE_BLOCK_SIZE + 1) * 4 + 64)
+
+struct PGZipPart {
+	cc_uint8* data;   /* Dictionary (end of previous part), followed by the input data of this part */
+	cc_uint8* output; /* Compressed output of this part */
+	int dictLen, length;
+	cc_uint32 outputLen;
+	cc_bool final, done;
+	cc_result res;
+};
+
+/* Parts are filled and written out in order on the main thread, and compressed by worker threads */
+/* Part N is always compressed by worker thread N % numThreads */
+static struct ParallelGZipState {
+	struct PGZipPart parts[PGZIP_MAX_THREADS * 2];
+	struct DeflateState* deflaters[PGZIP_MAX_THREADS];
+	void* threads[PGZIP_MAX_THREADS];
+	void* signals[PGZIP_MAX_THREADS];
+	void* mutex;
+	void* doneSignal;
+	int numThreads, numParts, startedCount;
+	int submitted, written; /* Number of parts submitted for compression, and already written out */
+	cc_bool active, quit;
+	cc_uint8 level;
+	struct Stream* dest;
+	cc_uint32 crc32, size;
+	cc_result res;
+} pgzip;
+
+/* Ends a part of compressed data, without ending the whole DEFLATE stream */
+static cc_result Deflate_SyncFlush(struct DeflateState* state) {
+	cc_result res = Deflate_FlushBlock(state, state->InputPosition - DEFLATE_BLOCK_SIZE, false);
+	if (res) return res;
+
+	/* Empty stored block, which also aligns output to a byte boundary */
+	Deflate_PushBits(state, 0, 3);
+	if (state->NumBits & 7) { Deflate_PushBits(state, 0, 8 - (state->NumBits & 7)); }
+	Deflate_FlushBits(state);
+
+	state->NextOut[0] = 0x00; state->NextOut[1] = 0x00;
+	state->NextOut[2] = 0xFF; state->NextOut[3] = 0xFF;
+	state->NextOut += 4; state->AvailOut -= 4;
+	return Deflate_FlushOutput(state);
+}
+
+/* Makes the given data be the "previous block", so that matches can be found within it */
+static void Deflate_SetDictionary(struct DeflateState* state, const cc_uint8* data, int len) {
+	int i, beg = DEFLATE_BLOCK_SIZE - len;
+	Mem_Copy(state->Input + beg, data, len);
+
+	/* Position 0 is used to mean no entry in the hash chains */
+	for (i = max(beg, 1); i < DEFLATE_BLOCK_SIZE - 2; i++) {
+		Deflate_Insert(state, state->Input + i);
+	}
+}
+
+static cc_result PGZip_OutputWrite(struct Stream* s, const cc_uint8* data, cc_uint32 count, cc_uint32* modified) {
+	*modified = 0;
+	if (count > s->meta.mem.left) return ERR_END_OF_STREAM;
+
+	Mem_Copy(s->meta.mem.cur, data, count);
+	s->meta.mem.cur  += count;
+	s->meta.mem.left -= count;
+	*modified = count;
+	return 0;
+}
+
+static void PGZip_Compress(struct DeflateState* deflater, struct PGZipPart* part) {
+	struct Stream out, comp;
+	cc_result res;
+
+	Stream_Init(&out);
+	out.Write = PGZip_OutputWrite;
+	out.meta.mem.cur  = part->output;
+	out.meta.mem.left = PGZIP_OUTPUT_SIZE;
+
+	Deflate_MakeStream(&comp, deflater, &out);
+	deflater->Level = pgzip.level;
+	Deflate_SetDictionary(deflater, part->data, part->dictLen);
+
+	res = Stream_Write(&comp, part->data + part->dictLen, part->length);
+	if (!res) res = part->final ? comp.Close(&comp) : Deflate_SyncFlush(deflater);
+
+	part->res       = res;
+	part->outputLen = PGZIP_OUTPUT_SIZE - out.meta.mem.left;
+}
+
+static void PGZip_WorkerLoop(void) {
+	cc_bool available, quit;
+	int id, seq;
+
+	Mutex_Lock(pgzip.mutex);
+	id = pgzip.startedCount++;
+	Mutex_Unlock(pgzip.mutex);
+
+	for (seq = id;;) {
+		Mutex_Lock(pgzip.mutex);
+		available = seq < pgzip.submitted;
+		quit      = pgzip.quit;
+		Mutex_Unlock(pgzip.mutex);
+
+		if (!available) {
+			if (quit) return;
+			Waitable_Wait(pgzip.signals[id]); continue;
+		}
+
+		PGZip_Compress(pgzip.deflaters[id], &pgzip.parts[seq % pgzip.numParts]);
+		Mutex_Lock(pgzip.mutex);
+		pgzip.parts[seq % pgzip.numParts].done = true;
+		Mutex_Unlock(pgzip.mutex);
+
+		Waitable_Signal(pgzip.doneSignal);
+		seq += pgzip.numThreads;
+	}
+}
+
+/* Waits for the oldest part not yet written out to be compressed, then writes it out */
+static cc_result PGZip_WriteNext(void) {
+	static const cc_uint8 header[10] = { 0x1F, 0x8B, 0x08 }; /* GZip header */
+	struct PGZipPart* part = &pgzip.parts[pgzip.written % pgzip.numParts];
+	cc_bool done;
+
+	for (;;) {
+		Mutex_Lock(pgzip.mutex);
+		done = part->done;
+		Mutex_Unlock(pgzip.mutex);
+
+		if (done) break;
+		Waitable_Wait(pgzip.doneSignal);
+	}
+
+	/* After an error, parts are still waited on but no longer written */
+	if (!pgzip.res && !pgzip.written) pgzip.res = Stream_Write(pgzip.dest, header, sizeof(header));
+	if (!pgzip.res) pgzip.res = part->res;
+	if (!pgzip.res) pgzip.res = Stream_Write(pgzip.dest, part->output, part->outputLen);
+
+	part->done = false;
+	pgzip.written++;
+	return pgzip.res;
+}
+
+/* Queues the part currently being filled to be compressed, then prepares the next part to be filled */
+static cc_result PGZip_Submit(cc_bool final) {
+	struct PGZipPart* part = &pgzip.parts[pgzip.submitted % pgzip.numParts];
+	struct PGZipPart* next;
+	cc_result res;
+	int id = pgzip.submitted % pgzip.numThreads;
+	part->final = final;
+
+	Mutex_Lock(pgzip.mutex);
+	pgzip.submitted++;
+	Mutex_Unlock(pgzip.mutex);
+	Waitable_Signal(pgzip.signals[id]);
+	if (final) return 0;
+
+	/* Next part can only be reused once its previous contents have been written out */
+	while (pgzip.submitted - pgzip.written >= pgzip.numParts) {
+		if ((res = PGZip_WriteNext())) return res;
+	}
+
+	next = &pgzip.parts[pgzip.submitted % pgzip.numParts];
+	next->dictLen = DEFLATE_BLOCK_SIZE;
+	next->length  = 0;
+	Mem_Copy(next->data, part->data + part->dictLen + part->length - DEFLATE_BLOCK_SIZE, DEFLATE_BLOCK_SIZE);
+	return 0;
+}
+
+static cc_result PGZip_StreamWrite(struct Stream* stream, const cc_uint8* data, cc_uint32 total, cc_uint32* modified) {
+	struct PGZipPart* part;
+	cc_uint32 len;
+	cc_result res;
+	*modified = 0;
+
+	while (total > 0) {
+		part = &pgzip.parts[pgzip.submitted % pgzip.numParts];
+		len  = min(total, (cc_uint32)(PGZIP_PART_SIZE - part->length));
+		Mem_Copy(part->data + part->dictLen + part->length, data, len);
+
+		pgzip.crc32 = Utils_UpdateCRC32(pgzip.crc32, data, len);
+		pgzip.size += len;
+
+		part->length += len;
+		*modified    += len;
+		data  += len;
+		total -= len;
+
+		if (part->length < PGZIP_PART_SIZE) continue;
+		if ((res = PGZip_Submit(false))) return res;
+	}
+	return 0;
+}
+
+static void PGZip_Free(void) {
+	int i;
+	if (pgzip.mutex) {
+		Mutex_Lock(pgzip.mutex);
+		pgzip.quit = true;
+		Mutex_Unlock(pgzip.mutex);
+	}
+
+	for (i = 0; i < pgzip.numThreads; i++) {
+		if (!pgzip.threads[i]) continue;
+		Waitable_Signal(pgzip.signals[i]);
+		Thread_Join(pgzip.threads[i]);
+	}
+	for (i = 0; i < pgzip.numThreads; i++) {
+		if (pgzip.signals[i]) Waitable_Free(pgzip.signals[i]);
+		Mem_Free(pgzip.deflaters[i]);
+	}
+	for (i = 0; i < pgzip.numParts; i++) {
+		Mem_Free(pgzip.parts[i].data);
+		Mem_Free(pgzip.parts[i].output);
+	}
+
+	if (pgzip.doneSignal) Waitable_Free(pgzip.doneSignal);
+	if (pgzip.mutex)      Mutex_Free(pgzip.mutex);
+	Mem_Set(&pgzip, 0, sizeof(pgzip));
+}
+
+static cc_result PGZip_StreamClose(struct Stream* stream) {
+	cc_uint8 data[8];
+	cc_result res;
+
+	PGZip_Submit(true);
+	while (pgzip.written < pgzip.submitted) PGZip_WriteNext();
+
+	if (!pgzip.res) {
+		Stream_SetU32_LE(&data[0], pgzip.crc32 ^ 0xFFFFFFFFUL);
+		Stream_SetU32_LE(&data[4], pgzip.size);
+		pgzip.res = Stream_Write(pgzip.dest, data, sizeof(data));
+	}
+
+	res = pgzip.res;
+	PGZip_Free();
+	return res;
+}
+
+cc_bool GZip_MakeParallelStream(struct Stream* stream, struct Stream* underlying, int level, int threads) {
+	int i;
+	if (pgzip.active || threads <= 0) return false;
+
+	pgzip.active     = true;
+	pgzip.numThreads = min(threads, PGZIP_MAX_THREADS);
+	pgzip.numParts   = pgzip.numThreads * 2;
+	pgzip.level      = level;
+	pgzip.dest       = underlying;
+	pgzip.crc32      = 0xFFFFFFFFUL;
+
+	for (i = 0; i < pgzip.numThreads; i++) {
+		pgzip.deflaters[i] = (struct DeflateState*)Mem_TryAlloc(1, sizeof(struct DeflateState));
+		if (!pgzip.deflaters[i]) { PGZip_Free(); return false; }
+	}
+	for (i = 0; i < pgzip.numParts; i++) {
+		pgzip.parts[i].data   = (cc_uint8*)Mem_TryAlloc(DEFLATE_BLOCK_SIZE + PGZIP_PART_SIZE, 1);
+		pgzip.parts[i].output = (cc_uint8*)Mem_TryAlloc(PGZIP_OUTPUT_SIZE, 1);
+		if (!pgzip.parts[i].data || !pgzip.parts[i].output) { PGZip_Free(); return false; }
+	}
+
+	/* Tables must be initialised before Deflate_MakeStream is called across multiple threads */
+	Deflate_InitTables();
+	pgzip.mutex      = Mutex_Create("GZip parts");
+	pgzip.doneSignal = Waitable_Create("GZip part done");
+
+	for (i = 0; i < pgzip.numThreads; i++) {
+		pgzip.signals[i] = Waitable_Create("GZip worker");
+	}
+	for (i = 0; i < pgzip.numThreads; i++) {
+		Thread_Run(&pgzip.threads[i], PGZip_WorkerLoop, 256 * 1024, "GZip compressor");
+	}
+	Stream_Init(stream);
+	stream->meta.inflate = &pgzip;
+	stream->Write = PGZip_StreamWrite;
+	stream->Close = PGZip_StreamClose;
+	return true;
+}
+#else
+cc_bool GZip_MakeParallelStream(struct Stream* stream, struct Stream* underlying, int level, int threads) {
+	return false;
+}
+#endif
+
+
 /*########################################################################################################################*
 *-----------------------------------------------------ZLib (compress)-----------------------------------------------------*
 *#########################################################################################################################*/
@@ -1109,19 +1764,72 @@ static cc_result ZLib_StreamClose(struct Stream* stream) {
 	return Stream_Write(state->Base.Dest, data, sizeof(data));
 }
 
-static cc_result ZLib_StreamWrite(struct Stream* stream, const cc_uint8* data, cc_uint32 count, cc_uint32* modified) {
-	struct ZLibState* state = (struct ZLibState*)stream->meta.inflate;
-	cc_uint32 i, adler32 = state->Adler32;
+#define ADLER32_BASE 65521
+/* Largest number of bytes that can be summed before s2 might overflow 32 bits */
+#define ADLER32_NMAX 5552
+
+#ifdef ADLER32_SSE2
+static cc_uint32 Adler32_Sum(__m128i v) {
+	v = _mm_add_epi32(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2)));
+	v = _mm_add_epi32(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(2, 3, 0, 1)));
+	return (cc_uint32)_mm_cvtsi128_si32(v);
+}
+
+/* NOTE: count must be a multiple of 16 */
+static void Adler32_SSE2(cc_uint32* s1, cc_uint32* s2, const cc_uint8* data, cc_uint32 count) {
+	__m128i zero  = _mm_setzero_si128();
+	__m128i losW  = _mm_setr_epi16(16, 15, 14, 13, 12, 11, 10, 9);
+	__m128i hisW  = _mm_setr_epi16( 8,  7,  6,  5,  4,  3,  2, 1);
+	__m128i vs1   = zero, vs2 = zero, prev = zero;
+	__m128i v;
+	cc_uint32 i;
+
+	/* Byte j of n bytes adds (n - j) * byte to s2, which is computed as: */
+	/*   (16 - index within its 16 bytes) * byte + */
+	/*   16 * (number of later groups of 16 bytes) * byte */
+	for (i = 0; i < count; i += 16) {
+		v    = _mm_loadu_si128((const __m128i*)(data + i));
+		prev = _mm_add_epi32(prev, vs1);
+		vs1  = _mm_add_epi32(vs1, _mm_sad_epu8(v, zero));
+
+		vs2  = _mm_add_epi32(vs2, _mm_madd_epi16(_mm_unpacklo_epi8(v, zero), losW));
+		vs2  = _mm_add_epi32(vs2, _mm_madd_epi16(_mm_unpackhi_epi8(v, zero), hisW));
+	}
+
+	*s2 += count * *s1 + Adler32_Sum(vs2) + (Adler32_Sum(prev) << 4);
+	*s1 += Adler32_Sum(vs1);
+}
+#endif
+
+static cc_uint32 ZLib_Adler32(cc_uint32 adler32, const cc_uint8* data, cc_uint32 count) {
 	cc_uint32 s1 = adler32 & 0xFFFF, s2 = (adler32 >> 16) & 0xFFFF;
+	cc_uint32 len;
 
-	/* TODO: Optimise this calculation */
-	for (i = 0; i < count; i++) {
-		#define ADLER32_BASE 65521
-		s1 = (s1 + data[i]) % ADLER32_BASE;
-		s2 = (s2 + s1)      % ADLER32_BASE;
+	/* Only need to apply the modulo every ADLER32_NMAX bytes */
+	while (count) {
+		len    = min(count, ADLER32_NMAX);
+		count -= len;
+
+#ifdef ADLER32_SSE2
+		Adler32_SSE2(&s1, &s2, data, len & ~15);
+		data += len & ~15; len &= 15;
+#endif
+		for (; len >= 4; len -= 4, data += 4) {
+			s1 += data[0]; s2 += s1; s1 += data[1]; s2 += s1;
+			s1 += data[2]; s2 += s1; s1 += data[3]; s2 += s1;
+		}
+		for (; len; len--, data++) {
+			s1 += *data; s2 += s1;
+		}
+		s1 %= ADLER32_BASE;
+		s2 %= ADLER32_BASE;
 	}
+	return (s2 << 16) | s1;
+}
 
-	state->Adler32 = (s2 << 16) | s1;
+static cc_result ZLib_StreamWrite(struct Stream* stream, const cc_uint8* data, cc_uint32 count, cc_uint32* modified) {
+	struct ZLibState* state = (struct ZLibState*)stream->meta.inflate;
+	state->Adler32 = ZLib_Adler32(state->Adler32, data, count);
 	return Deflate_StreamWrite(stream, data, count, modified);
 }
 
@@ -1225,12 +1933,9 @@ static cc_result Zip_ReadLocalFileHeader(struct ZipState* state, struct ZipEntry
 	return res;
 }
 
-static cc_result Zip_ReadCentralDirectory(struct ZipState* state) {
-	struct Stream* stream = state->source;
-	struct ZipEntry* entry;
+/* Reads a central directory entry header and its path (path's buffer must be at least ZIP_MAXNAMELEN long) */
+static cc_result Zip_ReadCentralHeader(struct Stream* stream, struct ZipEntry* entry, cc_string* path) {
 	cc_uint8 header[42];
-
-	cc_string path; char pathBuffer[ZIP_MAXNAMELEN];
 	int pathLen, extraLen, commentLen;
 	cc_result res;
 
@@ -1239,21 +1944,33 @@ static cc_result Zip_ReadCentralDirectory(struct ZipState* state) {
 	if (pathLen > ZIP_MAXNAMELEN) return ZIP_ERR_FILENAME_LEN;
 
 	/* NOTE: ZIP spec says path uses code page 437 for encoding */
-	path = String_Init(pathBuffer, pathLen, pathLen);
-	if ((res = Stream_Read(stream, (cc_uint8*)pathBuffer, pathLen))) return res;
+	path->length = pathLen;
+	if ((res = Stream_Read(stream, (cc_uint8*)path->buffer, pathLen))) return res;
 
 	/* skip data following central directory entry header */
 	extraLen   = Stream_GetU16_LE(&header[26]);
 	commentLen = Stream_GetU16_LE(&header[28]);
 	if ((res = stream->Skip(stream, extraLen + commentLen))) return res;
 
-	if (!state->SelectEntry(&path)) return 0;
-	if (state->usedEntries >= state->maxEntries) return ZIP_ERR_TOO_MANY_ENTRIES;
-	entry = &state->entries[state->usedEntries++];
-
 	entry->CompressedSize    = Stream_GetU32_LE(&header[16]);
 	entry->UncompressedSize  = Stream_GetU32_LE(&header[20]);
 	entry->LocalHeaderOffset = Stream_GetU32_LE(&header[38]);
+	entry->Crc32             = Stream_GetU32_LE(&header[12]);
+	return 0;
+}
+
+static cc_result Zip_ReadCentralDirectory(struct ZipState* state) {
+	struct ZipEntry entry;
+	cc_string path; char pathBuffer[ZIP_MAXNAMELEN];
+	cc_result res;
+
+	path = String_Init(pathBuffer, 0, ZIP_MAXNAMELEN);
+	if ((res = Zip_ReadCentralHeader(state->source, &entry, &path))) return res;
+
+	if (!state->SelectEntry(&path)) return 0;
+	if (state->usedEntries >= state->maxEntries) return ZIP_ERR_TOO_MANY_ENTRIES;
+
+	state->entries[state->usedEntries++] = entry;
 	return 0;
 }
 
@@ -1275,9 +1992,9 @@ enum ZipSig {
 	ZIP_SIG_LOCALFILEHEADER = 0x04034b50
 };
 
-cc_result Zip_Extract(struct Stream* source, Zip_SelectEntry selector, Zip_ProcessEntry processor, 
-						struct ZipEntry* entries, int maxEntries) {
-	struct ZipState state;
+/* Finds the end of central directory record, then seeks to the first central directory entry */
+static cc_result Zip_SeekCentralDirectory(struct ZipState* state) {
+	struct Stream* source = state->source;
 	cc_uint32 stream_len;
 	cc_uint32 sig = 0;
 	int i, count;
@@ -1295,19 +2012,44 @@ cc_result Zip_Extract(struct Stream* source, Zip_SelectEntry selector, Zip_Proce
 		if (sig == ZIP_SIG_ENDOFCENTRALDIR) break;
 	}
 
+	if (sig != ZIP_SIG_ENDOFCENTRALDIR) return ZIP_ERR_NO_END_OF_CENTRAL_DIR;
+	res = Zip_ReadEndOfCentralDirectory(state);
+	if (res) return res;
+
+	res = source->Seek(source, state->centralDirBeg);
+	if (res) return ZIP_ERR_SEEK_CENTRAL_DIR;
+	return 0;
+}
+
+static cc_result Zip_ExtractEntry(struct ZipState* state, struct ZipEntry* entry) {
+	struct Stream* source = state->source;
+	cc_uint32 sig = 0;
+	cc_result res;
+
+	res = source->Seek(source, entry->LocalHeaderOffset);
+	if (res) return ZIP_ERR_SEEK_LOCAL_DIR;
+
+	if ((res = Stream_ReadU32_LE(source, &sig))) return res;
+	if (sig != ZIP_SIG_LOCALFILEHEADER) return ZIP_ERR_INVALID_LOCAL_DIR;
+
+	return Zip_ReadLocalFileHeader(state, entry);
+}
+
+cc_result Zip_Extract(struct Stream* source, Zip_SelectEntry selector, Zip_ProcessEntry processor, 
+						struct ZipEntry* entries, int maxEntries) {
+	struct ZipState state;
+	cc_uint32 sig = 0;
+	cc_result res;
+	int i;
+
 	state.source       = source;
 	state.SelectEntry  = selector;
 	state.ProcessEntry = processor;
 	state.entries      = entries;
 	state.maxEntries   = maxEntries;
+	state.usedEntries  = 0;
 
-	if (sig != ZIP_SIG_ENDOFCENTRALDIR) return ZIP_ERR_NO_END_OF_CENTRAL_DIR;
-	res = Zip_ReadEndOfCentralDirectory(&state);
-	if (res) return res;
-
-	res = source->Seek(source, state.centralDirBeg);
-	if (res) return ZIP_ERR_SEEK_CENTRAL_DIR;
-	state.usedEntries = 0;
+	if ((res = Zip_SeekCentralDirectory(&state))) return res;
 
 	/* Read all the central directory entries */
 	for (i = 0; i < state.totalEntries; i++) {
@@ -1325,15 +2067,73 @@ cc_result Zip_Extract(struct Stream* source, Zip_SelectEntry selector, Zip_Proce
 
 	/* Now read the local file header entries */
 	for (i = 0; i < state.usedEntries; i++) {
-		struct ZipEntry* entry = &state.entries[i];
-		res = source->Seek(source, entry->LocalHeaderOffset);
-		if (res) return ZIP_ERR_SEEK_LOCAL_DIR;
+		res = Zip_ExtractEntry(&state, &state.entries[i]);
+		if (res) return res;
+	}
+	return 0;
+}
 
+
+/*########################################################################################################################*
+*---------------------------------------------------------ZipIndex--------------------------------------------------------*
+*#########################################################################################################################*/
+static cc_bool Zip_SelectAll(const cc_string* path) { return true; }
+
+cc_result ZipIndex_Open(struct ZipIndex* index, struct Stream* source) {
+	struct ZipState state;
+	cc_string path; char pathBuffer[ZIP_MAXNAMELEN];
+	cc_uint32 sig = 0;
+	cc_result res;
+	int i;
+
+	index->source  = source;
+	index->entries = NULL;
+	index->count   = 0;
+	StringsBuffer_Init(&index->paths);
+	/* Paths can be up to ZIP_MAXNAMELEN long, which doesn't fit in default 9 length bits */
+	StringsBuffer_SetLengthBits(&index->paths, 10);
+	StringsBuffer_IndexKeys(&index->paths, '\0');
+
+	state.source = source;
+	if ((res = Zip_SeekCentralDirectory(&state))) return res;
+	if (!state.totalEntries) return 0;
+
+	index->entries = (struct ZipEntry*)Mem_TryAlloc(state.totalEntries, sizeof(struct ZipEntry));
+	if (!index->entries) return ERR_OUT_OF_MEMORY;
+
+	for (i = 0; i < state.totalEntries; i++) {
 		if ((res = Stream_ReadU32_LE(source, &sig))) return res;
-		if (sig != ZIP_SIG_LOCALFILEHEADER) return ZIP_ERR_INVALID_LOCAL_DIR;
 
-		res = Zip_ReadLocalFileHeader(&state, entry);
+		if (sig == ZIP_SIG_ENDOFCENTRALDIR) break;
+		if (sig != ZIP_SIG_CENTRALDIR) return ZIP_ERR_INVALID_CENTRAL_DIR;
+
+		path = String_Init(pathBuffer, 0, ZIP_MAXNAMELEN);
+		res  = Zip_ReadCentralHeader(source, &index->entries[index->count], &path);
 		if (res) return res;
+
+		StringsBuffer_Add(&index->paths, &path);
+		index->count++;
 	}
 	return 0;
 }
+
+int ZipIndex_Find(struct ZipIndex* index, const cc_string* path) {
+	/* Paths never contain '\0', so the whole path is used as the key */
+	return StringsBuffer_FindKey(&index->paths, path, '\0');
+}
+
+cc_result ZipIndex_Extract(struct ZipIndex* index, int i, Zip_ProcessEntry processor) {
+	struct ZipState state;
+	state.source       = index->source;
+	state.SelectEntry  = Zip_SelectAll;
+	state.ProcessEntry = processor;
+
+	return Zip_ExtractEntry(&state, &index->entries[i]);
+}
+
+void ZipIndex_Free(struct ZipIndex* index) {
+	Mem_Free(index->entries);
+	StringsBuffer_Clear(&index->paths);
+	index->entries = NULL;
+	index->count   = 0;
+}
@@ -1,6 +1,6 @@
 #ifndef CC_DEFLATE_H
 #define CC_DEFLATE_H
-#include "Core.h"
+#include "String.h"
 CC_BEGIN_HEADER
 
 /* Decodes data compressed using DEFLATE in a streaming manner.
@@ -30,7 +30,12 @@ cc_result ZLibHeader_Read(struct Stream* s, struct ZLibHeader* header);
 #define INFLATE_MAX_LITS_DISTS (INFLATE_MAX_LITS + INFLATE_MAX_DISTS)
 #define INFLATE_MAX_BITS 16
 
+/* Codewords with up to this many bits are decoded using a single table lookup */
+#ifdef CC_BUILD_LOWMEM
 #define INFLATE_FAST_BITS 9
+#else
+#define INFLATE_FAST_BITS 10
+#endif
 #define INFLATE_FAST_LEN_SHIFT 9
 #define INFLATE_FAST_VAL_MASK  0x1FF
 
@@ -48,7 +53,7 @@ struct HuffmanTable {
 struct InflateState {
 	cc_uint8 State;
 	cc_bool LastBlock; /* Whether the last DEFLATE block has been encounted in the stream */
-	cc_uint32 Bits;    /* Holds bits across byte boundaries */
+	cc_uintptr Bits;   /* Holds bits across byte boundaries (machine word sized, to reduce refills) */
 	cc_uint32 NumBits; /* Number of bits in Bits buffer */
 
 	cc_uint8* NextIn;   /* Pointer within Input buffer to next byte that can be read */
@@ -69,6 +74,7 @@ struct InflateState {
 		struct HuffmanTable Lits;           /* Values represent literal or lengths */
 	} Table; /* union to save on memory */
 	struct HuffmanTable TableDists;         /* Values represent distances back */
+	cc_uint32 LitPairs[1 << INFLATE_FAST_BITS]; /* Two literals and their total bit length, or 0 if not two literals */
 	cc_uint8 Window[INFLATE_WINDOW_SIZE];    /* Holds circular buffer of recent output data, used for LZ77 */
 	cc_result result;
 };
@@ -89,6 +95,9 @@ CC_API void Inflate_MakeStream2(struct Stream* stream, struct InflateState* stat
 #define DEFLATE_OUT_SIZE 8192
 #define DEFLATE_HASH_SIZE 0x1000UL
 #define DEFLATE_HASH_MASK 0x0FFFUL
+/* How much effort is spent searching for matches, trading off speed for smaller output */
+enum DEFLATE_LEVEL { DEFLATE_LEVEL_FAST, DEFLATE_LEVEL_NORMAL, DEFLATE_LEVEL_MAX, DEFLATE_LEVEL_COUNT };
+
 struct DeflateState {
 	cc_uint32 Bits;         /* Holds bits across byte boundaries */
 	cc_uint32 NumBits;      /* Number of bits in Bits buffer */
@@ -100,6 +109,10 @@ struct DeflateState {
 
 	cc_uint16 LitsCodewords[INFLATE_MAX_LITS]; /* Codewords for each value */
 	cc_uint8 LitsLens[INFLATE_MAX_LITS];       /* Bit lengths of each codeword */
+	cc_uint16 DistsCodewords[INFLATE_MAX_DISTS];
+	cc_uint8 DistsLens[INFLATE_MAX_DISTS];
+	cc_uint8 Level; /* DEFLATE_LEVEL, can be changed after Deflate_MakeStream */
+	int NumSymbols; /* Number of entries used in Symbols */
 	
 	cc_uint8 Input[DEFLATE_BUFFER_SIZE];
 	cc_uint8 Output[DEFLATE_OUT_SIZE];
@@ -107,7 +120,7 @@ struct DeflateState {
 	cc_uint16 Prev[DEFLATE_BUFFER_SIZE];
 	/* NOTE: The largest possible value that can get */
 	/*  stored in Head/Prev is <= DEFLATE_BUFFER_SIZE */
-	cc_bool WroteHeader;
+	cc_uint16 Symbols[DEFLATE_BLOCK_SIZE]; /* Literals and length/distance pairs of the current block */
 };
 /* Compresses input data using DEFLATE, then writes compressed output to another stream. Write only stream. */
 /* DEFLATE compression is pure compressed data, there is no header or footer. */
@@ -118,6 +131,11 @@ struct GZipState { struct DeflateState Base; cc_uint32 Crc32, Size; };
 /* GZIP compression is GZIP header, followed by DEFLATE compressed data, followed by GZIP footer. */
 CC_API  void GZip_MakeStream(      struct Stream* stream, struct GZipState* state, struct Stream* underlying);
 typedef void (*FP_GZip_MakeStream)(struct Stream* stream, struct GZipState* state, struct Stream* underlying);
+/* Compresses input data using GZIP, splitting it into parts that are compressed across worker threads. Write only stream. */
+/* Each part uses the end of the previous part as its dictionary, and parts are concatenated into one GZIP stream. */
+/* Returns false if threads are unsupported or memory couldn't be allocated, in which case use GZip_MakeStream instead. */
+/* NOTE: Only one parallel stream can be open at a time, and Close must always be called to stop the worker threads. */
+CC_API cc_bool GZip_MakeParallelStream(struct Stream* stream, struct Stream* underlying, int level, int threads);
 
 struct ZLibState { struct DeflateState Base; cc_uint32 Adler32; };
 /* Compresses input data using ZLIB, then writes compressed output to another stream. Write only stream. */
@@ -126,7 +144,7 @@ CC_API  void ZLib_MakeStream(      struct Stream* stream, struct ZLibState* stat
 typedef void (*FP_ZLib_MakeStream)(struct Stream* stream, struct ZLibState* state, struct Stream* underlying);
 
 /* Minimal data needed to describe an entry in a .zip archive */
-struct ZipEntry { cc_uint32 CompressedSize, UncompressedSize, LocalHeaderOffset; };
+struct ZipEntry { cc_uint32 CompressedSize, UncompressedSize, LocalHeaderOffset, Crc32; };
 /* Callback function to process the data in a .zip archive entry */
 /* Return non-zero to indicate an error and stop further processing */
 /* NOTE: data stream MAY NOT be seekable (i.e. entry data might be compressed) */
@@ -138,5 +156,23 @@ typedef cc_bool (*Zip_SelectEntry)(const cc_string* path);
 cc_result Zip_Extract(struct Stream* source, Zip_SelectEntry selector, Zip_ProcessEntry processor,
 						struct ZipEntry* entries, int maxEntries);
 
+/* Lookup table of the entries in a .zip archive, built by reading its central directory once */
+/* Individual entries can then be extracted on demand, without rescanning the whole archive */
+struct ZipIndex {
+	struct Stream* source;
+	struct ZipEntry* entries;   /* Data for each entry, in central directory order */
+	struct StringsBuffer paths; /* Path of each entry, in same order as entries */
+	int count;
+};
+/* Reads the central directory of the given .zip archive into the given index */
+/* NOTE: source must stay open while the index is used, and ZipIndex_Free must be called even on failure */
+cc_result ZipIndex_Open(struct ZipIndex* index, struct Stream* source);
+/* Returns the index of the entry whose path caselessly equals the given path, or -1 if none */
+int ZipIndex_Find(struct ZipIndex* index, const cc_string* path);
+/* Seeks to the i'th entry and passes its data to the given callback */
+cc_result ZipIndex_Extract(struct ZipIndex* index, int i, Zip_ProcessEntry processor);
+/* Frees memory used by the index. NOTE: Does NOT close the source stream */
+void ZipIndex_Free(struct ZipIndex* index);
+
 CC_END_HEADER
 #endif
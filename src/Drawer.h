@@ -23,6 +23,8 @@ CC_VAR extern struct _DrawerData {
 	float X1, Y1, Z1;
 	/* Coordinate of maximum block bounding box corner in the world. */
 	float X2, Y2, Z2;
+	/* Whether texture V coords include the 1D atlas index. (See Atlas1D_TileV) */
+	cc_bool Layered;
 } Drawer;
 
 /* Draws minimum X face of the cuboid. (i.e. at X1) */
@@ -38,5 +40,14 @@ CC_API void Drawer_YMin(int count, PackedCol col, TextureLoc texLoc, struct Vert
 /* Draws maximum Y face of the cuboid. (i.e. at Y2) */
 CC_API void Drawer_YMax(int count, PackedCol col, TextureLoc texLoc, struct VertexTextured** vertices);
 
+/* Variants of the above functions that use the given cuboid state instead of the global Drawer state */
+/* NOTE: Used by the chunk mesh builder, as chunk meshes may be built on multiple threads at once */
+void Drawer_XMinEx(struct _DrawerData* d, int count, PackedCol col, TextureLoc texLoc, struct VertexTextured** vertices);
+void Drawer_XMaxEx(struct _DrawerData* d, int count, PackedCol col, TextureLoc texLoc, struct VertexTextured** vertices);
+void Drawer_ZMinEx(struct _DrawerData* d, int count, PackedCol col, TextureLoc texLoc, struct VertexTextured** vertices);
+void Drawer_ZMaxEx(struct _DrawerData* d, int count, PackedCol col, TextureLoc texLoc, struct VertexTextured** vertices);
+void Drawer_YMinEx(struct _DrawerData* d, int count, PackedCol col, TextureLoc texLoc, struct VertexTextured** vertices);
+void Drawer_YMaxEx(struct _DrawerData* d, int count, PackedCol col, TextureLoc texLoc, struct VertexTextured** vertices);
+
 CC_END_HEADER
 #endif
@@ -96,6 +96,7 @@ static void CalculateTextWidths(void) {
 
 static void FreeFontBitmap(void) {
 	int i;
+	Drawer2D_ResetTextWidths();
 	for (i = 0; i < Array_Elems(tileWidths); i++) tileWidths[i] = 0;
 	Mem_Free(fontBitmap.scan0);
 }
@@ -147,7 +148,7 @@ cc_bool Drawer2D_Clamp(struct Context2D* ctx, int* x, int* y, int* width, int* h
 }
 #define Drawer2D_ClampPixel(p) p = (p < 0 ? 0 : (p > 255 ? 255 : p))
 
-void Context2D_Alloc(struct Context2D* ctx, int width, int height) {
+static void Context2D_Init(struct Context2D* ctx, int width, int height) {
 	ctx->width  = width;
 	ctx->height = height;
 	ctx->meta   = NULL;
@@ -163,7 +164,30 @@ void Context2D_Alloc(struct Context2D* ctx, int width, int height) {
 
 	ctx->bmp.width  = width; 
 	ctx->bmp.height = height;
-	ctx->bmp.scan0  = (BitmapCol*)Mem_AllocCleared(width * height, BITMAPCOLOR_SIZE, "bitmap data");
+}
+
+/* Allocates the backing bitmap from the bitmap pool, as it's usually freed soon after anyways */
+static void Context2D_AllocPooled(struct Context2D* ctx) {
+	Bitmap_Allocate(&ctx->bmp, ctx->bmp.width, ctx->bmp.height);
+	Mem_Set(ctx->bmp.scan0, 0, ctx->bmp.width * ctx->bmp.height * BITMAPCOLOR_SIZE);
+}
+
+void Context2D_Alloc(struct Context2D* ctx, int width, int height) {
+	Context2D_Init(ctx, width, height);
+	Context2D_AllocPooled(ctx);
+}
+
+void Context2D_AllocTemp(struct Context2D* ctx, int width, int height) {
+	int size;
+	Context2D_Init(ctx, width, height);
+	size = ctx->bmp.width * ctx->bmp.height;
+
+	ctx->bmp.scan0 = (BitmapCol*)Game_AllocScratch(size, BITMAPCOLOR_SIZE);
+	if (ctx->bmp.scan0) {
+		Mem_Set(ctx->bmp.scan0, 0, size * BITMAPCOLOR_SIZE);
+	} else {
+		Context2D_AllocPooled(ctx);
+	}
 }
 
 void Context2D_Wrap(struct Context2D* ctx, struct Bitmap* bmp) {
@@ -174,10 +198,33 @@ void Context2D_Wrap(struct Context2D* ctx, struct Bitmap* bmp) {
 }
 
 void Context2D_Free(struct Context2D* ctx) {
-	Mem_Free(ctx->bmp.scan0);
+	if (!Game_FreeScratch(ctx->bmp.scan0)) Bitmap_Free(&ctx->bmp);
 }
 
 #define BitmapColor_Raw(r, g, b) (BitmapColor_R_Bits(r) | BitmapColor_G_Bits(g) | BitmapColor_B_Bits(b))
+
+/* Sets pixels in a row to the same color, 4 pixels at a time */
+static void Drawer2D_FillRow(BitmapCol* row, BitmapCol color, int width) {
+	int xx = 0;
+	for (; xx + 4 <= width; xx += 4) {
+		row[xx + 0] = color; row[xx + 1] = color;
+		row[xx + 2] = color; row[xx + 3] = color;
+	}
+	for (; xx < width; xx++) { row[xx] = color; }
+}
+
+/* Fills the first row, then copies it to the remaining rows */
+/* (Mem_Copy is typically implemented using SIMD instructions by the C runtime) */
+static void Drawer2D_FillArea(struct Bitmap* bmp, BitmapCol color, int x, int y, int width, int height) {
+	BitmapCol* first = Bitmap_GetRow(bmp, y) + x;
+	int yy;
+	Drawer2D_FillRow(first, color, width);
+
+	for (yy = 1; yy < height; yy++) {
+		Mem_Copy(Bitmap_GetRow(bmp, y + yy) + x, first, width * BITMAPCOLOR_SIZE);
+	}
+}
+
 void Gradient_Noise(struct Context2D* ctx, BitmapCol color, int variation,
 					int x, int y, int width, int height) {
 	struct Bitmap* bmp = (struct Bitmap*)ctx;
@@ -217,7 +264,7 @@ void Gradient_Vertical(struct Context2D* ctx, BitmapCol a, BitmapCol b,
 					   int x, int y, int width, int height) {
 	struct Bitmap* bmp = (struct Bitmap*)ctx;
 	BitmapCol* row, color;
-	int xx, yy;
+	int yy;
 	float t;
 	if (!Drawer2D_Clamp(ctx, &x, &y, &width, &height)) return;
 
@@ -230,16 +277,39 @@ void Gradient_Vertical(struct Context2D* ctx, BitmapCol a, BitmapCol b,
 			Math_Lerp(BitmapCol_G(a), BitmapCol_G(b), t),
 			Math_Lerp(BitmapCol_B(a), BitmapCol_B(b), t),
 			255);
+		Drawer2D_FillRow(row, color, width);
+	}
+}
 
-		for (xx = 0; xx < width; xx++) { row[xx] = color; }
+#ifndef BITMAP_16BPP
+/* Divides each of the two 16 bit lanes by 255 (exact for values up to 65025) */
+#define Blend_Div255(v) ((((v) + 0x00010001U + (((v) >> 8) & 0x00FF00FFU)) >> 8) & 0x00FF00FFU)
+
+/* Blends two color components at once, by treating a pixel as two lanes of 0x00XX00XX */
+static void Gradient_BlendRow(BitmapCol* dst, BitmapCol color, int blend, int width) {
+	cc_uint32 srcLo = color & 0x00FF00FFU, srcHi = (color >> 8) & 0x00FF00FFU;
+	cc_uint32 lo, hi;
+	int xx;
+
+	for (xx = 0; xx < width; xx++) {
+		lo = dst[xx] & 0x00FF00FFU;
+		hi = (dst[xx] >> 8) & 0x00FF00FFU;
+
+		lo = srcLo + Blend_Div255(lo * blend);
+		hi = srcHi + Blend_Div255(hi * blend);
+		dst[xx] = lo | (hi << 8) | BITMAPCOLOR_A_MASK;
 	}
 }
+#endif
 
 void Gradient_Blend(struct Context2D* ctx, BitmapCol color, int blend,
 					int x, int y, int width, int height) {
 	struct Bitmap* bmp = (struct Bitmap*)ctx;
 	BitmapCol* dst;
-	int R, G, B, xx, yy;
+	int yy;
+#ifdef BITMAP_16BPP
+	int R, G, B, xx;
+#endif
 	if (!Drawer2D_Clamp(ctx, &x, &y, &width, &height)) return;
 
 	/* Pre compute the alpha blended source color */
@@ -253,7 +323,9 @@ void Gradient_Blend(struct Context2D* ctx, BitmapCol color, int blend,
 
 	for (yy = 0; yy < height; yy++) {
 		dst = Bitmap_GetRow(bmp, y + yy) + x;
-
+#ifndef BITMAP_16BPP
+		Gradient_BlendRow(dst, color, blend, width);
+#else
 		for (xx = 0; xx < width; xx++, dst++) {
 			/* TODO: Not shift when multiplying */
 			R = BitmapCol_R(color) + (BitmapCol_R(*dst) * blend) / 255;
@@ -262,6 +334,7 @@ void Gradient_Blend(struct Context2D* ctx, BitmapCol color, int blend,
 
 			*dst = BitmapColor_RGB(R, G, B);
 		}
+#endif
 	}
 }
 
@@ -284,14 +357,9 @@ void Context2D_DrawPixels(struct Context2D* ctx, int x, int y, struct Bitmap* sr
 void Context2D_Clear(struct Context2D* ctx, BitmapCol color,
 					int x, int y, int width, int height) {
 	struct Bitmap* bmp = (struct Bitmap*)ctx;
-	BitmapCol* row;
-	int xx, yy;
 	if (!Drawer2D_Clamp(ctx, &x, &y, &width, &height)) return;
 
-	for (yy = 0; yy < height; yy++) {
-		row = Bitmap_GetRow(bmp, y + yy) + x;
-		for (xx = 0; xx < width; xx++) { row[xx] = color; }
-	}
+	Drawer2D_FillArea(bmp, color, x, y, width, height);
 }
 
 
@@ -306,7 +374,7 @@ void Drawer2D_MakeTextTexture(struct Texture* tex, struct DrawTextArgs* args) {
 	if (!width) { *tex = empty; return; }
 	height = Drawer2D_TextHeight(args);
 
-	Context2D_Alloc(&ctx, width, height);
+	Context2D_AllocTemp(&ctx, width, height);
 	{
 		Context2D_DrawText(&ctx, args, 0, 0);
 		Context2D_MakeTexture(tex, &ctx);
@@ -426,18 +494,11 @@ void Drawer2D_ReducePadding_Height(int* height, int point, int scale) {
 }
 
 void Drawer2D_Fill(struct Bitmap* bmp, int x, int y, int width, int height, BitmapCol color) {
-	BitmapCol* row;
-	int xx, yy;
+	if (x + width  > bmp->width)  width  = bmp->width  - x;
+	if (y + height > bmp->height) height = bmp->height - y;
+	if (width <= 0 || height <= 0) return;
 
-	for (yy = y; yy < y + height; yy++) {
-		if (yy >= bmp->height) return;
-		row = Bitmap_GetRow(bmp, yy);
-
-		for (xx = x; xx < x + width; xx++) {
-			if (xx >= bmp->width) break;
-			row[xx] = color;
-		}
-	}
+	Drawer2D_FillArea(bmp, color, x, y, width, height);
 }
 
 static void DrawBitmappedTextCore(struct Bitmap* bmp, struct DrawTextArgs* args, int x, int y, cc_bool shadow) {
@@ -590,11 +651,81 @@ void Context2D_DrawText(struct Context2D* ctx, struct DrawTextArgs* args, int x,
 	SysFont_DrawText(args, bmp, x, y, false);
 }
 
-int Drawer2D_TextWidth(struct DrawTextArgs* args) {
+static int MeasureTextWidth(struct DrawTextArgs* args) {
 	if (Font_IsBitmap(args->font)) return MeasureBitmappedWidth(args);
 	return SysFont_TextWidth(args);
 }
 
+
+/*########################################################################################################################*
+*---------------------------------------------------Text width cache------------------------------------------------------*
+*#########################################################################################################################*/
+/* Must be a power of two */
+#define TEXTWIDTH_CACHE_SIZE 128
+/* Longer strings are always measured, since they rarely get measured twice */
+#define TEXTWIDTH_MAX_LENGTH 48
+
+/* The same strings tend to get measured over and over (e.g. in layout and when clipping text), */
+/*  so widths are remembered in a direct mapped cache to avoid walking through each character again */
+struct TextWidthEntry {
+	void* handle;
+	cc_uint32 hash;
+	cc_uint16 size, flags;
+	cc_uint8 used, useShadow, length;
+	int width;
+	char text[TEXTWIDTH_MAX_LENGTH];
+};
+static struct TextWidthEntry textWidths[TEXTWIDTH_CACHE_SIZE];
+
+void Drawer2D_ResetTextWidths(void) {
+	Mem_Set(textWidths, 0, sizeof(textWidths));
+}
+
+static cc_uint32 TextWidth_Hash(struct DrawTextArgs* args) {
+	const struct FontDesc* font = args->font;
+	cc_uint32 hash = 2166136261U;
+	int i;
+
+	for (i = 0; i < args->text.length; i++) {
+		hash = (hash ^ (cc_uint8)args->text.buffer[i]) * 16777619U;
+	}
+	hash ^= (cc_uint32)(cc_uintptr)font->handle;
+	hash ^= (font->size << 16) | (font->flags << 1) | args->useShadow;
+	return hash * 2654435761U;
+}
+
+int Drawer2D_TextWidth(struct DrawTextArgs* args) {
+	const struct FontDesc* font = args->font;
+	struct TextWidthEntry* e;
+	cc_uint32 hash;
+	int len = args->text.length;
+
+	if (len > TEXTWIDTH_MAX_LENGTH) return MeasureTextWidth(args);
+	hash = TextWidth_Hash(args);
+	e    = &textWidths[(hash >> 16) & (TEXTWIDTH_CACHE_SIZE - 1)];
+
+	if (e->used && e->hash == hash && e->length == len && e->handle == font->handle
+		&& e->size == font->size && e->flags == font->flags && e->useShadow == args->useShadow
+		&& Mem_Equal(e->text, args->text.buffer, len)) return e->width;
+
+	e->used      = true;
+	e->hash      = hash;
+	e->handle    = font->handle;
+	e->size      = font->size;
+	e->flags     = font->flags;
+	e->useShadow = args->useShadow;
+	e->length    = len;
+	e->width     = MeasureTextWidth(args);
+
+	Mem_Copy(e->text, args->text.buffer, len);
+	return e->width;
+}
+
+static void OnColorCodeChanged(void* obj, int code) {
+	/* Whether "&x" is a color code (and so doesn't take up space) may have changed */
+	Drawer2D_ResetTextWidths();
+}
+
 int Drawer2D_TextHeight(struct DrawTextArgs* args) {
 	return Font_CalcHeight(args->font, args->useShadow);
 }
@@ -694,11 +825,13 @@ static void OnReset(void) {
 	Mem_Copy(&Drawer2D.Colors['0'], defaults_0_9, sizeof(defaults_0_9));
 	Mem_Copy(&Drawer2D.Colors['a'], defaults_a_f, sizeof(defaults_a_f));
 	Mem_Copy(&Drawer2D.Colors['A'], defaults_a_f, sizeof(defaults_a_f));
+	Drawer2D_ResetTextWidths();
 }
 
 static void OnInit(void) {
 	OnReset();
 	TextureEntry_Register(&default_entry);
+	Event_Register_(&ChatEvents.ColCodeChanged, NULL, OnColorCodeChanged);
 
 	Drawer2D.BitmappedText    = Game_ClassicMode || !Options_GetBool(OPT_USE_CHAT_FONT, false);
 	Drawer2D.BlackTextShadows = Options_GetBool(OPT_BLACK_TEXT, false);
@@ -39,6 +39,9 @@ cc_bool Drawer2D_Clamp(struct Context2D* ctx, int* x, int* y, int* width, int* h
 /* Allocates a new context for 2D drawing */
 /*  Note: Allocates a power-of-2 sized backing bitmap equal to or greater than the given size */
 CC_API void Context2D_Alloc(struct Context2D* ctx, int width, int height);
+/* Same as Context2D_Alloc, but the backing bitmap is allocated from per-frame scratch memory where possible */
+/*  NOTE: Context2D_Free MUST be called before the end of the current frame */
+void Context2D_AllocTemp(struct Context2D* ctx, int width, int height);
 /* Allocates a new context for 2D drawing, using an existing bimap as backing bitmap */
 CC_API void Context2D_Wrap(struct Context2D* ctx, struct Bitmap* bmp);
 /* Frees/Releases a previously allocatedcontext for 2D drawing */
@@ -68,7 +71,12 @@ CC_API void Gradient_Blend(struct Context2D* ctx, BitmapCol color, int blend,
 						   int x, int y, int width, int height);
 
 /* Returns how wide the given text would be when drawn */
+/* NOTE: Widths of short strings are cached, see Drawer2D_ResetTextWidths */
 CC_API int Drawer2D_TextWidth(struct DrawTextArgs* args);
+/* Forgets all cached text widths */
+/* NOTE: Must be called whenever the handle of a system font is destroyed, */
+/*  as a later font might otherwise reuse the same handle and get the wrong widths */
+void Drawer2D_ResetTextWidths(void);
 /* Returns how tall the given text would be when drawn */
 /*  NOTE: Height returned only depends on the font. (see Font_CalcHeight) */
 CC_API int Drawer2D_TextHeight(struct DrawTextArgs* args);
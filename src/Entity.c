@@ -43,7 +43,7 @@ void Entity_Init(struct Entity* e) {
 	e->Flags      = ENTITY_FLAG_HAS_MODELVB;
 	e->uScale     = 1.0f;
 	e->vScale     = 1.0f;
-	e->_skinReqID = 0;
+	e->_skinEntry = 0;
 	e->SkinRaw[0] = '\0';
 	e->NameRaw[0] = '\0';
 	Entity_SetModel(e, &model);
@@ -206,62 +206,13 @@ cc_bool Entity_TouchesAnyWater(struct Entity* e) {
 /*########################################################################################################################*
 *------------------------------------------------------Entity skins-------------------------------------------------------*
 *#########################################################################################################################*/
-static struct Entity* Entity_FirstOtherWithSameSkinAndFetchedSkin(struct Entity* except) {
-	struct Entity* e;
-	cc_string skin, eSkin;
-	int i;
-
-	skin = String_FromRawArray(except->SkinRaw);
-	for (i = 0; i < ENTITIES_MAX_COUNT; i++) {
-		if (!Entities.List[i] || Entities.List[i] == except) continue;
-
-		e     = Entities.List[i];
-		eSkin = String_FromRawArray(e->SkinRaw);
-		if (e->SkinFetchState && String_Equals(&skin, &eSkin)) return e;
-	}
-	return NULL;
-}
-
-/* Copies skin data from another entity */
-static void Entity_CopySkin(struct Entity* dst, struct Entity* src) {
-	dst->TextureId    = src->TextureId;	
-	dst->SkinType     = src->SkinType;
-	dst->uScale       = src->uScale;
-	dst->vScale       = src->vScale;
-	dst->MobTextureId = src->MobTextureId;
-}
-
 /* Resets skin data for the given entity */
 static void Entity_ResetSkin(struct Entity* e) {
 	e->uScale = 1.0f; e->vScale = 1.0f;
 	e->MobTextureId = 0;
 	e->TextureId    = 0;
 	e->SkinType     = SKIN_64x32;
-}
-
-/* Copies or resets skin data for all entity with same skin */
-static void Entity_SetSkinAll(struct Entity* source, cc_bool reset) {
-	struct Entity* e;
-	cc_string skin, eSkin;
-	int i;
-
-	skin = String_FromRawArray(source->SkinRaw);
-	source->MobTextureId = Utils_IsUrlPrefix(&skin) ? source->TextureId : 0;
-
-	for (i = 0; i < ENTITIES_MAX_COUNT; i++) {
-		if (!Entities.List[i]) continue;
-
-		e     = Entities.List[i];
-		eSkin = String_FromRawArray(e->SkinRaw);
-		if (!String_Equals(&skin, &eSkin)) continue;
-
-		if (reset) {
-			Entity_ResetSkin(e);
-		} else {
-			Entity_CopySkin(e, source);
-		}
-		e->SkinFetchState = SKIN_FETCH_COMPLETED;
-	}
+	e->Flags       &= ~ENTITY_FLAG_SKIN_ATLAS;
 }
 
 /* Clears hat area from a skin bitmap if it's completely white or black,
@@ -290,8 +241,85 @@ static void Entity_ClearHat(struct Bitmap* bmp, cc_uint8 skinType) {
 	}
 }
 
+static void LogInvalidSkin(cc_result res, const cc_string* skin, const cc_uint8* data, int size) {
+	cc_string msg; char msgBuffer[256];
+	String_InitArray(msg, msgBuffer);
+
+	Logger_FormatWarn2(&msg, res, "decoding skin", skin, Platform_DescribeError);
+	if (res != PNG_ERR_INVALID_SIG) { Logger_WarnFunc(&msg); return; }
+
+	String_AppendConst(&msg, " (got ");
+	String_AppendAll(  &msg, data, min(size, 8));
+	String_AppendConst(&msg, ")");
+	Logger_WarnFunc(&msg);
+}
+
+
+/*########################################################################################################################*
+*-------------------------------------------------------Skins cache-------------------------------------------------------*
+*#########################################################################################################################*/
+/* Skins are shared by all entities with the same skin name/url, and are kept around after */
+/*  the last entity using them is removed, so players rejoining don't need to be downloaded again */
+#define SKINS_MAX_ENTRIES 512
+#define SKINS_NUM_BUCKETS 256
+/* Skins rendered this recently are never evicted to stay within the VRAM budget */
+#define SKINS_EVICT_DELAY 5.0
+
+enum SkinState { SKIN_ENTRY_FREE, SKIN_ENTRY_FETCHING, SKIN_ENTRY_DECODING, SKIN_ENTRY_LOADED, SKIN_ENTRY_EVICTED };
+struct SkinEntry {
+	cc_uint8 state;    /* SKIN_ENTRY_ state */
+	cc_uint8 skinType;
+	cc_uint16 next;    /* Index + 1 of the next entry in the same bucket, 0 if none */
+	int refs;          /* Number of entities using this skin */
+	int reqID;
+	GfxResourceID texID;
+	float uScale, vScale;
+	float uOffset, vOffset;
+	cc_uint8 page;     /* Index + 1 of the atlas page texID belongs to, 0 if texID is only used by this skin */
+	cc_uint8 cell;     /* Index of the top cell used in the atlas page */
+	cc_uint32 vram;    /* Approximate size of texID in bytes */
+	double lastUsed;   /* Game.Time the skin was last rendered */
+	cc_uint8* data;    /* Downloaded PNG, kept so that evicted textures can be recreated */
+	cc_uint32 size;
+	cc_bool clearHat;  /* Whether to clear the hat area of the skin while decoding it */
+	char name[STRING_SIZE];
+};
+
+static struct SkinEntry skins_entries[SKINS_MAX_ENTRIES];
+static cc_uint16 skins_buckets[SKINS_NUM_BUCKETS];
+static cc_uint32 skins_vram, skins_budget;
+
+static cc_uint32 Skins_Hash(const cc_string* name) {
+	cc_uint32 hash = 0;
+	int i;
+	for (i = 0; i < name->length; i++) { hash = hash * 31 + (cc_uint8)name->buffer[i]; }
+	return hash & (SKINS_NUM_BUCKETS - 1);
+}
+
+static int Skins_Find(const cc_string* name) {
+	struct SkinEntry* entry;
+	cc_string entryName;
+	int i = skins_buckets[Skins_Hash(name)];
+
+	for (; i; i = entry->next) {
+		entry     = &skins_entries[i - 1];
+		entryName = String_FromRawArray(entry->name);
+		if (String_Equals(name, &entryName)) return i - 1;
+	}
+	return -1;
+}
+
+/* Result of decoding the downloaded PNG data of a skin */
+struct SkinDecoded {
+	struct Bitmap bmp;
+	cc_result res;
+	float uScale, vScale;
+	cc_uint8 skinType;
+};
+
 /* Ensures skin is a power of two size, resizing if needed. */
-static cc_result EnsurePow2Skin(struct Entity* e, struct Bitmap* bmp) {
+static cc_result EnsurePow2Skin(struct SkinDecoded* d) {
+	struct Bitmap* bmp = &d->bmp;
 	struct Bitmap scaled;
 	cc_uint32 stride;
 	int width, height;
@@ -304,8 +332,8 @@ static cc_result EnsurePow2Skin(struct Entity* e, struct Bitmap* bmp) {
 	Bitmap_TryAllocate(&scaled, width, height);
 	if (!scaled.scan0) return ERR_OUT_OF_MEMORY;
 
-	e->uScale = (float)bmp->width  / width;
-	e->vScale = (float)bmp->height / height;
+	d->uScale = (float)bmp->width  / width;
+	d->vScale = (float)bmp->height / height;
 	stride = bmp->width * 4;
 
 	for (y = 0; y < bmp->height; y++) {
@@ -314,105 +342,563 @@ static cc_result EnsurePow2Skin(struct Entity* e, struct Bitmap* bmp) {
 		Mem_Copy(dst, src, stride);
 	}
 
-	Mem_Free(bmp->scan0);
+	Bitmap_Free(bmp);
 	*bmp = scaled;
 	return 0;
 }
 
-static cc_result ApplySkin(struct Entity* e, struct Bitmap* bmp, struct Stream* src, cc_string* skin) {
-	cc_result res;
-	if ((res = Png_Decode(bmp, src))) return res;
+/* Decodes PNG data into a power of two sized skin bitmap */
+/* NOTE: Can be called from a background thread, so must only use its arguments */
+static void DecodeSkin(struct SkinDecoded* d, cc_uint8* data, cc_uint32 size, cc_bool clearHat) {
+	struct Stream src;
+	d->bmp.scan0 = NULL;
+	d->uScale    = 1.0f;
+	d->vScale    = 1.0f;
+	d->skinType  = SKIN_64x32;
+
+	Stream_ReadonlyMemory(&src, data, size);
+	if ((d->res = Png_Decode(&d->bmp, &src))) return;
+	if ((d->res = EnsurePow2Skin(d)))          return;
+
+	d->skinType = Utils_CalcSkinType(&d->bmp);
+	if (clearHat) Entity_ClearHat(&d->bmp, d->skinType);
+}
+
+
+#ifdef CC_BUILD_BUILDERTHREADS
+/* Downloaded skins are decoded on a background thread, (including fixing them up to be a power of two size) */
+/*  so that only creating their textures needs to happen on the main thread */
+static struct SkinDecoder {
+	void* thread;
+	void* mutex;
+	void* signal;     /* Signalled when a skin is queued, or when the thread should quit */
+	void* doneSignal; /* Signalled after a skin has finished decoding */
+	cc_uint16 queue[SKINS_MAX_ENTRIES]; /* Indices of entries waiting to be decoded */
+	int count;
+	int current;      /* Index of the entry being decoded, -1 if none */
+	cc_bool quit;
+	/* Whether the entry at the same index has finished decoding */
+	cc_bool done[SKINS_MAX_ENTRIES];
+	struct SkinDecoded results[SKINS_MAX_ENTRIES];
+} skins_decoder;
+
+static void SkinDecoder_WorkerLoop(void) {
+	struct SkinDecoder* s = &skins_decoder;
+	struct SkinEntry* entry;
+	struct SkinDecoded d;
+	int i;
 
-	Gfx_DeleteTexture(&e->TextureId);
-	Entity_SetSkinAll(e, true);
-	if ((res = EnsurePow2Skin(e, bmp))) return res;
-	e->SkinType = Utils_CalcSkinType(bmp);
+	for (;;) {
+		Mutex_Lock(s->mutex);
+		if (s->quit) { Mutex_Unlock(s->mutex); return; }
 
-	if (!Gfx_CheckTextureSize(bmp->width, bmp->height, 0)) {
-		Chat_Add1("&cSkin %s is too large", skin);
-	} else {
-		if (e->Model->flags & MODEL_FLAG_CLEAR_HAT)
-			Entity_ClearHat(bmp, e->SkinType);
+		if (!s->count) {
+			Mutex_Unlock(s->mutex);
+			Waitable_Wait(s->signal);
+			continue;
+		}
 
-		e->TextureId = Gfx_CreateTexture(bmp, TEXTURE_FLAG_MANAGED, false);
-		Entity_SetSkinAll(e, false);
+		i = s->queue[0];
+		s->count--;
+		Mem_Move(s->queue, s->queue + 1, s->count * sizeof(cc_uint16));
+		s->current = i;
+		Mutex_Unlock(s->mutex);
+
+		/* Main thread doesn't change data of an entry while it is being decoded */
+		entry = &skins_entries[i];
+		DecodeSkin(&d, entry->data, entry->size, entry->clearHat);
+
+		Mutex_Lock(s->mutex);
+		s->results[i] = d;
+		s->done[i]    = true;
+		s->current    = -1;
+		Mutex_Unlock(s->mutex);
+		Waitable_Signal(s->doneSignal);
 	}
-	return 0;
 }
 
-static void LogInvalidSkin(cc_result res, const cc_string* skin, const cc_uint8* data, int size) {
-	cc_string msg; char msgBuffer[256];
-	String_InitArray(msg, msgBuffer);
+static void SkinDecoder_Queue(int index) {
+	struct SkinDecoder* s = &skins_decoder;
 
-	Logger_FormatWarn2(&msg, res, "decoding skin", skin, Platform_DescribeError);
-	if (res != PNG_ERR_INVALID_SIG) { Logger_WarnFunc(&msg); return; }
+	if (!s->thread) {
+		s->mutex      = Mutex_Create("Skin decoder");
+		s->signal     = Waitable_Create("Skin decoder");
+		s->doneSignal = Waitable_Create("Skin decoder done");
+		s->current    = -1;
+		Thread_Run(&s->thread, SkinDecoder_WorkerLoop, 256 * 1024, "Skin decoder");
+	}
 
-	String_AppendConst(&msg, " (got ");
-	String_AppendAll(  &msg, data, min(size, 8));
-	String_AppendConst(&msg, ")");
-	Logger_WarnFunc(&msg);
+	Mutex_Lock(s->mutex);
+	s->done[index]       = false;
+	s->queue[s->count++] = index;
+	Mutex_Unlock(s->mutex);
+	Waitable_Signal(s->signal);
 }
 
-static void Entity_CheckSkin(struct Entity* e) {
-	struct Entity* first;
-	struct HttpRequest item;
-	struct Stream mem;
+/* Retrieves the decoded skin of the given entry, if it has finished decoding */
+static cc_bool SkinDecoder_Take(int index, struct SkinDecoded* d) {
+	struct SkinDecoder* s = &skins_decoder;
+	cc_bool done;
+
+	Mutex_Lock(s->mutex);
+	done = s->done[index];
+	if (done) *d = s->results[index];
+	s->done[index] = false;
+	Mutex_Unlock(s->mutex);
+	return done;
+}
+
+/* Stops decoding the given entry, waiting for the background thread if it is already decoding it */
+static void SkinDecoder_Cancel(int index) {
+	struct SkinDecoder* s = &skins_decoder;
+	struct SkinDecoded d;
+	int i;
+
+	Mutex_Lock(s->mutex);
+	for (i = 0; i < s->count; i++)
+	{
+		if (s->queue[i] != index) continue;
+
+		s->count--;
+		Mem_Move(s->queue + i, s->queue + i + 1, (s->count - i) * sizeof(cc_uint16));
+		break;
+	}
+
+	while (s->current == index) {
+		Mutex_Unlock(s->mutex);
+		Waitable_Wait(s->doneSignal);
+		Mutex_Lock(s->mutex);
+	}
+	Mutex_Unlock(s->mutex);
+
+	if (SkinDecoder_Take(index, &d)) Bitmap_Free(&d.bmp);
+}
+
+static void SkinDecoder_Free(void) {
+	struct SkinDecoder* s = &skins_decoder;
+	if (!s->thread) return;
+
+	Mutex_Lock(s->mutex);
+	s->quit = true;
+	Mutex_Unlock(s->mutex);
+
+	Waitable_Signal(s->signal);
+	Thread_Join(s->thread);
+	Waitable_Free(s->signal);
+	Waitable_Free(s->doneSignal);
+	Mutex_Free(s->mutex);
+	Mem_Set(s, 0, sizeof(struct SkinDecoder));
+}
+#else
+static void SkinDecoder_Queue(int index)  { }
+static void SkinDecoder_Cancel(int index) { }
+static void SkinDecoder_Free(void)        { }
+
+static cc_bool SkinDecoder_Take(int index, struct SkinDecoded* d) {
+	struct SkinEntry* entry = &skins_entries[index];
+	DecodeSkin(d, entry->data, entry->size, entry->clearHat);
+	return true;
+}
+#endif
+
+
+/* Skins that are exactly 64x64 or 64x32 are packed into shared atlas pages, */
+/*  so entities with different skins can be drawn without changing the bound texture */
+#define SKINS_PAGE_SIZE  512
+#define SKINS_PAGE_COLS  (SKINS_PAGE_SIZE / 64)
+#define SKINS_PAGE_ROWS  (SKINS_PAGE_SIZE / 32)
+#define SKINS_PAGE_CELLS (SKINS_PAGE_COLS * SKINS_PAGE_ROWS)
+#define SKINS_MAX_PAGES  4
+
+/* Each page is divided into 64x32 cells, with 64x64 skins using two vertically adjacent cells */
+static struct SkinPage {
+	GfxResourceID texID;
+	int used; /* Number of cells in use */
+	cc_bool cells[SKINS_PAGE_CELLS];
+} skins_pages[SKINS_MAX_PAGES];
+static cc_bool skins_useAtlas;
+
+static cc_bool SkinPage_Create(struct SkinPage* page) {
 	struct Bitmap bmp;
-	cc_string skin;
-	cc_uint8 flags;
-	cc_result res;
+	BitmapCol* pixels = (BitmapCol*)Mem_TryAllocCleared(SKINS_PAGE_SIZE * SKINS_PAGE_SIZE, 4);
+	if (!pixels) return false;
 
-	/* Don't check skin if don't have to */
-	if (!e->Model->usesSkin) return;
-	if (e->SkinFetchState == SKIN_FETCH_COMPLETED) return;
-	skin = String_FromRawArray(e->SkinRaw);
+	Bitmap_Init(bmp, SKINS_PAGE_SIZE, SKINS_PAGE_SIZE, pixels);
+	page->texID = Gfx_CreateTexture(&bmp, TEXTURE_FLAG_MANAGED | TEXTURE_FLAG_DYNAMIC, false);
+	Mem_Free(pixels);
+	return page->texID != 0;
+}
 
-	if (!e->SkinFetchState) {
-		first = Entity_FirstOtherWithSameSkinAndFetchedSkin(e);
-		flags = e == &LocalPlayer_Instances[0].Base ? HTTP_FLAG_NOCACHE : 0;
+/* Returns the index of the first of the given number of free cells, or -1 if the page is full */
+static int SkinPage_FindCells(struct SkinPage* page, int count) {
+	int row, col, i;
 
-		if (!first) {
-			e->_skinReqID     = Http_AsyncGetSkin(&skin, flags);
-			e->SkinFetchState = SKIN_FETCH_DOWNLOADING;
-		} else {
-			Entity_CopySkin(e, first);
-			e->SkinFetchState = SKIN_FETCH_COMPLETED;
-			return;
+	for (row = 0; row + count <= SKINS_PAGE_ROWS; row += count)
+	{
+		for (col = 0; col < SKINS_PAGE_COLS; col++)
+		{
+			for (i = 0; i < count; i++) {
+				if (page->cells[(row + i) * SKINS_PAGE_COLS + col]) break;
+			}
+			if (i == count) return row * SKINS_PAGE_COLS + col;
 		}
 	}
+	return -1;
+}
 
-	if (!Http_GetResult(e->_skinReqID, &item)) return;
+/* Copies the skin into an atlas page, returning false if it can't be packed */
+static cc_bool SkinsAtlas_Add(struct SkinEntry* entry, struct Bitmap* bmp) {
+	struct SkinPage* page;
+	int i, j, cell, count = bmp->height / 32;
+	int x, y;
 
-	if (!item.success) {
-		Entity_SetSkinAll(e, true);
-	} else {
-		Stream_ReadonlyMemory(&mem, item.data, item.size);
+	if (!skins_useAtlas || bmp->width != 64 || (bmp->height != 64 && bmp->height != 32)) return false;
 
-		if ((res = ApplySkin(e, &bmp, &mem, &skin))) {
-			LogInvalidSkin(res, &skin, item.data, item.size);
+	for (i = 0; i < SKINS_MAX_PAGES; i++)
+	{
+		page = &skins_pages[i];
+		if ((cell = SkinPage_FindCells(page, count)) == -1) continue;
+		if (!page->texID && !SkinPage_Create(page)) return false;
+
+		for (j = 0; j < count; j++) {
+			page->cells[cell + j * SKINS_PAGE_COLS] = true;
 		}
-		Mem_Free(bmp.scan0);
+		page->used += count;
+
+		x = (cell % SKINS_PAGE_COLS) * 64;
+		y = (cell / SKINS_PAGE_COLS) * 32;
+		Gfx_UpdateTexture(page->texID, x, y, bmp, bmp->width, false);
+
+		entry->page  = i + 1;
+		entry->cell  = cell;
+		entry->texID = page->texID;
+		entry->vram  = bmp->width * bmp->height * 4;
+
+		entry->uOffset = (float)x / SKINS_PAGE_SIZE;
+		entry->vOffset = (float)y / SKINS_PAGE_SIZE;
+		entry->uScale  = 64.0f       / SKINS_PAGE_SIZE;
+		entry->vScale  = bmp->height / (float)SKINS_PAGE_SIZE;
+		return true;
+	}
+	return false;
+}
+
+static void SkinsAtlas_Remove(struct SkinEntry* entry) {
+	struct SkinPage* page = &skins_pages[entry->page - 1];
+	int j, count = entry->skinType == SKIN_64x32 ? 1 : 2;
+
+	for (j = 0; j < count; j++) {
+		page->cells[entry->cell + j * SKINS_PAGE_COLS] = false;
+	}
+	page->used -= count;
+	if (!page->used) Gfx_DeleteTexture(&page->texID);
+
+	entry->page  = 0;
+	entry->texID = 0;
+}
+
+static void Skins_DeleteTexture(struct SkinEntry* entry) {
+	if (entry->page) {
+		SkinsAtlas_Remove(entry);
+	} else {
+		Gfx_DeleteTexture(&entry->texID);
+	}
+	skins_vram  -= entry->vram;
+	entry->vram  = 0;
+}
+
+static void Skins_Remove(int index) {
+	struct SkinEntry* entry = &skins_entries[index];
+	cc_string name = String_FromRawArray(entry->name);
+	cc_uint16* link = &skins_buckets[Skins_Hash(&name)];
+
+	while (*link != index + 1) { link = &skins_entries[*link - 1].next; }
+	*link = entry->next;
+
+	/* Skin is no longer needed, so don't waste time still downloading it */
+	if (entry->state == SKIN_ENTRY_FETCHING) Http_TryCancel(entry->reqID);
+	if (entry->state == SKIN_ENTRY_DECODING) SkinDecoder_Cancel(index);
+	Skins_DeleteTexture(entry);
+	Mem_Free(entry->data);
+	Mem_Set(entry, 0, sizeof(struct SkinEntry));
+}
+
+/* Returns the index of a newly added entry, or -1 if all entries are in use */
+static int Skins_Add(const cc_string* name) {
+	struct SkinEntry* entry;
+	int i, slot = -1, oldest = -1;
+
+	for (i = 0; i < SKINS_MAX_ENTRIES; i++)
+	{
+		entry = &skins_entries[i];
+		if (!entry->state) { slot = i; break; }
+		if (entry->refs)   continue;
+
+		if (oldest == -1 || entry->lastUsed < skins_entries[oldest].lastUsed) oldest = i;
+	}
+
+	/* Reuse the least recently rendered unused skin */
+	if (slot == -1) {
+		if (oldest == -1) return -1;
+		Skins_Remove(oldest);
+		slot = oldest;
+	}
+
+	entry = &skins_entries[slot];
+	String_CopyToRawArray(entry->name, name);
+	entry->state    = SKIN_ENTRY_FETCHING;
+	entry->uScale   = 1.0f;
+	entry->vScale   = 1.0f;
+	entry->skinType = SKIN_64x32;
+	entry->lastUsed = Game.Time;
+
+	i = Skins_Hash(name);
+	entry->next      = skins_buckets[i];
+	skins_buckets[i] = slot + 1;
+	return slot;
+}
+
+/* Copies skin data from the given cache entry */
+static void Entity_CopySkin(struct Entity* e, struct SkinEntry* entry) {
+	cc_string skin = String_FromRawArray(entry->name);
+	e->TextureId    = entry->texID;
+	e->SkinType     = entry->skinType;
+	e->uScale       = entry->uScale;
+	e->vScale       = entry->vScale;
+	e->MobTextureId = Utils_IsUrlPrefix(&skin) ? entry->texID : 0;
+
+	if (entry->page) {
+		e->Flags  |= ENTITY_FLAG_SKIN_ATLAS;
+		e->uOffset = entry->uOffset;
+		e->vOffset = entry->vOffset;
 	}
-	HttpRequest_Free(&item);
 }
 
-/* Returns true if no other entities are sharing this skin texture */
-static cc_bool CanDeleteTexture(struct Entity* except) {
+static void Skins_Unload(int index) {
+	struct SkinEntry* entry = &skins_entries[index];
+	struct Entity* e;
 	int i;
-	if (!except->TextureId) return false;
+	Skins_DeleteTexture(entry);
+	entry->state = SKIN_ENTRY_EVICTED;
 
+	/* Entities using this skin recreate the texture once they are rendered again */
 	for (i = 0; i < ENTITIES_MAX_COUNT; i++)
 	{
-		if (!Entities.List[i] || Entities.List[i] == except)  continue;
-		if (Entities.List[i]->TextureId == except->TextureId) return false;
+		e = Entities.List[i];
+		if (!e || !e->SkinFetchState || e->_skinEntry != index + 1) continue;
+
+		Entity_ResetSkin(e);
+		e->SkinFetchState = SKIN_FETCH_DOWNLOADING;
 	}
+}
+
+/* Unloads least recently rendered skins until the textures of skins fit within the VRAM budget */
+static void Skins_Evict(void) {
+	struct SkinEntry* entry;
+	int i, oldest;
+
+	while (skins_budget && skins_vram > skins_budget)
+	{
+		oldest = -1;
+		for (i = 0; i < SKINS_MAX_ENTRIES; i++)
+		{
+			entry = &skins_entries[i];
+			if (!entry->texID || entry->lastUsed + SKINS_EVICT_DELAY > Game.Time) continue;
+
+			if (oldest == -1 || entry->lastUsed < skins_entries[oldest].lastUsed) oldest = i;
+		}
+
+		if (oldest == -1) return;
+		Skins_Unload(oldest);
+	}
+}
+
+/* Creates the texture of a skin from its decoded bitmap */
+static void ApplySkin(struct SkinEntry* entry, struct SkinDecoded* d) {
+	cc_string skin = String_FromRawArray(entry->name);
+	struct Bitmap* bmp = &d->bmp;
+
+	entry->state = SKIN_ENTRY_LOADED;
+	if (d->res) {
+		LogInvalidSkin(d->res, &skin, entry->data, entry->size);
+	} else {
+		entry->uScale   = d->uScale;
+		entry->vScale   = d->vScale;
+		entry->skinType = d->skinType;
+
+		if (!Gfx_CheckTextureSize(bmp->width, bmp->height, 0)) {
+			Chat_Add1("&cSkin %s is too large", &skin);
+		} else {
+			if (!SkinsAtlas_Add(entry, bmp)) {
+				entry->texID = Gfx_CreateTexture(bmp, TEXTURE_FLAG_MANAGED | TEXTURE_FLAG_COMPRESSED, false);
+				/* Compressed textures use 1 byte per pixel */
+				entry->vram  = bmp->width * bmp->height * (Gfx.CompressTextures && Gfx.SupportsCompressedTextures ? 1 : 4);
+			}
+			skins_vram += entry->vram;
+		}
+	}
+	Bitmap_Free(bmp);
+
+	/* No point keeping around data that can't be turned into a texture */
+	if (!entry->texID) {
+		Mem_Free(entry->data);
+		entry->data = NULL;
+	}
+	Skins_Evict();
+}
+
+
+/* Maximum number of skin textures created per frame, to avoid frame spikes when many players join at once */
+#define SKINS_MAX_UPLOADS 2
+static double skins_uploadTime;
+static int skins_uploads;
+
+static cc_bool Skins_CanUpload(void) {
+	/* Game.Time only changes once per frame */
+	if (skins_uploadTime != Game.Time) {
+		skins_uploadTime = Game.Time;
+		skins_uploads    = 0;
+	}
+	return skins_uploads < SKINS_MAX_UPLOADS;
+}
+
+/* Starts turning the downloaded PNG data of a skin into a texture */
+static void Skins_BeginDecode(struct SkinEntry* entry, struct Entity* e) {
+	if (!entry->data) { entry->state = SKIN_ENTRY_LOADED; return; }
+
+	entry->state    = SKIN_ENTRY_DECODING;
+	entry->clearHat = (e->Model->flags & MODEL_FLAG_CLEAR_HAT) != 0;
+	SkinDecoder_Queue((int)(entry - skins_entries));
+}
+
+/* Creates the texture of a skin, if it has finished decoding and the per-frame upload budget allows */
+static cc_bool Skins_FinishDecode(struct SkinEntry* entry) {
+	struct SkinDecoded d;
+	if (!Skins_CanUpload()) return false;
+	if (!SkinDecoder_Take((int)(entry - skins_entries), &d)) return false;
+
+	skins_uploads++;
+	ApplySkin(entry, &d);
 	return true;
 }
 
+static void Skins_Clear(void) {
+	int i;
+	for (i = 0; i < SKINS_MAX_ENTRIES; i++)
+	{
+		if (skins_entries[i].state) Skins_Remove(i);
+	}
+}
+
+
+/*########################################################################################################################*
+*-----------------------------------------------------Skin fetching-------------------------------------------------------*
+*#########################################################################################################################*/
+/* Skins of entities this far away are hard to make out anyways */
+#define SKIN_FAR_DISTANCE 64.0f
+
+static cc_bool Entity_IsFarAway(struct Entity* e) {
+	Vec3 delta;
+	if (!Entities.CurPlayer || e == &Entities.CurPlayer->Base) return false;
+
+	Vec3_Sub(&delta, &e->Position, &Entities.CurPlayer->Base.Position);
+	return Vec3_LengthSquared(&delta) > SKIN_FAR_DISTANCE * SKIN_FAR_DISTANCE;
+}
+
+/* Whether the entity was rendered last frame */
+static cc_bool Entity_IsSkinVisible(struct Entity* e) {
+	int i;
+	if (e->ShouldRender) return true;
+
+	/* Local players always need their skin, e.g. for the held block hand */
+	for (i = 0; i < MAX_LOCAL_PLAYERS; i++)
+	{
+		if (e == &LocalPlayer_Instances[i].Base) return true;
+	}
+	return false;
+}
+
+/* Starts using the cached skin with the same name, adding it to the cache if needed */
+static void Entity_AcquireSkin(struct Entity* e, const cc_string* skin) {
+	struct SkinEntry* entry;
+	cc_bool local = e == &LocalPlayer_Instances[0].Base;
+	cc_uint8 flags;
+	int i = Skins_Find(skin);
+
+	/* Always get the latest version of the user's own skin, unless another entity is showing it */
+	if (i >= 0 && local && !skins_entries[i].refs) {
+		Skins_Remove(i); i = -1;
+	}
+
+	if (i == -1) {
+		if ((i = Skins_Add(skin)) == -1) return;
+
+		flags = local ? HTTP_FLAG_NOCACHE : 0;
+		if (Entity_IsFarAway(e)) flags |= HTTP_FLAG_LOW_PRIORITY;
+		skins_entries[i].reqID = Http_AsyncGetSkin(skin, flags);
+	}
+
+	entry = &skins_entries[i];
+	entry->refs++;
+	e->_skinEntry     = i + 1;
+	e->SkinFetchState = SKIN_FETCH_DOWNLOADING;
+}
+
+static void Entity_CheckSkin(struct Entity* e) {
+	struct SkinEntry* entry;
+	struct HttpRequest item;
+	cc_string skin;
+
+	/* Don't check skin if don't have to */
+	if (!e->Model->usesSkin) return;
+
+	if (e->SkinFetchState == SKIN_FETCH_COMPLETED) {
+		if (e->_skinEntry && Entity_IsSkinVisible(e))
+			skins_entries[e->_skinEntry - 1].lastUsed = Game.Time;
+		return;
+	}
+
+	if (!e->SkinFetchState) {
+		skin = String_FromRawArray(e->SkinRaw);
+		Entity_AcquireSkin(e, &skin);
+		if (!e->SkinFetchState) return;
+	}
+	entry = &skins_entries[e->_skinEntry - 1];
+
+	if (entry->state == SKIN_ENTRY_FETCHING) {
+		if (!Http_GetResult(entry->reqID, &item)) return;
+
+		/* Take ownership of the downloaded data */
+		if (item.success) {
+			entry->data = item.data;
+			entry->size = item.size;
+			item.data   = NULL;
+		}
+		HttpRequest_Free(&item);
+		Skins_BeginDecode(entry, e);
+	} else if (entry->state == SKIN_ENTRY_EVICTED) {
+		if (!Entity_IsSkinVisible(e)) return;
+		Skins_BeginDecode(entry, e);
+	}
+	if (entry->state == SKIN_ENTRY_DECODING && !Skins_FinishDecode(entry)) return;
+
+	Entity_CopySkin(e, entry);
+	entry->lastUsed   = Game.Time;
+	e->SkinFetchState = SKIN_FETCH_COMPLETED;
+}
+
 CC_NOINLINE static void DeleteSkin(struct Entity* e) {
-	if (CanDeleteTexture(e)) Gfx_DeleteTexture(&e->TextureId);
+	struct SkinEntry* entry;
+	int i = e->_skinEntry - 1;
+
+	if (e->SkinFetchState && i >= 0) {
+		entry = &skins_entries[i];
+		entry->refs--;
+		if (!entry->refs && entry->state == SKIN_ENTRY_FETCHING) Skins_Remove(i);
+	}
 
 	Entity_ResetSkin(e);
+	e->_skinEntry     = 0;
 	e->SkinFetchState = 0;
 }
 
@@ -445,24 +931,123 @@ void Entity_LerpAngles(struct Entity* e, float t) {
 *--------------------------------------------------------Entities---------------------------------------------------------*
 *#########################################################################################################################*/
 struct _EntitiesData Entities;
+cc_uint16 Entities_ActiveIds[ENTITIES_MAX_COUNT];
+int Entities_ActiveCount;
+/* Index of each entity within Entities_ActiveIds */
+static cc_uint16 active_slots[ENTITIES_MAX_COUNT];
+
+/* Active entities are hashed into buckets by which 4x4 block column they are in */
+#define GRID_CELL_SHIFT 2
+#define GRID_BUCKETS    64
+/* ID + 1 of the first entity in each bucket, and of the next entity in the same bucket as each entity */
+/* NOTE: 0 marks the end of the bucket, so the grid starts off empty */
+static cc_uint16 grid_heads[GRID_BUCKETS];
+static cc_uint16 grid_next[ENTITIES_MAX_COUNT];
+
+static CC_INLINE int Grid_Bucket(int cellX, int cellZ) {
+	return (int)(((cc_uint32)cellX * 73856093U ^ (cc_uint32)cellZ * 19349663U) & (GRID_BUCKETS - 1));
+}
+
+static void Grid_Rebuild(void) {
+	struct Entity* e;
+	int i, id, bucket;
+	Mem_Set(grid_heads, 0, sizeof(grid_heads));
+
+	for (i = 0; i < Entities_ActiveCount; i++)
+	{
+		id = Entities_ActiveIds[i];
+		e  = Entities.List[id];
+
+		bucket = Grid_Bucket(Math_Floor(e->Position.x) >> GRID_CELL_SHIFT, 
+							 Math_Floor(e->Position.z) >> GRID_CELL_SHIFT);
+		grid_next[id]      = grid_heads[bucket];
+		grid_heads[bucket] = id + 1;
+	}
+}
+
+int Entities_FindNearby(const Vec3* pos, float radius, cc_uint16* ids) {
+	int minX = Math_Floor(pos->x - radius) >> GRID_CELL_SHIFT, maxX = Math_Floor(pos->x + radius) >> GRID_CELL_SHIFT;
+	int minZ = Math_Floor(pos->z - radius) >> GRID_CELL_SHIFT, maxZ = Math_Floor(pos->z + radius) >> GRID_CELL_SHIFT;
+	cc_bool visited[GRID_BUCKETS] = { 0 };
+	int x, z, bucket, id, count = 0;
+
+	/* Large areas would visit every bucket anyway */
+	if ((maxX - minX + 1) * (maxZ - minZ + 1) >= GRID_BUCKETS) {
+		Mem_Copy(ids, Entities_ActiveIds, Entities_ActiveCount * 2);
+		return Entities_ActiveCount;
+	}
+
+	for (z = minZ; z <= maxZ; z++)
+		for (x = minX; x <= maxX; x++)
+		{
+			/* Entities are only in one bucket, so this also avoids returning any twice */
+			bucket = Grid_Bucket(x, z);
+			if (visited[bucket]) continue;
+			visited[bucket] = true;
+
+			for (id = grid_heads[bucket] - 1; id >= 0; id = grid_next[id] - 1)
+			{
+				if (Entities.List[id]) ids[count++] = id;
+			}
+		}
+	return count;
+}
 
 void Entities_Tick(struct ScheduledTask* task) {
+	struct Entity* e;
 	int i;
-	for (i = 0; i < ENTITIES_MAX_COUNT; i++)
+	Grid_Rebuild();
+
+	for (i = 0; i < Entities_ActiveCount; i++)
+	{
+		e = Entities_GetActive(i);
+		e->VTABLE->Tick(e, task->interval);
+	}
+}
+
+/* Order that active entities are rendered in, so that entities with the same skin texture are drawn together */
+static cc_uint16 render_order[ENTITIES_MAX_COUNT];
+cc_uint16 Entities_VisibleIds[ENTITIES_MAX_COUNT];
+int Entities_VisibleCount;
+/* Whether entities were added or removed since render_order was last sorted */
+static cc_bool render_orderChanged = true;
+
+static void Entities_SortByTexture(void) {
+	cc_uint16 id;
+	int i, j;
+
+	/* Insertion sort, since the order rarely changes between frames */
+	for (i = 1; i < Entities_ActiveCount; i++)
 	{
-		if (!Entities.List[i]) continue;
-		Entities.List[i]->VTABLE->Tick(Entities.List[i], task->interval);
+		id = render_order[i];
+		for (j = i - 1; j >= 0; j--)
+		{
+			if ((cc_uintptr)Entities.List[render_order[j]]->TextureId <= (cc_uintptr)Entities.List[id]->TextureId) break;
+			render_order[j + 1] = render_order[j];
+		}
+		render_order[j + 1] = id;
 	}
 }
 
 void Entities_RenderModels(float delta, float t) {
+	struct Entity* e;
 	int i;
 	Gfx_SetAlphaTest(true);
+
+	/* Otherwise start from the previous frame's order, so sorting is cheap */
+	if (render_orderChanged) {
+		Mem_Copy(render_order, Entities_ActiveIds, Entities_ActiveCount * 2);
+		render_orderChanged = false;
+	}
+	Entities_SortByTexture();
 	
-	for (i = 0; i < ENTITIES_MAX_COUNT; i++)
+	Entities_VisibleCount = 0;
+	for (i = 0; i < Entities_ActiveCount; i++)
 	{
-		if (!Entities.List[i]) continue;
-		Entities.List[i]->VTABLE->RenderModel(Entities.List[i], delta, t);
+		e = Entities.List[render_order[i]];
+		e->VTABLE->RenderModel(e, delta, t);
+		/* Culling is done while rendering models, as that's where interpolated position is calculated */
+		if (e->ShouldRender) Entities_VisibleIds[Entities_VisibleCount++] = render_order[i];
 	}
 	Gfx_SetAlphaTest(false);
 }
@@ -479,12 +1064,37 @@ static void Entities_ContextLost(void* obj) {
 		if (entity->Flags & ENTITY_FLAG_HAS_MODELVB)
 			Gfx_DeleteDynamicVb(&entity->ModelVB);
 
-		if (!Gfx.ManagedTextures)
-			DeleteSkin(entity);
+	}
+	if (Gfx.ManagedTextures) return;
+
+	for (i = 0; i < SKINS_MAX_ENTRIES; i++)
+	{
+		if (skins_entries[i].texID) Skins_Unload(i);
 	}
 }
 /* No OnContextCreated, skin textures remade when needed */
 
+void Entities_Add(int id, struct Entity* e) {
+	if (!Entities.List[id]) {
+		active_slots[id] = Entities_ActiveCount;
+		Entities_ActiveIds[Entities_ActiveCount++] = id;
+		render_orderChanged = true;
+	}
+	Entities.List[id] = e;
+}
+
+static void Entities_RemoveActive(int id) {
+	int slot = active_slots[id];
+	int last = Entities_ActiveIds[--Entities_ActiveCount];
+
+	/* Move last active entity into the removed entity's slot */
+	Entities_ActiveIds[slot] = last;
+	active_slots[last]       = slot;
+	render_orderChanged      = true;
+	/* List may now contain a removed entity, so wait until next frame's culling pass */
+	Entities_VisibleCount    = 0;
+}
+
 void Entities_Remove(int id) {
 	struct Entity* e = Entities.List[id];
 	if (!e) return;
@@ -492,6 +1102,7 @@ void Entities_Remove(int id) {
 	Event_RaiseInt(&EntityEvents.Removed, id);
 	e->VTABLE->Despawn(e);
 	Entities.List[id] = NULL;
+	Entities_RemoveActive(id);
 
 	/* TODO: Move to EntityEvents.Removed callback instead */
 	if (id < TABLIST_MAX_NAMES && TabList_EntityLinked_Get(id)) {
@@ -509,15 +1120,15 @@ int Entities_GetClosest(struct Entity* src) {
 	float t0, t1;
 	int i;
 
-	for (i = 0; i < ENTITIES_MAX_COUNT; i++) /* because we don't want to pick against local player */
+	for (i = 0; i < Entities_ActiveCount; i++) /* because we don't want to pick against local player */
 	{
-		struct Entity* e = Entities.List[i];
-		if (!e || e == &Entities.CurPlayer->Base) continue;
+		struct Entity* e = Entities_GetActive(i);
+		if (e == &Entities.CurPlayer->Base) continue;
 		if (!Intersection_RayIntersectsRotatedBox(eyePos, dir, e, &t0, &t1)) continue;
 
 		if (targetID == -1 || t0 < closestDist) {
 			closestDist = t0;
-			targetID    = i;
+			targetID    = Entities_ActiveIds[i];
 		}
 	}
 	return targetID;
@@ -709,12 +1320,12 @@ static void LocalPlayer_RenderModel(struct Entity* e, float delta, float t) {
 	AnimatedComp_GetCurrent(e, t);
 	TiltComp_GetCurrent(p, &p->Tilt, t);
 
-	if (!Camera.Active->isThirdPerson && p == Entities.CurPlayer) return;
-	Model_Render(e->Model, e);
+	e->ShouldRender = (Camera.Active->isThirdPerson || p != Entities.CurPlayer) && Model_ShouldRender(e);
+	if (e->ShouldRender) Model_Render(e->Model, e);
 }
 
 static cc_bool LocalPlayer_ShouldRenderName(struct Entity* e) {
-	return Camera.Active->isThirdPerson;
+	return Camera.Active->isThirdPerson && e->ShouldRender;
 }
 
 static void LocalPlayer_CheckJumpVelocity(void* obj) {
@@ -1074,6 +1685,14 @@ void LocalPlayer_CalcDefaultSpawn(struct LocalPlayer* p, struct LocationUpdate*
 *-------------------------------------------------------NetPlayer---------------------------------------------------------*
 *#########################################################################################################################*/
 struct NetPlayer NetPlayers_List[MAX_NET_PLAYERS];
+/* Squared distances beyond which animation is updated less often, and limbs stop being animated */
+static float netPlayers_animLodDist, netPlayers_limbLodDist;
+/* How many ticks apart the animation of players beyond netPlayers_animLodDist is updated */
+#define NETPLAYER_LOD_ANIM_TICKS 3
+
+static float NetPlayer_LodDistance(int blocks) {
+	return blocks ? (float)blocks * blocks : MATH_LARGENUM;
+}
 
 static void NetPlayer_SetLocation(struct Entity* e, struct LocationUpdate* update) {
 	struct NetPlayer* p = (struct NetPlayer*)e;
@@ -1085,14 +1704,30 @@ static void NetPlayer_Tick(struct Entity* e, float delta) {
 	NetInterpComp_AdvanceState(&p->Interp, e);
 
 	Entity_CheckSkin(e);
-	AnimatedComp_Update(e, e->prev.pos, e->next.pos, delta);
+	/* Animation is only visible when rendered */
+	if (!e->ShouldRender) return;
+
+	if (Model_RenderDistance(e) <= netPlayers_animLodDist) {
+		p->animTicks = 0;
+		AnimatedComp_Update(e, e->prev.pos, e->next.pos, delta);
+	} else if (++p->animTicks >= NETPLAYER_LOD_ANIM_TICKS) {
+		/* Movement between prev and next is also used to approximate the skipped ticks movement */
+		p->animTicks = 0;
+		AnimatedComp_Update(e, e->prev.pos, e->next.pos, delta * NETPLAYER_LOD_ANIM_TICKS);
+	}
 }
 
 static void NetPlayer_RenderModel(struct Entity* e, float delta, float t) {
-	Vec3_Lerp(&e->Position, &e->prev.pos, &e->next.pos, t);
-	Entity_LerpAngles(e, t);
+	struct NetPlayer* p = (struct NetPlayer*)e;
 
-	AnimatedComp_GetCurrent(e, t);
+	/* Previous and next states are identical when idle */
+	if (!NetInterpComp_IsIdle(&p->Interp)) {
+		Vec3_Lerp(&e->Position, &e->prev.pos, &e->next.pos, t);
+		Entity_LerpAngles(e, t);
+	}
+
+	/* Limbs are kept in their last pose when too far away to notice */
+	if (Model_RenderDistance(e) <= netPlayers_limbLodDist) AnimatedComp_GetCurrent(e, t);
 	e->ShouldRender = Model_ShouldRender(e);
 	/* Original classic only shows players up to 64 blocks away */
 	if (Game_ClassicMode) e->ShouldRender &= Model_RenderDistance(e) <= 64 * 64;
@@ -1136,11 +1771,18 @@ static void Entities_Init(void) {
 	Entities.ShadowsMode = Options_GetEnum(OPT_ENTITY_SHADOW, SHADOW_MODE_NONE,
 		ShadowMode_Names, Array_Elems(ShadowMode_Names));
 	if (Game_ClassicMode) Entities.ShadowsMode = SHADOW_MODE_NONE;
+	skins_budget = Options_GetInt(OPT_SKINS_VRAM, 0, 4096, 64) * 1024 * 1024;
+	/* 0 disables the corresponding level of detail reduction */
+	netPlayers_animLodDist = NetPlayer_LodDistance(Options_GetInt(OPT_ENTITY_ANIM_LOD, 0, 4096, 64));
+	netPlayers_limbLodDist = NetPlayer_LodDistance(Options_GetInt(OPT_ENTITY_LIMB_LOD, 0, 4096, 128));
+#ifndef CC_BUILD_LOWMEM
+	skins_useAtlas = Options_GetBool(OPT_SKINS_ATLAS, true) && Gfx_CheckTextureSize(SKINS_PAGE_SIZE, SKINS_PAGE_SIZE, 0);
+#endif
 
 	for (i = 0; i < Game_NumStates; i++)
 	{
 		LocalPlayer_Init(&LocalPlayer_Instances[i], i);
-		Entities.List[MAX_NET_PLAYERS + i] = &LocalPlayer_Instances[i].Base;
+		Entities_Add(MAX_NET_PLAYERS + i, &LocalPlayer_Instances[i].Base);
 	}
 	for (; i < MAX_LOCAL_PLAYERS; i++)
 	{
@@ -1156,6 +1798,8 @@ static void Entities_Free(void) {
 	{
 		Entities_Remove(i);
 	}
+	Skins_Clear();
+	SkinDecoder_Free();
 	sources_head = NULL;
 }
 
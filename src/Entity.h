@@ -85,9 +85,9 @@ struct EntityVTABLE {
 	cc_bool (*ShouldRenderName)(struct Entity* e);
 };
 
-/* Skin is still being downloaded asynchronously */
+/* Skin is still being downloaded asynchronously, or its texture needs to be recreated */
 #define SKIN_FETCH_DOWNLOADING 1
-/* Skin was downloaded or copied from another entity with the same skin. */
+/* Skin was downloaded or copied from the skins cache. */
 #define SKIN_FETCH_COMPLETED   2
 
 /* true to restrict model scale (needed for local player, giant model collisions are too costly) */
@@ -101,6 +101,10 @@ struct EntityVTABLE {
 /* Whether in classic mode, to slightly adjust this entity downwards when rendering it */
 /*  to replicate the behaviour of the original vanilla classic client */
 #define ENTITY_FLAG_CLASSIC_ADJUST 0x04
+/* Whether the skin of this entity is part of a shared atlas texture, starting at uOffset/vOffset */
+#define ENTITY_FLAG_SKIN_ATLAS 0x08
+/* Whether NameTex is part of a shared atlas texture, with NameTex.y being the index of its first cell */
+#define ENTITY_FLAG_NAME_ATLAS 0x10
 
 /* Contains a model, along with position, velocity, and rotation. May also contain other fields and properties. */
 struct Entity {
@@ -116,7 +120,7 @@ struct Entity {
 	cc_bool ShouldRender;
 	struct AABB ModelAABB;
 	Vec3 ModelScale, Size;
-	int _skinReqID;
+	int _skinEntry; /* Index + 1 of the skins cache entry, valid when SkinFetchState is non-zero */
 	
 	cc_uint8 SkinType;
 	cc_uint8 SkinFetchState;
@@ -133,6 +137,8 @@ struct Entity {
 	/*  Current state is linearly interpolated between prev and next */
 	struct EntityLocation prev, next;
 	GfxResourceID ModelVB;
+	/* Texture coordinates of the top left of the skin, when ENTITY_FLAG_SKIN_ATLAS is set */
+	float uOffset, vOffset;
 };
 typedef cc_bool (*Entity_TouchesCondition)(BlockID block);
 
@@ -175,10 +181,32 @@ CC_VAR extern struct _EntitiesData {
 	struct LocalPlayer* CurPlayer;
 } Entities;
 
+/* IDs of all the entities in Entities.List that are not NULL, in no particular order */
+/* NOTE: Entities must be added with Entities_Add to be included in this list */
+extern cc_uint16 Entities_ActiveIds[ENTITIES_MAX_COUNT];
+/* Number of entities in Entities_ActiveIds */
+extern int Entities_ActiveCount;
+/* Gets the i'th active entity (not necessarily the entity with ID i) */
+#define Entities_GetActive(i) Entities.List[Entities_ActiveIds[i]]
+
+/* IDs of the entities that passed culling when models were last rendered, in render order */
+/* NOTE: Only valid after Entities_RenderModels has been called in the current frame */
+extern cc_uint16 Entities_VisibleIds[ENTITIES_MAX_COUNT];
+/* Number of entities in Entities_VisibleIds */
+extern int Entities_VisibleCount;
+#define Entities_GetVisible(i) Entities.List[Entities_VisibleIds[i]]
+
 /* Ticks all entities */
 void Entities_Tick(struct ScheduledTask* task);
+/* Stores the IDs of entities that might be within the given horizontal distance of the given position */
+/* NOTE: This is only a quick approximate test, based on where entities were at the start of the current tick */
+/* NOTE: ids must have room for ENTITIES_MAX_COUNT entries */
+int Entities_FindNearby(const Vec3* pos, float radius, cc_uint16* ids);
 /* Renders all entities */
 void Entities_RenderModels(float delta, float t);
+/* Sets the entity with the given ID, and adds it to the list of active entities */
+/* NOTE: Does not raise EntityEvents.Added event */
+void Entities_Add(int id, struct Entity* e);
 /* Removes the given entity, raising EntityEvents.Removed event */
 void Entities_Remove(int id);
 /* Gets the ID of the closest entity to the given entity */
@@ -222,6 +250,7 @@ CC_API void TabList_Set(EntityID id, const cc_string* player, const cc_string* l
 struct NetPlayer {
 	struct Entity Base;
 	struct NetInterpComp Interp;
+	cc_uint8 animTicks; /* Ticks since animation was last updated, when far away */
 };
 CC_API void NetPlayer_Init(struct NetPlayer* player);
 extern struct NetPlayer NetPlayers_List[MAX_NET_PLAYERS];
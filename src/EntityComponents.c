@@ -332,10 +332,36 @@ static void NetInterpComp_AddPosition(struct NetInterpComp* interp, Vec3 pos) {
 	interp->Positions[interp->PositionsCount++] = pos;
 }
 
+/* Tracks how regularly the server sends position updates for this entity */
+static void NetInterpComp_MeasureInterval(struct NetInterpComp* interp) {
+	float interval = (float)(interp->Ticks - interp->LastUpdate);
+	float delta;
+	interp->LastUpdate = interp->Ticks;
+
+	/* Multiple updates can be received in the same tick (e.g. when network is catching up) */
+	if (!interp->AvgInterval) { interp->AvgInterval = max(interval, 1.0f); return; }
+	delta = interval - interp->AvgInterval;
+
+	interp->AvgInterval += delta * 0.125f;
+	interp->Jitter      += (Math_AbsF(delta) - interp->Jitter) * 0.125f;
+}
+
+/* Number of interpolation states that should be kept queued to smooth over packet jitter */
+static int NetInterpComp_TargetDepth(struct NetInterpComp* interp) {
+	int depth;
+	/* No measurements yet, so just use the whole buffer */
+	if (!interp->AvgInterval) return Array_Elems(interp->Positions);
+
+	depth = (int)Math_Ceil(interp->AvgInterval + interp->Jitter * 2.0f) + 1;
+	return min(depth, Array_Elems(interp->Positions));
+}
+
 static void NetInterpComp_SetPosition(struct NetInterpComp* interp, struct LocationUpdate* update, struct Entity* e, int mode) {
 	Vec3 lastPos = interp->CurPos;
 	Vec3* curPos = &interp->CurPos;
 	Vec3 midPos;
+	NetInterpComp_MeasureInterval(interp);
+	interp->IdleTicks = 0;
 
 	if (mode == LU_POS_ABSOLUTE_INSTANT || mode == LU_POS_ABSOLUTE_SMOOTH) {
 		*curPos = update->pos;
@@ -347,6 +373,9 @@ static void NetInterpComp_SetPosition(struct NetInterpComp* interp, struct Locat
 		e->prev.pos = *curPos;
 		e->next.pos = *curPos;
 		interp->PositionsCount = 0;
+	} else if (interp->AvgInterval && interp->AvgInterval < 1.5f) {
+		/* Updates arrive about every tick, so a midpoint would only add latency */
+		NetInterpComp_AddPosition(interp, *curPos);
 	} else {
 		/* Smoother interpolation by also adding midpoint */
 		Vec3_Lerp(&midPos, &lastPos, curPos, 0.5f);
@@ -386,6 +415,7 @@ void NetInterpComp_SetLocation(struct NetInterpComp* interp, struct LocationUpda
 	if (flags & LU_HAS_PITCH) cur->Pitch = Math_ClampAngle(update->pitch);
 	if (flags & LU_HAS_YAW)   cur->Yaw   = Math_ClampAngle(update->yaw);
 
+	interp->IdleTicks = 0;
 	if (!interpolate) {
 		NetInterpAngles_Copy(e->prev, cur); e->prev.rotY = cur->Yaw;
 		NetInterpAngles_Copy(e->next, cur); e->next.rotY = cur->Yaw;
@@ -407,14 +437,31 @@ void NetInterpComp_SetLocation(struct NetInterpComp* interp, struct LocationUpda
 }
 
 void NetInterpComp_AdvanceState(struct NetInterpComp* interp, struct Entity* e) {
+	cc_bool moved = interp->PositionsCount || interp->AnglesCount || interp->RotYCount;
+	interp->Ticks++;
+
+	/* Previous and next states are already identical, so nothing to do */
+	if (!moved && NetInterpComp_IsIdle(interp)) return;
+	interp->IdleTicks = moved ? 0 : interp->IdleTicks + 1;
+
 	e->prev     = e->next;
 	e->Position = e->prev.pos;
 
 	if (interp->PositionsCount) {
+		/* Catch up when more states are queued than needed for the measured jitter, */
+		/*  rather than permanently lagging behind after a burst of packets */
+		while (interp->PositionsCount > NetInterpComp_TargetDepth(interp)) {
+			NetInterpComp_RemoveOldestPosition(interp);
+		}
+
 		e->next.pos = interp->Positions[0];
 		NetInterpComp_RemoveOldestPosition(interp);
 	}
 	if (interp->AnglesCount) {
+		while (interp->AnglesCount > NetInterpComp_TargetDepth(interp)) {
+			NetInterpComp_RemoveOldestAngles(interp);
+		}
+
 		NetInterpAngles_Copy(e->next, &interp->Angles[0]);
 		NetInterpComp_RemoveOldestAngles(interp);
 	}
@@ -1030,16 +1077,19 @@ float PhysicsComp_CalcJumpVelocity(float jumpHeight) {
 }
 
 void PhysicsComp_DoEntityPush(struct Entity* entity) {
+	cc_uint16 ids[ENTITIES_MAX_COUNT];
 	struct Entity* other;
 	cc_bool yIntersects;
 	Vec3 dir;
 	float dist, pushStrength;
-	int id;
+	int i, count;
 	dir.y = 0.0f;
 
-	for (id = 0; id < ENTITIES_MAX_COUNT; id++) {
-		other = Entities.List[id];
-		if (!other || other == entity) continue;
+	/* Entities further than 1 block away don't push, but include some leeway in case they moved this tick */
+	count = Entities_FindNearby(&entity->Position, 2.0f, ids);
+	for (i = 0; i < count; i++) {
+		other = Entities.List[ids[i]];
+		if (other == entity) continue;
 		if (!other->Model->pushes)     continue;
 
 		yIntersects =
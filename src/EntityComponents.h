@@ -99,7 +99,17 @@ struct NetInterpComp {
 	/* Interpolated position and orientation state */
 	int PositionsCount, AnglesCount;
 	Vec3 Positions[10]; struct NetInterpAngles Angles[10];
+	/* Number of ticks advanced, and tick that the last position update was received at */
+	int Ticks, LastUpdate;
+	/* Number of ticks in a row that no interpolation state was consumed */
+	int IdleTicks;
+	/* Average number of ticks between position updates, and average deviation from that */
+	float AvgInterval, Jitter;
 };
+/* Number of ticks without any movement before an entity skips interpolating */
+#define NETINTERP_IDLE_TICKS 2
+/* Whether the entity hasn't moved for a while, so doesn't need to be interpolated */
+#define NetInterpComp_IsIdle(interp) ((interp)->IdleTicks >= NETINTERP_IDLE_TICKS)
 
 void NetInterpComp_SetLocation(struct NetInterpComp* interp, struct LocationUpdate* update, struct Entity* e);
 void NetInterpComp_AdvanceState(struct NetInterpComp* interp, struct Entity* e);
@@ -11,6 +11,7 @@
 #include "World.h"
 #include "Particle.h"
 #include "Drawer2D.h"
+#include "Platform.h"
 
 /*########################################################################################################################*
 *------------------------------------------------------Entity Shadow------------------------------------------------------*
@@ -127,6 +128,8 @@ static cc_bool EntityShadow_GetBlocks(struct Entity* e, int x, int y, int z, str
 	cur     = data;
 	posY    = e->Position.y;
 	outside = !World_ContainsXZ(x, z);
+	/* Shadows are never cast by gas or sprite blocks, so skip straight to the highest other block */
+	if (!outside) y = min(y, World_GetTopVisibleY(x, z));
 
 	for (i = 0; y >= 0 && i < 4; y--) 
 	{
@@ -261,10 +264,10 @@ void EntityShadows_Render(void) {
 	EntityShadow_Draw(&Entities.CurPlayer->Base);
 
 	if (Entities.ShadowsMode == SHADOW_MODE_CIRCLE_ALL) {	
-		for (i = 0; i < ENTITIES_MAX_COUNT; i++) 
+		for (i = 0; i < Entities_VisibleCount; i++) 
 		{
-			e = Entities.List[i];
-			if (!e || !e->ShouldRender || e == &Entities.CurPlayer->Base) continue;
+			e = Entities_GetVisible(i);
+			if (e == &Entities.CurPlayer->Base) continue;
 			EntityShadow_Draw(e);
 		}
 	}
@@ -282,6 +285,110 @@ static GfxResourceID names_VB;
 #define NAME_IS_EMPTY -30000
 #define NAME_OFFSET 3 /* offset of back layer of name above an entity */
 
+/* Names are packed into rows of fixed height cells in shared atlas textures, */
+/*  so that all names can usually be drawn using just one texture */
+#define NAMES_PAGE_SIZE   512
+#define NAMES_CELL_WIDTH  16
+#define NAMES_ROW_HEIGHT  32
+#define NAMES_PAGE_COLS   (NAMES_PAGE_SIZE / NAMES_CELL_WIDTH)
+#define NAMES_PAGE_ROWS   (NAMES_PAGE_SIZE / NAMES_ROW_HEIGHT)
+#define NAMES_MAX_PAGES   4
+
+struct NamesPage {
+	GfxResourceID texID;
+	int used; /* Number of names in this page */
+	cc_uint32 rows[NAMES_PAGE_ROWS]; /* Bitmask of used cells in each row */
+};
+static struct NamesPage names_pages[NAMES_MAX_PAGES];
+
+static cc_bool NamesPage_Create(struct NamesPage* page) {
+	struct Bitmap bmp;
+	BitmapCol* pixels = (BitmapCol*)Mem_TryAllocCleared(NAMES_PAGE_SIZE * NAMES_PAGE_SIZE, 4);
+	if (!pixels) return false;
+
+	Bitmap_Init(bmp, NAMES_PAGE_SIZE, NAMES_PAGE_SIZE, pixels);
+	page->texID = Gfx_CreateTexture(&bmp, TEXTURE_FLAG_MANAGED | TEXTURE_FLAG_DYNAMIC, false);
+	Mem_Free(pixels);
+	return page->texID != 0;
+}
+
+static cc_uint32 NamesPage_CellsMask(int count) {
+	return count == NAMES_PAGE_COLS ? 0xFFFFFFFFU : ((1U << count) - 1);
+}
+
+/* Returns the index of the first of the given number of free adjacent cells, or -1 if the page is full */
+static int NamesPage_FindCells(struct NamesPage* page, int count) {
+	cc_uint32 mask = NamesPage_CellsMask(count);
+	int row, col;
+
+	for (row = 0; row < NAMES_PAGE_ROWS; row++)
+	{
+		for (col = 0; col + count <= NAMES_PAGE_COLS; col++)
+		{
+			if (!(page->rows[row] & (mask << col))) return row * NAMES_PAGE_COLS + col;
+		}
+	}
+	return -1;
+}
+
+/* Copies the drawn name into an atlas page, returning false if it can't be packed */
+static cc_bool NamesAtlas_Add(struct Entity* e, struct Context2D* ctx) {
+	struct NamesPage* page;
+	struct Bitmap part;
+	int i, cell, count = (ctx->width + NAMES_CELL_WIDTH - 1) / NAMES_CELL_WIDTH;
+	int x, y;
+
+	if (Gfx.Limitations & GFX_LIMIT_NO_UV_SUPPORT) return false;
+	if (ctx->width > NAMES_PAGE_SIZE || ctx->height > NAMES_ROW_HEIGHT) return false;
+
+	for (i = 0; i < NAMES_MAX_PAGES; i++)
+	{
+		page = &names_pages[i];
+		if ((cell = NamesPage_FindCells(page, count)) == -1) continue;
+		if (!page->texID && !NamesPage_Create(page)) return false;
+
+		page->rows[cell / NAMES_PAGE_COLS] |= NamesPage_CellsMask(count) << (cell % NAMES_PAGE_COLS);
+		page->used++;
+
+		x = (cell % NAMES_PAGE_COLS) * NAMES_CELL_WIDTH;
+		y = (cell / NAMES_PAGE_COLS) * NAMES_ROW_HEIGHT;
+		Bitmap_Init(part, ctx->width, ctx->height, ctx->bmp.scan0);
+		Gfx_UpdateTexture(page->texID, x, y, &part, ctx->bmp.width, false);
+
+		e->Flags     |= ENTITY_FLAG_NAME_ATLAS;
+		e->NameTex.ID = page->texID;
+		e->NameTex.y  = cell;
+		e->NameTex.width  = ctx->width;
+		e->NameTex.height = ctx->height;
+
+		e->NameTex.uv.u1 = (float)x / NAMES_PAGE_SIZE;
+		e->NameTex.uv.v1 = (float)y / NAMES_PAGE_SIZE;
+		e->NameTex.uv.u2 = (float)(x + ctx->width)  / NAMES_PAGE_SIZE;
+		e->NameTex.uv.v2 = (float)(y + ctx->height) / NAMES_PAGE_SIZE;
+		return true;
+	}
+	return false;
+}
+
+static void NamesAtlas_Remove(struct Entity* e) {
+	struct NamesPage* page;
+	int i, cell = e->NameTex.y, count = (e->NameTex.width + NAMES_CELL_WIDTH - 1) / NAMES_CELL_WIDTH;
+
+	for (i = 0; i < NAMES_MAX_PAGES; i++)
+	{
+		page = &names_pages[i];
+		if (page->texID != e->NameTex.ID) continue;
+
+		page->rows[cell / NAMES_PAGE_COLS] &= ~(NamesPage_CellsMask(count) << (cell % NAMES_PAGE_COLS));
+		page->used--;
+		if (!page->used) Gfx_DeleteTexture(&page->texID);
+		break;
+	}
+
+	e->Flags     &= ~ENTITY_FLAG_NAME_ATLAS;
+	e->NameTex.ID = 0;
+}
+
 static void MakeNameTexture(struct Entity* e) {
 	cc_string colorlessName; char colorlessBuffer[STRING_SIZE];
 	BitmapCol shadowColor = BitmapCol_Make(80, 80, 80, 255);
@@ -310,7 +417,7 @@ static void MakeNameTexture(struct Entity* e) {
 		width  += NAME_OFFSET; 
 		height = Drawer2D_TextHeight(&args) + NAME_OFFSET;
 
-		Context2D_Alloc(&ctx, width, height);
+		Context2D_AllocTemp(&ctx, width, height);
 		{
 			origWhiteColor = Drawer2D.Colors['f'];
 
@@ -323,13 +430,30 @@ static void MakeNameTexture(struct Entity* e) {
 			args.text = name;
 			Context2D_DrawText(&ctx, &args, 0, 0);
 		}
-		Context2D_MakeTexture(&e->NameTex, &ctx);
+		if (!NamesAtlas_Add(e, &ctx)) Context2D_MakeTexture(&e->NameTex, &ctx);
 		Context2D_Free(&ctx);
 	}
 }
 
+/* Names are drawn in batches, which are only flushed when the texture changes or the batch is full */
+#define NAMES_BATCH_MAX 64
+static struct VertexTextured names_batch[NAMES_BATCH_MAX * 4];
+static GfxResourceID names_batchTex;
+static int names_batchCount;
+
+static void FlushNames(void) {
+	if (!names_batchCount) return;
+	if (!names_VB)
+		names_VB = Gfx_CreateDynamicVb(VERTEX_FORMAT_TEXTURED, NAMES_BATCH_MAX * 4);
+
+	Gfx_SetVertexFormat(VERTEX_FORMAT_TEXTURED);
+	Gfx_BindTexture(names_batchTex);
+	Gfx_SetDynamicVbData(names_VB, names_batch, names_batchCount * 4);
+	Gfx_DrawVb_IndexedTris(names_batchCount * 4);
+	names_batchCount = 0;
+}
+
 static void DrawName(struct Entity* e) {
-	struct VertexTextured* vertices;
 	struct Model* model;
 	struct Matrix mat, transform;
 	Vec3 pos;
@@ -339,10 +463,7 @@ static void DrawName(struct Entity* e) {
 	if (!e->VTABLE->ShouldRenderName(e)) return;
 	if (e->NameTex.x == NAME_IS_EMPTY)   return;
 	if (!e->NameTex.ID) MakeNameTexture(e);
-	Gfx_BindTexture(e->NameTex.ID);
-
-	if (!names_VB)
-		names_VB = Gfx_CreateDynamicVb(VERTEX_FORMAT_TEXTURED, 4);
+	if (e->NameTex.x == NAME_IS_EMPTY)   return;
 
 	model = e->Model;
 	Model_GetEntityTransform(model, e, &transform);
@@ -359,17 +480,19 @@ static void DrawName(struct Entity* e) {
 		size.x *= scale * 0.2f; size.y *= scale * 0.2f;
 	}
 
-	Gfx_SetVertexFormat(VERTEX_FORMAT_TEXTURED);
-
-	vertices = (struct VertexTextured*)Gfx_LockDynamicVb(names_VB, VERTEX_FORMAT_TEXTURED, 4);
-	Particle_DoRender(&size, &pos, &e->NameTex.uv, PACKEDCOL_WHITE, vertices);
-	Gfx_UnlockDynamicVb(names_VB);
+	if (names_batchTex != e->NameTex.ID || names_batchCount == NAMES_BATCH_MAX) FlushNames();
+	names_batchTex = e->NameTex.ID;
 
-	Gfx_DrawVb_IndexedTris(4);
+	Particle_DoRender(&size, &pos, &e->NameTex.uv, PACKEDCOL_WHITE, &names_batch[names_batchCount * 4]);
+	names_batchCount++;
 }
 
 void EntityNames_Delete(struct Entity* e) {
-	Gfx_DeleteTexture(&e->NameTex.ID);
+	if (e->Flags & ENTITY_FLAG_NAME_ATLAS) {
+		NamesAtlas_Remove(e);
+	} else {
+		Gfx_DeleteTexture(&e->NameTex.ID);
+	}
 	e->NameTex.x = 0; /* X is used as an 'empty name' flag */
 }
 
@@ -392,11 +515,11 @@ void EntityNames_Render(void) {
 	hadFog = Gfx_GetFog();
 	if (hadFog) Gfx_SetFog(false);
 
-	for (i = 0; i < ENTITIES_MAX_COUNT; i++) 
+	for (i = 0; i < Entities_VisibleCount; i++) 
 	{
-		if (!Entities.List[i]) continue;
-		if (i != closestEntityId) DrawName(Entities.List[i]);
+		if (Entities_VisibleIds[i] != closestEntityId) DrawName(Entities_GetVisible(i));
 	}
+	FlushNames();
 
 	Gfx_SetAlphaTest(false);
 	if (hadFog) Gfx_SetFog(true);
@@ -413,11 +536,11 @@ void EntityNames_RenderHovered(void) {
 	allNames = !(Entities.NamesMode == NAME_MODE_HOVERED || Entities.NamesMode == NAME_MODE_ALL) 
 		&& p->Hacks.CanSeeAllNames;
 
-	for (i = 0; i < ENTITIES_MAX_COUNT; i++) 
+	for (i = 0; i < Entities_VisibleCount; i++) 
 	{
-		e = Entities.List[i];
-		if (!e || e == &p->Base) continue;
-		if (!allNames && i != closestEntityId) continue;
+		e = Entities_GetVisible(i);
+		if (e == &p->Base) continue;
+		if (!allNames && Entities_VisibleIds[i] != closestEntityId) continue;
 
 		/* Only alter the GPU state when actually necessary */
 		if (!setupState) {
@@ -433,6 +556,7 @@ void EntityNames_RenderHovered(void) {
 	}
 
 	if (!setupState) return;
+	FlushNames();
 	Gfx_SetAlphaTest(false);
 	Gfx_SetDepthTest(true);
 	Gfx_SetDepthWrite(true);
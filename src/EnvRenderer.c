@@ -11,6 +11,7 @@
 #include "Utils.h"
 #include "Game.h"
 #include "Logger.h"
+#include "MapRenderer.h"
 #include "Block.h"
 #include "Event.h"
 #include "TexturePack.h"
@@ -21,6 +22,7 @@
 #include "Entity.h"
 
 cc_bool EnvRenderer_Legacy, EnvRenderer_Minimal;
+int EnvRenderer_FogDistance;
 
 static float CalcBlendFactor(float x) {
 	float blend = -0.13f + 0.28f * ((float)Math_Log2(x) * 0.17329f);
@@ -36,6 +38,19 @@ static int CalcNumVertices(int axis1Len, int axis2Len) {
 	return Math_CeilDiv(axis1Len, axisSize) * Math_CeilDiv(axis2Len, axisSize) * 4;
 }
 
+/* Clouds, sky and map borders are built in steps of this many blocks past the edges of the map */
+#define MESH_EXTENT_STEP 512
+/* How far past the edges of the map clouds, sky and map borders were last built */
+static int meshExtent;
+
+/* Anything past the view distance is hidden by the far plane anyways, so meshes only */
+/*  need to be at least that large. Rounding up means that temporary changes to the view */
+/*  distance (e.g. fog from being underwater) don't have to rebuild all the meshes */
+static int CalcMeshExtent(void) {
+	int extent = Utils_AdjViewDist(Game_ViewDistance);
+	return Math_CeilDiv(extent, MESH_EXTENT_STEP) * MESH_EXTENT_STEP;
+}
+
 
 /*########################################################################################################################*
 *------------------------------------------------------------Fog----------------------------------------------------------*
@@ -86,12 +101,19 @@ static void UpdateFogMinimal(float fogDensity) {
 	}
 }
 
+/* ln(0.01), i.e. exp fog coord at which fog is 99% opaque is ln(0.01) / -density */
+#define LOG_001 -4.60517018598809f
+
 static void UpdateFogNormal(float fogDensity, PackedCol fogColor) {
-	float density;
+	float density, dist;
 
 	if (fogDensity != 0.0f) {
 		Gfx_SetFogMode(FOG_EXP);
 		Gfx_SetFogDensity(fogDensity);
+
+		/* Solve coord for f = 0.01, past which terrain is hidden by fog */
+		dist = LOG_001 / -fogDensity;
+		if (dist < Game_UserViewDistance) EnvRenderer_FogDistance = (int)dist + 1;
 	} else if (Env.ExpFog) {
 		Gfx_SetFogMode(FOG_EXP);
 		/* f = 1-z/end   f = e^(-dz)
@@ -100,13 +122,12 @@ static void UpdateFogNormal(float fogDensity, PackedCol fogColor) {
 		   0.99=z/end   --> z=end*0.99
 		     therefore
 		  d = -ln(0.01)/(end*0.99) */
-		#define LOG_001 -4.60517018598809f
-
-		density = -LOG_001 / (Game_ViewDistance * 0.99f);
+		density = -LOG_001 / ((Game_ViewDistance + MapRenderer_LodDistance) * 0.99f);
 		Gfx_SetFogDensity(density);
 	} else {
 		Gfx_SetFogMode(FOG_LINEAR);
-		Gfx_SetFogEnd((float)Game_ViewDistance);
+		/* Fog ends past any distant terrain, so that it is actually visible */
+		Gfx_SetFogEnd((float)(Game_ViewDistance + MapRenderer_LodDistance));
 	}
 	Gfx_SetFogCol(fogColor);
 	Game_SetViewDistance(Game_UserViewDistance);
@@ -119,6 +140,7 @@ void EnvRenderer_UpdateFog(void) {
 
 	CalcFog(&fogDensity, &fogColor);
 	Gfx_ClearColor(fogColor);
+	EnvRenderer_FogDistance = 0;
 
 	if (EnvRenderer_Minimal) {
 		UpdateFogMinimal(fogDensity);
@@ -185,7 +207,7 @@ static void UpdateClouds(void) {
 	if (!World.Loaded || Gfx.LostContext) return;
 	if (EnvRenderer_Minimal) return;
 
-	extent = Utils_AdjViewDist(Game_ViewDistance);
+	extent = meshExtent;
 	x1 = -extent; x2 = World.Width  + extent;
 	z1 = -extent; z2 = World.Length + extent;
 	clouds_vertices = CalcNumVertices(x2 - x1, z2 - z1);
@@ -257,7 +279,7 @@ static void UpdateSky(void) {
 	if (!World.Loaded || Gfx.LostContext) return;
 	if (EnvRenderer_Minimal) return;
 
-	extent = Utils_AdjViewDist(Game_ViewDistance);
+	extent = meshExtent;
 	x1 = -extent; x2 = World.Width  + extent;
 	z1 = -extent; z2 = World.Length + extent;
 	sky_vertices = CalcNumVertices(x2 - x1, z2 - z1);
@@ -341,7 +363,6 @@ void EnvRenderer_RenderSkybox(void) {
 /*########################################################################################################################*
 *----------------------------------------------------------Weather--------------------------------------------------------*
 *#########################################################################################################################*/
-cc_int16* Weather_Heightmap;
 static GfxResourceID rain_tex, snow_tex, weather_vb;
 static float weather_accumulator;
 static IVec3 lastPos;
@@ -351,171 +372,80 @@ static IVec3 lastPos;
 #define WEATHER_RANGE  (WEATHER_EXTENT * 2 + 1)
 
 #define WEATHER_VERTS_COUNT WEATHER_RANGE * WEATHER_RANGE * WEATHER_VERTS
-#define Weather_Pack(x, z) ((x) * World.Length + (z))
-
-static void InitWeatherHeightmap(void) {
-	int i;
-	Weather_Heightmap = (cc_int16*)Mem_Alloc(World.Width * World.Length, 2, "weather heightmap");
-	
-	for (i = 0; i < World.Width * World.Length; i++) {
-		Weather_Heightmap[i] = Int16_MaxValue;
-	}
-}
-
-#define RainCalcBody(get_block)\
-for (y = maxY; y >= 0; y--, i -= World.OneY) {\
-	draw = Blocks.Draw[get_block];\
-\
-	if (!(draw == DRAW_GAS || draw == DRAW_SPRITE)) {\
-		Weather_Heightmap[hIndex] = y;\
-		return y;\
-	}\
-}
-
-static int CalcRainHeightAt(int x, int maxY, int z, int hIndex) {
-	int i = World_Pack(x, maxY, z), y;
-	cc_uint8 draw;
-
-#ifndef EXTENDED_BLOCKS
-	RainCalcBody(World.Blocks[i]);
-#else
-	if (World.IDMask <= 0xFF) {
-		RainCalcBody(World.Blocks[i]);
-	} else {
-		RainCalcBody(World.Blocks[i] | (World.Blocks2[i] << 8));
-	}
-#endif
-
-	Weather_Heightmap[hIndex] = -1;
-	return -1;
-}
 
 static float GetRainHeight(int x, int z) {
-	int hIndex, height;
 	int y;
 	if (!World_ContainsXZ(x, z)) return (float)Env.EdgeHeight;
 
-	hIndex = Weather_Pack(x, z);
-	height = Weather_Heightmap[hIndex];
-
-	y = height == Int16_MaxValue ? CalcRainHeightAt(x, World.MaxY, z, hIndex) : height;
+	y = World_GetTopVisibleY(x, z);
 	return y == -1 ? 0 : y + Blocks.MaxBB[World_GetBlock(x, y, z)].y;
 }
 
-void EnvRenderer_OnBlockChanged(int x, int y, int z, BlockID oldBlock, BlockID newBlock) {
-	cc_bool didBlock = !(Blocks.Draw[oldBlock] == DRAW_GAS || Blocks.Draw[oldBlock] == DRAW_SPRITE);
-	cc_bool nowBlock = !(Blocks.Draw[newBlock] == DRAW_GAS || Blocks.Draw[newBlock] == DRAW_SPRITE);
-	int hIndex, height;
-	if (didBlock == nowBlock) return;
-
-	hIndex = Weather_Pack(x, z);
-	height = Weather_Heightmap[hIndex];
-	/* Two cases can be skipped here: */
-	/* a) rain height was not calculated to begin with (height is short.MaxValue) */
-	/* b) changed y is below current calculated rain height */
-	if (y < height) return;
-
-	if (nowBlock) {
-		/* Simple case: Rest of column below is now not visible to rain. */
-		Weather_Heightmap[hIndex] = y;
-	} else {
-		/* Part of the column is now visible to rain, we don't know how exactly how high it should be though. */
-		/* However, we know that if the old block was above or equal to rain height, then the new rain height must be <= old block.y */
-		CalcRainHeightAt(x, y, z, hIndex);
-	}
-}
-
 static float CalcRainAlphaAt(float x) {
 	/* Wolfram Alpha: fit {0,178},{1,169},{4,147},{9,114},{16,59},{25,9} */
 	float falloff = 0.05f * x * x - 7 * x;
 	return 178 + falloff * Env.WeatherFade;
 }
 
+/* Columns around the camera that weather falls in, only recalculated when the camera moves */
+/*  to another block, or when the height of a column or environment settings may have changed */
 struct RainCoord { int dx, dz; float y; };
+static struct RainCoord weather_coords[WEATHER_RANGE * WEATHER_RANGE];
+static int weather_numCoords, weather_columnsVersion;
+static IVec3 weather_pos;
+/* Whether weather_coords and the vertices in weather_vb need to be recalculated */
+static cc_bool weather_dirty;
 static RNGState snowDirRng;
 
-void EnvRenderer_RenderWeather(float delta) {
-	struct RainCoord coords[WEATHER_RANGE * WEATHER_RANGE];
-	int i, weather, numCoords = 0;
-	struct VertexTextured* v;
-	cc_bool moved, particles;
-	float speed, vOffsetBase, vOffset;
-	IVec3 pos;
-
-	PackedCol color;
-	int dist, dx, dz, x, z;
-	float alpha, y, height;
-	float uOffset1, uOffset2, uSpeed;
-	float worldV, v1, v2, vPlane1Offset;
-	float x1,y1,z1, x2,y2,z2;
-
-	weather = Env.Weather;
-	if (weather == WEATHER_SUNNY) return;
-
-	if (!Weather_Heightmap) 
-		InitWeatherHeightmap();
-	if (!weather_vb)
-		weather_vb = Gfx_CreateDynamicVb(VERTEX_FORMAT_TEXTURED, WEATHER_VERTS_COUNT);
-
-	IVec3_Floor(&pos, &Camera.CurrentPos);
-	moved   = pos.x != lastPos.x || pos.y != lastPos.y || pos.z != lastPos.z;
-	lastPos = pos;
-
-	/* Rain should extend up by 64 blocks, or to the top of the world. */
-	pos.y += 64;
-	pos.y = max(World.Height, pos.y);
-
-	weather_accumulator += delta;
-	particles = weather == WEATHER_RAINY && (weather_accumulator >= 0.25f || moved);
+static void UpdateWeatherColumns(void) {
+	int dx, dz, x, z, numCoords = 0;
+	float y;
 
 	for (dx = -WEATHER_EXTENT; dx <= WEATHER_EXTENT; dx++) {
 		for (dz = -WEATHER_EXTENT; dz <= WEATHER_EXTENT; dz++) {
-			x = pos.x + dx; z = pos.z + dz;
+			x = weather_pos.x + dx; z = weather_pos.z + dz;
 
 			y = GetRainHeight(x, z);
-			if (pos.y <= y) continue;
-			if (particles) Particles_RainSnowEffect((float)x, y, (float)z);
+			if (weather_pos.y <= y) continue;
 
-			coords[numCoords].dx = dx;
-			coords[numCoords].y  = y;
-			coords[numCoords].dz = dz;
+			weather_coords[numCoords].dx = dx;
+			weather_coords[numCoords].y  = y;
+			weather_coords[numCoords].dz = dz;
 			numCoords++;
 		}
 	}
 
-	Gfx_BindTexture(weather == WEATHER_RAINY ? rain_tex : snow_tex);
-	if (particles) weather_accumulator = 0;
-	if (!numCoords) return;
-
-	Gfx_SetAlphaTest(false);
-	Gfx_SetDepthWrite(false);
-	Gfx_SetAlphaArgBlend(true);
+	weather_numCoords      = numCoords;
+	weather_columnsVersion = World_ColumnsVersion;
+}
 
-	Gfx_SetVertexFormat(VERTEX_FORMAT_TEXTURED);
-	v = (struct VertexTextured*)Gfx_LockDynamicVb(weather_vb, 
-										VERTEX_FORMAT_TEXTURED, numCoords * WEATHER_VERTS);
+/* Writes the quads of all the weather columns, with the given falling and drifting offsets */
+static void BuildWeatherMesh(struct VertexTextured* v, int weather, float vOffsetBase, float uSpeed) {
+	PackedCol color;
+	int i, dist, dx, dz, x, z;
+	float alpha, y, height;
+	float uOffset1, uOffset2, vOffset;
+	float worldV, v1, v2, vPlane1Offset;
+	float x1,y1,z1, x2,y2,z2;
 
 	color = Env.SunCol;
-	speed = (weather == WEATHER_RAINY ? 1.0f : 0.2f) * Env.WeatherSpeed;
-
-	vOffsetBase   = (float)Game.Time * speed;
 	vPlane1Offset = weather == WEATHER_RAINY  ? 0 : 0.25f; /* Offset v on 1 plane while snowing to avoid the unnatural mirrored texture effect */
 
-	for (i = 0; i < numCoords; i++)
+	for (i = 0; i < weather_numCoords; i++)
 	{
-		dx = coords[i].dx;
-		y  = coords[i].y;
-		dz = coords[i].dz;
+		dx = weather_coords[i].dx;
+		y  = weather_coords[i].y;
+		dz = weather_coords[i].dz;
 
-		height = pos.y - y;
+		height = weather_pos.y - y;
 
 		dist  = dx * dx + dz * dz;
 		alpha = CalcRainAlphaAt((float)dist);
 		Math_Clamp(alpha, 0.0f, 255.0f);
 		color = (color & PACKEDCOL_RGB_MASK) | PackedCol_A_Bits(alpha);
 
-		x = dx + pos.x;
-		z = dz + pos.z;
+		x = dx + weather_pos.x;
+		z = dz + weather_pos.z;
 
 		uOffset1 = 0;
 		uOffset2 = 0;
@@ -523,7 +453,6 @@ void EnvRenderer_RenderWeather(float delta) {
 			Random_Seed(&snowDirRng, (x + 1217 * z) & 0x7fffffff);
 
 			/* Multiply horizontal speed by a random float from -1 to 1 */
-			uSpeed   = (float)Game.Time * Env.WeatherSpeed * 0.5f;
 			uOffset1 = uSpeed * (Random_Float(&snowDirRng) * 2 + -1);
 			uOffset2 = uSpeed * (Random_Float(&snowDirRng) * 2 + -1);
 
@@ -549,9 +478,86 @@ void EnvRenderer_RenderWeather(float delta) {
 		v->x = x1; v->y = y2; v->z = z2; v->Col = color; v->U = uOffset2;        v->V = v2; v++;
 		v->x = x1; v->y = y1; v->z = z2; v->Col = color; v->U = uOffset2;        v->V = v1; v++;
 	}
+}
 
-	Gfx_UnlockDynamicVb(weather_vb);
-	Gfx_DrawVb_IndexedTris(numCoords * WEATHER_VERTS);
+void EnvRenderer_RenderWeather(float delta) {
+	int i, weather;
+	struct VertexTextured* v;
+	cc_bool moved, particles;
+	float speed, vOffsetBase, uSpeed;
+	IVec3 pos;
+
+	weather = Env.Weather;
+	if (weather == WEATHER_SUNNY) return;
+
+	if (!weather_vb) {
+		weather_vb    = Gfx_CreateDynamicVb(VERTEX_FORMAT_TEXTURED, WEATHER_VERTS_COUNT);
+		weather_dirty = true;
+	}
+
+	IVec3_Floor(&pos, &Camera.CurrentPos);
+	moved   = pos.x != lastPos.x || pos.y != lastPos.y || pos.z != lastPos.z;
+	lastPos = pos;
+
+	/* Rain should extend up by 64 blocks, or to the top of the world. */
+	pos.y += 64;
+	pos.y = max(World.Height, pos.y);
+
+	if (moved || weather_columnsVersion != World_ColumnsVersion) weather_dirty = true;
+	if (weather_dirty) {
+		weather_pos = pos;
+		UpdateWeatherColumns();
+	}
+
+	weather_accumulator += delta;
+	particles = weather == WEATHER_RAINY && (weather_accumulator >= 0.25f || moved);
+
+	if (particles) {
+		for (i = 0; i < weather_numCoords; i++) 
+		{
+			Particles_RainSnowEffect((float)(weather_pos.x + weather_coords[i].dx), weather_coords[i].y,
+									 (float)(weather_pos.z + weather_coords[i].dz));
+		}
+		weather_accumulator = 0;
+	}
+
+	Gfx_BindTexture(weather == WEATHER_RAINY ? rain_tex : snow_tex);
+	/* Mesh is rebuilt anyway once there are columns again, since that requires the columns to change */
+	if (!weather_numCoords) { weather_dirty = false; return; }
+
+	Gfx_SetAlphaTest(false);
+	Gfx_SetDepthWrite(false);
+	Gfx_SetAlphaArgBlend(true);
+	Gfx_SetVertexFormat(VERTEX_FORMAT_TEXTURED);
+
+	speed       = (weather == WEATHER_RAINY ? 1.0f : 0.2f) * Env.WeatherSpeed;
+	vOffsetBase = (float)Game.Time * speed;
+
+	/* Every column of rain falls at the same speed, so the mesh only needs rebuilding when */
+	/*  the columns change and falling can be done purely with a texture offset. However each */
+	/*  column of snow falls and drifts at its own random speed, so it is rebuilt every frame */
+	if (weather == WEATHER_RAINY) {
+		if (weather_dirty) {
+			v = (struct VertexTextured*)Gfx_LockDynamicVb(weather_vb, 
+											VERTEX_FORMAT_TEXTURED, weather_numCoords * WEATHER_VERTS);
+			BuildWeatherMesh(v, weather, 0, 0);
+			Gfx_UnlockDynamicVb(weather_vb);
+		} else {
+			Gfx_BindDynamicVb(weather_vb);
+		}
+		/* Texture repeats, so only the fractional part of the offset matters */
+		Gfx_EnableTextureOffset(0, Math_Mod1(vOffsetBase));
+	} else {
+		uSpeed = (float)Game.Time * Env.WeatherSpeed * 0.5f;
+		v = (struct VertexTextured*)Gfx_LockDynamicVb(weather_vb, 
+										VERTEX_FORMAT_TEXTURED, weather_numCoords * WEATHER_VERTS);
+		BuildWeatherMesh(v, weather, vOffsetBase, uSpeed);
+		Gfx_UnlockDynamicVb(weather_vb);
+	}
+
+	weather_dirty = false;
+	Gfx_DrawVb_IndexedTris(weather_numCoords * WEATHER_VERTS);
+	if (weather == WEATHER_RAINY) Gfx_DisableTextureOffset();
 
 	Gfx_SetAlphaArgBlend(false);
 	Gfx_SetDepthWrite(true);
@@ -610,7 +616,7 @@ static Rect2D EnvRenderer_Rect(int x, int y, int width, int height) {
 }
 
 static void CalcBorderRects(Rect2D* rects) {
-	int extent = Utils_AdjViewDist(Game_ViewDistance);
+	int extent = meshExtent;
 	rects[0] = EnvRenderer_Rect(-extent, -extent,      extent + World.Width + extent, extent);
 	rects[1] = EnvRenderer_Rect(-extent, World.Length, extent + World.Width + extent, extent);
 
@@ -830,6 +836,7 @@ static void OnContextLost(void* obj) {
 }
 
 static void UpdateAll(void) {
+	meshExtent = CalcMeshExtent();
 	UpdateMapSides();
 	UpdateMapEdges();
 	UpdateClouds();
@@ -870,9 +877,14 @@ int EnvRenderer_CalcFlags(const cc_string* mode) {
 static void OnTexturePackChanged(void* obj) {
 	/* TODO: Find better way, really should delete them all here */
 	Gfx_DeleteTexture(&skybox_tex);
+	TextureEntry_Forget(skybox_entry.filename);
 }
 static void OnTerrainAtlasChanged(void* obj) { UpdateBorderTextures(); }
-static void OnViewDistanceChanged(void* obj) { UpdateAll(); }
+static void OnViewDistanceChanged(void* obj) {
+	int extent = CalcMeshExtent();
+	/* Only rebuild when the meshes no longer cover the view distance, or are far larger than needed */
+	if (extent > meshExtent || extent * 4 <= meshExtent) UpdateAll();
+}
 
 static void OnEnvVariableChanged(void* obj, int envVar) {
 	if (envVar == ENV_VAR_EDGE_BLOCK) {
@@ -884,8 +896,10 @@ static void OnEnvVariableChanged(void* obj, int envVar) {
 	} else if (envVar == ENV_VAR_EDGE_HEIGHT || envVar == ENV_VAR_SIDES_OFFSET) {
 		UpdateMapEdges();
 		UpdateMapSides();
+		weather_dirty = true;
 	} else if (envVar == ENV_VAR_SUN_COLOR) {
 		UpdateMapEdges();
+		weather_dirty = true;
 	} else if (envVar == ENV_VAR_SHADOW_COLOR) {
 		UpdateMapSides();
 	} else if (envVar == ENV_VAR_SKY_COLOR) {
@@ -899,6 +913,8 @@ static void OnEnvVariableChanged(void* obj, int envVar) {
 		UpdateClouds();
 	} else if (envVar == ENV_VAR_SKYBOX_COLOR) {
 		Gfx_DeleteVb(&skybox_vb);
+	} else if (envVar == ENV_VAR_WEATHER || envVar == ENV_VAR_WEATHER_FADE) {
+		weather_dirty = true;
 	}
 }
 
@@ -934,16 +950,11 @@ static void OnInit(void) {
 
 static void OnFree(void) {
 	OnContextLost(NULL);
-	Mem_Free(Weather_Heightmap);
-	Weather_Heightmap = NULL;
 }
 
 static void OnReset(void) {
 	Gfx_SetFog(false);
 	DeleteVbs();
-
-	Mem_Free(Weather_Heightmap);
-	Weather_Heightmap = NULL;
 	lastPos = IVec3_MaxValue();
 }
 
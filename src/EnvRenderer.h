@@ -29,9 +29,6 @@ void EnvRenderer_RenderSkybox(void);
 /* Whether a skybox should be rendered. */
 cc_bool EnvRenderer_ShouldRenderSkybox(void);
 
-extern cc_int16* Weather_Heightmap;
-/* Called when a block is changed to update internal weather state. */
-void EnvRenderer_OnBlockChanged(int x, int y, int z, BlockID oldBlock, BlockID newBlock);
 /* Renders rainfall/snowfall weather. */
 void EnvRenderer_RenderWeather(float delta);
 
@@ -41,6 +38,9 @@ extern cc_bool EnvRenderer_Legacy;
 /* Whether minimal environmental effects are rendered. */
 /* Minimal mode disables skybox, clouds and fog. */
 extern cc_bool EnvRenderer_Minimal;
+/* Distance at which fog fully hides terrain, if less than the view distance. 0 if fog doesn't hide terrain early. */
+/* NOTE: This is updated by EnvRenderer_UpdateFog */
+extern int EnvRenderer_FogDistance;
 /* Sets whether Legacy and Minimal modes are used based on given flags. */
 void EnvRenderer_SetMode(int flags);
 /* Calculates mode flags for the given mode. */
@@ -138,5 +138,11 @@ enum CC_ERRORS {
 	SSL_ERR_CONTEXT_DEAD = 0xCCDED070UL, /* Server shutdown the SSL context and it must be recreated */
 	PNG_ERR_16BITSAMPLES = 0xCCDED071UL, /* Image uses 16 bit samples, which is unimplemented */
 	ERR_NO_NETWORKING    = 0xCCDED072UL, /* No working network connection */
+
+	CCR_ERR_SIGNATURE    = 0xCCDED073UL, /* CCR stream bytes #1-#4 aren't "CCRG" */
+	CCR_ERR_VERSION      = 0xCCDED074UL, /* CCR stream bytes #5-#6 aren't 1 */
+	CCR_ERR_INDEX        = 0xCCDED075UL, /* CCR index length doesn't match number of regions in the map */
+	NETCAP_ERR_SIGNATURE = 0xCCDED076UL, /* Network capture bytes #1-#4 aren't "CCNC" */
+	NETCAP_ERR_VERSION   = 0xCCDED077UL, /* Network capture bytes #5-#8 aren't 1 */
 };
 #endif
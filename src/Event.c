@@ -1,7 +1,7 @@
 #include "Event.h"
 #include "Platform.h"
 
-int EventAPIVersion = 4;
+int EventAPIVersion = 5;
 struct _EntityEventsList        EntityEvents;
 struct _TabListEventsList       TabListEvents;
 struct _TextureEventsList       TextureEvents;
@@ -31,6 +31,7 @@ void Event_Register(struct Event_Void* handlers, void* obj, Event_Void_Callback
 		handlers->Handlers[handlers->Count] = handler;
 		handlers->Objs[handlers->Count]     = obj;
 		handlers->Count++;
+		HandlerCost_SetOwner((void*)handler, false);
 	}
 }
 
@@ -52,6 +53,43 @@ void Event_Unregister(struct Event_Void* handlers, void* obj, Event_Void_Callbac
 	}
 }
 
+/* Recalculates which blocks at least one callback is interested in */
+static void Event_UpdateInterest(struct Event_Blocks* handlers) {
+	const cc_uint8* filter;
+	int i, j;
+	Mem_Set(handlers->Interest, 0, sizeof(handlers->Interest));
+
+	for (i = 0; i < handlers->Count; i++) {
+		filter = handlers->Filters[i];
+		if (!filter) {
+			Mem_Set(handlers->Interest, 0xFF, sizeof(handlers->Interest)); return;
+		}
+		for (j = 0; j < (int)sizeof(handlers->Interest); j++) handlers->Interest[j] |= filter[j];
+	}
+}
+
+void Event_RegisterBlocks(struct Event_Blocks* handlers, void* obj, Event_Blocks_Callback handler, const cc_uint8* filter) {
+	Event_Register_(handlers, obj, handler);
+	handlers->Filters[handlers->Count - 1] = filter;
+	Event_UpdateInterest(handlers);
+}
+
+void Event_UnregisterBlocks(struct Event_Blocks* handlers, void* obj, Event_Blocks_Callback handler) {
+	int i, j;
+	for (i = 0; i < handlers->Count; i++) {
+		if (handlers->Handlers[i] != handler || handlers->Objs[i] != obj) continue;
+
+		for (j = i; j < handlers->Count - 1; j++) {
+			handlers->Filters[j] = handlers->Filters[j + 1];
+		}
+		handlers->Filters[handlers->Count - 1] = NULL;
+		break;
+	}
+
+	Event_Unregister_(handlers, obj, handler);
+	Event_UpdateInterest(handlers);
+}
+
 void Event_UnregisterAll(void) {
 	/* NOTE: This MUST be kept in sync with Event.h list of events */
 	EntityEvents.Added.Count   = 0;
@@ -83,6 +121,8 @@ void Event_UnregisterAll(void) {
 	WorldEvents.MapLoaded.Count = 0;
 	WorldEvents.EnvVarChanged.Count = 0;
 	WorldEvents.LightingModeChanged.Count = 0;
+	WorldEvents.BlocksChanged.Count = 0;
+	Event_UpdateInterest(&WorldEvents.BlocksChanged);
 
 	ChatEvents.FontChanged.Count    = 0;
 	ChatEvents.ChatReceived.Count   = 0;
@@ -118,86 +158,234 @@ void Event_UnregisterAll(void) {
 	NetEvents.PluginMessageReceived.Count = 0;
 }
 
+/* Calls the i'th handler with the given arguments, timing it if handler costs are being tallied */
+/* NOTE: The handler is read beforehand, as it may unregister itself while being called */
+#define Event_Invoke(handlers, i, args) \
+	if (!HandlerCost_Enabled) { handlers->Handlers[i] args; } else { \
+		void* func_ = (void*)handlers->Handlers[i]; cc_uint64 beg_ = Stopwatch_Measure(); \
+		handlers->Handlers[i] args; HandlerCost_Record(func_, beg_); }
+
 void Event_RaiseVoid(struct Event_Void* handlers) {
 	int i;
 	for (i = 0; i < handlers->Count; i++) {
-		handlers->Handlers[i](handlers->Objs[i]);
+		Event_Invoke(handlers, i, (handlers->Objs[i]));
 	}
 }
 
 void Event_RaiseInt(struct Event_Int* handlers, int arg) {
 	int i;
 	for (i = 0; i < handlers->Count; i++) {
-		handlers->Handlers[i](handlers->Objs[i], arg);
+		Event_Invoke(handlers, i, (handlers->Objs[i], arg));
 	}
 }
 
 void Event_RaiseFloat(struct Event_Float* handlers, float arg) {
 	int i;
 	for (i = 0; i < handlers->Count; i++) {
-		handlers->Handlers[i](handlers->Objs[i], arg);
+		Event_Invoke(handlers, i, (handlers->Objs[i], arg));
 	}
 }
 
 void Event_RaiseEntry(struct Event_Entry* handlers, struct Stream* stream, const cc_string* name) {
 	int i;
 	for (i = 0; i < handlers->Count; i++) {
-		handlers->Handlers[i](handlers->Objs[i], stream, name);
+		Event_Invoke(handlers, i, (handlers->Objs[i], stream, name));
 	}
 }
 
 void Event_RaiseBlock(struct Event_Block* handlers, IVec3 coords, BlockID oldBlock, BlockID block) {
 	int i;
 	for (i = 0; i < handlers->Count; i++) {
-		handlers->Handlers[i](handlers->Objs[i], coords, oldBlock, block);
+		Event_Invoke(handlers, i, (handlers->Objs[i], coords, oldBlock, block));
+	}
+}
+
+#define Event_FilterMatches(filter, b) ((filter)[(b) >> 3] & (1 << ((b) & 7)))
+void Event_RaiseBlocks(struct Event_Blocks* handlers, const struct BlockChange* changes, int count) {
+	const cc_uint8* filter;
+	int i, j, beg;
+
+	for (i = 0; i < handlers->Count; i++) {
+		filter = handlers->Filters[i];
+		if (!filter) {
+			Event_Invoke(handlers, i, (handlers->Objs[i], changes, count)); continue;
+		}
+
+		/* Pass on runs of changes that match the filter, so that the changes don't need to be copied */
+		for (j = 0; j < count; ) {
+			for (; j < count; j++) {
+				if (Event_FilterMatches(filter, changes[j].oldBlock)) break;
+				if (Event_FilterMatches(filter, changes[j].block))    break;
+			}
+			for (beg = j; j < count; j++) {
+				if (Event_FilterMatches(filter, changes[j].oldBlock)) continue;
+				if (Event_FilterMatches(filter, changes[j].block))    continue;
+				break;
+			}
+			if (j > beg) { Event_Invoke(handlers, i, (handlers->Objs[i], changes + beg, j - beg)); }
+		}
 	}
 }
 
 void Event_RaiseChat(struct Event_Chat* handlers, const cc_string* msg, int msgType) {
 	int i;
 	for (i = 0; i < handlers->Count; i++) {
-		handlers->Handlers[i](handlers->Objs[i], msg, msgType);
+		Event_Invoke(handlers, i, (handlers->Objs[i], msg, msgType));
 	}
 }
 
 void Event_RaiseInput(struct Event_Input* handlers, int key, cc_bool repeating, struct InputDevice* device) {
 	int i;
 	for (i = 0; i < handlers->Count; i++) {
-		handlers->Handlers[i](handlers->Objs[i], key, repeating, device);
+		Event_Invoke(handlers, i, (handlers->Objs[i], key, repeating, device));
 	}
 }
 
 void Event_RaiseString(struct Event_String* handlers, const cc_string* str) {
 	int i;
 	for (i = 0; i < handlers->Count; i++) {
-		handlers->Handlers[i](handlers->Objs[i], str);
+		Event_Invoke(handlers, i, (handlers->Objs[i], str));
 	}
 }
 
 void Event_RaiseRawMove(struct Event_RawMove* handlers, float xDelta, float yDelta) {
 	int i;
 	for (i = 0; i < handlers->Count; i++) {
-		handlers->Handlers[i](handlers->Objs[i], xDelta, yDelta);
+		Event_Invoke(handlers, i, (handlers->Objs[i], xDelta, yDelta));
 	}
 }
 
 void Event_RaisePadAxis(struct Event_PadAxis* handlers, int port, int axis, float x, float y) {
 	int i;
 	for (i = 0; i < handlers->Count; i++) {
-		handlers->Handlers[i](handlers->Objs[i], port, axis, x, y);
+		Event_Invoke(handlers, i, (handlers->Objs[i], port, axis, x, y));
 	}
 }
 
 void Event_RaisePluginMessage(struct Event_PluginMessage* handlers, cc_uint8 channel, cc_uint8* data) {
 	int i;
 	for (i = 0; i < handlers->Count; i++) {
-		handlers->Handlers[i](handlers->Objs[i], channel, data);
+		Event_Invoke(handlers, i, (handlers->Objs[i], channel, data));
 	}
 }
 
 void Event_RaiseLightingMode(struct Event_LightingMode* handlers, cc_uint8 oldMode, cc_bool fromServer) {
 	int i;
 	for (i = 0; i < handlers->Count; i++) {
-		handlers->Handlers[i](handlers->Objs[i], oldMode, fromServer);
+		Event_Invoke(handlers, i, (handlers->Objs[i], oldMode, fromServer));
+	}
+}
+
+
+/*########################################################################################################################*
+*-------------------------------------------------------Handler costs-----------------------------------------------------*
+*#########################################################################################################################*/
+/* Must be a power of two, and large enough for every event handler and scheduled task */
+#define HANDLERCOST_TABLE_SIZE 512
+/* Most owners whose tallies can be combined by HandlerCost_Get */
+#define HANDLERCOST_MAX_OWNERS 128
+
+cc_bool HandlerCost_Enabled;
+void* HandlerCost_Owner;
+/* Open addressing hash table of tallies, keyed by callback address */
+static struct HandlerCost costs_table[HANDLERCOST_TABLE_SIZE];
+static int costs_count;
+
+static struct HandlerCost* HandlerCost_Find(void* func) {
+	cc_uint32 hash = (cc_uint32)((cc_uintptr)func >> 2) * 2654435761U;
+	int i = (int)(hash & (HANDLERCOST_TABLE_SIZE - 1));
+	struct HandlerCost* cost;
+
+	for (;; i = (i + 1) & (HANDLERCOST_TABLE_SIZE - 1)) {
+		cost = &costs_table[i];
+		if (cost->func == func) return cost;
+		if (cost->func) continue;
+
+		/* Keep the table at most 3/4 full, so probe sequences stay short */
+		if (costs_count >= HANDLERCOST_TABLE_SIZE * 3 / 4) return NULL;
+		costs_count++;
+		cost->func = func;
+		return cost;
+	}
+}
+
+void HandlerCost_SetOwner(void* func, cc_bool isTask) {
+	struct HandlerCost* cost = HandlerCost_Find(func);
+	if (!cost) return;
+
+	cost->isTask = isTask;
+	if (!cost->owner) cost->owner = HandlerCost_Owner;
+}
+
+void HandlerCost_Record(void* func, cc_uint64 beg) {
+	cc_uint64 end = Stopwatch_Measure();
+	struct HandlerCost* cost = HandlerCost_Find(func);
+	if (!cost) return;
+
+	cost->elapsed += Stopwatch_ElapsedMicroseconds(beg, end);
+	cost->calls++;
+}
+
+void HandlerCost_Reset(void) {
+	int i;
+	for (i = 0; i < HANDLERCOST_TABLE_SIZE; i++) {
+		costs_table[i].elapsed = 0;
+		costs_table[i].calls   = 0;
+	}
+}
+
+/* Inserts the given tally into the list of up to maxCosts tallies, keeping it sorted from most to least time */
+static void HandlerCost_Insert(struct HandlerCost* costs, int* count, int maxCosts, const struct HandlerCost* tmp) {
+	int j;
+	if (!tmp->calls || !maxCosts) return;
+
+	if (*count == maxCosts) {
+		if (costs[*count - 1].elapsed >= tmp->elapsed) return;
+		(*count)--; /* Drop the tally with the least time spent */
+	}
+
+	for (j = *count; j > 0 && costs[j - 1].elapsed < tmp->elapsed; j--) {
+		costs[j] = costs[j - 1];
+	}
+	costs[j] = *tmp;
+	(*count)++;
+}
+
+int HandlerCost_Get(struct HandlerCost* costs, int maxCosts, cc_bool byOwner) {
+	struct HandlerCost owners[HANDLERCOST_MAX_OWNERS];
+	struct HandlerCost* cost;
+	int i, j, ownersCount = 0, count = 0;
+
+	if (!byOwner) {
+		for (i = 0; i < HANDLERCOST_TABLE_SIZE; i++) {
+			HandlerCost_Insert(costs, &count, maxCosts, &costs_table[i]);
+		}
+		return count;
+	}
+
+	for (i = 0; i < HANDLERCOST_TABLE_SIZE; i++) {
+		cost = &costs_table[i];
+		if (!cost->calls) continue;
+
+		for (j = 0; j < ownersCount; j++) {
+			if (owners[j].owner == cost->owner) break;
+		}
+
+		if (j == ownersCount) {
+			if (ownersCount == HANDLERCOST_MAX_OWNERS) continue;
+			ownersCount++;
+			owners[j].func    = NULL;
+			owners[j].owner   = cost->owner;
+			owners[j].isTask  = false;
+			owners[j].calls   = 0;
+			owners[j].elapsed = 0;
+		}
+		owners[j].calls   += cost->calls;
+		owners[j].elapsed += cost->elapsed;
+	}
+
+	for (i = 0; i < ownersCount; i++) {
+		HandlerCost_Insert(costs, &count, maxCosts, &owners[i]);
 	}
+	return count;
 }
@@ -1,6 +1,7 @@
 #ifndef CC_EVENT_H
 #define CC_EVENT_H
 #include "Vectors.h"
+#include "BlockID.h"
 CC_BEGIN_HEADER
 
 /* Helper methods for using events, and contains all events.
@@ -42,6 +43,18 @@ struct Event_Block {
 	void* Objs[EVENT_MAX_CALLBACKS]; int Count;
 };
 
+/* A block in the world changing from oldBlock to block */
+struct BlockChange { IVec3 coords; BlockID oldBlock, block; };
+typedef void (*Event_Blocks_Callback)(void* obj, const struct BlockChange* changes, int count);
+struct Event_Blocks {
+	Event_Blocks_Callback Handlers[EVENT_MAX_CALLBACKS];
+	void* Objs[EVENT_MAX_CALLBACKS]; int Count;
+	/* Bitset of the blocks each callback is interested in, or NULL for all blocks */
+	const cc_uint8* Filters[EVENT_MAX_CALLBACKS];
+	/* Union of all the filters, so changes no callback is interested in can be skipped cheaply */
+	cc_uint8 Interest[BLOCK_COUNT / 8];
+};
+
 typedef void (*Event_Chat_Callback)(void* obj, const cc_string* msg, int msgType);
 struct Event_Chat {
 	Event_Chat_Callback Handlers[EVENT_MAX_CALLBACKS];
@@ -93,6 +106,17 @@ CC_API void Event_Unregister(struct Event_Void* handlers, void* obj, Event_Void_
 #define Event_Register_(handlers,   obj, handler) Event_Register((struct Event_Void*)(handlers),   obj, (Event_Void_Callback)(handler))
 #define Event_Unregister_(handlers, obj, handler) Event_Unregister((struct Event_Void*)(handlers), obj, (Event_Void_Callback)(handler))
 
+/* Registers a callback function for an event which takes a batch of block changes. */
+/* filter is a bitset of BLOCK_COUNT bits (block b is bit b & 7 of byte b >> 3), and only changes */
+/*  from or to a block in it are passed to the callback. NULL means changes of all blocks are. */
+/* NOTE: filter must stay valid until the callback is unregistered */
+CC_API void Event_RegisterBlocks(struct Event_Blocks* handlers,   void* obj, Event_Blocks_Callback handler, const cc_uint8* filter);
+/* Unregisters a callback function for an event which takes a batch of block changes. */
+/* NOTE: Event_Unregister must not be used instead, as it doesn't update filters */
+CC_API void Event_UnregisterBlocks(struct Event_Blocks* handlers, void* obj, Event_Blocks_Callback handler);
+/* Whether any callback registered for the event is interested in changes from or to the given block */
+#define Event_BlocksInterested(handlers, b) ((handlers)->Interest[(b) >> 3] & (1 << ((b) & 7)))
+
 /* Calls all registered callback for an event with no arguments. */
 CC_API void Event_RaiseVoid(struct Event_Void* handlers);
 /* Calls all registered callback for an event which has an int argument. */
@@ -106,6 +130,9 @@ void Event_RaiseEntry(struct Event_Entry* handlers, struct Stream* stream, const
 /* Calls all registered callbacks for an event which takes block change arguments. */
 /* These are the coordinates/location of the change, block there before, block there now. */
 void Event_RaiseBlock(struct Event_Block* handlers, IVec3 coords, BlockID oldBlock, BlockID block);
+/* Calls all registered callbacks for an event which takes a batch of block changes. */
+/* Each callback is only passed the changes it is interested in, as runs of consecutive changes. */
+void Event_RaiseBlocks(struct Event_Blocks* handlers, const struct BlockChange* changes, int count);
 /* Calls all registered callbacks for an event which has chat message type and contents. */
 /* See MsgType enum in Chat.h for what types of messages there are. */
 void Event_RaiseChat(struct Event_Chat* handlers, const cc_string* msg, int msgType);
@@ -123,6 +150,29 @@ void Event_RaisePluginMessage(struct Event_PluginMessage* handlers, cc_uint8 cha
 /* Calls all registered callbacks for an event called when the Lighting_LightingMode is changed */
 void Event_RaiseLightingMode(struct Event_LightingMode* handlers, cc_uint8 oldMode, cc_bool fromServer);
 
+/* Time spent in an event handler or scheduled task callback, since handler costs were last reset */
+struct HandlerCost {
+	void* func;  /* Address of the callback, or NULL when tallies of an owner are combined */
+	void* owner; /* Component that was being initialised/reset when the callback was registered, or NULL */
+	cc_bool isTask;    /* Whether the callback is a scheduled task instead of an event handler */
+	int calls;         /* Number of times the callback was invoked */
+	cc_uint64 elapsed; /* Total time spent in the callback, in microseconds */
+};
+/* Whether each event handler and scheduled task callback is timed when invoked */
+/* NOTE: Only callbacks invoked on the main thread should be timed */
+extern cc_bool HandlerCost_Enabled;
+/* Component that callbacks registered from now on are attributed to, NULL if unknown */
+extern void* HandlerCost_Owner;
+/* Attributes the given callback to HandlerCost_Owner, unless it is already attributed to a component */
+void HandlerCost_SetOwner(void* func, cc_bool isTask);
+/* Adds the time elapsed since beg (from Stopwatch_Measure) to the tally of the given callback */
+void HandlerCost_Record(void* func, cc_uint64 beg);
+/* Resets the time/calls tallies of all callbacks. (owners are kept) */
+void HandlerCost_Reset(void);
+/* Copies the tallies of up to maxCosts callbacks, from most to least time spent. */
+/* If byOwner is true, the tallies of all callbacks with the same owner are combined first */
+int HandlerCost_Get(struct HandlerCost* costs, int maxCosts, cc_bool byOwner);
+
 void Event_UnregisterAll(void);
 /* NOTE: Event_UnregisterAll MUST be updated when events lists are changed */
 
@@ -131,6 +181,7 @@ void Event_UnregisterAll(void);
 /*  Version 2 - Added WindowEvents.Redrawing */
 /*  Version 3 - Changed InputEvent.Press from code page 437 to unicode character */
 /*  Version 4 - Added InputEvents.Down2 and InputEvents.Up2 */
+/*  Version 5 - Added WorldEvents.BlocksChanged */
 /* You MUST CHECK the event API version before attempting to use the events listed above, */
 /*  as otherwise if the player is using an older client that lacks some of the above events, */
 /*  you will be calling Event_Register on random data instead of the expected EventsList struct */
@@ -179,6 +230,7 @@ CC_VAR extern struct _WorldEventsList {
 	struct Event_Void  MapLoaded;     /* New world has finished loading, player can now interact with it */
 	struct Event_Int   EnvVarChanged; /* World environment variable changed by player/CPE/WoM config */
 	struct Event_LightingMode LightingModeChanged; /* Lighting mode changed. */
+	struct Event_Blocks BlocksChanged; /* Blocks in the world changed (raised in batches, at least once per frame) */
 } WorldEvents;
 
 CC_VAR extern struct _ChatEventsList {
@@ -22,6 +22,12 @@ struct LightNode {
 static struct Queue lightQueue;
 static struct Queue unlightQueue;
 
+/* Spreading the same light level into the same cell more than once is redundant */
+static cc_uint64 LightNode_Key(const void* item) {
+	const struct LightNode* ln = (const struct LightNode*)item;
+	return ((cc_uint64)World_Pack(ln->coords.x, ln->coords.y, ln->coords.z) << 4) | ln->brightness;
+}
+
 /* Top face, X face, Z face, bottomY face*/
 #define PALETTE_SHADES 4
 /* One palette-group for sunlight, one palette-group for shadow */
@@ -39,8 +45,16 @@ static struct Queue unlightQueue;
 /* E.G. myPalette[0b_0010_0001] will give us the color for lamp level 2 and lava level 1 (lowest level is 0) */
 static PackedCol* palettes[PALETTE_COUNT];
 
+/* Light levels of each cell in a chunk, with lamp level in the upper 4 bits and lava level in the lower 4 bits */
 typedef cc_uint8* LightingChunk;
 static cc_uint8* chunkLightingDataFlags;
+/* Light level of every cell in a chunk that has no per-cell light levels allocated */
+/*  (usually 0, as most chunks in a map do not have any light sources nearby) */
+static cc_uint8* chunkLightingUniform;
+/* Whether a chunk needs its lighting recalculated once the current lighting batch ends */
+static cc_uint8* chunkLightingBatch;
+#define BATCH_CHUNK_CHANGED 1 /* A block in this chunk was changed */
+#define BATCH_CHUNK_RELIGHT 2 /* This chunk or a neighbouring chunk changed */
 #define CHUNK_UNCALCULATED 0
 #define CHUNK_SELF_CALCULATED 1
 #define CHUNK_ALL_CALCULATED 2
@@ -106,18 +120,19 @@ static void AllocState(void) {
 	InitPalettes();
 	chunksCount = World.ChunksCount;
 
-	chunkLightingDataFlags = (cc_uint8*)Mem_AllocCleared(chunksCount, sizeof(cc_uint8), "light flags");
-	chunkLightingData = (LightingChunk*)Mem_AllocCleared(chunksCount, sizeof(LightingChunk), "light chunks");
+	chunkLightingDataFlags = (cc_uint8*)Mem_MapAllocCleared(chunksCount, sizeof(cc_uint8), "light flags");
+	chunkLightingData = (LightingChunk*)Mem_MapAllocCleared(chunksCount, sizeof(LightingChunk), "light chunks");
+	chunkLightingUniform   = (cc_uint8*)Mem_MapAllocCleared(chunksCount, sizeof(cc_uint8), "light uniform");
+	chunkLightingBatch     = (cc_uint8*)Mem_MapAllocCleared(chunksCount, sizeof(cc_uint8), "light batch");
 	Queue_Init(&lightQueue, sizeof(struct LightNode));
 	Queue_Init(&unlightQueue, sizeof(struct LightNode));
+	Queue_SetDedupe(&lightQueue, LightNode_Key);
 }
 
 static void FreeState(void) {
 	int i;
-	ClassicLighting_FreeState();
-	
 	/* This function can be called multiple times without calling AllocState, so... */
-	if (!chunkLightingDataFlags) return;
+	if (!chunkLightingDataFlags) { ClassicLighting_FreeState(); return; }
 
 	FreePalettes();
 
@@ -125,12 +140,18 @@ static void FreeState(void) {
 		Mem_Free(chunkLightingData[i]);
 	}
 
-	Mem_Free(chunkLightingDataFlags);
-	Mem_Free(chunkLightingData);
+	/* Freed in reverse order of allocation, so the map arena can reuse the space when switching lighting mode */
+	Mem_MapFree(chunkLightingBatch);
+	Mem_MapFree(chunkLightingUniform);
+	Mem_MapFree(chunkLightingData);
+	Mem_MapFree(chunkLightingDataFlags);
 	chunkLightingDataFlags = NULL;
 	chunkLightingData = NULL;
+	chunkLightingUniform   = NULL;
+	chunkLightingBatch     = NULL;
 	Queue_Clear(&lightQueue);
 	Queue_Clear(&unlightQueue);
+	ClassicLighting_FreeState();
 }
 
 /* Converts chunk x/y/z coordinates to the corresponding index in chunks array/list */
@@ -140,6 +161,31 @@ static void FreeState(void) {
 /* Converts global x/y/z coordinates to the corresponding index in a chunk */
 #define GlobalCoordsToChunkCoordsIndex(x, y, z) (LocalCoordsToIndex(x & CHUNK_MASK, y & CHUNK_MASK, z & CHUNK_MASK))
 
+/* Allocates per-cell light levels for a chunk, filled with the chunk's uniform light level */
+static LightingChunk ExpandChunk(int chunkIndex) {
+	LightingChunk chunk = (cc_uint8*)Mem_TryAlloc(CHUNK_SIZE_3, sizeof(cc_uint8));
+	if (!chunk) return NULL;
+
+	Mem_Set(chunk, chunkLightingUniform[chunkIndex], CHUNK_SIZE_3);
+	chunkLightingData[chunkIndex] = chunk;
+	return chunk;
+}
+
+/* Frees the per-cell light levels of a chunk if every cell has the same light level */
+static void CompactChunk(int chunkIndex) {
+	LightingChunk chunk = chunkLightingData[chunkIndex];
+	int i;
+	if (!chunk) return;
+
+	for (i = 1; i < CHUNK_SIZE_3; i++) {
+		if (chunk[i] != chunk[0]) return;
+	}
+
+	chunkLightingUniform[chunkIndex] = chunk[0];
+	chunkLightingData[chunkIndex]    = NULL;
+	Mem_Free(chunk);
+}
+
 /* Sets the light level at this cell. Does NOT check that the cell is in bounds. */
 static void SetBrightness(cc_uint8 brightness, int x, int y, int z, cc_bool isLamp, cc_bool refreshChunk) {
 	cc_uint8 clearMask, shift = isLamp ? FANCY_LIGHTING_LAMP_SHIFT : 0, prevValue;
@@ -149,13 +195,16 @@ static void SetBrightness(cc_uint8 brightness, int x, int y, int z, cc_bool isLa
 	int chunkIndex = ChunkCoordsToIndex(cx, cy, cz);
 	int localIndex = LocalCoordsToIndex(lx, ly, lz);
 
-	if (chunkLightingData[chunkIndex] == NULL) {
-		chunkLightingData[chunkIndex] = (cc_uint8*)Mem_TryAllocCleared(CHUNK_SIZE_3, sizeof(cc_uint8));
-	}
-
 	/* 00001111 if lamp, otherwise 11110000*/
 	clearMask = ~(FANCY_LIGHTING_MAX_LEVEL << shift);
 
+	if (chunkLightingData[chunkIndex] == NULL) {
+		prevValue = chunkLightingUniform[chunkIndex];
+		/* Avoid allocating per-cell light levels when they wouldn't change anyways */
+		if (((prevValue & clearMask) | (brightness << shift)) == prevValue) return;
+		ExpandChunk(chunkIndex);
+	}
+
 	if (refreshChunk) {
 		prevValue = chunkLightingData[chunkIndex][localIndex];
 
@@ -183,13 +232,15 @@ static cc_uint8 GetBrightness(int x, int y, int z, cc_bool isLamp) {
 	int cy = y >> CHUNK_SHIFT, ly = y & CHUNK_MASK;
 	int cz = z >> CHUNK_SHIFT, lz = z & CHUNK_MASK;
 	int chunkIndex = ChunkCoordsToIndex(cx, cy, cz), localIndex;
+	cc_uint8 value;
 
-	if (chunkLightingData[chunkIndex] == NULL) { return 0; }
-	localIndex = LocalCoordsToIndex(lx, ly, lz);
-
-	return isLamp ?
-		chunkLightingData[chunkIndex][localIndex] >> FANCY_LIGHTING_LAMP_SHIFT :
-		chunkLightingData[chunkIndex][localIndex] & FANCY_LIGHTING_MAX_LEVEL;
+	if (chunkLightingData[chunkIndex] == NULL) {
+		value = chunkLightingUniform[chunkIndex];
+	} else {
+		localIndex = LocalCoordsToIndex(lx, ly, lz);
+		value      = chunkLightingData[chunkIndex][localIndex];
+	}
+	return isLamp ? value >> FANCY_LIGHTING_LAMP_SHIFT : value & FANCY_LIGHTING_MAX_LEVEL;
 }
 
 
@@ -322,6 +373,285 @@ static void CalculateChunkLightingSelf(int chunkIndex, int cx, int cy, int cz) {
 	chunkLightingDataFlags[chunkIndex] = CHUNK_SELF_CALCULATED;
 }
 
+/*########################################################################################################################*
+*-----------------------------------------------Multithreaded self lighting-----------------------------------------------*
+*#########################################################################################################################*/
+#ifdef CC_BUILD_BUILDERTHREADS
+#define LIGHT_MAX_THREADS 16
+#define LIGHT_MAX_JOBS    27
+/* Light from a source never travels further than this many blocks away from it */
+#define LIGHT_REGION_MARGIN (FANCY_LIGHTING_MAX_LEVEL - 1)
+#define LIGHT_REGION_SIZE   (CHUNK_SIZE + LIGHT_REGION_MARGIN * 2)
+#define LIGHT_REGION_SIZE_3 (LIGHT_REGION_SIZE * LIGHT_REGION_SIZE * LIGHT_REGION_SIZE)
+
+/* Private lighting state for a thread, so that chunks can be self lit independently of each other. */
+/* Self lighting of a chunk is flood filled into a region around the chunk, then afterwards merged */
+/*  into the global lighting data. As flood filled light levels are always the maximum of the */
+/*  levels from each individual source, merging by taking the maximum gives the same result. */
+struct LightWorker {
+	struct Queue queue;
+	cc_uint8* region;
+	int originX, originY, originZ;
+};
+struct LightJob { int index, cx, cy, cz; };
+
+static struct LightWorker light_workers[LIGHT_MAX_THREADS + 1];
+static struct LightJob light_jobs[LIGHT_MAX_JOBS];
+static int light_jobsCount, light_nextJob;
+static void* light_mutex;
+static void* light_mergeMutex;
+static void* light_doneSignal;
+static int light_busyThreads;
+static cc_bool light_quit;
+
+static void* light_threads[LIGHT_MAX_THREADS];
+static void* light_signals[LIGHT_MAX_THREADS];
+static int light_threadsCount, light_startedCount;
+
+#define RegionIndex(w, x, y, z) ((((y) - w->originY) * LIGHT_REGION_SIZE + ((z) - w->originZ)) * LIGHT_REGION_SIZE + ((x) - w->originX))
+
+static cc_uint8 GetRegionBrightness(struct LightWorker* w, int x, int y, int z, cc_bool isLamp) {
+	cc_uint8 value = w->region[RegionIndex(w, x, y, z)];
+	return isLamp ? value >> FANCY_LIGHTING_LAMP_SHIFT : value & FANCY_LIGHTING_MAX_LEVEL;
+}
+
+static void SetRegionBrightness(struct LightWorker* w, cc_uint8 brightness, int x, int y, int z, cc_bool isLamp) {
+	cc_uint8 shift = isLamp ? FANCY_LIGHTING_LAMP_SHIFT : 0;
+	int index = RegionIndex(w, x, y, z);
+
+	w->region[index] &= ~(FANCY_LIGHTING_MAX_LEVEL << shift);
+	w->region[index] |= brightness << shift;
+}
+
+#define Light_TrySpreadRegion(axis, AXIS, dir, limit, isLamp, thisFace, thatFace) \
+	if (ln.coords.axis dir ## = limit && \
+		CanLightPass(thisBlock, FACE_ ## AXIS ## thisFace) && \
+		CanLightPass(World_GetBlock(ln.coords.x, ln.coords.y, ln.coords.z), FACE_ ## AXIS ## thatFace) && \
+		GetRegionBrightness(w, ln.coords.x, ln.coords.y, ln.coords.z, isLamp) < ln.brightness) { \
+		Queue_Enqueue(&w->queue, &ln); \
+	} \
+
+/* Same as FlushLightQueue, but only reads and writes the thread's private lighting region */
+static void FlushRegionQueue(struct LightWorker* w, cc_bool isLamp) {
+	struct LightNode ln;
+	BlockID thisBlock;
+
+	while (w->queue.count > 0) {
+		ln = *(struct LightNode*)(Queue_Dequeue(&w->queue));
+
+		if (GetRegionBrightness(w, ln.coords.x, ln.coords.y, ln.coords.z, isLamp) >= ln.brightness) { continue; }
+		if (ln.brightness == 0) { continue; }
+
+		SetRegionBrightness(w, ln.brightness, ln.coords.x, ln.coords.y, ln.coords.z, isLamp);
+
+		thisBlock = World_GetBlock(ln.coords.x, ln.coords.y, ln.coords.z);
+		ln.brightness--;
+		if (ln.brightness == 0) continue;
+
+		ln.coords.x--;
+		Light_TrySpreadRegion(x, X, > , 0, isLamp, MAX, MIN)
+		ln.coords.x += 2;
+		Light_TrySpreadRegion(x, X, < , World.MaxX, isLamp, MIN, MAX)
+		ln.coords.x--;
+
+		ln.coords.y--;
+		Light_TrySpreadRegion(y, Y, >, 0, isLamp, MAX, MIN)
+		ln.coords.y += 2;
+		Light_TrySpreadRegion(y, Y, <, World.MaxY, isLamp, MIN, MAX)
+		ln.coords.y--;
+
+		ln.coords.z--;
+		Light_TrySpreadRegion(z, Z, > , 0, isLamp, MAX, MIN)
+		ln.coords.z += 2;
+		Light_TrySpreadRegion(z, Z, < , World.MaxZ, isLamp, MIN, MAX)
+	}
+}
+
+/* Merges the light levels in the thread's private region into the global lighting data */
+static void MergeRegion(struct LightWorker* w) {
+	int x1 = max(w->originX, 0), x2 = min(w->originX + LIGHT_REGION_SIZE, World.Width);
+	int y1 = max(w->originY, 0), y2 = min(w->originY + LIGHT_REGION_SIZE, World.Height);
+	int z1 = max(w->originZ, 0), z2 = min(w->originZ + LIGHT_REGION_SIZE, World.Length);
+	int x, y, z, chunkIndex, localIndex;
+	cc_uint8 value, cur, lamp, lava;
+	LightingChunk chunk;
+
+	Mutex_Lock(light_mergeMutex);
+	for (y = y1; y < y2; y++) {
+		for (z = z1; z < z2; z++) {
+			for (x = x1; x < x2; x++) {
+				value = w->region[RegionIndex(w, x, y, z)];
+				if (!value) continue;
+
+				chunkIndex = ChunkCoordsToIndex(x >> CHUNK_SHIFT, y >> CHUNK_SHIFT, z >> CHUNK_SHIFT);
+				chunk      = chunkLightingData[chunkIndex];
+				if (!chunk && !(chunk = ExpandChunk(chunkIndex))) continue;
+
+				localIndex = GlobalCoordsToChunkCoordsIndex(x, y, z);
+				cur  = chunk[localIndex];
+				lamp = max(cur >> FANCY_LIGHTING_LAMP_SHIFT, value >> FANCY_LIGHTING_LAMP_SHIFT);
+				lava = max(cur & FANCY_LIGHTING_MAX_LEVEL,   value & FANCY_LIGHTING_MAX_LEVEL);
+				chunk[localIndex] = (lamp << FANCY_LIGHTING_LAMP_SHIFT) | lava;
+			}
+		}
+	}
+	Mutex_Unlock(light_mergeMutex);
+}
+
+/* Same as CalculateChunkLightingSelf, but works on the thread's private lighting region */
+static void SelfLightJob(struct LightWorker* w, struct LightJob* job) {
+	int x, y, z, chunkStartX, chunkStartY, chunkStartZ, chunkEndX, chunkEndY, chunkEndZ;
+	cc_bool any = false, isLamp;
+	struct LightNode entry;
+	cc_uint8 brightness;
+	BlockID curBlock;
+
+	chunkStartX = job->cx * CHUNK_SIZE;
+	chunkStartY = job->cy * CHUNK_SIZE;
+	chunkStartZ = job->cz * CHUNK_SIZE;
+	chunkEndX = min(chunkStartX + CHUNK_SIZE, World.Width);
+	chunkEndY = min(chunkStartY + CHUNK_SIZE, World.Height);
+	chunkEndZ = min(chunkStartZ + CHUNK_SIZE, World.Length);
+
+	w->originX = chunkStartX - LIGHT_REGION_MARGIN;
+	w->originY = chunkStartY - LIGHT_REGION_MARGIN;
+	w->originZ = chunkStartZ - LIGHT_REGION_MARGIN;
+
+	for (y = chunkStartY; y < chunkEndY; y++) {
+		for (z = chunkStartZ; z < chunkEndZ; z++) {
+			for (x = chunkStartX; x < chunkEndX; x++) {
+				curBlock = World_GetBlock(x, y, z);
+				if (!Blocks.Brightness[curBlock]) continue;
+
+				/* Region is only cleared once a chunk with a light source is found, */
+				/*  as most chunks in a map usually do not have any */
+				if (!any) { Mem_Set(w->region, 0, LIGHT_REGION_SIZE_3); any = true; }
+
+				/* If no lava brightness, it must use lamp brightness */
+				brightness = GetBlockBrightness(curBlock, false);
+				isLamp     = brightness == 0;
+				if (isLamp) brightness = Blocks.Brightness[curBlock] >> FANCY_LIGHTING_LAMP_SHIFT;
+
+				LightNode_Init(entry, x, y, z, brightness);
+				Queue_Enqueue(&w->queue, &entry);
+				FlushRegionQueue(w, isLamp);
+			}
+		}
+	}
+	if (any) MergeRegion(w);
+}
+
+/* Self lights chunks in the current batch, until there are no jobs left */
+static void RunLightJobs(struct LightWorker* w) {
+	int i;
+	if (!w->region) w->region = (cc_uint8*)Mem_Alloc(LIGHT_REGION_SIZE_3, 1, "light region");
+
+	for (;;) {
+		Mutex_Lock(light_mutex);
+		i = light_nextJob++;
+		Mutex_Unlock(light_mutex);
+
+		if (i >= light_jobsCount) return;
+		SelfLightJob(w, &light_jobs[i]);
+	}
+}
+
+static void LightWorkerLoop(void) {
+	struct LightWorker* w;
+	cc_bool done;
+	void* signal;
+	int id;
+
+	Mutex_Lock(light_mutex);
+	id = light_startedCount++;
+	Mutex_Unlock(light_mutex);
+	signal = light_signals[id];
+	w      = &light_workers[id + 1];
+
+	for (;;) {
+		Waitable_Wait(signal);
+		if (light_quit) return;
+		RunLightJobs(w);
+
+		Mutex_Lock(light_mutex);
+		done = --light_busyThreads == 0;
+		Mutex_Unlock(light_mutex);
+		if (done) Waitable_Signal(light_doneSignal);
+	}
+}
+
+/* Self lights all chunks in the current batch, using the main thread and worker threads */
+static void RunLightBatch(void) {
+	int i, count = min(light_threadsCount, light_jobsCount - 1);
+	cc_bool busy;
+
+	Mutex_Lock(light_mutex);
+	light_nextJob     = 0;
+	light_busyThreads = count;
+	Mutex_Unlock(light_mutex);
+
+	for (i = 0; i < count; i++) Waitable_Signal(light_signals[i]);
+	RunLightJobs(&light_workers[0]);
+
+	for (;;) {
+		Mutex_Lock(light_mutex);
+		busy = light_busyThreads > 0;
+		Mutex_Unlock(light_mutex);
+
+		if (!busy) break;
+		Waitable_Wait(light_doneSignal);
+	}
+
+	for (i = 0; i < light_jobsCount; i++) {
+		chunkLightingDataFlags[light_jobs[i].index] = CHUNK_SELF_CALCULATED;
+	}
+}
+
+static void InitLightThreads(void) {
+	int i;
+	light_threadsCount = Options_GetInt(OPT_LIGHT_THREADS, 0, LIGHT_MAX_THREADS, 3);
+	for (i = 0; i <= light_threadsCount; i++) {
+		Queue_Init(&light_workers[i].queue, sizeof(struct LightNode));
+		Queue_SetDedupe(&light_workers[i].queue, LightNode_Key);
+	}
+	if (!light_threadsCount) return;
+
+	light_mutex      = Mutex_Create("Light jobs");
+	light_mergeMutex = Mutex_Create("Light merge");
+	light_doneSignal = Waitable_Create("Light done");
+
+	for (i = 0; i < light_threadsCount; i++) {
+		light_signals[i] = Waitable_Create("Light worker");
+	}
+	for (i = 0; i < light_threadsCount; i++) {
+		Thread_Run(&light_threads[i], LightWorkerLoop, 128 * 1024, "Chunk lighter");
+	}
+}
+
+static void FreeLightThreads(void) {
+	int i;
+	for (i = 0; i <= light_threadsCount; i++) {
+		Queue_Clear(&light_workers[i].queue);
+		Mem_Free(light_workers[i].region);
+		light_workers[i].region = NULL;
+	}
+	if (!light_threadsCount) return;
+	light_quit = true;
+
+	for (i = 0; i < light_threadsCount; i++) {
+		Waitable_Signal(light_signals[i]);
+		Thread_Join(light_threads[i]);
+		Waitable_Free(light_signals[i]);
+	}
+
+	Waitable_Free(light_doneSignal);
+	Mutex_Free(light_mergeMutex);
+	Mutex_Free(light_mutex);
+	light_threadsCount = 0;
+}
+#endif
+
+
 static void CalculateChunkLightingAll(int chunkIndex, int cx, int cy, int cz) {
 	int x, y, z;
 	/* Chunk coordinates */
@@ -343,6 +673,33 @@ static void CalculateChunkLightingAll(int chunkIndex, int cx, int cy, int cz) {
 	if (chunkEndY == World.ChunksY) { chunkEndY--; }
 	if (chunkEndZ == World.ChunksZ) { chunkEndZ--; }
 
+#ifdef CC_BUILD_BUILDERTHREADS
+	/* Self lighting of each chunk is independent, so can be split across threads */
+	if (light_threadsCount) {
+		light_jobsCount = 0;
+
+		for (y = chunkStartY; y <= chunkEndY; y++) {
+			for (z = chunkStartZ; z <= chunkEndZ; z++) {
+				for (x = chunkStartX; x <= chunkEndX; x++) {
+					curChunkIndex = ChunkCoordsToIndex(x, y, z);
+					if (chunkLightingDataFlags[curChunkIndex] != CHUNK_UNCALCULATED) continue;
+
+					light_jobs[light_jobsCount].index = curChunkIndex;
+					light_jobs[light_jobsCount].cx = x;
+					light_jobs[light_jobsCount].cy = y;
+					light_jobs[light_jobsCount].cz = z;
+					light_jobsCount++;
+				}
+			}
+		}
+
+		if (light_jobsCount) RunLightBatch();
+		chunkLightingDataFlags[chunkIndex] = CHUNK_ALL_CALCULATED;
+		CompactChunk(chunkIndex);
+		return;
+	}
+#endif
+
 	for (y = chunkStartY; y <= chunkEndY; y++) {
 		for (z = chunkStartZ; z <= chunkEndZ; z++) {
 			for (x = chunkStartX; x <= chunkEndX; x++) {
@@ -355,6 +712,9 @@ static void CalculateChunkLightingAll(int chunkIndex, int cx, int cy, int cz) {
 		}
 	}
 	chunkLightingDataFlags[chunkIndex] = CHUNK_ALL_CALCULATED;
+	/* Light from neighbouring chunks can no longer spread into this chunk, */
+	/*  so its light levels will only change again due to block changes */
+	CompactChunk(chunkIndex);
 }
 
 
@@ -460,12 +820,162 @@ static void CalcBlockChange(int x, int y, int z, BlockID oldBlock, BlockID newBl
 
 	CalcUnlight(x, y, z, oldLightLevelHere, isLamp);
 }
+
+
+/*########################################################################################################################*
+*-----------------------------------------------------Batched relighting--------------------------------------------------*
+*#########################################################################################################################*/
+/* Blocks changed in a batch beyond this many are relit per chunk, instead of individually */
+#define BATCH_MAX_INCREMENTAL 64
+static int batchChanges;
+static cc_bool batchAnyChanged;
+
+static const cc_int8 batchFaceOffsets[FACE_COUNT][3] = {
+	{ -1, 0, 0 }, { 1, 0, 0 }, { 0, 0, -1 }, { 0, 0, 1 }, { 0, -1, 0 }, { 0, 1, 0 }
+};
+
+/* Queues light spreading into a chunk from the cells just outside one of its faces */
+static void SeedFromFace(int cx, int cy, int cz, int face, cc_bool isLamp) {
+	int x1 = cx * CHUNK_SIZE, x2 = min(x1 + CHUNK_SIZE, World.Width);
+	int y1 = cy * CHUNK_SIZE, y2 = min(y1 + CHUNK_SIZE, World.Height);
+	int z1 = cz * CHUNK_SIZE, z2 = min(z1 + CHUNK_SIZE, World.Length);
+	int dx = batchFaceOffsets[face][0], dy = batchFaceOffsets[face][1], dz = batchFaceOffsets[face][2];
+	int x, y, z;
+	struct LightNode entry;
+	cc_uint8 brightness;
+
+	/* Collapse the chunk's bounds to the layer of cells on this face */
+	if (dx < 0) x2 = x1 + 1; else if (dx > 0) x1 = x2 - 1;
+	if (dy < 0) y2 = y1 + 1; else if (dy > 0) y1 = y2 - 1;
+	if (dz < 0) z2 = z1 + 1; else if (dz > 0) z1 = z2 - 1;
+
+	for (y = y1; y < y2; y++) {
+		for (z = z1; z < z2; z++) {
+			for (x = x1; x < x2; x++) {
+				brightness = GetBrightness(x + dx, y + dy, z + dz, isLamp);
+				if (brightness <= 1) continue;
+
+				if (!CanLightPass(World_GetBlock(x + dx, y + dy, z + dz), (Face)face)) continue;
+				if (!CanLightPass(World_GetBlock(x, y, z), (Face)(face ^ 1)))         continue;
+
+				LightNode_Init(entry, x, y, z, brightness - 1);
+				Queue_Enqueue(&lightQueue, &entry);
+			}
+		}
+	}
+}
+
+/* Spreads light from all light sources in a chunk, and from outside neighbouring chunks being relit */
+static void RelightChunk(int cx, int cy, int cz, cc_bool isLamp) {
+	int x1 = cx * CHUNK_SIZE, x2 = min(x1 + CHUNK_SIZE, World.Width);
+	int y1 = cy * CHUNK_SIZE, y2 = min(y1 + CHUNK_SIZE, World.Height);
+	int z1 = cz * CHUNK_SIZE, z2 = min(z1 + CHUNK_SIZE, World.Length);
+	int x, y, z, face, nx, ny, nz;
+	struct LightNode entry;
+	cc_uint8 brightness;
+
+	for (y = y1; y < y2; y++) {
+		for (z = z1; z < z2; z++) {
+			for (x = x1; x < x2; x++) {
+				brightness = GetBlockBrightness(World_GetBlock(x, y, z), isLamp);
+				if (!brightness) continue;
+
+				LightNode_Init(entry, x, y, z, brightness);
+				Queue_Enqueue(&lightQueue, &entry);
+			}
+		}
+	}
+
+	for (face = 0; face < FACE_COUNT; face++) {
+		nx = cx + batchFaceOffsets[face][0];
+		ny = cy + batchFaceOffsets[face][1];
+		nz = cz + batchFaceOffsets[face][2];
+
+		if (nx < 0 || ny < 0 || nz < 0 || nx >= World.ChunksX || ny >= World.ChunksY || nz >= World.ChunksZ) continue;
+		if (chunkLightingBatch[ChunkCoordsToIndex(nx, ny, nz)] & BATCH_CHUNK_RELIGHT) continue;
+		SeedFromFace(cx, cy, cz, face, isLamp);
+	}
+	FlushLightQueue(isLamp, false);
+}
+
+static void MarkRelight(int cx, int cy, int cz) {
+	int x, y, z;
+	for (y = max(cy - 1, 0); y <= min(cy + 1, World.ChunksY - 1); y++) {
+		for (z = max(cz - 1, 0); z <= min(cz + 1, World.ChunksZ - 1); z++) {
+			for (x = max(cx - 1, 0); x <= min(cx + 1, World.ChunksX - 1); x++) {
+				chunkLightingBatch[ChunkCoordsToIndex(x, y, z)] |= BATCH_CHUNK_RELIGHT;
+			}
+		}
+	}
+}
+
+/* Meshes of neighbouring chunks also use the light levels at the borders of a chunk */
+static void RefreshNeighbours(int cx, int cy, int cz) {
+	int x, y, z;
+	for (y = cy - 1; y <= cy + 1; y++) {
+		for (z = cz - 1; z <= cz + 1; z++) {
+			for (x = cx - 1; x <= cx + 1; x++) {
+				MapRenderer_RefreshChunk(x, y, z);
+			}
+		}
+	}
+}
+
+/* Light from a changed block can only reach into neighbouring chunks, so all light in changed */
+/*  and neighbouring chunks is cleared and then spread again from light sources in those chunks */
+/*  and from the light levels just outside them (which are unaffected by the changed blocks) */
+static void FlushBatch(void) {
+	int cx, cy, cz, i;
+	ClassicLighting_FlushBatch();
+
+	batchChanges = 0;
+	if (!batchAnyChanged) return;
+	batchAnyChanged = false;
+
+	for (cy = 0; cy < World.ChunksY; cy++) {
+		for (cz = 0; cz < World.ChunksZ; cz++) {
+			for (cx = 0; cx < World.ChunksX; cx++) {
+				if (chunkLightingBatch[ChunkCoordsToIndex(cx, cy, cz)] & BATCH_CHUNK_CHANGED) MarkRelight(cx, cy, cz);
+			}
+		}
+	}
+
+	for (i = 0; i < chunksCount; i++) {
+		if (!(chunkLightingBatch[i] & BATCH_CHUNK_RELIGHT)) continue;
+
+		Mem_Free(chunkLightingData[i]);
+		chunkLightingData[i]    = NULL;
+		chunkLightingUniform[i] = 0;
+		/* All light sources in the chunk are about to be spread */
+		if (chunkLightingDataFlags[i] == CHUNK_UNCALCULATED) chunkLightingDataFlags[i] = CHUNK_SELF_CALCULATED;
+	}
+
+	for (cy = 0; cy < World.ChunksY; cy++) {
+		for (cz = 0; cz < World.ChunksZ; cz++) {
+			for (cx = 0; cx < World.ChunksX; cx++) {
+				if (!(chunkLightingBatch[ChunkCoordsToIndex(cx, cy, cz)] & BATCH_CHUNK_RELIGHT)) continue;
+
+				RelightChunk(cx, cy, cz, false);
+				RelightChunk(cx, cy, cz, true);
+				RefreshNeighbours(cx, cy, cz);
+			}
+		}
+	}
+	Mem_Set(chunkLightingBatch, 0, chunksCount);
+}
+
 static void OnBlockChanged(int x, int y, int z, BlockID oldBlock, BlockID newBlock) {
 	/* For some reason this is a possible case */
 	if (oldBlock == newBlock) { return; }
 
 	ClassicLighting_OnBlockChanged(x, y, z, oldBlock, newBlock);
 
+	if (Lighting_BatchDepth && ++batchChanges > BATCH_MAX_INCREMENTAL) {
+		chunkLightingBatch[ChunkCoordsToIndex(x >> CHUNK_SHIFT, y >> CHUNK_SHIFT, z >> CHUNK_SHIFT)] |= BATCH_CHUNK_CHANGED;
+		batchAnyChanged = true;
+		return;
+	}
+
 	CalcBlockChange(x, y, z, oldBlock, newBlock, false);
 	CalcBlockChange(x, y, z, oldBlock, newBlock, true);
 }
@@ -496,9 +1006,9 @@ static PackedCol Color_Core(int x, int y, int z, int paletteFace) {
 	chunkIndex = ChunkCoordsToIndex(cx, cy, cz);
 	CalcForChunkIfNeeded(cx, cy, cz, chunkIndex);
 
-	/* There might be no light data in this chunk even after it was calculated */
+	/* There might be no per-cell light data in this chunk even after it was calculated */
 	if (chunkLightingData[chunkIndex] == NULL) {
-		lightData = 0;
+		lightData = chunkLightingUniform[chunkIndex];
 	} else {
 		chunkCoordsIndex = GlobalCoordsToChunkCoordsIndex(x, y, z);
 		lightData = chunkLightingData[chunkIndex][chunkCoordsIndex];
@@ -537,6 +1047,7 @@ static PackedCol Color_ZSide(int x, int y, int z) {
 
 static void LightHint(int startX, int startY, int startZ) {
 	int cx, cy, cz, chunkIndex;
+	int x1, y1, z1, x2, y2, z2;
 	ClassicLighting_LightHint(startX, startY, startZ);
 	/* Add 1 to startX/Z, as coordinates are for the extended chunk (18x18x18) */
 	startX++; startY++; startZ++;
@@ -545,13 +1056,43 @@ static void LightHint(int startX, int startY, int startZ) {
 	cy = (startY + HALF_CHUNK_SIZE) >> CHUNK_SHIFT;
 	cz = (startZ + HALF_CHUNK_SIZE) >> CHUNK_SHIFT;
 
-	chunkIndex = ChunkCoordsToIndex(cx, cy, cz);
-	CalcForChunkIfNeeded(cx, cy, cz, chunkIndex);
+	/* Chunk meshes may also be built on other threads, so light for all neighbouring */
+	/*  chunks must be calculated in advance, as Color_Core must not calculate it lazily */
+	x1 = max(cx - 1, 0); x2 = min(cx + 1, World.ChunksX - 1);
+	y1 = max(cy - 1, 0); y2 = min(cy + 1, World.ChunksY - 1);
+	z1 = max(cz - 1, 0); z2 = min(cz + 1, World.ChunksZ - 1);
+
+	for (cy = y1; cy <= y2; cy++) {
+		for (cz = z1; cz <= z2; cz++) {
+			for (cx = x1; cx <= x2; cx++) {
+				chunkIndex = ChunkCoordsToIndex(cx, cy, cz);
+				CalcForChunkIfNeeded(cx, cy, cz, chunkIndex);
+			}
+		}
+	}
+}
+
+cc_uint32 FancyLighting_MemoryUsage(void) {
+	cc_uint32 size = ClassicLighting_MemoryUsage();
+	int i;
+	if (!chunkLightingDataFlags) return size;
+
+	/* Flags, uniform and batch bytes, plus a pointer to per-cell light levels for each chunk */
+	size += chunksCount * (3 + sizeof(LightingChunk));
+	for (i = 0; i < chunksCount; i++) {
+		if (chunkLightingData[i]) size += CHUNK_SIZE_3;
+	}
+
+	for (i = 0; i < PALETTE_COUNT; i++) {
+		if (palettes[i]) size += FANCY_LIGHTING_LEVELS * FANCY_LIGHTING_LEVELS * sizeof(PackedCol);
+	}
+	return size;
 }
 
 void FancyLighting_SetActive(void) {
 	Lighting.OnBlockChanged = OnBlockChanged;
 	Lighting.Refresh = Refresh;
+	Lighting.FlushBatch = FlushBatch;
 	Lighting.IsLit = IsLit;
 	Lighting.Color = Color;
 	Lighting.Color_XSide = Color_XSide;
@@ -580,4 +1121,13 @@ static void OnEnvVariableChanged(void* obj, int envVar) {
 
 void FancyLighting_OnInit(void) {
 	Event_Register_(&WorldEvents.EnvVarChanged, NULL, OnEnvVariableChanged);
+#ifdef CC_BUILD_BUILDERTHREADS
+	InitLightThreads();
+#endif
+}
+
+void FancyLighting_OnFree(void) {
+#ifdef CC_BUILD_BUILDERTHREADS
+	FreeLightThreads();
+#endif
 }
@@ -21,6 +21,7 @@
 static struct LocationUpdate* spawn_point;
 static struct MapImporter* imp_head;
 static struct MapImporter* imp_tail;
+static void Ccr_FinishLoad(const cc_string* path);
 
 
 /*########################################################################################################################*
@@ -34,6 +35,26 @@ static cc_result Map_ReadBlocks(struct Stream* stream) {
 	return Stream_Read(stream, World.Blocks, World.Volume);
 }
 
+/* Writes the lower 8 bits (upper false) or upper 8 bits (upper true) of every block in the world */
+static cc_result Map_WriteBlocks(struct Stream* stream, cc_bool upper) {
+#ifdef CC_BUILD_PALETTEWORLD
+	BlockRaw buffer[4096];
+	cc_result res;
+	int i, count;
+
+	for (i = 0; i < World.Volume; i += count) {
+		count = min(World.Volume - i, (int)sizeof(buffer));
+		World_CopyRawBlocks(i, count, buffer, upper ? 8 : 0);
+		if ((res = Stream_Write(stream, buffer, count))) return res;
+	}
+	return 0;
+#elif defined EXTENDED_BLOCKS
+	return Stream_Write(stream, upper ? World.Blocks2 : World.Blocks, World.Volume);
+#else
+	return Stream_Write(stream, World.Blocks, World.Volume);
+#endif
+}
+
 static cc_result Map_SkipGZipHeader(struct Stream* stream) {
 	struct GZipHeader gzHeader;
 	cc_result res;
@@ -66,11 +87,21 @@ cc_result Map_LoadFrom(const cc_string* path) {
 	struct LocationUpdate update = { 0 };
 	struct MapImporter* imp;
 	struct Stream stream;
+	cc_uint8* data;
+	cc_uint32 length;
 	cc_result res;
 	Game_Reset();
 	
 	spawn_point = &update;
-	res = Stream_OpenFile(&stream, path);
+	/* Reading the whole file upfront avoids many small file reads while decoding */
+	res = Stream_ReadAllFrom(path, &data, &length);
+
+	if (!res) {
+		Stream_ReadonlyMemory(&stream, data, length);
+	} else if (res == ERR_OUT_OF_MEMORY) {
+		/* Too large to fit in memory, so decode directly from the file instead */
+		res = Stream_OpenSequentialFile(&stream, path);
+	}
 	if (res) { Logger_SysWarn2(res, "opening", path); return res; }
 
 	imp = MapImporter_Find(path);
@@ -82,9 +113,11 @@ cc_result Map_LoadFrom(const cc_string* path) {
 
 	/* No point logging error for closing readonly file */
 	(void)stream.Close(&stream);
+	Mem_Free(data);
 	if (res) Logger_SysWarn2(res, "decoding", path);
 
 	World_SetNewMap(World.Blocks, World.Width, World.Height, World.Length);
+	if (!res) Ccr_FinishLoad(path);
 	if (!spawn_point) LocalPlayer_CalcDefaultSpawn(Entities.CurPlayer, &update);
 	LocalPlayers_MoveToSpawn(&update);
 
@@ -457,6 +490,7 @@ static cc_result Nbt_ReadTag(cc_uint8 typeId, cc_bool readTagName, struct Stream
 		if (NbtTag_IsSmall(&tag)) {
 			res = Stream_Read(stream, tag.value.small, tag.dataSize);
 		} else {
+			/* Large arrays are inflated directly into the allocation that Nbt_TakeArray hands out */
 			tag.value.big = (cc_uint8*)Mem_TryAlloc(tag.dataSize, 1);
 			if (!tag.value.big) return ERR_OUT_OF_MEMORY;
 
@@ -666,12 +700,15 @@ static void Cw_Callback_1(struct NbtTag* tag) {
 		return;
 	}
 
+	/* Free any array from an earlier duplicate tag, rather than leaking it */
 	if (IsTag(tag, "BlockArray")) {
+		Mem_Free(World.Blocks);
 		World.Volume = tag->dataSize;
 		World.Blocks = Nbt_TakeArray(tag, ".cw map blocks");
 	}
 #ifdef EXTENDED_BLOCKS
 	if (IsTag(tag, "BlockArray2")) {
+		Mem_Free(World.Blocks2);
 		World_SetMapUpper(Nbt_TakeArray(tag, ".cw map blocks2"));
 	}
 #endif
@@ -874,7 +911,12 @@ static void Cw_Callback(struct NbtTag* tag) {
 /* Imports a world from a .cw ClassicWorld map file */
 /* Used by ClassiCube/ClassicalSharp */
 static cc_result Cw_Load(struct Stream* stream) {
-	return Nbt_Read(stream, Cw_Callback);
+	cc_result res;
+	/* Maps can contain hundreds of block definitions, so only refresh after reading all of them */
+	Block_BeginDefineBatch();
+	res = Nbt_Read(stream, Cw_Callback);
+	Block_EndDefineBatch();
+	return res;
 }
 
 
@@ -1570,12 +1612,11 @@ static cc_result Cw_WriteBockDef(struct Stream* stream, int b) {
 	return Stream_Write(stream, buffer, (int)(cur - buffer));
 }
 
-cc_result Cw_Save(struct Stream* stream) {
+/* Writes everything before the contents of the BlockArray tag */
+static cc_result Cw_WriteHeader(struct Stream* stream, int volume) {
 	struct LocalPlayer* p = Entities.CurPlayer;
 	cc_uint8 buffer[2048];
 	cc_uint8* cur;
-	cc_result res;
-	int b;
 
 	cur = buffer;
 	cur = Nbt_WriteDict(cur,   "ClassicWorld");
@@ -1600,20 +1641,27 @@ cc_result Cw_Save(struct Stream* stream) {
 		cur  = Nbt_WriteUInt8(cur,  "H", Math_Deg2Packed(p->SpawnYaw));
 		cur  = Nbt_WriteUInt8(cur,  "P", Math_Deg2Packed(p->SpawnPitch));
 	} *cur++ = NBT_END;
-	cur = Nbt_WriteArray(cur, "BlockArray", World.Volume);
+	cur = Nbt_WriteArray(cur, "BlockArray", volume);
 
-	if ((res = Stream_Write(stream, buffer, (int)(cur - buffer)))) return res;
-	if ((res = Stream_Write(stream, World.Blocks, World.Volume)))  return res;
+	return Stream_Write(stream, buffer, (int)(cur - buffer));
+}
 
-#ifdef EXTENDED_BLOCKS
-	if (World.Blocks != World.Blocks2) {
-		cur = buffer;
-		cur = Nbt_WriteArray(cur, "BlockArray2", World.Volume);
+static cc_result Cw_WriteUpperHeader(struct Stream* stream, int volume) {
+	cc_uint8 buffer[64];
+	cc_uint8* cur;
 
-		if ((res = Stream_Write(stream, buffer, (int)(cur - buffer)))) return res;
-		if ((res = Stream_Write(stream, World.Blocks2, World.Volume))) return res;
-	}
-#endif
+	cur = buffer;
+	cur = Nbt_WriteArray(cur, "BlockArray2", volume);
+	return Stream_Write(stream, buffer, (int)(cur - buffer));
+}
+
+/* Writes everything after the contents of the block arrays */
+static cc_result Cw_WriteMetadata(struct Stream* stream) {
+	struct LocalPlayer* p = Entities.CurPlayer;
+	cc_uint8 buffer[2048];
+	cc_uint8* cur;
+	cc_result res;
+	int b;
 
 	cur = buffer;
 	cur = Nbt_WriteDict(cur, "Metadata");
@@ -1677,6 +1725,212 @@ cc_result Cw_Save(struct Stream* stream) {
 	return Stream_Write(stream, cw_end, sizeof(cw_end));
 }
 
+cc_result Cw_Save(struct Stream* stream) {
+	cc_result res;
+	if ((res = Cw_WriteHeader(stream, World.Volume))) return res;
+	if ((res = Map_WriteBlocks(stream, false)))       return res;
+
+#ifdef EXTENDED_BLOCKS
+	/* Only worlds using more than 256 blocks have a separate upper blocks array */
+	if (World.IDMask > 0xFF) {
+		if ((res = Cw_WriteUpperHeader(stream, World.Volume))) return res;
+		if ((res = Map_WriteBlocks(stream, true)))             return res;
+	}
+#endif
+	return Cw_WriteMetadata(stream);
+}
+
+
+/*########################################################################################################################*
+*---------------------------------------------------Background .cw export-------------------------------------------------*
+*#########################################################################################################################*/
+#ifdef CC_BUILD_BUILDERTHREADS
+static struct CwBackgroundSave {
+	void* thread;
+	void* lock;
+	struct Stream file;
+	struct Stream header, metadata; /* Serialised on the main thread before saving starts */
+	cc_bool hasUpper, done;
+	int level, threads, volume, numPages;
+	cc_result res;
+	Cw_SaveCallback callback;
+	cc_string path; char pathBuffer[FILENAME_SIZE];
+} cw_bg;
+static cc_bool cw_bgTaskAdded;
+
+static cc_result Cw_BufferWrite(struct Stream* s, const cc_uint8* data, cc_uint32 count, cc_uint32* modified) {
+	cc_uint32 used, size;
+	cc_uint8* base;
+
+	if (count > s->meta.mem.left) {
+		used = s->meta.mem.length - s->meta.mem.left;
+		size = s->meta.mem.length * 2 + count;
+		base = (cc_uint8*)Mem_TryRealloc(s->meta.mem.base, size, 1);
+		if (!base) { *modified = 0; return ERR_OUT_OF_MEMORY; }
+
+		s->meta.mem.base   = base;
+		s->meta.mem.cur    = base + used;
+		s->meta.mem.left   = size - used;
+		s->meta.mem.length = size;
+	}
+
+	Mem_Copy(s->meta.mem.cur, data, count);
+	s->meta.mem.cur  += count;
+	s->meta.mem.left -= count;
+	*modified = count;
+	return 0;
+}
+
+/* Initialises a stream that writes to a memory buffer, growing it as needed */
+static void Cw_InitBuffer(struct Stream* s) {
+	Stream_Init(s);
+	s->Write = Cw_BufferWrite;
+	s->meta.mem.cur    = NULL;
+	s->meta.mem.left   = 0;
+	s->meta.mem.length = 0;
+	s->meta.mem.base   = NULL;
+}
+
+static cc_result Cw_WriteBuffer(struct Stream* dst, struct Stream* buffer) {
+	return Stream_Write(dst, buffer->meta.mem.base, buffer->meta.mem.length - buffer->meta.mem.left);
+}
+
+static cc_result Cw_WriteSnapshot(struct Stream* stream) {
+	BlockRaw* page;
+	cc_result res = 0;
+	int a, p, count;
+
+	page = (BlockRaw*)Mem_TryAlloc(WORLD_SNAPSHOT_PAGE_SIZE, 1);
+	if (!page) return ERR_OUT_OF_MEMORY;
+	if ((res = Cw_WriteBuffer(stream, &cw_bg.header))) goto finished;
+
+	for (a = 0; a < (cw_bg.hasUpper ? 2 : 1); a++) {
+		/* header for the upper block array is appended right after the lower block array */
+		if (a == 1 && (res = Cw_WriteUpperHeader(stream, cw_bg.volume))) goto finished;
+
+		for (p = 0; p < cw_bg.numPages; p++) {
+			if ((res = World_ReadSnapshot(a, p, page, &count))) goto finished;
+			if ((res = Stream_Write(stream, page, count)))      goto finished;
+		}
+	}
+	res = Cw_WriteBuffer(stream, &cw_bg.metadata);
+
+finished:
+	Mem_Free(page);
+	return res;
+}
+
+static void Cw_BackgroundSaveLoop(void) {
+	struct GZipState* state = NULL;
+	struct Stream compStream;
+	cc_result res, closeRes;
+
+	if (!GZip_MakeParallelStream(&compStream, &cw_bg.file, cw_bg.level, cw_bg.threads)) {
+		state = (struct GZipState*)Mem_TryAlloc(1, sizeof(struct GZipState));
+		if (!state) { res = ERR_OUT_OF_MEMORY; goto finished; }
+
+		GZip_MakeStream(&compStream, state, &cw_bg.file);
+		state->Base.Level = cw_bg.level;
+	}
+
+	/* Still need to close the compressor on error, to free its resources */
+	res      = Cw_WriteSnapshot(&compStream);
+	closeRes = compStream.Close(&compStream);
+	if (!res) res = closeRes;
+	Mem_Free(state);
+
+finished:
+	closeRes = cw_bg.file.Close(&cw_bg.file);
+	if (!res) res = closeRes;
+
+	Mutex_Lock(cw_bg.lock);
+	{
+		cw_bg.res  = res;
+		cw_bg.done = true;
+	}
+	Mutex_Unlock(cw_bg.lock);
+}
+
+static void Cw_JoinBackgroundSave(void) {
+	Thread_Join(cw_bg.thread);
+	cw_bg.thread = NULL;
+
+	World_EndSnapshot();
+	Mutex_Free(cw_bg.lock);
+	Mem_Free(cw_bg.header.meta.mem.base);
+	Mem_Free(cw_bg.metadata.meta.mem.base);
+}
+
+void Cw_FinishBackgroundSave(void) {
+	if (!cw_bg.thread) return;
+	Cw_JoinBackgroundSave();
+	cw_bg.callback(&cw_bg.path, cw_bg.res);
+}
+
+static void Cw_CheckBackgroundSave(struct ScheduledTask* task) {
+	cc_bool done;
+	if (!cw_bg.thread) return;
+
+	Mutex_Lock(cw_bg.lock);
+	{
+		done = cw_bg.done;
+	}
+	Mutex_Unlock(cw_bg.lock);
+	if (done) Cw_FinishBackgroundSave();
+}
+
+cc_bool Cw_SaveInBackground(struct Stream* file, const cc_string* path, int level, int threads, Cw_SaveCallback callback) {
+	int arrays;
+	Cw_FinishBackgroundSave();
+
+	Cw_InitBuffer(&cw_bg.header);
+	Cw_InitBuffer(&cw_bg.metadata);
+	/* Errors here can only be from running out of memory, so just save on the main thread instead */
+	if (Cw_WriteHeader(&cw_bg.header, World.Volume) || Cw_WriteMetadata(&cw_bg.metadata)) goto failed;
+
+	arrays = World_BeginSnapshot();
+	if (!arrays) goto failed;
+
+	if (!cw_bgTaskAdded) {
+		ScheduledTask_Add(0.1, Cw_CheckBackgroundSave);
+		cw_bgTaskAdded = true;
+	}
+
+	cw_bg.file     = *file;
+	cw_bg.hasUpper = arrays > 1;
+	cw_bg.done     = false;
+	cw_bg.level    = level;
+	cw_bg.threads  = threads;
+	cw_bg.volume   = World.Volume;
+	cw_bg.numPages = (World.Volume + (WORLD_SNAPSHOT_PAGE_SIZE - 1)) / WORLD_SNAPSHOT_PAGE_SIZE;
+	cw_bg.res      = 0;
+	cw_bg.callback = callback;
+
+	String_InitArray(cw_bg.path, cw_bg.pathBuffer);
+	String_Copy(&cw_bg.path, path);
+
+	cw_bg.lock = Mutex_Create("Map saver");
+	Thread_Run(&cw_bg.thread, Cw_BackgroundSaveLoop, 256 * 1024, "Map saver");
+	return true;
+
+failed:
+	Mem_Free(cw_bg.header.meta.mem.base);
+	Mem_Free(cw_bg.metadata.meta.mem.base);
+	return false;
+}
+static void Cw_FreeBackgroundSave(void) {
+	/* Other components may already be freed, so don't report the result */
+	if (cw_bg.thread) Cw_JoinBackgroundSave();
+}
+#else
+static void Cw_FreeBackgroundSave(void) { }
+void Cw_FinishBackgroundSave(void) { }
+
+cc_bool Cw_SaveInBackground(struct Stream* file, const cc_string* path, int level, int threads, Cw_SaveCallback callback) {
+	return false;
+}
+#endif
+
 
 /*########################################################################################################################*
 *---------------------------------------------------Schematic export------------------------------------------------------*
@@ -1711,7 +1965,7 @@ cc_result Schematic_Save(struct Stream* stream) {
 		Stream_SetU32_BE(&tmp[74], World.Volume);
 	}
 	if ((res = Stream_Write(stream, tmp, sizeof(sc_begin)))) return res;
-	if ((res = Stream_Write(stream, World.Blocks, World.Volume))) return res;
+	if ((res = Map_WriteBlocks(stream, false)))              return res;
 
 	Mem_Copy(tmp, sc_data, sizeof(sc_data));
 	{
@@ -1856,10 +2110,429 @@ cc_result Dat_Save(struct Stream* stream) {
 }
 
 
+/*########################################################################################################################*
+*-----------------------------------------------ClassiCube region map format----------------------------------------------*
+*#########################################################################################################################*/
+/* Region maps store the blocks of each 64x64x64 region of the world in an independently compressed record.
+   Saving to the same file again then only needs to append records for regions that have changed,
+   followed by a new index. (the file is only rewritten once stale records take up more space than current ones)
+     Header                 Index
+|-------------------|  |-----------------------|  Records are raw DEFLATE compressed, and contain the
+| U8[4] "CCRG"      |  | U32 MetadataOffset    |   lower 8 bits of each block in the region in YZX order,
+| U16 Version (1)   |  | U32 MetadataLength    |   then the upper 8 bits if bit 0 of Flags is set.
+| U16 Reserved      |  | U16 X, Y, Z           |  Metadata is a GZIP compressed .cw file whose BlockArray is empty
+| U32 IndexOffset   |  | Region[count] regions |
+| U32 IndexLength   |  |_______________________|       Region
+|___________________|                           |-------------------|
+                                                | U32 Offset        |
+All values are big endian, and regions are      | U32 Length        |
+ ordered in YZX order.                          | U8  Flags         |
+                                                |___________________| */
+#define CCR_VERSION 1
+#define CCR_REGION_SHIFT  6
+#define CCR_REGION_SIZE   (1 << CCR_REGION_SHIFT)
+#define CCR_REGION_VOLUME (CCR_REGION_SIZE * CCR_REGION_SIZE * CCR_REGION_SIZE)
+#define CCR_HEADER_SIZE 16
+#define CCR_INDEX_SIZE  14
+#define CCR_ENTRY_SIZE  9
+#define CCR_FLAG_UPPER  0x01
+#define CCR_RegionsCount(width, height, length) \
+	((((width) + CCR_REGION_SIZE - 1) >> CCR_REGION_SHIFT) * (((height) + CCR_REGION_SIZE - 1) >> CCR_REGION_SHIFT) * (((length) + CCR_REGION_SIZE - 1) >> CCR_REGION_SHIFT))
+
+struct CcrEntry { cc_uint32 offset, length; cc_uint8 flags; };
+
+/* Layout of the region map file that the world was last loaded from or saved to */
+static struct CcrFile {
+	cc_string path; char _pathBuffer[FILENAME_SIZE];
+	struct CcrEntry* entries;
+	int width, height, length;
+	cc_uint32 end;    /* Length of the file */
+	cc_uint32 used;   /* Bytes of the file used by the header, the current records and the current index */
+	cc_bool valid;    /* Whether the records match the blocks in the world, except for those in dirty chunks */
+	cc_bool loading;  /* Whether entries was just read by Ccr_Load */
+} ccr_file;
+
+static void Ccr_FreeFile(void) {
+	Mem_Free(ccr_file.entries);
+	ccr_file.entries = NULL;
+	ccr_file.valid   = false;
+	ccr_file.loading = false;
+}
+
+/* Calculates the coordinates of the blocks in the given region of the world */
+static void Ccr_GetBounds(int rx, int ry, int rz, int* x1, int* y1, int* z1, int* x2, int* y2, int* z2) {
+	*x1 = rx << CCR_REGION_SHIFT; *x2 = min(*x1 + CCR_REGION_SIZE, World.Width);
+	*y1 = ry << CCR_REGION_SHIFT; *y2 = min(*y1 + CCR_REGION_SIZE, World.Height);
+	*z1 = rz << CCR_REGION_SHIFT; *z2 = min(*z1 + CCR_REGION_SIZE, World.Length);
+}
+
+static void Ccr_Callback(struct NbtTag* tag) {
+	/* Blocks are stored in the region records instead */
+	if (IsTag(tag, "BlockArray") || IsTag(tag, "BlockArray2")) return;
+	Cw_Callback(tag);
+}
+
+/* Copies the blocks of a region from the record data into the given block array */
+static void Ccr_ScatterRegion(int rx, int ry, int rz, const BlockRaw* data, BlockRaw* blocks) {
+	int x1, y1, z1, x2, y2, z2;
+	int y, z, width, index;
+	Ccr_GetBounds(rx, ry, rz, &x1, &y1, &z1, &x2, &y2, &z2);
+	width = x2 - x1;
+
+	for (y = y1; y < y2; y++) {
+		for (z = z1; z < z2; z++) {
+			index = World_Pack(x1, y, z);
+			Mem_Copy(&blocks[index], data, width);
+			data += width;
+		}
+	}
+}
+
+static cc_result Ccr_ReadRegion(struct Stream* stream, struct CcrEntry* e, int rx, int ry, int rz,
+								struct InflateState* state, BlockRaw* data) {
+	struct Stream portion, compStream;
+	int x1, y1, z1, x2, y2, z2;
+	cc_uint32 count;
+	cc_result res;
+
+	Ccr_GetBounds(rx, ry, rz, &x1, &y1, &z1, &x2, &y2, &z2);
+	count = (x2 - x1) * (y2 - y1) * (z2 - z1);
+	if ((res = stream->Seek(stream, e->offset))) return res;
+
+	Stream_ReadonlyPortion(&portion, stream, e->length);
+	Inflate_MakeStream2(&compStream, state, &portion);
+	if ((res = Stream_Read(&compStream, data, count))) return res;
+	Ccr_ScatterRegion(rx, ry, rz, data, World.Blocks);
+
+#ifdef EXTENDED_BLOCKS
+	if (e->flags & CCR_FLAG_UPPER) {
+		if ((res = Stream_Read(&compStream, data, count))) return res;
+		Ccr_ScatterRegion(rx, ry, rz, data, World.Blocks2);
+	}
+#endif
+	return 0;
+}
+
+static cc_result Ccr_ReadIndex(struct Stream* stream, int* count) {
+	cc_uint8 header[CCR_HEADER_SIZE];
+	cc_uint8 index[CCR_INDEX_SIZE];
+	cc_uint8* entry;
+	cc_uint8* data;
+	struct Stream portion;
+	cc_uint32 indexOffset, indexLength;
+	int i, width, height, length;
+	cc_result res;
+
+	if ((res = Stream_Read(stream, header, CCR_HEADER_SIZE))) return res;
+	if (header[0] != 'C' || header[1] != 'C' || header[2] != 'R' || header[3] != 'G') return CCR_ERR_SIGNATURE;
+	if (Stream_GetU16_BE(&header[4]) != CCR_VERSION) return CCR_ERR_VERSION;
+	indexOffset = Stream_GetU32_BE(&header[8]);
+	indexLength = Stream_GetU32_BE(&header[12]);
+
+	if ((res = stream->Seek(stream, indexOffset)))             return res;
+	if ((res = Stream_Read(stream, index, CCR_INDEX_SIZE)))    return res;
+	width  = Stream_GetU16_BE(&index[8]);
+	height = Stream_GetU16_BE(&index[10]);
+	length = Stream_GetU16_BE(&index[12]);
+
+	if (!World_CheckVolume(width, height, length)) return ERR_NOT_SUPPORTED;
+	*count = CCR_RegionsCount(width, height, length);
+	if (indexLength != CCR_INDEX_SIZE + *count * CCR_ENTRY_SIZE) return CCR_ERR_INDEX;
+
+	ccr_file.entries = (struct CcrEntry*)Mem_TryAlloc(*count, sizeof(struct CcrEntry));
+	data = (cc_uint8*)Mem_TryAlloc(*count, CCR_ENTRY_SIZE);
+	if (!ccr_file.entries || !data) { Mem_Free(data); return ERR_OUT_OF_MEMORY; }
+
+	res = Stream_Read(stream, data, *count * CCR_ENTRY_SIZE);
+	ccr_file.used = CCR_HEADER_SIZE + indexLength + Stream_GetU32_BE(&index[4]);
+
+	for (i = 0, entry = data; i < *count; i++, entry += CCR_ENTRY_SIZE) {
+		ccr_file.entries[i].offset = Stream_GetU32_BE(&entry[0]);
+		ccr_file.entries[i].length = Stream_GetU32_BE(&entry[4]);
+		ccr_file.entries[i].flags  = entry[8];
+		ccr_file.used += ccr_file.entries[i].length;
+	}
+	Mem_Free(data);
+	if (res) return res;
+
+	/* Metadata is read first, as that resets the world's dimensions */
+	if ((res = stream->Seek(stream, Stream_GetU32_BE(&index[0])))) return res;
+	Stream_ReadonlyPortion(&portion, stream, Stream_GetU32_BE(&index[4]));
+	if ((res = Nbt_Read(&portion, Ccr_Callback))) return res;
+
+	World.Width  = width; World.Height = height; World.Length = length;
+	World.Volume = width * height * length;
+	ccr_file.width = width; ccr_file.height = height; ccr_file.length = length;
+	return stream->Length(stream, &ccr_file.end);
+}
+
+/* Imports a world from a .ccr ClassiCube region map file */
+static cc_result Ccr_Load(struct Stream* stream) {
+	struct InflateState* state;
+	BlockRaw* data;
+	int i, count, rx, ry, rz;
+	cc_bool upper = false;
+	cc_result res;
+
+	Ccr_FreeFile();
+	if ((res = Ccr_ReadIndex(stream, &count))) return res;
+
+	World.Blocks = (BlockRaw*)Mem_TryAlloc(World.Volume, 1);
+	if (!World.Blocks) return ERR_OUT_OF_MEMORY;
+
+#ifdef EXTENDED_BLOCKS
+	for (i = 0; i < count; i++) upper |= ccr_file.entries[i].flags & CCR_FLAG_UPPER;
+	if (upper) {
+		World_SetMapUpper((BlockRaw*)Mem_TryAllocCleared(World.Volume, 1));
+		if (!World.Blocks2) return ERR_OUT_OF_MEMORY;
+	}
+#endif
+
+	state = (struct InflateState*)Mem_TryAlloc(1, sizeof(struct InflateState));
+	data  = (BlockRaw*)Mem_TryAlloc(CCR_REGION_VOLUME, 1);
+	res   = ERR_OUT_OF_MEMORY;
+	i     = 0;
+
+	if (state && data) {
+		res = 0;
+		for (ry = 0; ry < (World.Height + CCR_REGION_SIZE - 1) >> CCR_REGION_SHIFT && !res; ry++)
+			for (rz = 0; rz < (World.Length + CCR_REGION_SIZE - 1) >> CCR_REGION_SHIFT && !res; rz++)
+				for (rx = 0; rx < (World.Width + CCR_REGION_SIZE - 1) >> CCR_REGION_SHIFT && !res; rx++, i++)
+		{
+			res = Ccr_ReadRegion(stream, &ccr_file.entries[i], rx, ry, rz, state, data);
+		}
+	}
+
+	Mem_Free(state);
+	Mem_Free(data);
+	ccr_file.loading = !res;
+	return res;
+}
+
+/* Called after a map has been imported, so that the next save to the same region map file can be incremental */
+static void Ccr_FinishLoad(const cc_string* path) {
+	if (!ccr_file.loading) return;
+	ccr_file.loading = false;
+	ccr_file.valid   = true;
+
+	String_InitArray(ccr_file.path, ccr_file._pathBuffer);
+	String_Copy(&ccr_file.path, path);
+	/* Blocks in the file now match the world */
+	World_ClearDirtyChunks();
+}
+
+static cc_bool Ccr_IsRegionDirty(int rx, int ry, int rz) {
+	int cx, cy, cz;
+	int x1, y1, z1, x2, y2, z2;
+	Ccr_GetBounds(rx, ry, rz, &x1, &y1, &z1, &x2, &y2, &z2);
+
+	for (cy = y1 >> CHUNK_SHIFT; cy <= (y2 - 1) >> CHUNK_SHIFT; cy++)
+		for (cz = z1 >> CHUNK_SHIFT; cz <= (z2 - 1) >> CHUNK_SHIFT; cz++)
+			for (cx = x1 >> CHUNK_SHIFT; cx <= (x2 - 1) >> CHUNK_SHIFT; cx++)
+	{
+		if (World_IsChunkDirty(cx, cy, cz)) return true;
+	}
+	return false;
+}
+
+/* Splits the blocks of the given region into their lower and upper 8 bits */
+static int Ccr_GatherRegion(int rx, int ry, int rz, BlockRaw* lower, BlockRaw* upper, cc_uint8* flags) {
+	int x1, y1, z1, x2, y2, z2;
+	int x, y, z, i = 0;
+	BlockID block;
+	Ccr_GetBounds(rx, ry, rz, &x1, &y1, &z1, &x2, &y2, &z2);
+	*flags = 0;
+
+	for (y = y1; y < y2; y++)
+		for (z = z1; z < z2; z++)
+			for (x = x1; x < x2; x++, i++)
+	{
+		block    = World_GetBlock(x, y, z);
+		lower[i] = (BlockRaw)block;
+		upper[i] = (BlockRaw)(block >> 8);
+		if (block > 0xFF) *flags = CCR_FLAG_UPPER;
+	}
+	return i;
+}
+
+static cc_result Ccr_WriteRegion(struct Stream* file, struct CcrEntry* e, int rx, int ry, int rz,
+								struct GZipState* state, BlockRaw* data, int level) {
+	struct Stream compStream;
+	cc_uint32 end;
+	cc_result res;
+	int count;
+
+	count = Ccr_GatherRegion(rx, ry, rz, data, data + CCR_REGION_VOLUME, &e->flags);
+	if ((res = file->Position(file, &e->offset))) return res;
+
+	Deflate_MakeStream(&compStream, &state->Base, file);
+	state->Base.Level = level;
+	if ((res = Stream_Write(&compStream, data, count))) return res;
+
+	if (e->flags & CCR_FLAG_UPPER) {
+		if ((res = Stream_Write(&compStream, data + CCR_REGION_VOLUME, count))) return res;
+	}
+	if ((res = compStream.Close(&compStream))) return res;
+
+	if ((res = file->Position(file, &end))) return res;
+	e->length = end - e->offset;
+	return 0;
+}
+
+static cc_result Ccr_WriteRecords(struct Stream* file, struct CcrEntry* entries, cc_bool append, int level) {
+	struct GZipState* state;
+	BlockRaw* data;
+	int i = 0, rx, ry, rz;
+	cc_result res = 0;
+
+	state = (struct GZipState*)Mem_TryAlloc(1, sizeof(struct GZipState));
+	data  = (BlockRaw*)Mem_TryAlloc(CCR_REGION_VOLUME, 2);
+	if (!state || !data) { res = ERR_OUT_OF_MEMORY; goto done; }
+
+	for (ry = 0; ry < (World.Height + CCR_REGION_SIZE - 1) >> CCR_REGION_SHIFT; ry++)
+		for (rz = 0; rz < (World.Length + CCR_REGION_SIZE - 1) >> CCR_REGION_SHIFT; rz++)
+			for (rx = 0; rx < (World.Width + CCR_REGION_SIZE - 1) >> CCR_REGION_SHIFT; rx++, i++)
+	{
+		if (append && !Ccr_IsRegionDirty(rx, ry, rz)) continue;
+		if ((res = Ccr_WriteRegion(file, &entries[i], rx, ry, rz, state, data, level))) goto done;
+	}
+
+done:
+	Mem_Free(state);
+	Mem_Free(data);
+	return res;
+}
+
+static cc_result Ccr_WriteMetadata(struct Stream* file, cc_uint32* offset, cc_uint32* length, int level) {
+	struct Stream compStream;
+	struct GZipState* state;
+	cc_uint32 end;
+	cc_result res;
+
+	state = (struct GZipState*)Mem_TryAlloc(1, sizeof(struct GZipState));
+	if (!state) return ERR_OUT_OF_MEMORY;
+	if ((res = file->Position(file, offset))) goto done;
+
+	GZip_MakeStream(&compStream, state, file);
+	state->Base.Level = level;
+	if ((res = Cw_WriteHeader(&compStream, 0)))  goto done;
+	if ((res = Cw_WriteMetadata(&compStream)))   goto done;
+	if ((res = compStream.Close(&compStream)))   goto done;
+
+	if ((res = file->Position(file, &end))) goto done;
+	*length = end - *offset;
+done:
+	Mem_Free(state);
+	return res;
+}
+
+static cc_result Ccr_WriteIndex(struct Stream* file, struct CcrEntry* entries, int count, int level) {
+	cc_uint8 header[CCR_HEADER_SIZE] = { 'C','C','R','G' };
+	cc_uint8 index[CCR_INDEX_SIZE];
+	cc_uint8* entry;
+	cc_uint8* data;
+	cc_uint32 metaOffset, metaLength, indexOffset;
+	cc_result res;
+	int i;
+
+	if ((res = Ccr_WriteMetadata(file, &metaOffset, &metaLength, level))) return res;
+	if ((res = file->Position(file, &indexOffset))) return res;
+
+	Stream_SetU32_BE(&index[0],  metaOffset);
+	Stream_SetU32_BE(&index[4],  metaLength);
+	Stream_SetU16_BE(&index[8],  World.Width);
+	Stream_SetU16_BE(&index[10], World.Height);
+	Stream_SetU16_BE(&index[12], World.Length);
+	if ((res = Stream_Write(file, index, CCR_INDEX_SIZE))) return res;
+
+	data = (cc_uint8*)Mem_TryAlloc(count, CCR_ENTRY_SIZE);
+	if (!data) return ERR_OUT_OF_MEMORY;
+	ccr_file.used = CCR_HEADER_SIZE + metaLength + CCR_INDEX_SIZE + count * CCR_ENTRY_SIZE;
+
+	for (i = 0, entry = data; i < count; i++, entry += CCR_ENTRY_SIZE) {
+		Stream_SetU32_BE(&entry[0], entries[i].offset);
+		Stream_SetU32_BE(&entry[4], entries[i].length);
+		entry[8] = entries[i].flags;
+		ccr_file.used += entries[i].length;
+	}
+
+	res = Stream_Write(file, data, count * CCR_ENTRY_SIZE);
+	Mem_Free(data);
+	if (res) return res;
+	if ((res = file->Position(file, &ccr_file.end))) return res;
+
+	/* The header is only changed to refer to the new index once everything else has been written, */
+	/*  so that if appending fails partway through, the file still has the complete previous save */
+	Stream_SetU16_BE(&header[4],  CCR_VERSION);
+	Stream_SetU16_BE(&header[6],  0);
+	Stream_SetU32_BE(&header[8],  indexOffset);
+	Stream_SetU32_BE(&header[12], CCR_INDEX_SIZE + count * CCR_ENTRY_SIZE);
+	if ((res = file->Seek(file, 0))) return res;
+	return Stream_Write(file, header, CCR_HEADER_SIZE);
+}
+
+/* Whether only the changed regions need to be appended to the file */
+static cc_bool Ccr_CanAppend(const cc_string* path) {
+	return ccr_file.valid && String_Equals(&ccr_file.path, path)
+		&& ccr_file.width  == World.Width && ccr_file.height == World.Height && ccr_file.length == World.Length
+		&& ccr_file.end - ccr_file.used <= ccr_file.used;
+}
+
+static cc_result Ccr_OpenFile(struct Stream* file, const cc_string* path, cc_bool* append) {
+	static const cc_uint8 header[CCR_HEADER_SIZE] = { 0 };
+	cc_uint32 length;
+	cc_result res;
+
+	if (*append) {
+		res = Stream_AppendFile(file, path);
+		/* Make sure the file hasn't been changed by something else since */
+		if (!res && !file->Length(file, &length) && length == ccr_file.end) return 0;
+		if (!res) file->Close(file);
+	}
+	*append = false;
+
+	if ((res = Stream_CreateFile(file, path))) return res;
+	return Stream_Write(file, header, CCR_HEADER_SIZE);
+}
+
+cc_result Ccr_Save(const cc_string* path, int level) {
+	int count = CCR_RegionsCount(World.Width, World.Height, World.Length);
+	cc_bool append = Ccr_CanAppend(path);
+	struct Stream file;
+	cc_result res;
+
+	if (!append) {
+		Ccr_FreeFile();
+		ccr_file.entries = (struct CcrEntry*)Mem_TryAllocCleared(count, sizeof(struct CcrEntry));
+		if (!ccr_file.entries) return ERR_OUT_OF_MEMORY;
+	}
+	/* entries will no longer match the file if saving fails partway through */
+	ccr_file.valid = false;
+
+	if ((res = Ccr_OpenFile(&file, path, &append))) return res;
+	res = Ccr_WriteRecords(&file, ccr_file.entries, append, level);
+	if (!res) res = Ccr_WriteIndex(&file, ccr_file.entries, count, level);
+
+	if (res) { file.Close(&file); return res; }
+	if ((res = file.Close(&file))) return res;
+
+	String_InitArray(ccr_file.path, ccr_file._pathBuffer);
+	String_Copy(&ccr_file.path, path);
+	ccr_file.width  = World.Width;
+	ccr_file.height = World.Height;
+	ccr_file.length = World.Length;
+	ccr_file.valid  = true;
+
+	World_ClearDirtyChunks();
+	return 0;
+}
+
+
 /*########################################################################################################################*
 *-------------------------------------------------------Formats component-------------------------------------------------*
 *#########################################################################################################################*/
 static struct MapImporter cw_imp    = { ".cw",      Cw_Load };
+static struct MapImporter ccr_imp   = { ".ccr",     Ccr_Load };
 static struct MapImporter dat_imp   = { ".dat",     Dat_Load };
 static struct MapImporter lvl_imp   = { ".lvl",     Lvl_Load };
 static struct MapImporter mine_imp  = { ".mine",    Dat_Load };
@@ -1868,6 +2541,7 @@ static struct MapImporter mclvl_imp = { ".mclevel", MCLevel_Load };
 
 static void OnInit(void) {
 	MapImporter_Register(&cw_imp);
+	MapImporter_Register(&ccr_imp);
 	MapImporter_Register(&dat_imp);
 	MapImporter_Register(&lvl_imp);
 	MapImporter_Register(&mine_imp);
@@ -1877,6 +2551,8 @@ static void OnInit(void) {
 
 static void OnFree(void) {
 	imp_head = NULL;
+	Cw_FreeBackgroundSave();
+	Ccr_FreeFile();
 }
 #else
 /* No point including map format code when can't save/load maps anyways */
@@ -1884,7 +2560,12 @@ struct MapImporter* MapImporter_Find(const cc_string* path) { return NULL; }
 cc_result Map_LoadFrom(const cc_string* path) { return ERR_NOT_SUPPORTED; }
 
 cc_result Cw_Save(struct Stream* stream)  { return ERR_NOT_SUPPORTED; }
+void Cw_FinishBackgroundSave(void) { }
+cc_bool Cw_SaveInBackground(struct Stream* file, const cc_string* path, int level, int threads, Cw_SaveCallback callback) {
+	return false;
+}
 cc_result Dat_Save(struct Stream* stream) { return ERR_NOT_SUPPORTED; }
+cc_result Ccr_Save(const cc_string* path, int level) { return ERR_NOT_SUPPORTED; }
 cc_result Schematic_Save(struct Stream* stream) { return ERR_NOT_SUPPORTED; }
 
 static void OnInit(void) { }
@@ -32,12 +32,25 @@ CC_API cc_result Map_LoadFrom(const cc_string* path);
 /* Exports a world to a .cw ClassicWorld map file. */
 /* Compatible with ClassiCube/ClassicalSharp */
 cc_result Cw_Save(struct Stream* stream);
+/* Invoked on the main thread once a background save has finished */
+typedef void (*Cw_SaveCallback)(const cc_string* path, cc_result res);
+/* Starts exporting the world to a .cw ClassicWorld map file on a background thread. */
+/* Blocks are read from a snapshot of the world, so the world can keep changing while saving. */
+/* Returns false if saving in the background isn't possible, in which case use Cw_Save instead. */
+/* NOTE: If true is returned, the file stream is closed once saving has finished */
+cc_bool Cw_SaveInBackground(struct Stream* file, const cc_string* path, int level, int threads, Cw_SaveCallback callback);
+/* Waits for the current background save (if any) to finish, then invokes its callback. */
+void Cw_FinishBackgroundSave(void);
 /* Exports a world to a .schematic Schematic map file */
 /* Used by MCEdit and other tools */
 cc_result Schematic_Save(struct Stream* stream);
 /* Exports a world to a .dat Classic map file */
 /* Used by MineCraft Classic */
 cc_result Dat_Save(struct Stream* stream);
+/* Exports a world to a .ccr ClassiCube region map file at the given path. */
+/* If the world was last loaded from or saved to that file, only regions containing */
+/*  chunks that have changed since then are written, by appending them to the file */
+cc_result Ccr_Save(const cc_string* path, int level);
 
 CC_END_HEADER
 #endif
@@ -41,6 +41,8 @@
 #include "SystemFonts.h"
 #include "Formats.h"
 #include "EntityRenderers.h"
+#include "BlockPhysics.h"
+#include "Errors.h"
 
 struct _GameData Game;
 static cc_uint64 frameStart;
@@ -93,6 +95,7 @@ int ScheduledTask_Add(double interval, ScheduledTaskCallback callback) {
 	task.accumulator = 0.0;
 	task.interval    = interval;
 	task.Callback    = callback;
+	HandlerCost_SetOwner((void*)callback, true);
 
 	if (tasksCount == tasksCapacity) {
 		Utils_Resize((void**)&tasks, &tasksCapacity,
@@ -154,7 +157,31 @@ void Game_CycleViewDistance(void) {
 	}
 }
 
+#ifdef CC_BUILD_ANDROID
+/* How thermally throttled the device is (or is about to be), from 0 (not at all) to 3 (severely) */
+static int thermalLevel;
+
+/* Limits FPS and view distance while the device is hot, as otherwise the device */
+/*  just throttles the CPU/GPU later on and causes much worse stuttering */
+static void Thermal_Tick(struct ScheduledTask* task) {
+	int level = Platform_GetThermalLevel();
+	if (level == thermalLevel) return;
+
+	thermalLevel = level;
+	Game_SetFpsLimit(Game_FpsLimit);
+	Game_SetViewDistance(Game_UserViewDistance);
+}
+#define Thermal_MinFrameTime() (thermalLevel >= 2 ? 1000/30.0f : (thermalLevel == 1 ? 1000/60.0f : 0))
+#define Thermal_MaxViewDistance() (thermalLevel >= 3 ? 64 : Game_MaxViewDistance)
+#endif
+
 cc_bool Game_ReduceVRAM(void) {
+	/* Unload distant chunks first, so that view distance can stay as high as memory allows */
+	if (MapRenderer_ReduceVRAM()) {
+		Chat_AddRaw("&cOut of VRAM! Unloading distant chunks..");
+		return true;
+	}
+
 	if (Game_UserViewDistance <= 16) return false;
 	Game_UserViewDistance /= 2;
 	Game_UserViewDistance = max(16, Game_UserViewDistance);
@@ -168,6 +195,9 @@ cc_bool Game_ReduceVRAM(void) {
 
 void Game_SetViewDistance(int distance) {
 	distance = min(distance, Game_MaxViewDistance);
+#ifdef CC_BUILD_ANDROID
+	distance = min(distance, Thermal_MaxViewDistance());
+#endif
 	if (distance == Game_ViewDistance) return;
 	Game_ViewDistance = distance;
 
@@ -192,19 +222,90 @@ void Game_Reset(void) {
 	World_NewMap();
 
 	for (comp = comps_head; comp; comp = comp->next) {
+		HandlerCost_Owner = comp;
 		if (comp->Reset) comp->Reset();
 	}
+	HandlerCost_Owner = NULL;
+}
+
+/* Max number of block changes that are raised together in WorldEvents.BlocksChanged */
+#define GAME_MAX_PENDING_CHANGES 256
+static struct BlockChange pendingChanges[GAME_MAX_PENDING_CHANGES];
+static int pendingChangesCount;
+
+static void Game_FlushBlockChanges(void) {
+	/* Copied, so that callbacks changing blocks don't overwrite the changes being raised */
+	struct BlockChange changes[GAME_MAX_PENDING_CHANGES];
+	int count = pendingChangesCount;
+	if (!count) return;
+
+	Mem_Copy(changes, pendingChanges, count * sizeof(struct BlockChange));
+	pendingChangesCount = 0;
+	Event_RaiseBlocks(&WorldEvents.BlocksChanged, changes, count);
+}
+
+static void Game_QueueBlockChange(int x, int y, int z, BlockID old, BlockID block) {
+	struct BlockChange* change;
+	if (pendingChangesCount == GAME_MAX_PENDING_CHANGES) Game_FlushBlockChanges();
+
+	change = &pendingChanges[pendingChangesCount++];
+	change->coords.x = x; change->coords.y = y; change->coords.z = z;
+	change->oldBlock = old;
+	change->block    = block;
+}
+
+/* Number of Game_BeginBlockEdit calls that have not been ended yet */
+static int edit_depth;
+/* Whether any blocks have been changed in the current block edit */
+static cc_bool edit_changed;
+/* Bounds of the region containing all blocks changed in the current block edit */
+static IVec3 edit_min, edit_max;
+
+void Game_BeginBlockEdit(void) {
+	if (edit_depth++) return;
+	edit_changed = false;
+	Lighting_BeginBatch();
+}
+
+void Game_EndBlockEdit(void) {
+	if (--edit_depth) return;
+	Lighting_EndBatch();
+	if (!edit_changed) return;
+
+	MapRenderer_OnRegionChanged(edit_min.x, edit_min.y, edit_min.z,
+								edit_max.x, edit_max.y, edit_max.z);
+}
+
+static void Game_EditBlock(int x, int y, int z) {
+	if (!edit_changed) {
+		edit_changed = true;
+		edit_min.x = x; edit_min.y = y; edit_min.z = z;
+		edit_max   = edit_min;
+		return;
+	}
+
+	edit_min.x = min(edit_min.x, x); edit_max.x = max(edit_max.x, x);
+	edit_min.y = min(edit_min.y, y); edit_max.y = max(edit_max.y, y);
+	edit_min.z = min(edit_min.z, z); edit_max.z = max(edit_max.z, z);
 }
 
 void Game_UpdateBlock(int x, int y, int z, BlockID block) {
 	BlockID old = World_GetBlock(x, y, z);
 	World_SetBlock(x, y, z, block);
 
-	if (Weather_Heightmap) {
-		EnvRenderer_OnBlockChanged(x, y, z, old, block);
-	}
+	Physics_OnBlockUpdated(x, y, z, old, block);
 	Lighting.OnBlockChanged(x, y, z, old, block);
-	MapRenderer_OnBlockChanged(x, y, z, block);
+
+	if (!edit_depth) {
+		MapRenderer_OnBlockChanged(x, y, z, old, block);
+	} else if (old != block) {
+		Game_EditBlock(x, y, z);
+	}
+
+	if (old == block) return;
+	if (Event_BlocksInterested(&WorldEvents.BlocksChanged, old) || Event_BlocksInterested(&WorldEvents.BlocksChanged, block)) {
+		Game_QueueBlockChange(x, y, z, old, block);
+	}
 }
 
 void Game_ChangeBlock(int x, int y, int z, BlockID block) {
@@ -296,16 +397,23 @@ static void Game_OnResize(void* obj) {
 
 static void HandleOnNewMap(void* obj) {
 	struct IGameComponent* comp;
+	/* Changes were for the previous map */
+	pendingChangesCount = 0;
+
 	for (comp = comps_head; comp; comp = comp->next) {
+		HandlerCost_Owner = comp;
 		if (comp->OnNewMap) comp->OnNewMap();
 	}
+	HandlerCost_Owner = NULL;
 }
 
 static void HandleOnNewMapLoaded(void* obj) {
 	struct IGameComponent* comp;
 	for (comp = comps_head; comp; comp = comp->next) {
+		HandlerCost_Owner = comp;
 		if (comp->OnNewMapLoaded) comp->OnNewMapLoaded();
 	}
+	HandlerCost_Owner = NULL;
 }
 
 static void HandleInactiveChanged(void* obj) {
@@ -363,6 +471,21 @@ static void LoadOptions(void) {
 }
 
 #ifdef CC_BUILD_PLUGINS
+/* Filenames of loaded plugins, so that their components can be identified */
+#define GAME_MAX_PLUGIN_NAMES 32
+static struct IGameComponent* pluginComps[GAME_MAX_PLUGIN_NAMES];
+static char pluginNames[GAME_MAX_PLUGIN_NAMES][STRING_SIZE];
+static int pluginsCount;
+
+static void AddPluginName(const cc_string* path, struct IGameComponent* comp) {
+	cc_string name = *path;
+	if (pluginsCount == GAME_MAX_PLUGIN_NAMES) return;
+
+	Utils_UNSAFE_GetFilename(&name);
+	String_CopyToRaw(pluginNames[pluginsCount], STRING_SIZE - 1, &name);
+	pluginComps[pluginsCount++] = comp;
+}
+
 static void LoadPlugin(const cc_string* path, void* obj, int isDirectory) {
 	void* lib;
 	void* verSym;  /* EXPORT int Plugin_ApiVersion = GAME_API_VER; */
@@ -393,6 +516,7 @@ static void LoadPlugin(const cc_string* path, void* obj, int isDirectory) {
 		return;
 	}
 
+	AddPluginName(path, (struct IGameComponent*)compSym);
 	Game_AddComponent((struct IGameComponent*)compSym);
 }
 
@@ -408,12 +532,295 @@ static void LoadPlugins(void) {
 static void LoadPlugins(void) { }
 #endif
 
+
+/*########################################################################################################################*
+*---------------------------------------------------------Startup---------------------------------------------------------*
+*#########################################################################################################################*/
+#define GAME_MAX_STARTUP_STEPS 64
+static struct StartupStep startupSteps[GAME_MAX_STARTUP_STEPS];
+static int startupStepsCount;
+static cc_uint64 startupBeg, stepBeg;
+static cc_bool firstFrameRendered;
+
+#define GAME_MAX_DEFERRED_TASKS 16
+static struct DeferredTask { Game_DeferredTask task; const char* name; } deferredTasks[GAME_MAX_DEFERRED_TASKS];
+static int deferredTasksCount;
+
+static void Startup_BeginStep(void) { stepBeg = Stopwatch_Measure(); }
+
+static void Startup_EndStep(const char* name) {
+	cc_uint64 now = Stopwatch_Measure();
+	if (startupStepsCount == GAME_MAX_STARTUP_STEPS) return;
+
+	startupSteps[startupStepsCount].name   = name;
+	startupSteps[startupStepsCount].micros = (cc_uint32)Stopwatch_ElapsedMicroseconds(stepBeg, now);
+	startupStepsCount++;
+}
+
+int Game_GetStartupSteps(const struct StartupStep** steps) {
+	*steps = startupSteps;
+	return startupStepsCount;
+}
+
+void Game_DeferTask(Game_DeferredTask task, const char* name) {
+	/* No room left, so just run it now instead */
+	if (deferredTasksCount == GAME_MAX_DEFERRED_TASKS) { task(); return; }
+
+	deferredTasks[deferredTasksCount].task = task;
+	deferredTasks[deferredTasksCount].name = name;
+	deferredTasksCount++;
+}
+
+static void Startup_RunDeferredTask(void) {
+	struct DeferredTask deferred = deferredTasks[0];
+	int i;
+
+	/* Removed before running, in case the task defers another task */
+	for (i = 0; i < deferredTasksCount - 1; i++) {
+		deferredTasks[i] = deferredTasks[i + 1];
+	}
+	deferredTasksCount--;
+
+	Startup_BeginStep();
+	deferred.task();
+	Startup_EndStep(deferred.name);
+}
+
+static void Startup_EndFrame(void) {
+	if (!firstFrameRendered) {
+		firstFrameRendered = true;
+		stepBeg = startupBeg;
+		Startup_EndStep("Time to first frame");
+		return;
+	}
+	if (deferredTasksCount) Startup_RunDeferredTask();
+}
+
+static const struct CoreComponent {
+	struct IGameComponent* comp; const char* name;
+} coreComponents[] = {
+	{ &World_Component,                "World"               },
+	{ &Textures_Component,             "Textures"            },
+	{ &Input_Component,                "Input"               },
+	{ &InputHandler_Component,         "InputHandler"        },
+	{ &Camera_Component,               "Camera"              },
+	{ &Gfx_Component,                  "Graphics"            },
+	{ &Blocks_Component,               "Blocks"              },
+	{ &Drawer2D_Component,             "Drawer2D"            },
+	{ &SystemFonts_Component,          "SystemFonts"         },
+
+	{ &Chat_Component,                 "Chat"                },
+	{ &Commands_Component,             "Commands"            },
+	{ &Particles_Component,            "Particles"           },
+	{ &TabList_Component,              "TabList"             },
+	{ &Models_Component,               "Models"              },
+	{ &Entities_Component,             "Entities"            },
+	{ &Http_Component,                 "Http"                },
+	{ &Lighting_Component,             "Lighting"            },
+
+	{ &Animations_Component,           "Animations"          },
+	{ &Inventory_Component,            "Inventory"           },
+	{ &Builder_Component,              "Builder"             },
+	{ &MapRenderer_Component,          "MapRenderer"         },
+	{ &EnvRenderer_Component,          "EnvRenderer"         },
+	{ &Server_Component,               "Server"              },
+	{ &Protocol_Component,             "Protocol"            },
+
+	{ &Gui_Component,                  "Gui"                 },
+	{ &Selections_Component,           "Selections"          },
+	{ &HeldBlockRenderer_Component,    "HeldBlockRenderer"   },
+	/* Gfx_SetDepthWrite(true) */
+	{ &SelOutlineRenderer_Component,   "SelOutlineRenderer"  },
+	{ &Audio_Component,                "Audio"               },
+	{ &AxisLinesRenderer_Component,    "AxisLinesRenderer"   },
+	{ &Formats_Component,              "Formats"             },
+	{ &EntityRenderers_Component,      "EntityRenderers"     },
+};
+
+const char* Game_ComponentName(struct IGameComponent* comp) {
+	int i;
+	for (i = 0; i < Array_Elems(coreComponents); i++) {
+		if (coreComponents[i].comp == comp) return coreComponents[i].name;
+	}
+#ifdef CC_BUILD_PLUGINS
+	for (i = 0; i < pluginsCount; i++) {
+		if (pluginComps[i] == comp) return pluginNames[i];
+	}
+#endif
+	return "Plugin";
+}
+
+
+/*########################################################################################################################*
+*-----------------------------------------------------Scratch memory------------------------------------------------------*
+*#########################################################################################################################*/
+#define SCRATCH_ALIGN 16
+#ifdef CC_BUILD_LOWMEM
+#define SCRATCH_MAX_SIZE (256  * 1024)
+#else
+#define SCRATCH_MAX_SIZE (4096 * 1024)
+#endif
+static cc_uint8* scratch_mem;
+/* scratch_wanted is the most scratch memory that was needed at once in the current frame */
+static cc_uint32 scratch_size, scratch_used, scratch_last, scratch_wanted;
+
+void* Game_AllocScratch(cc_uint32 numElems, cc_uint32 elemsSize) {
+	cc_uint64 size = ((cc_uint64)numElems * elemsSize + (SCRATCH_ALIGN - 1)) & ~(cc_uint64)(SCRATCH_ALIGN - 1);
+	cc_uint8* ptr;
+
+	if (size > SCRATCH_MAX_SIZE) return NULL;
+	if (scratch_used + size > scratch_size) {
+		scratch_wanted = max(scratch_wanted, scratch_used + (cc_uint32)size);
+		return NULL;
+	}
+
+	ptr = scratch_mem + scratch_used;
+	scratch_last  = scratch_used;
+	scratch_used += (cc_uint32)size;
+	scratch_wanted = max(scratch_wanted, scratch_used);
+	return ptr;
+}
+
+cc_bool Game_FreeScratch(void* ptr) {
+	cc_uint8* mem = (cc_uint8*)ptr;
+	if (!scratch_mem || mem < scratch_mem || mem >= scratch_mem + scratch_size) return false;
+
+	/* Only the most recent allocation can be reused straight away, */
+	/*  the rest of the memory is reused once the next frame starts */
+	if (mem == scratch_mem + scratch_last && scratch_last < scratch_used) {
+		scratch_used = scratch_last;
+	}
+	return true;
+}
+
+static void Game_ResetScratch(void) {
+	cc_uint32 size = scratch_wanted;
+	scratch_used   = 0;
+	scratch_last   = 0;
+	scratch_wanted = 0;
+	if (size <= scratch_size) return;
+
+	/* Grow the buffer so that everything needed in the last frame fits next time */
+	size = min(Math_NextPowOf2(size), SCRATCH_MAX_SIZE);
+	Mem_Free(scratch_mem);
+	scratch_mem  = (cc_uint8*)Mem_TryAlloc(size, 1);
+	scratch_size = scratch_mem ? size : 0;
+}
+
+static void Game_FreeScratchMem(void) {
+	Mem_Free(scratch_mem);
+	scratch_mem  = NULL;
+	scratch_size = 0;
+	scratch_used = 0;
+}
+
+
 static void Game_PendingClose(void* obj) { gameRunning = false; }
+static void FileOps_Tick(struct ScheduledTask* task) { Stream_PollFileOps(); }
+static void BitmapPool_Tick(struct ScheduledTask* task) { BitmapPool_Trim(); }
+
+#ifdef CC_GFX_SCALED_SCENE
+/*########################################################################################################################*
+*---------------------------------------------------Dynamic resolution---------------------------------------------------*
+*#########################################################################################################################*/
+/* Frame time in milliseconds that the 3D scene is scaled to fit in, 0 if dynamic resolution is disabled */
+static float dynRes_targetMS;
+static float dynRes_scale = 1.0f;
+static float dynRes_totalMS;
+static int dynRes_frames;
+static cc_bool dynRes_gpuTimed, dynRes_scaled;
+
+#define DYNRES_MIN_SCALE 0.5f
+#define DYNRES_SCALE_STEP 0.05f
+/* Number of frames that frame times are averaged over, before changing the scale */
+#define DYNRES_SAMPLE_FRAMES 30
+
+static void DynRes_Init(void) {
+	int fps = Options_GetInt(OPT_DYNAMIC_RES_FPS, 0, 1000, 0);
+	dynRes_targetMS = fps ? 1000.0f / fps : 0.0f;
+}
+
+static void DynRes_Sample(float frameMS, cc_bool gpuTimed) {
+	float avgMS;
+	dynRes_totalMS += frameMS; 
+	dynRes_frames++;
+	if (dynRes_frames < DYNRES_SAMPLE_FRAMES) return;
+
+	avgMS = dynRes_totalMS / dynRes_frames;
+	dynRes_totalMS = 0;
+	dynRes_frames  = 0;
+
+	/* GPU time excludes waiting for VSync, so headroom can be left below the target */
+	/* CPU frame time only ever goes down to the target with VSync, so only back off when clearly above it */
+	if (gpuTimed ? avgMS > dynRes_targetMS * 0.9f : avgMS > dynRes_targetMS * 1.1f) {
+		dynRes_scale = max(DYNRES_MIN_SCALE, dynRes_scale - DYNRES_SCALE_STEP);
+	} else if (gpuTimed ? avgMS < dynRes_targetMS * 0.7f : avgMS < dynRes_targetMS * 1.05f) {
+		dynRes_scale = min(1.0f, dynRes_scale + DYNRES_SCALE_STEP);
+	}
+}
+
+static void DynRes_BeginFrame(float delta) {
+	float times[2];
+	if (!dynRes_targetMS) return;
+
+	/* Timestamps are shared with the frame profiler, so fall back to CPU frame time while it is active */
+	if (Gfx.SupportsTimestamps && !FrameProfiler_Enabled) {
+		if (dynRes_gpuTimed && Gfx_ReadTimestamps(times, 2) == 2) DynRes_Sample(times[1] - times[0], true);
+
+		dynRes_gpuTimed = true;
+		Gfx_BeginTimestamps();
+		Gfx_RecordTimestamp(0);
+	} else {
+		dynRes_gpuTimed = false;
+		DynRes_Sample(delta * 1000.0f, false);
+	}
+}
+
+static void DynRes_EndFrame(void) {
+	if (!dynRes_targetMS || !dynRes_gpuTimed) return;
+	Gfx_RecordTimestamp(1);
+	Gfx_EndTimestamps();
+}
+
+static void DynRes_BeginScene(void) {
+	int width, height;
+	dynRes_scaled = dynRes_targetMS && dynRes_scale < 1.0f && Game_NumStates == 1;
+	if (!dynRes_scaled) return;
+
+	width  = max(1, (int)(Game.Width  * dynRes_scale));
+	height = max(1, (int)(Game.Height * dynRes_scale));
+	Gfx_BeginScaledScene(width, height);
+}
+
+/* Stretches the scaled down 3D scene back over the whole window */
+static void DynRes_EndScene(void) {
+	struct Texture tex;
+	if (!dynRes_scaled) return;
+
+	dynRes_scaled = false;
+	Gfx_EndScaledScene(&tex);
+	Texture_Render(&tex);
+}
+#else
+#define DynRes_Init()
+#define DynRes_BeginFrame(delta)
+#define DynRes_EndFrame()
+#define DynRes_BeginScene()
+#define DynRes_EndScene()
+#endif
+
 static void Game_Load(void) {
 	struct IGameComponent* comp;
+	int i;
+	startupBeg = Stopwatch_Measure();
 	Game_UpdateDimensions();
 	Game_SetFpsLimit(Options_GetEnum(OPT_FPS_LIMIT, 0, FpsLimit_Names, FPS_LIMIT_COUNT));
+	DynRes_Init();
+	BitmapPool_Init();
+
+	Startup_BeginStep();
 	Gfx_Create();
+	Startup_EndStep("Creating graphics context");
 	
 	Logger_WarnFunc = Game_WarnFunc;
 	LoadOptions();
@@ -426,55 +833,39 @@ static void Game_Load(void) {
 	Event_Register_(&WindowEvents.Closing,         NULL, Game_PendingClose);
 	Event_Register_(&WindowEvents.InactiveChanged, NULL, HandleInactiveChanged);
 
-	Game_AddComponent(&World_Component);
-	Game_AddComponent(&Textures_Component);
-	Game_AddComponent(&Input_Component);
-	Game_AddComponent(&InputHandler_Component);
-	Game_AddComponent(&Camera_Component);
-	Game_AddComponent(&Gfx_Component);
-	Game_AddComponent(&Blocks_Component);
-	Game_AddComponent(&Drawer2D_Component);
-	Game_AddComponent(&SystemFonts_Component);
-
-	Game_AddComponent(&Chat_Component);
-	Game_AddComponent(&Commands_Component);
-	Game_AddComponent(&Particles_Component);
-	Game_AddComponent(&TabList_Component);
-	Game_AddComponent(&Models_Component);
-	Game_AddComponent(&Entities_Component);
-	Game_AddComponent(&Http_Component);
-	Game_AddComponent(&Lighting_Component);
-
-	Game_AddComponent(&Animations_Component);
-	Game_AddComponent(&Inventory_Component);
-	Game_AddComponent(&Builder_Component);
-	Game_AddComponent(&MapRenderer_Component);
-	Game_AddComponent(&EnvRenderer_Component);
-	Game_AddComponent(&Server_Component);
-	Game_AddComponent(&Protocol_Component);
-
-	Game_AddComponent(&Gui_Component);
-	Game_AddComponent(&Selections_Component);
-	Game_AddComponent(&HeldBlockRenderer_Component);
-	/* Gfx_SetDepthWrite(true) */
-	Game_AddComponent(&SelOutlineRenderer_Component);
-	Game_AddComponent(&Audio_Component);
-	Game_AddComponent(&AxisLinesRenderer_Component);
-	Game_AddComponent(&Formats_Component);
-	Game_AddComponent(&EntityRenderers_Component);
+	for (i = 0; i < Array_Elems(coreComponents); i++) {
+		Game_AddComponent(coreComponents[i].comp);
+	}
 
+	Startup_BeginStep();
 	LoadPlugins();
+	Startup_EndStep("Loading plugins");
+
 	for (comp = comps_head; comp; comp = comp->next) {
-		if (comp->Init) comp->Init();
+		if (!comp->Init) continue;
+
+		Startup_BeginStep();
+		HandlerCost_Owner = comp;
+		comp->Init();
+		Startup_EndStep(Game_ComponentName(comp));
 	}
+	HandlerCost_Owner = NULL;
 
+	Startup_BeginStep();
 	TexturePack_ExtractCurrent(true);
+	Startup_EndStep("Extracting texture pack");
 	if (TexturePack_DefaultMissing) {
 		Window_ShowDialog("Missing file",
 			"Both default.zip and classicube.zip are missing,\n try downloading resources first.\n\nClassiCube will still run, but without any textures.");
 	}
 
 	entTaskI = ScheduledTask_Add(GAME_DEF_TICKS, Entities_Tick);
+	ScheduledTask_Add(0.1, FileOps_Tick);
+	ScheduledTask_Add(10.0, BitmapPool_Tick);
+#ifdef CC_BUILD_ANDROID
+	/* NOTE: Android only updates thermal headroom forecasts at most once per second */
+	ScheduledTask_Add(5.0, Thermal_Tick);
+#endif
 	Gfx_WarnIfNecessary();
 
 	if (Gfx.Limitations & GFX_LIMIT_VERTEX_ONLY_FOG)
@@ -495,6 +886,9 @@ void Game_SetFpsLimit(int method) {
 	case FPS_LIMIT_60:  minFrameTime = 1000/60.0f;  break;
 	case FPS_LIMIT_30:  minFrameTime = 1000/30.0f;  break;
 	}
+#ifdef CC_BUILD_ANDROID
+	minFrameTime = max(minFrameTime, Thermal_MinFrameTime());
+#endif
 	Gfx_SetVSync(method == FPS_LIMIT_VSYNC);
 	Game_SetMinFrameTime(minFrameTime);
 }
@@ -511,6 +905,808 @@ void Game_SetMinFrameTime(float frameTimeMS) {
 }
 #endif
 
+
+/*########################################################################################################################*
+*-------------------------------------------------------Frame profiler----------------------------------------------------*
+*#########################################################################################################################*/
+const char* const FramePass_Names[FRAMEPASS_COUNT] = {
+	"Entities", "Particles", "Sky", "Map", "Shadows", "Translucent", "Selections", "UI"
+};
+const char FramePass_Colors[FRAMEPASS_COUNT] = { 'c', '6', 'b', 'a', '8', '9', 'd', 'f' };
+
+struct FrameProfile FrameProfiler_History[FRAMEPROFILER_HISTORY];
+int FrameProfiler_Next;
+cc_bool FrameProfiler_Enabled, FrameProfiler_ShowGraph;
+
+/* Time at the start of the frame, then at the end of each pass */
+static cc_uint64 prof_marks[FRAMEPASS_COUNT + 1];
+static int prof_nextMark;
+
+void FrameProfiler_SetEnabled(cc_bool enabled) {
+	FrameProfiler_Enabled   = enabled;
+	FrameProfiler_ShowGraph = enabled;
+	FrameProfiler_Next      = 0;
+	Mem_Set(FrameProfiler_History, 0, sizeof(FrameProfiler_History));
+}
+
+/* Marks the end of the given pass, and of any earlier passes that weren't marked (e.g. 3D passes on the main menu) */
+/* NOTE: Later marks of an already marked pass are ignored (e.g. for the other views in splitscreen) */
+static void FrameProfiler_Mark(int pass) {
+	cc_uint64 now;
+	if (!FrameProfiler_Enabled || prof_nextMark > pass + 1) return;
+	now = Stopwatch_Measure();
+
+	for (; prof_nextMark <= pass + 1; prof_nextMark++) 
+	{
+		prof_marks[prof_nextMark] = now;
+		Gfx_RecordTimestamp(prof_nextMark);
+	}
+}
+
+static void FrameProfiler_Begin(void) {
+	struct FrameProfile* profile;
+	float times[FRAMEPASS_COUNT + 1];
+	int i, count;
+	if (!FrameProfiler_Enabled) return;
+
+	profile = &FrameProfiler_History[FrameProfiler_Next];
+	Mem_Set(profile->gpuMS, 0, sizeof(profile->gpuMS));
+	count   = Gfx_ReadTimestamps(times, FRAMEPASS_COUNT + 1);
+
+	for (i = 0; i < count - 1; i++) 
+	{
+		profile->gpuMS[i] = times[i + 1] - times[i];
+	}
+
+	Gfx_BeginTimestamps();
+	Gfx_StateCounts.applied = 0;
+	Gfx_StateCounts.skipped = 0;
+	Gfx_StateCounts.draws   = 0;
+	prof_nextMark = 0;
+	FrameProfiler_Mark(-1);
+}
+
+static void FrameProfiler_End(void) {
+	struct FrameProfile* profile;
+	int i;
+	if (!FrameProfiler_Enabled) return;
+
+	FrameProfiler_Mark(FRAMEPASS_COUNT - 1);
+	Gfx_EndTimestamps();
+	profile = &FrameProfiler_History[FrameProfiler_Next];
+
+	for (i = 0; i < FRAMEPASS_COUNT; i++) 
+	{
+		profile->cpuMS[i] = (int)Stopwatch_ElapsedMicroseconds(prof_marks[i], prof_marks[i + 1]) / 1000.0f;
+	}
+	profile->statesApplied = Gfx_StateCounts.applied;
+	profile->statesSkipped = Gfx_StateCounts.skipped;
+	profile->drawCalls     = Gfx_StateCounts.draws;
+	FrameProfiler_Next = (FrameProfiler_Next + 1) % FRAMEPROFILER_HISTORY;
+}
+
+/* Height in pixels of 1 millisecond in the graph */
+#define PROFGRAPH_SCALE  4
+#define PROFGRAPH_HEIGHT (PROFGRAPH_SCALE * 34)
+
+static void FrameProfiler_DrawBars(int x, int y, cc_bool gpu) {
+	struct FrameProfile* profile;
+	PackedCol cols[FRAMEPASS_COUNT];
+	BitmapCol col;
+	int i, pass, height, top;
+	float ms;
+
+	for (pass = 0; pass < FRAMEPASS_COUNT; pass++) 
+	{
+		col = Drawer2D_GetColor(FramePass_Colors[pass]);
+		cols[pass] = PackedCol_Make(BitmapCol_R(col), BitmapCol_G(col), BitmapCol_B(col), 255);
+	}
+
+	Gfx_Draw2DFlat(x, y, FRAMEPROFILER_HISTORY * 2, PROFGRAPH_HEIGHT, PackedCol_Make(0, 0, 0, 160));
+	/* Lines at 60 and 30 FPS frame times */
+	Gfx_Draw2DFlat(x, y + PROFGRAPH_HEIGHT - (int)(16.7f * PROFGRAPH_SCALE), 
+					FRAMEPROFILER_HISTORY * 2, 1, PackedCol_Make(255, 255, 255, 128));
+	Gfx_Draw2DFlat(x, y + PROFGRAPH_HEIGHT - (int)(33.3f * PROFGRAPH_SCALE), 
+					FRAMEPROFILER_HISTORY * 2, 1, PackedCol_Make(255, 255, 255, 128));
+
+	/* Oldest frame is drawn on the left */
+	for (i = 0; i < FRAMEPROFILER_HISTORY; i++) 
+	{
+		profile = &FrameProfiler_History[(FrameProfiler_Next + i) % FRAMEPROFILER_HISTORY];
+		top     = y + PROFGRAPH_HEIGHT;
+
+		for (pass = 0; pass < FRAMEPASS_COUNT; pass++) 
+		{
+			ms     = gpu ? profile->gpuMS[pass] : profile->cpuMS[pass];
+			height = min((int)(ms * PROFGRAPH_SCALE + 0.5f), top - y);
+			if (height <= 0) continue;
+
+			top -= height;
+			Gfx_Draw2DFlat(x + i * 2, top, 2, height, cols[pass]);
+		}
+	}
+}
+
+/* Draws stacked bar graphs of CPU (and GPU if supported) pass timings in the bottom left corner */
+static void FrameProfiler_DrawGraph(void) {
+	int x = 10, y = Game.Height - PROFGRAPH_HEIGHT - 10;
+	if (!FrameProfiler_ShowGraph) return;
+
+	Gfx_Begin2DBatch();
+	FrameProfiler_DrawBars(x, y, false);
+	if (Gfx.SupportsTimestamps) FrameProfiler_DrawBars(x + FRAMEPROFILER_HISTORY * 2 + 10, y, true);
+	Gfx_End2DBatch();
+}
+
+static cc_result FrameProfiler_WriteTo(struct Stream* s) {
+	cc_string line; char lineBuffer[1024];
+	struct FrameProfile* profile;
+	int i, pass;
+	cc_result res;
+
+	String_InitArray(line, lineBuffer);
+	String_AppendConst(&line, "frame");
+	for (pass = 0; pass < FRAMEPASS_COUNT; pass++) String_Format1(&line, ",cpu %c", FramePass_Names[pass]);
+	for (pass = 0; pass < FRAMEPASS_COUNT; pass++) String_Format1(&line, ",gpu %c", FramePass_Names[pass]);
+	String_AppendConst(&line, ",states applied,states skipped,draw calls");
+	if ((res = Stream_WriteLine(s, &line))) return res;
+
+	for (i = 0; i < FRAMEPROFILER_HISTORY; i++) 
+	{
+		profile = &FrameProfiler_History[(FrameProfiler_Next + i) % FRAMEPROFILER_HISTORY];
+		line.length = 0;
+		String_AppendInt(&line, i);
+
+		for (pass = 0; pass < FRAMEPASS_COUNT; pass++) String_Format1(&line, ",%f3", &profile->cpuMS[pass]);
+		for (pass = 0; pass < FRAMEPASS_COUNT; pass++) String_Format1(&line, ",%f3", &profile->gpuMS[pass]);
+		String_Format3(&line, ",%i,%i,%i", &profile->statesApplied, &profile->statesSkipped, &profile->drawCalls);
+		if ((res = Stream_WriteLine(s, &line))) return res;
+	}
+	return 0;
+}
+
+cc_result FrameProfiler_Dump(const cc_string* path) {
+	struct Stream stream;
+	cc_result res, closeRes;
+
+	res = Stream_CreateFile(&stream, path);
+	if (res) return res;
+
+	res      = FrameProfiler_WriteTo(&stream);
+	closeRes = stream.Close(&stream);
+	return res ? res : closeRes;
+}
+
+
+/*########################################################################################################################*
+*---------------------------------------------------Fly-through benchmark-------------------------------------------------*
+*#########################################################################################################################*/
+#define FLYBENCH_MAX_KEYFRAMES 1024
+/* Camera always moves this far along the path each frame, so every run renders exactly the same frames */
+#define FLYBENCH_TIMESTEP (1.0f / 60.0f)
+/* Limits paths to 15 minutes */
+#define FLYBENCH_MAX_FRAMES (60 * 60 * 15)
+
+struct FlyBenchKeyframe { float time, yaw, pitch; Vec3 pos; };
+enum FlyBenchMetric { FLYMETRIC_FRAME, FLYMETRIC_CPU, FLYMETRIC_GPU, FLYMETRIC_DRAWS, FLYMETRIC_COUNT };
+static const char* const FlyBench_MetricNames[FLYMETRIC_COUNT] = { "frame ms", "cpu ms", "gpu ms", "draw calls" };
+
+cc_bool FlyBench_Running;
+static struct FlyBenchKeyframe* fly_keys;
+static int fly_keysCount, fly_curKey;
+static float* fly_frames; /* FLYMETRIC_COUNT values for each frame */
+static int fly_framesCount, fly_maxFrames;
+static cc_bool fly_wasProfiling;
+static cc_bool (*fly_oldDownHook)(int btn, struct InputDevice* device);
+static cc_string fly_output; static char fly_outputBuffer[FILENAME_SIZE];
+
+/* Parses a line in the format 'time x y z yaw pitch' */
+static cc_bool FlyBench_ParseKeyframe(const cc_string* line, struct FlyBenchKeyframe* key) {
+	cc_string parts[6];
+	if (String_UNSAFE_Split(line, ' ', parts, 6) != 6) return false;
+
+	return
+		Convert_ParseFloat(&parts[0], &key->time)  && Convert_ParseFloat(&parts[1], &key->pos.x) &&
+		Convert_ParseFloat(&parts[2], &key->pos.y) && Convert_ParseFloat(&parts[3], &key->pos.z) &&
+		Convert_ParseFloat(&parts[4], &key->yaw)   && Convert_ParseFloat(&parts[5], &key->pitch);
+}
+
+static cc_result FlyBench_LoadPath(struct Stream* s) {
+	cc_string line; char lineBuffer[256];
+	struct FlyBenchKeyframe key;
+	cc_result res;
+
+	for (;;) {
+		String_InitArray(line, lineBuffer);
+		res = Stream_ReadLine(s, &line);
+		if (res == ERR_END_OF_STREAM) return 0;
+		if (res) return res;
+
+		String_UNSAFE_TrimStart(&line);
+		String_UNSAFE_TrimEnd(&line);
+		if (!line.length || line.buffer[0] == '#') continue;
+
+		if (!FlyBench_ParseKeyframe(&line, &key)) {
+			Chat_Add1("&cInvalid camera path line: %s", &line);
+		} else if (fly_keysCount && key.time <= fly_keys[fly_keysCount - 1].time) {
+			Chat_Add1("&cCamera path times must be increasing: %s", &line);
+		} else if (fly_keysCount < FLYBENCH_MAX_KEYFRAMES) {
+			fly_keys[fly_keysCount++] = key;
+		}
+	}
+}
+
+static void FlyBench_Free(void) {
+	FlyBench_Running = false;
+	Input.DownHook   = fly_oldDownHook;
+	FrameProfiler_SetEnabled(fly_wasProfiling);
+
+	Mem_Free(fly_keys);
+	Mem_Free(fly_frames);
+	fly_keys   = NULL;
+	fly_frames = NULL;
+}
+
+/* All input is ignored while flying, except for escape to cancel the benchmark */
+static cc_bool FlyBench_DownHook(int btn, struct InputDevice* device) {
+	if (btn == device->escapeButton) {
+		FlyBench_Stop();
+		Chat_AddRaw("&eFly-through benchmark cancelled");
+	}
+	return true;
+}
+
+cc_result FlyBench_Start(const cc_string* path, const cc_string* output) {
+	cc_uint8 buffer[2048];
+	struct Stream stream, buffered;
+	cc_result res;
+	if (FlyBench_Running) FlyBench_Stop();
+
+	fly_keys      = (struct FlyBenchKeyframe*)Mem_Alloc(FLYBENCH_MAX_KEYFRAMES, sizeof(struct FlyBenchKeyframe), "camera path");
+	fly_keysCount = 0;
+
+	res = Stream_OpenFile(&stream, path);
+	if (!res) {
+		Stream_ReadonlyBuffered(&buffered, &stream, buffer, sizeof(buffer));
+		res = FlyBench_LoadPath(&buffered);
+		/* No point logging error for closing readonly file */
+		(void)stream.Close(&stream);
+	}
+	if (!res && !fly_keysCount) res = ERR_INVALID_ARGUMENT;
+	if (res) { Mem_Free(fly_keys); fly_keys = NULL; return res; }
+
+	fly_maxFrames   = (int)(fly_keys[fly_keysCount - 1].time / FLYBENCH_TIMESTEP) + 1;
+	fly_maxFrames   = min(fly_maxFrames, FLYBENCH_MAX_FRAMES);
+	fly_frames      = (float*)Mem_Alloc(fly_maxFrames * FLYMETRIC_COUNT, sizeof(float), "benchmark frames");
+	fly_framesCount = 0;
+	fly_curKey      = 0;
+
+	String_InitArray(fly_output, fly_outputBuffer);
+	String_Copy(&fly_output, output);
+
+	/* Frame profiler provides the CPU/GPU timings, but its graph would be included in them */
+	fly_wasProfiling = FrameProfiler_Enabled;
+	FrameProfiler_SetEnabled(true);
+	FrameProfiler_ShowGraph = false;
+
+	fly_oldDownHook  = Input.DownHook;
+	Input.DownHook   = FlyBench_DownHook;
+	FlyBench_Running = true;
+	return 0;
+}
+
+void FlyBench_Stop(void) {
+	if (FlyBench_Running) FlyBench_Free();
+}
+
+/* Moves the local player to where they should be along the camera path in the current frame */
+static void FlyBench_Update(void) {
+	struct Entity* e = &Entities.CurPlayer->Base;
+	struct FlyBenchKeyframe* a;
+	struct FlyBenchKeyframe* b;
+	struct LocationUpdate update;
+	float time = fly_framesCount * FLYBENCH_TIMESTEP, t;
+
+	while (fly_curKey < fly_keysCount - 1 && fly_keys[fly_curKey + 1].time <= time) fly_curKey++;
+	a = &fly_keys[fly_curKey];
+	b = fly_curKey < fly_keysCount - 1 ? a + 1 : a;
+	t = b->time > a->time ? (time - a->time) / (b->time - a->time) : 0.0f;
+	Math_Clamp(t, 0.0f, 1.0f);
+
+	Vec3_Lerp(&update.pos, &a->pos, &b->pos, t);
+	update.yaw   = Math_LerpAngle(a->yaw, b->yaw, t);
+	update.pitch = Math_Lerp(a->pitch, b->pitch, t);
+	update.flags = LU_HAS_POS | LU_HAS_YAW | LU_HAS_PITCH;
+
+	e->VTABLE->SetLocation(e, &update);
+	/* Otherwise gravity keeps accumulating while the player is held in place */
+	Vec3_Set(e->Velocity, 0, 0, 0);
+}
+
+static void FlyBench_SortValues(float* keys, int left, int right) {
+	float key;
+
+	while (left < right) {
+		int i = left, j = right;
+		float pivot = keys[(i + j) >> 1];
+
+		/* partition the list */
+		while (i <= j) {
+			while (pivot > keys[i]) i++;
+			while (pivot < keys[j]) j--;
+			QuickSort_Swap_Maybe();
+		}
+		/* recurse into the smaller subset */
+		if (j - left <= right - i) {
+			if (left < j) FlyBench_SortValues(keys, left, j);
+			left = i;
+		} else {
+			if (i < right) FlyBench_SortValues(keys, i, right);
+			right = j;
+		}
+	}
+}
+
+static cc_result FlyBench_WriteResults(struct Stream* s) {
+	static const int percentiles[3] = { 50, 95, 99 };
+	cc_string line; char lineBuffer[256];
+	float* values;
+	float value, mean;
+	int i, j, metric;
+	cc_result res;
+
+	values = (float*)Mem_TryAlloc(fly_framesCount, sizeof(float));
+	if (!values) return ERR_OUT_OF_MEMORY;
+
+	String_InitArray(line, lineBuffer);
+	String_AppendConst(&line, "metric,mean,p50,p95,p99,max");
+	res = Stream_WriteLine(s, &line);
+
+	for (metric = 0; metric < FLYMETRIC_COUNT && !res; metric++) 
+	{
+		for (i = 0, mean = 0.0f; i < fly_framesCount; i++) 
+		{
+			values[i] = fly_frames[i * FLYMETRIC_COUNT + metric];
+			mean     += values[i];
+		}
+		mean /= fly_framesCount;
+		FlyBench_SortValues(values, 0, fly_framesCount - 1);
+
+		line.length = 0;
+		String_Format2(&line, "%c,%f3", FlyBench_MetricNames[metric], &mean);
+		for (j = 0; j < Array_Elems(percentiles); j++) 
+		{
+			value = values[(fly_framesCount - 1) * percentiles[j] / 100];
+			String_Format1(&line, ",%f3", &value);
+		}
+		String_Format1(&line, ",%f3", &values[fly_framesCount - 1]);
+
+		Chat_Add1("&e  %s", &line);
+		res = Stream_WriteLine(s, &line);
+	}
+
+	Mem_Free(values);
+	return res;
+}
+
+static void FlyBench_Finish(void) {
+	struct Stream stream;
+	cc_result res;
+
+	Chat_Add1("&eFly-through benchmark finished after &f%i &eframes:", &fly_framesCount);
+	res = Stream_CreateFile(&stream, &fly_output);
+
+	if (!res) {
+		res = FlyBench_WriteResults(&stream);
+		(void)stream.Close(&stream);
+	}
+
+	if (res) { Logger_SysWarn2(res, "writing", &fly_output); }
+	else     { Chat_Add1("&eSaved benchmark results to &f%s", &fly_output); }
+	FlyBench_Free();
+}
+
+/* Records timings of the frame that was just rendered */
+static void FlyBench_EndFrame(float delta) {
+	struct FrameProfile* profile;
+	float* values;
+	int i;
+	if (!FlyBench_Running) return;
+
+	profile = &FrameProfiler_History[(FrameProfiler_Next + FRAMEPROFILER_HISTORY - 1) % FRAMEPROFILER_HISTORY];
+	values  = &fly_frames[fly_framesCount * FLYMETRIC_COUNT];
+	Mem_Set(values, 0, FLYMETRIC_COUNT * sizeof(float));
+
+	values[FLYMETRIC_FRAME] = delta * 1000.0f;
+	values[FLYMETRIC_DRAWS] = (float)profile->drawCalls;
+	for (i = 0; i < FRAMEPASS_COUNT; i++) 
+	{
+		values[FLYMETRIC_CPU] += profile->cpuMS[i];
+		values[FLYMETRIC_GPU] += profile->gpuMS[i];
+	}
+
+	fly_framesCount++;
+	if (fly_framesCount >= fly_maxFrames) FlyBench_Finish();
+}
+
+
+/*########################################################################################################################*
+*-----------------------------------------------------Crowd benchmark-----------------------------------------------------*
+*#########################################################################################################################*/
+/* Synthetic players use entity ids 0 and above, so at most MAX_NET_PLAYERS - 1 can be spawned */
+static const cc_uint8 crowd_steps[] = { 10, 25, 50, 100, 150, 200, 254 };
+#define CROWDBENCH_STEPS (int)Array_Elems(crowd_steps)
+#define CROWDBENCH_WARMUP_FRAMES  60
+#define CROWDBENCH_MEASURE_FRAMES 300
+/* Skins are fetched by name, so players share a few skins like on a real server */
+#define CROWDBENCH_SKINS 16
+
+enum CrowdBenchMetric { CROWDMETRIC_TICK, CROWDMETRIC_MODELS, CROWDMETRIC_SHADOWS, CROWDMETRIC_NAMES, CROWDMETRIC_FRAME, CROWDMETRIC_COUNT };
+static const char* const CrowdBench_MetricNames[CROWDMETRIC_COUNT] = { "tick ms", "models ms", "shadows ms", "names ms", "frame ms" };
+static const char* const crowd_models[] = { "humanoid", "humanoid", "humanoid", "humanoid", "chicken", "creeper", "pig", "sheep", "skeleton", "spider", "zombie" };
+
+cc_bool CrowdBench_Running;
+static int crowd_step, crowd_spawned, crowd_frames, crowd_ticks;
+static float crowd_totals[CROWDMETRIC_COUNT]; /* Milliseconds spent in each metric in the current step */
+static float crowd_results[CROWDBENCH_STEPS][CROWDMETRIC_COUNT];
+static cc_uint64 crowd_markTime;
+static float crowd_time;
+static Vec3 crowd_center;
+static RNGState crowd_rnd;
+static cc_bool (*crowd_oldDownHook)(int btn, struct InputDevice* device);
+static cc_string crowd_output; static char crowd_outputBuffer[FILENAME_SIZE];
+
+/* Adds the time elapsed since the previous mark to the given metric (if not -1) */
+static void CrowdBench_Mark(int metric) {
+	cc_uint64 now;
+	if (!CrowdBench_Running) return;
+
+	now = Stopwatch_Measure();
+	if (metric >= 0) crowd_totals[metric] += Stopwatch_ElapsedMicroseconds(crowd_markTime, now) / 1000.0f;
+	crowd_markTime = now;
+}
+
+/* Walks a player around a circle centred on where the local player was when the benchmark started */
+static void CrowdBench_Move(int id, cc_uint8 mode) {
+	struct NetPlayer* p = &NetPlayers_List[id];
+	struct LocationUpdate update;
+	float radius = 3.0f + (id % 16) * 1.5f;
+	/* Moves at around 4 blocks per second */
+	float angle  = crowd_time * (4.0f / radius) + id * 0.7f;
+
+	update.pos.x = crowd_center.x + Math_CosF(angle) * radius;
+	update.pos.y = crowd_center.y;
+	update.pos.z = crowd_center.z + Math_SinF(angle) * radius;
+	update.yaw   = angle * MATH_RAD2DEG + 180.0f;
+	update.pitch = 0.0f;
+	update.flags = LU_HAS_POS | LU_HAS_YAW | LU_HAS_PITCH | mode;
+	NetInterpComp_SetLocation(&p->Interp, &update, &p->Base);
+}
+
+static void CrowdBench_Spawn(int id) {
+	cc_string name; char nameBuffer[STRING_SIZE];
+	cc_string skin; char skinBuffer[STRING_SIZE];
+	struct Entity* e = &NetPlayers_List[id].Base;
+	cc_string model;
+	int skinID;
+
+	Entities_Remove(id);
+	NetPlayer_Init(&NetPlayers_List[id]);
+	Entities_Add(id, e);
+	Event_RaiseInt(&EntityEvents.Added, id);
+
+	String_InitArray(name, nameBuffer);
+	String_Format1(&name, "&7Bot%i", &id);
+	String_InitArray(skin, skinBuffer);
+	skinID = Random_Next(&crowd_rnd, CROWDBENCH_SKINS);
+	String_Format1(&skin, "CrowdBot%i", &skinID);
+
+	Entity_SetSkin(e, &skin);
+	Entity_SetName(e, &name);
+	model = String_FromReadonly(crowd_models[Random_Next(&crowd_rnd, Array_Elems(crowd_models))]);
+	Entity_SetModel(e, &model);
+	CrowdBench_Move(id, LU_POS_ABSOLUTE_INSTANT);
+}
+
+/* Sends movement to all players like a server would each tick, then times ticking all entities */
+static void CrowdBench_Tick(struct ScheduledTask* task) {
+	int i;
+	crowd_time += (float)task->interval;
+	for (i = 0; i < crowd_spawned; i++) CrowdBench_Move(i, LU_POS_ABSOLUTE_SMOOTH);
+
+	CrowdBench_Mark(-1);
+	Entities_Tick(task);
+	CrowdBench_Mark(CROWDMETRIC_TICK);
+	crowd_ticks++;
+}
+
+static void CrowdBench_BeginStep(void) {
+	while (crowd_spawned < crowd_steps[crowd_step]) 
+	{
+		CrowdBench_Spawn(crowd_spawned++);
+	}
+	crowd_frames = 0;
+}
+
+static void CrowdBench_Free(void) {
+	int i;
+	CrowdBench_Running = false;
+	Input.DownHook     = crowd_oldDownHook;
+	tasks[entTaskI].Callback = Entities_Tick;
+
+	for (i = 0; i < crowd_spawned; i++) 
+	{
+		if (Entities.List[i] == &NetPlayers_List[i].Base) Entities_Remove(i);
+	}
+	crowd_spawned = 0;
+}
+
+/* All input is ignored while benchmarking, except for escape to cancel the benchmark */
+static cc_bool CrowdBench_DownHook(int btn, struct InputDevice* device) {
+	if (btn == device->escapeButton) {
+		CrowdBench_Stop();
+		Chat_AddRaw("&eCrowd benchmark cancelled");
+	}
+	return true;
+}
+
+void CrowdBench_Start(const cc_string* output) {
+	if (CrowdBench_Running) CrowdBench_Stop();
+
+	String_InitArray(crowd_output, crowd_outputBuffer);
+	String_Copy(&crowd_output, output);
+
+	crowd_center  = Entities.CurPlayer->Base.Position;
+	crowd_time    = 0.0f;
+	crowd_step    = 0;
+	crowd_spawned = 0;
+	/* Same seed every run, so every run spawns the same models and skins */
+	Random_Seed(&crowd_rnd, 0x43524F57);
+
+	crowd_oldDownHook  = Input.DownHook;
+	Input.DownHook     = CrowdBench_DownHook;
+	tasks[entTaskI].Callback = CrowdBench_Tick;
+	CrowdBench_Running = true;
+	CrowdBench_BeginStep();
+}
+
+void CrowdBench_Stop(void) {
+	if (CrowdBench_Running) CrowdBench_Free();
+}
+
+static cc_result CrowdBench_WriteResults(struct Stream* s) {
+	cc_string line; char lineBuffer[256];
+	int i, step, players;
+	cc_result res;
+
+	String_InitArray(line, lineBuffer);
+	String_AppendConst(&line, "players");
+	for (i = 0; i < CROWDMETRIC_COUNT; i++) String_Format1(&line, ",%c", CrowdBench_MetricNames[i]);
+	if ((res = Stream_WriteLine(s, &line))) return res;
+
+	for (step = 0; step < CROWDBENCH_STEPS; step++) 
+	{
+		line.length = 0;
+		players     = crowd_steps[step];
+		String_AppendInt(&line, players);
+
+		for (i = 0; i < CROWDMETRIC_COUNT; i++) String_Format1(&line, ",%f3", &crowd_results[step][i]);
+		if ((res = Stream_WriteLine(s, &line))) return res;
+	}
+	return 0;
+}
+
+static void CrowdBench_Finish(void) {
+	struct Stream stream;
+	cc_result res;
+
+	CrowdBench_Free();
+	res = Stream_CreateFile(&stream, &crowd_output);
+
+	if (!res) {
+		res = CrowdBench_WriteResults(&stream);
+		(void)stream.Close(&stream);
+	}
+
+	if (res) { Logger_SysWarn2(res, "writing", &crowd_output); }
+	else     { Chat_Add1("&eSaved crowd benchmark results to &f%s", &crowd_output); }
+}
+
+static void CrowdBench_EndStep(void) {
+	float* results = crowd_results[crowd_step];
+	int i, players = crowd_steps[crowd_step];
+
+	/* Ticks happen at a fixed rate independent of frames, so are averaged per tick instead */
+	for (i = 0; i < CROWDMETRIC_COUNT; i++) results[i] = crowd_totals[i] / CROWDBENCH_MEASURE_FRAMES;
+	results[CROWDMETRIC_TICK] = crowd_totals[CROWDMETRIC_TICK] / max(1, crowd_ticks);
+
+	Chat_Add4("&e%i players: &ftick %f3, models %f3, shadows %f3 ms", 
+				&players, &results[CROWDMETRIC_TICK], &results[CROWDMETRIC_MODELS], &results[CROWDMETRIC_SHADOWS]);
+	Chat_Add2("&e  names %f3 ms, frame %f3 ms", &results[CROWDMETRIC_NAMES], &results[CROWDMETRIC_FRAME]);
+}
+
+/* Moves on to the next number of players once enough frames have been measured */
+static void CrowdBench_EndFrame(float delta) {
+	if (!CrowdBench_Running) return;
+	crowd_totals[CROWDMETRIC_FRAME] += delta * 1000.0f;
+	crowd_frames++;
+
+	/* Skins and model textures are still being loaded during the first few frames */
+	if (crowd_frames == CROWDBENCH_WARMUP_FRAMES) {
+		Mem_Set(crowd_totals, 0, sizeof(crowd_totals));
+		crowd_ticks = 0;
+	} else if (crowd_frames == CROWDBENCH_WARMUP_FRAMES + CROWDBENCH_MEASURE_FRAMES) {
+		CrowdBench_EndStep();
+		crowd_step++;
+
+		if (crowd_step < CROWDBENCH_STEPS) {
+			CrowdBench_BeginStep();
+		} else {
+			CrowdBench_Finish();
+		}
+	}
+}
+
+
+/*########################################################################################################################*
+*-------------------------------------------------------Event tracer------------------------------------------------------*
+*#########################################################################################################################*/
+cc_bool Tracer_Enabled;
+#ifdef CC_BUILD_TRACING
+/* Max number of events recorded by each thread, before further events are dropped */
+#define TRACER_MAX_EVENTS 32768
+
+/* name is NULL for the end of a scope */
+struct TracerEvent { const char* name; cc_uint64 time; };
+struct TracerBuffer {
+	struct TracerBuffer* next;
+	int threadID;
+	/* Only ever written by the owning thread, and only increased after the event is written */
+	volatile int count;
+	struct TracerEvent events[TRACER_MAX_EVENTS];
+};
+
+/* Buffers are allocated the first time a thread records an event, and then kept for reuse */
+/*  by that thread until the game exits, since threads are never notified before exiting */
+static CC_THREADLOCAL struct TracerBuffer* tracer_cur;
+static struct TracerBuffer* tracer_head;
+static void* tracer_mutex;
+static int tracer_threads;
+static cc_uint64 tracer_start;
+
+static CC_NOINLINE struct TracerBuffer* Tracer_AddBuffer(void) {
+	struct TracerBuffer* buffer = (struct TracerBuffer*)Mem_TryAlloc(1, sizeof(struct TracerBuffer));
+	if (!buffer) return NULL;
+	buffer->count = 0;
+
+	Mutex_Lock(tracer_mutex);
+	{
+		buffer->threadID = ++tracer_threads;
+		buffer->next     = tracer_head;
+		tracer_head      = buffer;
+	}
+	Mutex_Unlock(tracer_mutex);
+	return buffer;
+}
+
+static void Tracer_Record(const char* name) {
+	struct TracerBuffer* buffer = tracer_cur;
+	struct TracerEvent* e;
+
+	if (!buffer) buffer = tracer_cur = Tracer_AddBuffer();
+	if (!buffer || buffer->count >= TRACER_MAX_EVENTS) return;
+
+	e = &buffer->events[buffer->count];
+	e->name = name;
+	e->time = Stopwatch_Measure();
+	buffer->count++;
+}
+
+void Tracer_Begin(const char* name) { if (Tracer_Enabled) Tracer_Record(name); }
+void Tracer_End(void)               { if (Tracer_Enabled) Tracer_Record(NULL); }
+
+cc_result Tracer_Start(void) {
+	struct TracerBuffer* buffer;
+	if (!tracer_mutex) tracer_mutex = Mutex_Create("Tracer buffers");
+	Tracer_Enabled = false;
+
+	Mutex_Lock(tracer_mutex);
+	{
+		for (buffer = tracer_head; buffer; buffer = buffer->next) buffer->count = 0;
+	}
+	Mutex_Unlock(tracer_mutex);
+
+	tracer_start   = Stopwatch_Measure();
+	Tracer_Enabled = true;
+	return 0;
+}
+
+static cc_result Tracer_Flush(struct Stream* s, cc_string* str) {
+	cc_result res = Stream_Write(s, (const cc_uint8*)str->buffer, str->length);
+	str->length   = 0;
+	return res;
+}
+
+static cc_result Tracer_WriteBuffer(struct Stream* s, cc_string* str, struct TracerBuffer* buffer) {
+	struct TracerEvent* e;
+	int i, depth = 0, named = false, count = buffer->count;
+	cc_uint32 time;
+	cc_result res;
+
+	for (i = 0; i < count; i++) 
+	{
+		e    = &buffer->events[i];
+		time = (cc_uint32)Stopwatch_ElapsedMicroseconds(tracer_start, e->time);
+
+		if (e->name) {
+			/* Chrome trace viewer shows this as the name of the thread's row */
+			if (!named) String_Format2(str, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%i,\"args\":{\"name\":\"%c\"}}", 
+									&buffer->threadID, e->name);
+
+			String_Format3(str, ",\n{\"name\":\"%c\",\"ph\":\"B\",\"ts\":%i,\"pid\":1,\"tid\":%i}", 
+									e->name, &time, &buffer->threadID);
+			depth++; named = true;
+		} else if (depth) {
+			/* Ends of scopes that began before tracing was started are skipped */
+			String_Format2(str, ",\n{\"ph\":\"E\",\"ts\":%i,\"pid\":1,\"tid\":%i}", 
+									&time, &buffer->threadID);
+			depth--;
+		}
+
+		if (str->length < str->capacity - 256) continue;
+		if ((res = Tracer_Flush(s, str))) return res;
+	}
+	return 0;
+}
+
+static cc_result Tracer_WriteTo(struct Stream* s) {
+	cc_string str; char strBuffer[8192];
+	struct TracerBuffer* buffer;
+	cc_result res = 0;
+
+	String_InitArray(str, strBuffer);
+	/* Dummy metadata event, so every later event can start with a comma */
+	String_AppendConst(&str, "{\"traceEvents\":[\n{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"" GAME_APP_NAME "\"}}");
+
+	for (buffer = tracer_head; buffer && !res; buffer = buffer->next) 
+	{
+		res = Tracer_WriteBuffer(s, &str, buffer);
+	}
+	if (res) return res;
+
+	String_AppendConst(&str, "\n]}\n");
+	return Tracer_Flush(s, &str);
+}
+
+cc_result Tracer_Stop(const cc_string* path) {
+	struct Stream stream;
+	cc_result res, closeRes;
+	if (!Tracer_Enabled) return ERR_NOT_SUPPORTED;
+	Tracer_Enabled = false;
+
+	res = Stream_CreateFile(&stream, path);
+	if (res) return res;
+
+	Mutex_Lock(tracer_mutex);
+	{
+		res = Tracer_WriteTo(&stream);
+	}
+	Mutex_Unlock(tracer_mutex);
+
+	closeRes = stream.Close(&stream);
+	return res ? res : closeRes;
+}
+#else
+void Tracer_Begin(const char* name) { }
+void Tracer_End(void) { }
+
+cc_result Tracer_Start(void) { return ERR_NOT_SUPPORTED; }
+cc_result Tracer_Stop(const cc_string* path) { return ERR_NOT_SUPPORTED; }
+#endif
+
+/* Whether the world has not been drawn from any view yet in the current frame */
+static cc_bool firstView;
+
 static void Render3DFrame(float delta, float t) {
 	struct Matrix mvp;
 	Vec3 pos;
@@ -524,21 +1720,39 @@ static void Render3DFrame(float delta, float t) {
 
 	if (EnvRenderer_ShouldRenderSkybox()) EnvRenderer_RenderSkybox();
 	AxisLinesRenderer_Render();
+	CrowdBench_Mark(-1);
 	Entities_RenderModels(delta, t);
+	CrowdBench_Mark(CROWDMETRIC_MODELS);
 	EntityNames_Render();
+	CrowdBench_Mark(CROWDMETRIC_NAMES);
+	FrameProfiler_Mark(FRAMEPASS_ENTITIES);
 
 	Particles_Render(t);
+	FrameProfiler_Mark(FRAMEPASS_PARTICLES);
 	EnvRenderer_RenderSky();
 	EnvRenderer_RenderClouds();
+	FrameProfiler_Mark(FRAMEPASS_SKY);
+
+	/* Chunks only need sorting and building once per frame, even when drawing from multiple views */
+	if (firstView) {
+		MapRenderer_Update(delta);
+	} else {
+		MapRenderer_UpdateView();
+	}
+	firstView = false;
 
-	MapRenderer_Update(delta);
 	MapRenderer_RenderNormal(delta);
+	MapRenderer_RenderDistant(delta);
 	EnvRenderer_RenderMapSides();
+	FrameProfiler_Mark(FRAMEPASS_MAP);
 
+	CrowdBench_Mark(-1);
 	EntityShadows_Render();
+	CrowdBench_Mark(CROWDMETRIC_SHADOWS);
 	if (Game_SelectedPos.valid && !Game_HideGui) {
 		SelOutlineRenderer_Render(&Game_SelectedPos, true);
 	}
+	FrameProfiler_Mark(FRAMEPASS_SHADOWS);
 
 	/* Render water over translucent blocks when under the water outside the map for proper alpha blending */
 	pos = Camera.CurrentPos;
@@ -555,10 +1769,12 @@ static void Render3DFrame(float delta, float t) {
 	if (Game_SelectedPos.valid && !Game_HideGui && Blocks.Draw[Game_SelectedPos.block] == DRAW_TRANSLUCENT) {
 		SelOutlineRenderer_Render(&Game_SelectedPos, false);
 	}
+	FrameProfiler_Mark(FRAMEPASS_TRANSLUCENT);
 
 	Selections_Render();
 	EntityNames_RenderHovered();
 	if (!Game_HideGui) HeldBlockRenderer_Render(delta);
+	FrameProfiler_Mark(FRAMEPASS_SELECTIONS);
 }
 
 static void Render3D_Anaglyph(float delta, float t) {
@@ -577,22 +1793,83 @@ static void Render3D_Anaglyph(float delta, float t) {
 static void PerformScheduledTasks(double time) {
 	struct ScheduledTask* task;
 	int i;
+	Tracer_Begin("PerformScheduledTasks");
 
 	for (i = 0; i < tasksCount; i++) {
 		task = &tasks[i];
 		task->accumulator += time;
 
 		while (task->accumulator >= task->interval) {
-			task->Callback(task);
+			if (!HandlerCost_Enabled) {
+				task->Callback(task);
+			} else {
+				void* func    = (void*)task->Callback;
+				cc_uint64 beg = Stopwatch_Measure();
+				task->Callback(task);
+				HandlerCost_Record(func, beg);
+			}
 			task->accumulator -= task->interval;
 		}
 	}
+	Tracer_End();
+}
+
+static void Screenshot_MakeName(cc_string* filename) {
+	struct cc_datetime now;
+	DateTime_CurrentLocal(&now);
+
+	String_Format3(filename, "screenshot_%p4-%p2-%p2", &now.year, &now.month, &now.day);
+	String_Format3(filename, "-%p2-%p2-%p2.png", &now.hour, &now.minute, &now.second);
+}
+
+#ifdef CC_GFX_SCREENSHOT_READBACK
+/* Encoding a large screenshot to .png can take a while, so it's done on the file ops thread instead */
+static cc_result Screenshot_Encode(struct Stream* s, void* obj) {
+	return Png_Encode((struct Bitmap*)obj, s, NULL, false, NULL);
+}
+
+static void Screenshot_Saved(const cc_string* path, cc_uint8* data, cc_uint32 length, cc_result res, void* obj) {
+	struct Bitmap* bmp = (struct Bitmap*)obj;
+	cc_string filename;
+	Mem_Free(bmp->scan0);
+	Mem_Free(bmp);
+
+	if (res) { Logger_SysWarn2(res, "saving to", path); return; }
+	filename = String_UNSAFE_SubstringAt(path, String_IndexOf(path, '/') + 1);
+	Chat_Add1("&eTaken screenshot as: %s", &filename);
+
+#ifdef CC_BUILD_MOBILE
+	Platform_ShareScreenshot(&filename);
+#endif
+}
+
+static void Screenshot_ReadBack(struct Bitmap* pixels, cc_result res) {
+	cc_string filename; char fileBuffer[STRING_SIZE];
+	cc_string path;     char pathBuffer[FILENAME_SIZE];
+	struct Bitmap* bmp;
+
+	if (res) { Logger_SysWarn(res, "taking screenshot"); Mem_Free(pixels->scan0); return; }
+	bmp = (struct Bitmap*)Mem_TryAlloc(1, sizeof(struct Bitmap));
+	if (!bmp) { Logger_SysWarn(ERR_OUT_OF_MEMORY, "taking screenshot"); Mem_Free(pixels->scan0); return; }
+	*bmp = *pixels;
+
+	String_InitArray(filename, fileBuffer);
+	Screenshot_MakeName(&filename);
+	String_InitArray(path, pathBuffer);
+	String_Format1(&path, "screenshots/%s", &filename);
+
+	Stream_CreateFileAsync(&path, Screenshot_Encode, Screenshot_Saved, bmp);
 }
 
+void Game_TakeScreenshot(void) {
+	Game_ScreenshotRequested = false;
+	if (!Utils_EnsureDirectory("screenshots")) return;
+	Gfx_ReadbackScreenshot(Screenshot_ReadBack);
+}
+#else
 void Game_TakeScreenshot(void) {
 	cc_string filename; char fileBuffer[STRING_SIZE];
 	cc_string path;     char pathBuffer[FILENAME_SIZE];
-	struct cc_datetime now;
 	cc_result res;
 #ifdef CC_BUILD_WEB
 	cc_filepath str;
@@ -600,11 +1877,8 @@ void Game_TakeScreenshot(void) {
 	struct Stream stream;
 #endif
 	Game_ScreenshotRequested = false;
-	DateTime_CurrentLocal(&now);
-
 	String_InitArray(filename, fileBuffer);
-	String_Format3(&filename, "screenshot_%p4-%p2-%p2", &now.year, &now.month, &now.day);
-	String_Format3(&filename, "-%p2-%p2-%p2.png", &now.hour, &now.minute, &now.second);
+	Screenshot_MakeName(&filename);
 
 #ifdef CC_BUILD_WEB
 	extern void interop_TakeScreenshot(const char* path);
@@ -632,6 +1906,7 @@ void Game_TakeScreenshot(void) {
 #endif
 #endif
 }
+#endif
 
 
 #ifdef CC_BUILD_WEB
@@ -640,40 +1915,59 @@ static void LimitFPS(void) {
 	/* Instead the web browser manages the frame timing */
 }
 #else
-static float gfx_targetTime, gfx_actualTime;
+/* Frames are paced against absolute deadlines, measured in microseconds since pace_base */
+/*  so that rounding errors in each frame's wait don't accumulate into uneven frame times */
+static cc_uint64 pace_base, pace_deadline;
+/* Estimate of how much longer than requested Thread_Sleep can take, in milliseconds */
+/*  (e.g. requested 4ms, but actually slept for 5ms due to timer resolution) */
+static float pace_oversleep = 1.0f;
+
+static CC_INLINE cc_uint64 PaceElapsed(void) {
+	return Stopwatch_ElapsedMicroseconds(pace_base, Stopwatch_Measure());
+}
 
-static CC_INLINE float ElapsedMilliseconds(cc_uint64 beg, cc_uint64 end) {
-	cc_uint64 elapsed = Stopwatch_ElapsedMicroseconds(beg, end);
-	if (elapsed > 5000000) elapsed = 5000000;
-	
+/* Sleeps for most of the given time, but not so long that the deadline might be missed */
+static void PaceSleep(float remainingMS) {
+	int requested = (int)(remainingMS - pace_oversleep);
+	cc_uint64 beg = Stopwatch_Measure();
+	float overslept;
+
+	Thread_Sleep(requested);
 	/* Avoid uint64 / float division, as that typically gets implemented */
 	/* using a library function rather than a direct CPU instruction */
-	return (int)elapsed / 1000.0f;
+	overslept = (int)Stopwatch_ElapsedMicroseconds(beg, Stopwatch_Measure()) / 1000.0f - requested;
+
+	/* Quickly adapt to longer oversleeps, but only slowly trust shorter ones */
+	if (overslept > pace_oversleep) {
+		pace_oversleep = overslept;
+	} else {
+		pace_oversleep = pace_oversleep * 0.95f + overslept * 0.05f;
+	}
+	pace_oversleep = max(0.25f, min(pace_oversleep, 8.0f));
 }
 
-/* Examines difference between expected and actual frame times, */
-/*  then sleeps if actual frame time is too fast */
+/* Waits until the next frame's deadline, by sleeping for most of */
+/*  the time and then spinning for the last small part of it */
 static void LimitFPS(void) {
-	cc_uint64 frameEnd, sleepEnd;
-	
-	frameEnd = Stopwatch_Measure();
-	gfx_actualTime += ElapsedMilliseconds(frameStart, frameEnd);
-	gfx_targetTime += gfx_minFrameMs;
-
-	/* going faster than FPS limit - sleep to slow down */
-	if (gfx_actualTime < gfx_targetTime) {
-		float cooldown = gfx_targetTime - gfx_actualTime;
-		Thread_Sleep((int)(cooldown + 0.5f));
-
-		/* also accumulate Thread_Sleep duration, as actual sleep */
-		/*  duration can significantly deviate from requested time */
-		/*  (e.g. requested 4ms, but actually slept for 8ms) */
-		sleepEnd = Stopwatch_Measure();
-		gfx_actualTime += ElapsedMilliseconds(frameEnd, sleepEnd);
+	cc_uint64 frameUS = (cc_uint64)(gfx_minFrameMs * 1000.0f);
+	cc_uint64 now;
+	float remainingMS;
+
+	if (!pace_base) pace_base = Stopwatch_Measure();
+	now = PaceElapsed();
+	pace_deadline += frameUS;
+
+	/* Frame took much longer than it should have (e.g. loading a map), so start pacing again from now */
+	/* Also avoids waiting for an old deadline when changing from a lower to higher FPS limit */
+	if (pace_deadline + frameUS < now || pace_deadline > now + frameUS) {
+		pace_deadline = now; return;
 	}
 
-	/* reset accumulated time to avoid excessive FPS drift */
-	if (gfx_targetTime >= 1000) { gfx_actualTime = 0; gfx_targetTime = 0; }
+	for (; now < pace_deadline; now = PaceElapsed()) 
+	{
+		remainingMS = (int)(pace_deadline - now) / 1000.0f;
+		if (remainingMS > pace_oversleep + 1.0f) PaceSleep(remainingMS);
+	}
 }
 #endif
 
@@ -685,6 +1979,7 @@ static CC_INLINE void Game_DrawFrame(float delta, float t) {
 		Camera_KeyLookUpdate(delta);
 		InputHandler_Tick();
 
+		DynRes_BeginScene();
 		if (Game_Anaglyph3D) {
 			Render3D_Anaglyph(delta, t);
 		} else {
@@ -695,11 +1990,13 @@ static CC_INLINE void Game_DrawFrame(float delta, float t) {
 	}
 
 	Gfx_Begin2D(Game.Width, Game.Height);
+	DynRes_EndScene();
 	Gui_RenderGui(delta);
 	for (i = 0; i < Array_Elems(Game.Draw2DHooks); i++)
 	{
 		if (Game.Draw2DHooks[i]) Game.Draw2DHooks[i](delta);
 	}
+	FrameProfiler_DrawGraph();
 
 /* TODO find a better solution than this */
 #ifdef CC_BUILD_3DS
@@ -714,6 +2011,7 @@ static CC_INLINE void Game_DrawFrame(float delta, float t) {
 	}
 #endif
 	Gfx_End2D();
+	FrameProfiler_Mark(FRAMEPASS_UI);
 }
 
 #ifdef CC_BUILD_SPLITSCREEN
@@ -738,6 +2036,33 @@ int Game_MapState(int deviceIndex) {
 }
 #endif
 
+static void Game_UpdateMouse(float delta) {
+#ifdef CC_BUILD_SPLITSCREEN
+	/* TODO: find a better solution */
+	for (int i = 0; i < Game_NumStates; i++)
+	{
+		Game.CurrentState  = i;
+		Entities.CurPlayer = &LocalPlayer_Instances[i];
+		Camera.Active->UpdateMouse(Entities.CurPlayer, delta);
+	}
+	Game.CurrentState  = 0;
+	Entities.CurPlayer = &LocalPlayer_Instances[0];
+#else
+	Camera.Active->UpdateMouse(Entities.CurPlayer, delta);
+#endif
+}
+
+/* Scheduled tasks can take a while, so mouse movement that arrived since the start of the frame */
+/*  is applied just before the camera orientation is calculated, to reduce mouse look latency */
+static void Game_LatchMouse(void) {
+	/* Smoothed movement is integrated over the frame delta, so can only be updated once per frame */
+	if (!Input.RawMode || Camera.Smooth) return;
+
+	Window_ProcessEvents(0.0f);
+	if (!Input.RawMode) return;
+	Game_UpdateMouse(0.0f);
+}
+
 static CC_INLINE void Game_RenderFrame(void) {
 	struct ScheduledTask entTask;
 	double deltaD;
@@ -772,23 +2097,11 @@ static CC_INLINE void Game_RenderFrame(void) {
 
 	Gfx_BeginFrame();
 	Gfx_BindIb(Gfx.DefaultIb);
+	Game_ResetScratch();
 	Game.Time += deltaD;
 	Game_Vertices = 0;
 	Gamepad_Tick(delta);
-
-#ifdef CC_BUILD_SPLITSCREEN
-	/* TODO: find a better solution */
-	for (int i = 0; i < Game_NumStates; i++)
-	{
-		Game.CurrentState  = i;
-		Entities.CurPlayer = &LocalPlayer_Instances[i];
-		Camera.Active->UpdateMouse(Entities.CurPlayer, delta);
-	}
-	Game.CurrentState  = 0;
-	Entities.CurPlayer = &LocalPlayer_Instances[0];
-#else
-	Camera.Active->UpdateMouse(Entities.CurPlayer, delta);
-#endif
+	Game_UpdateMouse(delta);
 
 	if (!Window_Main.Focused && !Gui.InputGrab) Gui_ShowPauseMenu();
 
@@ -797,6 +2110,10 @@ static CC_INLINE void Game_RenderFrame(void) {
 	}
 
 	PerformScheduledTasks(deltaD);
+	Game_FlushBlockChanges();
+	if (FlyBench_Running) FlyBench_Update();
+	Game_LatchMouse();
+
 	entTask = tasks[entTaskI];
 	t = (float)(entTask.accumulator / entTask.interval);
 	LocalPlayer_SetInterpPosition(Entities.CurPlayer, t);
@@ -808,7 +2125,10 @@ static CC_INLINE void Game_RenderFrame(void) {
 
 	/* TODO: Not calling Gfx_EndFrame doesn't work with Direct3D9 */
 	if (Window_Main.Inactive) return;
+	FrameProfiler_Begin();
+	DynRes_BeginFrame(delta);
 	Gfx_ClearBuffers(GFX_BUFFER_COLOR | GFX_BUFFER_DEPTH);
+	firstView = true;
 	
 #ifdef CC_BUILD_SPLITSCREEN
 	switch (Game_NumStates) {
@@ -833,9 +2153,14 @@ static CC_INLINE void Game_RenderFrame(void) {
 #else
 	Game_DrawFrame(delta, t);
 #endif
+	FrameProfiler_End();
+	DynRes_EndFrame();
+	FlyBench_EndFrame(delta);
+	CrowdBench_EndFrame(delta);
 
 	if (Game_ScreenshotRequested) Game_TakeScreenshot();
 	Gfx_EndFrame();
+	Startup_EndFrame();
 	if (gfx_minFrameMs) LimitFPS();
 }
 
@@ -847,6 +2172,8 @@ static void Game_Free(void) {
 	Gfx.ManagedTextures = false;
 	Event_UnregisterAll();
 	tasksCount = 0;
+	/* Callbacks may still rely on other components, so must complete before they're freed */
+	Stream_FinishFileOps();
 
 	for (comp = comps_head; comp; comp = comp->next)
 	{
@@ -855,6 +2182,8 @@ static void Game_Free(void) {
 
 	gameRunning     = false;
 	Logger_WarnFunc = Logger_DialogWarn;
+	Game_FreeScratchMem();
+	BitmapPool_Free();
 	Gfx_Free();
 	Options_SaveIfChanged();
 	Window_DisableRawMouse();
@@ -863,7 +2192,9 @@ static void Game_Free(void) {
 #ifdef CC_BUILD_WEB
 void Game_DoFrame(void) {
 	if (gameRunning) {
+		Tracer_Begin("Game_RenderFrame");
 		Game_RenderFrame();
+		Tracer_End();
 	} else if (tasksCount) {
 		Game_Free();
 		Window_Free();
@@ -892,7 +2223,9 @@ cc_bool Game_ShouldClose(void) {
 static void Game_RunLoop(void) {
 	while (gameRunning)
 	{
+		Tracer_Begin("Game_RenderFrame");
 		Game_RenderFrame();
+		Tracer_End();
 	}
 	Game_Free();
 }
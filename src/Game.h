@@ -108,6 +108,12 @@ CC_API void Game_UpdateBlock(int x, int y, int z, BlockID block);
 /* Calls Game_UpdateBlock, then informs server connection of the block change. */
 /* In multiplayer this is sent to the server, in singleplayer just activates physics. */
 CC_API void Game_ChangeBlock(int x, int y, int z, BlockID block);
+/* Starts a bulk edit of the world, during which Game_UpdateBlock only records the region of changed blocks. */
+/* Lighting and chunk meshes are then updated once for the whole changed region in Game_EndBlockEdit. */
+/* NOTE: Edits can be nested, with the region only being updated once the outermost edit ends. */
+CC_API void Game_BeginBlockEdit(void);
+/* Ends a bulk edit started by Game_BeginBlockEdit. */
+CC_API void Game_EndBlockEdit(void);
 
 cc_bool Game_CanPick(BlockID block);
 /* Updates Game_Width and Game_Height. */
@@ -149,6 +155,8 @@ struct IGameComponent {
 };
 /* Adds a component to linked list of components. (always at end) */
 CC_NOINLINE void Game_AddComponent(struct IGameComponent* comp);
+/* Returns the name of the given component, or the filename of the plugin it was loaded from */
+const char* Game_ComponentName(struct IGameComponent* comp);
 
 /* Represents a task that periodically runs on the main thread every specified interval. */
 struct ScheduledTask;
@@ -165,5 +173,84 @@ typedef void (*ScheduledTaskCallback)(struct ScheduledTask* task);
 /* Adds a task to list of scheduled tasks. (always at end) */
 CC_API int ScheduledTask_Add(double interval, ScheduledTaskCallback callback);
 
+/* Consecutive groups of rendering work in a frame, which are timed separately by the frame profiler */
+enum FramePass {
+	FRAMEPASS_ENTITIES, FRAMEPASS_PARTICLES, FRAMEPASS_SKY, FRAMEPASS_MAP, FRAMEPASS_SHADOWS,
+	FRAMEPASS_TRANSLUCENT, FRAMEPASS_SELECTIONS, FRAMEPASS_UI, FRAMEPASS_COUNT
+};
+extern const char* const FramePass_Names[FRAMEPASS_COUNT];
+/* Colour code used to draw each pass in the profiler graph */
+extern const char FramePass_Colors[FRAMEPASS_COUNT];
+
+/* Number of frames the frame profiler keeps timings for */
+#define FRAMEPROFILER_HISTORY 120
+struct FrameProfile {
+	float cpuMS[FRAMEPASS_COUNT]; /* Main thread time spent issuing each pass */
+	float gpuMS[FRAMEPASS_COUNT]; /* GPU time spent executing each pass (0 if unsupported) */
+	int statesApplied, statesSkipped, drawCalls; /* See struct GfxStateCounts */
+};
+/* NOTE: GPU timings only become available a few frames later, so are stored in a later frame's entry */
+extern struct FrameProfile FrameProfiler_History[FRAMEPROFILER_HISTORY];
+/* Index of the entry in FrameProfiler_History the next frame will be stored in */
+extern int FrameProfiler_Next;
+/* Whether render passes are currently being timed */
+extern cc_bool FrameProfiler_Enabled;
+/* Whether a graph of pass timings is drawn over the game */
+extern cc_bool FrameProfiler_ShowGraph;
+
+void FrameProfiler_SetEnabled(cc_bool enabled);
+/* Writes timings of the frames in FrameProfiler_History to the given file in CSV format */
+cc_result FrameProfiler_Dump(const cc_string* path);
+
+/* Whether the camera is currently being flown along a path by the fly-through benchmark */
+extern cc_bool FlyBench_Running;
+/* Loads a camera path from the given file, then starts flying the local player along it */
+/* Once the end of the path is reached, percentiles of frame timings are saved to the output file */
+cc_result FlyBench_Start(const cc_string* path, const cc_string* output);
+/* Stops the fly-through benchmark early, without saving any results */
+void FlyBench_Stop(void);
+
+/* Whether synthetic players are currently being spawned and timed by the crowd benchmark */
+extern cc_bool CrowdBench_Running;
+/* Spawns increasing numbers of players moving around the local player, timing entity ticking and rendering */
+/* Once every number of players has been measured, the average timings are saved to the output file */
+void CrowdBench_Start(const cc_string* output);
+/* Stops the crowd benchmark early and removes its players, without saving any results */
+void CrowdBench_Stop(void);
+
+/* Time spent on a step of starting the game (e.g. initialising a component) */
+struct StartupStep { const char* name; cc_uint32 micros; };
+/* Sets steps to the startup steps timed so far, and returns how many there are */
+/* NOTE: The last step is time to first frame if the first frame has been rendered */
+int Game_GetStartupSteps(const struct StartupStep** steps);
+
+typedef void (*Game_DeferredTask)(void);
+/* Runs a task once the first frame has been rendered, so that it doesn't delay startup */
+/* NOTE: Only one deferred task is run per frame, in the order they were deferred */
+CC_API void Game_DeferTask(Game_DeferredTask task, const char* name);
+
+/* Allocates temporary memory from a buffer that is reused every frame, avoiding heap allocations. */
+/* Returns NULL if there isn't enough scratch memory left, in which case use Mem_Alloc instead. */
+/* NOTE: The memory is only valid until the start of the next frame */
+/* NOTE: If more scratch memory was needed than was available, the buffer is grown for later frames */
+void* Game_AllocScratch(cc_uint32 numElems, cc_uint32 elemsSize);
+/* Releases memory allocated by Game_AllocScratch, returning false if it wasn't scratch memory. */
+/* NOTE: Only the most recent allocation is actually reused before the next frame */
+cc_bool Game_FreeScratch(void* ptr);
+
+/* Whether begin/end scopes are currently being recorded by the event tracer */
+extern cc_bool Tracer_Enabled;
+/* Records the start of a named scope on the calling thread */
+/* NOTE: Only the pointer is stored, so name must be a string constant */
+void Tracer_Begin(const char* name);
+/* Records the end of the most recently started scope on the calling thread */
+void Tracer_End(void);
+/* Discards any previously recorded events, then starts recording scopes on all threads */
+/* Returns ERR_NOT_SUPPORTED when the platform lacks thread local storage */
+cc_result Tracer_Start(void);
+/* Stops recording scopes, then writes all recorded events to the given file */
+/*  in Chrome trace JSON format (can be opened in chrome://tracing or ui.perfetto.dev) */
+cc_result Tracer_Stop(const cc_string* path);
+
 CC_END_HEADER
 #endif
@@ -1,4 +1,9 @@
 #include "Generator.h"
+/* Noise must give exactly the same results as scalar float math, so not used with x87 float math */
+#if defined CC_BUILD_SSE2_MATH
+	#include <emmintrin.h>
+	#define NOISE_SSE2
+#endif
 #include "BlockID.h"
 #include "ExtMath.h"
 #include "Funcs.h"
@@ -7,6 +12,7 @@
 #include "Utils.h"
 #include "Game.h"
 #include "Window.h"
+#include "Options.h"
 
 const struct MapGenerator* Gen_Active;
 BlockRaw* Gen_Blocks;
@@ -15,6 +21,10 @@ int Gen_Seed;
 volatile float Gen_CurrentProgress;
 volatile const char* Gen_CurrentState;
 volatile cc_bool gen_done;
+#ifdef CC_BUILD_BUILDERTHREADS
+#define GEN_MAX_THREADS 16
+static int gen_threads;
+#endif
 
 /* There are two main types of multitasking: */
 /*  - Pre-emptive multitasking (system automatically switches between threads) */
@@ -65,7 +75,9 @@ cc_bool Gen_IsDone(void) {
 #define GEN_COOP_END
 
 static void Gen_DoGen(void) {
+	Tracer_Begin("Gen_DoGen");
 	Gen_Active->Generate();
+	Tracer_End();
 }
 
 static void Gen_Run(void) {
@@ -85,6 +97,9 @@ static void Gen_Reset(void) {
 
 void Gen_Start(void) {
 	Gen_Reset();
+#ifdef CC_BUILD_BUILDERTHREADS
+	gen_threads = Options_GetInt(OPT_GEN_THREADS, 0, GEN_MAX_THREADS, 3);
+#endif
 	Gen_Blocks = (BlockRaw*)Mem_TryAlloc(World.Volume, 1);
 
 	if (!Gen_Blocks || !Gen_Active->Prepare()) {
@@ -226,18 +241,192 @@ static void CombinedNoise_Init(struct CombinedNoise* n, RNGState* rnd, int octav
 	OctaveNoise_Init(&n->noise2, rnd, octaves2);
 }
 
-static float CombinedNoise_Calc(const struct CombinedNoise* n, float x, float y) {
-	float offset = OctaveNoise_Calc(&n->noise2, x, y);
-	return OctaveNoise_Calc(&n->noise1, x + offset, y);
+/* Maximum number of samples calculated by a single CalcRow call */
+#define NOISE_ROW_SIZE 256
+
+#ifdef NOISE_SSE2
+/* Calculates 4 samples of noise at once, using the same float operations as ImprovedNoise_Calc */
+static __m128 ImprovedNoise_Calc4(const cc_uint8* p, __m128 x, float y) {
+	int xFloors[4], gradX[4][4], gradY[4][4];
+	int yFloor, X, Y, A, B, hash, i;
+	__m128 u, v, yv, yv1, x1;
+	__m128 g22, g12, c1, g21, g11, c2;
+	__m128i xFloor;
+
+	/* xFloor = x >= 0 ? (int)x : (int)x - 1 */
+	xFloor = _mm_cvttps_epi32(x);
+	xFloor = _mm_add_epi32(xFloor, _mm_castps_si128(_mm_cmplt_ps(x, _mm_setzero_ps())));
+	_mm_storeu_si128((__m128i*)xFloors, xFloor);
+
+	yFloor = y >= 0 ? (int)y : (int)y - 1;
+	Y = yFloor & 0xFF;
+	x = _mm_sub_ps(x, _mm_cvtepi32_ps(xFloor));
+	y -= yFloor;
+
+	/* Fade(x) */
+	u = _mm_mul_ps(_mm_mul_ps(_mm_mul_ps(x, x), x),
+		_mm_add_ps(_mm_mul_ps(x, _mm_sub_ps(_mm_mul_ps(x, _mm_set1_ps(6.0f)), _mm_set1_ps(15.0f))), _mm_set1_ps(10.0f)));
+	v = _mm_set1_ps(y * y * y * (y * (y * 6 - 15) + 10)); /* Fade(y) */
+
+	/* Table lookups can't be vectorised with SSE2, so work out the gradient of each lane separately */
+	for (i = 0; i < 4; i++) {
+		X = xFloors[i] & 0xFF;
+		A = p[X] + Y; B = p[X + 1] + Y;
+
+		hash = (p[p[A]] & 0xF) << 1;
+		gradX[0][i] = ((X_FLAGS >> hash) & 3) - 1; gradY[0][i] = ((Y_FLAGS >> hash) & 3) - 1;
+		hash = (p[p[B]] & 0xF) << 1;
+		gradX[1][i] = ((X_FLAGS >> hash) & 3) - 1; gradY[1][i] = ((Y_FLAGS >> hash) & 3) - 1;
+		hash = (p[p[A + 1]] & 0xF) << 1;
+		gradX[2][i] = ((X_FLAGS >> hash) & 3) - 1; gradY[2][i] = ((Y_FLAGS >> hash) & 3) - 1;
+		hash = (p[p[B + 1]] & 0xF) << 1;
+		gradX[3][i] = ((X_FLAGS >> hash) & 3) - 1; gradY[3][i] = ((Y_FLAGS >> hash) & 3) - 1;
+	}
+
+#define Grad4(k, x, y) _mm_add_ps( \
+		_mm_mul_ps(_mm_cvtepi32_ps(_mm_loadu_si128((const __m128i*)gradX[k])), x), \
+		_mm_mul_ps(_mm_cvtepi32_ps(_mm_loadu_si128((const __m128i*)gradY[k])), y))
+
+	x1  = _mm_sub_ps(x, _mm_set1_ps(1.0f));
+	yv  = _mm_set1_ps(y);
+	yv1 = _mm_set1_ps(y - 1);
+
+	g22 = Grad4(0, x,  yv);
+	g12 = Grad4(1, x1, yv);
+	c1  = _mm_add_ps(g22, _mm_mul_ps(u, _mm_sub_ps(g12, g22)));
+
+	g21 = Grad4(2, x,  yv1);
+	g11 = Grad4(3, x1, yv1);
+	c2  = _mm_add_ps(g21, _mm_mul_ps(u, _mm_sub_ps(g11, g21)));
+
+	return _mm_add_ps(c1, _mm_mul_ps(v, _mm_sub_ps(c2, c1)));
+}
+
+static __m128 OctaveNoise_Calc4(const struct OctaveNoise* n, __m128 x, float y) {
+	float amplitude = 1, freq = 1;
+	__m128 sum = _mm_setzero_ps();
+	int i;
+
+	for (i = 0; i < n->octaves; i++) {
+		sum = _mm_add_ps(sum, _mm_mul_ps(ImprovedNoise_Calc4(n->p[i], _mm_mul_ps(x, _mm_set1_ps(freq)), y * freq), 
+										_mm_set1_ps(amplitude)));
+		amplitude *= 2.0f;
+		freq *= 0.5f;
+	}
+	return sum;
+}
+#endif
+
+/* Sets the x coordinates of a row of samples starting at the given x */
+static void Noise_RowCoords(float* xs, int x, int count, float scale) {
+	int i;
+	for (i = 0; i < count; i++) { xs[i] = (x + i) * scale; }
+}
+
+/* Calculates noise for each of the given x coordinates in a row */
+static void OctaveNoise_CalcRow(const struct OctaveNoise* n, const float* xs, float y, float* out, int count) {
+	int i = 0;
+#ifdef NOISE_SSE2
+	for (; i + 4 <= count; i += 4) {
+		_mm_storeu_ps(out + i, OctaveNoise_Calc4(n, _mm_loadu_ps(xs + i), y));
+	}
+#endif
+	for (; i < count; i++) {
+		out[i] = OctaveNoise_Calc(n, xs[i], y);
+	}
+}
+
+/* Calculates noise for each of the given x coordinates in a row */
+/* NOTE: count must not be greater than NOISE_ROW_SIZE */
+static void CombinedNoise_CalcRow(const struct CombinedNoise* n, const float* xs, float y, float* out, int count) {
+	float offsets[NOISE_ROW_SIZE];
+	int i;
+
+	OctaveNoise_CalcRow(&n->noise2, xs, y, offsets, count);
+	for (i = 0; i < count; i++) { offsets[i] += xs[i]; }
+	OctaveNoise_CalcRow(&n->noise1, offsets, y, out, count);
 }
 
 
+/*########################################################################################################################*
+*------------------------------------------------------Parallel gen-------------------------------------------------------*
+*#########################################################################################################################*/
+/* Stages where each row is generated independently of the others can be split into bands of rows, */
+/*  which are then generated across the map gen thread and some helper threads */
+/* NOTE: Bands must only write to their own rows, and not use the shared RNG state */
+typedef void (*Gen_BandFunc)(int beg, int end);
+#define GEN_BAND_ROWS 16
+
+#ifdef CC_BUILD_BUILDERTHREADS
+static Gen_BandFunc gen_bandFunc;
+static int gen_nextRow, gen_rowsCount, gen_rowsDone;
+static void* gen_mutex;
+
+static void Gen_RunBands(void) {
+	int beg, end;
+
+	for (;;) {
+		Mutex_Lock(gen_mutex);
+		beg = gen_nextRow;
+		gen_nextRow += GEN_BAND_ROWS;
+		Mutex_Unlock(gen_mutex);
+
+		if (beg >= gen_rowsCount) return;
+		end = min(beg + GEN_BAND_ROWS, gen_rowsCount);
+		gen_bandFunc(beg, end);
+
+		Mutex_Lock(gen_mutex);
+		gen_rowsDone += end - beg;
+		Gen_CurrentProgress = (float)gen_rowsDone / gen_rowsCount;
+		Mutex_Unlock(gen_mutex);
+	}
+}
+
+/* Generates the given number of rows, split across multiple threads */
+static void Gen_ForEachBand(Gen_BandFunc func, int rows) {
+	void* threads[GEN_MAX_THREADS];
+	int i, count = min(gen_threads, (rows - 1) / GEN_BAND_ROWS);
+
+	gen_bandFunc  = func;
+	gen_nextRow   = 0;
+	gen_rowsCount = rows;
+	gen_rowsDone  = 0;
+	if (count <= 0) { func(0, rows); return; }
+
+	gen_mutex = Mutex_Create("Gen bands");
+	for (i = 0; i < count; i++) {
+		Thread_Run(&threads[i], Gen_RunBands, 128 * 1024, "Map gen helper");
+	}
+	Gen_RunBands();
+
+	for (i = 0; i < count; i++) {
+		Thread_Join(threads[i]);
+	}
+	Mutex_Free(gen_mutex);
+	gen_mutex = NULL;
+}
+#else
+static void Gen_ForEachBand(Gen_BandFunc func, int rows) {
+	int beg, end;
+
+	for (beg = 0; beg < rows; beg += GEN_BAND_ROWS) {
+		end = min(beg + GEN_BAND_ROWS, rows);
+		func(beg, end);
+		Gen_CurrentProgress = (float)end / rows;
+	}
+}
+#endif
+
+
 /*########################################################################################################################*
 *----------------------------------------------------Notchy map gen-------------------------------------------------------*
 *#########################################################################################################################*/
-static int waterLevel, minHeight;
+static int waterLevel, minHeight, minStoneY;
 static cc_int16* heightmap;
 static RNGState rnd;
+/* Noise used by stages that are generated in parallel */
+static struct CombinedNoise gen_noise1, gen_noise2;
+static struct OctaveNoise gen_noise3, gen_noise4;
 
 static void NotchyGen_FillOblateSpheroid(int x, int y, int z, float radius, BlockRaw block) {
 	int xBeg = Math_Floor(max(x - radius, 0));
@@ -266,121 +455,155 @@ static void NotchyGen_FillOblateSpheroid(int x, int y, int z, float radius, Bloc
 }
 
 #define STACK_FAST 8192
+/* Indices of the blocks that flood filling still needs to start new runs from */
+struct FloodStack { int* seeds; int count, limit; };
+
+/* Adds a seed for the first block of each run of air in the given row between x1 and x2 */
+static void NotchyGen_AddSeeds(struct FloodStack* s, int row, int x1, int x2) {
+	int x;
+	for (x = x1; x <= x2; x++) {
+		if (Gen_Blocks[row + x] != BLOCK_AIR) continue;
+
+		if (s->count == s->limit) {
+			Utils_Resize((void**)&s->seeds, &s->limit, 4, STACK_FAST, STACK_FAST);
+		}
+		s->seeds[s->count++] = row + x;
+
+		/* Rest of the run gets filled when the seed is */
+		while (x < x2 && Gen_Blocks[row + x + 1] == BLOCK_AIR) x++;
+	}
+}
+
+/* Fills whole runs of air along the X axis at once, only adding seeds for the runs */
+/*  next to them below and along the Z axis (rather than one entry for every block) */
 static void NotchyGen_FloodFill(int index, BlockRaw block) {
-	int* stack;
 	int stack_default[STACK_FAST]; /* avoid allocating memory if possible */
-	int count = 0, limit = STACK_FAST;
-	int x, y, z;
+	struct FloodStack s;
+	int x, y, z, x1, x2, row;
 
-	stack = stack_default;
 	if (index < 0) return; /* y below map, don't bother starting */
-	stack[count++] = index;
-
-	while (count) {
-		index = stack[--count];
+	s.seeds = stack_default;
+	s.limit = STACK_FAST;
+	s.count = 0;
+	s.seeds[s.count++] = index;
 
+	while (s.count) {
+		index = s.seeds[--s.count];
 		if (Gen_Blocks[index] != BLOCK_AIR) continue;
-		Gen_Blocks[index] = block;
 
-		x = index  % World.Width;
-		y = index  / World.OneY;
-		z = (index / World.Width) % World.Length;
+		x   = index  % World.Width;
+		y   = index  / World.OneY;
+		z   = (index / World.Width) % World.Length;
+		row = index - x;
 
-		/* need to increase stack */
-		if (count >= limit - FACE_COUNT) {
-			Utils_Resize((void**)&stack, &limit, 4, STACK_FAST, STACK_FAST);
-		}
+		x1 = x; while (x1 > 0          && Gen_Blocks[row + x1 - 1] == BLOCK_AIR) x1--;
+		x2 = x; while (x2 < World.MaxX && Gen_Blocks[row + x2 + 1] == BLOCK_AIR) x2++;
+		Mem_Set(Gen_Blocks + row + x1, block, x2 - x1 + 1);
 
-		if (x > 0)          { stack[count++] = index - 1; }
-		if (x < World.MaxX) { stack[count++] = index + 1; }
-		if (z > 0)          { stack[count++] = index - World.Width; }
-		if (z < World.MaxZ) { stack[count++] = index + World.Width; }
-		if (y > 0)          { stack[count++] = index - World.OneY; }
+		if (z > 0)          NotchyGen_AddSeeds(&s, row - World.Width, x1, x2);
+		if (z < World.MaxZ) NotchyGen_AddSeeds(&s, row + World.Width, x1, x2);
+		if (y > 0)          NotchyGen_AddSeeds(&s, row - World.OneY,  x1, x2);
 	}
-	if (limit > STACK_FAST) Mem_Free(stack);
+	if (s.limit > STACK_FAST) Mem_Free(s.seeds);
 }
 
 
-static void NotchyGen_CreateHeightmap(void) {
+static void NotchyGen_HeightmapRows(int zBeg, int zEnd) {
+	float xs[NOISE_ROW_SIZE], scaledXs[NOISE_ROW_SIZE];
+	float lows[NOISE_ROW_SIZE], highs[NOISE_ROW_SIZE], selects[NOISE_ROW_SIZE];
 	float hLow, hHigh, height;
-	int hIndex = 0, adjHeight;
-	int x, z;
-	struct CombinedNoise n1, n2;
-	struct OctaveNoise n3;
+	int hIndex = zBeg * World.Width;
+	int x, z, i, count;
+
+	for (z = zBeg; z < zEnd; z++) {
+		for (x = 0; x < World.Width; x += NOISE_ROW_SIZE) {
+			count = min(NOISE_ROW_SIZE, World.Width - x);
+			Noise_RowCoords(xs,       x, count, 1.0f);
+			Noise_RowCoords(scaledXs, x, count, 1.3f);
+
+			/* High noise is calculated for every column, as that's cheaper than only for some of them */
+			CombinedNoise_CalcRow(&gen_noise1, scaledXs, z * 1.3f, lows,  count);
+			CombinedNoise_CalcRow(&gen_noise2, scaledXs, z * 1.3f, highs, count);
+			OctaveNoise_CalcRow(&gen_noise3,   xs,       (float)z, selects, count);
+
+			for (i = 0; i < count; i++) {
+				hLow   = lows[i] / 6 - 4;
+				height = hLow;
+
+				if (selects[i] <= 0) {
+					hHigh  = highs[i] / 5 + 6;
+					height = max(hLow, hHigh);
+				}
 
-	CombinedNoise_Init(&n1, &rnd, 8, 8);
-	CombinedNoise_Init(&n2, &rnd, 8, 8);	
-	OctaveNoise_Init(&n3, &rnd, 6);
+				height *= 0.5f;
+				if (height < 0) height *= 0.8f;
 
-	Gen_CurrentState = "Building heightmap";
-	for (z = 0; z < World.Length; z++) {
-		Gen_CurrentProgress = (float)z / World.Length;
+				heightmap[hIndex++] = (int)(height + waterLevel);
+			}
+		}
+	}
+}
 
-		for (x = 0; x < World.Width; x++) {
-			hLow   = CombinedNoise_Calc(&n1, x * 1.3f, z * 1.3f) / 6 - 4;
-			height = hLow;
+static void NotchyGen_CreateHeightmap(void) {
+	int i, count = World.Width * World.Length;
 
-			if (OctaveNoise_Calc(&n3, (float)x, (float)z) <= 0) {
-				hHigh = CombinedNoise_Calc(&n2, x * 1.3f, z * 1.3f) / 5 + 6;
-				height = max(hLow, hHigh);
-			}
+	CombinedNoise_Init(&gen_noise1, &rnd, 8, 8);
+	CombinedNoise_Init(&gen_noise2, &rnd, 8, 8);
+	OctaveNoise_Init(&gen_noise3, &rnd, 6);
 
-			height *= 0.5f;
-			if (height < 0) height *= 0.8f;
+	Gen_CurrentState = "Building heightmap";
+	Gen_ForEachBand(NotchyGen_HeightmapRows, World.Length);
 
-			adjHeight = (int)(height + waterLevel);
-			minHeight = min(adjHeight, minHeight);
-			heightmap[hIndex++] = adjHeight;
-		}
+	for (i = 0; i < count; i++) {
+		minHeight = min(heightmap[i], minHeight);
 	}
 }
 
-static int NotchyGen_CreateStrataFast(void) {
+static void NotchyGen_FillLayers(int yBeg, int yEnd) {
 	cc_uint32 oneY = (cc_uint32)World.OneY;
-	int stoneHeight, airHeight;
+	/* Invariant: the lowest value dirtThickness can possible be is -14 */
+	int stoneHeight = minHeight - 14;
 	int y;
 
-	Gen_CurrentProgress = 0.0f;
-	Gen_CurrentState    = "Filling map";
-	/* Make lava layer at bottom */
-	Mem_Set(Gen_Blocks, BLOCK_STILL_LAVA, oneY);
-
-	/* Invariant: the lowest value dirtThickness can possible be is -14 */
-	stoneHeight = minHeight - 14;
-	/* We can quickly fill in bottom solid layers */
-	for (y = 1; y <= stoneHeight; y++) {
-		Mem_Set(Gen_Blocks + y * oneY, BLOCK_STONE, oneY);
-		Gen_CurrentProgress = (float)y / World.Height;
+	for (y = yBeg; y < yEnd; y++) {
+		if (y == 0) {
+			/* Make lava layer at bottom */
+			Mem_Set(Gen_Blocks, BLOCK_STILL_LAVA, oneY);
+		} else if (y <= stoneHeight) {
+			/* We can quickly fill in bottom solid layers */
+			Mem_Set(Gen_Blocks + y * oneY, BLOCK_STONE, oneY);
+		} else {
+			/* Fill in rest of map wih air */
+			Mem_Set(Gen_Blocks + y * oneY, BLOCK_AIR, oneY);
+		}
 	}
+}
 
-	/* Fill in rest of map wih air */
-	airHeight = max(0, stoneHeight) + 1;
-	for (y = airHeight; y < World.Height; y++) {
-		Mem_Set(Gen_Blocks + y * oneY, BLOCK_AIR, oneY);
-		Gen_CurrentProgress = (float)y / World.Height;
-	}
+static int NotchyGen_CreateStrataFast(void) {
+	Gen_CurrentProgress = 0.0f;
+	Gen_CurrentState    = "Filling map";
+	Gen_ForEachBand(NotchyGen_FillLayers, World.Height);
 
 	/* if stoneHeight is <= 0, then no layer is fully stone */
-	return max(stoneHeight, 1);
+	return max(minHeight - 14, 1);
 }
 
-static void NotchyGen_CreateStrata(void) {
-	int dirtThickness, dirtHeight;
-	int minStoneY, stoneHeight;
-	int hIndex = 0, maxY = World.MaxY, index = 0;
-	int x, y, z;
-	struct OctaveNoise n;
-
-	/* Try to bulk fill bottom of the map if possible */
-	minStoneY = NotchyGen_CreateStrataFast();
-	OctaveNoise_Init(&n, &rnd, 8);
-
-	Gen_CurrentState = "Creating strata";
-	for (z = 0; z < World.Length; z++) {
-		Gen_CurrentProgress = (float)z / World.Length;
+static void NotchyGen_StrataRows(int zBeg, int zEnd) {
+	float xs[NOISE_ROW_SIZE], thicknesses[NOISE_ROW_SIZE];
+	int dirtThickness, dirtHeight, stoneHeight;
+	int hIndex = zBeg * World.Width, maxY = World.MaxY, index = 0;
+	int x, y, z, i, count;
+
+	for (z = zBeg; z < zEnd; z++) {
+		for (x = 0, i = 0, count = 0; x < World.Width; x++, i++) {
+			if (i == count) {
+				i     = 0;
+				count = min(NOISE_ROW_SIZE, World.Width - x);
+				Noise_RowCoords(xs, x, count, 1.0f);
+				OctaveNoise_CalcRow(&gen_noise3, xs, (float)z, thicknesses, count);
+			}
 
-		for (x = 0; x < World.Width; x++) {
-			dirtThickness = (int)(OctaveNoise_Calc(&n, (float)x, (float)z) / 24 - 4);
+			dirtThickness = (int)(thicknesses[i] / 24 - 4);
 			dirtHeight    = heightmap[hIndex++];
 			stoneHeight   = dirtHeight + dirtThickness;
 
@@ -401,6 +624,15 @@ static void NotchyGen_CreateStrata(void) {
 	}
 }
 
+static void NotchyGen_CreateStrata(void) {
+	/* Try to bulk fill bottom of the map if possible */
+	minStoneY = NotchyGen_CreateStrataFast();
+	OctaveNoise_Init(&gen_noise3, &rnd, 8);
+
+	Gen_CurrentState = "Creating strata";
+	Gen_ForEachBand(NotchyGen_StrataRows, World.Length);
+}
+
 static void NotchyGen_CarveCaves(void) {
 	int cavesCount, caveLen;
 	float caveX, caveY, caveZ;
@@ -541,20 +773,22 @@ static void NotchyGen_FloodFillLava(void) {
 	}
 }
 
-static void NotchyGen_CreateSurfaceLayer(void) {	
-	int hIndex = 0, index;
+static void NotchyGen_SurfaceRows(int zBeg, int zEnd) {
+	float xs[NOISE_ROW_SIZE], sands[NOISE_ROW_SIZE], gravels[NOISE_ROW_SIZE];
+	int hIndex = zBeg * World.Width, index;
 	BlockRaw above;
-	int x, y, z;
-	struct OctaveNoise n1, n2;
-
-	OctaveNoise_Init(&n1, &rnd, 8);
-	OctaveNoise_Init(&n2, &rnd, 8);
-
-	Gen_CurrentState = "Creating surface";
-	for (z = 0; z < World.Length; z++) {
-		Gen_CurrentProgress = (float)z / World.Length;
+	int x, y, z, i, count;
+
+	for (z = zBeg; z < zEnd; z++) {
+		for (x = 0, i = 0, count = 0; x < World.Width; x++, i++) {
+			if (i == count) {
+				i     = 0;
+				count = min(NOISE_ROW_SIZE, World.Width - x);
+				Noise_RowCoords(xs, x, count, 1.0f);
+				OctaveNoise_CalcRow(&gen_noise3, xs, (float)z, sands,   count);
+				OctaveNoise_CalcRow(&gen_noise4, xs, (float)z, gravels, count);
+			}
 
-		for (x = 0; x < World.Width; x++) {
 			y = heightmap[hIndex++];
 			if (y < 0 || y >= World.Height) continue;
 
@@ -562,15 +796,23 @@ static void NotchyGen_CreateSurfaceLayer(void) {
 			above = y >= World.MaxY ? BLOCK_AIR : Gen_Blocks[index + World.OneY];
 
 			/* TODO: update heightmap */
-			if (above == BLOCK_STILL_WATER && (OctaveNoise_Calc(&n2, (float)x, (float)z) > 12)) {
+			if (above == BLOCK_STILL_WATER && (gravels[i] > 12)) {
 				Gen_Blocks[index] = BLOCK_GRAVEL;
 			} else if (above == BLOCK_AIR) {
-				Gen_Blocks[index] = (y <= waterLevel && (OctaveNoise_Calc(&n1, (float)x, (float)z) > 8)) ? BLOCK_SAND : BLOCK_GRASS;
+				Gen_Blocks[index] = (y <= waterLevel && (sands[i] > 8)) ? BLOCK_SAND : BLOCK_GRASS;
 			}
 		}
 	}
 }
 
+static void NotchyGen_CreateSurfaceLayer(void) {
+	OctaveNoise_Init(&gen_noise3, &rnd, 8);
+	OctaveNoise_Init(&gen_noise4, &rnd, 8);
+
+	Gen_CurrentState = "Creating surface";
+	Gen_ForEachBand(NotchyGen_SurfaceRows, World.Length);
+}
+
 static void NotchyGen_PlantFlowers(void) {
 	int numPatches;
 	BlockRaw block;
@@ -702,6 +944,12 @@ static cc_bool NotchyGen_Prepare(void) {
 	return heightmap != NULL;
 }
 
+/* NOTE: Stages can't be run for just a region of the map, as many of them depend on the whole map: */
+/*  - Caves, ore veins and flowers etc start at random positions anywhere in the map, */
+/*     and must be placed in the same order to consume the shared RNG state in the same order */
+/*  - Flood filling water and lava can spread from a random position to anywhere in the map */
+/*  - Strata generation uses the lowest height of the whole heightmap */
+/* So the map can only be handed over to World once every stage has completed */
 static void NotchyGen_Generate(void) {
 	GEN_COOP_BEGIN
 		GEN_COOP_STEP( 0, NotchyGen_CreateHeightmap() );
@@ -737,6 +985,12 @@ const struct MapGenerator NotchyGen = {
 *#########################################################################################################################*/
 BlockRaw* Tree_Blocks;
 RNGState* Tree_Rnd;
+#ifdef CC_BUILD_PALETTEWORLD
+/* Tree_Blocks is only set when generating a map, otherwise the world's blocks are checked */
+#define Tree_GetBlock(index) (Tree_Blocks ? Tree_Blocks[index] : World_GetRawBlock(index))
+#else
+#define Tree_GetBlock(index) Tree_Blocks[index]
+#endif
 
 cc_bool TreeGen_CanGrow(int treeX, int treeY, int treeZ, int treeHeight) {
 	int baseHeight = treeHeight - 4;
@@ -750,7 +1004,7 @@ cc_bool TreeGen_CanGrow(int treeX, int treeY, int treeZ, int treeHeight) {
 
 				if (!World_Contains(x, y, z)) return false;
 				index = World_Pack(x, y, z);
-				if (Tree_Blocks[index] != BLOCK_AIR) return false;
+				if (Tree_GetBlock(index) != BLOCK_AIR) return false;
 			}
 		}
 	}
@@ -762,7 +1016,7 @@ cc_bool TreeGen_CanGrow(int treeX, int treeY, int treeZ, int treeHeight) {
 
 				if (!World_Contains(x, y, z)) return false;
 				index = World_Pack(x, y, z);
-				if (Tree_Blocks[index] != BLOCK_AIR) return false;
+				if (Tree_GetBlock(index) != BLOCK_AIR) return false;
 			}
 		}
 	}
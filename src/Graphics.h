@@ -28,11 +28,22 @@ struct MenuOptionsScreen;
 extern struct IGameComponent Gfx_Component;
 
 typedef enum VertexFormat_ {
-	VERTEX_FORMAT_COLOURED, VERTEX_FORMAT_TEXTURED
+	VERTEX_FORMAT_COLOURED, VERTEX_FORMAT_TEXTURED, VERTEX_FORMAT_CHUNK
 } VertexFormat;
 
 #define SIZEOF_VERTEX_COLOURED 16
 #define SIZEOF_VERTEX_TEXTURED 24
+#define SIZEOF_VERTEX_CHUNK    16
+
+/* Compact vertex format for chunk meshes, only supported when Gfx.SupportsChunkVertices is true */
+/* Positions are relative to the chunk origin, in units of 1/CHUNKVERTEX_POS_SCALE of a block */
+/* Texture coordinates are in units of 1/CHUNKVERTEX_U_SCALE and 1/CHUNKVERTEX_V_SCALE */
+/* NOTE: V must lie between 0 and 1 (i.e. 1D atlas has more than one tile) */
+/* layer is the index of the texture array layer, if Gfx.SupportsTextureArrays is true (otherwise unused) */
+struct VertexChunk { cc_int16 x, y, z, layer; cc_int16 U, V; PackedCol Col; };
+#define CHUNKVERTEX_POS_SCALE 256.0f
+#define CHUNKVERTEX_U_SCALE   1024.0f
+#define CHUNKVERTEX_V_SCALE   16384.0f
 
 #if defined CC_BUILD_PSP
 /* 3 floats for position (XYZ), 4 bytes for colour */
@@ -72,7 +83,10 @@ CC_VAR extern struct _GfxData {
 	cc_bool Limitations;
 	/* Type of the backend (e.g. OpenGL, Direct3D 9, etc)*/
 	cc_uint8 BackendType;
-	cc_bool __pad;
+	/* Whether the graphics backend supports VERTEX_FORMAT_CHUNK vertices */
+	cc_bool SupportsChunkVertices;
+	/* Whether the graphics backend applies Gfx_SetChunkLightColors to VERTEX_FORMAT_CHUNK vertices */
+	cc_bool SupportsChunkLightColors;
 	/* Maximum total size in pixels a low resolution texture can consist of */
 	/* NOTE: Not all graphics backends specify a value for this */
 	int MaxLowResTexSize;
@@ -83,6 +97,20 @@ CC_VAR extern struct _GfxData {
 	cc_uint8 ReducedPerfModeCooldown;
 	/* Default index buffer for a triangle list representing quads */
 	GfxResourceID DefaultIb;
+	/* Whether Gfx_CreateTextureArray is supported */
+	/* NOTE: VERTEX_FORMAT_CHUNK vertices are then drawn using the currently bound texture array */
+	cc_bool SupportsTextureArrays;
+	/* Whether the graphics backend can store textures in a GPU compressed format */
+	cc_bool SupportsCompressedTextures;
+	/* Whether textures created with TEXTURE_FLAG_COMPRESSED are stored compressed */
+	/* NOTE: Only has an effect if SupportsCompressedTextures is also true */
+	cc_bool CompressTextures;
+	/* Whether Gfx_SetModelParts is supported */
+	cc_bool SupportsModelParts;
+	/* Whether Gfx_DrawBillboards is supported */
+	cc_bool SupportsBillboards;
+	/* Whether Gfx_RecordTimestamp is supported */
+	cc_bool SupportsTimestamps;
 } Gfx;
 
 /* Whether the graphics backend supports U/V that don't occupy whole texture */
@@ -119,6 +147,9 @@ SUMMARY:
 #define TEXTURE_FLAG_LOWRES      0x08
 /* Texture should be rendered using bilinear filtering if possible */
 #define TEXTURE_FLAG_BILINEAR    0x10
+/* Texture can be stored in a lossy GPU compressed format to save video memory (if Gfx.CompressTextures) */
+/* NOTE: Gfx_UpdateTexture is then only applied to parts aligned to 4x4 pixel blocks */
+#define TEXTURE_FLAG_COMPRESSED  0x20
 
 cc_bool Gfx_CheckTextureSize(int width, int height, cc_uint8 flags);
 /* Creates a new texture. (and also generates mipmaps if mipmaps) */
@@ -136,6 +167,26 @@ CC_API void Gfx_UpdateTexturePart(GfxResourceID texId, int x, int y, struct Bitm
 void Gfx_UpdateTexture(GfxResourceID texId, int x, int y, struct Bitmap* part, int rowWidth, cc_bool mipmaps);
 /* Sets the currently active texture */
 CC_API void Gfx_BindTexture(GfxResourceID texId);
+
+/* Creates a new texture array, whose layers all have the same dimensions */
+/* NOTE: Contents of the layers are undefined until set using Gfx_UpdateTextureLayer */
+/* NOTE: Only supported when Gfx.SupportsTextureArrays is true */
+GfxResourceID Gfx_CreateTextureArray(int width, int height, int layers, cc_uint8 flags, cc_bool mipmaps);
+/* Updates a region of the given layer of a texture array. (and mipmapped regions if mipmaps) */
+/* NOTE: rowWidth is in pixels (so for normal bitmaps, rowWidth equals width) */
+void Gfx_UpdateTextureLayer(GfxResourceID texId, int layer, int x, int y, struct Bitmap* part, int rowWidth, cc_bool mipmaps);
+/* Sets the currently active texture array, used when drawing VERTEX_FORMAT_CHUNK vertices */
+void Gfx_BindTextureArray(GfxResourceID texId);
+/* Maximum number of texture array layers that Gfx_SetLayerOffsets can offset */
+#define GFX_MAX_LAYER_OFFSETS 32
+/* Sets how much the texture V coords of VERTEX_FORMAT_CHUNK vertices are offset by, */
+/*  for each texture array layer from first to first + count - 1 (e.g. to select an animation frame) */
+void Gfx_SetLayerOffsets(int first, const float* offsets, int count);
+/* Sets the sun and shadow light colours that VERTEX_FORMAT_CHUNK vertices are lit by */
+/* NOTE: The alpha of a vertex's colour selects its light (0 = shadow, 127 = sun, 255 = unlit), */
+/*  and so the RGB of the vertex's colour should only contain the tint and face shading */
+/* NOTE: Only supported when Gfx.SupportsChunkLightColors is true */
+void Gfx_SetChunkLightColors(PackedCol sun, PackedCol shadow);
 /* Deletes the given texture, then sets it to 0 */
 CC_API void Gfx_DeleteTexture(GfxResourceID* texId);
 
@@ -393,6 +444,54 @@ CC_API void Gfx_LoadMatrix(MatrixType type, const struct Matrix* matrix);
 CC_API void Gfx_EnableTextureOffset(float x, float y);
 /* Disables texture U/V translation */
 CC_API void Gfx_DisableTextureOffset(void);
+/* Maximum number of part matrices that Gfx_SetModelParts can use */
+#define GFX_MAX_MODEL_PARTS 16
+/* Makes VERTEX_FORMAT_TEXTURED vertices be transformed by the matrix of the model part they belong to, */
+/*  so that static model vertices can be animated without rebuilding them on the CPU */
+/* The R component of each vertex's colour is the index of its part, and G is the index of its colour in faceCols */
+/* Vertices with a B component of 255 are drawn fully bright instead, ignoring faceCols */
+/* Texture coordinates are multiplied by uScale/vScale, then offset by uOffset/vOffset */
+/* NOTE: Only supported when Gfx.SupportsModelParts is true */
+void Gfx_SetModelParts(const struct Matrix* parts, int count, const PackedCol* faceCols, 
+						float uScale, float vScale, float uOffset, float vOffset);
+/* Makes VERTEX_FORMAT_TEXTURED vertices be drawn normally again */
+void Gfx_DisableModelParts(void);
+
+/* Describes a square that always faces the camera */
+struct GfxBillboard {
+	float x, y, z;  /* Position of the middle of the bottom edge */
+	float size;     /* Width and height in world units */
+	PackedCol col;
+	float u1, v1, u2, v2;
+};
+/* Draws the given billboards with the currently bound texture, expanding each into a quad on the GPU */
+/* NOTE: Only supported when Gfx.SupportsBillboards is true */
+/* NOTE: This changes the bound vertex buffer */
+void Gfx_DrawBillboards(const struct GfxBillboard* items, int count);
+
+/* Maximum number of GPU timestamps that can be recorded per frame */
+#define GFX_MAX_TIMESTAMPS 16
+/* Number of frames that timestamps are kept around for, before they are overwritten */
+#define GFX_TIMESTAMP_FRAMES 3
+/* Starts recording a new set of GPU timestamps, overwriting the oldest set */
+/* NOTE: Only supported when Gfx.SupportsTimestamps is true */
+void Gfx_BeginTimestamps(void);
+/* Records the time the GPU finishes all previously issued commands into the given slot */
+void Gfx_RecordTimestamp(int slot);
+/* Finishes recording the current set of GPU timestamps */
+void Gfx_EndTimestamps(void);
+/* Retrieves the oldest set of timestamps (i.e. the set Gfx_BeginTimestamps overwrites next), */
+/*  as milliseconds since the timestamp in slot 0. Returns number of timestamps retrieved. */
+/* NOTE: Returns 0 if the GPU hasn't finished with that set yet, or the results are unreliable */
+int  Gfx_ReadTimestamps(float* times, int maxCount);
+/* Number of render state changes (e.g. Gfx_SetFog, Gfx_SetVertexFormat) since last reset */
+struct GfxStateCounts {
+	int applied; /* State changes passed on to the backend */
+	int skipped; /* Redundant state changes ignored, as the state was already set */
+	int draws;   /* Draw calls issued (only counted by the OpenGL and Direct3D backends) */
+};
+extern struct GfxStateCounts Gfx_StateCounts;
+
 /* Loads given modelview and projection matrices, then calculates the combined MVP matrix */
 void Gfx_LoadMVP(const struct Matrix* view, const struct Matrix* proj, struct Matrix* mvp);
 
@@ -418,6 +517,25 @@ CC_API void Gfx_SetScissor (int x, int y, int w, int h);
 *#########################################################################################################################*/
 /* Outputs a .png screenshot of the backbuffer */
 cc_result Gfx_TakeScreenshot(struct Stream* output);
+#if CC_GFX_BACKEND_IS_GL() && !defined CC_BUILD_COOPTHREADED
+/* Backend can read the backbuffer into memory, so screenshots can be encoded on another thread instead */
+#define CC_GFX_SCREENSHOT_READBACK
+/* Called with the pixels of the backbuffer, stored in top to bottom order */
+/* NOTE: The callback takes ownership of bmp->scan0, which must be freed with Mem_Free */
+typedef void (*Gfx_ReadbackCallback)(struct Bitmap* bmp, cc_result res);
+/* Reads back the pixels of the backbuffer, then calls the callback */
+/* NOTE: When supported, the copy is done asynchronously and so the callback is only called in a later Gfx_EndFrame */
+void Gfx_ReadbackScreenshot(Gfx_ReadbackCallback callback);
+#endif
+#if CC_GFX_BACKEND == CC_GFX_BACKEND_GL2
+/* Backend can draw the 3D scene at a lower resolution, which is then upscaled to fill the window */
+#define CC_GFX_SCALED_SCENE
+/* Starts drawing the 3D scene into only the bottom left width x height pixels of the backbuffer */
+void Gfx_BeginScaledScene(int width, int height);
+/* Copies the scaled 3D scene into a texture, and restores the viewport to the whole window */
+/* NOTE: The texture must then be drawn over the whole window, e.g. with Texture_Render in 2D mode */
+void Gfx_EndScaledScene(struct Texture* tex);
+#endif
 /* Warns in chat if the graphics backend has problems with the user's GPU */
 /* Returns whether legacy rendering mode for borders/sky/clouds is needed */
 cc_bool Gfx_WarnIfNecessary(void);
@@ -461,6 +579,15 @@ void Gfx_Draw2DTexture(const struct Texture* tex, PackedCol color);
 /* Fills out the vertices for rendering a 2D coloured texture */
 void Gfx_Make2DQuad(const struct Texture* tex, PackedCol color, struct VertexTextured** vertices);
 
+/* Maximum number of quads that are drawn together in one 2D batch draw */
+#define GFX_2D_BATCH_QUADS 64
+/* Starts collecting quads from Gfx_Draw2DFlat, Gfx_Draw2DGradient and Texture_Render/Texture_RenderShaded */
+/* Consecutive quads with the same texture are then drawn together, while keeping the order they were added in */
+/* NOTE: Other drawing functions (including Gfx_Draw2DTexture) must not be used until Gfx_End2DBatch */
+void Gfx_Begin2DBatch(void);
+/* Draws any remaining quads of the batch started by Gfx_Begin2DBatch */
+void Gfx_End2DBatch(void);
+
 /* Switches state to be suitable for drawing 2D graphics */
 /* NOTE: This means turning off fog/depth test, changing matrices, etc.*/
 void Gfx_Begin2D(int width, int height);
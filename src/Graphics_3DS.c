@@ -386,6 +386,41 @@ static inline cc_uint32 CalcZOrder(cc_uint32 a) {
     	//  but compiles to less instructions
 }
 
+// Converts a region aligned to 8x8 tiles, writing each tile sequentially
+// Within a tile, each group of 4 pixels is a 2x2 subtile, and the 16 subtiles
+//  are themselves arranged along a Z-order curve of 4x4 subtile coordinates
+static void ToMortonTiles(C3D_Tex* tex, int originX, int originY, 
+				struct Bitmap* bmp, int rowWidth) {
+	cc_uint32* rows[8];
+	int width = bmp->width, height = bmp->height;
+	cc_uint32* src = bmp->scan0;
+
+	for (int tileY = 0; tileY < height; tileY += 8)
+	{
+		// Texture is stored upside down, so bottom row of bitmap is first row of tiles
+		int dstY = tex->height - (tileY + originY) - 8;
+		for (int i = 0; i < 8; i++) 
+		{
+			rows[i] = src + (tileY + 7 - i) * rowWidth;
+		}
+		cc_uint32* dst = (cc_uint32*)tex->data + (originX * 8) + (dstY * tex->width);
+
+		for (int tileX = 0; tileX < width; tileX += 8, dst += 64)
+		{
+			for (int i = 0; i < 16; i++)
+			{
+				int x = tileX + ((i & 1)        | ((i >> 1) & 2)) * 2;
+				int y =         (((i >> 1) & 1) | ((i >> 2) & 2)) * 2;
+
+				dst[i * 4 + 0] = rows[y + 0][x + 0];
+				dst[i * 4 + 1] = rows[y + 0][x + 1];
+				dst[i * 4 + 2] = rows[y + 1][x + 0];
+				dst[i * 4 + 3] = rows[y + 1][x + 1];
+			}
+		}
+	}
+}
+
 // Pixels are arranged in a recursive Z-order curve / Morton offset
 // They are arranged into 8x8 tiles, where each 8x8 tile is composed of
 //  four 4x4 subtiles, which are in turn composed of four 2x2 subtiles
@@ -398,6 +433,12 @@ static void ToMortonTexture(C3D_Tex* tex, int originX, int originY,
 	cc_uint32* dst = tex->data;
 	cc_uint32* src = bmp->scan0;
 
+	// Fast path for terrain atlas and animation updates, which are always tile aligned
+	if (((originX | originY | width | height) & 0x07) == 0) {
+		ToMortonTiles(tex, originX, originY, bmp, rowWidth);
+		return;
+	}
+
 	for (int y = 0; y < height; y++)
 	{
 		dstY    = tex->height - 1 - (y + originY);
@@ -734,7 +775,7 @@ static int fogMode = FOG_LINEAR;
 static float fogDensity = 1.0f;
 static float fogEnd = 32.0f;
 
-void Gfx_SetFog(cc_bool enabled) {
+static void SetFog(cc_bool enabled) {
 	C3D_FogGasMode(enabled ? GPU_FOG : GPU_NO_FOG, GPU_PLAIN_DENSITY, false);
 	// TODO doesn't work quite right
 }
@@ -941,8 +982,7 @@ static void UpdateTexEnv(VertexFormat fmt) {
 	GPUCMD_AddWrite(GPUREG_TEXENV0_COMBINER, func   | (func   << 16));
 }
 
-void Gfx_SetVertexFormat(VertexFormat fmt) {
-	if (fmt == gfx_format) return;
+static void SetVertexFormat(VertexFormat fmt) {
 	gfx_format = fmt;
 	gfx_stride = strideSizes[fmt];
 	
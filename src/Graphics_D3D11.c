@@ -51,6 +51,8 @@ struct ShaderDesc { const void* data; int len; };
 static void IA_UpdateLayout(void);
 static void VS_UpdateShader(void);
 static void PS_UpdateShader(void);
+static void FlushConstants(void);
+static void TS_Free(void);
 static void InitPipeline(void);
 static void FreePipeline(void);
 
@@ -186,6 +188,7 @@ void Gfx_Create(void) {
 
 	Gfx.Created         = true;
 	Gfx.BackendType     = CC_GFX_BACKEND_D3D11;
+	Gfx.SupportsTimestamps = true;
 	customMipmapsLevels = true;
 	Gfx_RestoreState();
 }
@@ -224,6 +227,7 @@ static void Gfx_FreeState(void) {
 	inited = false;
 
 	FreeDefaultResources();
+	TS_Free();
 	FreePipeline();
 	Gfx_DeleteTexture(&white_square);
 }
@@ -355,6 +359,7 @@ void Gfx_UpdateTexture(GfxResourceID texId, int x, int y, struct Bitmap* part, i
 void Gfx_DeleteTexture(GfxResourceID* texId) {
 	ID3D11ShaderResourceView* view = (ID3D11ShaderResourceView*)(*texId);
 	ID3D11Resource* res = NULL;
+	MemStats_Untrack(MEMSTATS_TEXTURE, view);
 
 	if (view) {
 		ID3D11ShaderResourceView_GetResource(view, &res);
@@ -424,6 +429,7 @@ static GfxResourceID Gfx_AllocStaticVb(VertexFormat fmt, int count) {
 
 void Gfx_DeleteVb(GfxResourceID* vb) { 
 	ID3D11Buffer* buffer = (ID3D11Buffer*)(*vb);
+	MemStats_Untrack(MEMSTATS_VERTEXBUFFER, buffer);
 	if (buffer) ID3D11Buffer_Release(buffer);
 	*vb = NULL;
 }
@@ -451,6 +457,7 @@ static GfxResourceID Gfx_AllocDynamicVb(VertexFormat fmt, int maxVertices) {
 
 void Gfx_DeleteDynamicVb(GfxResourceID* vb) { 
 	ID3D11Buffer* buffer = (ID3D11Buffer*)(*vb);
+	MemStats_Untrack(MEMSTATS_VERTEXBUFFER, buffer);
 	if (buffer) ID3D11Buffer_Release(buffer);
 	*vb = NULL;
 }
@@ -475,8 +482,7 @@ void Gfx_UnlockDynamicVb(GfxResourceID vb) {
 /*########################################################################################################################*
 *-----------------------------------------------------Vertex rendering----------------------------------------------------*
 *#########################################################################################################################*/
-void Gfx_SetVertexFormat(VertexFormat fmt) {
-	if (fmt == gfx_format) return;
+static void SetVertexFormat(VertexFormat fmt) {
 	gfx_format = fmt;
 	gfx_stride = strideSizes[fmt];
 
@@ -486,21 +492,29 @@ void Gfx_SetVertexFormat(VertexFormat fmt) {
 }
 
 void Gfx_DrawVb_Lines(int verticesCount) {
+	FlushConstants();
 	ID3D11DeviceContext_IASetPrimitiveTopology(context, D3D11_PRIMITIVE_TOPOLOGY_LINELIST);
 	ID3D11DeviceContext_Draw(context, verticesCount, 0);
+	Gfx_StateCounts.draws++;
 	ID3D11DeviceContext_IASetPrimitiveTopology(context, D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
 }
 
 void Gfx_DrawVb_IndexedTris(int verticesCount) {
+	FlushConstants();
 	ID3D11DeviceContext_DrawIndexed(context, ICOUNT(verticesCount), 0, 0);
+	Gfx_StateCounts.draws++;
 }
 
 void Gfx_DrawVb_IndexedTris_Range(int verticesCount, int startVertex) {
+	FlushConstants();
 	ID3D11DeviceContext_DrawIndexed(context, ICOUNT(verticesCount), 0, startVertex);
+	Gfx_StateCounts.draws++;
 }
 
 void Gfx_DrawIndexedTris_T2fC4b(int verticesCount, int startVertex) {
+	FlushConstants();
 	ID3D11DeviceContext_DrawIndexed(context, ICOUNT(verticesCount), 0, startVertex);
+	Gfx_StateCounts.draws++;
 }
 
 
@@ -603,6 +617,7 @@ void Gfx_BindDynamicVb(GfxResourceID vb) {
 // https://docs.microsoft.com/en-us/windows/win32/direct3d11/vertex-shader-stage
 static ID3D11VertexShader* vs_shaders[3];
 static ID3D11Buffer* vs_cBuffer;
+static cc_bool vs_constantsDirty;
 
 static struct CC_ALIGNED(64) VSConstants {
 	struct Matrix mvp;
@@ -662,8 +677,10 @@ static void VS_FreeShaders(void) {
 	}
 }
 
+// Constants are only uploaded right before the next draw (see FlushConstants),
+//  so e.g. changing both view and projection matrices only results in one upload
 static void VS_UpdateConstants(void) {
-	ID3D11DeviceContext_UpdateSubresource(context, vs_cBuffer, 0, NULL, &vs_constants, 0, 0);
+	vs_constantsDirty = true;
 }
 
 static void VS_FreeConstants(void) {
@@ -697,6 +714,7 @@ void Gfx_LoadMVP(const struct Matrix* view, const struct Matrix* proj, struct Ma
 }
 
 void Gfx_EnableTextureOffset(float x, float y) {
+	if (vs_constants.texX == x && vs_constants.texY == y) return;
 	vs_constants.texX = x;
 	vs_constants.texY = y;
 	VS_UpdateShader();
@@ -789,6 +807,7 @@ void Gfx_SetFaceCulling(cc_bool enabled) {
 static ID3D11SamplerState* ps_samplers[2];
 static ID3D11PixelShader* ps_shaders[12];
 static ID3D11Buffer* ps_cBuffer;
+static cc_bool ps_constantsDirty;
 static cc_bool ps_mipmaps;
 static float ps_fogEnd, ps_fogDensity;
 static PackedCol ps_fogColor;
@@ -899,13 +918,25 @@ static void PS_UpdateConstants(void) {
 
 	// avoid doing - in pixel shader for density fog
 	ps_constants.fogValue = ps_fogMode == FOG_LINEAR ? ps_fogEnd : -ps_fogDensity;
-	ID3D11DeviceContext_UpdateSubresource(context, ps_cBuffer, 0, NULL, &ps_constants, 0, 0);
+	ps_constantsDirty = true;
 }
 
 static void PS_FreeConstants(void) {
 	ID3D11Buffer_Release(ps_cBuffer);
 }
 
+// Uploads constants changed since the last draw
+static void FlushConstants(void) {
+	if (vs_constantsDirty) {
+		ID3D11DeviceContext_UpdateSubresource(context, vs_cBuffer, 0, NULL, &vs_constants, 0, 0);
+		vs_constantsDirty = false;
+	}
+	if (ps_constantsDirty) {
+		ID3D11DeviceContext_UpdateSubresource(context, ps_cBuffer, 0, NULL, &ps_constants, 0, 0);
+		ps_constantsDirty = false;
+	}
+}
+
 static void PS_Init(void) {
 	PS_CreateShaders();
 	PS_CreateSamplers();
@@ -934,9 +965,7 @@ void Gfx_BindTexture(GfxResourceID texId) {
 	ID3D11DeviceContext_PSSetShaderResources(context, 0, 1, &view);
 }
 
-void Gfx_SetFog(cc_bool enabled) {
-	if (gfx_fogEnabled == enabled) return;
-	gfx_fogEnabled = enabled;
+static void SetFog(cc_bool enabled) {
 	PS_UpdateShader();
 }
 
@@ -1153,6 +1182,100 @@ void Gfx_DepthOnlyRendering(cc_bool depthOnly) {
 }
 
 
+//########################################################################################################################
+//-------------------------------------------------------GPU timestamps---------------------------------------------------
+//########################################################################################################################
+// https://learn.microsoft.com/en-us/windows/win32/api/d3d11/ne-d3d11-d3d11_query
+static ID3D11Query* ts_queries[GFX_TIMESTAMP_FRAMES][GFX_MAX_TIMESTAMPS];
+// Timestamps are only meaningful within a disjoint query, which also provides the timestamp frequency
+static ID3D11Query* ts_disjoint[GFX_TIMESTAMP_FRAMES];
+static int ts_counts[GFX_TIMESTAMP_FRAMES];
+static int ts_frame;
+
+static void TS_Create(void) {
+	D3D11_QUERY_DESC desc = { 0 };
+
+	for (int i = 0; i < GFX_TIMESTAMP_FRAMES; i++)
+	{
+		desc.Query = D3D11_QUERY_TIMESTAMP_DISJOINT;
+		ID3D11Device_CreateQuery(device, &desc, &ts_disjoint[i]);
+
+		desc.Query = D3D11_QUERY_TIMESTAMP;
+		for (int j = 0; j < GFX_MAX_TIMESTAMPS; j++)
+		{
+			ID3D11Device_CreateQuery(device, &desc, &ts_queries[i][j]);
+		}
+	}
+}
+
+static void TS_Free(void) {
+	for (int i = 0; i < GFX_TIMESTAMP_FRAMES; i++)
+	{
+		if (ts_disjoint[i]) ID3D11Query_Release(ts_disjoint[i]);
+		ts_disjoint[i] = NULL;
+		ts_counts[i]   = 0;
+
+		for (int j = 0; j < GFX_MAX_TIMESTAMPS; j++)
+		{
+			if (ts_queries[i][j]) ID3D11Query_Release(ts_queries[i][j]);
+			ts_queries[i][j] = NULL;
+		}
+	}
+}
+
+void Gfx_BeginTimestamps(void) {
+	if (!ts_disjoint[0]) TS_Create();
+	ts_frame = (ts_frame + 1) % GFX_TIMESTAMP_FRAMES;
+	ts_counts[ts_frame] = 0;
+
+	if (!ts_disjoint[ts_frame]) return;
+	ID3D11DeviceContext_Begin(context, (ID3D11Asynchronous*)ts_disjoint[ts_frame]);
+}
+
+void Gfx_RecordTimestamp(int slot) {
+	ID3D11Query* query = ts_queries[ts_frame][slot];
+	if (!query) return;
+
+	ID3D11DeviceContext_End(context, (ID3D11Asynchronous*)query);
+	ts_counts[ts_frame] = max(ts_counts[ts_frame], slot + 1);
+}
+
+void Gfx_EndTimestamps(void) {
+	if (!ts_disjoint[ts_frame]) return;
+	ID3D11DeviceContext_End(context, (ID3D11Asynchronous*)ts_disjoint[ts_frame]);
+}
+
+int Gfx_ReadTimestamps(float* times, int maxCount) {
+	D3D11_QUERY_DATA_TIMESTAMP_DISJOINT disjoint;
+	int frame = (ts_frame + 1) % GFX_TIMESTAMP_FRAMES;
+	int count = min(maxCount, ts_counts[frame]);
+	UINT64 first, value;
+	if (!count) return 0;
+
+	// Don't flush, as that would cause the GPU to stall
+	HRESULT hr = ID3D11DeviceContext_GetData(context, (ID3D11Asynchronous*)ts_disjoint[frame], 
+								&disjoint, sizeof(disjoint), D3D11_ASYNC_GETDATA_DONOTFLUSH);
+	if (hr != S_OK) return 0;
+	// e.g. GPU clock frequency changed, so results are meaningless
+	if (disjoint.Disjoint || !disjoint.Frequency) { ts_counts[frame] = 0; return 0; }
+
+	hr = ID3D11DeviceContext_GetData(context, (ID3D11Asynchronous*)ts_queries[frame][0], 
+								&first, sizeof(first), D3D11_ASYNC_GETDATA_DONOTFLUSH);
+	if (hr != S_OK) return 0;
+
+	for (int i = 0; i < count; i++)
+	{
+		hr = ID3D11DeviceContext_GetData(context, (ID3D11Asynchronous*)ts_queries[frame][i], 
+								&value, sizeof(value), D3D11_ASYNC_GETDATA_DONOTFLUSH);
+		if (hr != S_OK) return 0;
+
+		times[i] = (int)((value - first) * 1000000 / disjoint.Frequency) / 1000.0f;
+	}
+	ts_counts[frame] = 0;
+	return count;
+}
+
+
 /*########################################################################################################################*
 *-----------------------------------------------------------Misc----------------------------------------------------------*
 *#########################################################################################################################*/
@@ -385,7 +385,10 @@ void Gfx_BindTexture(GfxResourceID texId) {
 	if (res) Process_Abort2(res, "D3D9_BindTexture");
 }
 
-void Gfx_DeleteTexture(GfxResourceID* texId) { D3D9_FreeResource(*texId); *texId = NULL; }
+void Gfx_DeleteTexture(GfxResourceID* texId) {
+	MemStats_Untrack(MEMSTATS_TEXTURE, *texId);
+	D3D9_FreeResource(*texId); *texId = NULL;
+}
 
 void Gfx_EnableMipmaps(void) {
 	if (!Gfx.Mipmaps) return;
@@ -417,10 +420,7 @@ void Gfx_SetFaceCulling(cc_bool enabled) {
 	IDirect3DDevice9_SetRenderState(device, D3DRS_CULLMODE, mode);
 }
 
-void Gfx_SetFog(cc_bool enabled) {
-	if (gfx_fogEnabled == enabled) return;
-	gfx_fogEnabled = enabled;
-
+static void SetFog(cc_bool enabled) {
 	if (Gfx.LostContext) return;
 	IDirect3DDevice9_SetRenderState(device, D3DRS_FOGENABLE, enabled);
 }
@@ -621,7 +621,10 @@ static GfxResourceID Gfx_AllocStaticVb(VertexFormat fmt, int count) {
 	return D3D9_AllocVertexBuffer(fmt, count, D3DUSAGE_WRITEONLY);
 }
 
-void Gfx_DeleteVb(GfxResourceID* vb) { D3D9_FreeResource(*vb); *vb = NULL; }
+void Gfx_DeleteVb(GfxResourceID* vb) {
+	MemStats_Untrack(MEMSTATS_VERTEXBUFFER, *vb);
+	D3D9_FreeResource(*vb); *vb = NULL;
+}
 
 void Gfx_BindVb(GfxResourceID vb) {
 	IDirect3DVertexBuffer9* vbuffer = (IDirect3DVertexBuffer9*)vb;
@@ -647,7 +650,10 @@ static GfxResourceID Gfx_AllocDynamicVb(VertexFormat fmt, int maxVertices) {
 	return D3D9_AllocVertexBuffer(fmt, maxVertices, D3DUSAGE_DYNAMIC | D3DUSAGE_WRITEONLY);
 }
 
-void Gfx_DeleteDynamicVb(GfxResourceID* vb) { D3D9_FreeResource(*vb); *vb = NULL; }
+void Gfx_DeleteDynamicVb(GfxResourceID* vb) {
+	MemStats_Untrack(MEMSTATS_VERTEXBUFFER, *vb);
+	D3D9_FreeResource(*vb); *vb = NULL;
+}
 
 void Gfx_BindDynamicVb(GfxResourceID vb) {
 	IDirect3DVertexBuffer9* vbuffer = (IDirect3DVertexBuffer9*)vb;
@@ -678,9 +684,8 @@ void Gfx_SetDynamicVbData(GfxResourceID vb, void* vertices, int vCount) {
 /*########################################################################################################################*
 *-----------------------------------------------------Vertex rendering----------------------------------------------------*
 *#########################################################################################################################*/
-void Gfx_SetVertexFormat(VertexFormat fmt) {
+static void SetVertexFormat(VertexFormat fmt) {
 	cc_result res;
-	if (fmt == gfx_format) return;
 	gfx_format = fmt;
 
 	if (fmt == VERTEX_FORMAT_COLOURED) {
@@ -700,21 +705,25 @@ void Gfx_SetVertexFormat(VertexFormat fmt) {
 void Gfx_DrawVb_Lines(int verticesCount) {
 	/* NOTE: Skip checking return result for Gfx_DrawXYZ for performance */
 	IDirect3DDevice9_DrawPrimitive(device, D3DPT_LINELIST, 0, verticesCount >> 1);
+	Gfx_StateCounts.draws++;
 }
 
 void Gfx_DrawVb_IndexedTris(int verticesCount) {
 	IDirect3DDevice9_DrawIndexedPrimitive(device, D3DPT_TRIANGLELIST,
 		0, 0, verticesCount, 0, verticesCount >> 1);
+	Gfx_StateCounts.draws++;
 }
 
 void Gfx_DrawVb_IndexedTris_Range(int verticesCount, int startVertex) {
 	IDirect3DDevice9_DrawIndexedPrimitive(device, D3DPT_TRIANGLELIST,
 		startVertex, 0, verticesCount, 0, verticesCount >> 1);
+	Gfx_StateCounts.draws++;
 }
 
 void Gfx_DrawIndexedTris_T2fC4b(int verticesCount, int startVertex) {
 	IDirect3DDevice9_DrawIndexedPrimitive(device, D3DPT_TRIANGLELIST,
 		startVertex, 0, verticesCount, 0, verticesCount >> 1);
+	Gfx_StateCounts.draws++;
 }
 
 
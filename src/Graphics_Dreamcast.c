@@ -119,6 +119,15 @@ static int texmem_move(cc_uint8* ptr, cc_uint32 size) {
 	return moved * TEXMEM_PAGE_SIZE;
 }
 
+static cc_bool texmem_move_texture(TextureObject* tex, cc_uint32 size) {
+	int moved = texmem_move(tex->data, size);
+	if (!moved) return false;
+
+	memmove(tex->data - moved, tex->data, size);
+	tex->data -= moved;
+	return true;
+}
+
 static int texmem_defragment(void) {
 	int moved_any = false;
 	for (int i = 0; i < MAX_TEXTURE_COUNT; i++)
@@ -126,15 +135,43 @@ static int texmem_defragment(void) {
 		TextureObject* tex = &TEXTURE_LIST[i];
 		if (!tex->data) continue;
 
+		moved_any |= texmem_move_texture(tex, tex->width * tex->height * 2);
+	}
+	return moved_any;
+}
+
+// Maximum number of bytes of textures moved by background defragmenting each frame
+#define TEXMEM_DEFRAG_BUDGET (64 * 1024)
+// Whether textures have been freed since VRAM was last fully compacted
+static cc_bool texmem_fragmented;
+// Index into TEXTURE_LIST of where background defragmenting is up to
+static int texmem_defrag_index;
+static cc_bool texmem_defrag_moved;
+
+// Moves a few textures down into free pages, to avoid long stalls from texmem_alloc 
+//  needing to defragment the whole of VRAM at once (e.g. when changing texture packs)
+static void texmem_defragment_step(void) {
+	cc_uint32 budget = TEXMEM_DEFRAG_BUDGET;
+	if (!texmem_fragmented) return;
+
+	while (budget) 
+	{
+		if (texmem_defrag_index == MAX_TEXTURE_COUNT) {
+			// Finished a whole pass without moving anything, so VRAM is fully compacted
+			if (!texmem_defrag_moved) { texmem_fragmented = false; return; }
+
+			texmem_defrag_index = 0;
+			texmem_defrag_moved = false;
+		}
+		TextureObject* tex = &TEXTURE_LIST[texmem_defrag_index++];
+		if (!tex->data) continue;
+
 		cc_uint32 size = tex->width * tex->height * 2;
-		int moved = texmem_move(tex->data, size);
-		if (!moved) continue;
+		if (!texmem_move_texture(tex, size)) continue;
 
-		moved_any = true;
-		memmove(tex->data - moved, tex->data, size);
-		tex->data -= moved;
+		texmem_defrag_moved = true;
+		budget -= min(budget, size);
 	}
-	return moved_any;
 }
 
 static CC_INLINE int texmem_can_alloc(cc_uint32 beg, cc_uint32 pages) {
@@ -178,13 +215,17 @@ static void texmem_free(cc_uint8* ptr, cc_uint32 size) {
 
 	for (cc_uint32 i = 0; i < pages; i++)
 		texmem_used[page + i] = 0;
+
+	texmem_fragmented   = true;
+	texmem_defrag_index = 0;
+	texmem_defrag_moved = false;
 }
 
 static cc_uint32 texmem_total_free(void) {
 	cc_uint32 free = 0;
     for (cc_uint32 page = 0; page < texmem_pages; page++) 
 	{
-		if (!texmem_base[page]) free += TEXMEM_PAGE_SIZE;
+		if (!texmem_used[page]) free += TEXMEM_PAGE_SIZE;
     }
 	return free;
 }
@@ -193,11 +234,22 @@ static cc_uint32 texmem_total_used(void) {
 	cc_uint32 used = 0;
     for (cc_uint32 page = 0; page < texmem_pages; page++) 
 	{
-		if (texmem_base[page]) used += TEXMEM_PAGE_SIZE;
+		if (texmem_used[page]) used += TEXMEM_PAGE_SIZE;
     }
 	return used;
 }
 
+// Size of the largest texture that can be allocated without defragmenting
+static cc_uint32 texmem_largest_free(void) {
+	cc_uint32 largest = 0, run = 0;
+    for (cc_uint32 page = 0; page < texmem_pages; page++) 
+	{
+		run     = texmem_used[page] ? 0 : run + 1;
+		largest = max(largest, run);
+    }
+	return largest * TEXMEM_PAGE_SIZE;
+}
+
 
 /*########################################################################################################################*
 *---------------------------------------------------------General---------------------------------------------------------*
@@ -615,8 +667,7 @@ static PackedCol gfx_fogColor;
 static float gfx_fogEnd = 16.0f, gfx_fogDensity = 1.0f;
 static FogFunc gfx_fogMode = -1;
 
-void Gfx_SetFog(cc_bool enabled) {
-	gfx_fogEnabled = enabled;
+static void SetFog(cc_bool enabled) {
 	if (FOG_ENABLED == enabled) return;
 	
 	FOG_ENABLED = enabled;
@@ -792,8 +843,7 @@ void DrawQuads(int count, void* src) {
 	list->length = 0;
 }
 
-void Gfx_SetVertexFormat(VertexFormat fmt) {
-	if (fmt == gfx_format) return;
+static void SetVertexFormat(VertexFormat fmt) {
 	gfx_format = fmt;
 	gfx_stride = strideSizes[fmt];
 
@@ -841,6 +891,7 @@ cc_result Gfx_TakeScreenshot(struct Stream* output) {
 void Gfx_GetApiInfo(cc_string* info) {
 	int freeMem = texmem_total_free();
 	int usedMem = texmem_total_used();
+	int largest = texmem_largest_free() / 1024;
 	
 	float freeMemMB = freeMem / (1024.0 * 1024.0);
 	float usedMemMB = usedMem / (1024.0 * 1024.0);
@@ -849,6 +900,7 @@ void Gfx_GetApiInfo(cc_string* info) {
 	String_AppendConst(info, "GPU: PowerVR2 CLX2 100mHz\n");
 	String_AppendConst(info, "T&L: GLdc library (KallistiOS / Kazade)\n");
 	String_Format2(info,     "Texture memory: %f2 MB used, %f2 MB free\n", &usedMemMB, &freeMemMB);
+	String_Format1(info,     "Largest free block: %i KB\n", &largest);
 	PrintMaxTextureInfo(info);
 }
 
@@ -899,6 +951,8 @@ void Gfx_EndFrame(void) {
 	SubmitList(&listTR);
 	pvr_scene_finish();
 	pvr_wait_ready();
+	// Done between frames, so no poly headers reference the old texture addresses
+	texmem_defragment_step();
 }
 
 void Gfx_OnWindowResize(void) {
@@ -15,6 +15,7 @@ static void* xfbs[2];
 static  int curFB;
 static GfxResourceID white_square;
 static GXTexRegionCallback regionCB;
+static cc_uint8* quad_list;
 // https://wiibrew.org/wiki/Developer_tips
 // https://devkitpro.org/wiki/libogc/GX
 
@@ -89,6 +90,9 @@ void Gfx_RestoreState(void) {
 void Gfx_FreeState(void) { 
 	FreeDefaultResources();
 	Gfx_DeleteTexture(&white_square);
+
+	free(quad_list);
+	quad_list = NULL;
 }
 
 /*########################################################################################################################*
@@ -367,6 +371,8 @@ void* Gfx_LockVb(GfxResourceID vb, VertexFormat fmt, int count) {
 void Gfx_UnlockVb(GfxResourceID vb) { 
 	gfx_vertices = vb; 
 	DCFlushRange(vb, vb_size);
+	// Memory may previously have been used by a different vertex buffer
+	GX_InvVtxCache();
 }
 
 
@@ -426,8 +432,7 @@ static void UpdateFog(void) {
     GX_SetFog(mode, beg, end, near, far, color);
 }
 
-void Gfx_SetFog(cc_bool enabled) {
-	gfx_fogEnabled = enabled;
+static void SetFog(cc_bool enabled) {
 	UpdateFog();
 }
 
@@ -565,8 +570,7 @@ void Gfx_DisableTextureOffset(void) {
 /*########################################################################################################################*
 *---------------------------------------------------------Drawing---------------------------------------------------------*
 *#########################################################################################################################*/
-void Gfx_SetVertexFormat(VertexFormat fmt) {
-	if (fmt == gfx_format) return;
+static void SetVertexFormat(VertexFormat fmt) {
 	gfx_format = fmt;
 	gfx_stride = strideSizes[fmt];
 
@@ -644,7 +648,64 @@ void Gfx_DrawVb_IndexedTris(int verticesCount) {
 	}
 }
 
+// Chunk meshes are instead drawn by pointing the vertex arrays at the vertex buffer, and then calling a
+//  display list of quads with indices 0,1,2,3 4,5,6,7 ... which is shared by all vertex buffers
+// This avoids the CPU having to write every vertex of the chunks into the FIFO each frame
+// Each quad in the display list is padded to 32 bytes, as GX_CallDispList requires a multiple of 32
+#define QUADLIST_QUADS    4096
+#define QUADLIST_VERTICES (QUADLIST_QUADS * 4)
+#define QUADLIST_STRIDE   32
+static cc_bool indexed_desc;
+
+static void BuildQuadList(void) {
+	quad_list = memalign(32, QUADLIST_QUADS * QUADLIST_STRIDE);
+	if (!quad_list) return;
+	memset(quad_list, 0, QUADLIST_QUADS * QUADLIST_STRIDE); // 0 is GX_NOP
+
+	for (int i = 0; i < QUADLIST_QUADS; i++)
+	{
+		cc_uint8* ptr = quad_list + i * QUADLIST_STRIDE;
+		*ptr++ = GX_QUADS | GX_VTXFMT0;
+		*ptr++ = 0; *ptr++ = 4; // vertex count
+
+		for (int j = 0; j < 4; j++)
+		{
+			int index = i * 4 + j;
+			// same index for position, colour and texture coordinates
+			for (int k = 0; k < 3; k++) { *ptr++ = index >> 8; *ptr++ = index; }
+		}
+	}
+	DCFlushRange(quad_list, QUADLIST_QUADS * QUADLIST_STRIDE);
+}
+
+static void SetIndexedDesc(cc_bool indexed) {
+	u8 type = indexed ? GX_INDEX16 : GX_DIRECT;
+	if (indexed_desc == indexed) return;
+	indexed_desc = indexed;
+
+	GX_SetVtxDesc(GX_VA_POS,  type);
+	GX_SetVtxDesc(GX_VA_CLR0, type);
+	GX_SetVtxDesc(GX_VA_TEX0, type);
+}
+
 void Gfx_DrawIndexedTris_T2fC4b(int verticesCount, int startVertex) {
-	Draw_TexturedTriangles(verticesCount, startVertex);
+	if (!quad_list) BuildQuadList();
+	if (!quad_list) { Draw_TexturedTriangles(verticesCount, startVertex); return; }
+
+	SetIndexedDesc(true);
+	while (verticesCount > 0)
+	{
+		int count = min(verticesCount, QUADLIST_VERTICES);
+		cc_uint8* base = gfx_vertices + startVertex * SIZEOF_VERTEX_TEXTURED;
+
+		GX_SetArray(GX_VA_POS,  base +  0, SIZEOF_VERTEX_TEXTURED);
+		GX_SetArray(GX_VA_CLR0, base + 12, SIZEOF_VERTEX_TEXTURED);
+		GX_SetArray(GX_VA_TEX0, base + 16, SIZEOF_VERTEX_TEXTURED);
+		GX_CallDispList(quad_list, (count >> 2) * QUADLIST_STRIDE);
+
+		verticesCount -= count;
+		startVertex   += count;
+	}
+	SetIndexedDesc(false);
 }
 #endif
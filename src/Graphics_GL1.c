@@ -140,6 +140,7 @@ void Gfx_BindVb(GfxResourceID vb) {
 
 void Gfx_DeleteVb(GfxResourceID* vb) {
 	GfxResourceID id = *vb;
+	MemStats_Untrack(MEMSTATS_VERTEXBUFFER, id);
 	if (id) _glDeleteBuffers(1, (GLuint*)&id);
 	*vb = 0;
 }
@@ -159,6 +160,7 @@ void Gfx_BindVb(GfxResourceID vb) { activeList = ptr_to_uint(vb); }
 
 void Gfx_DeleteVb(GfxResourceID* vb) {
 	GLuint id = ptr_to_uint(*vb);
+	MemStats_Untrack(MEMSTATS_VERTEXBUFFER, *vb);
 	if (id) glDeleteLists(id, 1);
 	*vb = 0;
 }
@@ -196,6 +198,7 @@ void Gfx_UnlockVb(GfxResourceID vb) {
 GfxResourceID Gfx_CreateVb2(void* vertices, VertexFormat fmt, int count) {
 	GLuint list = glGenLists(1);
 	UpdateDisplayList(list, vertices, fmt, count);
+	MemStats_Track(MEMSTATS_VERTEXBUFFER, uint_to_ptr(list), count * strideSizes[fmt], "GPU vertex buffers");
 	return list;
 }
 #endif
@@ -221,6 +224,7 @@ void Gfx_BindDynamicVb(GfxResourceID vb) {
 
 void Gfx_DeleteDynamicVb(GfxResourceID* vb) {
 	GfxResourceID id = *vb;
+	MemStats_Untrack(MEMSTATS_VERTEXBUFFER, id);
 	if (id) _glDeleteBuffers(1, (GLuint*)&id);
 	*vb = 0;
 }
@@ -229,15 +233,17 @@ void* Gfx_LockDynamicVb(GfxResourceID vb, VertexFormat fmt, int count) {
 	return FastAllocTempMem(count * strideSizes[fmt]);
 }
 
+/* Respecifying the whole buffer's storage lets the driver 'orphan' the old storage that */
+/*  the GPU may still be using for previous draws, instead of stalling until they finish */
 void Gfx_UnlockDynamicVb(GfxResourceID vb) {
 	_glBindBuffer(GL_ARRAY_BUFFER, vb);
-	_glBufferSubData(GL_ARRAY_BUFFER, 0, tmpSize, tmpData);
+	_glBufferData(GL_ARRAY_BUFFER, tmpSize, tmpData, GL_DYNAMIC_DRAW);
 }
 
 void Gfx_SetDynamicVbData(GfxResourceID vb, void* vertices, int vCount) {
 	cc_uint32 size = vCount * gfx_stride;
 	_glBindBuffer(GL_ARRAY_BUFFER, vb);
-	_glBufferSubData(GL_ARRAY_BUFFER, 0, size, vertices);
+	_glBufferData(GL_ARRAY_BUFFER, size, vertices, GL_DYNAMIC_DRAW);
 }
 #else
 static GfxResourceID Gfx_AllocDynamicVb(VertexFormat fmt, int maxVertices) {
@@ -251,6 +257,7 @@ void Gfx_BindDynamicVb(GfxResourceID vb) {
 
 void Gfx_DeleteDynamicVb(GfxResourceID* vb) {
 	void* addr = *vb;
+	MemStats_Untrack(MEMSTATS_VERTEXBUFFER, addr);
 	if (addr) Mem_Free(addr);
 	*vb = 0;
 }
@@ -289,6 +296,12 @@ static void GL_SetupVbTextured(void) {
 	_glTexCoordPointer(2, GL_FLOAT,      SIZEOF_VERTEX_TEXTURED, VB_PTR + 16);
 }
 
+static void GL_SetupVbChunk(void) {
+	_glVertexPointer(3, GL_SHORT,        SIZEOF_VERTEX_CHUNK, VB_PTR +  0);
+	_glTexCoordPointer(2, GL_SHORT,      SIZEOF_VERTEX_CHUNK, VB_PTR +  8);
+	_glColorPointer(4, GL_UNSIGNED_BYTE, SIZEOF_VERTEX_CHUNK, VB_PTR + 12);
+}
+
 static void GL_SetupVbColoured_Range(int startVertex) {
 	cc_uint32 offset = startVertex * SIZEOF_VERTEX_COLOURED;
 	_glVertexPointer(3, GL_FLOAT,          SIZEOF_VERTEX_COLOURED, VB_PTR + offset +  0);
@@ -302,17 +315,42 @@ static void GL_SetupVbTextured_Range(int startVertex) {
 	_glTexCoordPointer(2, GL_FLOAT,        SIZEOF_VERTEX_TEXTURED, VB_PTR + offset + 16);
 }
 
-void Gfx_SetVertexFormat(VertexFormat fmt) {
-	if (fmt == gfx_format) return;
+static void GL_SetupVbChunk_Range(int startVertex) {
+	cc_uint32 offset = startVertex * SIZEOF_VERTEX_CHUNK;
+	_glVertexPointer(3, GL_SHORT,          SIZEOF_VERTEX_CHUNK, VB_PTR + offset +  0);
+	_glTexCoordPointer(2, GL_SHORT,        SIZEOF_VERTEX_CHUNK, VB_PTR + offset +  8);
+	_glColorPointer(4, GL_UNSIGNED_BYTE,   SIZEOF_VERTEX_CHUNK, VB_PTR + offset + 12);
+}
+
+static struct Matrix texMatrix = Matrix_IdentityValue;
+/* Texture coordinates of chunk vertices are scaled back to normal range using texture matrix */
+static void SetTexMatrixScale(cc_bool chunk) {
+	texMatrix.row1.x = chunk ? 1.0f / CHUNKVERTEX_U_SCALE : 1.0f;
+	texMatrix.row2.y = chunk ? 1.0f / CHUNKVERTEX_V_SCALE : 1.0f;
+	Gfx_LoadMatrix(2, &texMatrix);
+}
+
+static void SetVertexFormat(VertexFormat fmt) {
+	int oldFormat = gfx_format;
 	gfx_format = fmt;
 	gfx_stride = strideSizes[fmt];
 
+	if (fmt == VERTEX_FORMAT_CHUNK || oldFormat == VERTEX_FORMAT_CHUNK) {
+		SetTexMatrixScale(fmt == VERTEX_FORMAT_CHUNK);
+	}
+
 	if (fmt == VERTEX_FORMAT_TEXTURED) {
 		_glEnableClientState(GL_TEXTURE_COORD_ARRAY);
 		_glEnable(GL_TEXTURE_2D);
 
 		gfx_setupVBFunc      = GL_SetupVbTextured;
 		gfx_setupVBRangeFunc = GL_SetupVbTextured_Range;
+	} else if (fmt == VERTEX_FORMAT_CHUNK) {
+		_glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+		_glEnable(GL_TEXTURE_2D);
+
+		gfx_setupVBFunc      = GL_SetupVbChunk;
+		gfx_setupVBRangeFunc = GL_SetupVbChunk_Range;
 	} else {
 		_glDisableClientState(GL_TEXTURE_COORD_ARRAY);
 		_glDisable(GL_TEXTURE_2D);
@@ -325,9 +363,11 @@ void Gfx_SetVertexFormat(VertexFormat fmt) {
 void Gfx_DrawVb_Lines(int verticesCount) {
 	gfx_setupVBFunc();
 	_glDrawArrays(GL_LINES, 0, verticesCount);
+	Gfx_StateCounts.draws++;
 }
 
 void Gfx_DrawVb_IndexedTris_Range(int verticesCount, int startVertex) {
+	Gfx_StateCounts.draws++;
 #ifdef CC_BUILD_GL11
 	if (activeList != gl_DYNAMICLISTID) { glCallList(activeList); return; }
 #endif
@@ -336,6 +376,7 @@ void Gfx_DrawVb_IndexedTris_Range(int verticesCount, int startVertex) {
 }
 
 void Gfx_DrawVb_IndexedTris(int verticesCount) {
+	Gfx_StateCounts.draws++;
 #ifdef CC_BUILD_GL11
 	if (activeList != gl_DYNAMICLISTID) { glCallList(activeList); return; }
 #endif
@@ -344,10 +385,20 @@ void Gfx_DrawVb_IndexedTris(int verticesCount) {
 }
 
 #ifdef CC_BUILD_GL11
-void Gfx_DrawIndexedTris_T2fC4b(int verticesCount, int startVertex) { glCallList(activeList); }
+void Gfx_DrawIndexedTris_T2fC4b(int verticesCount, int startVertex) { 
+	Gfx_StateCounts.draws++;
+	glCallList(activeList); 
+}
 #else
 void Gfx_DrawIndexedTris_T2fC4b(int verticesCount, int startVertex) {
 	cc_uint32 offset = startVertex * SIZEOF_VERTEX_TEXTURED;
+	Gfx_StateCounts.draws++;
+	if (gfx_format == VERTEX_FORMAT_CHUNK) {
+		GL_SetupVbChunk_Range(startVertex);
+		_glDrawElements(GL_TRIANGLES, ICOUNT(verticesCount), GL_UNSIGNED_SHORT, IB_PTR);
+		return;
+	}
+
 	_glVertexPointer(3, GL_FLOAT,        SIZEOF_VERTEX_TEXTURED, VB_PTR + offset +  0);
 	_glColorPointer(4, GL_UNSIGNED_BYTE, SIZEOF_VERTEX_TEXTURED, VB_PTR + offset + 12);
 	_glTexCoordPointer(2, GL_FLOAT,      SIZEOF_VERTEX_TEXTURED, VB_PTR + offset + 16);
@@ -371,8 +422,7 @@ static PackedCol gfx_fogColor;
 static float gfx_fogEnd = -1.0f, gfx_fogDensity = -1.0f;
 static int gfx_fogMode  = -1;
 
-void Gfx_SetFog(cc_bool enabled) {
-	gfx_fogEnabled = enabled;
+static void SetFog(cc_bool enabled) {
 	if (enabled) { _glEnable(GL_FOG); } else { _glDisable(GL_FOG); }
 }
 
@@ -450,24 +500,29 @@ void Gfx_LoadMVP(const struct Matrix* view, const struct Matrix* proj, struct Ma
 	Matrix_Mul(mvp, view, proj);
 }
 
-static struct Matrix texMatrix = Matrix_IdentityValue;
 void Gfx_EnableTextureOffset(float x, float y) {
 	texMatrix.row4.x = x; texMatrix.row4.y = y;
 	Gfx_LoadMatrix(2, &texMatrix);
 }
 
-void Gfx_DisableTextureOffset(void) { Gfx_LoadMatrix(2, &Matrix_Identity); }
+void Gfx_DisableTextureOffset(void) {
+	texMatrix.row4.x = 0.0f; texMatrix.row4.y = 0.0f;
+	Gfx_LoadMatrix(2, &texMatrix);
+}
 
 
 /*########################################################################################################################*
 *-------------------------------------------------------State setup-------------------------------------------------------*
 *#########################################################################################################################*/
-static void Gfx_FreeState(void) { FreeDefaultResources(); }
+static void Gfx_FreeState(void) { FreeDefaultResources(); GL_FreeTimestamps(); }
 static void Gfx_RestoreState(void) {
 	InitDefaultResources();
 	_glEnableClientState(GL_VERTEX_ARRAY);
 	_glEnableClientState(GL_COLOR_ARRAY);
 	gfx_format = -1;
+	/* Restore cached state, since Gfx_SetFog/Gfx_SetAlphaTest ignore unchanged state */
+	if (gfx_fogEnabled) _glEnable(GL_FOG);
+	if (gfx_alphaTest)  _glEnable(GL_ALPHA_TEST);
 
 	_glHint(GL_FOG_HINT, GL_NICEST);
 	_glAlphaFunc(GL_GREATER, 0.5f);
@@ -721,8 +776,10 @@ static void GLBackend_Init(void) {
 	} else if (String_CaselessContains(&extensions, &vboExt)) {
 		GLContext_GetAll(arbVboFuncs,  Array_Elems(arbVboFuncs));
 	} else {
-		FallbackOpenGL();
+		FallbackOpenGL(); return;
 	}
+	/* Fallback paths only handle float positions and texture coordinates */
+	Gfx.SupportsChunkVertices = true;
 }
 #endif
 #endif
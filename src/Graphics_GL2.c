@@ -8,6 +8,8 @@
 #include "Errors.h"
 #include "Window.h"
 #include "Menus.h"
+#include "Stream.h"
+#include "Utils.h"
 
 /* OpenGL 2.0 backend (alternative modern-ish backend) */
 #include "../misc/opengl/GLCommon.h"
@@ -49,6 +51,8 @@ void Gfx_Create(void) {
 	GLContext_GetAll(core_funcs, Array_Elems(core_funcs));
 #endif
 	Gfx.BackendType = CC_GFX_BACKEND_GL2;
+	Gfx.SupportsChunkVertices    = true;
+	Gfx.SupportsChunkLightColors = true;
 	
 	GL_InitCommon();
 	GLBackend_Init();
@@ -103,6 +107,7 @@ void Gfx_BindVb(GfxResourceID vb) {
 
 void Gfx_DeleteVb(GfxResourceID* vb) {
 	GLuint id = ptr_to_uint(*vb);
+	MemStats_Untrack(MEMSTATS_VERTEXBUFFER, *vb);
 	if (id) glDeleteBuffers(1, &id);
 	*vb = 0;
 }
@@ -133,6 +138,7 @@ void Gfx_BindDynamicVb(GfxResourceID vb) {
 
 void Gfx_DeleteDynamicVb(GfxResourceID* vb) {
 	GLuint id = ptr_to_uint(*vb);
+	MemStats_Untrack(MEMSTATS_VERTEXBUFFER, *vb);
 	if (id) glDeleteBuffers(1, &id);
 	*vb = 0;
 }
@@ -141,15 +147,17 @@ void* Gfx_LockDynamicVb(GfxResourceID vb, VertexFormat fmt, int count) {
 	return FastAllocTempMem(count * strideSizes[fmt]);
 }
 
+/* Respecifying the whole buffer's storage lets the driver 'orphan' the old storage that */
+/*  the GPU may still be using for previous draws, instead of stalling until they finish */
 void Gfx_UnlockDynamicVb(GfxResourceID vb) {
 	glBindBuffer(GL_ARRAY_BUFFER, ptr_to_uint(vb));
-	glBufferSubData(GL_ARRAY_BUFFER, 0, tmpSize, tmpData);
+	glBufferData(GL_ARRAY_BUFFER, tmpSize, tmpData, GL_DYNAMIC_DRAW);
 }
 
 void Gfx_SetDynamicVbData(GfxResourceID vb, void* vertices, int vCount) {
 	cc_uint32 size = vCount * gfx_stride;
 	glBindBuffer(GL_ARRAY_BUFFER, ptr_to_uint(vb));
-	glBufferSubData(GL_ARRAY_BUFFER, 0, size, vertices);
+	glBufferData(GL_ARRAY_BUFFER, size, vertices, GL_DYNAMIC_DRAW);
 }
 
 
@@ -161,15 +169,22 @@ void Gfx_SetDynamicVbData(GfxResourceID vb, void* vertices, int vCount) {
 #define FTR_TEX_OFFSET (1 << 2)
 #define FTR_LINEAR_FOG (1 << 3)
 #define FTR_DENSIT_FOG (1 << 4)
+#define FTR_CHUNK_UV   (1 << 5)
+#define FTR_MODEL_PART (1 << 6)
 #define FTR_HASANY_FOG (FTR_LINEAR_FOG | FTR_DENSIT_FOG)
 #define FTR_FS_MEDIUMP (1 << 7)
+#define FTR_BILLBOARD  (1 << 8)
 
 #define UNI_MVP_MATRIX (1 << 0)
 #define UNI_TEX_OFFSET (1 << 1)
 #define UNI_FOG_COL    (1 << 2)
 #define UNI_FOG_END    (1 << 3)
 #define UNI_FOG_DENS   (1 << 4)
-#define UNI_MASK_ALL   0x1F
+#define UNI_LAYER_OFFS (1 << 5)
+#define UNI_MODEL_PART (1 << 6)
+#define UNI_BILLBOARD  (1 << 7)
+#define UNI_LIGHT_COLS (1 << 8)
+#define UNI_MASK_ALL   0x1FF
 
 /* cached uniforms (cached for multiple programs */
 static struct Matrix _view, _proj, _mvp;
@@ -178,14 +193,23 @@ static float _texX, _texY;
 static PackedCol gfx_fogColor;
 static float gfx_fogEnd = -1.0f, gfx_fogDensity = -1.0f;
 static int gfx_fogMode = -1;
+static float gfx_layerFirst = 65536.0f;
+static float gfx_layerOffsets[GFX_MAX_LAYER_OFFSETS];
+static cc_bool gfx_modelParts;
+static int gfx_partsCount;
+static struct Matrix gfx_parts[GFX_MAX_MODEL_PARTS];
+static float gfx_partCols[FACE_COUNT * 4];
+static float gfx_partUV[4];
+static cc_bool gfx_billboards;
+static PackedCol gfx_sunCol = PACKEDCOL_WHITE, gfx_shadowCol = PACKEDCOL_WHITE;
 
 /* shader programs (emulate fixed function) */
 static struct GLShader {
 	int features;     /* what features are enabled for this shader */
 	int uniforms;     /* which associated uniforms need to be resent to GPU */
 	GLuint program;   /* OpenGL program ID (0 if not yet compiled) */
-	int locations[5]; /* location of uniforms (not constant) */
-} shaders[6 * 3] = {
+	int locations[14]; /* location of uniforms (not constant) */
+} shaders[12 * 3] = {
 	/* no fog */
 	{ 0              },
 	{ 0              | FTR_ALPHA_TEST },
@@ -193,6 +217,12 @@ static struct GLShader {
 	{ FTR_TEXTURE_UV | FTR_ALPHA_TEST },
 	{ FTR_TEXTURE_UV | FTR_TEX_OFFSET },
 	{ FTR_TEXTURE_UV | FTR_TEX_OFFSET | FTR_ALPHA_TEST },
+	{ FTR_TEXTURE_UV | FTR_CHUNK_UV },
+	{ FTR_TEXTURE_UV | FTR_CHUNK_UV   | FTR_ALPHA_TEST },
+	{ FTR_TEXTURE_UV | FTR_MODEL_PART },
+	{ FTR_TEXTURE_UV | FTR_MODEL_PART | FTR_ALPHA_TEST },
+	{ FTR_TEXTURE_UV | FTR_BILLBOARD },
+	{ FTR_TEXTURE_UV | FTR_BILLBOARD  | FTR_ALPHA_TEST },
 	/* linear fog */
 	{ FTR_LINEAR_FOG | 0              },
 	{ FTR_LINEAR_FOG | 0              | FTR_ALPHA_TEST },
@@ -200,6 +230,12 @@ static struct GLShader {
 	{ FTR_LINEAR_FOG | FTR_TEXTURE_UV | FTR_ALPHA_TEST },
 	{ FTR_LINEAR_FOG | FTR_TEXTURE_UV | FTR_TEX_OFFSET },
 	{ FTR_LINEAR_FOG | FTR_TEXTURE_UV | FTR_TEX_OFFSET | FTR_ALPHA_TEST },
+	{ FTR_LINEAR_FOG | FTR_TEXTURE_UV | FTR_CHUNK_UV },
+	{ FTR_LINEAR_FOG | FTR_TEXTURE_UV | FTR_CHUNK_UV   | FTR_ALPHA_TEST },
+	{ FTR_LINEAR_FOG | FTR_TEXTURE_UV | FTR_MODEL_PART },
+	{ FTR_LINEAR_FOG | FTR_TEXTURE_UV | FTR_MODEL_PART | FTR_ALPHA_TEST },
+	{ FTR_LINEAR_FOG | FTR_TEXTURE_UV | FTR_BILLBOARD },
+	{ FTR_LINEAR_FOG | FTR_TEXTURE_UV | FTR_BILLBOARD  | FTR_ALPHA_TEST },
 	/* density fog */
 	{ FTR_DENSIT_FOG | 0              },
 	{ FTR_DENSIT_FOG | 0              | FTR_ALPHA_TEST },
@@ -207,6 +243,12 @@ static struct GLShader {
 	{ FTR_DENSIT_FOG | FTR_TEXTURE_UV | FTR_ALPHA_TEST },
 	{ FTR_DENSIT_FOG | FTR_TEXTURE_UV | FTR_TEX_OFFSET },
 	{ FTR_DENSIT_FOG | FTR_TEXTURE_UV | FTR_TEX_OFFSET | FTR_ALPHA_TEST },
+	{ FTR_DENSIT_FOG | FTR_TEXTURE_UV | FTR_CHUNK_UV },
+	{ FTR_DENSIT_FOG | FTR_TEXTURE_UV | FTR_CHUNK_UV   | FTR_ALPHA_TEST },
+	{ FTR_DENSIT_FOG | FTR_TEXTURE_UV | FTR_MODEL_PART },
+	{ FTR_DENSIT_FOG | FTR_TEXTURE_UV | FTR_MODEL_PART | FTR_ALPHA_TEST },
+	{ FTR_DENSIT_FOG | FTR_TEXTURE_UV | FTR_BILLBOARD },
+	{ FTR_DENSIT_FOG | FTR_TEXTURE_UV | FTR_BILLBOARD  | FTR_ALPHA_TEST },
 };
 static struct GLShader* gfx_activeShader;
 
@@ -214,20 +256,70 @@ static struct GLShader* gfx_activeShader;
 static void GenVertexShader(const struct GLShader* shader, cc_string* dst) {
 	int uv = shader->features & FTR_TEXTURE_UV;
 	int tm = shader->features & FTR_TEX_OFFSET;
-
-	String_AppendConst(dst,         "attribute vec3 in_pos;\n");
+	int ck = shader->features & FTR_CHUNK_UV;
+	int mp = shader->features & FTR_MODEL_PART;
+	int bb = shader->features & FTR_BILLBOARD;
+	/* Layer of chunk vertices is stored in the 4th component of position */
+	int ta = ck && Gfx.SupportsTextureArrays;
+
+	/* Size of billboards is stored in the 4th component of position, and their whole texture rectangle in UV */
+	if (ta || bb) String_AppendConst(dst, "attribute vec4 in_pos;\n");
+	else          String_AppendConst(dst, "attribute vec3 in_pos;\n");
 	String_AppendConst(dst,         "attribute vec4 in_col;\n");
-	if (uv) String_AppendConst(dst, "attribute vec2 in_uv;\n");
+	if (bb)      String_AppendConst(dst, "attribute vec4 in_uv;\n");
+	else if (uv) String_AppendConst(dst, "attribute vec2 in_uv;\n");
+	if (bb) String_AppendConst(dst, "attribute vec2 in_corner;\n");
 	String_AppendConst(dst,         "varying vec4 out_col;\n");
-	if (uv) String_AppendConst(dst, "varying vec2 out_uv;\n");
+	if (ta) String_AppendConst(dst, "varying vec3 out_uv;\n");
+	else if (uv) String_AppendConst(dst, "varying vec2 out_uv;\n");
 	String_AppendConst(dst,         "uniform mat4 mvp;\n");
 	if (tm) String_AppendConst(dst, "uniform vec2 texOffset;\n");
+	/* Array size must match GFX_MAX_LAYER_OFFSETS */
+	if (ta) String_AppendConst(dst, "uniform float layerFirst;\n");
+	if (ta) String_AppendConst(dst, "uniform float layerOffsets[32];\n");
+	/* Array sizes must match GFX_MAX_MODEL_PARTS and FACE_COUNT */
+	if (mp) String_AppendConst(dst, "uniform mat4 partMats[16];\n");
+	if (mp) String_AppendConst(dst, "uniform vec4 partCols[6];\n");
+	if (mp) String_AppendConst(dst, "uniform vec4 partUV;\n");
+	if (bb) String_AppendConst(dst, "uniform vec3 bbRight;\n");
+	if (bb) String_AppendConst(dst, "uniform vec3 bbUp;\n");
+	if (ck) String_AppendConst(dst, "uniform vec3 sunCol;\n");
+	if (ck) String_AppendConst(dst, "uniform vec3 shadowCol;\n");
 
 	String_AppendConst(dst,         "void main() {\n");
-	String_AppendConst(dst,         "  gl_Position = mvp * vec4(in_pos, 1.0);\n");
-	String_AppendConst(dst,         "  out_col = in_col;\n");
-	if (uv) String_AppendConst(dst, "  out_uv  = in_uv;\n");
-	if (tm) String_AppendConst(dst, "  out_uv  = out_uv + texOffset;\n");
+	if (bb) {
+		String_AppendConst(dst,     "  float s  = in_pos.w * 0.5;\n");
+		String_AppendConst(dst,     "  vec3 pos = in_pos.xyz + vec3(0.0, s, 0.0) + (bbRight * in_corner.x + bbUp * in_corner.y) * s;\n");
+		String_AppendConst(dst,     "  gl_Position = mvp * vec4(pos, 1.0);\n");
+		String_AppendConst(dst,     "  out_col = in_col;\n");
+		String_AppendConst(dst,     "  out_uv  = mix(in_uv.xw, in_uv.zy, in_corner * 0.5 + 0.5);\n");
+		String_AppendConst(dst,     "}");
+		return;
+	}
+
+	if (mp) {
+		String_AppendConst(dst,     "  gl_Position = mvp * (partMats[int(in_col.r * 255.0 + 0.5)] * vec4(in_pos.xyz, 1.0));\n");
+		String_AppendConst(dst,     "  out_col = mix(partCols[int(in_col.g * 255.0 + 0.5)], vec4(1.0), in_col.b);\n");
+	} else {
+		String_AppendConst(dst,     "  gl_Position = mvp * vec4(in_pos.xyz, 1.0);\n");
+		String_AppendConst(dst,     "  out_col = in_col;\n");
+	}
+	/* Alpha of chunk vertex colours is 0 for shadow, 127 for sun, and 255 for colours that are already lit */
+	if (ck) {
+		String_AppendConst(dst,     "  float lit = in_col.a * (255.0 / 127.0);\n");
+		String_AppendConst(dst,     "  vec3 light = mix(mix(shadowCol, sunCol, min(lit, 1.0)), vec3(1.0), clamp(lit - 1.0, 0.0, 1.0));\n");
+		String_AppendConst(dst,     "  out_col = vec4(in_col.rgb * light, 1.0);\n");
+	}
+	/* Scale packed chunk texture coordinates by 1/CHUNKVERTEX_U_SCALE and 1/CHUNKVERTEX_V_SCALE */
+	if (ta) { 
+		String_AppendConst(dst,     "  out_uv  = vec3(in_uv * vec2(1.0 / 1024.0, 1.0 / 16384.0), in_pos.w);\n");
+		String_AppendConst(dst,     "  if (in_pos.w >= layerFirst) out_uv.y += layerOffsets[int(in_pos.w - layerFirst)];\n");
+	} else {
+		if (uv) String_AppendConst(dst, "  out_uv  = in_uv;\n");
+		if (tm) String_AppendConst(dst, "  out_uv  = out_uv + texOffset;\n");
+		if (ck) String_AppendConst(dst, "  out_uv  = out_uv * vec2(1.0 / 1024.0, 1.0 / 16384.0);\n");
+		if (mp) String_AppendConst(dst, "  out_uv  = out_uv * partUV.xy + partUV.zw;\n");
+	}
 	String_AppendConst(dst,         "}");
 }
 
@@ -247,6 +339,8 @@ static void GenFragmentShader(const struct GLShader* shader, cc_string* dst) {
 	int fl = shader->features & FTR_LINEAR_FOG;
 	int fd = shader->features & FTR_DENSIT_FOG;
 	int fm = shader->features & FTR_HASANY_FOG;
+	int ta = (shader->features & FTR_CHUNK_UV) && Gfx.SupportsTextureArrays;
+	if (ta) String_AppendConst(dst, "#extension GL_EXT_texture_array : require\n");
 
 #ifdef CC_BUILD_GLES
 	int mp = shader->features & FTR_FS_MEDIUMP;
@@ -255,15 +349,21 @@ static void GenFragmentShader(const struct GLShader* shader, cc_string* dst) {
 #endif
 
 	String_AppendConst(dst,         "varying vec4 out_col;\n");
-	if (uv) String_AppendConst(dst, "varying vec2 out_uv;\n");
-	if (uv) String_AppendConst(dst, "uniform sampler2D texImage;\n");
+	if (ta) {
+		String_AppendConst(dst,     "varying vec3 out_uv;\n");
+		String_AppendConst(dst,     "uniform sampler2DArray texImage;\n");
+	} else if (uv) {
+		String_AppendConst(dst,     "varying vec2 out_uv;\n");
+		String_AppendConst(dst,     "uniform sampler2D texImage;\n");
+	}
 	if (fm) String_AppendConst(dst, "uniform vec3 fogCol;\n");
 	if (fl) String_AppendConst(dst, "uniform float fogEnd;\n");
 	if (fd) String_AppendConst(dst, "uniform float fogDensity;\n");
 
 	String_AppendConst(dst,         "void main() {\n");
-	if (uv) String_AppendConst(dst, "  vec4 col = texture2D(texImage, out_uv) * out_col;\n");
-	else    String_AppendConst(dst, "  vec4 col = out_col;\n");
+	if (ta)      String_AppendConst(dst, "  vec4 col = texture2DArray(texImage, out_uv) * out_col;\n");
+	else if (uv) String_AppendConst(dst, "  vec4 col = texture2D(texImage, out_uv) * out_col;\n");
+	else         String_AppendConst(dst, "  vec4 col = out_col;\n");
 	if (al) String_AppendConst(dst, "  if (col.a < 0.5) discard;\n");
 	if (fm) String_AppendConst(dst, "  float depth = 1.0 / gl_FragCoord.w;\n");
 	if (fl) String_AppendConst(dst, "  float f = clamp((fogEnd - depth) / fogEnd, 0.0, 1.0);\n");
@@ -304,6 +404,224 @@ static void ShaderFailed(GLint shader) {
 	Process_Abort("Failed to compile shader");
 }
 
+static void GetUniformLocations(struct GLShader* shader, GLuint program) {
+	shader->locations[0] = glGetUniformLocation(program, "mvp");
+	shader->locations[1] = glGetUniformLocation(program, "texOffset");
+	shader->locations[2] = glGetUniformLocation(program, "fogCol");
+	shader->locations[3] = glGetUniformLocation(program, "fogEnd");
+	shader->locations[4] = glGetUniformLocation(program, "fogDensity");
+	shader->locations[5] = glGetUniformLocation(program, "layerFirst");
+	shader->locations[6] = glGetUniformLocation(program, "layerOffsets");
+	shader->locations[7] = glGetUniformLocation(program, "partMats");
+	shader->locations[8] = glGetUniformLocation(program, "partCols");
+	shader->locations[9] = glGetUniformLocation(program, "partUV");
+	shader->locations[10] = glGetUniformLocation(program, "bbRight");
+	shader->locations[11] = glGetUniformLocation(program, "bbUp");
+	shader->locations[12] = glGetUniformLocation(program, "sunCol");
+	shader->locations[13] = glGetUniformLocation(program, "shadowCol");
+}
+
+
+/*########################################################################################################################*
+*--------------------------------------------------Program binary cache---------------------------------------------------*
+*#########################################################################################################################*/
+/* Linked programs are saved to disc, so later sessions can skip compiling GLSL */
+/* NOTE: Binaries are only valid for the exact same driver, so the cache is keyed by driver strings */
+#define _GL_PROGRAM_BINARY_RETRIEVABLE_HINT 0x8257
+#define _GL_PROGRAM_BINARY_LENGTH           0x8741
+#define _GL_NUM_PROGRAM_BINARY_FORMATS      0x87FE
+
+#define PROGCACHE_MAGIC   0x42504343UL /* "CCPB" */
+#define PROGCACHE_VERSION 2
+#define PROGCACHE_HEADER_SIZE 12
+#define PROGCACHE_ENTRY_SIZE  12
+/* Binaries larger than this are assumed to be from a corrupted file */
+#define PROGCACHE_MAX_BINARY (4 * 1024 * 1024)
+
+static void (APIENTRY *_glGetProgramBinary)(GLuint program, GLsizei bufSize, GLsizei* length, GLenum* binaryFormat, void* binary);
+static void (APIENTRY *_glProgramBinary)(GLuint program, GLenum binaryFormat, const void* binary, GLsizei length);
+static void (APIENTRY *_glProgramParameteri)(GLuint program, GLenum pname, GLint value);
+static cc_bool progCacheSupported;
+static cc_string progCachePath; static char progCachePathBuffer[FILENAME_SIZE];
+
+static void GL_InitProgramCache(void) {
+	static const struct DynamicLibSym coreFuncs[] = {
+		DynamicLib_ReqSym(glGetProgramBinary), DynamicLib_ReqSym(glProgramBinary),
+		DynamicLib_OptSym(glProgramParameteri)
+	};
+	static const struct DynamicLibSym extFuncs[]  = {
+		DynamicLib_ReqSym2("glGetProgramBinaryOES", glGetProgramBinary),
+		DynamicLib_ReqSym2("glProgramBinaryOES",    glProgramBinary)
+	};
+	static const cc_string arbExt = String_FromConst("GL_ARB_get_program_binary");
+	static const cc_string oesExt = String_FromConst("GL_OES_get_program_binary");
+	cc_string extensions = String_FromReadonly((const char*)glGetString(GL_EXTENSIONS));
+	const char* ver      = (const char*)glGetString(GL_VERSION);
+	GLint formats = 0;
+
+#ifdef CC_BUILD_GLES
+	/* e.g. "OpenGL ES 3.0 ..." */
+	static const cc_string esVer = String_FromConst("OpenGL ES ");
+	cc_string version = String_FromReadonly(ver);
+	cc_bool core = String_CaselessStarts(&version, &esVer) && version.length > 10 && ver[10] >= '3';
+#else
+	/* Supported in core since 4.1 */
+	cc_bool core = ver[0] > '4' || (ver[0] == '4' && ver[2] >= '1');
+#endif
+
+	if (core || String_CaselessContains(&extensions, &arbExt)) {
+		GLContext_GetAll(coreFuncs, Array_Elems(coreFuncs));
+	} else if (String_CaselessContains(&extensions, &oesExt)) {
+		GLContext_GetAll(extFuncs,  Array_Elems(extFuncs));
+	}
+	if (!_glGetProgramBinary || !_glProgramBinary) return;
+
+	/* Drivers are allowed to support the functions without supporting any binary formats */
+	glGetIntegerv(_GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+	progCacheSupported = formats > 0;
+}
+
+/* Generated shader source also depends on the post processing mode */
+static void ProgramCache_MakePath(void) {
+	cc_string key; char keyBuffer[1024];
+	String_InitArray(key, keyBuffer);
+	String_AppendConst(&key, (const char*)glGetString(GL_VENDOR));
+	String_Append(&key, '|');
+	String_AppendConst(&key, (const char*)glGetString(GL_RENDERER));
+	String_Append(&key, '|');
+	String_AppendConst(&key, (const char*)glGetString(GL_VERSION));
+	String_Format1(&key, "|%i", &postProcess);
+
+	String_InitArray(progCachePath, progCachePathBuffer);
+	String_AppendConst(&progCachePath, "shadercache/");
+	String_AppendUInt32(&progCachePath, Utils_CRC32((const cc_uint8*)key.buffer, key.length));
+	String_AppendConst(&progCachePath, ".bin");
+}
+
+static cc_bool ProgramCache_Link(struct GLShader* shader, GLenum format, const void* binary, int length) {
+	GLuint program = glCreateProgram();
+	GLint linked   = 0;
+	if (!program) return false;
+
+	/* Driver may reject the binary (e.g. driver was updated), in which case the program is compiled instead */
+	_glProgramBinary(program, format, binary, length);
+	glGetProgramiv(program, GL_LINK_STATUS, &linked);
+	if (!linked) { glDeleteProgram(program); return false; }
+
+	shader->program = program;
+	GetUniformLocations(shader, program);
+	return true;
+}
+
+static cc_result ProgramCache_ReadFrom(struct Stream* s) {
+	cc_uint8 header[PROGCACHE_HEADER_SIZE];
+	cc_uint32 i, count, features, format, length;
+	int j;
+	void* binary;
+	cc_result res;
+
+	if ((res = Stream_Read(s, header, PROGCACHE_HEADER_SIZE))) return res;
+	/* Cache from an older version is silently ignored */
+	if (Stream_GetU32_LE(&header[0]) != PROGCACHE_MAGIC)   return 0;
+	if (Stream_GetU32_LE(&header[4]) != PROGCACHE_VERSION) return 0;
+	count = Stream_GetU32_LE(&header[8]);
+
+	for (i = 0; i < count; i++) {
+		if ((res = Stream_Read(s, header, PROGCACHE_ENTRY_SIZE))) return res;
+		features = Stream_GetU32_LE(&header[0]);
+		format   = Stream_GetU32_LE(&header[4]);
+		length   = Stream_GetU32_LE(&header[8]);
+		if (length > PROGCACHE_MAX_BINARY) return ERR_INVALID_ARGUMENT;
+
+		binary = Mem_TryAlloc(length, 1);
+		if (!binary) return ERR_OUT_OF_MEMORY;
+		if ((res = Stream_Read(s, (cc_uint8*)binary, length))) { Mem_Free(binary); return res; }
+
+		for (j = 0; j < Array_Elems(shaders); j++) {
+			if ((shaders[j].features & ~FTR_FS_MEDIUMP) != (features & ~FTR_FS_MEDIUMP)) continue;
+			if (shaders[j].program) break;
+
+			/* Keep medium precision flag, in case program needs to be compiled again later */
+			if (ProgramCache_Link(&shaders[j], format, binary, length)) shaders[j].features = features;
+			break;
+		}
+		Mem_Free(binary);
+	}
+	return 0;
+}
+
+static cc_result ProgramCache_WriteTo(struct Stream* s) {
+	cc_uint8 header[PROGCACHE_HEADER_SIZE];
+	GLint length;
+	GLenum format;
+	void* binary;
+	int i, count = 0;
+	cc_result res;
+
+	for (i = 0; i < Array_Elems(shaders); i++) {
+		if (shaders[i].program) count++;
+	}
+	Stream_SetU32_LE(&header[0], PROGCACHE_MAGIC);
+	Stream_SetU32_LE(&header[4], PROGCACHE_VERSION);
+	Stream_SetU32_LE(&header[8], count);
+	if ((res = Stream_Write(s, header, PROGCACHE_HEADER_SIZE))) return res;
+
+	for (i = 0; i < Array_Elems(shaders); i++) {
+		if (!shaders[i].program) continue;
+		length = 0; format = 0;
+		glGetProgramiv(shaders[i].program, _GL_PROGRAM_BINARY_LENGTH, &length);
+
+		binary = length > 0 ? Mem_TryAlloc(length, 1) : NULL;
+		if (binary) _glGetProgramBinary(shaders[i].program, length, &length, &format, binary);
+		/* An empty entry is still written, as the header already includes it in the count */
+		if (!binary) length = 0;
+
+		Stream_SetU32_LE(&header[0], shaders[i].features);
+		Stream_SetU32_LE(&header[4], format);
+		Stream_SetU32_LE(&header[8], length);
+		res = Stream_Write(s, header, PROGCACHE_ENTRY_SIZE);
+		if (!res && length) res = Stream_Write(s, (const cc_uint8*)binary, length);
+
+		Mem_Free(binary);
+		if (res) return res;
+	}
+	return 0;
+}
+
+static void ProgramCache_Load(void) {
+	cc_uint8 buffer[8192];
+	struct Stream stream, buffered;
+	cc_result res;
+	if (!progCacheSupported) return;
+
+	ProgramCache_MakePath();
+	res = Stream_OpenFile(&stream, &progCachePath);
+	if (res == ReturnCode_FileNotFound) return;
+	if (res) { Logger_SysWarn2(res, "opening", &progCachePath); return; }
+
+	Stream_ReadonlyBuffered(&buffered, &stream, buffer, sizeof(buffer));
+	res = ProgramCache_ReadFrom(&buffered);
+	if (res) Logger_SysWarn2(res, "reading", &progCachePath);
+	(void)stream.Close(&stream);
+}
+
+static void ProgramCache_Save(void) {
+	struct Stream stream;
+	cc_result res;
+	if (!progCacheSupported || !Utils_EnsureDirectory("shadercache")) return;
+
+	res = Stream_CreateFile(&stream, &progCachePath);
+	if (res) { Logger_SysWarn2(res, "creating", &progCachePath); return; }
+
+	res = ProgramCache_WriteTo(&stream);
+	if (res) Logger_SysWarn2(res, "writing", &progCachePath);
+	(void)stream.Close(&stream);
+}
+
+
+/*########################################################################################################################*
+*---------------------------------------------------------Programs--------------------------------------------------------*
+*#########################################################################################################################*/
 /* Tries to compile vertex and fragment shaders, then link into an OpenGL program */
 static void CompileProgram(struct GLShader* shader) {
 	char tmpBuffer[2048]; cc_string tmp;
@@ -346,7 +664,10 @@ static void CompileProgram(struct GLShader* shader) {
 	glBindAttribLocation(program, 0, "in_pos");
 	glBindAttribLocation(program, 1, "in_col");
 	glBindAttribLocation(program, 2, "in_uv");
+	glBindAttribLocation(program, 3, "in_corner");
 
+	if (progCacheSupported && _glProgramParameteri)
+		_glProgramParameteri(program, _GL_PROGRAM_BINARY_RETRIEVABLE_HINT, true);
 	glLinkProgram(program);
 	glGetProgramiv(program, GL_LINK_STATUS, &temp);
 
@@ -357,11 +678,7 @@ static void CompileProgram(struct GLShader* shader) {
 		glDeleteShader(vs);
 		glDeleteShader(fs);
 
-		shader->locations[0] = glGetUniformLocation(program, "mvp");
-		shader->locations[1] = glGetUniformLocation(program, "texOffset");
-		shader->locations[2] = glGetUniformLocation(program, "fogCol");
-		shader->locations[3] = glGetUniformLocation(program, "fogEnd");
-		shader->locations[4] = glGetUniformLocation(program, "fogDensity");
+		GetUniformLocations(shader, program);
 		return;
 	}
 	temp = 0;
@@ -375,6 +692,23 @@ static void CompileProgram(struct GLShader* shader) {
 	Process_Abort("Failed to compile program");
 }
 
+/* Compiles every program upfront, so that none need to be compiled in the middle of rendering */
+static void CompilePrograms(void) {
+	cc_bool compiled = false;
+	int i;
+	ProgramCache_Load();
+
+	for (i = 0; i < Array_Elems(shaders); i++) {
+		if (shaders[i].program) continue;
+		/* Billboard programs are never used if instancing isn't supported */
+		if ((shaders[i].features & FTR_BILLBOARD) && !Gfx.SupportsBillboards) continue;
+
+		CompileProgram(&shaders[i]);
+		compiled = true;
+	}
+	if (compiled) ProgramCache_Save();
+}
+
 /* Marks a uniform as changed on all programs */
 static void DirtyUniform(int uniform) {
 	int i;
@@ -411,6 +745,29 @@ static void ReloadUniforms(void) {
 		glUniform1f(s->locations[4], -gfx_fogDensity);
 		s->uniforms &= ~UNI_FOG_DENS;
 	}
+	if ((s->uniforms & UNI_LAYER_OFFS) && (s->features & FTR_CHUNK_UV) && Gfx.SupportsTextureArrays) {
+		glUniform1f(s->locations[5], gfx_layerFirst);
+		glUniform1fv(s->locations[6], GFX_MAX_LAYER_OFFSETS, gfx_layerOffsets);
+		s->uniforms &= ~UNI_LAYER_OFFS;
+	}
+	if ((s->uniforms & UNI_MODEL_PART) && (s->features & FTR_MODEL_PART)) {
+		glUniformMatrix4fv(s->locations[7], gfx_partsCount, false, (float*)gfx_parts);
+		glUniform4fv(s->locations[8], FACE_COUNT, gfx_partCols);
+		glUniform4fv(s->locations[9], 1, gfx_partUV);
+		s->uniforms &= ~UNI_MODEL_PART;
+	}
+	if ((s->uniforms & UNI_BILLBOARD) && (s->features & FTR_BILLBOARD)) {
+		glUniform3f(s->locations[10], _view.row1.x, _view.row2.x, _view.row3.x);
+		glUniform3f(s->locations[11], _view.row1.y, _view.row2.y, _view.row3.y);
+		s->uniforms &= ~UNI_BILLBOARD;
+	}
+	if ((s->uniforms & UNI_LIGHT_COLS) && (s->features & FTR_CHUNK_UV)) {
+		glUniform3f(s->locations[12], PackedCol_R(gfx_sunCol) / 255.0f, PackedCol_G(gfx_sunCol) / 255.0f,
+									 PackedCol_B(gfx_sunCol) / 255.0f);
+		glUniform3f(s->locations[13], PackedCol_R(gfx_shadowCol) / 255.0f, PackedCol_G(gfx_shadowCol) / 255.0f,
+									 PackedCol_B(gfx_shadowCol) / 255.0f);
+		s->uniforms &= ~UNI_LIGHT_COLS;
+	}
 }
 
 /* Switches program to one that duplicates current fixed function state */
@@ -420,12 +777,20 @@ static void SwitchProgram(void) {
 	int index = 0;
 
 	if (gfx_fogEnabled) {
-		index += 6;                       /* linear fog */
-		if (gfx_fogMode >= 1) index += 6; /* exp fog */
+		index += 12;                       /* linear fog */
+		if (gfx_fogMode >= 1) index += 12; /* exp fog */
 	}
 
-	if (gfx_format == VERTEX_FORMAT_TEXTURED) index += 2;
-	if (gfx_texTransform) index += 2;
+	if (gfx_billboards) {
+		index += 10;
+	} else if (gfx_format == VERTEX_FORMAT_TEXTURED && gfx_modelParts) {
+		index += 8;
+	} else if (gfx_format == VERTEX_FORMAT_TEXTURED) {
+		index += 2;
+		if (gfx_texTransform) index += 2;
+	} else if (gfx_format == VERTEX_FORMAT_CHUNK) {
+		index += 6;
+	}
 	if (gfx_alphaTest)    index += 1;
 
 	shader = &shaders[index];
@@ -451,10 +816,145 @@ void Gfx_BindTexture(GfxResourceID texId) {
 }
 
 
+/*########################################################################################################################*
+*------------------------------------------------------Texture arrays-----------------------------------------------------*
+*#########################################################################################################################*/
+#ifndef CC_BUILD_GLES
+#define _GL_TEXTURE_2D_ARRAY 0x8C1A
+static void (APIENTRY *_glTexImage3D)(GLenum target, GLint level, GLint internalFormat, GLsizei width, GLsizei height, 
+								GLsizei depth, GLint border, GLenum format, GLenum type, const void* pixels);
+static void (APIENTRY *_glTexSubImage3D)(GLenum target, GLint level, GLint xoffset, GLint yoffset, GLint zoffset, 
+								GLsizei width, GLsizei height, GLsizei depth, GLenum format, GLenum type, const void* pixels);
+static void (APIENTRY *_glCompressedTexImage3D)(GLenum target, GLint level, GLenum internalFormat, GLsizei width, GLsizei height, 
+								GLsizei depth, GLint border, GLsizei imageSize, const void* data);
+static void (APIENTRY *_glCompressedTexSubImage3D)(GLenum target, GLint level, GLint xoffset, GLint yoffset, GLint zoffset, 
+								GLsizei width, GLsizei height, GLsizei depth, GLenum format, GLsizei imageSize, const void* data);
+
+static void GL_InitTextureArrays(void) {
+	static const struct DynamicLibSym funcs[] = {
+		DynamicLib_ReqSym(glTexImage3D), DynamicLib_ReqSym(glTexSubImage3D),
+		DynamicLib_OptSym(glCompressedTexImage3D), DynamicLib_OptSym(glCompressedTexSubImage3D)
+	};
+	static const cc_string arrayExt = String_FromConst("GL_EXT_texture_array");
+	cc_string extensions = String_FromReadonly((const char*)glGetString(GL_EXTENSIONS));
+
+	if (!String_CaselessContains(&extensions, &arrayExt)) return;
+	GLContext_GetAll(funcs, Array_Elems(funcs));
+	Gfx.SupportsTextureArrays = _glTexImage3D && _glTexSubImage3D;
+}
+
+GfxResourceID Gfx_CreateTextureArray(int width, int height, int layers, cc_uint8 flags, cc_bool mipmaps) {
+	GfxResourceID texId = NULL;
+	GLint filter = (flags & TEXTURE_FLAG_BILINEAR) ? GL_LINEAR : GL_NEAREST;
+	int lvl, lvls = mipmaps ? CalcMipmapsLevels(width, height) : 0;
+	GLenum format = 0;
+
+	/* Contents aren't known yet, so always use DXT5 in case some pixels are translucent */
+	if ((flags & TEXTURE_FLAG_COMPRESSED) && Gfx.CompressTextures && Gfx.SupportsCompressedTextures 
+			&& _glCompressedTexImage3D && _glCompressedTexSubImage3D) {
+		format = _GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+	}
+
+	glGenTextures(1, (GLuint*)&texId);
+	glBindTexture(_GL_TEXTURE_2D_ARRAY, ptr_to_uint(texId));
+	glTexParameteri(_GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, filter);
+	glTexParameteri(_GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, mipmaps ? GL_NEAREST_MIPMAP_LINEAR : filter);
+	glTexParameteri(_GL_TEXTURE_2D_ARRAY, _GL_TEXTURE_MAX_LEVEL, lvls);
+
+	/* Storage for all mipmap levels has to be allocated upfront */
+	for (lvl = 0; lvl <= lvls; lvl++) {
+		if (format) {
+			_glCompressedTexImage3D(_GL_TEXTURE_2D_ARRAY, lvl, format, width, height, layers, 0, 
+									DXT_CalcSize(format, width, height) * layers, NULL);
+		} else {
+			_glTexImage3D(_GL_TEXTURE_2D_ARRAY, lvl, GL_RGBA, width, height, layers, 0, PIXEL_FORMAT, TRANSFER_FORMAT, NULL);
+		}
+		if (width  > 1) width  /= 2;
+		if (height > 1) height /= 2;
+	}
+	return texId;
+}
+
+static void UpdateTextureLayer(GLenum format, int lvl, int layer, int x, int y, struct Bitmap* part, int rowWidth) {
+	void* ptr = part->scan0;
+	int size;
+
+	if (format) {
+		ptr = DXT_EncodeTemp(format, x, y, part, rowWidth, false, &size);
+		if (!ptr) return;
+
+		_glCompressedTexSubImage3D(_GL_TEXTURE_2D_ARRAY, lvl, x, y, layer, part->width, part->height, 1, format, size, ptr);
+		Mem_Free(ptr);
+		return;
+	}
+
+	if (part->width != rowWidth) {
+		ptr = Mem_Alloc(part->width * part->height, BITMAPCOLOR_SIZE, "Gfx_UpdateTextureLayer temp");
+		CopyTextureData(ptr, part->width * BITMAPCOLOR_SIZE,
+						part, rowWidth   * BITMAPCOLOR_SIZE);
+	}
+
+	_glTexSubImage3D(_GL_TEXTURE_2D_ARRAY, lvl, x, y, layer, part->width, part->height, 1, PIXEL_FORMAT, TRANSFER_FORMAT, ptr);
+	if (ptr != part->scan0) Mem_Free(ptr);
+}
+
+void Gfx_UpdateTextureLayer(GfxResourceID texId, int layer, int x, int y, struct Bitmap* part, int rowWidth, cc_bool mipmaps) {
+	BitmapCol* prev = part->scan0;
+	BitmapCol* cur;
+	struct Bitmap mip;
+	int lvl, lvls, width = part->width, height = part->height;
+	GLenum format;
+
+	glBindTexture(_GL_TEXTURE_2D_ARRAY, ptr_to_uint(texId));
+	format = DXT_GetFormat(_GL_TEXTURE_2D_ARRAY);
+	UpdateTextureLayer(format, 0, layer, x, y, part, rowWidth);
+	if (!mipmaps || GL_GenerateMipmaps(_GL_TEXTURE_2D_ARRAY, format)) return;
+
+	lvls = CalcMipmapsLevels(width, height);
+	cur  = GetMipmapsTemp(width, height);
+	for (lvl = 1; lvl <= lvls; lvl++) {
+		x /= 2; y /= 2;
+		if (width > 1)  width /= 2;
+		if (height > 1) height /= 2;
+
+		GenMipmaps(width, height, cur, prev, rowWidth);
+		Bitmap_Init(mip, width, height, cur);
+		UpdateTextureLayer(format, lvl, layer, x, y, &mip, width);
+
+		prev     = cur;
+		cur     += width * height;
+		rowWidth = width;
+	}
+}
+
+void Gfx_BindTextureArray(GfxResourceID texId) {
+	glBindTexture(_GL_TEXTURE_2D_ARRAY, ptr_to_uint(texId));
+}
+
+void Gfx_SetLayerOffsets(int first, const float* offsets, int count) {
+	int i;
+	count = min(count, GFX_MAX_LAYER_OFFSETS);
+	/* Layer of vertices is never this high, so no layers are offset */
+	gfx_layerFirst = count ? first : 65536.0f;
+
+	for (i = 0; i < count; i++) gfx_layerOffsets[i] = offsets[i];
+	DirtyUniform(UNI_LAYER_OFFS);
+	ReloadUniforms();
+}
+#else
+static void GL_InitTextureArrays(void) { }
+
+GfxResourceID Gfx_CreateTextureArray(int width, int height, int layers, cc_uint8 flags, cc_bool mipmaps) { return 0; }
+void Gfx_UpdateTextureLayer(GfxResourceID texId, int layer, int x, int y, struct Bitmap* part, int rowWidth, cc_bool mipmaps) { }
+void Gfx_BindTextureArray(GfxResourceID texId) { }
+void Gfx_SetLayerOffsets(int first, const float* offsets, int count) { }
+#endif
+
+
 /*########################################################################################################################*
 *-----------------------------------------------------State management----------------------------------------------------*
 *#########################################################################################################################*/
-void Gfx_SetFog(cc_bool enabled) { gfx_fogEnabled = enabled; SwitchProgram(); }
+static void SetFog(cc_bool enabled) { SwitchProgram(); }
 void Gfx_SetFogCol(PackedCol color) {
 	if (color == gfx_fogColor) return;
 	gfx_fogColor = color;
@@ -482,6 +982,14 @@ void Gfx_SetFogMode(FogFunc func) {
 	SwitchProgram();
 }
 
+void Gfx_SetChunkLightColors(PackedCol sun, PackedCol shadow) {
+	if (sun == gfx_sunCol && shadow == gfx_shadowCol) return;
+	gfx_sunCol    = sun;
+	gfx_shadowCol = shadow;
+	DirtyUniform(UNI_LIGHT_COLS);
+	ReloadUniforms();
+}
+
 static void SetAlphaTest(cc_bool enabled) { SwitchProgram(); }
 
 void Gfx_DepthOnlyRendering(cc_bool depthOnly) {
@@ -499,7 +1007,7 @@ void Gfx_LoadMatrix(MatrixType type, const struct Matrix* matrix) {
 	if (type == MATRIX_PROJ) _proj = *matrix;
 
 	Matrix_Mul(&_mvp, &_view, &_proj);
-	DirtyUniform(UNI_MVP_MATRIX);
+	DirtyUniform(UNI_MVP_MATRIX | UNI_BILLBOARD);
 	ReloadUniforms();
 }
 
@@ -521,11 +1029,136 @@ void Gfx_DisableTextureOffset(void) {
 	SwitchProgram();
 }
 
+void Gfx_SetModelParts(const struct Matrix* parts, int count, const PackedCol* faceCols, 
+						float uScale, float vScale, float uOffset, float vOffset) {
+	int i;
+	gfx_partsCount = min(count, GFX_MAX_MODEL_PARTS);
+	for (i = 0; i < gfx_partsCount; i++) gfx_parts[i] = parts[i];
+
+	for (i = 0; i < FACE_COUNT; i++) {
+		gfx_partCols[i * 4 + 0] = PackedCol_R(faceCols[i]) / 255.0f;
+		gfx_partCols[i * 4 + 1] = PackedCol_G(faceCols[i]) / 255.0f;
+		gfx_partCols[i * 4 + 2] = PackedCol_B(faceCols[i]) / 255.0f;
+		gfx_partCols[i * 4 + 3] = PackedCol_A(faceCols[i]) / 255.0f;
+	}
+	gfx_partUV[0] = uScale;  gfx_partUV[1] = vScale;
+	gfx_partUV[2] = uOffset; gfx_partUV[3] = vOffset;
+
+	gfx_modelParts = true;
+	DirtyUniform(UNI_MODEL_PART);
+	SwitchProgram();
+}
+
+void Gfx_DisableModelParts(void) {
+	gfx_modelParts = false;
+	SwitchProgram();
+}
+
+
+/*########################################################################################################################*
+*-------------------------------------------------------Billboards--------------------------------------------------------*
+*#########################################################################################################################*/
+static void (APIENTRY *_glVertexAttribDivisor)(GLuint index, GLuint divisor);
+static void (APIENTRY *_glDrawElementsInstanced)(GLenum mode, GLsizei count, GLenum type, const void* indices, GLsizei primcount);
+static GLuint bb_cornersVb, bb_instancesVb;
+
+static void GL_InitBillboards(void) {
+	static const struct DynamicLibSym coreFuncs[] = { 
+		DynamicLib_ReqSym(glVertexAttribDivisor), DynamicLib_ReqSym(glDrawElementsInstanced) 
+	};
+	cc_string extensions = String_FromReadonly((const char*)glGetString(GL_EXTENSIONS));
+	const GLubyte* ver   = glGetString(GL_VERSION);
+#ifdef CC_BUILD_GLES
+	static const struct DynamicLibSym extFuncs[]  = { 
+		DynamicLib_ReqSym2("glVertexAttribDivisorEXT",   glVertexAttribDivisor), 
+		DynamicLib_ReqSym2("glDrawElementsInstancedEXT", glDrawElementsInstanced) 
+	};
+	static const cc_string extExt = String_FromConst("GL_EXT_instanced_arrays");
+	/* e.g. "OpenGL ES 3.0 ..." */
+	static const cc_string esVer  = String_FromConst("OpenGL ES ");
+	cc_string version = String_FromReadonly((const char*)ver);
+
+	/* Supported in core since OpenGL ES 3.0 */
+	if (String_CaselessStarts(&version, &esVer) && version.length > 10 && ver[10] >= '3') {
+		GLContext_GetAll(coreFuncs, Array_Elems(coreFuncs));
+	} else if (String_CaselessContains(&extensions, &extExt)) {
+		GLContext_GetAll(extFuncs,  Array_Elems(extFuncs));
+	}
+#else
+	static const struct DynamicLibSym arbFuncs[]  = { 
+		DynamicLib_ReqSym2("glVertexAttribDivisorARB",   glVertexAttribDivisor), 
+		DynamicLib_ReqSym2("glDrawElementsInstancedARB", glDrawElementsInstanced) 
+	};
+	static const cc_string arbExt = String_FromConst("GL_ARB_instanced_arrays");
+
+	/* Supported in core since 3.3 */
+	if (ver[0] > '3' || (ver[0] == '3' && ver[2] >= '3')) {
+		GLContext_GetAll(coreFuncs, Array_Elems(coreFuncs));
+	} else if (String_CaselessContains(&extensions, &arbExt)) {
+		GLContext_GetAll(arbFuncs,  Array_Elems(arbFuncs));
+	}
+#endif
+	Gfx.SupportsBillboards = _glVertexAttribDivisor && _glDrawElementsInstanced;
+}
+
+static void FreeBillboards(void) {
+	if (bb_cornersVb)   glDeleteBuffers(1, &bb_cornersVb);
+	if (bb_instancesVb) glDeleteBuffers(1, &bb_instancesVb);
+	bb_cornersVb   = 0;
+	bb_instancesVb = 0;
+}
+
+static void GL_SetBillboardDivisors(GLuint divisor) {
+	_glVertexAttribDivisor(0, divisor);
+	_glVertexAttribDivisor(1, divisor);
+	_glVertexAttribDivisor(2, divisor);
+}
+
+void Gfx_DrawBillboards(const struct GfxBillboard* items, int count) {
+	/* In the same order as the vertices that Particle_DoRender produces */
+	static const float corners[8] = { -1,-1, -1,1, 1,1, 1,-1 };
+	if (!count || !Gfx.SupportsBillboards) return;
+
+	if (!bb_cornersVb) {
+		bb_cornersVb = GL_GenAndBind(GL_ARRAY_BUFFER);
+		glBufferData(GL_ARRAY_BUFFER, sizeof(corners), corners, GL_STATIC_DRAW);
+	}
+	if (!bb_instancesVb) bb_instancesVb = GL_GenAndBind(GL_ARRAY_BUFFER);
+
+	gfx_billboards = true;
+	SwitchProgram();
+
+	/* Each quad uses the same 4 corners, with the other attributes coming from its billboard */
+	glBindBuffer(GL_ARRAY_BUFFER, bb_cornersVb);
+	glEnableVertexAttribArray(3);
+	glVertexAttribPointer(3, 2, GL_FLOAT, false, 2 * sizeof(float), uint_to_ptr(0));
+
+	glBindBuffer(GL_ARRAY_BUFFER, bb_instancesVb);
+	glBufferData(GL_ARRAY_BUFFER, count * sizeof(struct GfxBillboard), items, GL_DYNAMIC_DRAW);
+	glEnableVertexAttribArray(2);
+	glVertexAttribPointer(0, 4, GL_FLOAT,         false, sizeof(struct GfxBillboard), uint_to_ptr( 0));
+	glVertexAttribPointer(1, 4, GL_UNSIGNED_BYTE, true,  sizeof(struct GfxBillboard), uint_to_ptr(16));
+	glVertexAttribPointer(2, 4, GL_FLOAT,         false, sizeof(struct GfxBillboard), uint_to_ptr(20));
+
+	GL_SetBillboardDivisors(1);
+	_glDrawElementsInstanced(GL_TRIANGLES, ICOUNT(4), GL_UNSIGNED_SHORT, NULL, count);
+	GL_SetBillboardDivisors(0);
+
+	glDisableVertexAttribArray(3);
+	if (gfx_format != VERTEX_FORMAT_TEXTURED && gfx_format != VERTEX_FORMAT_CHUNK) glDisableVertexAttribArray(2);
+
+	gfx_billboards = false;
+	SwitchProgram();
+}
+
 
 /*########################################################################################################################*
 *-------------------------------------------------------State setup-------------------------------------------------------*
 *#########################################################################################################################*/
 static void GLBackend_Init(void) {
+	Gfx.SupportsModelParts = true;
+	GL_InitBillboards();
+	GL_InitProgramCache();
 #ifdef CC_BUILD_GLES
 	// OpenGL ES 2.0 doesn't support custom mipmaps levels, but 3.2 does
 	// Note that GL_MAJOR_VERSION and GL_MINOR_VERSION were not actually
@@ -540,6 +1173,7 @@ static void GLBackend_Init(void) {
 	customMipmapsLevels = major >= 3 && minor >= 2;
 #else
     customMipmapsLevels = true;
+    GL_InitTextureArrays();
     const GLubyte* ver  = glGetString(GL_VERSION);
     int major = ver[0] - '0', minor = ver[2] - '0';
     if (major >= 2) return;
@@ -567,8 +1201,61 @@ static void DeleteShaders(void) {
 	}
 }
 
+/*########################################################################################################################*
+*-------------------------------------------------------Scaled scene------------------------------------------------------*
+*#########################################################################################################################*/
+static GLuint scene_tex;
+static int scene_width, scene_height, scene_texWidth, scene_texHeight;
+
+void Gfx_BeginScaledScene(int width, int height) {
+	scene_width  = width;
+	scene_height = height;
+	Gfx_SetViewport(0, 0, width, height);
+}
+
+/* Texture is as large as the window, so that changing the scale doesn't need to reallocate it */
+static void AllocSceneTexture(void) {
+	if (scene_tex && scene_texWidth == Game.Width && scene_texHeight == Game.Height) return;
+	if (!scene_tex) glGenTextures(1, &scene_tex);
+
+	glBindTexture(GL_TEXTURE_2D, scene_tex);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	/* No alpha, so that the scene is opaque when drawn with alpha blending */
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, Game.Width, Game.Height, 0, GL_RGB, GL_UNSIGNED_BYTE, NULL);
+
+	scene_texWidth  = Game.Width;
+	scene_texHeight = Game.Height;
+}
+
+void Gfx_EndScaledScene(struct Texture* tex) {
+	AllocSceneTexture();
+	glBindTexture(GL_TEXTURE_2D, scene_tex);
+	glCopyTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, 0, 0, scene_width, scene_height);
+	Gfx_SetViewport(0, 0, Game.Width, Game.Height);
+
+	tex->ID = uint_to_ptr(scene_tex);
+	tex->x  = 0; tex->width  = Game.Width;
+	tex->y  = 0; tex->height = Game.Height;
+
+	/* OpenGL stores the backbuffer bottom to top. Inset by half a texel, so that */
+	/*  bilinear filtering doesn't sample the unused parts of the texture */
+	tex->uv.u1 = 0.5f / scene_texWidth;  tex->uv.u2 = (scene_width  - 0.5f) / scene_texWidth;
+	tex->uv.v1 = (scene_height - 0.5f) / scene_texHeight; tex->uv.v2 = 0.5f / scene_texHeight;
+}
+
+static void FreeSceneTexture(void) {
+	if (scene_tex) glDeleteTextures(1, &scene_tex);
+	scene_tex = 0;
+}
+
 static void Gfx_FreeState(void) {
 	FreeDefaultResources();
+	FreeSceneTexture();
+	FreeBillboards();
+	GL_FreeTimestamps();
 	DeleteShaders();
 	Gfx_DeleteTexture(&white_square);
 }
@@ -580,6 +1267,7 @@ static void Gfx_RestoreState(void) {
 	gfx_format = -1;
 
 	DirtyUniform(UNI_MASK_ALL);
+	CompilePrograms();
 	GL_ClearColor(gfx_clearColor);
 	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 	glDepthFunc(GL_LEQUAL);
@@ -607,6 +1295,7 @@ static int  GetPostProcess(void) { return postProcess; }
 static void SetPostProcess(int v) {
 	postProcess = v;
 	DeleteShaders();
+	CompilePrograms();
 	SwitchProgram();
 	DirtyUniform(UNI_MASK_ALL);
 }
@@ -638,6 +1327,12 @@ static void GL_SetupVbTextured(void) {
 	glVertexAttribPointer(2, 2, GL_FLOAT,         false, SIZEOF_VERTEX_TEXTURED, uint_to_ptr(16));
 }
 
+static void GL_SetupVbChunk(void) {
+	glVertexAttribPointer(0, 4, GL_SHORT,         false, SIZEOF_VERTEX_CHUNK, uint_to_ptr( 0));
+	glVertexAttribPointer(1, 4, GL_UNSIGNED_BYTE, true,  SIZEOF_VERTEX_CHUNK, uint_to_ptr(12));
+	glVertexAttribPointer(2, 2, GL_SHORT,         false, SIZEOF_VERTEX_CHUNK, uint_to_ptr( 8));
+}
+
 static void GL_SetupVbColoured_Range(int startVertex) {
 	cc_uint32 offset = startVertex * SIZEOF_VERTEX_COLOURED;
 	glVertexAttribPointer(0, 3, GL_FLOAT,         false, SIZEOF_VERTEX_COLOURED, uint_to_ptr(offset     ));
@@ -651,8 +1346,14 @@ static void GL_SetupVbTextured_Range(int startVertex) {
 	glVertexAttribPointer(2, 2, GL_FLOAT,         false, SIZEOF_VERTEX_TEXTURED, uint_to_ptr(offset + 16));
 }
 
-void Gfx_SetVertexFormat(VertexFormat fmt) {
-	if (fmt == gfx_format) return;
+static void GL_SetupVbChunk_Range(int startVertex) {
+	cc_uint32 offset = startVertex * SIZEOF_VERTEX_CHUNK;
+	glVertexAttribPointer(0, 4, GL_SHORT,         false, SIZEOF_VERTEX_CHUNK, uint_to_ptr(offset     ));
+	glVertexAttribPointer(1, 4, GL_UNSIGNED_BYTE, true,  SIZEOF_VERTEX_CHUNK, uint_to_ptr(offset + 12));
+	glVertexAttribPointer(2, 2, GL_SHORT,         false, SIZEOF_VERTEX_CHUNK, uint_to_ptr(offset +  8));
+}
+
+static void SetVertexFormat(VertexFormat fmt) {
 	gfx_format = fmt;
 	gfx_stride = strideSizes[fmt];
 
@@ -660,6 +1361,10 @@ void Gfx_SetVertexFormat(VertexFormat fmt) {
 		glEnableVertexAttribArray(2);
 		gfx_setupVBFunc      = GL_SetupVbTextured;
 		gfx_setupVBRangeFunc = GL_SetupVbTextured_Range;
+	} else if (fmt == VERTEX_FORMAT_CHUNK) {
+		glEnableVertexAttribArray(2);
+		gfx_setupVBFunc      = GL_SetupVbChunk;
+		gfx_setupVBRangeFunc = GL_SetupVbChunk_Range;
 	} else {
 		glDisableVertexAttribArray(2);
 		gfx_setupVBFunc      = GL_SetupVbColoured;
@@ -671,28 +1376,32 @@ void Gfx_SetVertexFormat(VertexFormat fmt) {
 void Gfx_DrawVb_Lines(int verticesCount) {
 	gfx_setupVBFunc();
 	glDrawArrays(GL_LINES, 0, verticesCount);
+	Gfx_StateCounts.draws++;
 }
 
 void Gfx_DrawVb_IndexedTris_Range(int verticesCount, int startVertex) {
 	gfx_setupVBRangeFunc(startVertex);
 	glDrawElements(GL_TRIANGLES, ICOUNT(verticesCount), GL_UNSIGNED_SHORT, NULL);
+	Gfx_StateCounts.draws++;
 }
 
 void Gfx_DrawVb_IndexedTris(int verticesCount) {
 	gfx_setupVBFunc();
 	glDrawElements(GL_TRIANGLES, ICOUNT(verticesCount), GL_UNSIGNED_SHORT, NULL);
+	Gfx_StateCounts.draws++;
 }
 
 void Gfx_BindVb_Textured(GfxResourceID vb) {
 	Gfx_BindVb(vb);
-	GL_SetupVbTextured();
+	gfx_setupVBFunc();
 }
 
 void Gfx_DrawIndexedTris_T2fC4b(int verticesCount, int startVertex) {
+	Gfx_StateCounts.draws++;
 	if (startVertex + verticesCount > GFX_MAX_VERTICES) {
-		GL_SetupVbTextured_Range(startVertex);
+		gfx_setupVBRangeFunc(startVertex);
 		glDrawElements(GL_TRIANGLES, ICOUNT(verticesCount), GL_UNSIGNED_SHORT, NULL);
-		GL_SetupVbTextured();
+		gfx_setupVBFunc();
 	} else {
 		/* ICOUNT(startVertex) * 2 = startVertex * 3  */
 		glDrawElements(GL_TRIANGLES, ICOUNT(verticesCount), GL_UNSIGNED_SHORT, uint_to_ptr(startVertex * 3));
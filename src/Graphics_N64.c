@@ -420,7 +420,7 @@ void Gfx_DeleteDynamicVb(GfxResourceID* vb) { Gfx_DeleteVb(vb); }
 *#########################################################################################################################*/
 static cc_bool depthOnlyRendering;
 
-void Gfx_SetFog(cc_bool enabled) {
+static void SetFog(cc_bool enabled) {
 }
 
 void Gfx_SetFogCol(PackedCol color) {
@@ -493,8 +493,7 @@ static void GL_SetupVbTextured(void) {
 	glTexCoordPointer(2, GL_FLOAT,      SIZEOF_VERTEX_TEXTURED, (void*)(gfx_vb->vertices + 16));
 }
 
-void Gfx_SetVertexFormat(VertexFormat fmt) {
-	if (fmt == gfx_format) return;
+static void SetVertexFormat(VertexFormat fmt) {
 	gfx_format = fmt;
 	gfx_stride = strideSizes[fmt];
 
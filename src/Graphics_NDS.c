@@ -544,7 +544,7 @@ static void RecalculateFog() {
 	}
 }
 
-void Gfx_SetFog(cc_bool enabled) {
+static void SetFog(cc_bool enabled) {
 	fogEnabled = enabled;
 	SetPolygonMode();
 }
@@ -630,7 +630,7 @@ void Gfx_LoadMVP(const struct Matrix* view, const struct Matrix* proj, struct Ma
 /*########################################################################################################################*
 *--------------------------------------------------------Rendering--------------------------------------------------------*
 *#########################################################################################################################*/
-void Gfx_SetVertexFormat(VertexFormat fmt) {
+static void SetVertexFormat(VertexFormat fmt) {
 	gfx_format = fmt;
 	gfx_stride = strideSizes[fmt];
 }
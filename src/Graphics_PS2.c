@@ -17,7 +17,7 @@
 
 typedef struct Matrix VU0_MATRIX __attribute__((aligned(16)));
 typedef struct Vec4   VU0_VECTOR __attribute__((aligned(16)));
-typedef struct { int x, y, z, w; } VU0_IVECTOR __attribute__((aligned(16)));
+typedef struct { int x, y, z; float q; } VU0_PROJECTED __attribute__((aligned(16)));
 
 static void* gfx_vertices;
 extern framebuffer_t fb_colors[2];
@@ -245,7 +245,7 @@ void Gfx_DisableMipmaps(void) { }
 static int clearR, clearG, clearB;
 static cc_bool gfx_depthTest;
 
-void Gfx_SetFog(cc_bool enabled)    { }
+static void SetFog(cc_bool enabled) { }
 void Gfx_SetFogCol(PackedCol col)   { }
 void Gfx_SetFogDensity(float value) { }
 void Gfx_SetFogEnd(float value)     { }
@@ -522,83 +522,54 @@ typedef struct {
 	xyz_t xyz;
 } __attribute__((packed,aligned(8))) ColouredVertex;
 
-void Gfx_SetVertexFormat(VertexFormat fmt) {
+static void SetVertexFormat(VertexFormat fmt) {
 	gfx_format  = fmt;
 	gfx_stride  = strideSizes[fmt];
 	formatDirty = true;
 }
 
-extern void ViewportTransform(VU0_VECTOR* src, VU0_IVECTOR* dst);
-static xyz_t FinishVertex(VU0_VECTOR* src, float invW) {
-	src->w = invW;
-	VU0_IVECTOR tmp;
-	ViewportTransform(src, &tmp);
+// The perspective divide and viewport transform of each vertex are done by VU0
+//  when transforming a quad, so both triangles of a quad share the projected vertices
+static CC_INLINE void FinishColouredVertex(ColouredVertex* dst, VU0_PROJECTED* P, struct VertexColoured* V) {
+	dst->rgba  = V->Col;
+	dst->q     = P->q;
+	dst->xyz.x = (short)P->x;
+	dst->xyz.y = (short)P->y;
+	dst->xyz.z = P->z;
+}
 
-	xyz_t xyz;
-	xyz.x = (short)tmp.x;
-	xyz.y = (short)tmp.y;
-	xyz.z = tmp.z;
-	return xyz;
+static CC_INLINE void FinishTexturedVertex(TexturedVertex* dst, VU0_PROJECTED* P, struct VertexTextured* V) {
+	dst->rgba  = V->Col;
+	dst->q     = P->q;
+	dst->u     = V->U * P->q;
+	dst->v     = V->V * P->q;
+	dst->xyz.x = (short)P->x;
+	dst->xyz.y = (short)P->y;
+	dst->xyz.z = P->z;
 }
 
-static u64* DrawColouredTriangle(u64* dw, VU0_VECTOR* coords, 
-								struct VertexColoured* V0, struct VertexColoured* V1, struct VertexColoured* V2) {
+static u64* DrawColouredTriangle(u64* dw, VU0_PROJECTED* P, struct VertexColoured* v, int i0, int i1, int i2) {
 	ColouredVertex* dst = (ColouredVertex*)dw;
-	float Q;
 
-	// TODO optimise
 	// Add the "primitives" to the GIF packet
-	Q   = 1.0f / coords[0].w;
-	dst[0].rgba  = V0->Col;
-	dst[0].q     = Q;
-	dst[0].xyz   = FinishVertex(&coords[0], Q);
-
-	Q   = 1.0f / coords[1].w;
-	dst[1].rgba  = V1->Col;
-	dst[1].q     = Q;
-	dst[1].xyz   = FinishVertex(&coords[1], Q);
-
-	Q   = 1.0f / coords[2].w;
-	dst[2].rgba  = V2->Col;
-	dst[2].q     = Q;
-	dst[2].xyz   = FinishVertex(&coords[2], Q);
-
+	FinishColouredVertex(&dst[0], &P[i0], &v[i0]);
+	FinishColouredVertex(&dst[1], &P[i1], &v[i1]);
+	FinishColouredVertex(&dst[2], &P[i2], &v[i2]);
 	return dw + 6;
 }
 
-static u64* DrawTexturedTriangle(u64* dw, VU0_VECTOR* coords, 
-								struct VertexTextured* V0, struct VertexTextured* V1, struct VertexTextured* V2) {
+static u64* DrawTexturedTriangle(u64* dw, VU0_PROJECTED* P, struct VertexTextured* v, int i0, int i1, int i2) {
 	TexturedVertex* dst = (TexturedVertex*)dw;
-	float Q;
 
-	// TODO optimise
 	// Add the "primitives" to the GIF packet
-	Q   = 1.0f / coords[0].w;
-	dst[0].rgba  = V0->Col;
-	dst[0].q     = Q;
-	dst[0].u     = V0->U * Q;
-	dst[0].v     = V0->V * Q;
-	dst[0].xyz   = FinishVertex(&coords[0], Q);
-
-	Q   = 1.0f / coords[1].w;
-	dst[1].rgba  = V1->Col;
-	dst[1].q     = Q;
-	dst[1].u     = V1->U * Q;
-	dst[1].v     = V1->V * Q;
-	dst[1].xyz   = FinishVertex(&coords[1], Q);
-
-	Q   = 1.0f / coords[2].w;
-	dst[2].rgba  = V2->Col;
-	dst[2].q     = Q;
-	dst[2].u     = V2->U * Q;
-	dst[2].v     = V2->V * Q;
-	dst[2].xyz   = FinishVertex(&coords[2], Q);
-
+	FinishTexturedVertex(&dst[0], &P[i0], &v[i0]);
+	FinishTexturedVertex(&dst[1], &P[i1], &v[i1]);
+	FinishTexturedVertex(&dst[2], &P[i2], &v[i2]);
 	return dw + 9;
 }
 
-extern void TransformTexturedQuad(void* src, VU0_VECTOR* dst, VU0_VECTOR* tmp, int* clip_flags);
-extern void TransformColouredQuad(void* src, VU0_VECTOR* dst, VU0_VECTOR* tmp, int* clip_flags);
+extern void TransformTexturedQuad(void* src, VU0_PROJECTED* dst, VU0_VECTOR* tmp, int* clip_flags);
+extern void TransformColouredQuad(void* src, VU0_PROJECTED* dst, VU0_VECTOR* tmp, int* clip_flags);
 
 static void DrawTexturedTriangles(int verticesCount, int startVertex) {
 	struct VertexTextured* v = (struct VertexTextured*)gfx_vertices + startVertex;
@@ -607,20 +578,21 @@ static void DrawTexturedTriangles(int verticesCount, int startVertex) {
 	u64* dw = (u64*)q;
 
 	unsigned numVerts = 0;
-	VU0_VECTOR V[6], tmp;
+	VU0_PROJECTED P[4];
+	VU0_VECTOR tmp;
 	int clip[4];
 
 	for (int i = 0; i < verticesCount / 4; i++, v += 4)
 	{
-		TransformTexturedQuad(v, V, &tmp, clip);
+		TransformTexturedQuad(v, P, &tmp, clip);
 		
 		if (((clip[0] | clip[1] | clip[2]) & 0x3F) == 0) {
-			dw = DrawTexturedTriangle(dw, V, v + 0, v + 1, v + 2);
+			dw = DrawTexturedTriangle(dw, P, v, 0, 1, 2);
 			numVerts += 3;
 		}
 		
 		if (((clip[2] | clip[3] | clip[0]) & 0x3F) == 0) {
-			dw = DrawTexturedTriangle(dw, V + 3, v + 2, v + 3, v + 0);
+			dw = DrawTexturedTriangle(dw, P, v, 2, 3, 0);
 			numVerts += 3;
 		}
 	}
@@ -644,20 +616,21 @@ static void DrawColouredTriangles(int verticesCount, int startVertex) {
 	u64* dw = (u64*)q;
 
 	unsigned numVerts = 0;
-	VU0_VECTOR V[6], tmp;
+	VU0_PROJECTED P[4];
+	VU0_VECTOR tmp;
 	int clip[4];
 
 	for (int i = 0; i < verticesCount / 4; i++, v += 4)
 	{
-		TransformColouredQuad(v, V, &tmp, clip);
+		TransformColouredQuad(v, P, &tmp, clip);
 		
 		if (((clip[0] | clip[1] | clip[2]) & 0x3F) == 0) {
-			dw = DrawColouredTriangle(dw, V, v + 0, v + 1, v + 2);
+			dw = DrawColouredTriangle(dw, P, v, 0, 1, 2);
 			numVerts += 3;
 		}
 		
 		if (((clip[2] | clip[3] | clip[0]) & 0x3F) == 0) {
-			dw = DrawColouredTriangle(dw, V + 3, v + 2, v + 3, v + 0);
+			dw = DrawColouredTriangle(dw, P, v, 2, 3, 0);
 			numVerts += 3;
 		}
 	}
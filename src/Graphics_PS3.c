@@ -654,7 +654,7 @@ void Gfx_DisableMipmaps(void) { }
 /*########################################################################################################################*
 *-----------------------------------------------------State management----------------------------------------------------*
 *#########################################################################################################################*/
-void Gfx_SetFog(cc_bool enabled) {/* TODO */
+static void SetFog(cc_bool enabled) {/* TODO */
 }
 
 void Gfx_SetFogCol(PackedCol color) {/* TODO */
@@ -707,8 +707,7 @@ void Gfx_DisableTextureOffset(void) {
 /*########################################################################################################################*
 *----------------------------------------------------------Drawing--------------------------------------------------------*
 *#########################################################################################################################*/
-void Gfx_SetVertexFormat(VertexFormat fmt) {
-	if (fmt == gfx_format) return;
+static void SetVertexFormat(VertexFormat fmt) {
 	gfx_format = fmt;
 	gfx_stride = strideSizes[fmt];/* TODO */
 	
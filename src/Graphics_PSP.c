@@ -357,8 +357,7 @@ static PackedCol gfx_fogColor;
 static float gfx_fogEnd = -1.0f, gfx_fogDensity = -1.0f;
 static int gfx_fogMode  = -1;
 
-void Gfx_SetFog(cc_bool enabled) {
-	gfx_fogEnabled = enabled;
+static void SetFog(cc_bool enabled) {
 	//GU_Toggle(GU_FOG);
 }
 
@@ -423,8 +422,7 @@ void Gfx_DisableTextureOffset(void) {
 cc_bool Gfx_WarnIfNecessary(void) { return false; }
 cc_bool Gfx_GetUIOptions(struct MenuOptionsScreen* s) { return false; }
 
-void Gfx_SetVertexFormat(VertexFormat fmt) {
-	if (fmt == gfx_format) return;
+static void SetVertexFormat(VertexFormat fmt) {
 	gfx_format = fmt;
 	gfx_fields = formatFields[fmt];
 	gfx_stride = strideSizes[fmt];
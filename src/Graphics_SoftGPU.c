@@ -1,5 +1,12 @@
 #include "Core.h"
 #if CC_GFX_BACKEND == CC_GFX_BACKEND_SOFTGPU
+#if defined CC_BUILD_SSE2
+	#include <emmintrin.h>
+	#define SOFTGPU_SSE2
+#elif defined CC_BUILD_NEON
+	#include <arm_neon.h>
+	#define SOFTGPU_NEON
+#endif
 #include "_GraphicsBase.h"
 #include "Errors.h"
 #include "Window.h"
@@ -16,6 +23,9 @@ static cc_bool colWrite = true;
 static int cb_stride;
 
 static float* depthBuffer;
+static float* hizMaxDepth;
+static cc_uint8* hizDirty;
+static int hiz_tilesX, hiz_tilesY;
 static cc_bool depthTest  = true;
 static cc_bool depthWrite = true;
 static int db_stride;
@@ -23,6 +33,12 @@ static int db_stride;
 static void* gfx_vertices;
 static GfxResourceID white_square;
 
+static void FlushTriangles(void);
+static void AllocBins(void);
+static void FreeBins(void);
+static void InitRasterThreads(void);
+static void FreeRasterThreads(void);
+
 void Gfx_RestoreState(void) {
 	InitDefaultResources();
 
@@ -50,18 +66,25 @@ void Gfx_Create(void) {
 	Gfx.Created      = true;
 	Gfx.BackendType  = CC_GFX_BACKEND_SOFTGPU;
 	
+	InitRasterThreads();
 	Gfx_RestoreState();
 }
 
 static void DestroyBuffers(void) {
+	FreeBins();
 	Window_FreeFramebuffer(&fb_bmp);
 	Mem_Free(depthBuffer);
+	Mem_Free(hizMaxDepth);
+	Mem_Free(hizDirty);
 	depthBuffer = NULL;
+	hizMaxDepth = NULL;
+	hizDirty    = NULL;
 }
 
 void Gfx_Free(void) { 
 	Gfx_FreeState();
 	DestroyBuffers();
+	FreeRasterThreads();
 }
 
 
@@ -92,7 +115,7 @@ void Gfx_BindTexture(GfxResourceID texId) {
 		
 void Gfx_DeleteTexture(GfxResourceID* texId) {
 	GfxResourceID data = *texId;
-	if (data) Mem_Free(data);
+	if (data) { FlushTriangles(); Mem_Free(data); }
 	*texId = NULL;
 }
 		
@@ -109,6 +132,7 @@ GfxResourceID Gfx_AllocTexture(struct Bitmap* bmp, int rowWidth, cc_uint8 flags,
 void Gfx_UpdateTexture(GfxResourceID texId, int x, int y, struct Bitmap* part, int rowWidth, cc_bool mipmaps) {
 	CCTexture* tex = (CCTexture*)texId;
 	BitmapCol* dst = (tex->pixels + x) + y * tex->width;
+	FlushTriangles();
 
 	CopyTextureData(dst, tex->width * BITMAPCOLOR_SIZE,
 					part, rowWidth  * BITMAPCOLOR_SIZE);
@@ -121,7 +145,7 @@ void Gfx_DisableMipmaps(void) { }
 /*########################################################################################################################*
 *------------------------------------------------------State management---------------------------------------------------*
 *#########################################################################################################################*/
-void Gfx_SetFog(cc_bool enabled)	{ }
+static void SetFog(cc_bool enabled) { }
 void Gfx_SetFogCol(PackedCol col)   { }
 void Gfx_SetFogDensity(float value) { }
 void Gfx_SetFogEnd(float value) 	{ }
@@ -161,10 +185,64 @@ static void ClearDepthBuffer(void) {
 #ifndef SOFTGPU_DISABLE_ZBUFFER
 	int i, size = fb_width * fb_height;
 	for (i = 0; i < size; i++) depthBuffer[i] = 100000000.0f;
+
+	size = hiz_tilesX * hiz_tilesY;
+	for (i = 0; i < size; i++) hizMaxDepth[i] = 100000000.0f;
+	Mem_Set(hizDirty, 0, size);
 #endif
 }
 
+
+/*########################################################################################################################*
+*----------------------------------------------------Hierarchical depth---------------------------------------------------*
+*#########################################################################################################################*/
+// The depth buffer is split into 8x8 tiles, each of which tracks the furthest depth of any pixel in it
+// A triangle whose nearest point is further away than that would fail the depth test across the whole tile
+// NOTE: Tiles must evenly divide RASTER_BAND_HEIGHT, so that each tile is only ever touched by one thread
+#define HIZ_TILE_SHIFT 3
+#define HIZ_TILE_MASK  ((1 << HIZ_TILE_SHIFT) - 1)
+
+#ifndef SOFTGPU_DISABLE_ZBUFFER
+// Furthest depth of a tile, recalculated if depth has been written into the tile since last checked
+static float HiZ_TileMaxDepth(int tileX, int tileY) {
+	int i = tileY * hiz_tilesX + tileX;
+	if (!hizDirty[i]) return hizMaxDepth[i];
+
+	int x1 = tileX << HIZ_TILE_SHIFT, x2 = min(x1 + HIZ_TILE_MASK, fb_width  - 1);
+	int y1 = tileY << HIZ_TILE_SHIFT, y2 = min(y1 + HIZ_TILE_MASK, fb_height - 1);
+	float maxDepth = 0.0f;
+
+	for (int y = y1; y <= y2; y++)
+	{
+		float* row = &depthBuffer[y * db_stride];
+		for (int x = x1; x <= x2; x++) maxDepth = max(maxDepth, row[x]);
+	}
+
+	hizDirty[i]    = false;
+	hizMaxDepth[i] = maxDepth;
+	return maxDepth;
+}
+
+// Shrinks the columns of a row of tiles to draw, by excluding tiles at either end that are fully occluded
+static void HiZ_CullTileRow(int tileY, float minZ, int* minX, int* maxX, cc_bool depthWrite) {
+	int tileX1 = *minX >> HIZ_TILE_SHIFT;
+	int tileX2 = *maxX >> HIZ_TILE_SHIFT;
+
+	while (tileX1 <= tileX2 && minZ > HiZ_TileMaxDepth(tileX1, tileY)) tileX1++;
+	while (tileX2 >  tileX1 && minZ > HiZ_TileMaxDepth(tileX2, tileY)) tileX2--;
+
+	if (tileX1 > tileX2) { *minX = 1; *maxX = 0; return; }
+	*minX = max(*minX, tileX1 << HIZ_TILE_SHIFT);
+	*maxX = min(*maxX, (tileX2 << HIZ_TILE_SHIFT) + HIZ_TILE_MASK);
+
+	// Depth may be written anywhere in these tiles, so their furthest depth must be recalculated later
+	if (!depthWrite) return;
+	Mem_Set(&hizDirty[tileY * hiz_tilesX + tileX1], true, tileX2 - tileX1 + 1);
+}
+#endif
+
 void Gfx_ClearBuffers(GfxBuffers buffers) {
+	FlushTriangles();
 	if (buffers & GFX_BUFFER_COLOR) ClearColorBuffer();
 	if (buffers & GFX_BUFFER_DEPTH) ClearDepthBuffer();
 }
@@ -342,6 +420,38 @@ static void TransformVertex2D(int index, Vertex* vertex) {
 	}
 }
 
+/* Clip space planes that triangles are clipped against */
+#define CLIP_NEAR   (1 << 0)
+#define CLIP_LEFT   (1 << 1)
+#define CLIP_RIGHT  (1 << 2)
+#define CLIP_BOTTOM (1 << 3)
+#define CLIP_TOP    (1 << 4)
+#define CLIP_PLANES 5
+/* Triangles are only clipped against the sides of the screen once they extend this far beyond it, */
+/*  which keeps screen coordinates small enough for the rasterisers' fixed point edge functions */
+#define CLIP_GUARD_BAND 2.0f
+
+/* Returns the signed distance of the vertex from the given clip plane, negative when outside */
+static float ClipDistance(Vertex* v, int plane) {
+	switch (plane) {
+	case 0:  return v->z;
+	case 1:  return v->w * CLIP_GUARD_BAND + v->x;
+	case 2:  return v->w * CLIP_GUARD_BAND - v->x;
+	case 3:  return v->w * CLIP_GUARD_BAND + v->y;
+	default: return v->w * CLIP_GUARD_BAND - v->y;
+	}
+}
+
+/* Returns a mask of the clip planes that the vertex is outside of */
+static int ClipOutcode(Vertex* v) {
+	int plane, code = 0;
+	for (plane = 0; plane < CLIP_PLANES; plane++)
+	{
+		if (ClipDistance(v, plane) < 0.0f) code |= 1 << plane;
+	}
+	return code;
+}
+
 static int TransformVertex3D(int index, Vertex* vertex) {
 	// TODO: avoid the multiply, just add down in DrawTriangles
 	char* ptr = (char*)gfx_vertices + index * gfx_stride;
@@ -363,7 +473,7 @@ static int TransformVertex3D(int index, Vertex* vertex) {
 		vertex->v = (v->V + texOffsetY);
 		vertex->c = v->Col;
 	}
-	return vertex->z >= 0.0f;
+	return ClipOutcode(vertex);
 }
 
 static void ViewportVertex3D(Vertex* vertex) {
@@ -385,8 +495,77 @@ static CC_INLINE int FastFloor(float value) {
 }
 
 #define edgeFunction(ax,ay, bx,by, cx,cy) (((bx) - (ax)) * ((cy) - (ay)) - ((by) - (ay)) * ((cx) - (ax)))
+/* Edge function at the centre of pixel (px, py), multiplied by 2 so that it's always an integer */
+#define edgeFixed(ax,ay, bx,by, px,py) (((bx) - (ax)) * (2 * ((py) - (ay)) + 1) - ((by) - (ay)) * (2 * ((px) - (ax)) + 1))
+
+/* Returns how many of the first count pixels in a row can be skipped, because they're outside the triangle */
+/* NOTE: Pixels are outside the triangle when any of their edge values are negative */
+static CC_INLINE int SkipOutside(int e0, int e1, int e2, int d0, int d1, int d2, int count) {
+	int skipped = 0;
+#if defined SOFTGPU_SSE2
+	__m128i v0 = _mm_add_epi32(_mm_set1_epi32(e0), _mm_setr_epi32(0, d0, d0 * 2, d0 * 3));
+	__m128i v1 = _mm_add_epi32(_mm_set1_epi32(e1), _mm_setr_epi32(0, d1, d1 * 2, d1 * 3));
+	__m128i v2 = _mm_add_epi32(_mm_set1_epi32(e2), _mm_setr_epi32(0, d2, d2 * 2, d2 * 3));
+	__m128i s0 = _mm_set1_epi32(d0 * 4), s1 = _mm_set1_epi32(d1 * 4), s2 = _mm_set1_epi32(d2 * 4);
+
+	for (; skipped + 4 <= count; skipped += 4)
+	{
+		/* Sign bit is set in each lane where any of the edge values are negative */
+		__m128i any = _mm_or_si128(_mm_or_si128(v0, v1), v2);
+		if (_mm_movemask_ps(_mm_castsi128_ps(any)) != 0xF) break;
 
-static void DrawTriangle2D(Vertex* V0, Vertex* V1, Vertex* V2) {
+		v0 = _mm_add_epi32(v0, s0); v1 = _mm_add_epi32(v1, s1); v2 = _mm_add_epi32(v2, s2);
+	}
+#elif defined SOFTGPU_NEON
+	int32x4_t lanes = { 0, 1, 2, 3 };
+	int32x4_t v0 = vmlaq_n_s32(vdupq_n_s32(e0), lanes, d0);
+	int32x4_t v1 = vmlaq_n_s32(vdupq_n_s32(e1), lanes, d1);
+	int32x4_t v2 = vmlaq_n_s32(vdupq_n_s32(e2), lanes, d2);
+	int32x4_t s0 = vdupq_n_s32(d0 * 4), s1 = vdupq_n_s32(d1 * 4), s2 = vdupq_n_s32(d2 * 4);
+
+	for (; skipped + 4 <= count; skipped += 4)
+	{
+		int32x4_t any = vorrq_s32(vorrq_s32(v0, v1), v2);
+		if (vminvq_u32(vcltzq_s32(any)) == 0) break;
+
+		v0 = vaddq_s32(v0, s0); v1 = vaddq_s32(v1, s1); v2 = vaddq_s32(v2, s2);
+	}
+#endif
+	return skipped;
+}
+
+/* State that affects how triangles are rasterised, captured at the start of each draw call */
+struct RasterState {
+	BitmapCol* texPixels;
+	int texWidth, texHeight;
+	int texWidthMask, texHeightMask;
+	cc_bool texSinglePixel, texturing;
+	cc_bool alphaTest, alphaBlend;
+	cc_bool depthTest, depthWrite, colWrite;
+	int maxX, maxY;
+};
+static struct RasterState curState;
+
+static void CaptureRasterState(void) {
+	curState.texPixels      = curTexPixels;
+	curState.texWidth       = curTexWidth;
+	curState.texHeight      = curTexHeight;
+	curState.texWidthMask   = texWidthMask;
+	curState.texHeightMask  = texHeightMask;
+	curState.texSinglePixel = texSinglePixel;
+	curState.texturing      = gfx_format == VERTEX_FORMAT_TEXTURED;
+
+	curState.alphaTest  = gfx_alphaTest;
+	curState.alphaBlend = gfx_alphaBlend;
+	curState.depthTest  = depthTest;
+	curState.depthWrite = depthWrite;
+	curState.colWrite   = colWrite;
+	curState.maxX = fb_maxX;
+	curState.maxY = fb_maxY;
+}
+
+/* Rasterises the rows of the triangle between bandMinY and bandMaxY */
+static void RasterTriangle2D(const struct RasterState* s, Vertex* V0, Vertex* V1, Vertex* V2, int bandMinY, int bandMaxY) {
 	int x0 = (int)V0->x, y0 = (int)V0->y;
 	int x1 = (int)V1->x, y1 = (int)V1->y;
 	int x2 = (int)V2->x, y2 = (int)V2->y;
@@ -396,53 +575,58 @@ static void DrawTriangle2D(Vertex* V0, Vertex* V1, Vertex* V2) {
 	int maxY = max(y0, max(y1, y2));
 
 	int area = edgeFunction(x0,y0, x1,y1, x2,y2);
-	// Reject triangles completely outside
-	if (maxX < 0 || minX > fb_maxX) return;
-	if (maxY < 0 || minY > fb_maxY) return;
-
+	// Edge values are integers multiplied by 2, and flipped for back facing triangles so inside is never negative
+	int sign = area < 0 ? -2 : 2;
 	// Perform scissoring
-	minX = max(minX, 0); maxX = min(maxX, fb_maxX);
-	minY = max(minY, 0); maxY = min(maxY, fb_maxY);
-	float factor = 1.0f / area;
+	minX = max(minX, 0);        maxX = min(maxX, s->maxX);
+	minY = max(minY, bandMinY); maxY = min(maxY, min(s->maxY, bandMaxY));
+	float factor = 1.0f / (area * sign);
 
-	float u0 = V0->u * curTexWidth,  u1 = V1->u * curTexWidth,  u2 = V2->u * curTexWidth;
-	float v0 = V0->v * curTexHeight, v1 = V1->v * curTexHeight, v2 = V2->v * curTexHeight;
+	float u0 = V0->u * s->texWidth,  u1 = V1->u * s->texWidth,  u2 = V2->u * s->texWidth;
+	float v0 = V0->v * s->texHeight, v1 = V1->v * s->texHeight, v2 = V2->v * s->texHeight;
 	PackedCol color = V0->c;
-	
+
 	// https://fgiesen.wordpress.com/2013/02/10/optimizing-the-basic-rasterizer/
 	// Essentially these are the deltas of edge functions between X/Y and X/Y + 1 (i.e. one X/Y step)
-	int dx01  = y0 - y1, dy01 = x1 - x0;
-	int dx12  = y1 - y2, dy12 = x2 - x1;
-	int dx20  = y2 - y0, dy20 = x0 - x2;
+	int dx01  = (y0 - y1) * sign, dy01 = (x1 - x0) * sign;
+	int dx12  = (y1 - y2) * sign, dy12 = (x2 - x1) * sign;
+	int dx20  = (y2 - y0) * sign, dy20 = (x0 - x2) * sign;
 
-	float bc0_start = edgeFunction(x1,y1, x2,y2, minX+0.5f,minY+0.5f);
-	float bc1_start = edgeFunction(x2,y2, x0,y0, minX+0.5f,minY+0.5f);
-	float bc2_start = edgeFunction(x0,y0, x1,y1, minX+0.5f,minY+0.5f);
+	int bc0_start = edgeFixed(x1,y1, x2,y2, minX,minY) * (sign / 2);
+	int bc1_start = edgeFixed(x2,y2, x0,y0, minX,minY) * (sign / 2);
+	int bc2_start = edgeFixed(x0,y0, x1,y1, minX,minY) * (sign / 2);
 
-	for (int y = minY; y <= maxY; y++, bc0_start += dy12, bc1_start += dy20, bc2_start += dy01) 
+	for (int y = minY; y <= maxY; y++, bc0_start += dy12, bc1_start += dy20, bc2_start += dy01)
 	{
-		float bc0 = bc0_start;
-		float bc1 = bc1_start;
-		float bc2 = bc2_start;
+		int skip = SkipOutside(bc0_start, bc1_start, bc2_start, dx12, dx20, dx01, maxX - minX + 1);
+		int bc0  = bc0_start + skip * dx12;
+		int bc1  = bc1_start + skip * dx20;
+		int bc2  = bc2_start + skip * dx01;
+		cc_bool inside = false;
 
-		for (int x = minX; x <= maxX; x++, bc0 += dx12, bc1 += dx20, bc2 += dx01) 
+		for (int x = minX + skip; x <= maxX; x++, bc0 += dx12, bc1 += dx20, bc2 += dx01)
 		{
+			if ((bc0 | bc1 | bc2) < 0) {
+				// Triangles are convex, so the rest of the row must be outside too
+				if (inside) break;
+				continue;
+			}
+			inside = true;
+
 			float ic0 = bc0 * factor;
 			float ic1 = bc1 * factor;
 			float ic2 = bc2 * factor;
-
-			if (ic0 < 0 || ic1 < 0 || ic2 < 0) continue;
 			int cb_index = y * cb_stride + x;
 
 			int R, G, B, A;
-			if (gfx_format == VERTEX_FORMAT_TEXTURED) {
+			if (s->texturing) {
 				float u = ic0 * u0 + ic1 * u1 + ic2 * u2;
 				float v = ic0 * v0 + ic1 * v1 + ic2 * v2;
-				int texX = ((int)u) & texWidthMask;
-				int texY = ((int)v) & texHeightMask;
-				int texIndex = texY * curTexWidth + texX;
+				int texX = ((int)u) & s->texWidthMask;
+				int texY = ((int)v) & s->texHeightMask;
+				int texIndex = texY * s->texWidth + texX;
 
-				BitmapCol tColor = curTexPixels[texIndex];
+				BitmapCol tColor = s->texPixels[texIndex];
 				int a1 = PackedCol_A(color), a2 = BitmapCol_A(tColor);
 				A = ( a1 * a2 ) >> 8;
 				int r1 = PackedCol_R(color), r2 = BitmapCol_R(tColor);
@@ -458,10 +642,10 @@ static void DrawTriangle2D(Vertex* V0, Vertex* V1, Vertex* V2) {
 				A = PackedCol_A(color);
 			}
 
-			if (gfx_alphaTest && A < 0x80) continue;
-			if (gfx_alphaBlend && A == 0)  continue;
+			if (s->alphaTest && A < 0x80) continue;
+			if (s->alphaBlend && A == 0)  continue;
 
-			if (gfx_alphaBlend && A != 255) {
+			if (s->alphaBlend && A != 255) {
 				BitmapCol dst = colorBuffer[cb_index];
 				int dstR = BitmapCol_R(dst);
 				int dstG = BitmapCol_G(dst);
@@ -494,7 +678,8 @@ static void DrawTriangle2D(Vertex* V0, Vertex* V1, Vertex* V2) {
 	b2 = BitmapCol_B(tColor); \
 	B  = ( b1 * b2 ) >> 8;    \
 
-static void DrawTriangle3D(Vertex* V0, Vertex* V1, Vertex* V2) {
+/* Rasterises the rows of the triangle between bandMinY and bandMaxY */
+static void RasterTriangle3D(const struct RasterState* s, Vertex* V0, Vertex* V1, Vertex* V2, int bandMinY, int bandMaxY) {
 	int x0 = (int)V0->x, y0 = (int)V0->y;
 	int x1 = (int)V1->x, y1 = (int)V1->y;
 	int x2 = (int)V2->x, y2 = (int)V2->y;
@@ -504,105 +689,119 @@ static void DrawTriangle3D(Vertex* V0, Vertex* V1, Vertex* V2) {
 	int maxY = max(y0, max(y1, y2));
 
 	int area = edgeFunction(x0,y0, x1,y1, x2,y2);
-	if (faceCulling) {
-		// https://gamedev.stackexchange.com/questions/203694/how-to-make-backface-culling-work-correctly-in-both-orthographic-and-perspective
-		if (area < 0) return;
-	}
-
-	// Reject triangles completely outside
-	if (maxX < 0 || minX > fb_maxX) return;
-	if (maxY < 0 || minY > fb_maxY) return;
-
+	// Edge values are integers multiplied by 2, and flipped for back facing triangles so inside is never negative
+	int sign = area < 0 ? -2 : 2;
 	// Perform scissoring
-	minX = max(minX, 0); maxX = min(maxX, fb_maxX);
-	minY = max(minY, 0); maxY = min(maxY, fb_maxY);
+	minX = max(minX, 0);        maxX = min(maxX, s->maxX);
+	minY = max(minY, bandMinY); maxY = min(maxY, min(s->maxY, bandMaxY));
 
-	// NOTE: W in frag variables below is actually 1/W 
-	float factor = 1.0f / area;
+	// NOTE: W in frag variables below is actually 1/W
+	float factor = 1.0f / (area * sign);
 	float w0 = V0->w, w1 = V1->w, w2 = V2->w;
-	
-	// TODO proper clipping
-	if (w0 <= 0 || w1 <= 0 || w2 <= 0) {
-		return;
-	}
 
 	float z0 = V0->z, z1 = V1->z, z2 = V2->z;
+#ifndef SOFTGPU_DISABLE_ZBUFFER
+	// Interpolated depth is nearest at one of the vertices
+	// (slightly nearer than that is used, to allow for rounding when redrawing over same depth)
+	float minZ = min(z0 / w0, min(z1 / w1, z2 / w2)) * (1.0f - 1.0f / 4096);
+	cc_bool hiZ = s->depthTest;
+#endif
 	float u0 = V0->u, u1 = V1->u, u2 = V2->u;
 	float v0 = V0->v, v1 = V1->v, v2 = V2->v;
 	PackedCol color = V0->c;
-	
+
 	// https://fgiesen.wordpress.com/2013/02/10/optimizing-the-basic-rasterizer/
 	// Essentially these are the deltas of edge functions between X/Y and X/Y + 1 (i.e. one X/Y step)
-	int dx01  = y0 - y1, dy01 = x1 - x0;
-	int dx12  = y1 - y2, dy12 = x2 - x1;
-	int dx20  = y2 - y0, dy20 = x0 - x2;
+	int dx01  = (y0 - y1) * sign, dy01 = (x1 - x0) * sign;
+	int dx12  = (y1 - y2) * sign, dy12 = (x2 - x1) * sign;
+	int dx20  = (y2 - y0) * sign, dy20 = (x0 - x2) * sign;
 
-	float bc0_start = edgeFunction(x1,y1, x2,y2, minX+0.5f,minY+0.5f);
-	float bc1_start = edgeFunction(x2,y2, x0,y0, minX+0.5f,minY+0.5f);
-	float bc2_start = edgeFunction(x0,y0, x1,y1, minX+0.5f,minY+0.5f);
+	int bc0_start = edgeFixed(x1,y1, x2,y2, minX,minY) * (sign / 2);
+	int bc1_start = edgeFixed(x2,y2, x0,y0, minX,minY) * (sign / 2);
+	int bc2_start = edgeFixed(x0,y0, x1,y1, minX,minY) * (sign / 2);
 
 	int R, G, B, A;
 	int a1, r1, g1, b1;
 	int a2, r2, g2, b2;
-	cc_bool texturing = gfx_format == VERTEX_FORMAT_TEXTURED;
+	cc_bool texturing = s->texturing;
 
 	if (!texturing) {
 		R = PackedCol_R(color);
 		G = PackedCol_G(color);
 		B = PackedCol_B(color);
 		A = PackedCol_A(color);
-	} else if (texSinglePixel) {
+	} else if (s->texSinglePixel) {
 		/* Don't need to calculate complicated texturing in this case */
-		MultiplyColors(color, curTexPixels[0]);
+		MultiplyColors(color, s->texPixels[0]);
 		texturing = false;
 	}
 
-	for (int y = minY; y <= maxY; y++, bc0_start += dy12, bc1_start += dy20, bc2_start += dy01) 
-	{
-		float bc0 = bc0_start;
-		float bc1 = bc1_start;
-		float bc2 = bc2_start;
+	int rowMinX = minX, rowMaxX = maxX;
 
-		for (int x = minX; x <= maxX; x++, bc0 += dx12, bc1 += dx20, bc2 += dx01) 
+	for (int y = minY; y <= maxY; y++, bc0_start += dy12, bc1_start += dy20, bc2_start += dy01)
+	{
+#ifndef SOFTGPU_DISABLE_ZBUFFER
+		if (hiZ && (y == minY || !(y & HIZ_TILE_MASK))) {
+			rowMinX = minX; rowMaxX = maxX;
+			HiZ_CullTileRow(y >> HIZ_TILE_SHIFT, minZ, &rowMinX, &rowMaxX, s->depthWrite);
+		}
+		if (rowMinX > rowMaxX) continue;
+#endif
+		int skip = SkipOutside(bc0_start + (rowMinX - minX) * dx12,
+							   bc1_start + (rowMinX - minX) * dx20,
+							   bc2_start + (rowMinX - minX) * dx01,
+							   dx12, dx20, dx01, rowMaxX - rowMinX + 1) + (rowMinX - minX);
+		int bc0  = bc0_start + skip * dx12;
+		int bc1  = bc1_start + skip * dx20;
+		int bc2  = bc2_start + skip * dx01;
+		cc_bool inside = false;
+
+		for (int x = minX + skip; x <= rowMaxX; x++, bc0 += dx12, bc1 += dx20, bc2 += dx01)
 		{
+			if ((bc0 | bc1 | bc2) < 0) {
+				// Triangles are convex, so the rest of the row must be outside too
+				if (inside) break;
+				continue;
+			}
+			inside = true;
+
 			float ic0 = bc0 * factor;
 			float ic1 = bc1 * factor;
 			float ic2 = bc2 * factor;
-			if (ic0 < 0 || ic1 < 0 || ic2 < 0) continue;
 			int db_index = y * db_stride + x;
 
 			float w = 1 / (ic0 * w0 + ic1 * w1 + ic2 * w2);
 			float z = (ic0 * z0 + ic1 * z1 + ic2 * z2) * w;
 
 #ifndef SOFTGPU_DISABLE_ZBUFFER
-			if (depthTest && (z < 0 || z > depthBuffer[db_index])) continue;
-			if (!colWrite) {
-				if (depthWrite) depthBuffer[db_index] = z;
+			if (s->depthTest && (z < 0 || z > depthBuffer[db_index])) continue;
+			if (!s->colWrite) {
+				if (s->depthWrite) depthBuffer[db_index] = z;
 				continue;
 			}
 #else
-			if (!colWrite) continue;
+			if (!s->colWrite) continue;
 #endif
 
 			if (texturing) {
 				float u = (ic0 * u0 + ic1 * u1 + ic2 * u2) * w;
 				float v = (ic0 * v0 + ic1 * v1 + ic2 * v2) * w;
-				int texX = ((int)(Math_AbsF(u - FastFloor(u)) * curTexWidth )) & texWidthMask;
-				int texY = ((int)(Math_AbsF(v - FastFloor(v)) * curTexHeight)) & texHeightMask;
+				int texX = ((int)(Math_AbsF(u - FastFloor(u)) * s->texWidth )) & s->texWidthMask;
+				int texY = ((int)(Math_AbsF(v - FastFloor(v)) * s->texHeight)) & s->texHeightMask;
 
-				int texIndex = texY * curTexWidth + texX;
-				BitmapCol tColor = curTexPixels[texIndex];
+				int texIndex = texY * s->texWidth + texX;
+				BitmapCol tColor = s->texPixels[texIndex];
 
 				MultiplyColors(color, tColor);
 			}
 
-			if (gfx_alphaTest && A < 0x80) continue;
+			if (s->alphaTest && A < 0x80) continue;
 #ifndef SOFTGPU_DISABLE_ZBUFFER
-			if (depthWrite) depthBuffer[db_index] = z;
+			if (s->depthWrite) depthBuffer[db_index] = z;
 #endif
 			int cb_index = y * cb_stride + x;
-			
-			if (!gfx_alphaBlend) {
+
+			if (!s->alphaBlend) {
 				colorBuffer[cb_index] = BitmapCol_Make(R, G, B, 0xFF);
 				continue;
 			}
@@ -620,272 +819,351 @@ static void DrawTriangle3D(Vertex* V0, Vertex* V1, Vertex* V2) {
 	}
 }
 
-#define V0_VIS (1 << 0)
-#define V1_VIS (1 << 1)
-#define V2_VIS (1 << 2)
-#define V3_VIS (1 << 3)
 
-// https://github.com/behindthepixels/EDXRaster/blob/master/EDXRaster/Core/Clipper.h
-static void ClipLine(Vertex* v1, Vertex* v2, Vertex* V) {
-	float t  = Math_AbsF(v1->z / (v2->z - v1->z));
+/*########################################################################################################################*
+*-------------------------------------------------------Tile binning------------------------------------------------------*
+*#########################################################################################################################*/
+/* Triangles can be rasterised across multiple threads when real threads are available */
+#if !defined CC_BUILD_COOPTHREADED && !defined CC_BUILD_CONSOLE && !defined CC_BUILD_LOWMEM
+#define RASTER_MAX_THREADS 16
+/* Maximum number of triangles/states queued before they must be rasterised */
+#define RASTER_MAX_TRIS   4096
+#define RASTER_MAX_STATES 512
+/* Height in pixels of each band of the framebuffer that a thread rasterises */
+#define RASTER_BAND_HEIGHT 32
+
+struct RasterTri { Vertex v[3]; cc_uint16 state; cc_bool is2D; };
+static struct RasterTri* raster_tris;
+static struct RasterState raster_states[RASTER_MAX_STATES];
+static int raster_trisCount, raster_statesCount;
+/* Index of curState in raster_states, -1 if it still needs to be added */
+static int raster_curState = -1;
+
+/* Triangles overlapping each band, in the order they were drawn */
+static cc_uint16* raster_bins;
+static int* raster_binCounts;
+static int raster_bandsCount;
+
+static void* raster_mutex;
+static void* raster_doneSignal;
+static void* raster_threads[RASTER_MAX_THREADS];
+static void* raster_signals[RASTER_MAX_THREADS];
+static int raster_threadsCount, raster_startedCount;
+static int raster_busyThreads, raster_nextBand;
+static cc_bool raster_quit;
+
+static cc_bool RasterState_Equals(const struct RasterState* a, const struct RasterState* b) {
+	return a->texPixels == b->texPixels && a->texWidth == b->texWidth && a->texHeight == b->texHeight
+		&& a->texWidthMask == b->texWidthMask && a->texHeightMask == b->texHeightMask
+		&& a->texSinglePixel == b->texSinglePixel && a->texturing  == b->texturing
+		&& a->alphaTest  == b->alphaTest  && a->alphaBlend == b->alphaBlend
+		&& a->depthTest  == b->depthTest  && a->depthWrite == b->depthWrite && a->colWrite == b->colWrite
+		&& a->maxX == b->maxX && a->maxY == b->maxY;
+}
+
+static void RasterBand(int band) {
+	int minY = band * RASTER_BAND_HEIGHT, maxY = minY + RASTER_BAND_HEIGHT - 1;
+	cc_uint16* bin = &raster_bins[band * RASTER_MAX_TRIS];
+	struct RasterTri* tri;
+	int i;
+
+	for (i = 0; i < raster_binCounts[band]; i++)
+	{
+		tri = &raster_tris[bin[i]];
+		if (tri->is2D) {
+			RasterTriangle2D(&raster_states[tri->state], &tri->v[0], &tri->v[1], &tri->v[2], minY, maxY);
+		} else {
+			RasterTriangle3D(&raster_states[tri->state], &tri->v[0], &tri->v[1], &tri->v[2], minY, maxY);
+		}
+	}
+	raster_binCounts[band] = 0;
+}
+
+/* Rasterises bands of the current batch, until there are no bands left */
+static void RasterBands(void) {
+	int band;
+
+	for (;;) {
+		Mutex_Lock(raster_mutex);
+		band = raster_nextBand++;
+		Mutex_Unlock(raster_mutex);
+
+		if (band >= raster_bandsCount) return;
+		if (raster_binCounts[band]) RasterBand(band);
+	}
+}
+
+static void RasterWorkerLoop(void) {
+	cc_bool done;
+	void* signal;
+
+	Mutex_Lock(raster_mutex);
+	signal = raster_signals[raster_startedCount++];
+	Mutex_Unlock(raster_mutex);
+
+	for (;;) {
+		Waitable_Wait(signal);
+		if (raster_quit) return;
+		RasterBands();
+
+		Mutex_Lock(raster_mutex);
+		done = --raster_busyThreads == 0;
+		Mutex_Unlock(raster_mutex);
+		if (done) Waitable_Signal(raster_doneSignal);
+	}
+}
+
+/* Rasterises all queued triangles, using the main thread and worker threads */
+static void FlushTriangles(void) {
+	int i;
+	cc_bool busy;
+	if (!raster_trisCount) return;
+
+	Mutex_Lock(raster_mutex);
+	raster_nextBand    = 0;
+	raster_busyThreads = raster_threadsCount;
+	Mutex_Unlock(raster_mutex);
+
+	for (i = 0; i < raster_threadsCount; i++) Waitable_Signal(raster_signals[i]);
+	RasterBands();
+
+	for (;;) {
+		Mutex_Lock(raster_mutex);
+		busy = raster_busyThreads > 0;
+		Mutex_Unlock(raster_mutex);
+
+		if (!busy) break;
+		Waitable_Wait(raster_doneSignal);
+	}
+
+	raster_trisCount   = 0;
+	raster_statesCount = 0;
+	raster_curState    = -1;
+}
+
+static void QueueTriangle(Vertex* V0, Vertex* V1, Vertex* V2, int minY, int maxY, cc_bool is2D) {
+	struct RasterTri* tri;
+	int band, minBand, maxBand;
+
+	if (raster_trisCount == RASTER_MAX_TRIS) FlushTriangles();
+	if (raster_curState < 0) {
+		if (raster_statesCount == RASTER_MAX_STATES) FlushTriangles();
+		raster_curState = raster_statesCount++;
+		raster_states[raster_curState] = curState;
+	}
+
+	minBand = max(minY, 0) / RASTER_BAND_HEIGHT;
+	maxBand = min(maxY / RASTER_BAND_HEIGHT, raster_bandsCount - 1);
+	if (minBand > maxBand) return;
+
+	tri = &raster_tris[raster_trisCount];
+	tri->v[0]  = *V0; tri->v[1] = *V1; tri->v[2] = *V2;
+	tri->state = raster_curState;
+	tri->is2D  = is2D;
+
+	for (band = minBand; band <= maxBand; band++)
+	{
+		raster_bins[band * RASTER_MAX_TRIS + raster_binCounts[band]++] = raster_trisCount;
+	}
+	raster_trisCount++;
+}
+
+static void BeginTriangles(void) {
+	CaptureRasterState();
+	/* Draw calls typically reuse the same state as the previous one */
+	if (raster_curState >= 0 && RasterState_Equals(&raster_states[raster_curState], &curState)) return;
+	raster_curState = -1;
+}
+
+static void SubmitTriangle(Vertex* V0, Vertex* V1, Vertex* V2, int minY, int maxY, cc_bool is2D) {
+	if (raster_threadsCount) {
+		QueueTriangle(V0, V1, V2, minY, maxY, is2D);
+	} else if (is2D) {
+		RasterTriangle2D(&curState, V0, V1, V2, 0, fb_maxY);
+	} else {
+		RasterTriangle3D(&curState, V0, V1, V2, 0, fb_maxY);
+	}
+}
+
+static void AllocBins(void) {
+	if (!raster_threadsCount) return;
+	raster_bandsCount = (fb_height + RASTER_BAND_HEIGHT - 1) / RASTER_BAND_HEIGHT;
+
+	raster_bins      = (cc_uint16*)Mem_Alloc(raster_bandsCount * RASTER_MAX_TRIS, 2, "raster bins");
+	raster_binCounts = (int*)Mem_AllocCleared(raster_bandsCount, sizeof(int), "raster bin counts");
+}
+
+static void FreeBins(void) {
+	FlushTriangles();
+	Mem_Free(raster_bins);
+	Mem_Free(raster_binCounts);
+
+	raster_bins       = NULL;
+	raster_binCounts  = NULL;
+	raster_bandsCount = 0;
+}
+
+static void InitRasterThreads(void) {
+	int i;
+	raster_threadsCount = Options_GetInt(OPT_SOFTGPU_THREADS, 0, RASTER_MAX_THREADS, 3);
+	if (!raster_threadsCount) return;
+
+	raster_tris = (struct RasterTri*)Mem_Alloc(RASTER_MAX_TRIS, sizeof(struct RasterTri), "raster triangles");
+	raster_mutex      = Mutex_Create("Raster bands");
+	raster_doneSignal = Waitable_Create("Raster done");
+
+	for (i = 0; i < raster_threadsCount; i++) {
+		raster_signals[i] = Waitable_Create("Raster worker");
+	}
+	for (i = 0; i < raster_threadsCount; i++) {
+		Thread_Run(&raster_threads[i], RasterWorkerLoop, 64 * 1024, "Rasteriser");
+	}
+}
+
+static void FreeRasterThreads(void) {
+	int i;
+	if (!raster_threadsCount) return;
+	raster_quit = true;
+
+	for (i = 0; i < raster_threadsCount; i++) {
+		Waitable_Signal(raster_signals[i]);
+		Thread_Join(raster_threads[i]);
+		Waitable_Free(raster_signals[i]);
+	}
+
+	Waitable_Free(raster_doneSignal);
+	Mutex_Free(raster_mutex);
+	Mem_Free(raster_tris);
+	raster_threadsCount = 0;
+	raster_quit         = false;
+	raster_startedCount = 0;
+}
+#else
+static void BeginTriangles(void) { CaptureRasterState(); }
+
+static void SubmitTriangle(Vertex* V0, Vertex* V1, Vertex* V2, int minY, int maxY, cc_bool is2D) {
+	if (is2D) {
+		RasterTriangle2D(&curState, V0, V1, V2, 0, fb_maxY);
+	} else {
+		RasterTriangle3D(&curState, V0, V1, V2, 0, fb_maxY);
+	}
+}
+
+static void FlushTriangles(void)    { }
+static void AllocBins(void)         { }
+static void FreeBins(void)          { }
+static void InitRasterThreads(void) { }
+static void FreeRasterThreads(void) { }
+#endif
+
+static void DrawTriangle2D(Vertex* V0, Vertex* V1, Vertex* V2) {
+	int x0 = (int)V0->x, y0 = (int)V0->y;
+	int x1 = (int)V1->x, y1 = (int)V1->y;
+	int x2 = (int)V2->x, y2 = (int)V2->y;
+	int minX = min(x0, min(x1, x2));
+	int minY = min(y0, min(y1, y2));
+	int maxX = max(x0, max(x1, x2));
+	int maxY = max(y0, max(y1, y2));
+
+	int area = edgeFunction(x0,y0, x1,y1, x2,y2);
+	if (area == 0) return;
+
+	// Reject triangles completely outside
+	if (maxX < 0 || minX > fb_maxX) return;
+	if (maxY < 0 || minY > fb_maxY) return;
+
+	SubmitTriangle(V0, V1, V2, minY, maxY, true);
+}
+
+static void DrawTriangle3D(Vertex* V0, Vertex* V1, Vertex* V2) {
+	int x0 = (int)V0->x, y0 = (int)V0->y;
+	int x1 = (int)V1->x, y1 = (int)V1->y;
+	int x2 = (int)V2->x, y2 = (int)V2->y;
+	int minX = min(x0, min(x1, x2));
+	int minY = min(y0, min(y1, y2));
+	int maxX = max(x0, max(x1, x2));
+	int maxY = max(y0, max(y1, y2));
+
+	int area = edgeFunction(x0,y0, x1,y1, x2,y2);
+	if (faceCulling) {
+		// https://gamedev.stackexchange.com/questions/203694/how-to-make-backface-culling-work-correctly-in-both-orthographic-and-perspective
+		if (area < 0) return;
+	}
+
+	if (area == 0) return;
+
+	// Reject triangles completely outside
+	if (maxX < 0 || minX > fb_maxX) return;
+	if (maxY < 0 || minY > fb_maxY) return;
+
+	SubmitTriangle(V0, V1, V2, minY, maxY, false);
+}
+
+#define CLIP_MAX_VERTICES (3 + CLIP_PLANES)
+
+static void ClipLine(Vertex* v1, Vertex* v2, float t, Vertex* V) {
 	float invt = 1.0f - t;
-	
+
 	V->x = invt * v1->x + t * v2->x;
 	V->y = invt * v1->y + t * v2->y;
-	//V->z = invt * v1->z + t * v2->z;
-	V->z = 0.0f; // clipped against near plane anyways (I.e Z/W = 0 --> Z = 0)
+	V->z = invt * v1->z + t * v2->z;
 	V->w = invt * v1->w + t * v2->w;
-	
+
 	V->u = invt * v1->u + t * v2->u;
 	V->v = invt * v1->v + t * v2->v;
 	V->c = v1->c;
 }
 
-// https://casual-effects.com/research/McGuire2011Clipping/clip.glsl
-static void DrawClipped(int mask, Vertex* v0, Vertex* v1, Vertex* v2, Vertex* v3) {
-	Vertex tmp[2];
-	Vertex* a = &tmp[0];
-	Vertex* b = &tmp[1];
+// https://en.wikipedia.org/wiki/Sutherland%E2%80%93Hodgman_algorithm
+static int ClipPolygon(int plane, Vertex* src, int count, Vertex* dst) {
+	int i, clipped = 0;
 
-    switch (mask) {
-	case V0_VIS:
+	for (i = 0; i < count; i++)
 	{
-		//		   v0
-		//		  / |
-		//       /   |
-		// .....A....B...
-		//    /      |
-		//  v3--v2---v1
-		ClipLine(v3, v0, a);
-		ClipLine(v0, v1, b);
-
-		ViewportVertex3D(v0);
-		ViewportVertex3D(a);
-		ViewportVertex3D(b);
-
-		DrawTriangle3D(v0, a, b);
+		Vertex* a = &src[i];
+		Vertex* b = &src[(i + 1) % count];
+		float dA  = ClipDistance(a, plane);
+		float dB  = ClipDistance(b, plane);
+
+		if (dA >= 0.0f) dst[clipped++] = *a;
+		if ((dA >= 0.0f) != (dB >= 0.0f)) ClipLine(a, b, dA / (dA - dB), &dst[clipped++]);
 	}
-    break;
-	case V1_VIS:
-	{
-		//		   v1
-		//		  / |
-		//       /   |
-		// ....A.....B...
-		//    /      |
-		//  v0--v3---v2
-		ClipLine(v0, v1, a);
-		ClipLine(v1, v2, b);
-
-		ViewportVertex3D(v1);
-		ViewportVertex3D(a);
-		ViewportVertex3D(b);
-
-		DrawTriangle3D(a, b, v1);
-	} break;
-	case V2_VIS:
-	{
-		//		   v2
-		//		  / |
-		//       /   |
-		// ....A.....B...
-		//    /      |
-		//  v1--v0---v3
-		ClipLine(v1, v2, a);
-		ClipLine(v2, v3, b);
-
-		ViewportVertex3D(v2);
-		ViewportVertex3D(a);
-		ViewportVertex3D(b);
-
-		DrawTriangle3D(a, b, v2);
-	} break;
-	case V3_VIS:
+	return clipped;
+}
+
+// Clips the triangle against the planes in the given mask, then draws what's left as a triangle fan
+static void DrawClipped(int mask, Vertex* v0, Vertex* v1, Vertex* v2) {
+	Vertex bufferA[CLIP_MAX_VERTICES], bufferB[CLIP_MAX_VERTICES];
+	Vertex* src = bufferA;
+	Vertex* dst = bufferB;
+	Vertex* tmp;
+	PackedCol color = v0->c;
+	int plane, i, count = 3;
+
+	src[0] = *v0; src[1] = *v1; src[2] = *v2;
+	for (plane = 0; plane < CLIP_PLANES; plane++)
 	{
-		//		   v3
-		//		  / |
-		//       /   |
-		// ....A.....B...
-		//    /      |
-		//  v2--v1---v0
-		ClipLine(v2, v3, a);
-		ClipLine(v3, v0, b);
-
-		ViewportVertex3D(v3);
-		ViewportVertex3D(a);
-		ViewportVertex3D(b);
-		
-		DrawTriangle3D(b, v3, a);
+		if (!(mask & (1 << plane))) continue;
+		count = ClipPolygon(plane, src, count, dst);
+		if (count < 3) return;
+
+		tmp = src; src = dst; dst = tmp;
 	}
-	break;
-	case V0_VIS | V1_VIS:
-	{
-		//    v0-----------v1
-		//     \		   |
-		//   ...B.........A...
-		//		 \		  |
-		//		  v3-----v2
-		ClipLine(v1, v2, a);
-		ClipLine(v3, v0, b);
-
-		ViewportVertex3D(v0);
-		ViewportVertex3D(v1);
-		ViewportVertex3D(a);
-		ViewportVertex3D(b);
-
-		DrawTriangle3D(v1, v0,  a);
-		DrawTriangle3D(a,  v0,  b);
-	} break;
-	// case V0_VIS | V2_VIS: degenerate case that should never happen
-	case V0_VIS | V3_VIS:
-	{
-		//    v3-----------v0
-		//     \		   |
-		//   ...B.........A...
-		//		 \		  |
-		//		  v2-----v1
-		ClipLine(v0, v1, a);
-		ClipLine(v2, v3, b);
-
-		ViewportVertex3D(v0);
-		ViewportVertex3D(v3);
-		ViewportVertex3D(a);
-		ViewportVertex3D(b);
-
-		DrawTriangle3D(a, v0,  b);
-		DrawTriangle3D(b, v0, v3);
-	} break;
-	case V1_VIS | V2_VIS:
-	{
-		//    v1-----------v2
-		//     \		   |
-		//   ...B.........A...
-		//		 \		  |
-		//		  v0-----v3
-		ClipLine(v2, v3, a);
-		ClipLine(v0, v1, b);
-
-		ViewportVertex3D(v1);
-		ViewportVertex3D(v2);
-		ViewportVertex3D(a);
-		ViewportVertex3D(b);
-
-		DrawTriangle3D(v1,  b, v2);
-		DrawTriangle3D(v2,  b,  a);
-	} break;
-	// case V1_VIS | V3_VIS: degenerate case that should never happen
-	case V2_VIS | V3_VIS:
-	{
-		//    v2-----------v3
-		//     \		   |
-		//   ...B.........A...
-		//		 \		  |
-		//		  v1-----v0
-		ClipLine(v3, v0, a);
-		ClipLine(v1, v2, b);
-
-		ViewportVertex3D(v2);
-		ViewportVertex3D(v3);
-		ViewportVertex3D(a);
-		ViewportVertex3D(b);
-
-		DrawTriangle3D( b,  a, v2);
-		DrawTriangle3D(v2,  a, v3);
-	} break;
-	case V0_VIS | V1_VIS | V2_VIS:
-	{
-		//		  --v1--
-		//    v0--      --v2
-		//      \		 /
-		//   ....B.....A...
-		//		  \   /
-		//		    v3
-		// v1,v2,v0  v2,v0,A  v0,A,B
-		ClipLine(v2, v3, a);
-		ClipLine(v3, v0, b);
-
-		ViewportVertex3D(v0);
-		ViewportVertex3D(v1);
-		ViewportVertex3D(v2);
-		ViewportVertex3D(a);
-		ViewportVertex3D(b);
-
-		DrawTriangle3D(v1, v0, v2);
-		DrawTriangle3D(v2, v0,  a);
-		DrawTriangle3D(v0,  b,  a);
-	} break;
-	case V0_VIS | V1_VIS | V3_VIS:
-	{
-		//		  --v0--
-		//    v3--      --v1
-		//      \		 /
-		//   ....B.....A...
-		//		  \   /
-		//		    v2
-		// v0,v1,v3  v1,v3,A  v3,A,B
-		ClipLine(v1, v2, a);
-		ClipLine(v2, v3, b);
-
-		ViewportVertex3D(v0);
-		ViewportVertex3D(v1);
-		ViewportVertex3D(v3);
-		ViewportVertex3D(a);
-		ViewportVertex3D(b);
-
-		DrawTriangle3D(v0, v3, v1);
-		DrawTriangle3D(v1, v3,  a);
-		DrawTriangle3D(v3,  b,  a);
-	} break;
-	case V0_VIS | V2_VIS | V3_VIS:
-	{
-		//		  --v3--
-		//    v2--      --v0
-		//      \		 /
-		//   ....B.....A...
-		//		  \   /
-		//		    v1
-		// v3,v0,v2  v0,v2,A  v2,A,B
-		ClipLine(v0, v1, a);
-		ClipLine(v1, v2, b);
-
-		ViewportVertex3D(v0);
-		ViewportVertex3D(v2);
-		ViewportVertex3D(v3);
-		ViewportVertex3D(a);
-		ViewportVertex3D(b);
-
-		DrawTriangle3D(v3, v2, v0);
-		DrawTriangle3D(v0, v2,  a);
-		DrawTriangle3D(v2,  b,  a);
-	} break;
-	case V1_VIS | V2_VIS | V3_VIS:
+
+	for (i = 0; i < count; i++) ViewportVertex3D(&src[i]);
+	// Triangles are flat shaded using the colour of their first vertex
+	src[0].c = color;
+
+	for (i = 1; i < count - 1; i++)
 	{
-		//		  --v2--
-		//    v1--      --v3
-		//      \		 /
-		//   ....B.....A...
-		//		  \   /
-		//		    v0
-		// v2,v3,v1  v3,v1,A  v1,A,B
-		ClipLine(v3, v0, a);
-		ClipLine(v0, v1, b);
-
-		ViewportVertex3D(v1);
-		ViewportVertex3D(v2);
-		ViewportVertex3D(v3);
-		ViewportVertex3D(a);
-		ViewportVertex3D(b);
-
-		DrawTriangle3D(v2, v1, v3);
-		DrawTriangle3D(v3, v1,  a);
-		DrawTriangle3D(v1,  b,  a);
-	} break;
+		DrawTriangle3D(&src[0], &src[i], &src[i + 1]);
 	}
 }
 
 void DrawQuads(int startVertex, int verticesCount) {
 	Vertex vertices[4];
 	int j = startVertex;
+	BeginTriangles();
 
 	if (gfx_rendering2D) {
 		// 4 vertices = 1 quad = 2 triangles
@@ -903,14 +1181,14 @@ void DrawQuads(int startVertex, int verticesCount) {
 		// 4 vertices = 1 quad = 2 triangles
 		for (int i = 0; i < verticesCount / 4; i++, j += 4)
 		{
-			int clip = TransformVertex3D(j + 0, &vertices[0]) << 0
-					|  TransformVertex3D(j + 1, &vertices[1]) << 1
-					|  TransformVertex3D(j + 2, &vertices[2]) << 2
-					|  TransformVertex3D(j + 3, &vertices[3]) << 3;
-
-			if (clip == 0) {
-				// Quad entirely clipped
-			} else if (clip == 0x0F) {
+			int clip0 = TransformVertex3D(j + 0, &vertices[0]);
+			int clip1 = TransformVertex3D(j + 1, &vertices[1]);
+			int clip2 = TransformVertex3D(j + 2, &vertices[2]);
+			int clip3 = TransformVertex3D(j + 3, &vertices[3]);
+
+			if (clip0 & clip1 & clip2 & clip3) {
+				// Quad entirely outside one of the clip planes
+			} else if (!(clip0 | clip1 | clip2 | clip3)) {
 				// Quad entirely visible
 				ViewportVertex3D(&vertices[0]);
 				ViewportVertex3D(&vertices[1]);
@@ -921,13 +1199,14 @@ void DrawQuads(int startVertex, int verticesCount) {
 				DrawTriangle3D(&vertices[2], &vertices[0], &vertices[3]);
 			} else {
 				// Quad partially visible
-				DrawClipped(clip, &vertices[0], &vertices[1], &vertices[2], &vertices[3]);
+				DrawClipped(clip0 | clip2 | clip1, &vertices[0], &vertices[2], &vertices[1]);
+				DrawClipped(clip2 | clip0 | clip3, &vertices[2], &vertices[0], &vertices[3]);
 			}
 		}
 	}
 }
 
-void Gfx_SetVertexFormat(VertexFormat fmt) {
+static void SetVertexFormat(VertexFormat fmt) {
 	gfx_format = fmt;
 	gfx_stride = strideSizes[fmt];
 }
@@ -956,6 +1235,7 @@ static BitmapCol* CB_GetRow(struct Bitmap* bmp, int y, void* ctx) {
 
 cc_result Gfx_TakeScreenshot(struct Stream* output) {
 	struct Bitmap bmp;
+	FlushTriangles();
 	Bitmap_Init(bmp, fb_width, fb_height, NULL);
 	return Png_Encode(&bmp, output, CB_GetRow, false, NULL);
 }
@@ -967,6 +1247,7 @@ void Gfx_BeginFrame(void) { }
 
 void Gfx_EndFrame(void) {
 	Rect2D r = { 0, 0, fb_width, fb_height };
+	FlushTriangles();
 	Window_DrawFramebuffer(r, &fb_bmp);
 }
 
@@ -975,6 +1256,7 @@ void Gfx_SetVSync(cc_bool vsync) {
 }
 
 void Gfx_OnWindowResize(void) {
+	FreeBins();
 	if (depthBuffer) DestroyBuffers();
 
 	fb_width   = Game.Width;
@@ -987,7 +1269,13 @@ void Gfx_OnWindowResize(void) {
 #ifndef SOFTGPU_DISABLE_ZBUFFER
 	depthBuffer = Mem_Alloc(fb_width * fb_height, 4, "depth buffer");
 	db_stride   = fb_width;
+
+	hiz_tilesX  = (fb_width  + HIZ_TILE_MASK) >> HIZ_TILE_SHIFT;
+	hiz_tilesY  = (fb_height + HIZ_TILE_MASK) >> HIZ_TILE_SHIFT;
+	hizMaxDepth = (float*)Mem_Alloc(hiz_tilesX * hiz_tilesY, 4, "hi-z depth");
+	hizDirty    = (cc_uint8*)Mem_AllocCleared(hiz_tilesX * hiz_tilesY, 1, "hi-z dirty");
 #endif
+	AllocBins();
 
 	Gfx_SetViewport(0, 0, Game.Width, Game.Height);
 	Gfx_SetScissor (0, 0, Game.Width, Game.Height);
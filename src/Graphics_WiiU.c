@@ -159,7 +159,7 @@ void Gfx_SetFaceCulling(cc_bool enabled) {
 	GX2SetCullOnlyControl(GX2_FRONT_FACE_CCW, false, enabled);
 }
 
-void Gfx_SetFog(cc_bool enabled) {
+static void SetFog(cc_bool enabled) {
 	// TODO
 }
 
@@ -306,8 +306,7 @@ void Gfx_UnlockDynamicVb(GfxResourceID vb)  { Gfx_UnlockVb(vb); Gfx_BindVb(vb);
 /*########################################################################################################################*
 *-----------------------------------------------------Vertex rendering----------------------------------------------------*
 *#########################################################################################################################*/
-void Gfx_SetVertexFormat(VertexFormat fmt) {
-	if (fmt == gfx_format) return;
+static void SetVertexFormat(VertexFormat fmt) {
 	gfx_format = fmt;
 	gfx_stride = strideSizes[fmt];
 	
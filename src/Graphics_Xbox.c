@@ -464,7 +464,7 @@ void Gfx_DeleteDynamicVb(GfxResourceID* vb) { Gfx_DeleteVb(vb); }
 /*########################################################################################################################*
 *-----------------------------------------------------State management----------------------------------------------------*
 *#########################################################################################################################*/
-void Gfx_SetFog(cc_bool enabled) {
+static void SetFog(cc_bool enabled) {
 }
 
 void Gfx_SetFogCol(PackedCol color) {
@@ -617,8 +617,7 @@ static uint32_t* PushAttrib(uint32_t* p, int index, int format, int size, int st
 						MASK(NV097_SET_VERTEX_DATA_ARRAY_FORMAT_STRIDE, stride));
 }
 
-void Gfx_SetVertexFormat(VertexFormat fmt) {
-	if (fmt == gfx_format) return;
+static void SetVertexFormat(VertexFormat fmt) {
 	gfx_format = fmt;
 	gfx_stride = strideSizes[fmt];
 
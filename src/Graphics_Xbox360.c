@@ -136,7 +136,7 @@ void Gfx_SetFaceCulling(cc_bool enabled) {
 	Xe_SetCullMode(xe, enabled ? XE_CULL_CW : XE_CULL_NONE);
 }
 
-void Gfx_SetFog(cc_bool enabled) {
+static void SetFog(cc_bool enabled) {
 	// TODO
 }
 
@@ -266,8 +266,7 @@ void Gfx_UnlockDynamicVb(GfxResourceID vb)  { Gfx_UnlockVb(vb); Gfx_BindVb(vb);
 /*########################################################################################################################*
 *-----------------------------------------------------Vertex rendering----------------------------------------------------*
 *#########################################################################################################################*/
-void Gfx_SetVertexFormat(VertexFormat fmt) {
-	if (fmt == gfx_format) return;
+static void SetVertexFormat(VertexFormat fmt) {
 	Platform_LogConst("CHANGE FORMAT");
 	gfx_format = fmt;
 	gfx_stride = strideSizes[fmt];
@@ -381,7 +381,7 @@ void TextAtlas_Make(struct TextAtlas* atlas, const cc_string* chars, struct Font
 	}
 	height = Drawer2D_TextHeight(&args);
 
-	Context2D_Alloc(&ctx, width, height);
+	Context2D_AllocTemp(&ctx, width, height);
 	{
 		args.text = *prefix;
 		Context2D_DrawText(&ctx, &args, 0, 0);
@@ -713,7 +713,7 @@ static void OnInit(void) {
 
 #ifdef CC_BUILD_DUALSCREEN
 	struct Context2D ctx;
-	Context2D_Alloc(&ctx, 32, 32);
+	Context2D_AllocTemp(&ctx, 32, 32);
 	Gradient_Noise(&ctx, BitmapColor_RGB(0x40, 0x30, 0x20), 6, 0, 0, ctx.width, ctx.height);
 	Context2D_MakeTexture(&touchBgTex, &ctx);
 	Context2D_Free(&ctx);
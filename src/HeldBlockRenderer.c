@@ -15,6 +15,8 @@ cc_bool HeldBlockRenderer_Show;
 static BlockID held_block;
 static struct Entity held_entity;
 static struct Matrix held_blockProj;
+/* The held block rarely changes, so its vertices are kept around */
+static struct BlockModelCache held_cache;
 
 static cc_bool held_animating, held_breaking, held_swinging;
 static float held_swingY;
@@ -54,7 +56,7 @@ static void HeldBlockRenderer_RenderModel(void) {
 		Vec3_Set(held_entity.ModelScale, 0.4f, 0.4f, 0.4f);
 
 		Gfx_SetupAlphaState(Blocks.Draw[held_block]);
-		Model_Render(model, &held_entity);
+		BlockModel_RenderCached(&held_cache, &held_entity);
 		Gfx_RestoreAlphaState(Blocks.Draw[held_block]);
 	}
 	
@@ -91,6 +93,9 @@ static void ResetHeldState(void) {
 	held_entity.MobTextureId = p->MobTextureId;
 	held_entity.uScale       = p->uScale;
 	held_entity.vScale       = p->vScale;
+	held_entity.uOffset      = p->uOffset;
+	held_entity.vOffset      = p->vOffset;
+	held_entity.Flags        = (held_entity.Flags & ~ENTITY_FLAG_SKIN_ATLAS) | (p->Flags & ENTITY_FLAG_SKIN_ATLAS);
 }
 
 static void SetBaseOffset(void) {
@@ -244,6 +249,13 @@ void HeldBlockRenderer_Render(float delta) {
 
 static void OnContextLost(void* obj) {
 	Gfx_DeleteDynamicVb(&held_entity.ModelVB);
+	Gfx_DeleteDynamicVb(&held_cache.vb);
+	held_cache.valid = false;
+}
+
+/* Textures or definition of the cached block may have changed */
+static void OnBlocksChanged(void* obj) {
+	held_cache.valid = false;
 }
 
 static const struct EntityVTABLE heldEntity_VTABLE = {
@@ -262,6 +274,8 @@ static void OnInit(void) {
 	Event_Register_(&UserEvents.HeldBlockChanged, NULL, DoSwitchBlockAnim);
 	Event_Register_(&UserEvents.BlockChanged,     NULL, OnBlockChanged);
 	Event_Register_(&GfxEvents.ContextLost,       NULL, OnContextLost);
+	Event_Register_(&BlockEvents.BlockDefChanged, NULL, OnBlocksChanged);
+	Event_Register_(&TextureEvents.AtlasChanged,  NULL, OnBlocksChanged);
 }
 #else
 void HeldBlockRenderer_ClickAnim(cc_bool digging) { }
@@ -12,10 +12,13 @@ Copyright 2014-2025 ClassiCube | Licensed under BSD-3
 struct IGameComponent;
 struct ScheduledTask;
 struct StringsBuffer;
+struct Stream;
 
 #define URL_MAX_SIZE (STRING_SIZE * 2)
 #define HTTP_FLAG_PRIORITY 0x01
 #define HTTP_FLAG_NOCACHE  0x02
+/* Request is processed after all requests without this flag (e.g. skins of far away entities) */
+#define HTTP_FLAG_LOW_PRIORITY 0x04
 
 extern struct IGameComponent Http_Component;
 
@@ -44,8 +47,13 @@ struct HttpRequest {
 	char lastModified[STRING_SIZE]; /* Time item cached at (if at all) */
 	char etag[STRING_SIZE];         /* ETag of cached item (if any) */
 	cc_uint8 requestType;           /* See the various REQUEST_TYPE_ */
+	cc_uint8 priority;              /* Requests with higher priority are processed first */
 	cc_bool success;                /* Whether Result is 0, status is 200, and data is not NULL */
 	struct StringsBuffer* cookies;  /* Cookie list sent in requests. May be modified by the response. */
+
+	struct Stream* sink;   /* Stream response contents are written to as they arrive, NULL if not streaming */
+	cc_uint32 _streamed;   /* (private) Number of bytes written to sink so far */
+	cc_result _sinkResult; /* (private) First error from writing to or closing sink */
 };
 
 /* Frees all dynamically allocated data from a HTTP request */
@@ -64,6 +72,11 @@ int Http_AsyncPostData(const cc_string* url, cc_uint8 flags, const void* data, c
 /* Asynchronously performs a http GET request. (e.g. to download data) */
 /* Also sets the If-Modified-Since and If-None-Match headers. (if not NULL)  */
 int Http_AsyncGetDataEx(const cc_string* url, cc_uint8 flags, const cc_string* lastModified, const cc_string* etag, struct StringsBuffer* cookies);
+/* Asynchronously performs a http GET request, writing the contents of a 200 OK response to sink as they arrive. */
+/* This avoids having to keep the entire response in memory, which for e.g. large texture packs can be 50 MB. */
+/* NOTE: A copy is made of sink, which is written to from a http worker thread and closed once the request finishes. */
+/*   As such the caller must not use sink again. On success, data is NULL and size is how many bytes were written. */
+int Http_AsyncGetDataToStream(const cc_string* url, cc_uint8 flags, const cc_string* lastModified, const cc_string* etag, struct Stream* sink);
 /* Attempts to remove given request from pending and finished request lists. */
 /* NOTE: Won't cancel the request if it is currently in progress. */
 void Http_TryCancel(int reqID);
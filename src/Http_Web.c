@@ -13,10 +13,12 @@ static cc_uint64 startTime;
 *----------------------------------------------------Http public api------------------------------------------------------*
 *#########################################################################################################################*/
 cc_bool Http_GetResult(int reqID, struct HttpRequest* item) {
-	int i = RequestList_Find(&processedReqs, reqID);
+	int i;
+	if (!Http_MaybeProcessed(reqID)) return false;
+	i = RequestList_Find(&processedReqs, reqID);
 
 	if (i >= 0) *item = processedReqs.entries[i];
-	if (i >= 0) RequestList_RemoveAt(&processedReqs, i);
+	if (i >= 0) Http_RemoveProcessed(i);
 	return i >= 0;
 }
 
@@ -34,6 +36,8 @@ int Http_CheckProgress(int reqID) {
 }
 
 void Http_ClearPending(void) {
+	Http_CloseAllSinks(queuedReqs.entries,  queuedReqs.count);
+	Http_CloseAllSinks(workingReqs.entries, workingReqs.count);
 	RequestList_Free(&queuedReqs);
 	RequestList_Free(&workingReqs);
 }
@@ -41,7 +45,7 @@ void Http_ClearPending(void) {
 void Http_TryCancel(int reqID) {
 	RequestList_TryFree(&queuedReqs,    reqID);
 	RequestList_TryFree(&workingReqs,   reqID);
-	RequestList_TryFree(&processedReqs, reqID);
+	Http_TryFreeProcessed(reqID);
 }
 
 
@@ -81,7 +85,7 @@ static void Http_StartNextDownload(void) {
 		RequestList_RemoveAt(&queuedReqs, 0);
 		Http_StartNextDownload();
 	} else {
-		RequestList_Append(&workingReqs, req, false);
+		RequestList_Append(&workingReqs, req);
 		RequestList_RemoveAt(&queuedReqs, 0);
 	}
 }
@@ -127,7 +131,7 @@ static void HttpBackend_Add(struct HttpRequest* req, cc_uint8 flags) {
 		String_Format2(&url, "?t=%i%i", &hi, &lo);
 	}
 
-	RequestList_Append(&queuedReqs, req, flags);
+	RequestList_Append(&queuedReqs, req);
 	Http_StartNextDownload();
 }
 
@@ -2,6 +2,20 @@
 #ifndef CC_BUILD_WEB
 #include "_HttpBase.h"
 
+/* Maximum number of worker threads that can process requests at the same time */
+#if defined CC_BUILD_ANDROID
+	/* Android backend tracks the request it is processing in a global */
+	#define HTTP_MAX_WORKERS 1
+#else
+	#define HTTP_MAX_WORKERS 4
+#endif
+
+#if defined CC_BUILD_ANDROID || defined CC_BUILD_LOWMEM
+	#define HTTP_DEF_WORKERS 1
+#else
+	#define HTTP_DEF_WORKERS 3
+#endif
+
 /* Ensures data buffer has enough space left to append amount bytes */
 static cc_bool Http_BufferExpand(struct HttpRequest* req, cc_uint32 amount) {
 	cc_uint32 newSize = req->size + amount;
@@ -10,7 +24,8 @@ static cc_bool Http_BufferExpand(struct HttpRequest* req, cc_uint32 amount) {
 
 	if (!req->_capacity) {
 		/* Allocate initial storage */
-		req->_capacity = req->contentLength ? req->contentLength : 1;
+		/* (when streaming, data is written to the sink after each read, so only space for one read is needed) */
+		req->_capacity = req->contentLength && !Http_IsStreaming(req) ? req->contentLength : 1;
 		req->_capacity = max(req->_capacity, newSize);
 
 		ptr = (cc_uint8*)Mem_TryAlloc(req->_capacity, 1);
@@ -28,13 +43,18 @@ static cc_bool Http_BufferExpand(struct HttpRequest* req, cc_uint32 amount) {
 /* Increases size and updates current progress */
 static void Http_BufferExpanded(struct HttpRequest* req, cc_uint32 read) {
 	req->size += read;
-	if (req->contentLength) req->progress = (int)(100.0f * req->size / req->contentLength);
+	if (Http_IsStreaming(req)) Http_FlushSink(req);
+	if (req->contentLength) req->progress = (int)(100.0f * (req->_streamed + req->size) / req->contentLength);
 }
 
 
 /*########################################################################################################################*
 *---------------------------------------------------Common backend code---------------------------------------------------*
 *#########################################################################################################################*/
+/* Multiple requests being processed by different worker threads may share the same cookies list */
+/*  (e.g. the launcher's ccCookies), so it must only be accessed with this locked */
+static void* cookiesMutex;
+
 static void Http_ParseCookie(struct HttpRequest* req, const cc_string* value) {
 	cc_string name, data;
 	int dataEnd;
@@ -44,7 +64,11 @@ static void Http_ParseCookie(struct HttpRequest* req, const cc_string* value) {
 	dataEnd = String_IndexOf(&data, ';');
 	if (dataEnd >= 0) data.length = dataEnd;
 
-	EntryList_Set(req->cookies, &name, &data, '=');
+	Mutex_Lock(cookiesMutex);
+	{
+		EntryList_Set(req->cookies, &name, &data, '=');
+	}
+	Mutex_Unlock(cookiesMutex);
 }
 
 static void Http_ParseContentLength(struct HttpRequest* req, const cc_string* value) {
@@ -103,26 +127,30 @@ static void Http_SetRequestHeaders(struct HttpRequest* req) {
 	}
 
 	if (req->data) Http_AddHeader(req, "Content-Type", &contentType);
-	if (!req->cookies || !req->cookies->count) return;
-
+	if (!req->cookies) return;
 	String_InitArray(cookies, cookiesBuffer);
-	for (i = 0; i < req->cookies->count; i++) {
-		if (i) String_AppendConst(&cookies, "; ");
-		str = StringsBuffer_UNSAFE_Get(req->cookies, i);
-		String_AppendString(&cookies, &str);
+
+	Mutex_Lock(cookiesMutex);
+	{
+		for (i = 0; i < req->cookies->count; i++) {
+			if (i) String_AppendConst(&cookies, "; ");
+			str = StringsBuffer_UNSAFE_Get(req->cookies, i);
+			String_AppendString(&cookies, &str);
+		}
 	}
-	Http_AddHeader(req, "Cookie", &cookies);
+	Mutex_Unlock(cookiesMutex);
+
+	if (cookies.length) Http_AddHeader(req, "Cookie", &cookies);
 }
 
-/* TODO: Rewrite to use a local variable instead */
-static cc_string* Http_GetUserAgent_UNSAFE(void) {
-	static char userAgentBuffer[STRING_SIZE];
-	static cc_string userAgent;
+/* NOTE: Uses a local variable, as multiple worker threads may be adding headers at once */
+static void Http_AddUserAgent(struct HttpRequest* req) {
+	cc_string userAgent; char userAgentBuffer[STRING_SIZE];
 
 	String_InitArray(userAgent, userAgentBuffer);
 	String_AppendConst(&userAgent, GAME_APP_NAME);
 	String_AppendConst(&userAgent, Platform_AppNameSuffix);
-	return &userAgent;
+	Http_AddHeader(req, "User-Agent", &userAgent);
 }
 
 
@@ -229,9 +257,41 @@ static cc_bool LoadCurlFuncs(void) {
 	return success;
 }
 
-static CURL* curl;
+/* Easy handles can't be used from multiple threads at once, so each worker uses its own */
+static CURL* curlHandles[HTTP_MAX_WORKERS];
+static cc_bool curlInUse[HTTP_MAX_WORKERS];
+static void* curlMutex;
 static cc_bool curlSupported, curlVerbose;
 
+static CURL* Curl_Acquire(void) {
+	CURL* curl = NULL;
+	int i;
+
+	Mutex_Lock(curlMutex);
+	for (i = 0; i < HTTP_MAX_WORKERS; i++)
+	{
+		if (curlInUse[i]) continue;
+		if (!curlHandles[i]) curlHandles[i] = _curl_easy_init();
+
+		curl = curlHandles[i];
+		if (curl) curlInUse[i] = true;
+		break;
+	}
+	Mutex_Unlock(curlMutex);
+	return curl;
+}
+
+static void Curl_Release(CURL* curl) {
+	int i;
+
+	Mutex_Lock(curlMutex);
+	for (i = 0; i < HTTP_MAX_WORKERS; i++)
+	{
+		if (curlHandles[i] == curl) curlInUse[i] = false;
+	}
+	Mutex_Unlock(curlMutex);
+}
+
 static cc_bool HttpBackend_DescribeError(cc_result res, cc_string* dst) {
 	const char* err;
 	
@@ -246,12 +306,13 @@ static cc_bool HttpBackend_DescribeError(cc_result res, cc_string* dst) {
 static void HttpBackend_Init(void) {
 	static const cc_string msg = String_FromConst("Failed to init libcurl. All HTTP requests will therefore fail.");
 	CURLcode res;
+	curlMutex = Mutex_Create("HTTP curl");
 
 	if (!LoadCurlFuncs()) { Logger_WarnFunc(&msg); return; }
 	res = _curl_global_init(CURL_GLOBAL_DEFAULT);
 	if (res) { Logger_SimpleWarn(res, "initing curl"); return; }
-	curl = _curl_easy_init();
-	if (!curl) { Logger_SimpleWarn(res, "initing curl_easy"); return; }
+	curlHandles[0] = _curl_easy_init();
+	if (!curlHandles[0]) { Logger_SimpleWarn(res, "initing curl_easy"); return; }
 
 	curlSupported = true;
 	curlVerbose = Options_GetBool("curl-verbose", false);
@@ -293,7 +354,7 @@ static size_t Http_ProcessData(char *buffer, size_t size, size_t nitems, void* u
 }
 
 /* Sets general curl options for a request */
-static void Http_SetCurlOpts(struct HttpRequest* req) {
+static void Http_SetCurlOpts(CURL* curl, struct HttpRequest* req) {
 	_curl_easy_setopt(curl, CURLOPT_USERAGENT,      GAME_APP_NAME);
 	_curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
 	_curl_easy_setopt(curl, CURLOPT_MAXREDIRS,      20L);
@@ -314,13 +375,17 @@ static cc_result HttpBackend_Do(struct HttpRequest* req, cc_string* url) {
 	char urlStr[NATIVE_STR_LEN];
 	void* post_data = req->data;
 	CURLcode res;
+	CURL* curl;
 	if (!curlSupported) return ERR_NOT_SUPPORTED;
 
+	curl = Curl_Acquire();
+	if (!curl) return ERR_OUT_OF_MEMORY;
+
 	req->meta = NULL;
 	Http_SetRequestHeaders(req);
 	_curl_easy_setopt(curl, CURLOPT_HTTPHEADER, req->meta);
 
-	Http_SetCurlOpts(req);
+	Http_SetCurlOpts(curl, req);
 	String_EncodeUtf8(urlStr, url);
 	_curl_easy_setopt(curl, CURLOPT_URL, urlStr);
 
@@ -360,6 +425,7 @@ static cc_result HttpBackend_Do(struct HttpRequest* req, cc_string* url) {
 	/* can free now that request has finished */
 	Mem_Free(post_data);
 	_curl_easy_setopt(curl, CURLOPT_ERRORBUFFER, NULL);
+	Curl_Release(curl);
 	return res;
 }
 #elif CC_NET_BACKEND == CC_NET_BACKEND_BUILTIN
@@ -529,46 +595,104 @@ static cc_result HttpConnection_Write(struct HttpConnection* conn, const cc_uint
 /*########################################################################################################################*
 *-----------------------------------------------------Connection Pool-----------------------------------------------------*
 *#########################################################################################################################*/
+/* Connections idle for longer than this are likely to have been closed by the server already */
+#define POOL_IDLE_TIMEOUT 30
+
 static struct ConnectionPoolEntry {
 	struct HttpConnection conn;
 	cc_string addr;
 	char addrBuffer[STRING_SIZE];
 	cc_bool https;
-} connection_pool[10];
+	cc_bool inUse;   /* Whether a worker thread is currently using this connection */
+	TimeMS lastUsed; /* Time this connection was last handed out, in seconds */
+} connection_pool[16];
+static void* poolMutex;
 
-static cc_result ConnectionPool_Insert(int i, struct HttpConnection** conn, const struct HttpUrl* url) {
+static struct ConnectionPoolEntry* ConnectionPool_Insert(int i, const struct HttpUrl* url) {
 	struct ConnectionPoolEntry* e = &connection_pool[i];
-	*conn = &e->conn;
 
 	String_InitArray(e->addr, e->addrBuffer);
 	String_Copy(&e->addr, &url->address);
-	e->https = url->https;
-	return HttpConnection_Open(&e->conn, url);
+	e->https    = url->https;
+	e->lastUsed = DateTime_CurrentUTC();
+	return e;
 }
 
-static cc_result ConnectionPool_Open(struct HttpConnection** conn, const struct HttpUrl* url) {
+/* Closes connections that have been idle for too long to still be usable */
+static void ConnectionPool_CloseIdle(TimeMS now) {
 	struct ConnectionPoolEntry* e;
 	int i;
 
 	for (i = 0; i < Array_Elems(connection_pool); i++)
 	{
 		e = &connection_pool[i];
-		if (e->conn.valid && e->https == url->https && String_Equals(&e->addr, &url->address)) {
-			*conn = &connection_pool[i].conn;
-			return 0;
+		if (e->inUse) continue;
+
+		if (e->conn.valid && e->lastUsed + POOL_IDLE_TIMEOUT < now) {
+			HttpConnection_Close(&e->conn);
 		}
 	}
+}
+
+/* Finds an existing connection to reuse, or otherwise the entry to open a new connection in */
+static struct ConnectionPoolEntry* ConnectionPool_Find(const struct HttpUrl* url) {
+	struct ConnectionPoolEntry* e;
+	TimeMS now = DateTime_CurrentUTC();
+	int i, oldest = -1;
+	ConnectionPool_CloseIdle(now);
 
 	for (i = 0; i < Array_Elems(connection_pool); i++)
 	{
 		e = &connection_pool[i];
-		if (!e->conn.valid) return ConnectionPool_Insert(i, conn, url);
+		if (e->inUse || !e->conn.valid) continue;
+
+		if (e->https == url->https && String_Equals(&e->addr, &url->address)) {
+			e->lastUsed = now;
+			return e;
+		}
+	}
+
+	for (i = 0; i < Array_Elems(connection_pool); i++)
+	{
+		e = &connection_pool[i];
+		if (e->inUse) continue;
+
+		if (!e->conn.valid) return ConnectionPool_Insert(i, url);
+		if (oldest == -1 || e->lastUsed < connection_pool[oldest].lastUsed) oldest = i;
 	}
 
-	/* TODO: Should we be consistent in which entry gets evicted? */
-	i = (cc_uint8)Stopwatch_Measure() % Array_Elems(connection_pool);
-	HttpConnection_Close(&connection_pool[i].conn);
-	return ConnectionPool_Insert(i, conn, url);
+	/* Evict the least recently used connection */
+	/* NOTE: There are more pool entries than worker threads, so an entry is always available */
+	HttpConnection_Close(&connection_pool[oldest].conn);
+	return ConnectionPool_Insert(oldest, url);
+}
+
+static cc_result ConnectionPool_Open(struct HttpConnection** conn, const struct HttpUrl* url) {
+	struct ConnectionPoolEntry* e;
+
+	Mutex_Lock(poolMutex);
+	{
+		e = ConnectionPool_Find(url);
+		e->inUse = true;
+	}
+	Mutex_Unlock(poolMutex);
+
+	*conn = &e->conn;
+	if (e->conn.valid) return 0;
+	/* Connect outside the lock, so other workers aren't blocked while this one connects */
+	return HttpConnection_Open(&e->conn, url);
+}
+
+/* Makes the connection available to be reused by other requests */
+static void ConnectionPool_Release(struct HttpConnection* conn) {
+	int i;
+
+	Mutex_Lock(poolMutex);
+	for (i = 0; i < Array_Elems(connection_pool); i++)
+	{
+		if (&connection_pool[i].conn == conn) connection_pool[i].inUse = false;
+	}
+	Mutex_Unlock(poolMutex);
 }
 
 
@@ -626,7 +750,7 @@ static void HttpClient_Serialise(struct HttpClientState* state) {
 					verbs[req->requestType], &state->url.resource);
 
 	Http_AddHeader(req, "Host",       &state->url.address);
-	Http_AddHeader(req, "User-Agent", Http_GetUserAgent_UNSAFE());
+	Http_AddUserAgent(req);
 	if (req->data) String_Format1(buffer, "Content-Length: %i\r\n", &req->size);
 
 	Http_SetRequestHeaders(req);
@@ -714,6 +838,10 @@ static int HttpClient_GetChunkLength(const cc_string* line) {
 }
 
 /* https://httpwg.org/specs/rfc7230.html */
+#define INPUT_BUFFER_LEN 8192
+/* When streaming, the buffered data is written to the sink after every read */
+#define HttpClient_DataSpace(req, left) (Http_IsStreaming(req) ? min(left, INPUT_BUFFER_LEN) : (left))
+
 static cc_result HttpClient_Process(struct HttpClientState* state, char* buffer, int total) {
 	struct HttpRequest* req = state->req;
 	cc_uint32 left, avail, read;
@@ -747,7 +875,7 @@ static cc_result HttpClient_Process(struct HttpClientState* state, char* buffer,
 					/* The rest of the request body is just content/data */
 					if (state->state == HTTP_RESPONSE_STATE_DATA) {
 						state->dataLeft = req->contentLength;
-						ok = Http_BufferExpand(req, state->dataLeft);
+						ok = Http_BufferExpand(req, HttpClient_DataSpace(req, state->dataLeft));
 						if (!ok) return ERR_OUT_OF_MEMORY;
 					}
 					break;
@@ -798,7 +926,7 @@ static cc_result HttpClient_Process(struct HttpClientState* state, char* buffer,
 					state->state = HTTP_RESPONSE_STATE_DATA;
 
 					state->dataLeft = chunkLen;
-					ok = Http_BufferExpand(req, state->dataLeft);
+					ok = Http_BufferExpand(req, HttpClient_DataSpace(req, state->dataLeft));
 					if (!ok) return ERR_OUT_OF_MEMORY;
 				}
 				break;
@@ -845,7 +973,6 @@ static cc_result HttpClient_Process(struct HttpClientState* state, char* buffer,
 	return 0;
 }
 
-#define INPUT_BUFFER_LEN 8192
 static cc_result HttpClient_ParseResponse(struct HttpClientState* state) {
 	struct HttpRequest* req = state->req;
 	cc_uint8 buffer[INPUT_BUFFER_LEN];
@@ -898,6 +1025,7 @@ static cc_result HttpClient_HandleRedirect(struct HttpClientState* state) {
 *-----------------------------------------------Http backend implementation-----------------------------------------------*
 *#########################################################################################################################*/
 static void HttpBackend_Init(void) {
+	poolMutex = Mutex_Create("HTTP pool");
 	SSLBackend_Init(httpsVerify);
 	//httpOnly = true; // TODO: insecure
 }
@@ -910,14 +1038,12 @@ static cc_result HttpBackend_PerformRequest(struct HttpClientState* state) {
 	cc_result res;
 
 	res = ConnectionPool_Open(&state->conn, &state->url);
-	if (res) { HttpConnection_Close(state->conn); return res; }
-
-	res = HttpClient_SendRequest(state);
-	if (res) { HttpConnection_Close(state->conn); return res; }
-
-	res = HttpClient_ParseResponse(state);
-	if (res) HttpConnection_Close(state->conn);
+	if (!res) res = HttpClient_SendRequest(state);
+	if (!res) res = HttpClient_ParseResponse(state);
 
+	/* Server won't accept any more requests over this connection */
+	if (res || state->autoClose) HttpConnection_Close(state->conn);
+	ConnectionPool_Release(state->conn);
 	return res;
 }
 
@@ -1074,7 +1200,7 @@ static cc_result HttpBackend_Do(struct HttpRequest* req, cc_string* url) {
 	java_req = req;
 
 	Http_SetRequestHeaders(req);
-	Http_AddHeader(req, "User-Agent", Http_GetUserAgent_UNSAFE());
+	Http_AddUserAgent(req);
 	
 	if (req->data) {
 		if (res = Http_SetData(env, req)) return res;
@@ -1162,7 +1288,7 @@ static cc_result HttpBackend_Do(struct HttpRequest* req, cc_string* url) {
     request = CFHTTPMessageCreateRequest(NULL, verbs[req->requestType], urlRef, kCFHTTPVersion1_1);
     req->meta = request;
     Http_SetRequestHeaders(req);
-    Http_AddHeader(req, "User-Agent", Http_GetUserAgent_UNSAFE());
+    Http_AddUserAgent(req);
     CFRelease(urlRef);
     
     if (req->data) {
@@ -1224,13 +1350,17 @@ static cc_result HttpBackend_Do(struct HttpRequest* req, cc_string* url) {
 
 
 static void* workerWaitable;
-static void* workerThread;
+static void* workerThreads[HTTP_MAX_WORKERS];
+static int workersStarted;
 
 static void* pendingMutex;
 static struct RequestList pendingReqs;
 
-static void* curRequestMutex;
-static struct HttpRequest http_curRequest;
+/* Request currently being processed by each worker thread */
+static struct HttpRequest http_curRequests[HTTP_MAX_WORKERS];
+/* ID of the request currently being processed by each worker thread, 0 if none */
+/* NOTE: Read without locking, as the progress of a request is only informational anyways */
+static volatile int http_curIDs[HTTP_MAX_WORKERS];
 
 
 /*########################################################################################################################*
@@ -1238,37 +1368,48 @@ static struct HttpRequest http_curRequest;
 *#########################################################################################################################*/
 cc_bool Http_GetResult(int reqID, struct HttpRequest* item) {
 	int i;
+	/* Requests are usually polled every frame until they finish, so avoid locking in that case */
+	if (!Http_MaybeProcessed(reqID)) return false;
+
 	Mutex_Lock(processedMutex);
 	{
 		i = RequestList_Find(&processedReqs, reqID);
 		if (i >= 0) HttpRequest_Copy(item, &processedReqs.entries[i]);
-		if (i >= 0) RequestList_RemoveAt(&processedReqs, i);
+		if (i >= 0) Http_RemoveProcessed(i);
 	}
 	Mutex_Unlock(processedMutex);
 	return i >= 0;
 }
 
 cc_bool Http_GetCurrent(int* reqID, int* progress) {
-	Mutex_Lock(curRequestMutex);
+	int i, id;
+	*reqID    = 0;
+	*progress = HTTP_PROGRESS_NOT_WORKING_ON;
+
+	for (i = 0; i < HTTP_MAX_WORKERS; i++)
 	{
-		*reqID    = http_curRequest.id;
-		*progress = http_curRequest.progress;
+		if (!(id = http_curIDs[i])) continue;
+
+		*reqID    = id;
+		*progress = http_curRequests[i].progress;
+		break;
 	}
-	Mutex_Unlock(curRequestMutex);
 	return *reqID != 0;
 }
 
 int Http_CheckProgress(int reqID) {
-	int curReqID, progress;
-	Http_GetCurrent(&curReqID, &progress);
-
-	if (reqID != curReqID) progress = HTTP_PROGRESS_NOT_WORKING_ON;
-	return progress;
+	int i;
+	for (i = 0; i < HTTP_MAX_WORKERS; i++)
+	{
+		if (http_curIDs[i] == reqID) return http_curRequests[i].progress;
+	}
+	return HTTP_PROGRESS_NOT_WORKING_ON;
 }
 
 void Http_ClearPending(void) {
 	Mutex_Lock(pendingMutex);
 	{
+		Http_CloseAllSinks(pendingReqs.entries, pendingReqs.count);
 		RequestList_Free(&pendingReqs);
 	}
 	Mutex_Unlock(pendingMutex);
@@ -1283,7 +1424,7 @@ void Http_TryCancel(int reqID) {
 
 	Mutex_Lock(processedMutex);
 	{
-		RequestList_TryFree(&processedReqs, reqID);
+		Http_TryFreeProcessed(reqID);
 	}
 	Mutex_Unlock(processedMutex);
 }
@@ -1293,18 +1434,15 @@ void Http_TryCancel(int reqID) {
 *-----------------------------------------------------Http worker---------------------------------------------------------*
 *#########################################################################################################################*/
 /* Sets up state to begin a http request */
-static void PrepareCurrentRequest(struct HttpRequest* req, cc_string* url) {
+static void PrepareCurrentRequest(struct HttpRequest* cur, struct HttpRequest* req, cc_string* url) {
 	static const char* verbs[] = { "GET", "HEAD", "POST" };
 	Http_GetUrl(req, url);
 	Platform_Log2("Fetching %s (%c)", url, verbs[req->requestType]);
 	/* TODO change to verbs etc */
 
-	Mutex_Lock(curRequestMutex);
-	{
-		HttpRequest_Copy(&http_curRequest, req);
-		http_curRequest.progress = HTTP_PROGRESS_MAKING_REQUEST;
-	}
-	Mutex_Unlock(curRequestMutex);
+	HttpRequest_Copy(cur, req);
+	cur->progress = HTTP_PROGRESS_MAKING_REQUEST;
+	http_curIDs[cur - http_curRequests] = req->id;
 }
 
 static void PerformRequest(struct HttpRequest* req, cc_string* url) {
@@ -1322,27 +1460,31 @@ static void PerformRequest(struct HttpRequest* req, cc_string* url) {
 	Http_FinishRequest(req);
 }
 
-static void ClearCurrentRequest(void) {
-	Mutex_Lock(curRequestMutex);
-	{
-		http_curRequest.id       = 0;
-		http_curRequest.progress = HTTP_PROGRESS_NOT_WORKING_ON;
-	}
-	Mutex_Unlock(curRequestMutex);
+static void ClearCurrentRequest(struct HttpRequest* cur) {
+	http_curIDs[cur - http_curRequests] = 0;
+	cur->id       = 0;
+	cur->progress = HTTP_PROGRESS_NOT_WORKING_ON;
 }
 
-static void DoRequest(struct HttpRequest* request) {
+static void DoRequest(struct HttpRequest* cur, struct HttpRequest* request) {
 	char urlBuffer[URL_MAX_SIZE]; cc_string url;
 
 	String_InitArray(url, urlBuffer);
-	PrepareCurrentRequest(request, &url);
-	PerformRequest(&http_curRequest, &url);
-	ClearCurrentRequest();
+	PrepareCurrentRequest(cur, request, &url);
+	PerformRequest(cur, &url);
+	ClearCurrentRequest(cur);
 }
 
 static void WorkerLoop(void) {
 	struct HttpRequest request;
-	cc_bool hasRequest;
+	struct HttpRequest* cur;
+	cc_bool hasRequest, hasMore;
+
+	Mutex_Lock(pendingMutex);
+	{
+		cur = &http_curRequests[workersStarted++];
+	}
+	Mutex_Unlock(pendingMutex);
 
 	for (;;) {
 		hasRequest = false;
@@ -1354,11 +1496,17 @@ static void WorkerLoop(void) {
 				hasRequest = true;
 				RequestList_RemoveAt(&pendingReqs, 0);
 			}
+			hasMore = pendingReqs.count > 0;
 		}
 		Mutex_Unlock(pendingMutex);
 
+		/* Signals only wake up one worker, so pass it on for the remaining requests */
+		if (hasMore) Waitable_Signal(workerWaitable);
+
 		if (hasRequest) {
-			DoRequest(&request);
+			Tracer_Begin("Http_DoRequest");
+			DoRequest(cur, &request);
+			Tracer_End();
 		} else {
 			/* Block until another thread submits a request to do */
 			Platform_LogConst("Download queue empty, going back to sleep...");
@@ -1371,11 +1519,11 @@ static void WorkerLoop(void) {
 static void HttpBackend_Add(struct HttpRequest* req, cc_uint8 flags) {
 #if defined CC_BUILD_PSP || defined CC_BUILD_NDS
 	/* TODO why doesn't threading work properly on PSP */
-	DoRequest(req);
+	DoRequest(&http_curRequests[0], req);
 #else
 	Mutex_Lock(pendingMutex);
 	{
-		RequestList_Append(&pendingReqs, req, flags);
+		RequestList_Append(&pendingReqs, req);
 	}
 	Mutex_Unlock(pendingMutex);
 	Waitable_Signal(workerWaitable);
@@ -1386,10 +1534,14 @@ static void HttpBackend_Add(struct HttpRequest* req, cc_uint8 flags) {
 *-----------------------------------------------------Http component------------------------------------------------------*
 *#########################################################################################################################*/
 static void Http_Init(void) {
+	int i, numWorkers;
 	Http_InitCommon();
-	http_curRequest.progress = HTTP_PROGRESS_NOT_WORKING_ON;
+	for (i = 0; i < HTTP_MAX_WORKERS; i++)
+	{
+		http_curRequests[i].progress = HTTP_PROGRESS_NOT_WORKING_ON;
+	}
 	/* Http component gets initialised multiple times on Android */
-	if (workerThread) return;
+	if (workerThreads[0]) return;
 
 	HttpBackend_Init();
 	RequestList_Init(&pendingReqs);
@@ -1398,8 +1550,12 @@ static void Http_Init(void) {
 	workerWaitable  = Waitable_Create("HTTP wakeup");
 	pendingMutex    = Mutex_Create("HTTP pending");
 	processedMutex  = Mutex_Create("HTTP processed");
-	curRequestMutex = Mutex_Create("HTTP current");
-	
-	Thread_Run(&workerThread, WorkerLoop, 128 * 1024, "HTTP");
+	cookiesMutex    = Mutex_Create("HTTP cookies");
+
+	numWorkers = Options_GetInt(OPT_HTTP_WORKERS, 1, HTTP_MAX_WORKERS, HTTP_DEF_WORKERS);
+	for (i = 0; i < numWorkers; i++)
+	{
+		Thread_Run(&workerThreads[i], WorkerLoop, 128 * 1024, "HTTP");
+	}
 }
 #endif
@@ -11,6 +11,8 @@
 static struct VertexTextured* iso_vertices;
 static struct VertexTextured* iso_vertices_base;
 static int* iso_state;
+static int* iso_state_base;
+static int iso_overlayBeg;
 
 static cc_bool iso_cacheInited;
 static PackedCol iso_colorXSide, iso_colorZSide, iso_colorYBottom;
@@ -123,6 +125,12 @@ void IsometricDrawer_BeginBatch(struct VertexTextured* vertices, int* state) {
 	iso_vertices      = vertices;
 	iso_vertices_base = vertices;
 	iso_state         = state; /* TODO just store TextureLoc ??? */
+	iso_state_base    = state;
+	iso_overlayBeg    = -1;
+}
+
+void IsometricDrawer_BeginOverlay(void) {
+	iso_overlayBeg = (int)(iso_state - iso_state_base);
 }
 
 void IsometricDrawer_AddBatch(BlockID block, float size, float x, float y) {
@@ -142,7 +150,37 @@ void IsometricDrawer_AddBatch(BlockID block, float size, float x, float y) {
 	}
 }
 
+/* Sorts quads by the 1D atlas they use, so that IsometricDrawer_Render needs to switch textures less often */
+/* NOTE: Relative order of quads using the same atlas is preserved */
+static void IsometricDrawer_SortQuads(int count) {
+	struct VertexTextured quad[4];
+	int i, j, k, key;
+
+	for (i = 1; i < count; i++)
+	{
+		key = iso_state_base[i];
+		for (j = i; j > 0 && iso_state_base[j - 1] > key; j--) { }
+		if (j == i) continue;
+
+		for (k = 0; k < 4; k++) quad[k] = iso_vertices_base[i * 4 + k];
+		for (k = i; k > j; k--) 
+		{
+			iso_state_base[k] = iso_state_base[k - 1];
+			iso_vertices_base[k * 4 + 0] = iso_vertices_base[k * 4 - 4];
+			iso_vertices_base[k * 4 + 1] = iso_vertices_base[k * 4 - 3];
+			iso_vertices_base[k * 4 + 2] = iso_vertices_base[k * 4 - 2];
+			iso_vertices_base[k * 4 + 3] = iso_vertices_base[k * 4 - 1];
+		}
+
+		iso_state_base[j] = key;
+		for (k = 0; k < 4; k++) iso_vertices_base[j * 4 + k] = quad[k];
+	}
+}
+
 int IsometricDrawer_EndBatch(void) {
+	int count = (int)(iso_state - iso_state_base);
+	/* Blocks in the overlay must stay on top of all other blocks */
+	IsometricDrawer_SortQuads(iso_overlayBeg >= 0 ? iso_overlayBeg : count);
 	return (int)(iso_vertices - iso_vertices_base);
 }
 
@@ -15,6 +15,9 @@ struct VertexTextured;
 void IsometricDrawer_BeginBatch(struct VertexTextured* vertices, int* state);
 /* Buffers the vertices needed to draw the given block at the given position */
 void IsometricDrawer_AddBatch(BlockID block, float size, float x, float y);
+/* Marks that blocks buffered after this are drawn on top of the blocks buffered before */
+/* NOTE: Blocks must otherwise not overlap, as EndBatch reorders them to reduce texture switches */
+void IsometricDrawer_BeginOverlay(void);
 /* Returns the number of buffered vertices */
 int  IsometricDrawer_EndBatch(void);
 /* Draws the buffered vertices */
@@ -31,9 +31,16 @@
 struct FontDesc titleFont, textFont, hintFont, logoFont, rowFont;
 /* Contains the pixels that are drawn to the window */
 static struct Context2D framebuffer;
-/* The area/region of the window that needs to be redrawn and presented to the screen. */
-/* If width is 0, means no area needs to be redrawn. */
-static Rect2D dirty_rect;
+/* Window backends that can cheaply present several separate areas of the framebuffer each frame */
+#if CC_WIN_BACKEND == CC_WIN_BACKEND_X11 || CC_WIN_BACKEND == CC_WIN_BACKEND_WIN32 || CC_WIN_BACKEND == CC_WIN_BACKEND_SDL2 || CC_WIN_BACKEND == CC_WIN_BACKEND_SDL3
+	#define MAX_DIRTY_RECTS 8
+#else
+	#define MAX_DIRTY_RECTS 1
+#endif
+/* The areas/regions of the window that need to be redrawn and presented to the screen. */
+/* Areas are merged together whenever doing so wouldn't present noticeably more pixels. */
+static Rect2D dirty_rects[MAX_DIRTY_RECTS];
+static int dirty_count;
 static int pendingFullDraws;
 
 LBackend_DrawHook LBackend_Hooks[4];
@@ -188,28 +195,55 @@ void LBackend_NeedsRedraw(void* widget) {
 }
 
 void LBackend_MarkAllDirty(void) {
-	dirty_rect.x = 0; dirty_rect.width  = framebuffer.width;
-	dirty_rect.y = 0; dirty_rect.height = framebuffer.height;
+	dirty_rects[0].x = 0; dirty_rects[0].width  = framebuffer.width;
+	dirty_rects[0].y = 0; dirty_rects[0].height = framebuffer.height;
+	dirty_count = 1;
 }
 
-void LBackend_MarkAreaDirty(int x, int y, int width, int height) {
-	int x1, y1, x2, y2;
-	if (!Drawer2D_Clamp(&framebuffer, &x, &y, &width, &height)) return;
+#define Rect_Area(r) ((r).width * (r).height)
+static void Rect_Union(Rect2D* dst, const Rect2D* a, const Rect2D* b) {
+	int x1 = min(a->x, b->x), x2 = max(a->x + a->width,  b->x + b->width);
+	int y1 = min(a->y, b->y), y2 = max(a->y + a->height, b->y + b->height);
 
-	/* union with existing dirty area */
-	if (dirty_rect.width) {
-		x1 = min(x, dirty_rect.x);
-		y1 = min(y, dirty_rect.y);
+	dst->x = x1; dst->width  = x2 - x1;
+	dst->y = y1; dst->height = y2 - y1;
+}
 
-		x2 = max(x +  width, dirty_rect.x + dirty_rect.width);
-		y2 = max(y + height, dirty_rect.y + dirty_rect.height);
+static void RemoveDirtyRect(int i) {
+	dirty_rects[i] = dirty_rects[--dirty_count];
+}
 
-		x = x1; width  = x2 - x1;
-		y = y1; height = y2 - y1;
-	}
+void LBackend_MarkAreaDirty(int x, int y, int width, int height) {
+	Rect2D r, u;
+	int i, best, cost, bestCost;
+	if (!Drawer2D_Clamp(&framebuffer, &x, &y, &width, &height)) return;
+	r.x = x; r.width  = width;
+	r.y = y; r.height = height;
+
+	for (;;) {
+		/* Merge with areas when doing so doesn't present more pixels than keeping them separate */
+		/* (merged area might then overlap other areas, so have to check all areas again) */
+		for (i = 0; i < dirty_count; ) {
+			Rect_Union(&u, &r, &dirty_rects[i]);
+
+			if (Rect_Area(u) <= Rect_Area(r) + Rect_Area(dirty_rects[i])) {
+				r = u; RemoveDirtyRect(i); i = 0;
+			} else { i++; }
+		}
+		if (dirty_count < MAX_DIRTY_RECTS) break;
+
+		/* Out of free areas, so union with whichever area grows the least */
+		best = 0; bestCost = Int32_MaxValue;
+		for (i = 0; i < dirty_count; i++) {
+			Rect_Union(&u, &r, &dirty_rects[i]);
+			cost = Rect_Area(u) - Rect_Area(dirty_rects[i]);
+			if (cost < bestCost) { best = i; bestCost = cost; }
+		}
 
-	dirty_rect.x = x; dirty_rect.width  = width;
-	dirty_rect.y = y; dirty_rect.height = height;
+		Rect_Union(&r, &r, &dirty_rects[best]);
+		RemoveDirtyRect(best);
+	}
+	dirty_rects[dirty_count++] = r;
 }
 
 void LBackend_InitFramebuffer(void) {
@@ -313,16 +347,18 @@ void LBackend_Tick(void) {
 		pendingFullDraws--;
 		LBackend_MarkAllDirty();
 	}
-	if (!dirty_rect.width) return;
+	if (!dirty_count) return;
 
 	for (i = 0; i < Array_Elems(LBackend_Hooks); i++)
 	{
 		if (LBackend_Hooks[i]) LBackend_Hooks[i](&framebuffer);
 	}
-	Window_DrawFramebuffer(dirty_rect, &framebuffer.bmp);
-
-	dirty_rect.x = 0; dirty_rect.width   = 0;
-	dirty_rect.y = 0; dirty_rect.height  = 0;
+	
+	for (i = 0; i < dirty_count; i++) 
+	{
+		Window_DrawFramebuffer(dirty_rects[i], &framebuffer.bmp);
+	}
+	dirty_count = 0;
 }
 
 void LBackend_AddDirtyFrames(int frames) {
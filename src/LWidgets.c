@@ -677,6 +677,8 @@ void LTable_Add(void* screen, struct LTable* w,
 	w->sortingCol = -1;
 	w->opaque     = true;
 	w->layouts    = layouts;
+	w->_lastFilterServers = -1;
+	String_InitArray(w->_lastFilter, w->_lastFilterBuffer);
 	
 	for (i = 0; i < w->numColumns; i++) {
 		w->columns[i].width = Display_ScaleX(w->columns[i].width);
@@ -693,6 +695,7 @@ void LTable_Reset(struct LTable* w) {
 	w->rowsCount  = 0;
 	w->_wheelAcc  = 0.0f;
 	w->sortingCol = -1;
+	w->_lastFilterServers = -1;
 }
 
 static int ShouldShowServer(struct LTable* w, struct ServerInfo* server) {
@@ -700,16 +703,40 @@ static int ShouldShowServer(struct LTable* w, struct ServerInfo* server) {
 		&& (Launcher_ShowEmptyServers || server->players > 0);
 }
 
-void LTable_ApplyFilter(struct LTable* w) {
-	int i, j, count;
+/* Whether the rows currently shown are a superset of the rows the current filter would show */
+/* (e.g. when the user just typed another character onto the end of the search text) */
+static cc_bool LTable_CanNarrowFilter(struct LTable* w) {
+	return w->_lastFilterServers == FetchServersTask.numServers 
+		&& w->_lastFilterEmpty   == Launcher_ShowEmptyServers
+		&& String_CaselessContains(w->filter, &w->_lastFilter);
+}
 
+void LTable_ApplyFilter(struct LTable* w) {
+	int i, j, order, count;
 	count = FetchServersTask.numServers;
-	for (i = 0, j = 0; i < count; i++) {
-		if (ShouldShowServer(w, Servers_Get(i))) {
-			FetchServersTask.servers[j++]._order = FetchServersTask.orders[i];
+
+	if (LTable_CanNarrowFilter(w)) {
+		/* Only need to recheck the shown rows, which are already in sorted order */
+		for (i = 0, j = 0; i < w->rowsCount; i++) {
+			order = FetchServersTask.servers[i]._order;
+
+			if (ShouldShowServer(w, &FetchServersTask.servers[order])) {
+				FetchServersTask.servers[j++]._order = order;
+			}
+		}
+	} else {
+		for (i = 0, j = 0; i < count; i++) {
+			if (ShouldShowServer(w, Servers_Get(i))) {
+				FetchServersTask.servers[j++]._order = FetchServersTask.orders[i];
+			}
 		}
 	}
 
+	String_Copy(&w->_lastFilter, w->filter);
+	/* Truncated filter can't be used to narrow down later */
+	w->_lastFilterServers = w->filter->length <= w->_lastFilter.capacity ? count : -1;
+	w->_lastFilterEmpty   = Launcher_ShowEmptyServers;
+
 	w->rowsCount = j;
 	for (; j < count; j++) {
 		FetchServersTask.servers[j]._order = -100000;
@@ -754,6 +781,7 @@ static void LTable_QuickSort(int left, int right) {
 void LTable_Sort(struct LTable* w) {
 	sortingCol = w->sortingCol;
 	FetchServersTask_ResetOrder();
+	w->_lastFilterServers = -1;
 
 	if (FetchServersTask.numServers)
 		LTable_QuickSort(0, FetchServersTask.numServers - 1);
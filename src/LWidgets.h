@@ -218,6 +218,13 @@ struct LTable {
 	int _lastRow;    /* last clicked row (for doubleclick join) */
 	cc_uint64 _lastClick; /* timestamp of last mouse click on a row */
 	int sortingCol;
+
+	/* Filter and server state the currently shown rows were last filtered with */
+	/* (lets ApplyFilter narrow down the shown rows, instead of rechecking every server) */
+	cc_string _lastFilter;
+	char _lastFilterBuffer[STRING_SIZE];
+	int _lastFilterServers; /* -1 when shown rows must be recalculated from scratch */
+	cc_bool _lastFilterEmpty;
 };
 
 struct LTableCell { struct LTable* table; int x, y, width; };
@@ -423,12 +423,6 @@ static void ExtractTerrainTiles(struct Bitmap* bmp) {
 	TintBitmap(&stoneBmp, 96, 96, TILESIZE, TILESIZE);
 }
 
-static cc_bool Launcher_SelectZipEntry(const cc_string* path) {
-	return
-		String_CaselessEqualsConst(path, "default.png") ||
-		String_CaselessEqualsConst(path, "terrain.png");
-}
-
 static cc_result Launcher_ProcessZipEntry(const cc_string* path, struct Stream* data, struct ZipEntry* source) {
 	struct Bitmap bmp;
 	cc_result res;
@@ -460,8 +454,16 @@ static cc_result Launcher_ProcessZipEntry(const cc_string* path, struct Stream*
 	return 0;
 }
 
+static cc_result ExtractTexturePackEntry(struct ZipIndex* index, const char* name) {
+	cc_string path = String_FromReadonly(name);
+	int i = ZipIndex_Find(index, &path);
+
+	if (i == -1) return 0;
+	return ZipIndex_Extract(index, i, Launcher_ProcessZipEntry);
+}
+
 static cc_result ExtractTexturePack(const cc_string* path) {
-	struct ZipEntry entries[32];
+	struct ZipIndex index;
 	struct Stream stream;
 	cc_result res;
 
@@ -469,10 +471,13 @@ static cc_result ExtractTexturePack(const cc_string* path) {
 	if (res == ReturnCode_FileNotFound) return res;
 	if (res) { Logger_SysWarn(res, "opening texture pack"); return res; }
 
-	res = Zip_Extract(&stream, 
-			Launcher_SelectZipEntry, Launcher_ProcessZipEntry,
-			entries, Array_Elems(entries));
+	/* Only default.png and terrain.png are needed, so avoid reading through every other entry */
+	res = ZipIndex_Open(&index, &stream);
+	if (!res) res = ExtractTexturePackEntry(&index, "default.png");
+	if (!res) res = ExtractTexturePackEntry(&index, "terrain.png");
+
 	if (res) { Logger_SysWarn(res, "extracting texture pack"); }
+	ZipIndex_Free(&index);
 	/* No point logging error for closing readonly file */
 	(void)stream.Close(&stream);
 	return res;
@@ -1,4 +1,13 @@
 #include "Lighting.h"
+/* Paletted worlds have no flat block arrays to check with SIMD */
+#if defined CC_BUILD_PALETTEWORLD
+#elif defined CC_BUILD_SSE2
+	#include <emmintrin.h>
+	#define HEIGHTMAP_SSE2
+#elif defined CC_BUILD_NEON
+	#include <arm_neon.h>
+	#define HEIGHTMAP_NEON
+#endif
 #include "Block.h"
 #include "Funcs.h"
 #include "MapRenderer.h"
@@ -20,8 +29,29 @@ cc_bool  Lighting_ModeLockedByServer;
 cc_bool  Lighting_ModeSetByServer;
 cc_uint8 Lighting_ModeUserCached;
 struct _Lighting Lighting;
+struct _LightingMeshCols Lighting_MeshCols;
 #define Lighting_Pack(x, z) ((x) + World.Width * (z))
 
+int Lighting_BatchDepth;
+
+/* Alpha of chunk vertex colours tells Gfx_SetChunkLightColors whether a vertex is in sun or shadow */
+#define MESHCOL_SUN    PackedCol_Make(255, 255, 255, 127)
+#define MESHCOL_SHADOW PackedCol_Make(255, 255, 255,   0)
+
+void Lighting_UpdateMeshCols(cc_bool gpuLight) {
+	struct _LightingMeshCols* c = &Lighting_MeshCols;
+
+	if (gpuLight) {
+		c->Sun    = MESHCOL_SUN;
+		c->Shadow = MESHCOL_SHADOW;
+		PackedCol_GetShaded(c->Sun,    &c->SunXSide,    &c->SunZSide,    &c->SunYMin);
+		PackedCol_GetShaded(c->Shadow, &c->ShadowXSide, &c->ShadowZSide, &c->ShadowYMin);
+	} else {
+		c->Sun    = Env.SunCol;    c->SunXSide    = Env.SunXSide;    c->SunZSide    = Env.SunZSide;    c->SunYMin    = Env.SunYMin;
+		c->Shadow = Env.ShadowCol; c->ShadowXSide = Env.ShadowXSide; c->ShadowZSide = Env.ShadowZSide; c->ShadowYMin = Env.ShadowYMin;
+	}
+}
+
 void Lighting_SetMode(cc_uint8 mode, cc_bool fromServer) {
 	cc_uint8 oldMode = Lighting_Mode;
 	Lighting_Mode    = mode;
@@ -52,7 +82,9 @@ static int ClassicLighting_CalcHeightAt(int x, int maxY, int z, int hIndex) {
 	BlockID block;
 	int y, offset;
 
-#ifndef EXTENDED_BLOCKS
+#if defined CC_BUILD_PALETTEWORLD
+	ClassicLighting_CalcBody(World_GetRawBlock(i));
+#elif !defined EXTENDED_BLOCKS
 	ClassicLighting_CalcBody(World.Blocks[i]);
 #else
 	if (World.IDMask <= 0xFF) {
@@ -98,23 +130,23 @@ static PackedCol ClassicLighting_Color_XSide(int x, int y, int z) {
 }
 
 static PackedCol ClassicLighting_Color_Sprite_Fast(int x, int y, int z) {
-	return y > classic_heightmap[Lighting_Pack(x, z)] ? Env.SunCol : Env.ShadowCol;
+	return y > classic_heightmap[Lighting_Pack(x, z)] ? Lighting_MeshCols.Sun : Lighting_MeshCols.Shadow;
 }
 
 static PackedCol ClassicLighting_Color_YMax_Fast(int x, int y, int z) {
-	return y > classic_heightmap[Lighting_Pack(x, z)] ? Env.SunCol : Env.ShadowCol;
+	return y > classic_heightmap[Lighting_Pack(x, z)] ? Lighting_MeshCols.Sun : Lighting_MeshCols.Shadow;
 }
 
 static PackedCol ClassicLighting_Color_YMin_Fast(int x, int y, int z) {
-	return y > classic_heightmap[Lighting_Pack(x, z)] ? Env.SunYMin : Env.ShadowYMin;
+	return y > classic_heightmap[Lighting_Pack(x, z)] ? Lighting_MeshCols.SunYMin : Lighting_MeshCols.ShadowYMin;
 }
 
 static PackedCol ClassicLighting_Color_XSide_Fast(int x, int y, int z) {
-	return y > classic_heightmap[Lighting_Pack(x, z)] ? Env.SunXSide : Env.ShadowXSide;
+	return y > classic_heightmap[Lighting_Pack(x, z)] ? Lighting_MeshCols.SunXSide : Lighting_MeshCols.ShadowXSide;
 }
 
 static PackedCol ClassicLighting_Color_ZSide_Fast(int x, int y, int z) {
-	return y > classic_heightmap[Lighting_Pack(x, z)] ? Env.SunZSide : Env.ShadowZSide;
+	return y > classic_heightmap[Lighting_Pack(x, z)] ? Lighting_MeshCols.SunZSide : Lighting_MeshCols.ShadowZSide;
 }
 
 void ClassicLighting_Refresh(void) {
@@ -179,7 +211,9 @@ static cc_bool ClassicLighting_NeedsNeighour(BlockID block, int i, int minY, int
 	BlockID other;
 	cc_bool affected;
 
-#ifndef EXTENDED_BLOCKS
+#if defined CC_BUILD_PALETTEWORLD
+	ClassicLighting_NeedsNeighourBody(World_GetRawBlock(i));
+#elif !defined EXTENDED_BLOCKS
 	ClassicLighting_NeedsNeighourBody(World.Blocks[i]);
 #else
 	if (World.IDMask <= 0xFF) {
@@ -255,6 +289,7 @@ static void ClassicLighting_RefreshAffected(int x, int y, int z, BlockID block,
 	}
 }
 
+static cc_bool ClassicLighting_QueueColumn(int hIndex, int lightH);
 void ClassicLighting_OnBlockChanged(int x, int y, int z, BlockID oldBlock, BlockID newBlock) {
 	int hIndex = Lighting_Pack(x, z);
 	int lightH = classic_heightmap[hIndex];
@@ -263,136 +298,203 @@ void ClassicLighting_OnBlockChanged(int x, int y, int z, BlockID oldBlock, Block
 	/* Since light wasn't checked to begin with, means column never had meshes for any of its chunks built. */
 	/* So we don't need to do anything. */
 	if (lightH == HEIGHT_UNCALCULATED) return;
+	if (Lighting_BatchDepth && ClassicLighting_QueueColumn(hIndex, lightH)) return;
 
 	ClassicLighting_UpdateLighting(x, y, z, oldBlock, newBlock, hIndex, lightH);
 	newHeight = classic_heightmap[hIndex] + 1;
+
+	/* Shadows in the column are unchanged, so only chunks whose faces change visibility */
+	/*  need rebuilding - which MapRenderer_OnBlockChanged works out by itself */
+	if (newHeight == lightH + 1) return;
 	ClassicLighting_RefreshAffected(x, y, z, newBlock, lightH + 1, newHeight);
 }
 
 
 /*########################################################################################################################*
-*---------------------------------------------------Lighting heightmap----------------------------------------------------*
+*----------------------------------------------------Lighting batching----------------------------------------------------*
 *#########################################################################################################################*/
-static int Heightmap_InitialCoverage(int x1, int z1, int xCount, int zCount, int* skip) {
-	int elemsLeft = 0, index = 0, curRunCount = 0;
-	int x, z, hIndex, lightH;
-
-	for (z = 0; z < zCount; z++) {
-		hIndex = Lighting_Pack(x1, z1 + z);
-		for (x = 0; x < xCount; x++) {
-			lightH = classic_heightmap[hIndex++];
-
-			skip[index] = 0;
-			if (lightH == HEIGHT_UNCALCULATED) {
-				elemsLeft++;
-				curRunCount = 0;
-			} else {
-				skip[index - curRunCount]++;
-				curRunCount++;
-			}
-			index++;
-		}
-		curRunCount = 0; /* We can only skip an entire X row at most. */
+/* A heightmap column that needs to be recalculated once the current batch ends */
+struct LightingColumn { int index, oldHeight; };
+static struct LightingColumn* batch_columns;
+static int batch_count, batch_capacity;
+/* Bit per heightmap column, set when the column is already in batch_columns */
+static cc_uint8* batch_queued;
+
+static cc_bool ClassicLighting_QueueColumn(int hIndex, int lightH) {
+	if (!batch_queued) {
+		batch_queued = (cc_uint8*)Mem_TryAllocCleared((World.Width * World.Length + 7) >> 3, 1);
+		if (!batch_queued) return false;
+	}
+	if (batch_queued[hIndex >> 3] & (1 << (hIndex & 7))) return true;
+
+	if (batch_count == batch_capacity) {
+		batch_capacity = max(batch_capacity * 2, 64);
+		batch_columns  = (struct LightingColumn*)Mem_Realloc(batch_columns, batch_capacity, 
+												sizeof(struct LightingColumn), "lighting columns");
 	}
-	return elemsLeft;
+
+	batch_queued[hIndex >> 3] |= 1 << (hIndex & 7);
+	batch_columns[batch_count].index     = hIndex;
+	batch_columns[batch_count].oldHeight = lightH;
+	batch_count++;
+	return true;
 }
 
-#define Heightmap_CalculateBody(get_block)\
-for (y = World.Height - 1; y >= 0; y--) {\
-	if (elemsLeft <= 0) { return true; } \
-	mapIndex = World_Pack(x1, y, z1);\
-	hIndex   = Lighting_Pack(x1, z1);\
-\
-	for (z = 0; z < zCount; z++) {\
-		baseIndex = mapIndex;\
-		index = z * xCount;\
-		for (x = 0; x < xCount;) {\
-			curRunCount = skip[index];\
-			x += curRunCount; mapIndex += curRunCount; index += curRunCount;\
-\
-			if (x < xCount && Blocks.BlocksLight[get_block]) {\
-				lightOffset = (Blocks.LightOffset[get_block] >> LIGHT_FLAG_SHADES_FROM_BELOW) & 1;\
-				classic_heightmap[hIndex + x] = (cc_int16)(y - lightOffset);\
-				elemsLeft--;\
-				skip[index] = 0;\
-\
-				offset = prevRunCount + curRunCount;\
-				newRunCount = skip[index - offset] + 1;\
-\
-				/* consider case 1 0 1 0, where we are at last 0 */ \
-				/* we need to make this 3 0 0 0 and advance by 1 */ \
-				oldRunCount = (x - offset + newRunCount) < xCount ? skip[index - offset + newRunCount] : 0; \
-				if (oldRunCount != 0) {\
-					skip[index - offset + newRunCount] = 0; \
-					newRunCount += oldRunCount; \
-				} \
-				skip[index - offset] = newRunCount; \
-				x += oldRunCount; index += oldRunCount; mapIndex += oldRunCount; \
-				prevRunCount = newRunCount; \
-			} else { \
-				prevRunCount = 0; \
-			}\
-			x++; mapIndex++; index++; \
-		}\
-		prevRunCount = 0;\
-		hIndex += World.Width;\
-		mapIndex = baseIndex + World.Width; /* advance one Z */ \
-	}\
+static void ClassicLighting_RefreshColumns(int x, int z, int oldHeight, int newHeight) {
+	int cx = x >> CHUNK_SHIFT, bX = x & CHUNK_MASK;
+	int cz = z >> CHUNK_SHIFT, bZ = z & CHUNK_MASK;
+	/* Faces of the blocks below the lowest changed cell are also affected */
+	int minCy = max(min(oldHeight, newHeight), 0) >> CHUNK_SHIFT;
+	int maxCy = max(max(oldHeight, newHeight) + 1, 0) >> CHUNK_SHIFT;
+
+	ClassicLighting_ResetColumn(cx, minCy, cz, minCy, maxCy);
+	/* Unlike ClassicLighting_RefreshAffected, neighbouring columns are always refreshed */
+	/*  as the blocks that were changed in this column are not known anymore */
+	if (bX == 0         && cx > 0)                 ClassicLighting_ResetColumn(cx - 1, minCy, cz, minCy, maxCy);
+	if (bX == CHUNK_MAX && cx < World.ChunksX - 1) ClassicLighting_ResetColumn(cx + 1, minCy, cz, minCy, maxCy);
+	if (bZ == 0         && cz > 0)                 ClassicLighting_ResetColumn(cx, minCy, cz - 1, minCy, maxCy);
+	if (bZ == CHUNK_MAX && cz < World.ChunksZ - 1) ClassicLighting_ResetColumn(cx, minCy, cz + 1, minCy, maxCy);
+}
+
+/* Recalculates the light height of every column changed in the batch only once */
+void ClassicLighting_FlushBatch(void) {
+	struct LightingColumn* col;
+	int i, x, z, newHeight;
+
+	for (i = 0; i < batch_count; i++) {
+		col = &batch_columns[i];
+		batch_queued[col->index >> 3] &= ~(1 << (col->index & 7));
+
+		x = col->index % World.Width;
+		z = col->index / World.Width;
+		newHeight = ClassicLighting_CalcHeightAt(x, World.MaxY, z, col->index);
+
+		if (newHeight == col->oldHeight) continue;
+		ClassicLighting_RefreshColumns(x, z, col->oldHeight, newHeight);
+	}
+	batch_count = 0;
+}
+
+static void ClassicLighting_FreeBatch(void) {
+	Mem_Free(batch_columns);
+	Mem_Free(batch_queued);
+	batch_columns  = NULL;
+	batch_queued   = NULL;
+	batch_count    = 0;
+	batch_capacity = 0;
+}
+
+void Lighting_BeginBatch(void) { Lighting_BatchDepth++; }
+
+void Lighting_EndBatch(void) {
+	if (--Lighting_BatchDepth) return;
+	Lighting.FlushBatch();
 }
 
-static cc_bool Heightmap_CalculateCoverage(int x1, int z1, int xCount, int zCount, int elemsLeft, int* skip) {
-	int prevRunCount = 0, curRunCount, newRunCount, oldRunCount;
-	int lightOffset, offset;
-	int mapIndex, hIndex, baseIndex, index;
-	int x, y, z;
 
-#ifndef EXTENDED_BLOCKS
-	Heightmap_CalculateBody(World.Blocks[mapIndex]);
+/*########################################################################################################################*
+*---------------------------------------------------Lighting heightmap----------------------------------------------------*
+*#########################################################################################################################*/
+#if defined EXTENDED_BLOCKS || defined CC_BUILD_PALETTEWORLD
+#define Heightmap_GetBlock(i) World_GetRawBlock(i)
 #else
-	if (World.IDMask <= 0xFF) {
-		Heightmap_CalculateBody(World.Blocks[mapIndex]);
-	} else {
-		Heightmap_CalculateBody(World.Blocks[mapIndex] | (World.Blocks2[mapIndex] << 8));
+#define Heightmap_GetBlock(i) World.Blocks[i]
+#endif
+
+/* Returns a bitmask of which of the 16 blocks starting at the given index are not air */
+static cc_uint32 Heightmap_NonAir16(int i) {
+#if defined HEIGHTMAP_SSE2
+	__m128i blocks = _mm_loadu_si128((const __m128i*)(World.Blocks + i));
+	#ifdef EXTENDED_BLOCKS
+	blocks = _mm_or_si128(blocks, _mm_loadu_si128((const __m128i*)(World.Blocks2 + i)));
+	#endif
+	return ~_mm_movemask_epi8(_mm_cmpeq_epi8(blocks, _mm_setzero_si128())) & 0xFFFF;
+#elif defined HEIGHTMAP_NEON
+	static const cc_uint8 weights[16] = { 1,2,4,8,16,32,64,128, 1,2,4,8,16,32,64,128 };
+	uint8x16_t blocks = vld1q_u8(World.Blocks + i);
+	#ifdef EXTENDED_BLOCKS
+	blocks = vorrq_u8(blocks, vld1q_u8(World.Blocks2 + i));
+	#endif
+	blocks = vandq_u8(vtstq_u8(blocks, blocks), vld1q_u8(weights));
+	return vaddv_u8(vget_low_u8(blocks)) | (vaddv_u8(vget_high_u8(blocks)) << 8);
+#else
+	cc_uint32 mask = 0;
+	int j;
+	for (j = 0; j < 16; j++) {
+		if (Heightmap_GetBlock(i + j)) mask |= 1u << j;
 	}
+	return mask;
 #endif
-	return false;
 }
 
-static void Heightmap_FinishCoverage(int x1, int z1, int xCount, int zCount) {
-	int x, z, hIndex, lightH;
+/* Returns a bitmask of which of the count blocks starting at the given index are not air */
+static cc_uint32 Heightmap_NonAir(int i, int count) {
+	cc_uint32 mask = 0;
+	int j = 0;
 
-	for (z = 0; z < zCount; z++) {
-		hIndex = Lighting_Pack(x1, z1 + z);
-		for (x = 0; x < xCount; x++, hIndex++) {
-			lightH = classic_heightmap[hIndex];
+	if (count >= 16) { mask = Heightmap_NonAir16(i); j = 16; }
+	for (; j < count; j++) {
+		if (Heightmap_GetBlock(i + j)) mask |= 1u << j;
+	}
+	return mask;
+}
 
-			if (lightH == HEIGHT_UNCALCULATED) {
-				classic_heightmap[hIndex] = -10;
-			}
+/* Calculates light height of the uncalculated columns from x1 to x1 + xCount in the given row */
+/* Most blocks near the top of the map are usually air, so rather than looking up whether */
+/*  each block blocks light, rows of blocks are checked for being all air at once first */
+static void Heightmap_CalculateRow(int x1, int z, int xCount, cc_bool skipAir) {
+	int hIndex = Lighting_Pack(x1, z);
+	int x, y, mapIndex, lightOffset;
+	cc_uint32 pending = 0, candidates;
+	BlockID block;
+
+	for (x = 0; x < xCount; x++) {
+		if (classic_heightmap[hIndex + x] == HEIGHT_UNCALCULATED) pending |= 1u << x;
+	}
+
+	for (y = World.Height - 1; y >= 0 && pending; y--) {
+		mapIndex   = World_Pack(x1, y, z);
+		candidates = pending;
+		if (skipAir) candidates &= Heightmap_NonAir(mapIndex, xCount);
+
+		for (x = 0; candidates; x++, candidates >>= 1) {
+			if (!(candidates & 1)) continue;
+			block = Heightmap_GetBlock(mapIndex + x);
+			if (!Blocks.BlocksLight[block]) continue;
+
+			lightOffset = (Blocks.LightOffset[block] >> LIGHT_FLAG_SHADES_FROM_BELOW) & 1;
+			classic_heightmap[hIndex + x] = (cc_int16)(y - lightOffset);
+			pending &= ~(1u << x);
 		}
 	}
+
+	/* No blocks in these columns block light */
+	for (x = 0; pending; x++, pending >>= 1) {
+		if (pending & 1) classic_heightmap[hIndex + x] = -10;
+	}
 }
 
 
 void ClassicLighting_LightHint(int startX, int startY, int startZ) {
 	int x1 = max(startX, 0), x2 = min(World.Width,  startX + EXTCHUNK_SIZE);
 	int z1 = max(startZ, 0), z2 = min(World.Length, startZ + EXTCHUNK_SIZE);
-	int xCount = x2 - x1, zCount = z2 - z1;
-	int skip[EXTCHUNK_SIZE * EXTCHUNK_SIZE];
+	/* Air could have been redefined by the server to block light */
+	cc_bool skipAir = !Blocks.BlocksLight[BLOCK_AIR];
+	int z;
 
-	int elemsLeft = Heightmap_InitialCoverage(x1, z1, xCount, zCount, skip);
-	if (!Heightmap_CalculateCoverage(x1, z1, xCount, zCount, elemsLeft, skip)) {
-		Heightmap_FinishCoverage(x1, z1, xCount, zCount);
+	for (z = z1; z < z2; z++) {
+		Heightmap_CalculateRow(x1, z, x2 - x1, skipAir);
 	}
 }
 
 void ClassicLighting_FreeState(void) {
-	Mem_Free(classic_heightmap);
+	ClassicLighting_FreeBatch();
+	Mem_MapFree(classic_heightmap);
 	classic_heightmap = NULL;
 }
 
 void ClassicLighting_AllocState(void) {
-	classic_heightmap = (cc_int16*)Mem_TryAlloc(World.Width * World.Length, 2);
+	classic_heightmap = (cc_int16*)Mem_TryMapAlloc(World.Width * World.Length, 2);
 	if (classic_heightmap) {
 		ClassicLighting_Refresh();
 	} else {
@@ -400,12 +502,20 @@ void ClassicLighting_AllocState(void) {
 	}
 }
 
+cc_uint32 ClassicLighting_MemoryUsage(void) {
+	cc_uint32 size = 0;
+	if (classic_heightmap) size += World.Width * World.Length * 2;
+	if (batch_queued)      size += (World.Width * World.Length + 7) >> 3;
+	return size + batch_capacity * sizeof(struct LightingColumn);
+}
+
 static void ClassicLighting_SetActive(void) {
 	cc_bool smoothLighting = false;
 	if (!Game_ClassicMode) smoothLighting = Options_GetBool(OPT_SMOOTH_LIGHTING, false);
 
 	Lighting.OnBlockChanged = ClassicLighting_OnBlockChanged;
 	Lighting.Refresh        = ClassicLighting_Refresh;
+	Lighting.FlushBatch     = ClassicLighting_FlushBatch;
 	Lighting.IsLit          = ClassicLighting_IsLit;
 	Lighting.Color          = smoothLighting ? SmoothLighting_Color : ClassicLighting_Color;
 	Lighting.Color_XSide    = ClassicLighting_Color_XSide;
@@ -434,6 +544,11 @@ static void Lighting_ApplyActive(void) {
 	}
 }
 
+cc_uint32 Lighting_MemoryUsage(void) {
+	if (Lighting_Mode != LIGHTING_MODE_CLASSIC) return FancyLighting_MemoryUsage();
+	return ClassicLighting_MemoryUsage();
+}
+
 static void Lighting_SwitchActive(void) {
 	Lighting.FreeState();
 	Lighting_ApplyActive();
@@ -446,7 +561,8 @@ static void Lighting_HandleModeChanged(void* obj, cc_uint8 oldMode, cc_bool from
 
 	if (World.Loaded) {
 		Lighting_SwitchActive();
-		MapRenderer_Refresh();
+		/* Rebuild progressively (nearest chunks first) instead of discarding every mesh at once */
+		MapRenderer_RefreshAll();
 	} else {
 		Lighting_ApplyActive();
 	}
@@ -464,11 +580,15 @@ static void OnInit(void) {
 	Event_Register_(&WorldEvents.LightingModeChanged, NULL, Lighting_HandleModeChanged);
 }
 static void OnReset(void)        { Lighting.FreeState(); }
+static void OnFree(void) {
+	Lighting.FreeState();
+	FancyLighting_OnFree();
+}
 static void OnNewMapLoaded(void) { Lighting.AllocState(); }
 
 struct IGameComponent Lighting_Component = {
 	OnInit,  /* Init  */
-	OnReset, /* Free  */
+	OnFree,  /* Free  */
 	OnReset, /* Reset */
 	OnReset, /* OnNewMap */
 	OnNewMapLoaded /* OnNewMapLoaded */
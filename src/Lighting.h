@@ -53,6 +53,8 @@ CC_VAR extern struct _Lighting {
 	/* Invalidates/Resets lighting state for all of the blocks in the world */
 	/*  (e.g. because a block changed whether it is full bright or not) */
 	void (*Refresh)(void);
+	/* Performs the lighting updates that were deferred while a batch was active */
+	void (*FlushBatch)(void);
 
 	/* Returns whether the block at the given coordinates is fully in sunlight. */
 	/* NOTE: Does ***NOT*** check that the coordinates are inside the map. */
@@ -74,8 +76,33 @@ CC_VAR extern struct _Lighting {
 	PackedCol (*Color_ZSide_Fast)(int x, int y, int z);
 } Lighting;
 
+/* Sun and shadow colours used by the classic lighting _Fast functions when building chunk meshes */
+/* NOTE: When the graphics backend applies light colours itself (see Gfx_SetChunkLightColors), */
+/*  these only contain the face shading, so that sun/shadow colour changes don't need the world remeshed */
+CC_VAR extern struct _LightingMeshCols {
+	PackedCol Sun,    SunXSide,    SunZSide,    SunYMin;
+	PackedCol Shadow, ShadowXSide, ShadowZSide, ShadowYMin;
+} Lighting_MeshCols;
+/* Recalculates Lighting_MeshCols, either from the current environment colours, */
+/*  or for lighting by Gfx_SetChunkLightColors when gpuLight is true */
+void Lighting_UpdateMeshCols(cc_bool gpuLight);
+
+/* Number of Lighting_BeginBatch calls that have not been ended yet */
+extern int Lighting_BatchDepth;
+/* Starts deferring expensive lighting updates from OnBlockChanged until Lighting_EndBatch */
+/*  (e.g. when many blocks are about to be changed at once) */
+/* NOTE: Lighting state may be out of date until the batch is ended */
+CC_API void Lighting_BeginBatch(void);
+/* Ends a batch started by Lighting_BeginBatch, and performs the deferred lighting updates */
+CC_API void Lighting_EndBatch(void);
+
+/* Returns how many bytes of memory are used by the lighting state of the current map */
+cc_uint32 Lighting_MemoryUsage(void);
+
 void FancyLighting_SetActive(void);
 void FancyLighting_OnInit(void);
+void FancyLighting_OnFree(void);
+cc_uint32 FancyLighting_MemoryUsage(void);
 
 /* Expose ClassicLighting functions for reuse in Fancy lighting */
 void ClassicLighting_Refresh(void);
@@ -86,6 +113,8 @@ void ClassicLighting_LightHint(int startX, int startY, int startZ);
 cc_bool ClassicLighting_IsLit(int x, int y, int z);
 cc_bool ClassicLighting_IsLit_Fast(int x, int y, int z);
 void ClassicLighting_OnBlockChanged(int x, int y, int z, BlockID oldBlock, BlockID newBlock);
+void ClassicLighting_FlushBatch(void);
+cc_uint32 ClassicLighting_MemoryUsage(void);
 
 CC_END_HEADER
 #endif
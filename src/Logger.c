@@ -65,6 +65,7 @@ void Logger_DialogWarn(const cc_string* msg) {
 }
 const char* Logger_DialogTitle = "Error";
 Logger_DoWarn Logger_WarnFunc  = Logger_DialogWarn;
+Logger_DoCrash Logger_CrashHook;
 
 /* Returns a description for some ClassiCube specific error codes */
 static const char* GetCCErrorDesc(cc_result res) {
@@ -97,6 +98,11 @@ static const char* GetCCErrorDesc(cc_result res) {
 	case NBT_ERR_UNKNOWN:   return "Unknown NBT tag type";
 	case CW_ERR_ROOT_TAG:   return "Invalid root NBT tag";
 	case CW_ERR_STRING_LEN: return "NBT string too long";
+	case CCR_ERR_SIGNATURE: return "Not a region map file";
+	case CCR_ERR_VERSION:   return "Unsupported region map version";
+	case CCR_ERR_INDEX:     return "Invalid region map index";
+	case NETCAP_ERR_SIGNATURE: return "Not a network capture file";
+	case NETCAP_ERR_VERSION:   return "Unsupported network capture version";
 
 	case ERR_DOWNLOAD_INVALID: return "Website denied download or doesn't exist";
 	case ERR_NO_AUDIO_OUTPUT:  return "No audio output devices plugged in";
@@ -1174,6 +1180,8 @@ void Logger_DoAbort(cc_result result, const char* raw_msg, void* ctx) {
 	static const cc_string backtrace = String_FromConst("-- backtrace --" _NL);
 	cc_string msg; char msgBuffer[3070 + 1];
 	String_InitArray_NT(msg, msgBuffer);
+	/* Make sure that messages logged just before the crash aren't lost */
+	Platform_FlushLog();
 
 	String_AppendConst(&msg, "ClassiCube crashed." _NL);
 	if (raw_msg) String_Format1(&msg, "Reason: %c" _NL, raw_msg);
@@ -1201,6 +1209,13 @@ void Logger_DoAbort(cc_result result, const char* raw_msg, void* ctx) {
 	DumpMisc();
 	CloseLogFile();
 
+	/* Avoid recursively crashing if the hook itself crashes */
+	if (Logger_CrashHook) {
+		Logger_DoCrash hook = Logger_CrashHook;
+		Logger_CrashHook    = NULL;
+		hook();
+	}
+
 	msg.buffer[msg.length] = '\0';
 	Window_ShowDialog("We're sorry", msg.buffer);
 	Process_Exit(result);
@@ -17,6 +17,9 @@ extern Logger_DoWarn Logger_WarnFunc;
 extern const char* Logger_DialogTitle;
 /* Shows a warning message box with the given message. */
 void Logger_DialogWarn(const cc_string* msg);
+typedef void (*Logger_DoCrash)(void);
+/* Called when the game crashes, before the crash dialog is shown. (e.g. to write out buffered data) */
+extern Logger_DoCrash Logger_CrashHook;
 
 /* Format: "Error [result] when [action]  \n  Error meaning: [desc]" */
 /* If describeErr returns false, then 'Error meaning' line is omitted. */
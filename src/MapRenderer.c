@@ -14,8 +14,16 @@
 #include "Utils.h"
 #include "World.h"
 #include "Options.h"
+#include "Bitmap.h"
+#include "Lighting.h"
 
 int MapRenderer_1DUsedCount;
+cc_bool MapRenderer_CompactVertices;
+cc_bool MapRenderer_TextureArray;
+/* Whether the user allows using compact vertices for chunk meshes */
+static cc_bool compactVertices;
+/* Whether sun/shadow colours are applied to chunk meshes by the GPU, instead of being baked into vertices */
+static cc_bool gpuLight;
 struct ChunkPartInfo* MapRenderer_PartsNormal;
 struct ChunkPartInfo* MapRenderer_PartsTranslucent;
 
@@ -34,7 +42,10 @@ static cc_bool checkNormParts[ATLAS1D_MAX_ATLASES], checkTranParts[ATLAS1D_MAX_A
 /* Render info for all chunks in the world. Unsorted. */
 static struct ChunkInfo* mapChunks;
 /* Pointers to render info for all chunks in the world, sorted by distance from the camera. */
+/* Chunks known to be empty are removed from this, so that loops over it scale with the map's content */
 static struct ChunkInfo** sortedChunks;
+/* Number of chunks in the sortedChunks array */
+static int sortedCount;
 /* Pointers to render info for all chunks in the world, sorted by distance from the camera. */
 /* Only chunks that can be rendered (i.e. not empty and are visible) are included in this.  */
 static struct ChunkInfo** renderChunks;
@@ -42,10 +53,38 @@ static struct ChunkInfo** renderChunks;
 static int renderChunksCount;
 /* Distance of each chunk from the camera. */
 static cc_uint32* distances;
+/* Scratch arrays used while sorting sortedChunks and distances */
+static struct ChunkInfo** sortTempChunks;
+static cc_uint32* sortTempDistances;
+/* Indices of chunks pending in the occlusion flood fill */
+static int* occlusionQueue;
+/* Chunks are grouped into 4x4x4 chunks for frustum culling */
+#define CHUNK_GROUP_SHIFT 2
+#define CHUNK_GROUP_MASK  ((1 << CHUNK_GROUP_SHIFT) - 1)
+#define CHUNK_GROUP_BLOCKS_SHIFT (CHUNK_GROUP_SHIFT + CHUNK_SHIFT)
+#define CHUNK_GROUP_BLOCKS (1 << CHUNK_GROUP_BLOCKS_SHIFT)
+#define CHUNK_GROUP_RADIUS 56 /* 56 ~ sqrt(3 * 32^2) */
+/* FRUSTUM_RESULT of each group of 4x4x4 chunks, used to cull whole groups at once */
+static cc_uint8* groupCulling;
+static int groupsX, groupsY, groupsZ;
 /* Maximum number of chunk updates that can be performed in one frame. */
 static int maxChunkUpdates;
+#define MAX_CHUNK_UPDATES 1024
 /* Cached number of chunks in the world */
 static int chunksCount;
+/* Total size in bytes of the vertices of all chunk meshes */
+static cc_uint64 meshBytes;
+/* Max size in bytes that chunk meshes should use, 0 if unlimited */
+static cc_uint64 meshBudget;
+/* Once over budget, distant chunk meshes are evicted until below this, so evicted chunks aren't immediately rebuilt */
+#define MESH_BUDGET_LOW (meshBudget - meshBudget / 8)
+/* Below this, running out of VRAM is not handled by reducing the chunk mesh budget */
+#define MESH_MIN_BUDGET (16 * 1024 * 1024)
+#define MESH_VERTEX_SIZE (MapRenderer_CompactVertices ? SIZEOF_VERTEX_CHUNK : SIZEOF_VERTEX_TEXTURED)
+/* Offset to the adjacent block/chunk for each face */
+static const int faceOffsets[FACE_COUNT][3] = {
+	{ -1, 0, 0 }, { 1, 0, 0 }, { 0, 0, -1 }, { 0, 0, 1 }, { 0, -1, 0 }, { 0, 1, 0 }
+};
 
 static void ChunkInfo_Reset(struct ChunkInfo* chunk, int x, int y, int z) {
 	chunk->centreX = x + HALF_CHUNK_SIZE; chunk->centreY = y + HALF_CHUNK_SIZE; 
@@ -59,6 +98,10 @@ static void ChunkInfo_Reset(struct ChunkInfo* chunk, int x, int y, int z) {
 	chunk->dirty   = false; 
 	chunk->allAir  = false;
 	chunk->noData  = true;
+	chunk->occluded = false;
+	chunk->listed   = true;
+	/* Chunks are assumed to be see-through until their mesh is built */
+	Mem_Set(chunk->connected, FACE_BITS_ALL, FACE_COUNT);
 
 	chunk->drawXMin = false; chunk->drawXMax = false; chunk->drawZMin = false;
 	chunk->drawZMax = false; chunk->drawYMin = false; chunk->drawYMax = false;
@@ -71,6 +114,8 @@ static void ChunkInfo_Reset(struct ChunkInfo* chunk, int x, int y, int z) {
 CC_NOINLINE static int MapRenderer_UsedAtlases(void) {
 	TextureLoc maxLoc = 0;
 	int i;
+	/* All 1D atlases are layers of the same texture array */
+	if (MapRenderer_TextureArray) return 1;
 
 	for (i = 0; i < Array_Elems(Blocks.Textures); i++) {
 		maxLoc = max(maxLoc, Blocks.Textures[i]);
@@ -99,36 +144,100 @@ static void CheckWeather(float delta) {
 	Gfx_SetAlphaBlending(false);
 }
 
+/* Compact chunk vertices are relative to the chunk origin and scaled up, so undo that */
+static void LoadChunkMatrix(struct ChunkInfo* info) {
+	struct Matrix m = Matrix_IdentityValue, mv;
+	m.row1.x = 1.0f / CHUNKVERTEX_POS_SCALE;
+	m.row2.y = 1.0f / CHUNKVERTEX_POS_SCALE;
+	m.row3.z = 1.0f / CHUNKVERTEX_POS_SCALE;
+	m.row4.x = (float)(info->centreX - HALF_CHUNK_SIZE);
+	m.row4.y = (float)(info->centreY - HALF_CHUNK_SIZE);
+	m.row4.z = (float)(info->centreZ - HALF_CHUNK_SIZE);
+
+	Matrix_Mul(&mv, &m, &Gfx.View);
+	Gfx_LoadMatrix(MATRIX_VIEW, &mv);
+}
+
+static void SetChunkVertexFormat(void) {
+	Gfx_SetVertexFormat(MapRenderer_CompactVertices ? VERTEX_FORMAT_CHUNK : VERTEX_FORMAT_TEXTURED);
+	Gfx_SetChunkLightColors(Env.SunCol, Env.ShadowCol);
+}
+
+static void EndChunkVertexFormat(void) {
+	if (MapRenderer_CompactVertices) Gfx_LoadMatrix(MATRIX_VIEW, &Gfx.View);
+}
+
+/* Draws the faces of the given chunk part that can face the camera (or all faces if drawAll) */
+/* Faces are stored one after another in the VB, so runs of consecutive faces are drawn all at once */
+static void DrawChunkFaces(struct ChunkInfo* info, struct ChunkPartInfo* part, cc_bool drawAll) {
+	cc_bool draw[FACE_COUNT];
+	int offset = part->offset + part->spriteCount;
+	int face, start = offset, count = 0;
+
+	draw[FACE_XMIN] = drawAll || info->drawXMin; draw[FACE_XMAX] = drawAll || info->drawXMax;
+	draw[FACE_ZMIN] = drawAll || info->drawZMin; draw[FACE_ZMAX] = drawAll || info->drawZMax;
+	draw[FACE_YMIN] = drawAll || info->drawYMin; draw[FACE_YMAX] = drawAll || info->drawYMax;
+
+	for (face = 0; face < FACE_COUNT; face++) {
+		if (!part->counts[face]) continue;
+
+		if (draw[face]) {
 #ifdef CC_BUILD_GL11
-#define DrawFace(face, ign)    Gfx_BindVb(part.vbs[face]); Gfx_DrawIndexedTris_T2fC4b(0, 0);
-#define DrawFaces(f1, f2, ign) DrawFace(f1, ign); DrawFace(f2, ign);
+			Gfx_BindVb(part->vbs[face]); Gfx_DrawIndexedTris_T2fC4b(0, 0);
 #else
-#define DrawFace(face, offset)    Gfx_DrawIndexedTris_T2fC4b(part.counts[face], offset);
-#define DrawFaces(f1, f2, offset) Gfx_DrawIndexedTris_T2fC4b(part.counts[f1] + part.counts[f2], offset);
+			if (!count) start = offset;
+			count += part->counts[face];
 #endif
+			Game_Vertices += part->counts[face];
+		} else if (count) {
+			Gfx_DrawIndexedTris_T2fC4b(count, start);
+			count = 0;
+		}
+		offset += part->counts[face];
+	}
+	if (count) Gfx_DrawIndexedTris_T2fC4b(count, start);
+}
+
+static void BindBatchTexture(int batch) {
+	MapRenderer_CurStats->textureBinds++;
+	if (MapRenderer_TextureArray) {
+		Gfx_BindTextureArray(Atlas1D.ArrayTexId);
+	} else {
+		Atlas1D_Bind(batch);
+	}
+}
 
-#define DrawNormalFaces(minFace, maxFace) \
-if (drawMin && drawMax) { \
-	Gfx_SetFaceCulling(true); \
-	DrawFaces(minFace, maxFace, offset); \
-	Gfx_SetFaceCulling(false); \
-	Game_Vertices += (part.counts[minFace] + part.counts[maxFace]); \
-} else if (drawMin) { \
-	DrawFace(minFace, offset); \
-	Game_Vertices += part.counts[minFace]; \
-} else if (drawMax) { \
-	DrawFace(maxFace, offset + part.counts[minFace]); \
-	Game_Vertices += part.counts[maxFace]; \
-}
-
-static void RenderNormalBatch(int batch) {
+/* Opaque chunks are drawn in bands of increasing distance from the camera, with each band drawn one atlas at a time */
+/* This keeps most of the early depth testing benefit of near to far order, while binding each atlas at most once per band */
+#define NORMAL_BAND_SIZE (4 * CHUNK_SIZE)
+
+static cc_uint32 ChunkDistSquared(struct ChunkInfo* info) {
+	int dx = info->centreX - chunkPos.x, dy = info->centreY - chunkPos.y, dz = info->centreZ - chunkPos.z;
+	return (cc_uint32)(dx * dx + dy * dy + dz * dz);
+}
+
+/* Returns the index in renderChunks after the last chunk in the same distance band as the chunk at start */
+static int NextNormalBand(int start) {
+	cc_uint32 band, limit;
+	band  = (cc_uint32)Math_SqrtF((float)ChunkDistSquared(renderChunks[start])) / NORMAL_BAND_SIZE + 1;
+	limit = band * band * (NORMAL_BAND_SIZE * NORMAL_BAND_SIZE);
+
+	for (start++; start < renderChunksCount; start++) {
+		if (ChunkDistSquared(renderChunks[start]) >= limit) break;
+	}
+	return start;
+}
+
+/* Draws the parts of the given atlas batch in the chunks from renderChunks[start] up to renderChunks[end] */
+/* NOTE: The atlas is only bound once a part using it is found */
+static void RenderNormalBatch(int batch, int start, int end) {
 	int batchOffset = chunksCount * batch;
 	struct ChunkInfo* info;
 	struct ChunkPartInfo part;
-	cc_bool drawMin, drawMax;
+	cc_bool bound = false;
 	int i, offset, count;
 
-	for (i = 0; i < renderChunksCount; i++) {
+	for (i = start; i < end; i++) {
 		info = renderChunks[i];
 		if (!info->normalParts) continue;
 
@@ -136,36 +245,23 @@ static void RenderNormalBatch(int batch) {
 		if (part.offset < 0) continue;
 		hasNormParts[batch] = true;
 
+		if (!bound) { BindBatchTexture(batch); bound = true; }
+
 #ifndef CC_BUILD_GL11
 		Gfx_BindVb_Textured(info->vb);
+		if (MapRenderer_CompactVertices) LoadChunkMatrix(info);
 #endif
-
-		offset  = part.offset + part.spriteCount;
-		drawMin = info->drawXMin && part.counts[FACE_XMIN];
-		drawMax = info->drawXMax && part.counts[FACE_XMAX];
-		DrawNormalFaces(FACE_XMIN, FACE_XMAX);
-
-		offset  += part.counts[FACE_XMIN] + part.counts[FACE_XMAX];
-		drawMin = info->drawZMin && part.counts[FACE_ZMIN];
-		drawMax = info->drawZMax && part.counts[FACE_ZMAX];
-		DrawNormalFaces(FACE_ZMIN, FACE_ZMAX);
-
-		offset  += part.counts[FACE_ZMIN] + part.counts[FACE_ZMAX];
-		drawMin = info->drawYMin && part.counts[FACE_YMIN];
-		drawMax = info->drawYMax && part.counts[FACE_YMAX];
-		DrawNormalFaces(FACE_YMIN, FACE_YMAX);
+		DrawChunkFaces(info, &part, false);
 
 		if (!part.spriteCount) continue;
 		offset = part.offset;
 		count  = part.spriteCount >> 2; /* 4 per sprite */
 
-		Gfx_SetFaceCulling(true);
 		/* TODO: fix to not render them all */
 #ifdef CC_BUILD_GL11
 		Gfx_BindVb(part.vbs[FACE_COUNT]);
 		Gfx_DrawIndexedTris_T2fC4b(0, 0);
 		Game_Vertices += count * 4;
-		Gfx_SetFaceCulling(false);
 		continue;
 #endif
 		if (info->drawXMax || info->drawZMin) {
@@ -183,28 +279,36 @@ static void RenderNormalBatch(int batch) {
 		if (info->drawXMax || info->drawZMax) {
 			Gfx_DrawIndexedTris_T2fC4b(count, offset); Game_Vertices += count;
 		}
-		Gfx_SetFaceCulling(false);
 	}
 }
 
 void MapRenderer_RenderNormal(float delta) {
-	int batch;
+	int batch, start, end;
 	if (!mapChunks) return;
 
-	Gfx_SetVertexFormat(VERTEX_FORMAT_TEXTURED);
+	SetChunkVertexFormat();
 	Gfx_SetAlphaTest(true);
 	
 	Gfx_EnableMipmaps();
-	for (batch = 0; batch < MapRenderer_1DUsedCount; batch++) 
+	Gfx_SetFaceCulling(true);
+	for (start = 0; start < renderChunksCount; start = end)
 	{
-		if (normPartsCount[batch] <= 0) continue;
-		if (hasNormParts[batch] || checkNormParts[batch]) {
-			Atlas1D_Bind(batch);
-			RenderNormalBatch(batch);
-			checkNormParts[batch] = false;
+		end = NextNormalBand(start);
+
+		for (batch = 0; batch < MapRenderer_1DUsedCount; batch++) 
+		{
+			if (normPartsCount[batch] <= 0) continue;
+			if (hasNormParts[batch] || checkNormParts[batch]) RenderNormalBatch(batch, start, end);
 		}
 	}
+
+	for (batch = 0; batch < MapRenderer_1DUsedCount; batch++) 
+	{
+		checkNormParts[batch] = false;
+	}
+	Gfx_SetFaceCulling(false);
 	Gfx_DisableMipmaps();
+	EndChunkVertexFormat();
 
 	CheckWeather(delta);
 	Gfx_SetAlphaTest(false);
@@ -213,24 +317,22 @@ void MapRenderer_RenderNormal(float delta) {
 #endif
 }
 
-#define DrawTranslucentFaces(minFace, maxFace) \
-if (drawMin && drawMax) { \
-	DrawFaces(minFace, maxFace, offset); \
-	Game_Vertices += (part.counts[minFace] + part.counts[maxFace]); \
-} else if (drawMin) { \
-	DrawFace(minFace, offset); \
-	Game_Vertices += part.counts[minFace]; \
-} else if (drawMax) { \
-	DrawFace(maxFace, offset + part.counts[minFace]); \
-	Game_Vertices += part.counts[maxFace]; \
+/* Whether only the top faces of the given translucent part will be drawn, because the chunk is below the camera */
+/* Faces are built in order of increasing Y, so when viewed from above the top faces are */
+/*  already sorted back to front, and can be alpha blended without the depth only pass first */
+static cc_bool OnlyTopFacesVisible(struct ChunkInfo* info, struct ChunkPartInfo* part) {
+	if (inTranslucent || part->spriteCount) return false;
+	if (!info->drawYMax || info->drawYMin) return false;
+
+	return !part->counts[FACE_XMIN] && !part->counts[FACE_XMAX] &&
+		   !part->counts[FACE_ZMIN] && !part->counts[FACE_ZMAX];
 }
 
-static void RenderTranslucentBatch(int batch) {
+static void RenderTranslucentBatch(int batch, cc_bool topFaces) {
 	int batchOffset = chunksCount * batch;
 	struct ChunkInfo* info;
 	struct ChunkPartInfo part;
-	cc_bool drawMin, drawMax;
-	int i, offset;
+	int i;
 
 	for (i = 0; i < renderChunksCount; i++) {
 		info = renderChunks[i];
@@ -239,35 +341,38 @@ static void RenderTranslucentBatch(int batch) {
 		part = info->translucentParts[batchOffset];
 		if (part.offset < 0) continue;
 		hasTranParts[batch] = true;
+		if (OnlyTopFacesVisible(info, &part) != topFaces) continue;
 
 #ifndef CC_BUILD_GL11
 		Gfx_BindVb_Textured(info->vb);
+		if (MapRenderer_CompactVertices) LoadChunkMatrix(info);
 #endif
 
-		offset  = part.offset;
-		drawMin = (inTranslucent || info->drawXMin) && part.counts[FACE_XMIN];
-		drawMax = (inTranslucent || info->drawXMax) && part.counts[FACE_XMAX];
-		DrawTranslucentFaces(FACE_XMIN, FACE_XMAX);
-
-		offset  += part.counts[FACE_XMIN] + part.counts[FACE_XMAX];
-		drawMin = (inTranslucent || info->drawZMin) && part.counts[FACE_ZMIN];
-		drawMax = (inTranslucent || info->drawZMax) && part.counts[FACE_ZMAX];
-		DrawTranslucentFaces(FACE_ZMIN, FACE_ZMAX);
-
-		offset  += part.counts[FACE_ZMIN] + part.counts[FACE_ZMAX];
-		drawMin = (inTranslucent || info->drawYMin) && part.counts[FACE_YMIN];
-		drawMax = (inTranslucent || info->drawYMax) && part.counts[FACE_YMAX];
-		DrawTranslucentFaces(FACE_YMIN, FACE_YMAX);
+		DrawChunkFaces(info, &part, inTranslucent);
 	}
 }
 
 void MapRenderer_RenderTranslucent(float delta) {
 	int vertices, batch;
 	if (!mapChunks) return;
+	SetChunkVertexFormat();
 
-	/* First fill depth buffer */
+	/* First draw the chunks that don't need a depth pass (e.g. the surface of water below the camera) */
+	/* These still write to the depth buffer, so that translucent blocks behind them are hidden as usual */
+	Gfx_SetAlphaBlending(true);
+	Gfx_EnableMipmaps();
+	for (batch = 0; batch < MapRenderer_1DUsedCount; batch++) 
+	{
+		if (tranPartsCount[batch] <= 0) continue;
+		if (hasTranParts[batch] || checkTranParts[batch]) {
+			BindBatchTexture(batch);
+			RenderTranslucentBatch(batch, true);
+		}
+	}
+	Gfx_DisableMipmaps();
+
+	/* Then fill depth buffer for the other chunks */
 	vertices = Game_Vertices;
-	Gfx_SetVertexFormat(VERTEX_FORMAT_TEXTURED);
 	Gfx_SetAlphaBlending(false);
 	Gfx_DepthOnlyRendering(true);
 
@@ -275,7 +380,7 @@ void MapRenderer_RenderTranslucent(float delta) {
 	{
 		if (tranPartsCount[batch] <= 0) continue;
 		if (hasTranParts[batch] || checkTranParts[batch]) {
-			RenderTranslucentBatch(batch);
+			RenderTranslucentBatch(batch, false);
 			checkTranParts[batch] = false;
 		}
 	}
@@ -292,10 +397,11 @@ void MapRenderer_RenderTranslucent(float delta) {
 		if (tranPartsCount[batch] <= 0) continue;
 		if (!hasTranParts[batch]) continue;
 
-		Atlas1D_Bind(batch);
-		RenderTranslucentBatch(batch);
+		BindBatchTexture(batch);
+		RenderTranslucentBatch(batch, false);
 	}
 	Gfx_DisableMipmaps();
+	EndChunkVertexFormat();
 
 	Gfx_SetDepthWrite(true);
 	/* If we weren't under water, render weather after to blend properly */
@@ -312,9 +418,15 @@ void MapRenderer_RenderTranslucent(float delta) {
 *---------------------------------------------------Chunk functionality---------------------------------------------------*
 *#########################################################################################################################*/
 /* Deletes vertex buffer associated with the given chunk and updates internal state */
+static int PartVertices(struct ChunkPartInfo* part) {
+	int i, count = part->spriteCount;
+	for (i = 0; i < FACE_COUNT; i++) count += part->counts[i];
+	return count;
+}
+
 static void DeleteChunk(struct ChunkInfo* info) {
 	struct ChunkPartInfo* ptr;
-	int i;
+	int i, vertices = 0;
 #ifdef CC_BUILD_GL11
 	int j;
 #else
@@ -324,16 +436,14 @@ static void DeleteChunk(struct ChunkInfo* info) {
 	info->empty  = false; 
 	info->allAir = false;
 	info->noData = true;
-#ifdef OCCLUSION
-	info.OcclusionFlags = 0;
-	info.OccludedFlags = 0;
-#endif
+	Mem_Set(info->connected, FACE_BITS_ALL, FACE_COUNT);
 
 	if (info->normalParts) {
 		ptr = info->normalParts;
 		for (i = 0; i < MapRenderer_1DUsedCount; i++, ptr += chunksCount) {
 			if (ptr->offset < 0) continue; 
 			normPartsCount[i]--;
+			vertices += PartVertices(ptr);
 #ifdef CC_BUILD_GL11
 			for (j = 0; j < CHUNKPART_MAX_VBS; j++) Gfx_DeleteVb(&ptr->vbs[j]);
 #endif
@@ -346,22 +456,20 @@ static void DeleteChunk(struct ChunkInfo* info) {
 		for (i = 0; i < MapRenderer_1DUsedCount; i++, ptr += chunksCount) {
 			if (ptr->offset < 0) continue;
 			tranPartsCount[i]--;
+			vertices += PartVertices(ptr);
 #ifdef CC_BUILD_GL11
 			for (j = 0; j < CHUNKPART_MAX_VBS; j++) Gfx_DeleteVb(&ptr->vbs[j]);
 #endif
 		}
 		info->translucentParts = NULL;
 	}
+	meshBytes -= min(meshBytes, (cc_uint64)vertices * MESH_VERTEX_SIZE);
 }
 
-/* Builds the mesh (hence vertex buffer) for the given chunk, and updates internal state */
-static void BuildChunk(struct ChunkInfo* info, int* chunkUpdates) {
+/* Updates internal state after the mesh for the given chunk has been built */
+static void BuildChunk(struct ChunkInfo* info) {
 	struct ChunkPartInfo* ptr;
-	int i;
-
-	Game.ChunkUpdates++;
-	(*chunkUpdates)++;
-	Builder_MakeChunk(info);
+	int i, vertices = 0;
 
 	info->dirty  = false;
 	info->noData = !info->normalParts && !info->translucentParts;
@@ -371,16 +479,42 @@ static void BuildChunk(struct ChunkInfo* info, int* chunkUpdates) {
 	if (info->normalParts) {
 		ptr = info->normalParts;
 		for (i = 0; i < MapRenderer_1DUsedCount; i++, ptr += chunksCount) {
-			if (ptr->offset >= 0) normPartsCount[i]++;
+			if (ptr->offset < 0) continue;
+			normPartsCount[i]++;
+			vertices += PartVertices(ptr);
 		}
 	}
 
 	if (info->translucentParts) {
 		ptr = info->translucentParts;
 		for (i = 0; i < MapRenderer_1DUsedCount; i++, ptr += chunksCount) {
-			if (ptr->offset >= 0) tranPartsCount[i]++;
+			if (ptr->offset < 0) continue;
+			tranPartsCount[i]++;
+			vertices += PartVertices(ptr);
 		}
 	}
+	meshBytes += (cc_uint64)vertices * MESH_VERTEX_SIZE;
+}
+
+/* Deletes the meshes of the farthest chunks that aren't visible, until chunk meshes use at most the given bytes */
+static void EvictMeshes(cc_uint64 maxBytes) {
+	struct ChunkInfo* info;
+	int i;
+
+	for (i = sortedCount - 1; i >= 0 && meshBytes > maxBytes; i--) {
+		info = sortedChunks[i];
+		if (info->noData || info->visible) continue;
+		DeleteChunk(info);
+	}
+}
+
+cc_bool MapRenderer_ReduceVRAM(void) {
+	cc_uint64 oldBytes = meshBytes;
+	if (meshBytes < MESH_MIN_BUDGET) return false;
+
+	meshBudget = meshBytes - meshBytes / 4;
+	EvictMeshes(MESH_BUDGET_LOW);
+	return meshBytes < oldBytes;
 }
 
 
@@ -388,37 +522,54 @@ static void BuildChunk(struct ChunkInfo* info, int* chunkUpdates) {
 *----------------------------------------------------Chunks mangagement---------------------------------------------------*
 *#########################################################################################################################*/
 static void FreeParts(void) {
-	Mem_Free(MapRenderer_PartsNormal);
+	Mem_MapFree(MapRenderer_PartsNormal);
 	MapRenderer_PartsNormal      = NULL;
 	MapRenderer_PartsTranslucent = NULL;
 }
 
 static void FreeChunks(void) {
-	Mem_Free(mapChunks);
-	Mem_Free(sortedChunks);
-	Mem_Free(renderChunks);
-	Mem_Free(distances);
+	Mem_MapFree(groupCulling);
+	Mem_MapFree(sortTempDistances);
+	Mem_MapFree(sortTempChunks);
+	Mem_MapFree(occlusionQueue);
+	Mem_MapFree(distances);
+	Mem_MapFree(renderChunks);
+	Mem_MapFree(sortedChunks);
+	Mem_MapFree(mapChunks);
 
 	mapChunks    = NULL;
 	sortedChunks = NULL;
+	sortedCount  = 0;
 	renderChunks = NULL;
 	distances    = NULL;
+	occlusionQueue = NULL;
+	sortTempChunks    = NULL;
+	sortTempDistances = NULL;
+	groupCulling      = NULL;
 }
 
 static void AllocateParts(void) {
 	struct ChunkPartInfo* ptr;
 	cc_uint32 count = chunksCount * MapRenderer_1DUsedCount;
 
-	ptr = (struct ChunkPartInfo*)Mem_AllocCleared(count * 2, sizeof(struct ChunkPartInfo), "chunk parts");
+	ptr = (struct ChunkPartInfo*)Mem_MapAllocCleared(count * 2, sizeof(struct ChunkPartInfo), "chunk parts");
 	MapRenderer_PartsNormal      = ptr;
 	MapRenderer_PartsTranslucent = ptr + count;
 }
 
 static void AllocateChunks(void) {
-	mapChunks    = (struct ChunkInfo*) Mem_Alloc(chunksCount, sizeof(struct ChunkInfo),  "chunk info");
-	sortedChunks = (struct ChunkInfo**)Mem_Alloc(chunksCount, sizeof(struct ChunkInfo*), "sorted chunk info");
-	renderChunks = (struct ChunkInfo**)Mem_Alloc(chunksCount, sizeof(struct ChunkInfo*), "render chunk info");
-	distances    = (cc_uint32*)Mem_Alloc(chunksCount, 4, "chunk distances");
+	mapChunks    = (struct ChunkInfo*) Mem_MapAlloc(chunksCount, sizeof(struct ChunkInfo),  "chunk info");
+	sortedChunks = (struct ChunkInfo**)Mem_MapAlloc(chunksCount, sizeof(struct ChunkInfo*), "sorted chunk info");
+	renderChunks = (struct ChunkInfo**)Mem_MapAlloc(chunksCount, sizeof(struct ChunkInfo*), "render chunk info");
+	distances    = (cc_uint32*)Mem_MapAlloc(chunksCount, 4, "chunk distances");
+	occlusionQueue = (int*)Mem_MapAlloc(chunksCount, sizeof(int), "chunk occlusion queue");
+	sortTempChunks    = (struct ChunkInfo**)Mem_MapAlloc(chunksCount, sizeof(struct ChunkInfo*), "chunk sort temp");
+	sortTempDistances = (cc_uint32*)Mem_MapAlloc(chunksCount, 4, "chunk sort distances");
+
+	groupsX = (World.ChunksX + CHUNK_GROUP_MASK) >> CHUNK_GROUP_SHIFT;
+	groupsY = (World.ChunksY + CHUNK_GROUP_MASK) >> CHUNK_GROUP_SHIFT;
+	groupsZ = (World.ChunksZ + CHUNK_GROUP_MASK) >> CHUNK_GROUP_SHIFT;
+	groupCulling = (cc_uint8*)Mem_MapAlloc(groupsX * groupsY * groupsZ, 1, "chunk group culling");
 }
 
 static void ResetPartFlags(void) {
@@ -452,6 +603,7 @@ static void InitChunks(void) {
 			}
 		}
 	}
+	sortedCount = chunksCount;
 }
 
 static void ResetChunks(void) {
@@ -460,10 +612,14 @@ static void ResetChunks(void) {
 		for (y = 0; y < World.Height; y += CHUNK_SIZE) {
 			for (x = 0; x < World.Width; x += CHUNK_SIZE) {
 				ChunkInfo_Reset(&mapChunks[index], x, y, z);
+				sortedChunks[index] = &mapChunks[index];
 				index++;
 			}
 		}
 	}
+	/* All chunks are listed again, so sort order needs recalculating */
+	sortedCount = chunksCount;
+	chunkPos    = IVec3_MaxValue();
 }
 
 static void DeleteChunks(void) {
@@ -474,13 +630,21 @@ static void DeleteChunks(void) {
 		DeleteChunk(&mapChunks[i]);
 	}
 	ResetPartCounts();
+	meshBytes = 0;
+}
+
+/* Fancy lighting has more than just sun and shadow colours, so still always bakes light into vertices */
+static void UpdateMeshColors(void) {
+	gpuLight = MapRenderer_CompactVertices && Gfx.SupportsChunkLightColors && Lighting_Mode == LIGHTING_MODE_CLASSIC;
+	Lighting_UpdateMeshCols(gpuLight);
 }
 
 void MapRenderer_Refresh(void) {
 	int oldCount;
 	chunkPos = IVec3_MaxValue();
+	UpdateMeshColors();
 
-	if (mapChunks && World.Blocks) {
+	if (mapChunks && World_HasBlocks()) {
 		DeleteChunks();
 		ResetChunks();
 
@@ -501,7 +665,7 @@ static void RefreshBorderChunks(int maxHeight) {
 	cc_bool onBorder;
 
 	chunkPos = IVec3_MaxValue();
-	if (!mapChunks || !World.Blocks) return;
+	if (!mapChunks || !World_HasBlocks()) return;
 
 	for (cz = 0; cz < World.ChunksZ; cz++) {
 		for (cy = 0; cy < World.ChunksY; cy++) {
@@ -520,8 +684,6 @@ static void RefreshBorderChunks(int maxHeight) {
 /*########################################################################################################################*
 *--------------------------------------------------Chunks updating/sorting------------------------------------------------*
 *#########################################################################################################################*/
-#define CHUNK_TARGET_TIME ((1.0f/30) + 0.01f)
-static int chunksTarget = 12;
 static Vec3 lastCamPos;
 static float lastYaw, lastPitch;
 /* Max distance from camera that chunks are rendered within */
@@ -537,57 +699,312 @@ static int AdjustDist(int dist) {
 	return (dist + 24) * (dist + 24);
 }
 
+/* Fog distance that renderDistSquared was last calculated with */
+static int lastFogDistance;
+
 static void CalcViewDists(void) {
+	int dist = Game_ViewDistance;
+	/* Chunks completely hidden by fog don't need to be drawn */
+	if (EnvRenderer_FogDistance) dist = min(dist, EnvRenderer_FogDistance);
+	lastFogDistance = EnvRenderer_FogDistance;
+
 	buildDistSquared  = AdjustDist(Game_UserViewDistance);
-	renderDistSquared = AdjustDist(Game_ViewDistance);
+	renderDistSquared = AdjustDist(dist);
+}
+
+/* Max time in microseconds that can be spent building chunk meshes each frame */
+static int buildBudget;
+/* Number of chunks built at once, before checking whether the time budget has been used up */
+#define BUILD_BATCH_SIZE 16
+/* Chunks that have been queued to have their meshes built this frame */
+static struct ChunkInfo* buildChunks[MAX_CHUNK_UPDATES];
+/* Chunks outside the view frustum that are queued for building if any time is left over */
+static struct ChunkInfo* deferredChunks[MAX_CHUNK_UPDATES];
+static int queuedCount, builtCount, deferredCount;
+static cc_uint64 buildBeg;
+static cc_bool buildBudgetUsed;
+/* Time budget and max chunks built for the current frame */
+static int frameBudget, frameMaxUpdates;
+
+/* Chunks are built with a much larger budget for a short while after a new map is loaded, */
+/*  so that the world fills in quickly rather than popping in over the following seconds */
+#define LOAD_BOOST_FRAMES 60
+#define LOAD_BOOST_SCALE  4
+static int loadBoostFrames;
+
+static struct ChunkStats statsHistory[CHUNKSTATS_HISTORY];
+static int statsIndex;
+struct ChunkStats* MapRenderer_CurStats = &statsHistory[0];
+cc_bool MapRenderer_ShowStats;
+
+void MapRenderer_GetStats(int frames, struct ChunkStats* total, struct ChunkStats* maximum) {
+	struct ChunkStats* cur;
+	int i;
+	Mem_Set(total,   0, sizeof(*total));
+	Mem_Set(maximum, 0, sizeof(*maximum));
+	frames = min(frames, CHUNKSTATS_HISTORY - 1);
+
+	/* Skip current frame, as its statistics are still incomplete */
+	for (i = 1; i <= frames; i++) {
+		cur = &statsHistory[(statsIndex - i + CHUNKSTATS_HISTORY) % CHUNKSTATS_HISTORY];
+		total->built       += cur->built;       maximum->built       = max(maximum->built,       cur->built);
+		total->vertices    += cur->vertices;    maximum->vertices    = max(maximum->vertices,    cur->vertices);
+		total->buildTime   += cur->buildTime;   maximum->buildTime   = max(maximum->buildTime,   cur->buildTime);
+		total->uploadBytes += cur->uploadBytes; maximum->uploadBytes = max(maximum->uploadBytes, cur->uploadBytes);
+		total->sortTime    += cur->sortTime;    maximum->sortTime    = max(maximum->sortTime,    cur->sortTime);
+		total->textureBinds += cur->textureBinds; maximum->textureBinds = max(maximum->textureBinds, cur->textureBinds);
+	}
+}
+
+void MapRenderer_GetBuildHistogram(int buckets[CHUNKSTATS_BUCKETS]) {
+	int i, j, limit;
+	for (j = 0; j < CHUNKSTATS_BUCKETS; j++) buckets[j] = 0;
+
+	for (i = 0; i < CHUNKSTATS_HISTORY; i++) {
+		if (i == statsIndex) continue;
+
+		for (j = 0, limit = 1000; j < CHUNKSTATS_BUCKETS - 1; j++, limit *= 2) {
+			if (statsHistory[i].buildTime < limit) break;
+		}
+		buckets[j]++;
+	}
+}
+
+/* Moves onto the statistics for the next frame */
+static void NextStatsFrame(void) {
+	statsIndex = (statsIndex + 1) % CHUNKSTATS_HISTORY;
+	MapRenderer_CurStats = &statsHistory[statsIndex];
+	Mem_Set(MapRenderer_CurStats, 0, sizeof(struct ChunkStats));
+}
+
+/* Builds the meshes of all chunks queued but not built yet */
+static void BuildQueuedChunks(void) {
+	int i, count = queuedCount - builtCount;
+	cc_uint64 beg;
+	if (!count) return;
+
+	beg = Stopwatch_Measure();
+	Builder_MakeChunks(&buildChunks[builtCount], count);
+	for (i = builtCount; i < queuedCount; i++) {
+		BuildChunk(buildChunks[i]);
+	}
+
+	builtCount      = queuedCount;
+	buildBudgetUsed = Stopwatch_ElapsedMicroseconds(buildBeg, Stopwatch_Measure()) >= frameBudget;
+
+	MapRenderer_CurStats->built     += count;
+	MapRenderer_CurStats->buildTime += (int)Stopwatch_ElapsedMicroseconds(beg, Stopwatch_Measure());
+}
+
+/* Queues the given chunk to have its mesh (hence vertex buffer) built this frame */
+static void QueueChunk(struct ChunkInfo* info) {
+	if (buildBudgetUsed || queuedCount >= frameMaxUpdates) return;
+	/* Near the mesh memory budget, only chunks the player can see are built */
+	if (meshBudget && meshBytes >= MESH_BUDGET_LOW && !info->visible) return;
+	DeleteChunk(info);
+
+	Game.ChunkUpdates++;
+	buildChunks[queuedCount++] = info;
+	if (queuedCount - builtCount >= BUILD_BATCH_SIZE) BuildQueuedChunks();
+}
+
+/* Chunks inside the view frustum are built first, then chunks outside it */
+static void QueueOrDeferChunk(struct ChunkInfo* info) {
+	if (info->visible) {
+		QueueChunk(info);
+	} else if (deferredCount < frameMaxUpdates) {
+		deferredChunks[deferredCount++] = info;
+	}
+}
+
+/* Whether chunks hidden behind other chunks are culled */
+static cc_bool occlusionCulling;
+
+static cc_bool ChunkInView(struct ChunkInfo* info) {
+	int dx = info->centreX - chunkPos.x, dy = info->centreY - chunkPos.y, dz = info->centreZ - chunkPos.z;
+	return dx * dx + dy * dy + dz * dz <= renderDistSquared &&
+		FrustumCulling_SphereInFrustum(info->centreX, info->centreY, info->centreZ, 14); /* 14 ~ sqrt(3 * 8^2) */
 }
 
-static int UpdateChunksAndVisibility(int* chunkUpdates) {
+/* Flood fills outwards from the chunk the camera is in, only moving from one chunk to the next */
+/*  through faces that can be seen from the face the chunk was entered through. Chunks that */
+/*  the flood fill never reaches can't be seen from the camera, so are marked as occluded. */
+/* NOTE: The flood fill never moves back towards the camera (e.g. +X then -X), as */
+/*  otherwise it would go around corners and reach chunks that are actually hidden */
+static void CalcOcclusion(void) {
+	struct ChunkInfo* info;
+	struct ChunkInfo* other;
+	int i, head = 0, tail = 0;
+	int cx, cy, cz, nx, ny, nz, face;
+	IVec3 pos;
+
+	IVec3_Floor(&pos, &Camera.CurrentPos);
+	cx = pos.x >> CHUNK_SHIFT; cy = pos.y >> CHUNK_SHIFT; cz = pos.z >> CHUNK_SHIFT;
+
+	/* Can't tell what is visible when looking at the map from outside of it */
+	if (!World_Contains(pos.x, pos.y, pos.z)) {
+		for (i = 0; i < chunksCount; i++) mapChunks[i].occluded = false;
+		return;
+	}
+	for (i = 0; i < chunksCount; i++) mapChunks[i].occluded = true;
+
+	i    = World_ChunkPack(cx, cy, cz);
+	info = &mapChunks[i];
+	info->occluded   = false;
+	info->enterFace  = FACE_COUNT;
+	info->travelDirs = 0;
+	occlusionQueue[tail++] = i;
+
+	while (head < tail) {
+		info = &mapChunks[occlusionQueue[head++]];
+		cx   = info->centreX >> CHUNK_SHIFT;
+		cy   = info->centreY >> CHUNK_SHIFT;
+		cz   = info->centreZ >> CHUNK_SHIFT;
+
+		for (face = 0; face < FACE_COUNT; face++) {
+			if (info->travelDirs & (1 << (face ^ 1))) continue;
+			if (info->enterFace != FACE_COUNT && !(info->connected[info->enterFace] & (1 << face))) continue;
+
+			nx = cx + faceOffsets[face][0];
+			ny = cy + faceOffsets[face][1];
+			nz = cz + faceOffsets[face][2];
+			if (nx < 0 || ny < 0 || nz < 0 || nx >= World.ChunksX || ny >= World.ChunksY || nz >= World.ChunksZ) continue;
+
+			i     = World_ChunkPack(nx, ny, nz);
+			other = &mapChunks[i];
+			if (!other->occluded || !ChunkInView(other)) continue;
+
+			other->occluded   = false;
+			other->enterFace  = face ^ 1;
+			other->travelDirs = info->travelDirs | (1 << face);
+			occlusionQueue[tail++] = i;
+		}
+	}
+}
+
+/* Classifies every group of chunks against the view frustum */
+/* Chunks in groups completely inside or outside the frustum then don't need to be tested individually */
+static void UpdateGroupCulling(void) {
+	int y, z, i = 0;
+	for (y = 0; y < groupsY; y++) {
+		for (z = 0; z < groupsZ; z++, i += groupsX) {
+			FrustumCulling_ClassifyRow(
+				(float)(CHUNK_GROUP_BLOCKS / 2),
+				(float)((y << CHUNK_GROUP_BLOCKS_SHIFT) + CHUNK_GROUP_BLOCKS / 2),
+				(float)((z << CHUNK_GROUP_BLOCKS_SHIFT) + CHUNK_GROUP_BLOCKS / 2),
+				(float)CHUNK_GROUP_BLOCKS, groupsX, CHUNK_GROUP_RADIUS, &groupCulling[i]);
+		}
+	}
+}
+
+static cc_bool ChunkInFrustum(struct ChunkInfo* info) {
+	int x = info->centreX >> CHUNK_GROUP_BLOCKS_SHIFT;
+	int y = info->centreY >> CHUNK_GROUP_BLOCKS_SHIFT;
+	int z = info->centreZ >> CHUNK_GROUP_BLOCKS_SHIFT;
+	int result = groupCulling[(y * groupsZ + z) * groupsX + x];
+
+	if (result != FRUSTUM_INTERSECTS) return result == FRUSTUM_INSIDE;
+	return FrustumCulling_SphereInFrustum(info->centreX, info->centreY, info->centreZ, 14); /* 14 ~ sqrt(3 * 8^2) */
+}
+
+/* Finishes removing empty chunks from sortedChunks, after the first 'count' chunks were compacted into 'kept' chunks */
+static void RemoveEmptyChunks(int count, int kept) {
+	int i;
+	/* Chunks may have been refreshed and added to the end of the list while in the loop */
+	for (i = count; i < sortedCount; i++, kept++) {
+		sortedChunks[kept] = sortedChunks[i];
+		distances[kept]    = distances[i];
+	}
+	sortedCount = kept;
+}
+
+/* When moving fast (e.g. flying with speed hacks), chunks around where the player will be soon are built early */
+/*  so that chunk building isn't outrun, which would otherwise leave holes in the direction of travel */
+#define PREDICT_SECONDS 1.5f
+/* Min speed in blocks per second for chunks to be predicted, which is well above walking speed */
+#define PREDICT_MIN_SPEED 10.0f
+static cc_bool predicting;
+static IVec3 predictPos;
+
+static void UpdatePrediction(void) {
+	/* Velocity is in blocks per tick */
+	Vec3 vel = Entities.CurPlayer->Base.Velocity;
+	Vec3_Mul1By(&vel, 20.0f);
+
+	predicting = Vec3_LengthSquared(&vel) >= PREDICT_MIN_SPEED * PREDICT_MIN_SPEED;
+	if (!predicting) return;
+
+	predictPos.x = (int)(Camera.CurrentPos.x + vel.x * PREDICT_SECONDS);
+	predictPos.y = (int)(Camera.CurrentPos.y + vel.y * PREDICT_SECONDS);
+	predictPos.z = (int)(Camera.CurrentPos.z + vel.z * PREDICT_SECONDS);
+}
+
+static int PredictedDistSquared(struct ChunkInfo* info) {
+	int dx = info->centreX - predictPos.x, dy = info->centreY - predictPos.y, dz = info->centreZ - predictPos.z;
+	return dx * dx + dy * dy + dz * dz;
+}
+
+static int UpdateChunksAndVisibility(void) {
 	int renderDistSqr = renderDistSquared;
 	int buildDistSqr  = buildDistSquared;
 
 	struct ChunkInfo* info;
-	int i, j = 0, distSqr;
+	int count = sortedCount;
+	int i, j = 0, k, distSqr, predSqr;
 	cc_bool noData;
 
-	for (i = 0; i < chunksCount; i++) {
+	if (occlusionCulling) CalcOcclusion();
+	UpdateGroupCulling();
+	UpdatePrediction();
+
+	for (i = 0, k = 0; i < count; i++) {
 		info = sortedChunks[i];
-		if (info->empty) continue;
+		/* Empty chunks stay empty until they are refreshed, which adds them back to the list */
+		if (info->empty) { info->listed = false; continue; }
 
 		distSqr = distances[i];
+		sortedChunks[k] = info;
+		distances[k]    = distSqr; k++;
 		noData  = info->noData;
+		predSqr = predicting ? PredictedDistSquared(info) : distSqr;
 		
 		/* Auto unload chunks far away chunks */
-		if (!noData && distSqr >= buildDistSqr + 32 * 16) {
+		if (!noData && distSqr >= buildDistSqr + 32 * 16 && predSqr >= buildDistSqr + 32 * 16) {
 			DeleteChunk(info); continue;
 		}
 		noData |= info->dirty;
 
-		if (noData && distSqr <= buildDistSqr && *chunkUpdates < chunksTarget) {
-			DeleteChunk(info);
-			BuildChunk(info, chunkUpdates);
+		info->visible = !info->occluded && distSqr <= renderDistSqr && ChunkInFrustum(info);
+		if (noData && min(distSqr, predSqr) <= buildDistSqr) {
+			/* Chunks ahead of the player will be needed soon, even when outside the view frustum */
+			if (predSqr < distSqr) { QueueChunk(info); } else { QueueOrDeferChunk(info); }
 		}
 
-		info->visible = distSqr <= renderDistSqr &&
-			FrustumCulling_SphereInFrustum(info->centreX, info->centreY, info->centreZ, 14); /* 14 ~ sqrt(3 * 8^2) */
 		if (info->visible && !info->empty) { renderChunks[j] = info; j++; }
 	}
+
+	RemoveEmptyChunks(count, k);
 	return j;
 }
 
-static int UpdateChunksStill(int* chunkUpdates) {
+static int UpdateChunksStill(void) {
 	int renderDistSqr = renderDistSquared;
 	int buildDistSqr  = buildDistSquared;
 
 	struct ChunkInfo* info;
-	int i, j = 0, distSqr;
+	int count = sortedCount;
+	int i, j = 0, k, distSqr;
 	cc_bool noData;
 
-	for (i = 0; i < chunksCount; i++) {
+	UpdateGroupCulling();
+	for (i = 0, k = 0; i < count; i++) {
 		info = sortedChunks[i];
-		if (info->empty) continue;
+		/* Empty chunks stay empty until they are refreshed, which adds them back to the list */
+		if (info->empty) { info->listed = false; continue; }
 
 		distSqr = distances[i];
+		sortedChunks[k] = info;
+		distances[k]    = distSqr; k++;
 		noData  = info->noData;
 
 		/* Auto unload chunks far away chunks */
@@ -596,62 +1013,121 @@ static int UpdateChunksStill(int* chunkUpdates) {
 		}
 		noData |= info->dirty;
 
-		if (noData && distSqr <= buildDistSqr && *chunkUpdates < chunksTarget) {
-			DeleteChunk(info);
-			BuildChunk(info, chunkUpdates);
-
+		if (noData && distSqr <= buildDistSqr) {
 			/* only need to update the visibility of chunks in range. */
-			info->visible = distSqr <= renderDistSqr &&
-				FrustumCulling_SphereInFrustum(info->centreX, info->centreY, info->centreZ, 14); /* 14 ~ sqrt(3 * 8^2) */
-			if (info->visible && !info->empty) { renderChunks[j] = info; j++; }
-		} else if (info->visible) {
-			renderChunks[j] = info; j++;
+			info->visible = !info->occluded && distSqr <= renderDistSqr && ChunkInFrustum(info);
+			QueueOrDeferChunk(info);
 		}
+		if (info->visible && !info->empty) { renderChunks[j] = info; j++; }
 	}
+
+	RemoveEmptyChunks(count, k);
 	return j;
 }
 
+/* Builds the meshes of all chunks queued this frame */
+static void BuildChunks(void) {
+	struct ChunkInfo* info;
+	int i, j = 0;
+
+	for (i = 0; i < deferredCount; i++) {
+		QueueChunk(deferredChunks[i]);
+	}
+	BuildQueuedChunks();
+
+	/* Chunks are added to render list before their mesh is built, so remove any that turned out to be empty */
+	for (i = 0; i < renderChunksCount; i++) {
+		info = renderChunks[i];
+		if (!info->empty) { renderChunks[j] = info; j++; }
+	}
+	renderChunksCount = j;
+}
+
+/* Whether other views have overwritten the occlusion of chunks since the last MapRenderer_Update */
+static cc_bool otherViewsOccluded;
+
 static void UpdateChunks(float delta) {
 	struct LocalPlayer* p;
 	cc_bool samePos;
-	int chunkUpdates = 0;
-
-	/* Build more chunks if 30 FPS or over, otherwise slowdown */
-	chunksTarget += delta < CHUNK_TARGET_TIME ? 1 : -1; 
-	Math_Clamp(chunksTarget, 4, maxChunkUpdates);
+	/* Rebuilt chunks may have changed which chunks are occluded */
+	cc_bool rebuilt = (occlusionCulling && queuedCount) || otherViewsOccluded;
+	otherViewsOccluded = false;
+
+	queuedCount   = 0;
+	builtCount    = 0;
+	deferredCount = 0;
+	buildBeg      = Stopwatch_Measure();
+	buildBudgetUsed = false;
+
+	if (loadBoostFrames > 0) {
+		loadBoostFrames--;
+		frameBudget     = buildBudget * LOAD_BOOST_SCALE;
+		frameMaxUpdates = MAX_CHUNK_UPDATES;
+	} else {
+		frameBudget     = buildBudget;
+		frameMaxUpdates = maxChunkUpdates;
+	}
 
 	p = Entities.CurPlayer;
 	samePos = Vec3_Equals(&Camera.CurrentPos, &lastCamPos)
-		&& p->Base.Pitch == lastPitch && p->Base.Yaw == lastYaw;
+		&& p->Base.Pitch == lastPitch && p->Base.Yaw == lastYaw && !rebuilt;
 
 	renderChunksCount = samePos ?
-		UpdateChunksStill(&chunkUpdates) :
-		UpdateChunksAndVisibility(&chunkUpdates);
+		UpdateChunksStill() :
+		UpdateChunksAndVisibility();
+	BuildChunks();
+	if (meshBudget && meshBytes > meshBudget) EvictMeshes(MESH_BUDGET_LOW);
 
 	lastCamPos = Camera.CurrentPos;
 	lastPitch  = p->Base.Pitch;
 	lastYaw    = p->Base.Yaw;
 
-	if (!samePos || chunkUpdates) ResetPartFlags();
+	if (!samePos || queuedCount) ResetPartFlags();
 }
 
-static void SortMapChunks(int left, int right) {
-	struct ChunkInfo** values = sortedChunks; struct ChunkInfo* value;
-	cc_uint32* keys = distances; cc_uint32 key;
+/* Sorts sortedChunks by distance, using a least significant digit radix sort on the distances */
+/* This is linear in the number of chunks, unlike quicksort which caused a spike on large maps */
+static void SortMapChunks(void) {
+	static int counts[4][256];
+	struct ChunkInfo** srcChunks = sortedChunks;
+	struct ChunkInfo** dstChunks = sortTempChunks;
+	struct ChunkInfo** tmpChunks;
+	cc_uint32* srcKeys = distances;
+	cc_uint32* dstKeys = sortTempDistances;
+	cc_uint32* tmpKeys;
+	cc_uint32 key;
+	int i, pass, shift, sum, count;
+
+	Mem_Set(counts, 0, sizeof(counts));
+	for (i = 0; i < sortedCount; i++) {
+		key = srcKeys[i];
+		counts[0][key & 0xFF]++;         counts[1][(key >> 8) & 0xFF]++;
+		counts[2][(key >> 16) & 0xFF]++; counts[3][key >> 24]++;
+	}
+
+	for (pass = 0, shift = 0; pass < 4; pass++, shift += 8) {
+		/* Skip the pass when all chunks have the same digit, e.g. the upper bytes on smaller maps */
+		if (counts[pass][(srcKeys[0] >> shift) & 0xFF] == sortedCount) continue;
 
-	while (left < right) {
-		int i = left, j = right;
-		cc_uint32 pivot = keys[(i + j) >> 1];
+		for (i = 0, sum = 0; i < 256; i++) {
+			count = counts[pass][i];
+			counts[pass][i] = sum; sum += count;
+		}
 
-		/* partition the list */
-		while (i <= j) {
-			while (pivot > keys[i]) i++;
-			while (pivot < keys[j]) j--;
-			QuickSort_Swap_KV_Maybe();
+		for (i = 0; i < sortedCount; i++) {
+			key   = srcKeys[i];
+			count = counts[pass][(key >> shift) & 0xFF]++;
+			dstKeys[count]   = key;
+			dstChunks[count] = srcChunks[i];
 		}
-		/* recurse into the smaller subset */
-		QuickSort_Recurse(SortMapChunks)
+
+		tmpKeys   = srcKeys;   srcKeys   = dstKeys;   dstKeys   = tmpKeys;
+		tmpChunks = srcChunks; srcChunks = dstChunks; dstChunks = tmpChunks;
 	}
+
+	/* Sorted results may have ended up in the scratch arrays */
+	distances    = srcKeys;   sortTempDistances = dstKeys;
+	sortedChunks = srcChunks; sortTempChunks    = dstChunks;
 }
 
 static void UpdateSortOrder(void) {
@@ -668,9 +1144,9 @@ static void UpdateSortOrder(void) {
 	/* If in same chunk, don't need to recalculate sort order */
 	if (pos.x == chunkPos.x && pos.y == chunkPos.y && pos.z == chunkPos.z) return;
 	chunkPos = pos;
-	if (!chunksCount) return;
+	if (!sortedCount) return;
 
-	for (i = 0; i < chunksCount; i++) {
+	for (i = 0; i < sortedCount; i++) {
 		info = sortedChunks[i];
 		/* Calculate distance to chunk centre */
 		dx = info->centreX - pos.x; dy = info->centreY - pos.y; dz = info->centreZ - pos.z;
@@ -689,15 +1165,327 @@ static void UpdateSortOrder(void) {
 		info->drawYMin = dy >= 0; info->drawYMax = dy <= 0;
 	}
 
-	SortMapChunks(0, chunksCount - 1);
+	SortMapChunks();
 	ResetPartFlags();
-	/*SimpleOcclusionCulling();*/
 }
 
 void MapRenderer_Update(float delta) {
+	cc_uint64 beg;
+	NextStatsFrame();
 	if (!mapChunks) return;
+	Tracer_Begin("MapRenderer_Update");
+
+	/* Fog density can change every frame, e.g. when going underwater */
+	if (EnvRenderer_FogDistance != lastFogDistance) {
+		lastCamPos = Vec3_BigPos();
+		CalcViewDists();
+	}
+
+	beg = Stopwatch_Measure();
 	UpdateSortOrder();
+	MapRenderer_CurStats->sortTime = (int)Stopwatch_ElapsedMicroseconds(beg, Stopwatch_Measure());
 	UpdateChunks(delta);
+	Tracer_End();
+}
+
+void MapRenderer_UpdateView(void) {
+	struct ChunkInfo* info;
+	IVec3 mainPos = chunkPos;
+	cc_bool samePos;
+	int i, j = 0;
+	if (!mapChunks) return;
+
+	/* The sort order and flood fill only depend on which chunk the camera is in, */
+	/*  so e.g. both views of anaglyph 3D can reuse those from the main view */
+	UpdateSortOrder();
+	samePos = chunkPos.x == mainPos.x && chunkPos.y == mainPos.y && chunkPos.z == mainPos.z;
+
+	if (occlusionCulling && !samePos) {
+		CalcOcclusion();
+		otherViewsOccluded = true;
+	}
+	UpdateGroupCulling();
+
+	for (i = 0; i < sortedCount; i++) {
+		info = sortedChunks[i];
+		if (info->empty || info->occluded || distances[i] > renderDistSquared) continue;
+		if (ChunkInFrustum(info)) { renderChunks[j] = info; j++; }
+	}
+
+	renderChunksCount = j;
+	ResetPartFlags();
+}
+
+
+/*########################################################################################################################*
+*-----------------------------------------------------Distant terrain-----------------------------------------------------*
+*#########################################################################################################################*/
+/* Past the view distance, terrain is drawn as coarse coloured top faces only. */
+/* Each chunk column is split into cells of 4x4 columns of blocks, and each cell is drawn */
+/*  as one quad at the top of the highest block in it. Chunk columns are grouped into */
+/*  regions of 4x4 chunk columns, with all the cells of a region in one vertex buffer. */
+#define LOD_CELL_SIZE 4
+#define LOD_REGION_SIZE 4
+#define LOD_REGION_COLUMNS (LOD_REGION_SIZE * LOD_REGION_SIZE)
+#define LOD_REGION_BLOCKS  (LOD_REGION_SIZE * CHUNK_SIZE)
+#define LOD_MAX_VERTICES (LOD_REGION_COLUMNS * (CHUNK_SIZE / LOD_CELL_SIZE) * (CHUNK_SIZE / LOD_CELL_SIZE) * 4)
+#define LOD_MAX_TILES (ATLAS2D_TILES_PER_ROW * ATLAS2D_MAX_ROWS_COUNT)
+/* Max number of regions rebuilt each frame */
+#define LOD_MAX_UPDATES 2
+
+struct LodRegion {
+	GfxResourceID vb;
+	cc_bool dirty;
+	/* Offset of the first vertex of each chunk column in the vertex buffer */
+	cc_uint16 offsets[LOD_REGION_COLUMNS + 1];
+	/* Y of the highest block in each chunk column, or -1 if the column is empty */
+	cc_int16 heights[LOD_REGION_COLUMNS];
+};
+
+int MapRenderer_LodDistance;
+static struct LodRegion* lodRegions;
+static int lodRegionsX, lodRegionsZ, lodDistSquared;
+static struct VertexColoured lodVertices[LOD_MAX_VERTICES];
+/* Average colour of each tile in the terrain atlas, calculated on demand */
+static PackedCol lodTileCols[LOD_MAX_TILES];
+static cc_bool lodTileColsValid[LOD_MAX_TILES];
+
+static PackedCol Lod_TileColor(TextureLoc loc) {
+	struct Bitmap* bmp = &Atlas2D.Bmp;
+	int size = Atlas2D.TileSize;
+	int x1   = Atlas2D_TileX(loc) * size, y1 = Atlas2D_TileY(loc) * size;
+	int x, y, r = 0, g = 0, b = 0, count = 0;
+	BitmapCol* row;
+	BitmapCol col;
+
+	if (lodTileColsValid[loc]) return lodTileCols[loc];
+	lodTileColsValid[loc] = true;
+	lodTileCols[loc]      = PACKEDCOL_WHITE;
+	if (!bmp->scan0 || y1 + size > bmp->height) return lodTileCols[loc];
+
+	for (y = y1; y < y1 + size; y++) {
+		row = Bitmap_GetRow(bmp, y);
+		for (x = x1; x < x1 + size; x++) {
+			col = row[x];
+			/* Transparent pixels (e.g. gaps in leaves) aren't seen */
+			if (BitmapCol_A(col) < 128) continue;
+			r += BitmapCol_R(col); g += BitmapCol_G(col); b += BitmapCol_B(col);
+			count++;
+		}
+	}
+
+	if (count) lodTileCols[loc] = PackedCol_Make(r / count, g / count, b / count, 255);
+	return lodTileCols[loc];
+}
+
+/* Returns the Y of the highest visible non-sprite block in the column above minY, or -1 if none */
+static int Lod_TopBlock(int x, int z, int minY, BlockID* block) {
+	int y;
+	for (y = World.MaxY; y > minY; y--) {
+		*block = World_GetBlock(x, y, z);
+		if (Blocks.Draw[*block] != DRAW_GAS && Blocks.Draw[*block] != DRAW_SPRITE) return y;
+	}
+	return -1;
+}
+
+/* Outputs the quads for all the cells in the given chunk column, returning the number of vertices */
+static int Lod_BuildColumn(struct VertexColoured* v, int x1, int z1, cc_int16* height) {
+	int xMax = min(World.Width,  x1 + CHUNK_SIZE);
+	int zMax = min(World.Length, z1 + CHUNK_SIZE);
+	int cellX, cellZ, x, z, x2, z2, y, top, count = 0;
+	BlockID block = BLOCK_AIR, cur;
+	PackedCol col;
+	float y2;
+
+	*height = -1;
+	for (cellZ = z1; cellZ < zMax; cellZ += LOD_CELL_SIZE) {
+		for (cellX = x1; cellX < xMax; cellX += LOD_CELL_SIZE) {
+			x2  = min(xMax, cellX + LOD_CELL_SIZE);
+			z2  = min(zMax, cellZ + LOD_CELL_SIZE);
+			top = -1;
+
+			for (z = cellZ; z < z2; z++) {
+				for (x = cellX; x < x2; x++) {
+					y = Lod_TopBlock(x, z, top, &cur);
+					if (y > top) { top = y; block = cur; }
+				}
+			}
+			if (top < 0) continue;
+			*height = max(*height, top);
+
+			col = PackedCol_Tint(Lod_TileColor(Block_Tex(block, FACE_YMAX)), Env.SunCol);
+			if (Blocks.Tinted[block]) col = PackedCol_Tint(col, Blocks.FogCol[block]);
+			y2  = top + Blocks.MaxBB[block].y;
+
+			v->x = (float)x2;    v->y = y2; v->z = (float)cellZ; v->Col = col; v++;
+			v->x = (float)cellX; v->y = y2; v->z = (float)cellZ; v->Col = col; v++;
+			v->x = (float)cellX; v->y = y2; v->z = (float)z2;    v->Col = col; v++;
+			v->x = (float)x2;    v->y = y2; v->z = (float)z2;    v->Col = col; v++;
+			count += 4;
+		}
+	}
+	return count;
+}
+
+static void Lod_BuildRegion(struct LodRegion* region, int rx, int rz) {
+	int cx, cz, i = 0, count = 0;
+	void* data;
+	region->dirty = false;
+
+	for (cz = 0; cz < LOD_REGION_SIZE; cz++) {
+		for (cx = 0; cx < LOD_REGION_SIZE; cx++, i++) {
+			region->offsets[i] = count;
+			count += Lod_BuildColumn(&lodVertices[count], (rx * LOD_REGION_SIZE + cx) * CHUNK_SIZE,
+									 (rz * LOD_REGION_SIZE + cz) * CHUNK_SIZE, &region->heights[i]);
+		}
+	}
+	region->offsets[i] = count;
+
+	if (!count) { Gfx_DeleteVb(&region->vb); return; }
+	data = Gfx_RecreateAndLockVb(&region->vb, VERTEX_FORMAT_COLOURED, count);
+	Mem_Copy(data, lodVertices, count * SIZEOF_VERTEX_COLOURED);
+	Gfx_UnlockVb(region->vb);
+}
+
+static void Lod_MarkAllDirty(void) {
+	int i;
+	for (i = 0; i < lodRegionsX * lodRegionsZ; i++) lodRegions[i].dirty = true;
+}
+
+static void Lod_InvalidateColors(void) {
+	Mem_Set(lodTileColsValid, 0, sizeof(lodTileColsValid));
+	Lod_MarkAllDirty();
+}
+
+/* Marks the region containing the given block as needing rebuilding, if the change can affect it */
+static void Lod_OnBlockChanged(int x, int y, int z) {
+	struct LodRegion* region;
+	int cx = x >> CHUNK_SHIFT, cz = z >> CHUNK_SHIFT;
+	if (!lodRegions) return;
+
+	region = &lodRegions[(cz / LOD_REGION_SIZE) * lodRegionsX + (cx / LOD_REGION_SIZE)];
+	/* Changes below the surface of the column are hidden anyways */
+	if (y >= region->heights[(cz % LOD_REGION_SIZE) * LOD_REGION_SIZE + (cx % LOD_REGION_SIZE)]) {
+		region->dirty = true;
+	}
+}
+
+/* Marks all regions overlapping the given columns as needing rebuilding */
+static void Lod_OnRegionChanged(int x1, int z1, int x2, int z2) {
+	int rx, rz;
+	if (!lodRegions) return;
+
+	for (rz = z1 / LOD_REGION_BLOCKS; rz <= z2 / LOD_REGION_BLOCKS; rz++) {
+		for (rx = x1 / LOD_REGION_BLOCKS; rx <= x2 / LOD_REGION_BLOCKS; rx++) {
+			lodRegions[rz * lodRegionsX + rx].dirty = true;
+		}
+	}
+}
+
+static void Lod_DeleteRegions(void) {
+	int i;
+	for (i = 0; i < lodRegionsX * lodRegionsZ; i++) {
+		Gfx_DeleteVb(&lodRegions[i].vb);
+		lodRegions[i].dirty = true;
+	}
+}
+
+static void Lod_FreeRegions(void) {
+	if (!lodRegions) return;
+	Lod_DeleteRegions();
+	Mem_Free(lodRegions);
+
+	lodRegions  = NULL;
+	lodRegionsX = 0;
+	lodRegionsZ = 0;
+}
+
+static void Lod_AllocRegions(void) {
+	int i;
+	if (!MapRenderer_LodDistance || !World.ChunksCount) return;
+
+	lodRegionsX = (World.ChunksX + LOD_REGION_SIZE - 1) / LOD_REGION_SIZE;
+	lodRegionsZ = (World.ChunksZ + LOD_REGION_SIZE - 1) / LOD_REGION_SIZE;
+	lodRegions  = (struct LodRegion*)Mem_AllocCleared(lodRegionsX * lodRegionsZ, sizeof(struct LodRegion), "LOD regions");
+	for (i = 0; i < lodRegionsX * lodRegionsZ; i++) lodRegions[i].dirty = true;
+}
+
+/* Fog distance that lodDistSquared was last calculated with */
+static int lodFogDistance;
+
+static void Lod_CalcDist(void) {
+	int dist = Game_ViewDistance + MapRenderer_LodDistance;
+	if (EnvRenderer_FogDistance) dist = min(dist, EnvRenderer_FogDistance);
+	lodFogDistance = EnvRenderer_FogDistance;
+	lodDistSquared = MapRenderer_LodDistance ? AdjustDist(dist) : 0;
+}
+
+static void Lod_UpdateRegions(void) {
+	int rx, rz, updates = 0;
+	for (rz = 0; rz < lodRegionsZ; rz++) {
+		for (rx = 0; rx < lodRegionsX; rx++) {
+			if (!lodRegions[rz * lodRegionsX + rx].dirty) continue;
+
+			Lod_BuildRegion(&lodRegions[rz * lodRegionsX + rx], rx, rz);
+			if (++updates >= LOD_MAX_UPDATES) return;
+		}
+	}
+}
+
+/* Draws the chunk columns of the region whose surface is too far away to be drawn in full detail */
+/*  (consecutive chunk columns in the vertex buffer are drawn at once) */
+static void Lod_RenderRegion(struct LodRegion* region, int rx, int rz) {
+	int i, cx, cz, dx, dy, dz, dist, start = 0, count = 0;
+
+	for (i = 0; i < LOD_REGION_COLUMNS; i++) {
+		cx = rx * LOD_REGION_SIZE + (i % LOD_REGION_SIZE);
+		cz = rz * LOD_REGION_SIZE + (i / LOD_REGION_SIZE);
+		
+		dx   = cx * CHUNK_SIZE + HALF_CHUNK_SIZE - chunkPos.x;
+		dy   = (region->heights[i] & ~CHUNK_MASK) + HALF_CHUNK_SIZE - chunkPos.y;
+		dz   = cz * CHUNK_SIZE + HALF_CHUNK_SIZE - chunkPos.z;
+		dist = dx * dx + dy * dy + dz * dz;
+
+		if (region->heights[i] >= 0 && dist > renderDistSquared && dist <= lodDistSquared) {
+			if (!count) start = region->offsets[i];
+			count += region->offsets[i + 1] - region->offsets[i];
+		} else if (count) {
+			Gfx_DrawVb_IndexedTris_Range(count, start);
+			Game_Vertices += count; count = 0;
+		}
+	}
+
+	if (count) {
+		Gfx_DrawVb_IndexedTris_Range(count, start);
+		Game_Vertices += count;
+	}
+}
+
+void MapRenderer_RenderDistant(float delta) {
+	struct LodRegion* region;
+	float halfHeight, radius;
+	int rx, rz;
+	if (!lodRegions || !mapChunks) return;
+
+	if (EnvRenderer_FogDistance != lodFogDistance) Lod_CalcDist();
+	Lod_UpdateRegions();
+	halfHeight = World.Height * 0.5f;
+	radius     = Math_SqrtF(LOD_REGION_BLOCKS * LOD_REGION_BLOCKS * 0.5f + halfHeight * halfHeight);
+
+	Gfx_SetVertexFormat(VERTEX_FORMAT_COLOURED);
+	Gfx_SetFaceCulling(true);
+	for (rz = 0; rz < lodRegionsZ; rz++) {
+		for (rx = 0; rx < lodRegionsX; rx++) {
+			region = &lodRegions[rz * lodRegionsX + rx];
+			if (!region->vb) continue;
+
+			if (!FrustumCulling_SphereInFrustum((rx + 0.5f) * LOD_REGION_BLOCKS, halfHeight,
+												(rz + 0.5f) * LOD_REGION_BLOCKS, radius)) continue;
+			Gfx_BindVb(region->vb);
+			Lod_RenderRegion(region, rx, rz);
+		}
+	}
+	Gfx_SetFaceCulling(false);
 }
 
 
@@ -712,21 +1500,122 @@ void MapRenderer_RefreshChunk(int cx, int cy, int cz) {
 	if (info->allAir) return; /* do not recreate chunks completely air */
 	info->empty = false;
 	info->dirty = true;
+
+	if (info->listed) return;
+	info->listed = true;
+	sortedChunks[sortedCount] = info;
+	distances[sortedCount]    = 0;
+	sortedCount++;
+	/* Position in sort order is unknown */
+	chunkPos = IVec3_MaxValue();
 }
 
-void MapRenderer_OnBlockChanged(int x, int y, int z, BlockID block) {
+/* Chunks keep drawing their old mesh while dirty, so this doesn't cause a visible gap while they are rebuilt */
+void MapRenderer_RefreshAll(void) {
+	struct ChunkInfo* info;
+	int i;
+	chunkPos = IVec3_MaxValue();
+	UpdateMeshColors();
+	if (!mapChunks || !World_HasBlocks()) return;
+
+	for (i = 0; i < chunksCount; i++) {
+		info = &mapChunks[i];
+		/* Chunks without a mesh will be built anyways, and empty chunks stay empty */
+		if (info->noData) continue;
+		info->dirty = true;
+	}
+}
+
+/* Whether two blocks affect the lighting/shading of surrounding faces identically */
+static cc_bool SameLighting(BlockID a, BlockID b) {
+	return Blocks.Draw[a] == Blocks.Draw[b] && Blocks.FullOpaque[a] == Blocks.FullOpaque[b]
+		&& Blocks.BlocksLight[a] == Blocks.BlocksLight[b] && Blocks.LightOffset[a] == Blocks.LightOffset[b]
+		&& Blocks.Brightness[a] == Blocks.Brightness[b];
+}
+
+/* Works out which chunks actually need to be rebuilt after a block change. */
+/* Rather than always rebuilding the chunk and any neighbours on a boundary, only */
+/*  rebuilds chunks where a face of the changed block or of a neighbour touching it */
+/*  changes visibility, or where the change can affect the lighting of nearby faces. */
+/* (e.g. replacing a stone block buried inside terrain rebuilds nothing at all) */
+void MapRenderer_OnBlockChanged(int x, int y, int z, BlockID old, BlockID now) {
 	int cx = x >> CHUNK_SHIFT, cy = y >> CHUNK_SHIFT, cz = z >> CHUNK_SHIFT;
+	int nx, ny, nz, face, opposite;
+	cc_bool sameLight, changed, refreshSelf;
 	struct ChunkInfo* chunk;
+	BlockID other;
 
 	chunk = &mapChunks[World_ChunkPack(cx, cy, cz)];
-	chunk->allAir &= Blocks.Draw[block] == DRAW_GAS;
+	chunk->allAir &= Blocks.Draw[now] == DRAW_GAS;
+	if (old == now) return;
+	Lod_OnBlockChanged(x, y, z);
+
+	sameLight   = SameLighting(old, now);
+	refreshSelf = !sameLight;
+
+	for (face = 0; face < FACE_COUNT; face++) {
+		nx = x + faceOffsets[face][0];
+		ny = y + faceOffsets[face][1];
+		nz = z + faceOffsets[face][2];
+
+		/* Faces on the map borders are always treated as visible */
+		if (!World_Contains(nx, ny, nz)) { refreshSelf = true; continue; }
+		other    = World_GetBlock(nx, ny, nz);
+		opposite = face ^ 1;
+
+		if (!Block_IsFaceHidden(old, other, face) || !Block_IsFaceHidden(now, other, face)) {
+			refreshSelf = true;
+		}
+
+		if (sameLight) {
+			changed = !Block_IsFaceHidden(other, old, opposite) != !Block_IsFaceHidden(other, now, opposite);
+		} else {
+			changed = Blocks.Draw[other] != DRAW_GAS;
+		}
+		if (!changed) continue;
+
+		if ((nx >> CHUNK_SHIFT) == cx && (ny >> CHUNK_SHIFT) == cy && (nz >> CHUNK_SHIFT) == cz) {
+			refreshSelf = true;
+		} else {
+			MapRenderer_RefreshChunk(nx >> CHUNK_SHIFT, ny >> CHUNK_SHIFT, nz >> CHUNK_SHIFT);
+		}
+	}
+
 	/* TODO: Don't lookup twice, refresh directly using chunk pointer */
-	MapRenderer_RefreshChunk(cx, cy, cz);
+	if (refreshSelf) MapRenderer_RefreshChunk(cx, cy, cz);
+}
+
+void MapRenderer_OnRegionChanged(int x1, int y1, int z1, int x2, int y2, int z2) {
+	int cx, cy, cz;
+	if (!mapChunks) return;
+
+	/* Chunks containing changed blocks may no longer be completely air */
+	for (cy = y1 >> CHUNK_SHIFT; cy <= (y2 >> CHUNK_SHIFT); cy++)
+		for (cz = z1 >> CHUNK_SHIFT; cz <= (z2 >> CHUNK_SHIFT); cz++)
+			for (cx = x1 >> CHUNK_SHIFT; cx <= (x2 >> CHUNK_SHIFT); cx++)
+			{
+				mapChunks[World_ChunkPack(cx, cy, cz)].allAir = false;
+			}
+	Lod_OnRegionChanged(x1, z1, x2, z2);
+
+	/* Faces of blocks just outside the region may have been hidden or exposed too */
+	x1 = max(x1 - 1, 0); x2 = min(x2 + 1, World.MaxX);
+	y1 = max(y1 - 1, 0); y2 = min(y2 + 1, World.MaxY);
+	z1 = max(z1 - 1, 0); z2 = min(z2 + 1, World.MaxZ);
+
+	for (cy = y1 >> CHUNK_SHIFT; cy <= (y2 >> CHUNK_SHIFT); cy++)
+		for (cz = z1 >> CHUNK_SHIFT; cz <= (z2 >> CHUNK_SHIFT); cz++)
+			for (cx = x1 >> CHUNK_SHIFT; cx <= (x2 >> CHUNK_SHIFT); cx++)
+			{
+				MapRenderer_RefreshChunk(cx, cy, cz);
+			}
 }
 
 static void OnEnvVariableChanged(void* obj, int envVar) {
 	if (envVar == ENV_VAR_SUN_COLOR || envVar == ENV_VAR_SHADOW_COLOR) {
-		MapRenderer_Refresh();
+		/* Chunk meshes don't need to be rebuilt when the GPU applies the new colours */
+		if (!gpuLight) MapRenderer_Refresh();
+		Lod_MarkAllDirty();
 	} else if (envVar == ENV_VAR_EDGE_HEIGHT || envVar == ENV_VAR_SIDES_OFFSET) {
 		int oldClip        = Builder_EdgeLevel;
 		Builder_SidesLevel = max(0, Env_SidesHeight);
@@ -739,27 +1628,39 @@ static void OnEnvVariableChanged(void* obj, int envVar) {
 
 static void OnTerrainAtlasChanged(void* obj) {
 	static int tilesPerAtlas;
+	static cc_bool textureArray;
+	/* Compact vertices can't represent texture coordinates past the bottom of the 1D atlas */
+	MapRenderer_CompactVertices = compactVertices && Gfx.SupportsChunkVertices && Atlas1D.TilesPerAtlas > 1;
+	/* Compact vertices are always drawn using a texture array when the backend supports them */
+	if (Gfx.SupportsTextureArrays && !Atlas1D.ArrayTexId) MapRenderer_CompactVertices = false;
+	MapRenderer_TextureArray = MapRenderer_CompactVertices && Atlas1D.ArrayTexId;
+	UpdateMeshColors();
+
 	/* e.g. If old atlas was 256x256 and new is 256x256, don't need to refresh */
-	if (MapRenderer_1DUsedCount && tilesPerAtlas != Atlas1D.TilesPerAtlas) {
+	if (MapRenderer_1DUsedCount && (tilesPerAtlas != Atlas1D.TilesPerAtlas || textureArray != MapRenderer_TextureArray)) {
 		MapRenderer_Refresh();
 	}
+	textureArray = MapRenderer_TextureArray;
 
 	MapRenderer_1DUsedCount = MapRenderer_UsedAtlases();
 	tilesPerAtlas = Atlas1D.TilesPerAtlas;
 	ResetPartFlags();
+	Lod_InvalidateColors();
 }
 
 static void OnBlockDefinitionChanged(void* obj) {
 	MapRenderer_Refresh();
 	MapRenderer_1DUsedCount = MapRenderer_UsedAtlases();
 	ResetPartFlags();
+	Lod_MarkAllDirty();
 }
 
 static void OnVisibilityChanged(void* obj) {
 	lastCamPos = Vec3_BigPos();
 	CalcViewDists();
+	Lod_CalcDist();
 }
-static void DeleteChunks_(void* obj) { DeleteChunks(); }
+static void DeleteChunks_(void* obj) { DeleteChunks(); Lod_DeleteRegions(); }
 static void Refresh_(void* obj)      { MapRenderer_Refresh(); }
 
 static void OnNewMap(void) {
@@ -770,6 +1671,7 @@ static void OnNewMap(void) {
 	chunkPos = IVec3_MaxValue();
 	FreeChunks();
 	FreeParts();
+	Lod_FreeRegions();
 }
 
 static void OnNewMapLoaded(void) {
@@ -784,7 +1686,10 @@ static void OnNewMapLoaded(void) {
 	/*}*/
 
 	InitChunks();
+	UpdateMeshColors();
+	Lod_AllocRegions();
 	lastCamPos = Vec3_BigPos();
+	loadBoostFrames = LOAD_BOOST_FRAMES;
 }
 
 static void OnInit(void) {
@@ -800,8 +1705,14 @@ static void OnInit(void) {
 	/* This = 87 fixes map being invisible when no textures */
 	MapRenderer_1DUsedCount = 87; /* Atlas1D_UsedAtlasesCount(); */
 	chunkPos   = IVec3_MaxValue();
-	maxChunkUpdates = Options_GetInt(OPT_MAX_CHUNK_UPDATES, 4, 1024, 30);
+	maxChunkUpdates = Options_GetInt(OPT_MAX_CHUNK_UPDATES, 4, MAX_CHUNK_UPDATES, 30);
+	buildBudget     = Options_GetInt(OPT_CHUNK_BUILD_TIME,  1, 100, 6) * 1000;
+	meshBudget      = (cc_uint64)Options_GetInt(OPT_CHUNK_MESH_MEMORY, 0, 65536, 0) * 1024 * 1024;
+	occlusionCulling = Options_GetBool(OPT_OCCLUSION_CULLING, true);
+	compactVertices  = Options_GetBool(OPT_COMPACT_VERTICES,  true);
+	MapRenderer_LodDistance = Options_GetInt(OPT_LOD_DISTANCE, 0, 4096, 0);
 	CalcViewDists();
+	Lod_CalcDist();
 }
 
 struct IGameComponent MapRenderer_Component = {
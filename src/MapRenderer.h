@@ -14,6 +14,12 @@ extern struct IGameComponent MapRenderer_Component;
 
 /* Max used 1D atlases. (i.e. Atlas1D_Index(maxTextureLoc) + 1) */
 extern int MapRenderer_1DUsedCount;
+/* Whether chunk meshes use the compact VERTEX_FORMAT_CHUNK vertex format */
+extern cc_bool MapRenderer_CompactVertices;
+/* Whether chunk meshes are drawn in one batch using Atlas1D.ArrayTexId, instead of one batch per 1D atlas */
+extern cc_bool MapRenderer_TextureArray;
+/* Extra distance past the view distance that coarse distant terrain is drawn within (0 = disabled) */
+extern int MapRenderer_LodDistance;
 
 /* Buffer for all chunk parts. There are (MapRenderer_ChunksCount * Atlas1D_Count) parts in the buffer,
 with parts for 'normal' buffer being in lower half. */
@@ -41,6 +47,8 @@ struct ChunkInfo {
 	cc_uint8 dirty : 1;   /* Whether chunk is pending being rebuilt */
 	cc_uint8 allAir : 1;  /* Whether chunk is completely air */
 	cc_uint8 noData : 1;  /* Whether the chunk is currently empty of data, but may have data if built */
+	cc_uint8 occluded : 1; /* Whether chunk is hidden from the camera behind other chunks */
+	cc_uint8 listed : 1;   /* Whether chunk is in the list of chunks sorted by distance */
 	cc_uint8 : 0;         /* pad to next byte*/
 
 	cc_uint8 drawXMin : 1;
@@ -50,10 +58,10 @@ struct ChunkInfo {
 	cc_uint8 drawYMin : 1;
 	cc_uint8 drawYMax : 1;
 	cc_uint8 : 0;          /* pad to next byte */
-#ifdef OCCLUSION
-	public cc_bool Visited = false, Occluded = false;
-	public byte OcclusionFlags, OccludedFlags, DistanceFlags;
-#endif
+	/* Bitmask of faces of the chunk that can be seen through non-opaque blocks from each face */
+	cc_uint8 connected[FACE_COUNT];
+	cc_uint8 enterFace;  /* Face the occlusion flood fill entered this chunk through */
+	cc_uint8 travelDirs; /* Bitmask of directions taken by the flood fill to reach this chunk */
 #ifndef CC_BUILD_GL11
 	GfxResourceID vb;
 #endif
@@ -61,22 +69,62 @@ struct ChunkInfo {
 	struct ChunkPartInfo* translucentParts;
 };
 
+/* Chunk mesh building statistics for a single frame */
+struct ChunkStats {
+	int built;       /* Number of chunk meshes built */
+	int vertices;    /* Number of vertices uploaded for built chunk meshes */
+	int buildTime;   /* Time spent building chunk meshes, in microseconds */
+	int uploadBytes; /* Number of bytes of vertices uploaded to the GPU */
+	int sortTime;    /* Time spent sorting chunks by distance, in microseconds */
+	int textureBinds; /* Number of times a terrain atlas was bound to draw chunks */
+};
+/* Number of frames that chunk mesh building statistics are kept for */
+#define CHUNKSTATS_HISTORY 120
+/* Number of build time ranges in the histogram, each range being twice as long as the last */
+#define CHUNKSTATS_BUCKETS 6
+
+/* Statistics for the frame currently being rendered */
+extern struct ChunkStats* MapRenderer_CurStats;
+/* Whether chunk mesh building statistics are shown in the HUD */
+extern cc_bool MapRenderer_ShowStats;
+/* Calculates the sum and maximum of the statistics over the last given number of frames */
+void MapRenderer_GetStats(int frames, struct ChunkStats* total, struct ChunkStats* maximum);
+/* Counts how many of the recent frames spent less than 1 ms, less than 2 ms, less than 4 ms, etc building chunks */
+/* NOTE: The last bucket also includes all frames that spent longer than that */
+void MapRenderer_GetBuildHistogram(int buckets[CHUNKSTATS_BUCKETS]);
+
 /* Renders the meshes of non-translucent blocks in visible chunks. */
 void MapRenderer_RenderNormal(float delta);
 /* Renders the meshes of translucent blocks in visible chunks. */
 void MapRenderer_RenderTranslucent(float delta);
+/* Renders coarse top faces of terrain that is past the view distance. */
+void MapRenderer_RenderDistant(float delta);
 /* Potentially updates sort order of rendered chunks. */
 /* Potentially builds meshes for several nearby chunks. */
 /* NOTE: This should be called once per frame. */
 void MapRenderer_Update(float delta);
+/* Updates which chunks are rendered, when drawing the world again from another view in the same frame. */
+/* (e.g. the other eye in anaglyph 3D, or other players in splitscreen) */
+/* NOTE: Unlike MapRenderer_Update, this never builds chunks or changes what chunks are built next */
+void MapRenderer_UpdateView(void);
 
 /* Marks the given chunk as needing to be rebuilt/redrawn. */
 /* NOTE: Coordinates outside the map are simply ignored. */
 void MapRenderer_RefreshChunk(int cx, int cy, int cz);
 /* Called when a block is changed, to update internal state. */
-void MapRenderer_OnBlockChanged(int x, int y, int z, BlockID block);
+/* NOTE: Only marks chunks whose meshes are actually affected by the change as needing rebuilding. */
+void MapRenderer_OnBlockChanged(int x, int y, int z, BlockID old, BlockID now);
+/* Called when any blocks within the given region have changed, to update internal state. */
+/* NOTE: Unlike MapRenderer_OnBlockChanged, all chunks touching the region are marked as needing rebuilding. */
+void MapRenderer_OnRegionChanged(int x1, int y1, int z1, int x2, int y2, int z2);
+/* Marks all chunks with a mesh as needing to be rebuilt. */
+/* NOTE: Unlike MapRenderer_Refresh, existing meshes are still drawn until they are rebuilt. */
+void MapRenderer_RefreshAll(void);
 /* Deletes all chunks and resets internal state. */
 void MapRenderer_Refresh(void);
+/* Lowers the memory budget for chunk meshes to below what they currently use, deleting distant chunk meshes. */
+/* Returns false if chunk meshes already use very little memory, or no meshes could be deleted. */
+cc_bool MapRenderer_ReduceVRAM(void);
 
 CC_END_HEADER
 #endif
@@ -734,7 +734,7 @@ static void    GrO_SetSmooth(cc_bool v) {
 	Builder_SmoothLighting = v;
 	Options_SetBool(OPT_SMOOTH_LIGHTING, v);
 	Builder_ApplyActive();
-	MapRenderer_Refresh();
+	MapRenderer_RefreshAll();
 }
 
 static int  GrO_GetLighting(void) { return Lighting_Mode; }
@@ -880,8 +880,10 @@ static void EditHotkeyScreen_Render(void* screen, float delta) {
 	PackedCol grey = PackedCol_Make(150, 150, 150, 255);
 
 	MenuScreen_Render2(screen, delta);
+	Gfx_Begin2DBatch();
 	Gfx_Draw2DFlat(s->barX, s->barY[0], s->barWidth, s->barHeight, grey);
 	Gfx_Draw2DFlat(s->barX, s->barY[1], s->barWidth, s->barHeight, grey);
+	Gfx_End2DBatch();
 }
 
 static int EditHotkeyScreen_KeyPress(void* screen, char keyChar) {
@@ -1331,15 +1333,42 @@ static void SaveLevelScreen_RemoveOverwrites(struct SaveLevelScreen* s) {
 	}
 }
 
-static cc_result DoSaveMap(const cc_string* path, struct GZipState* state) {
+static void SaveLevelScreen_OnSaved(const cc_string* path, cc_result res) {
+	if (res) { Logger_SysWarn2(res, "saving", path); return; }
+	Chat_Add1("&eSaved map to: %s", path);
+	CPE_SendNotifyAction(NOTIFY_ACTION_LEVEL_SAVED, 0);
+}
+
+/* background is set to false if the map couldn't be saved in the background */
+static cc_result DoSaveMap(const cc_string* path, struct GZipState* state, cc_bool* background) {
 	static const cc_string schematic = String_FromConst(".schematic");
 	static const cc_string mine      = String_FromConst(".mine");
+	static const cc_string region    = String_FromConst(".ccr");
 	struct Stream stream, compStream;
+	int level, threads;
 	cc_result res;
 
+	level   = Options_GetInt(OPT_SAVE_COMPRESSION, 0, DEFLATE_LEVEL_COUNT - 1, DEFLATE_LEVEL_NORMAL);
+	threads = Options_GetInt(OPT_SAVE_THREADS, 0, 16, 3);
+
+	/* Region maps manage the file themselves, as they may only need to be appended to */
+	if (String_CaselessEnds(path, &region)) {
+		*background = false;
+		res = Ccr_Save(path, level);
+		if (res) Logger_SysWarn2(res, "saving", path);
+		return res;
+	}
+
 	res = Stream_CreateFile(&stream, path);
 	if (res) { Logger_SysWarn2(res, "creating", path); return res; }
-	GZip_MakeStream(&compStream, state, &stream);
+
+	if (*background && Cw_SaveInBackground(&stream, path, level, threads, SaveLevelScreen_OnSaved)) return 0;
+	*background = false;
+
+	if (!GZip_MakeParallelStream(&compStream, &stream, level, threads)) {
+		GZip_MakeStream(&compStream, state, &stream);
+		state->Base.Level = level;
+	}
 
 	if (String_CaselessEnds(path, &schematic)) {
 		res = Schematic_Save(&compStream);
@@ -1350,6 +1379,8 @@ static cc_result DoSaveMap(const cc_string* path, struct GZipState* state) {
 	}
 
 	if (res) {
+		/* Still need to close the compressor, to free its resources */
+		compStream.Close(&compStream);
 		stream.Close(&stream);
 		Logger_SysWarn2(res, "encoding", path); return res;
 	}
@@ -1364,21 +1395,27 @@ static cc_result DoSaveMap(const cc_string* path, struct GZipState* state) {
 	return 0;
 }
 
-static cc_result SaveLevelScreen_SaveMap(const cc_string* path) {
+/* Saving .cw maps in the background is only possible when they are being saved to the maps folder */
+static void SaveLevelScreen_SaveMap(const cc_string* path, cc_bool background) {
+	static const cc_string cw = String_FromConst(".cw");
 	struct GZipState* state;
 	cc_result res;
 
+	/* Avoid saving the same file from two threads at once */
+	Cw_FinishBackgroundSave();
+	background = background && String_CaselessEnds(path, &cw) && Options_GetBool(OPT_SAVE_BACKGROUND, true);
+
 	state = Mem_TryAlloc(1, sizeof(struct GZipState));
 	res   = ERR_OUT_OF_MEMORY;
-	if (!state) { Logger_SysWarn(res, "allocating temp memory"); return res; }
+	if (!state) { Logger_SysWarn(res, "allocating temp memory"); return; }
 
-	res = DoSaveMap(path, state);
+	res = DoSaveMap(path, state, &background);
 	Mem_Free(state);
-	if (res) return res;
+	if (res) return;
 
 	World.LastSave = Game.Time;
 	Gui_ShowPauseMenu();
-	return 0;
+	if (!background) SaveLevelScreen_OnSaved(path, 0);
 }
 
 static void SaveLevelScreen_Save(void* screen, void* widget) { 
@@ -1387,18 +1424,24 @@ static void SaveLevelScreen_Save(void* screen, void* widget) {
 	cc_string path; char pathBuffer[FILENAME_SIZE];
 	cc_string file = s->input.base.text;
 	cc_filepath str;
-	cc_result res;
 
 	if (!file.length) {
 		TextWidget_SetConst(&s->desc, "&ePlease enter a filename", &s->textFont);
 		return;
 	}
 
+	/* Keep saving as a region map if there already is one, as saving those again can be much quicker */
 	String_InitArray(path, pathBuffer);
-	String_Format1(&path, "maps/%s.cw", &file);
+	String_Format1(&path, "maps/%s.ccr", &file);
+	Platform_EncodePath(&str, &path);
+
+	if (!File_Exists(&str)) {
+		path.length = 0;
+		String_Format1(&path, "maps/%s.cw", &file);
+		Platform_EncodePath(&str, &path);
+	}
 	String_Copy(&World.Name, &file);
 
-	Platform_EncodePath(&str, &path);
 	if (File_Exists(&str) && !btn->optName) {
 		btn->optName = "";
 		SaveLevelScreen_UpdateSave(s);
@@ -1406,25 +1449,20 @@ static void SaveLevelScreen_Save(void* screen, void* widget) {
 	}
 		
 	SaveLevelScreen_RemoveOverwrites(s);
-	if ((res = SaveLevelScreen_SaveMap(&path))) return;
-	Chat_Add1("&eSaved map to: %s", &path);
-	CPE_SendNotifyAction(NOTIFY_ACTION_LEVEL_SAVED, 0);
+	SaveLevelScreen_SaveMap(&path, true);
 }
 
 static void SaveLevelScreen_UploadCallback(const cc_string* path) {
-	cc_result res = SaveLevelScreen_SaveMap(path);
-	if (!res) {
-		Chat_Add1("&eSaved map to: %s", path);
-		CPE_SendNotifyAction(NOTIFY_ACTION_LEVEL_SAVED, 0);
-	}
+	/* The file may be e.g. downloaded as soon as this returns */
+	SaveLevelScreen_SaveMap(path, false);
 }
 
 static void SaveLevelScreen_File(void* screen, void* b) {
 	static const char* const titles[] = {
-		"ClassiCube map", "Minecraft schematic", "Minecraft classic map", NULL
+		"ClassiCube map", "ClassiCube region map", "Minecraft schematic", "Minecraft classic map", NULL
 	};
 	static const char* const filters[] = {
-		".cw", ".schematic", ".mine", NULL
+		".cw", ".ccr", ".schematic", ".mine", NULL
 	};
 	struct SaveLevelScreen* s = (struct SaveLevelScreen*)screen;
 	struct SaveFileDialogArgs args;
@@ -1824,7 +1862,7 @@ static void LoadLevelScreen_LoadEntries(struct ListScreen* s) {
 static void LoadLevelScreen_UploadCallback(const cc_string* path) { Map_LoadFrom(path); }
 static void LoadLevelScreen_ActionFunc(void* s, void* w) {
 	static const char* const filters[] = { 
-		".cw", ".dat", ".lvl", ".mine", ".fcm", ".mclevel", NULL 
+		".cw", ".ccr", ".dat", ".lvl", ".mine", ".fcm", ".mclevel", NULL 
 	}; /* TODO not hardcode list */
 	static struct OpenFileDialogArgs args = {
 		"Classic map files", filters,
@@ -131,6 +131,8 @@ void Model_SetupState(struct Model* model, struct Entity* e) {
 	/* TODO: Remove setting this eventually */
 	Models.uScale = 100.0f;
 	Models.vScale = 100.0f;
+	Models.uOffset = 0.0f;
+	Models.vOffset = 0.0f;
 
 	if (!e->NoShade) {
 		Models.Cols[1] = PackedCol_Scale(col, PACKEDCOL_SHADE_YMIN);
@@ -156,8 +158,15 @@ void Model_ApplyTexture(struct Entity* e) {
 	cc_bool _64x64;
 
 	tex = model->usesHumanSkin ? e->TextureId : e->MobTextureId;
+	Models.uOffset = 0.0f;
+	Models.vOffset = 0.0f;
+
 	if (tex) {
 		Models.skinType = e->SkinType;
+		if (e->Flags & ENTITY_FLAG_SKIN_ATLAS) {
+			Models.uOffset = e->uOffset;
+			Models.vOffset = e->vOffset;
+		}
 	} else {
 		data = model->defaultTex;
 		tex  = data->texID;
@@ -222,8 +231,8 @@ void Model_DrawPart(struct ModelPart* part) {
 		dst->x = v.x; dst->y = v.y; dst->z = v.z;
 		dst->Col = Models.Cols[i >> 2];
 
-		dst->U = (v.u & UV_POS_MASK) * Models.uScale - (v.u >> UV_MAX_SHIFT) * 0.01f * Models.uScale;
-		dst->V = (v.v & UV_POS_MASK) * Models.vScale - (v.v >> UV_MAX_SHIFT) * 0.01f * Models.vScale;
+		dst->U = (v.u & UV_POS_MASK) * Models.uScale - (v.u >> UV_MAX_SHIFT) * 0.01f * Models.uScale + Models.uOffset;
+		dst->V = (v.v & UV_POS_MASK) * Models.vScale - (v.v >> UV_MAX_SHIFT) * 0.01f * Models.vScale + Models.vOffset;
 		src++; dst++;
 	}
 	model->index += count;
@@ -244,11 +253,13 @@ void Model_DrawRotate(float angleX, float angleY, float angleZ, struct ModelPart
 	float t, x = part->rotX, y = part->rotY, z = part->rotZ;
 	
 	struct ModelVertex v;
+	float m[3][3], vx, vy, vz;
 	int i, count = part->count;
 
-	for (i = 0; i < count; i++) {
-		v = *src;
-		v.x -= x; v.y -= y; v.z -= z;
+	/* Rotating is linear, so rotate each axis once to work out a 3x3 rotation matrix for all vertices */
+	/* (avoids the per-vertex rotation order branches, which are slow on PSP/Vita/etc) */
+	for (i = 0; i < 3; i++) {
+		v.x = (float)(i == 0); v.y = (float)(i == 1); v.z = (float)(i == 2);
 
 		/* Rotate locally */
 		if (Models.Rotation == ROTATE_ORDER_ZYX) {
@@ -273,16 +284,56 @@ void Model_DrawRotate(float angleX, float angleY, float angleZ, struct ModelPart
 		if (head) {
 			t = Models.cosHead * v.x - Models.sinHead * v.z; v.z = Models.sinHead * v.x + Models.cosHead * v.z; v.x = t;
 		}
-		dst->x = v.x + x; dst->y = v.y + y; dst->z = v.z + z;
+		m[i][0] = v.x; m[i][1] = v.y; m[i][2] = v.z;
+	}
+
+	for (i = 0; i < count; i++) {
+		v  = *src;
+		vx = v.x - x; vy = v.y - y; vz = v.z - z;
+
+		dst->x = vx * m[0][0] + vy * m[1][0] + vz * m[2][0] + x;
+		dst->y = vx * m[0][1] + vy * m[1][1] + vz * m[2][1] + y;
+		dst->z = vx * m[0][2] + vy * m[1][2] + vz * m[2][2] + z;
 		dst->Col = Models.Cols[i >> 2];
 
-		dst->U = (v.u & UV_POS_MASK) * Models.uScale - (v.u >> UV_MAX_SHIFT) * 0.01f * Models.uScale;
-		dst->V = (v.v & UV_POS_MASK) * Models.vScale - (v.v >> UV_MAX_SHIFT) * 0.01f * Models.vScale;
+		dst->U = (v.u & UV_POS_MASK) * Models.uScale - (v.u >> UV_MAX_SHIFT) * 0.01f * Models.uScale + Models.uOffset;
+		dst->V = (v.v & UV_POS_MASK) * Models.vScale - (v.v >> UV_MAX_SHIFT) * 0.01f * Models.vScale + Models.vOffset;
 		src++; dst++;
 	}
 	model->index += count;
 }
 
+/* Calculates the matrix that transforms vertices of the given part the same way Model_DrawRotate does */
+static void Model_GetPartMatrix(struct Matrix* m, float angleX, float angleY, float angleZ, struct ModelPart* part, cc_bool head) {
+	struct Matrix rotX, rotY, rotZ, tmp;
+	Matrix_RotateX(&rotX, angleX);
+	Matrix_RotateY(&rotY, angleY);
+	Matrix_RotateZ(&rotZ, angleZ);
+	Matrix_Translate(m, -part->rotX, -part->rotY, -part->rotZ);
+
+	/* Rotate locally */
+	if (Models.Rotation == ROTATE_ORDER_ZYX) {
+		Matrix_Mul(m, m, &rotZ); Matrix_Mul(m, m, &rotY); Matrix_Mul(m, m, &rotX);
+	} else if (Models.Rotation == ROTATE_ORDER_XZY) {
+		Matrix_Mul(m, m, &rotX); Matrix_Mul(m, m, &rotZ); Matrix_Mul(m, m, &rotY);
+	} else if (Models.Rotation == ROTATE_ORDER_YZX) {
+		Matrix_Mul(m, m, &rotY); Matrix_Mul(m, m, &rotZ); Matrix_Mul(m, m, &rotX);
+	} else if (Models.Rotation == ROTATE_ORDER_XYZ) {
+		Matrix_Mul(m, m, &rotX); Matrix_Mul(m, m, &rotY); Matrix_Mul(m, m, &rotZ);
+	}
+
+	/* Rotate globally */
+	if (head) {
+		tmp = Matrix_Identity;
+		tmp.row1.x =  Models.cosHead; tmp.row1.z = Models.sinHead;
+		tmp.row3.x = -Models.sinHead; tmp.row3.z = Models.cosHead;
+		Matrix_Mul(m, m, &tmp);
+	}
+
+	Matrix_Translate(&tmp, part->rotX, part->rotY, part->rotZ);
+	Matrix_Mul(m, m, &tmp);
+}
+
 void Model_RenderArm(struct Model* model, struct Entity* e) {
 	struct Matrix m, translate;
 	Vec3 pos = e->Position;
@@ -518,6 +569,10 @@ static void Models_TextureChanged(void* obj, struct Stream* stream, const cc_str
 }
 
 
+/* Whether to animate models on the GPU, instead of rebuilding their vertices every frame */
+static cc_bool models_gpuParts;
+#define Models_UseGpuParts() (models_gpuParts && Gfx.SupportsModelParts)
+
 #ifdef CUSTOM_MODELS
 /*########################################################################################################################*
 *------------------------------------------------------Custom Models------------------------------------------------------*
@@ -661,6 +716,22 @@ static float CustomModel_GetAnimValue(cc_uint8 type, struct CustomModelAnim* ani
 	return 0.0f;
 }
 
+static cc_bool CustomModel_IsTranslateAnim(cc_uint8 type) {
+	return
+		type == CustomModelAnimType_SinTranslate ||
+		type == CustomModelAnimType_SinTranslateVelocity ||
+		type == CustomModelAnimType_FlipTranslate ||
+		type == CustomModelAnimType_FlipTranslateVelocity;
+}
+
+static cc_bool CustomModel_IsSizeAnim(cc_uint8 type) {
+	return
+		type == CustomModelAnimType_SinSize ||
+		type == CustomModelAnimType_SinSizeVelocity ||
+		type == CustomModelAnimType_FlipSize ||
+		type == CustomModelAnimType_FlipSizeVelocity;
+}
+
 static PackedCol oldCols[FACE_COUNT];
 static void CustomModel_DrawPart(
 	struct CustomModelPart* part,
@@ -698,17 +769,7 @@ static void CustomModel_DrawPart(
 		if (type == CustomModelAnimType_None) continue;
 		value = CustomModel_GetAnimValue(type, anim, e);
 	
-		if (
-			!modifiedVertices &&
-			(type == CustomModelAnimType_SinTranslate ||
-				type == CustomModelAnimType_SinTranslateVelocity ||
-				type == CustomModelAnimType_SinSize ||
-				type == CustomModelAnimType_SinSizeVelocity ||
-				type == CustomModelAnimType_FlipTranslate ||
-				type == CustomModelAnimType_FlipTranslateVelocity ||
-				type == CustomModelAnimType_FlipSize ||
-				type == CustomModelAnimType_FlipSizeVelocity)
-		) {
+		if (!modifiedVertices && (CustomModel_IsTranslateAnim(type) || CustomModel_IsSizeAnim(type))) {
 			modifiedVertices = true;
 			Mem_Copy(
 				oldVertices,
@@ -717,12 +778,7 @@ static void CustomModel_DrawPart(
 			);
 		}
 		
-		if (
-			type == CustomModelAnimType_SinTranslate ||
-			type == CustomModelAnimType_SinTranslateVelocity ||
-			type == CustomModelAnimType_FlipTranslate ||
-			type == CustomModelAnimType_FlipTranslateVelocity
-		) {
+		if (CustomModel_IsTranslateAnim(type)) {
 			for (i = 0; i < MODEL_BOX_VERTICES; i++) {
 				struct ModelVertex* vertex = &cm->model.vertices[part->modelPart.offset + i];
 				switch (axis) {
@@ -739,12 +795,7 @@ static void CustomModel_DrawPart(
 						break;
 				}
 			}
-		} else if (
-			type == CustomModelAnimType_SinSize ||
-			type == CustomModelAnimType_SinSizeVelocity ||
-			type == CustomModelAnimType_FlipSize ||
-			type == CustomModelAnimType_FlipSizeVelocity
-		) {
+		} else if (CustomModel_IsSizeAnim(type)) {
 			for (i = 0; i < MODEL_BOX_VERTICES; i++) {
 				struct ModelVertex* vertex = &cm->model.vertices[part->modelPart.offset + i];
 				switch (axis) {
@@ -804,6 +855,143 @@ static void CustomModel_DrawPart(
 	}
 }
 
+/* Calculates the matrix that transforms vertices of the given part the same way CustomModel_DrawPart does */
+static void CustomModel_GetPartMatrix(struct Matrix* m, struct CustomModelPart* part, struct Entity* e) {
+	struct ModelPart* mp = &part->modelPart;
+	struct Matrix tmp;
+	float rotX, rotY, rotZ, value;
+	float x, y, z;
+	cc_bool head = false;
+	cc_uint8 type, axis;
+	int i;
+
+	/* bbmodels use xyz rotation order */
+	Models.Rotation = ROTATE_ORDER_XYZ;
+	*m = Matrix_Identity;
+
+	rotX = part->rotation.x * MATH_DEG2RAD;
+	rotY = part->rotation.y * MATH_DEG2RAD;
+	rotZ = part->rotation.z * MATH_DEG2RAD;
+
+	for (i = 0; i < MAX_CUSTOM_MODEL_ANIMS; i++) 
+	{
+		type = part->animType[i];
+		axis = part->animAxis[i];
+
+		if (type == CustomModelAnimType_None) continue;
+		value = CustomModel_GetAnimValue(type, &part->anims[i], e);
+
+		if (CustomModel_IsTranslateAnim(type)) {
+			x = axis == CustomModelAnimAxis_X ? value : 0.0f;
+			y = axis == CustomModelAnimAxis_Y ? value : 0.0f;
+			z = axis == CustomModelAnimAxis_Z ? value : 0.0f;
+
+			Matrix_Translate(&tmp, x, y, z);
+			Matrix_Mul(m, m, &tmp);
+		} else if (CustomModel_IsSizeAnim(type)) {
+			x = axis == CustomModelAnimAxis_X ? value : 1.0f;
+			y = axis == CustomModelAnimAxis_Y ? value : 1.0f;
+			z = axis == CustomModelAnimAxis_Z ? value : 1.0f;
+
+			/* Scales towards the rotation origin, as Math_Lerp does */
+			Matrix_Translate(&tmp, -mp->rotX, -mp->rotY, -mp->rotZ);
+			Matrix_Mul(m, m, &tmp);
+			Matrix_Scale(&tmp, x, y, z);
+			Matrix_Mul(m, m, &tmp);
+			Matrix_Translate(&tmp, mp->rotX, mp->rotY, mp->rotZ);
+			Matrix_Mul(m, m, &tmp);
+		} else {
+			if (type == CustomModelAnimType_Head) head = true;
+
+			if (axis == CustomModelAnimAxis_X) rotX += value;
+			if (axis == CustomModelAnimAxis_Y) rotY += value;
+			if (axis == CustomModelAnimAxis_Z) rotZ += value;
+		}
+	}
+
+	if (rotX || rotY || rotZ || head) {
+		Model_GetPartMatrix(&tmp, rotX, rotY, rotZ, mp, head);
+		Matrix_Mul(m, m, &tmp);
+	}
+}
+
+static cc_bool CustomModel_IsAnimated(struct CustomModelPart* part) {
+	int i;
+	for (i = 0; i < MAX_CUSTOM_MODEL_ANIMS; i++) 
+	{
+		if (part->animType[i] != CustomModelAnimType_None) return true;
+	}
+	return false;
+}
+
+/* Gives each animated part its own part matrix, with all the static parts sharing the first one */
+static void CustomModel_AssignGpuSlots(struct CustomModel* cm) {
+	int i, slots = 1;
+
+	for (i = 0; i < cm->numParts; i++) 
+	{
+		cm->parts[i].gpuSlot = CustomModel_IsAnimated(&cm->parts[i]) ? slots++ : 0;
+	}
+	/* Models with too many animated parts are always drawn on the CPU instead */
+	cm->numGpuSlots = slots <= GFX_MAX_MODEL_PARTS ? slots : 0;
+}
+
+/* Static parts are baked with their fixed rotation applied, so only animated parts need a matrix per frame */
+static GfxResourceID CustomModel_GetPartsVb(struct CustomModel* cm) {
+	struct CustomModelPart* part;
+	struct VertexTextured* dst;
+	struct ModelVertex v;
+	struct Matrix m;
+	Vec3 pos;
+	int i, j;
+	if (cm->partsVb) return cm->partsVb;
+
+	dst = (struct VertexTextured*)Gfx_RecreateAndLockVb(&cm->partsVb, VERTEX_FORMAT_TEXTURED, 
+														cm->numParts * MODEL_BOX_VERTICES);
+	for (i = 0; i < cm->numParts; i++) 
+	{
+		part = &cm->parts[i];
+		m    = Matrix_Identity;
+		if (!part->gpuSlot) CustomModel_GetPartMatrix(&m, part, NULL);
+
+		for (j = 0; j < part->modelPart.count; j++) 
+		{
+			v = cm->model.vertices[part->modelPart.offset + j];
+			pos.x = v.x; pos.y = v.y; pos.z = v.z;
+			Vec3_Transform(&pos, &pos, &m);
+
+			dst->x = pos.x; dst->y = pos.y; dst->z = pos.z;
+			/* Index of the part's matrix, index of the face colour, and whether to ignore face colours */
+			dst->Col = PackedCol_Make(part->gpuSlot, j >> 2, part->fullbright ? 255 : 0, 255);
+
+			dst->U = (v.u & UV_POS_MASK) - (v.u >> UV_MAX_SHIFT) * 0.01f;
+			dst->V = (v.v & UV_POS_MASK) - (v.v >> UV_MAX_SHIFT) * 0.01f;
+			dst++;
+		}
+	}
+	Gfx_UnlockVb(cm->partsVb);
+	return cm->partsVb;
+}
+
+static void CustomModel_DrawGpuParts(struct Entity* e, struct CustomModel* cm) {
+	struct Matrix m[GFX_MAX_MODEL_PARTS];
+	struct CustomModelPart* part;
+	int i;
+	Gfx_BindVb(CustomModel_GetPartsVb(cm));
+	m[0] = Matrix_Identity;
+
+	for (i = 0; i < cm->numParts; i++) 
+	{
+		part = &cm->parts[i];
+		if (part->gpuSlot) CustomModel_GetPartMatrix(&m[part->gpuSlot], part, e);
+	}
+
+	Gfx_SetModelParts(m, cm->numGpuSlots, Models.Cols, Models.uScale, Models.vScale, Models.uOffset, Models.vOffset);
+	Gfx_DrawVb_IndexedTris(cm->numParts * MODEL_BOX_VERTICES);
+	Gfx_DisableModelParts();
+	Models.Rotation = ROTATE_ORDER_ZYX;
+}
+
 static void CustomModel_Draw(struct Entity* e) {
 	struct CustomModel* cm = (struct CustomModel*)Models.Active;
 	int i;
@@ -811,6 +999,10 @@ static void CustomModel_Draw(struct Entity* e) {
 	Model_ApplyTexture(e);
 	Models.uScale = e->uScale / cm->uScale;
 	Models.vScale = e->vScale / cm->vScale;
+	if (cm->numGpuSlots && Models_UseGpuParts()) {
+		CustomModel_DrawGpuParts(e, cm); return;
+	}
+
 	Model_LockVB(e, cm->numParts * MODEL_BOX_VERTICES);
 
 	for (i = 0; i < cm->numParts; i++) 
@@ -845,8 +1037,8 @@ static void CustomModel_DrawArm(struct Entity* e) {
 	if (!cm->numArmParts) return;
 	Gfx_SetAlphaTest(true);
 
-	Models.uScale = 1.0f / cm->uScale;
-	Models.vScale = 1.0f / cm->vScale;
+	Models.uScale = e->uScale / cm->uScale;
+	Models.vScale = e->vScale / cm->vScale;
 	Model_LockVB(e, cm->numArmParts * MODEL_BOX_VERTICES);
 
 	for (i = 0; i < cm->numParts; i++) 
@@ -877,6 +1069,7 @@ void CustomModel_Register(struct CustomModel* cm) {
 	cm->model.name        = cm->name;
 	cm->model.defaultTex  = &customDefaultTex;
 	cm->model.maxVertices = cm->numParts * MODEL_BOX_VERTICES;
+	CustomModel_AssignGpuSlots(cm);
 
 	cm->model.MakeParts = Model_NoParts;
 	cm->model.Draw      = CustomModel_Draw;
@@ -901,6 +1094,7 @@ void CustomModel_Undefine(struct CustomModel* cm) {
 	if (!cm->defined) return;
 	if (cm->registered) Model_Unregister((struct Model*)cm);
 
+	Gfx_DeleteVb(&cm->partsVb);
 	Mem_Free(cm->model.vertices);
 	Mem_Set(cm, 0, sizeof(struct CustomModel));
 }
@@ -916,8 +1110,21 @@ static void CustomModel_FreeAll(void) {
 		CustomModel_Undefine(&custom_models[i]);
 	}
 }
+
+static void CustomModel_FreePartsVbs(void) {
+	int i;
+#ifdef CC_BUILD_LOWMEM
+	if (!custom_models) return;
+#endif
+
+	for (i = 0; i < MAX_CUSTOM_MODELS; i++) 
+	{
+		Gfx_DeleteVb(&custom_models[i].partsVb);
+	}
+}
 #else
 static void CustomModel_FreeAll(void) { }
+static void CustomModel_FreePartsVbs(void) { }
 #endif
 
 
@@ -930,45 +1137,148 @@ struct ModelLimbs {
 struct ModelSet {
 	struct ModelPart head, torso, hat, torsoLayer;
 	struct ModelLimbs limbs[3];
+	/* Static vertices of all parts for each skin type, when parts are transformed on the GPU */
+	GfxResourceID partsVb[3];
+	struct ModelVertex* partsSrc;
 };
 #define HUMAN_BASE_VERTICES  (6 * MODEL_BOX_VERTICES)
 #define HUMAN_HAT32_VERTICES (1 * MODEL_BOX_VERTICES)
 #define HUMAN_HAT64_VERTICES (6 * MODEL_BOX_VERTICES)
 #define HUMAN_MAX_VERTICES   HUMAN_BASE_VERTICES + HUMAN_HAT64_VERTICES
+#define HUMAN_MAX_PARTS      (HUMAN_MAX_VERTICES / MODEL_BOX_VERTICES)
+
+/* Returns the parts of the given skin type, in the order that HumanModel_DrawCore draws them */
+static int HumanModel_GetParts(struct ModelSet* model, int type, struct ModelPart** parts) {
+	struct ModelLimbs* set = &model->limbs[type & 0x3];
+	int count = 0;
+
+	parts[count++] = &model->head;   parts[count++] = &model->torso;
+	parts[count++] = &set->leftLeg;  parts[count++] = &set->rightLeg;
+	parts[count++] = &set->leftArm;  parts[count++] = &set->rightArm;
+
+	if (type != SKIN_64x32) {
+		parts[count++] = &model->torsoLayer;
+		parts[count++] = &set->leftLegLayer; parts[count++] = &set->rightLegLayer;
+		parts[count++] = &set->leftArmLayer; parts[count++] = &set->rightArmLayer;
+	}
+	parts[count++] = &model->hat;
+	return count;
+}
+
+static GfxResourceID HumanModel_GetPartsVb(struct ModelSet* model, int type) {
+	struct ModelPart* parts[HUMAN_MAX_PARTS];
+	struct ModelVertex* vertices = Models.Active->vertices;
+	GfxResourceID* vb = &model->partsVb[type & 0x3];
+	struct VertexTextured* dst;
+	struct ModelVertex v;
+	int i, j, count, total = 0;
+
+	/* Vertices need to be remade if a different model is using this set */
+	if (model->partsSrc != vertices) {
+		for (i = 0; i < Array_Elems(model->partsVb); i++) Gfx_DeleteVb(&model->partsVb[i]);
+		model->partsSrc = vertices;
+	}
+	if (*vb) return *vb;
+
+	count = HumanModel_GetParts(model, type, parts);
+	for (i = 0; i < count; i++) total += parts[i]->count;
+	dst = (struct VertexTextured*)Gfx_RecreateAndLockVb(vb, VERTEX_FORMAT_TEXTURED, total);
+
+	for (i = 0; i < count; i++) 
+	{
+		for (j = 0; j < parts[i]->count; j++) 
+		{
+			v = vertices[parts[i]->offset + j];
+			dst->x = v.x; dst->y = v.y; dst->z = v.z;
+			/* Index of the part's matrix, and of the face colour Model_DrawPart would use */
+			dst->Col = PackedCol_Make(i, j >> 2, 0, 255);
+
+			dst->U = (v.u & UV_POS_MASK) - (v.u >> UV_MAX_SHIFT) * 0.01f;
+			dst->V = (v.v & UV_POS_MASK) - (v.v >> UV_MAX_SHIFT) * 0.01f;
+			dst++;
+		}
+	}
+	Gfx_UnlockVb(*vb);
+	return *vb;
+}
+
+static void HumanModel_FreePartsVbs(struct ModelSet* model) {
+	int i;
+	for (i = 0; i < Array_Elems(model->partsVb); i++) Gfx_DeleteVb(&model->partsVb[i]);
+	model->partsSrc = NULL;
+}
+
+/* Sets up drawing the static vertices of the parts, transformed the same way as HumanModel_DrawCore */
+static void HumanModel_SetupGpuParts(struct Entity* e, struct ModelSet* model, int type) {
+	struct ModelLimbs* set = &model->limbs[type & 0x3];
+	struct Matrix m[HUMAN_MAX_PARTS];
+	int count = 0;
+	Gfx_BindVb(HumanModel_GetPartsVb(model, type));
+
+	Model_GetPartMatrix(&m[count++], -e->Pitch * MATH_DEG2RAD, 0, 0, &model->head, true);
+	m[count++] = Matrix_Identity;
+	Model_GetPartMatrix(&m[count++], e->Anim.LeftLegX,  0, e->Anim.LeftLegZ,  &set->leftLeg,  false);
+	Model_GetPartMatrix(&m[count++], e->Anim.RightLegX, 0, e->Anim.RightLegZ, &set->rightLeg, false);
+
+	Models.Rotation = ROTATE_ORDER_XZY;
+	Model_GetPartMatrix(&m[count++], e->Anim.LeftArmX,  0, e->Anim.LeftArmZ,  &set->leftArm,  false);
+	Model_GetPartMatrix(&m[count++], e->Anim.RightArmX, 0, e->Anim.RightArmZ, &set->rightArm, false);
+	Models.Rotation = ROTATE_ORDER_ZYX;
+
+	if (type != SKIN_64x32) {
+		m[count++] = Matrix_Identity;
+		Model_GetPartMatrix(&m[count++], e->Anim.LeftLegX,  0, e->Anim.LeftLegZ,  &set->leftLegLayer,  false);
+		Model_GetPartMatrix(&m[count++], e->Anim.RightLegX, 0, e->Anim.RightLegZ, &set->rightLegLayer, false);
+
+		Models.Rotation = ROTATE_ORDER_XZY;
+		Model_GetPartMatrix(&m[count++], e->Anim.LeftArmX,  0, e->Anim.LeftArmZ,  &set->leftArmLayer,  false);
+		Model_GetPartMatrix(&m[count++], e->Anim.RightArmX, 0, e->Anim.RightArmZ, &set->rightArmLayer, false);
+		Models.Rotation = ROTATE_ORDER_ZYX;
+	}
+	Model_GetPartMatrix(&m[count++], -e->Pitch * MATH_DEG2RAD, 0, 0, &model->hat, true);
+
+	Gfx_SetModelParts(m, count, Models.Cols, Models.uScale, Models.vScale, Models.uOffset, Models.vOffset);
+}
 
 static void HumanModel_DrawCore(struct Entity* e, struct ModelSet* model, cc_bool opaqueBody) {
 	struct ModelLimbs* set;
+	cc_bool gpuParts = Models_UseGpuParts();
 	int type, num;
 	Model_ApplyTexture(e);
 
 	type = Models.skinType;
 	set  = &model->limbs[type & 0x3];
 	num  = HUMAN_BASE_VERTICES + (type == SKIN_64x32 ? HUMAN_HAT32_VERTICES : HUMAN_HAT64_VERTICES);
-	Model_LockVB(e, num);
 
-	Model_DrawRotate(-e->Pitch * MATH_DEG2RAD, 0, 0, &model->head, true);
-	Model_DrawPart(&model->torso);
-	Model_DrawRotate(e->Anim.LeftLegX,  0, e->Anim.LeftLegZ,  &set->leftLeg,  false);
-	Model_DrawRotate(e->Anim.RightLegX, 0, e->Anim.RightLegZ, &set->rightLeg, false);
-
-	Models.Rotation = ROTATE_ORDER_XZY;
-	Model_DrawRotate(e->Anim.LeftArmX,  0, e->Anim.LeftArmZ,  &set->leftArm,  false);
-	Model_DrawRotate(e->Anim.RightArmX, 0, e->Anim.RightArmZ, &set->rightArm, false);
-	Models.Rotation = ROTATE_ORDER_ZYX;
+	if (gpuParts) {
+		HumanModel_SetupGpuParts(e, model, type);
+	} else {
+		Model_LockVB(e, num);
 
-	if (type != SKIN_64x32) {
-		Model_DrawPart(&model->torsoLayer);
-		Model_DrawRotate(e->Anim.LeftLegX,  0, e->Anim.LeftLegZ,  &set->leftLegLayer,  false);
-		Model_DrawRotate(e->Anim.RightLegX, 0, e->Anim.RightLegZ, &set->rightLegLayer, false);
+		Model_DrawRotate(-e->Pitch * MATH_DEG2RAD, 0, 0, &model->head, true);
+		Model_DrawPart(&model->torso);
+		Model_DrawRotate(e->Anim.LeftLegX,  0, e->Anim.LeftLegZ,  &set->leftLeg,  false);
+		Model_DrawRotate(e->Anim.RightLegX, 0, e->Anim.RightLegZ, &set->rightLeg, false);
 
 		Models.Rotation = ROTATE_ORDER_XZY;
-		Model_DrawRotate(e->Anim.LeftArmX,  0, e->Anim.LeftArmZ,  &set->leftArmLayer,  false);
-		Model_DrawRotate(e->Anim.RightArmX, 0, e->Anim.RightArmZ, &set->rightArmLayer, false);
+		Model_DrawRotate(e->Anim.LeftArmX,  0, e->Anim.LeftArmZ,  &set->leftArm,  false);
+		Model_DrawRotate(e->Anim.RightArmX, 0, e->Anim.RightArmZ, &set->rightArm, false);
 		Models.Rotation = ROTATE_ORDER_ZYX;
+
+		if (type != SKIN_64x32) {
+			Model_DrawPart(&model->torsoLayer);
+			Model_DrawRotate(e->Anim.LeftLegX,  0, e->Anim.LeftLegZ,  &set->leftLegLayer,  false);
+			Model_DrawRotate(e->Anim.RightLegX, 0, e->Anim.RightLegZ, &set->rightLegLayer, false);
+
+			Models.Rotation = ROTATE_ORDER_XZY;
+			Model_DrawRotate(e->Anim.LeftArmX,  0, e->Anim.LeftArmZ,  &set->leftArmLayer,  false);
+			Model_DrawRotate(e->Anim.RightArmX, 0, e->Anim.RightArmZ, &set->rightArmLayer, false);
+			Models.Rotation = ROTATE_ORDER_ZYX;
+		}
+		Model_DrawRotate(-e->Pitch * MATH_DEG2RAD, 0, 0, &model->hat, true);
+		Model_UnlockVB();
 	}
-	Model_DrawRotate(-e->Pitch * MATH_DEG2RAD, 0, 0, &model->hat, true);
 
-	Model_UnlockVB();
 	if (opaqueBody) {
 		/* human model draws the body opaque so players can't have invisible skins */
 		Gfx_SetAlphaTest(false);
@@ -978,6 +1288,7 @@ static void HumanModel_DrawCore(struct Entity* e, struct ModelSet* model, cc_boo
 	} else {
 		Gfx_DrawVb_IndexedTris(num);
 	}
+	if (gpuParts) Gfx_DisableModelParts();
 }
 
 static void HumanModel_DrawArmCore(struct Entity* e, struct ModelSet* model) {
@@ -2150,14 +2461,10 @@ static void BlockModel_SpriteXQuad(cc_bool firstPart, cc_bool mirror) {
 	bModel_vertices = ptr;
 }
 
-static void BlockModel_BuildParts(struct Entity* e, cc_bool sprite) {
-	struct VertexTextured* ptr;
+static void BlockModel_BuildVertices(struct VertexTextured* ptr, cc_bool sprite) {
 	Vec3 min, max;
 	TextureLoc loc;
 
-	Model_LockVB(e, sprite ? BLOCKMODEL_SPRITE_COUNT : BLOCKMODEL_CUBE_COUNT);
-	ptr = Models.Vertices;
-
 	if (sprite) {
 		bModel_vertices = ptr;
 
@@ -2189,7 +2496,11 @@ static void BlockModel_BuildParts(struct Entity* e, cc_bool sprite) {
 		loc = BlockModel_GetTex(FACE_XMIN); Drawer_XMin(1, Models.Cols[4], loc, &ptr);
 		loc = BlockModel_GetTex(FACE_YMAX); Drawer_YMax(1, Models.Cols[0], loc, &ptr);
 	}
+}
 
+static void BlockModel_BuildParts(struct Entity* e, cc_bool sprite) {
+	Model_LockVB(e, sprite ? BLOCKMODEL_SPRITE_COUNT : BLOCKMODEL_CUBE_COUNT);
+	BlockModel_BuildVertices(Models.Vertices, sprite);
 	Model_UnlockVB();
 }
 
@@ -2216,20 +2527,23 @@ static void BlockModel_DrawParts(void) {
 	Gfx_DrawVb_IndexedTris_Range(count, offset);
 }
 
+static void BlockModel_SetupColors(void) {
+	int i;
+	if (!Blocks.Brightness[bModel_block]) return;
+
+	for (i = 0; i < FACE_COUNT; i++)
+	{
+		Models.Cols[i] = PACKEDCOL_WHITE;
+	}
+}
+
 static void BlockModel_Draw(struct Entity* e) {
 	cc_bool sprite;
-	int i;
 
 	bModel_block = e->ModelBlock;
 	bModel_index = 0;
 	if (Blocks.Draw[bModel_block] == DRAW_GAS) return;
-
-	if (Blocks.Brightness[bModel_block]) {
-		for (i = 0; i < FACE_COUNT; i++)
-		{
-			Models.Cols[i] = PACKEDCOL_WHITE;
-		}
-	}
+	BlockModel_SetupColors();
 
 	sprite = Blocks.Draw[bModel_block] == DRAW_SPRITE;
 	BlockModel_BuildParts(e, sprite);
@@ -2239,6 +2553,55 @@ static void BlockModel_Draw(struct Entity* e) {
 	if (sprite) Gfx_SetFaceCulling(false);
 }
 
+static void BlockModel_UpdateCache(struct BlockModelCache* cache, cc_bool sprite) {
+	struct VertexTextured* ptr;
+	int count = sprite ? BLOCKMODEL_SPRITE_COUNT : BLOCKMODEL_CUBE_COUNT;
+
+	/* Dynamic, since the color changes whenever e.g. the player looks up or down */
+	if (!cache->vb) cache->vb = Gfx_CreateDynamicVb(VERTEX_FORMAT_TEXTURED, BLOCKMODEL_MAX_VERTICES);
+	cache->valid = true;
+
+	ptr = (struct VertexTextured*)Gfx_LockDynamicVb(cache->vb, VERTEX_FORMAT_TEXTURED, count);
+	BlockModel_BuildVertices(ptr, sprite);
+	Gfx_UnlockDynamicVb(cache->vb);
+
+	cache->block = bModel_block;
+	cache->count = bModel_index;
+	Mem_Copy(cache->texIndices, bModel_texIndices, sizeof(bModel_texIndices));
+	Mem_Copy(cache->cols,       Models.Cols,       sizeof(Models.Cols));
+}
+
+void BlockModel_RenderCached(struct BlockModelCache* cache, struct Entity* e) {
+	struct Matrix m, transform;
+	cc_bool sprite;
+
+	Model_SetupState(Models.Block, e);
+	Gfx_SetVertexFormat(VERTEX_FORMAT_TEXTURED);
+	Model_GetEntityTransform(Models.Block, e, &transform);
+	Matrix_Mul(&m, &transform, &Gfx.View);
+
+	bModel_block = e->ModelBlock;
+	bModel_index = 0;
+	if (Blocks.Draw[bModel_block] == DRAW_GAS) return;
+	BlockModel_SetupColors();
+
+	/* Only the transform changes from frame to frame most of the time */
+	sprite = Blocks.Draw[bModel_block] == DRAW_SPRITE;
+	if (!cache->valid || cache->block != bModel_block || !Mem_Equal(cache->cols, Models.Cols, sizeof(Models.Cols))) {
+		BlockModel_UpdateCache(cache, sprite);
+	} else {
+		bModel_index = cache->count;
+		Mem_Copy(bModel_texIndices, cache->texIndices, sizeof(bModel_texIndices));
+		Gfx_BindDynamicVb(cache->vb);
+	}
+
+	Gfx_LoadMatrix(MATRIX_VIEW, &m);
+	if (sprite) Gfx_SetFaceCulling(true);
+	BlockModel_DrawParts();
+	if (sprite) Gfx_SetFaceCulling(false);
+	Gfx_LoadMatrix(MATRIX_VIEW, &Gfx.View);
+}
+
 static struct Model block_model = { "block", NULL, &human_tex,
 	Model_NoParts,       BlockModel_Draw,
 	BlockModel_GetNameY, BlockModel_GetEyeY,
@@ -2337,7 +2700,7 @@ static void DrawBlockTransform(struct Entity* e, float dispX, float dispY, float
 	Matrix_Scale(&temp, scale / 1.5f, scale / 1.5f, scale / 1.5f);
 	Matrix_Mul(&m, &temp, &m);
 
-	Model_SetupState(&block_model, e);
+	Model_SetupState(Models.Block, e);
 	Gfx_LoadMatrix(MATRIX_VIEW, &m);
 	block_model.Draw(e);
 }
@@ -2420,6 +2783,9 @@ static void RegisterDefaultModels(void) {
 static void OnContextLost(void* obj) {
 	struct ModelTex* tex;
 	Gfx_DeleteDynamicVb(&Models.Vb);
+	HumanModel_FreePartsVbs(&human_set);
+	HumanModel_FreePartsVbs(&chibi_set);
+	CustomModel_FreePartsVbs();
 	if (Gfx.ManagedTextures) return;
 
 	for (tex = textures_head; tex; tex = tex->next) 
@@ -2432,6 +2798,7 @@ static void OnInit(void) {
 	Models.MaxVertices = MODELS_MAX_VERTICES;
 	RegisterDefaultModels();
 	Models.ClassicArms = Options_GetBool(OPT_CLASSIC_ARM_MODEL, Game_ClassicMode);
+	models_gpuParts    = Options_GetBool(OPT_GPU_MODELS, true);
 
 	Event_Register_(&TextureEvents.FileChanged, NULL, Models_TextureChanged);
 	Event_Register_(&GfxEvents.ContextLost,     NULL, OnContextLost);
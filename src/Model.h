@@ -118,6 +118,8 @@ CC_VAR extern struct _ModelsData {
 	struct Model* Human;
 	/* Pointer to block model */
 	struct Model* Block;
+	/* U/V offset added to skin texture coordinates, when the skin is part of an atlas texture. */
+	float uOffset, vOffset;
 } Models;
 
 /* Initialises fields of a model to default. */
@@ -151,6 +153,20 @@ void Model_RenderArm(struct Model* model, struct Entity* entity);
 /* Draws the given part with appropriate rotation to produce an arm look. */
 CC_API void Model_DrawArmPart(struct ModelPart* part);
 
+/* Vertices of a block model kept around between frames, for entities that are drawn often */
+/*  as the same block (e.g. the block held in the player's hand) */
+struct BlockModelCache {
+	GfxResourceID vb; /* NOTE: Dynamic vertex buffer */
+	cc_bool valid;    /* Whether vb holds the vertices of block */
+	BlockID block;
+	int count, texIndices[8];
+	PackedCol cols[FACE_COUNT];
+};
+/* Draws the given entity's ModelBlock as the block model, only rebuilding */
+/*  the cached vertices when the block or the entity's color changes. */
+/* NOTE: valid must be set to false when the block's textures or definition change */
+void BlockModel_RenderCached(struct BlockModelCache* cache, struct Entity* entity);
+
 /* Returns a pointer to the model whose name caselessly matches given name. */
 CC_API struct Model* Model_Get(const cc_string* name);
 /* Adds a model to the list of models. (e.g. "skeleton") */
@@ -274,6 +290,7 @@ struct CustomModelPart {
 	cc_uint8 animAxis[MAX_CUSTOM_MODEL_ANIMS];
 	cc_bool fullbright;
 	cc_bool firstPersonArm;
+	cc_uint8 gpuSlot; /* Index of the part matrix used when drawing on the GPU, 0 if never animated */
 };
 
 struct CustomModel {
@@ -292,6 +309,8 @@ struct CustomModel {
 
 	cc_uint8 numParts;
 	cc_uint8 numArmParts;
+	cc_uint8 numGpuSlots; /* Number of part matrices needed to draw on the GPU, 0 if too many */
+	GfxResourceID partsVb; /* Static vertices of all parts, when drawing on the GPU */
 	struct CustomModelPart parts[MAX_CUSTOM_MODEL_PARTS];
 };
 
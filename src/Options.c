@@ -15,6 +15,10 @@ static cc_bool savingPaused;
 #if defined CC_BUILD_WEB || defined CC_BUILD_MOBILE || defined CC_BUILD_CONSOLE
 	#define OPTIONS_SAVE_IMMEDIATELY
 #endif
+/* Avoid blocking the main thread on rewriting options.txt whenever an option changes */
+#if defined OPTIONS_SAVE_IMMEDIATELY && !defined CC_BUILD_COOPTHREADED
+	#define OPTIONS_SAVE_IN_BACKGROUND
+#endif
 
 void Options_Free(void) {
 	StringsBuffer_Clear(&Options);
@@ -45,32 +49,146 @@ void Options_Load(void) {
 	Options_LoadResult = EntryList_Load(&Options, "options.txt",         '=', NULL);
 }
 
-void Options_Reload(void) {
-	cc_string entry, key, value;
-	int i;
+#ifdef OPTIONS_SAVE_IN_BACKGROUND
+/* Changes are only written once no further changes have been made for this long, */
+/*  so that e.g. dragging a slider in a menu results in just one write */
+#define OPTIONS_SAVE_DELAY_MS 500
+
+static void* save_thread;
+static void* save_waitable;
+/* Held by the main thread while changing Options, and by the saver thread while copying it */
+static void* save_mutex;
+static int save_requests;
+static cc_bool save_quit;
+static struct StringsBuffer save_snapshot;
+
+static CC_INLINE int Options_SaveRequests(void) {
+	int requests;
+	Mutex_Lock(save_mutex);
+	{
+		requests = save_quit ? -1 : save_requests;
+	}
+	Mutex_Unlock(save_mutex);
+	return requests;
+}
 
-	/* Reset all the unchanged options */
-	for (i = Options.count - 1; i >= 0; i--) {
-		entry = StringsBuffer_UNSAFE_Get(&Options, i);
-		String_UNSAFE_Separate(&entry, '=', &key, &value);
+static void Options_SaveLoop(void) {
+	int i, requests, saved = 0;
+	cc_string entry;
+	cc_bool quit;
+
+	for (;;) {
+		Waitable_Wait(save_waitable);
+
+		do {
+			requests = Options_SaveRequests();
+			if (requests == -1) break;
+			Waitable_WaitFor(save_waitable, OPTIONS_SAVE_DELAY_MS);
+		} while (requests != Options_SaveRequests());
+
+		StringsBuffer_SetLengthBits(&save_snapshot, Options._lenShift);
+		StringsBuffer_Init(&save_snapshot);
+
+		Mutex_Lock(save_mutex);
+		{
+			requests = save_requests;
+			quit     = save_quit;
+
+			for (i = 0; i < Options.count; i++) {
+				StringsBuffer_UNSAFE_GetRaw(&Options, i, &entry);
+				StringsBuffer_Add(&save_snapshot, &entry);
+			}
+		}
+		Mutex_Unlock(save_mutex);
+
+		if (requests != saved) EntryList_Save(&save_snapshot, "options.txt");
+		saved = requests;
+		StringsBuffer_Clear(&save_snapshot);
+		if (quit) return;
+	}
+}
+
+/* NOTE: changedOpts is only cleared once the saver thread has written the changes (see FinishSaving) */
+static void SaveOptions(void) {
+	if (!save_thread) {
+		save_quit     = false;
+		save_mutex    = Mutex_Create("Options saver");
+		save_waitable = Waitable_Create("Options saver");
+		Thread_Run(&save_thread, Options_SaveLoop, 64 * 1024, "Options saver");
+	}
 
-		if (HasChanged(&key)) continue;
-		StringsBuffer_Remove(&Options, i);
+	Mutex_Lock(save_mutex);
+	{
+		save_requests++;
 	}
-	/* Load only options which have not changed */
-	Options_LoadResult = EntryList_Load(&Options, "options.txt", '=', Options_LoadFilter);
+	Mutex_Unlock(save_mutex);
+	Waitable_Signal(save_waitable);
 }
 
+/* Writes any pending changes to options.txt, then stops the saver thread */
+static void FinishSaving(void) {
+	if (!save_thread) return;
+
+	Mutex_Lock(save_mutex);
+	{
+		save_quit = true;
+	}
+	Mutex_Unlock(save_mutex);
+	Waitable_Signal(save_waitable);
+
+	Thread_Join(save_thread);
+	Waitable_Free(save_waitable);
+	Mutex_Free(save_mutex);
+	save_thread = NULL;
+	save_mutex  = NULL;
+
+	/* options.txt now contains every change, unless some were made while saving was paused */
+	if (!savingPaused) StringsBuffer_Clear(&changedOpts);
+}
+#define Options_LockSave()   if (save_mutex) Mutex_Lock(save_mutex)
+#define Options_UnlockSave() if (save_mutex) Mutex_Unlock(save_mutex)
+#else
+#ifdef OPTIONS_SAVE_IMMEDIATELY
 static void SaveOptions(void) {
 	EntryList_Save(&Options, "options.txt");
 	StringsBuffer_Clear(&changedOpts);
 }
+#endif
+
+static void FinishSaving(void) { }
+#define Options_LockSave()
+#define Options_UnlockSave()
+#endif
+
+void Options_Reload(void) {
+	cc_string entry, key, value;
+	int i;
+	/* Make sure options.txt is up to date first, otherwise just changed options would be lost */
+	FinishSaving();
+
+	Options_LockSave();
+	{
+		/* Reset all the unchanged options */
+		for (i = Options.count - 1; i >= 0; i--) {
+			entry = StringsBuffer_UNSAFE_Get(&Options, i);
+			String_UNSAFE_Separate(&entry, '=', &key, &value);
+
+			if (HasChanged(&key)) continue;
+			StringsBuffer_Remove(&Options, i);
+		}
+		/* Load only options which have not changed */
+		Options_LoadResult = EntryList_Load(&Options, "options.txt", '=', Options_LoadFilter);
+	}
+	Options_UnlockSave();
+}
 
 void Options_SaveIfChanged(void) {
+	FinishSaving();
 	if (!changedOpts.count) return;
 	
 	Options_Reload();
-	SaveOptions();
+	EntryList_Save(&Options, "options.txt");
+	StringsBuffer_Clear(&changedOpts);
 }
 
 void Options_PauseSaving(void) { savingPaused = true; }
@@ -179,10 +297,17 @@ void Options_Set(const char* keyRaw, const cc_string* value) {
 }
 
 void Options_SetString(const cc_string* key, const cc_string* value) {
+	cc_bool removed;
+
 	if (!value || !value->length) {
-		if (!EntryList_Remove(&Options, key, '=')) return;
+		Options_LockSave();
+		removed = EntryList_Remove(&Options, key, '=');
+		Options_UnlockSave();
+		if (!removed) return;
 	} else {
+		Options_LockSave();
 		EntryList_Set(&Options, key, value, '=');
+		Options_UnlockSave();
 	}
 
 #if defined OPTIONS_SAVE_IMMEDIATELY
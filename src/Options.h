@@ -13,6 +13,8 @@ Copyright 2014-2025 ClassiCube | Licensed under BSD-3
 #define OPT_FORCE_OPENAL "forceopenal"
 #define OPT_MIN_MUSIC_DELAY "music-mindelay"
 #define OPT_MAX_MUSIC_DELAY "music-maxdelay"
+#define OPT_MUSIC_BUFFERS "music-buffers"
+#define OPT_SOUNDS_MIXER "sounds-mixer"
 
 #define OPT_VIEW_DISTANCE "viewdist"
 #define OPT_BLOCK_PHYSICS "singleplayerphysics"
@@ -23,10 +25,21 @@ Copyright 2014-2025 ClassiCube | Licensed under BSD-3
 #define OPT_DEFAULT_TEX_PACK "defaulttexpack"
 #define OPT_VIEW_BOBBING "viewbobbing"
 #define OPT_ENTITY_SHADOW "entityshadow"
+#define OPT_ENTITY_ANIM_LOD "entityanimlod"
+#define OPT_ENTITY_LIMB_LOD "entitylimblod"
 #define OPT_RENDER_TYPE "normal"
 #define OPT_SMOOTH_LIGHTING "gfx-smoothlighting"
 #define OPT_LIGHTING_MODE "gfx-lightingmode"
 #define OPT_MIPMAPS "gfx-mipmaps"
+#define OPT_COMPRESSED_TEXTURES "gfx-compressedtextures"
+#define OPT_LIQUID_ANIM_FRAMES "gfx-liquidanimframes"
+#define OPT_GPU_MIPMAPS "gfx-gpumipmaps"
+#define OPT_GPU_MODELS "gfx-gpumodels"
+#define OPT_MAX_PARTICLES "gfx-maxparticles"
+#define OPT_GPU_PARTICLES "gfx-gpuparticles"
+#define OPT_DYNAMIC_RES_FPS "gfx-dynamicresfps"
+#define OPT_SKINS_VRAM "gfx-skinsvram"
+#define OPT_SKINS_ATLAS "gfx-skinsatlas"
 #define OPT_CHAT_LOGGING "chat-logging"
 #define OPT_WINDOW_WIDTH "window-width"
 #define OPT_WINDOW_HEIGHT "window-height"
@@ -71,6 +84,16 @@ Copyright 2014-2025 ClassiCube | Licensed under BSD-3
 #define OPT_CLASSIC_CHAT "nostalgia-classicchat"
 #define OPT_CLASSIC_INVENTORY "nostalgia-classicinventory"
 #define OPT_MAX_CHUNK_UPDATES "gfx-maxchunkupdates"
+#define OPT_BUILDER_THREADS "gfx-builderthreads"
+#define OPT_LIGHT_THREADS "gfx-lightthreads"
+#define OPT_SOFTGPU_THREADS "gfx-softgputhreads"
+#define OPT_CHUNK_BUILD_TIME "gfx-chunkbuildtime"
+#define OPT_CHUNK_MESH_MEMORY "gfx-chunkmeshmemory"
+#define OPT_GREEDY_MESHING "gfx-greedymeshing"
+#define OPT_OCCLUSION_CULLING "gfx-occlusionculling"
+#define OPT_COMPACT_VERTICES "gfx-compactvertices"
+#define OPT_MESH_CACHE "gfx-meshcache"
+#define OPT_LOD_DISTANCE "gfx-loddistance"
 #define OPT_CAMERA_MASS "cameramass"
 #define OPT_CAMERA_SMOOTH "camera-smooth"
 #define OPT_GRAB_CURSOR "win-grab-cursor"
@@ -79,12 +102,20 @@ Copyright 2014-2025 ClassiCube | Licensed under BSD-3
 #define OPT_TOUCH_SCALE "gui-touchscale"
 #define OPT_HTTP_ONLY "http-no-https"
 #define OPT_HTTPS_VERIFY "https-verify"
+#define OPT_HTTP_WORKERS "http-workers"
 #define OPT_SKIN_SERVER "http-skinserver"
 #define OPT_RAW_INPUT "win-raw-input"
 #define OPT_DPI_SCALING "win-dpi-scaling"
 #define OPT_GAME_VERSION "game-version"
 #define OPT_INV_SCROLLBAR_SCALE "inv-scrollbar-scale"
 #define OPT_ANAGLYPH3D "anaglyph-3d"
+#define OPT_SAVE_COMPRESSION "save-compression"
+#define OPT_SAVE_THREADS "save-threads"
+#define OPT_GEN_THREADS "gen-threads"
+#define OPT_SAVE_BACKGROUND "save-background"
+#define OPT_NET_THREAD "net-thread"
+#define OPT_NET_STATS_LOG "net-stats-log"
+#define OPT_NET_CAPTURE "net-capture"
 
 #define OPT_SELECTED_BLOCK_OUTLINE_COLOR "selected-block-outline-color"
 #define OPT_SELECTED_BLOCK_OUTLINE_OPACITY "selected-block-outline-opacity"
@@ -9,12 +9,19 @@
 #include "Funcs.h"
 #include "Game.h"
 #include "Event.h"
-
-#ifdef CC_BUILD_TINYMEM
-	#define PARTICLES_MAX 10
+#include "Options.h"
+#include "Platform.h"
+
+/* Default maximum number of particles of each type */
+#if defined CC_BUILD_TINYMEM
+	#define PARTICLES_DEF_MAX 10
+#elif defined CC_BUILD_LOWMEM
+	#define PARTICLES_DEF_MAX 600
 #else
-	#define PARTICLES_MAX 600
+	#define PARTICLES_DEF_MAX 2000
 #endif
+/* NOTE: All particles of one type are drawn from a single dynamic VB */
+#define PARTICLES_MAX_LIMIT (GFX_MAX_VERTICES / 4)
 
 
 /*########################################################################################################################*
@@ -24,6 +31,24 @@ static GfxResourceID particles_TexId, particles_VB;
 static RNGState rnd;
 static cc_bool hitTerrain;
 typedef cc_bool (*CanPassThroughFunc)(BlockID b);
+/* Maximum number of particles of each type */
+static int particles_max;
+/* Billboards of the particles currently being drawn */
+static struct GfxBillboard* particles_bb;
+/* Whether to expand particles into quads on the GPU instead of the CPU */
+static cc_bool particles_gpu;
+#define Particles_UseGpu() (particles_gpu && Gfx.SupportsBillboards)
+
+/* Returns the index of the slot to store a newly spawned particle in */
+/* If all slots are used, existing particles are replaced in turn */
+static int Particles_NextSlot(int* count, int* replace) {
+	int i;
+	if (*count < particles_max) return (*count)++;
+
+	i = *replace;
+	*replace = (i + 1) % particles_max;
+	return i;
+}
 
 void Particle_DoRender(const Vec2* size, const Vec3* pos, const TextureRec* rec, PackedCol col, struct VertexTextured* v) {
 	struct Matrix* view;
@@ -44,6 +69,45 @@ void Particle_DoRender(const Vec2* size, const Vec3* pos, const TextureRec* rec,
 	v->x = centre.x + aX - bX; v->y = centre.y + aY - bY; v->z = centre.z + aZ - bZ; v->Col = col; v->U = rec->u2; v->V = rec->v2; v++;
 }
 
+static void Particle_MakeBillboard(float size, const Vec3* pos, const TextureRec* rec, PackedCol col, struct GfxBillboard* b) {
+	b->x = pos->x; b->y = pos->y; b->z = pos->z;
+	b->size = size;
+	b->col  = col;
+	b->u1 = rec->u1; b->v1 = rec->v1;
+	b->u2 = rec->u2; b->v2 = rec->v2;
+}
+
+/* Uploads the vertices of the given billboards, when they can't be expanded on the GPU */
+static void Particles_Upload(const struct GfxBillboard* items, int count) {
+	struct VertexTextured* data;
+	TextureRec rec;
+	Vec2 size;
+	Vec3 pos;
+	int i;
+	if (Particles_UseGpu()) return;
+
+	data = (struct VertexTextured*)Gfx_LockDynamicVb(particles_VB, 
+										VERTEX_FORMAT_TEXTURED, count * 4);
+	for (i = 0; i < count; i++, items++) {
+		pos.x  = items->x;  pos.y  = items->y;  pos.z  = items->z;
+		rec.u1 = items->u1; rec.v1 = items->v1; rec.u2 = items->u2; rec.v2 = items->v2;
+		size.x = items->size; size.y = size.x;
+
+		Particle_DoRender(&size, &pos, &rec, items->col, data);
+		data += 4;
+	}
+	Gfx_UnlockDynamicVb(particles_VB);
+}
+
+/* Draws billboards [offset, offset + count) of those previously given to Particles_Upload */
+static void Particles_Draw(const struct GfxBillboard* items, int count, int offset) {
+	if (Particles_UseGpu()) {
+		Gfx_DrawBillboards(items + offset, count);
+	} else {
+		Gfx_DrawVb_IndexedTris_Range(count * 4, offset * 4);
+	}
+}
+
 static cc_bool CollidesHor(Vec3* nextPos, BlockID block) {
 	Vec3 horPos = Vec3_Create3((float)Math_Floor(nextPos->x), 0.0f, (float)Math_Floor(nextPos->z));
 	Vec3 min, max;
@@ -131,8 +195,8 @@ static cc_bool PhysicsTick(struct Particle* p, float gravity, CanPassThroughFunc
 /*########################################################################################################################*
 *-------------------------------------------------------Rain particle-----------------------------------------------------*
 *#########################################################################################################################*/
-static struct Particle rain_Particles[PARTICLES_MAX];
-static int rain_count;
+static struct Particle* rain_Particles;
+static int rain_count, rain_replace;
 static TextureRec rain_rec = { 2.0f/128.0f, 14.0f/128.0f, 5.0f/128.0f, 16.0f/128.0f };
 
 static cc_bool RainParticle_CanPass(BlockID block) {
@@ -145,42 +209,32 @@ static cc_bool RainParticle_Tick(struct Particle* p, float delta) {
 	return PhysicsTick(p, 3.5f, RainParticle_CanPass, delta) || hitTerrain;
 }
 
-static void RainParticle_Render(struct Particle* p, float t, struct VertexTextured* vertices) {
+static void RainParticle_Render(struct Particle* p, float t, struct GfxBillboard* bb) {
 	Vec3 pos;
-	Vec2 size;
 	PackedCol col;
 	int x, y, z;
 
 	Vec3_Lerp(&pos, &p->lastPos, &p->nextPos, t);
-	size.x = p->size * 0.015625f; size.y = size.x;
-
 	x = Math_Floor(pos.x); y = Math_Floor(pos.y); z = Math_Floor(pos.z);
 	col = Lighting.Color(x, y, z);
-	Particle_DoRender(&size, &pos, &rain_rec, col, vertices);
+	Particle_MakeBillboard(p->size * 0.015625f, &pos, &rain_rec, col, bb);
 }
 
 static void Rain_Render(float t) {
-	struct VertexTextured* data;
 	int i;
 	if (!rain_count) return;
 	
-	data = (struct VertexTextured*)Gfx_LockDynamicVb(particles_VB, 
-										VERTEX_FORMAT_TEXTURED, rain_count * 4);
 	for (i = 0; i < rain_count; i++) {
-		RainParticle_Render(&rain_Particles[i], t, data);
-		data += 4;
+		RainParticle_Render(&rain_Particles[i], t, &particles_bb[i]);
 	}
 
 	Gfx_BindTexture(particles_TexId);
-	Gfx_UnlockDynamicVb(particles_VB);
-	Gfx_DrawVb_IndexedTris(rain_count * 4);
+	Particles_Upload(particles_bb, rain_count);
+	Particles_Draw(particles_bb,   rain_count, 0);
 }
 
 static void Rain_RemoveAt(int i) {
-	for (; i < rain_count - 1; i++) {
-		rain_Particles[i] = rain_Particles[i + 1];
-	}
-	rain_count--;
+	rain_Particles[i] = rain_Particles[--rain_count];
 }
 
 static void Rain_Tick(float delta) {
@@ -197,8 +251,7 @@ void Particles_RainSnowEffect(float x, float y, float z) {
 	int i, type;
 
 	for (i = 0; i < 2; i++) {
-		if (rain_count == PARTICLES_MAX) Rain_RemoveAt(0);
-		p = &rain_Particles[rain_count++];
+		p = &rain_Particles[Particles_NextSlot(&rain_count, &rain_replace)];
 
 		p->velocity.x = Random_Float(&rnd) * 0.8f - 0.4f; /* [-0.4, 0.4] */
 		p->velocity.z = Random_Float(&rnd) * 0.8f - 0.4f;
@@ -227,10 +280,10 @@ struct TerrainParticle {
 	BlockID block;
 };
 
-static struct TerrainParticle terrain_particles[PARTICLES_MAX];
-static int terrain_count;
-static cc_uint16 terrain_1DCount[ATLAS1D_MAX_ATLASES];
-static cc_uint16 terrain_1DIndices[ATLAS1D_MAX_ATLASES];
+static struct TerrainParticle* terrain_particles;
+static int terrain_count, terrain_replace;
+static int terrain_1DCount[ATLAS1D_MAX_ATLASES];
+static int terrain_1DIndices[ATLAS1D_MAX_ATLASES];
 
 static cc_bool TerrainParticle_CanPass(BlockID block) {
 	cc_uint8 draw = Blocks.Draw[block];
@@ -241,14 +294,12 @@ static cc_bool TerrainParticle_Tick(struct TerrainParticle* p, float delta) {
 	return PhysicsTick(&p->base, Blocks.ParticleGravity[p->block], TerrainParticle_CanPass, delta);
 }
 
-static void TerrainParticle_Render(struct TerrainParticle* p, float t, struct VertexTextured* vertices) {
+static void TerrainParticle_Render(struct TerrainParticle* p, float t, struct GfxBillboard* bb) {
 	PackedCol col = PACKEDCOL_WHITE;
 	Vec3 pos;
-	Vec2 size;
 	int x, y, z;
 
 	Vec3_Lerp(&pos, &p->base.lastPos, &p->base.nextPos, t);
-	size.x = p->base.size * 0.015625f; size.y = size.x;
 	
 	if (!Blocks.Brightness[p->block]) {
 		x = Math_Floor(pos.x); y = Math_Floor(pos.y); z = Math_Floor(pos.z);
@@ -256,7 +307,7 @@ static void TerrainParticle_Render(struct TerrainParticle* p, float t, struct Ve
 	}
 
 	Block_Tint(col, p->block);
-	Particle_DoRender(&size, &pos, &p->rec, col, vertices);
+	Particle_MakeBillboard(p->base.size * 0.015625f, &pos, &p->rec, col, bb);
 }
 
 static void Terrain_Update1DCounts(void) {
@@ -268,7 +319,7 @@ static void Terrain_Update1DCounts(void) {
 	}
 	for (i = 0; i < terrain_count; i++) {
 		index = Atlas1D_Index(terrain_particles[i].texLoc);
-		terrain_1DCount[index] += 4;
+		terrain_1DCount[index]++;
 	}
 	for (i = 1; i < Atlas1D.Count; i++) {
 		terrain_1DIndices[i] = terrain_1DIndices[i - 1] + terrain_1DCount[i - 1];
@@ -276,42 +327,32 @@ static void Terrain_Update1DCounts(void) {
 }
 
 static void Terrain_Render(float t) {
-	struct VertexTextured* data;
-	struct VertexTextured* ptr;
 	int offset = 0;
 	int i, index;
 	if (!terrain_count) return;
 
-	data = (struct VertexTextured*)Gfx_LockDynamicVb(particles_VB, 
-										VERTEX_FORMAT_TEXTURED, terrain_count * 4);
 	Terrain_Update1DCounts();
 	for (i = 0; i < terrain_count; i++) 
 	{
 		index = Atlas1D_Index(terrain_particles[i].texLoc);
-		ptr   = data + terrain_1DIndices[index];
-
-		TerrainParticle_Render(&terrain_particles[i], t, ptr);
-		terrain_1DIndices[index] += 4;
+		TerrainParticle_Render(&terrain_particles[i], t, &particles_bb[terrain_1DIndices[index]]);
+		terrain_1DIndices[index]++;
 	}
 
-	Gfx_UnlockDynamicVb(particles_VB);
+	Particles_Upload(particles_bb, terrain_count);
 	for (i = 0; i < Atlas1D.Count; i++) 
 	{
 		int partCount = terrain_1DCount[i];
 		if (!partCount) continue;
 
 		Atlas1D_Bind(i);
-		Gfx_DrawVb_IndexedTris_Range(partCount, offset);
+		Particles_Draw(particles_bb, partCount, offset);
 		offset += partCount;
 	}
 }
 
 static void Terrain_RemoveAt(int i) {
-	for (; i < terrain_count - 1; i++) 
-	{
-		terrain_particles[i] = terrain_particles[i + 1];
-	}
-	terrain_count--;
+	terrain_particles[i] = terrain_particles[--terrain_count];
 }
 
 static void Terrain_Tick(float delta) {
@@ -375,8 +416,7 @@ void Particles_BreakBlockEffect(IVec3 coords, BlockID old, BlockID now) {
 				if (cell.x < minBB.x || cell.x > maxBB.x || cell.y < minBB.y
 					|| cell.y > maxBB.y || cell.z < minBB.z || cell.z > maxBB.z) continue;
 
-				if (terrain_count == PARTICLES_MAX) Terrain_RemoveAt(0);
-				p = &terrain_particles[terrain_count++];
+				p = &terrain_particles[Particles_NextSlot(&terrain_count, &terrain_replace)];
 
 				/* centre random offset around [-0.2, 0.2] */
 				p->base.velocity.x = CELL_CENTRE + (cellX - 0.5f) + (Random_Float(&rnd) * 0.4f - 0.2f);
@@ -417,8 +457,8 @@ struct CustomParticle {
 };
 
 struct CustomParticleEffect Particles_CustomEffects[256];
-static struct CustomParticle custom_particles[PARTICLES_MAX];
-static int custom_count;
+static struct CustomParticle* custom_particles;
+static int custom_count, custom_replace;
 static cc_uint8 collideFlags;
 #define EXPIRES_UPON_TOUCHING_GROUND (1 << 0)
 #define SOLID_COLLIDES  (1 << 1)
@@ -446,10 +486,9 @@ static cc_bool CustomParticle_Tick(struct CustomParticle* p, float delta) {
 		|| (hitTerrain && (e->collideFlags & EXPIRES_UPON_TOUCHING_GROUND));
 }
 
-static void CustomParticle_Render(struct CustomParticle* p, float t, struct VertexTextured* vertices) {
+static void CustomParticle_Render(struct CustomParticle* p, float t, struct GfxBillboard* bb) {
 	struct CustomParticleEffect* e = &Particles_CustomEffects[p->effectId];
 	Vec3 pos;
-	Vec2 size;
 	PackedCol col;
 	TextureRec rec = e->rec;
 	int x, y, z;
@@ -462,37 +501,28 @@ static void CustomParticle_Render(struct CustomParticle* p, float t, struct Vert
 	rec.u2 += shiftU;/* * 0.0078125f; */
 
 	Vec3_Lerp(&pos, &p->base.lastPos, &p->base.nextPos, t);
-	size.x = p->base.size; size.y = size.x;
-
 	x = Math_Floor(pos.x); y = Math_Floor(pos.y); z = Math_Floor(pos.z);
 	col = e->fullBright ? PACKEDCOL_WHITE : Lighting.Color(x, y, z);
 	col = PackedCol_Tint(col, e->tintCol);
 
-	Particle_DoRender(&size, &pos, &rec, col, vertices);
+	Particle_MakeBillboard(p->base.size, &pos, &rec, col, bb);
 }
 
 static void Custom_Render(float t) {
-	struct VertexTextured* data;
 	int i;
 	if (!custom_count) return;
 
-	data = (struct VertexTextured*)Gfx_LockDynamicVb(particles_VB, 
-										VERTEX_FORMAT_TEXTURED, custom_count * 4);
 	for (i = 0; i < custom_count; i++) {
-		CustomParticle_Render(&custom_particles[i], t, data);
-		data += 4;
+		CustomParticle_Render(&custom_particles[i], t, &particles_bb[i]);
 	}
 
 	Gfx_BindTexture(particles_TexId);
-	Gfx_UnlockDynamicVb(particles_VB);
-	Gfx_DrawVb_IndexedTris(custom_count * 4);
+	Particles_Upload(particles_bb, custom_count);
+	Particles_Draw(particles_bb,   custom_count, 0);
 }
 
 static void Custom_RemoveAt(int i) {
-	for (; i < custom_count - 1; i++) {
-		custom_particles[i] = custom_particles[i + 1];
-	}
-	custom_count--;
+	custom_particles[i] = custom_particles[--custom_count];
 }
 
 static void Custom_Tick(float delta) {
@@ -507,7 +537,7 @@ static void Custom_Tick(float delta) {
 void Particles_CustomEffect(int effectID, float x, float y, float z, float originX, float originY, float originZ) {
 	struct CustomParticle* p;
 	struct CustomParticleEffect* e = &Particles_CustomEffects[effectID];
-	int i, count = e->particleCount;
+	int i, index, count = e->particleCount;
 	Vec3 offset, delta, origin;
 	float d;
 
@@ -515,8 +545,8 @@ void Particles_CustomEffect(int effectID, float x, float y, float z, float origi
 
 	for (i = 0; i < count; i++) 
 	{
-		if (custom_count == PARTICLES_MAX) Custom_RemoveAt(0);
-		p = &custom_particles[custom_count++];
+		index = Particles_NextSlot(&custom_count, &custom_replace);
+		p     = &custom_particles[index];
 		p->effectId = effectID;
 
 		offset.x = Random_Float(&rnd) - 0.5f;
@@ -550,12 +580,18 @@ void Particles_CustomEffect(int effectID, float x, float y, float z, float origi
 		/* Don't spawn custom particle inside a block (otherwise it appears */
 		/*   for a few frames, then disappears in first PhysicsTick call)*/
 		collideFlags = e->collideFlags;
-		if (IntersectsBlock(&p->base, CustomParticle_CanPass)) custom_count--;
+		if (IntersectsBlock(&p->base, CustomParticle_CanPass)) Custom_RemoveAt(index);
 	}
 }
+static void Custom_Alloc(void) {
+	custom_particles = (struct CustomParticle*)Mem_Alloc(particles_max, sizeof(struct CustomParticle), "custom particles");
+}
+static void Custom_Free(void) { Mem_Free(custom_particles); custom_particles = NULL; }
 #else
 static int custom_count;
 
+static void Custom_Alloc(void) { }
+static void Custom_Free(void)  { }
 static void Custom_Render(float t) { }
 static void Custom_Tick(float delta) { }
 #endif
@@ -569,7 +605,7 @@ void Particles_Render(float t) {
 
 	if (Gfx.LostContext) return;
 	if (!particles_VB)
-		particles_VB = Gfx_CreateDynamicVb(VERTEX_FORMAT_TEXTURED, PARTICLES_MAX * 4);
+		particles_VB = Gfx_CreateDynamicVb(VERTEX_FORMAT_TEXTURED, particles_max * 4);
 
 	Gfx_SetAlphaTest(true);
 
@@ -614,11 +650,25 @@ static void OnInit(void) {
 	Random_SeedFromCurrentTime(&rnd);
 	TextureEntry_Register(&particles_entry);
 
+	particles_max     = Options_GetInt(OPT_MAX_PARTICLES, 10, PARTICLES_MAX_LIMIT, PARTICLES_DEF_MAX);
+	rain_Particles    = (struct Particle*)Mem_Alloc(particles_max, sizeof(struct Particle), "rain particles");
+	terrain_particles = (struct TerrainParticle*)Mem_Alloc(particles_max, sizeof(struct TerrainParticle), "terrain particles");
+	particles_bb      = (struct GfxBillboard*)Mem_Alloc(particles_max, sizeof(struct GfxBillboard), "particle billboards");
+	particles_gpu     = Options_GetBool(OPT_GPU_PARTICLES, true);
+	Custom_Alloc();
+
 	Event_Register_(&UserEvents.BlockChanged, NULL, OnBreakBlockEffect_Handler);
 	Event_Register_(&GfxEvents.ContextLost,   NULL, OnContextLost);
 }
 
-static void OnFree(void) { OnContextLost(NULL); }
+static void OnFree(void) {
+	OnContextLost(NULL);
+	Mem_Free(rain_Particles);    rain_Particles    = NULL;
+	Mem_Free(terrain_particles); terrain_particles = NULL;
+	Mem_Free(particles_bb);      particles_bb      = NULL;
+	Custom_Free();
+	rain_count = 0; terrain_count = 0; custom_count = 0;
+}
 
 static void OnReset(void) { rain_count = 0; terrain_count = 0; custom_count = 0; }
 
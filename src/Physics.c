@@ -7,6 +7,7 @@
 #include "Funcs.h"
 #include "Logger.h"
 #include "Entity.h"
+#include "Utils.h"
 
 
 /*########################################################################################################################*
@@ -128,7 +129,7 @@ cc_bool Intersection_RayIntersectsBox(Vec3 origin, Vec3 invDir, Vec3 min, Vec3 m
 *#########################################################################################################################*/
 #define SEARCHER_STATES_MIN 64
 static struct SearcherState searcherDefaultStates[SEARCHER_STATES_MIN];
-static cc_uint32 searcherCapacity = SEARCHER_STATES_MIN;
+static int searcherCapacity = SEARCHER_STATES_MIN;
 struct SearcherState* Searcher_States = searcherDefaultStates;
 
 static void Searcher_QuickSort(int left, int right) {
@@ -152,9 +153,8 @@ static void Searcher_QuickSort(int left, int right) {
 int Searcher_FindReachableBlocks(struct Entity* entity, struct AABB* entityBB, struct AABB* entityExtentBB) {
 	Vec3 vel = entity->Velocity;
 	IVec3 min, max;
-	cc_uint32 elements;
 	struct SearcherState* curState;
-	int count;
+	int count = 0;
 
 	BlockID block;
 	struct AABB blockBB;
@@ -173,19 +173,16 @@ int Searcher_FindReachableBlocks(struct Entity* entity, struct AABB* entityBB, s
 
 	IVec3_Floor(&min, &entityExtentBB->Min);
 	IVec3_Floor(&max, &entityExtentBB->Max);
-	elements = (max.x - min.x + 1) * (max.y - min.y + 1) * (max.z - min.z + 1);
-
-	if (elements > searcherCapacity) {
-		Searcher_Free();
-		searcherCapacity = elements;
-		Searcher_States  = (struct SearcherState*)Mem_Alloc(elements, sizeof(struct SearcherState), "collision search states");
-	}
-	curState = Searcher_States;
 
 	/* Order loops so that we minimise cache misses */
 	for (y = min.y; y <= max.y; y++) {
 		for (z = min.z; z <= max.z; z++) {
 			for (x = min.x; x <= max.x; x++) {
+				/* Skip over the rest of this row within chunks that can't have any solid blocks */
+				if (World_Contains(x, y, z) && World_IsChunkEmpty(x >> CHUNK_SHIFT, y >> CHUNK_SHIFT, z >> CHUNK_SHIFT)) {
+					x |= CHUNK_MAX; continue;
+				}
+
 				block = World_GetPhysicsBlock(x, y, z);
 				if (Blocks.Collide[block] != COLLIDE_SOLID) continue;
 
@@ -199,16 +196,21 @@ int Searcher_FindReachableBlocks(struct Entity* entity, struct AABB* entityBB, s
 				Searcher_CalcTime(&vel, entityBB, &blockBB, &tx, &ty, &tz);
 				if (tx > 1.0f || ty > 1.0f || tz > 1.0f) continue;
 
+				/* Only reachable solid blocks are stored, so the array rarely needs to grow */
+				if (count == searcherCapacity) {
+					Utils_Resize((void**)&Searcher_States, &searcherCapacity,
+								sizeof(struct SearcherState), SEARCHER_STATES_MIN, searcherCapacity);
+				}
+				curState = &Searcher_States[count++];
+
 				curState->x = (x << 3) | (block  & 0x007);
 				curState->y = (y << 4) | ((block & 0x078) >> 3);
 				curState->z = (z << 3) | ((block & 0x380) >> 7);
 				curState->tSquared = tx * tx + ty * ty + tz * tz;
-				curState++;
 			}
 		}
 	}
 
-	count = (int)(curState - Searcher_States);
 	if (count) Searcher_QuickSort(0, count - 1);
 	return count;
 }
@@ -151,6 +151,21 @@ static BlockID Picking_GetOutside(int x, int y, int z, IVec3 origin) {
 	return BLOCK_AIR;
 }
 
+/* Steps the ray out of the current chunk if it only contains empty blocks, as neither test can hit those */
+static cc_bool SkipEmptyChunk(struct RayTracer* t) {
+	int cx = t->pos.x >> CHUNK_SHIFT, cy = t->pos.y >> CHUNK_SHIFT, cz = t->pos.z >> CHUNK_SHIFT;
+	int i;
+	if (!World_Contains(t->pos.x, t->pos.y, t->pos.z) || !World_IsChunkEmpty(cx, cy, cz)) return false;
+
+	/* A ray can cross at most 3 * CHUNK_SIZE cells before leaving a chunk */
+	for (i = 0; i < 3 * CHUNK_SIZE; i++) 
+	{
+		RayTracer_Step(t);
+		if ((t->pos.x >> CHUNK_SHIFT) != cx || (t->pos.y >> CHUNK_SHIFT) != cy || (t->pos.z >> CHUNK_SHIFT) != cz) break;
+	}
+	return true;
+}
+
 static cc_bool RayTrace(struct RayTracer* t, const Vec3* origin, const Vec3* dir, float reach, IntersectTest intersect) {
 	IVec3 pOrigin;
 	cc_bool insideMap;
@@ -175,6 +190,9 @@ static cc_bool RayTrace(struct RayTracer* t, const Vec3* origin, const Vec3* dir
 	reachSq   = reach * reach;
 		
 	for (i = 0; i < 25000; i++) {
+		/* Picking_GetOutside may treat cells on the edges of the map as bedrock, so can't skip those */
+		if (insideMap && SkipEmptyChunk(t)) continue;
+
 		x   = t->pos.x; y   = t->pos.y; z   = t->pos.z;
 		v.x = (float)x; v.y = (float)y; v.z = (float)z;
 
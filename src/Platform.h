@@ -181,6 +181,47 @@ CC_API void* Mem_Realloc(void* mem, cc_uint32 numElems, cc_uint32 elemsSize, con
 /* Frees an allocated a block of memory. Does nothing when passed NULL. */
 CC_API void  Mem_Free(void* mem);
 
+/* Allocates a block of memory from the map arena, with undetermined contents. Returns NULL on allocation failure. */
+/* Map arena memory is bump allocated from a few large blocks, which are all reclaimed at once */
+/*  by Mem_ResetMapArena when a new map is loaded. This avoids fragmenting the heap with per-map state. */
+/* NOTE: Must only be used from the main thread */
+CC_API void* Mem_TryMapAlloc(cc_uint32 numElems, cc_uint32 elemsSize);
+/* Allocates a block of memory from the map arena, with undetermined contents. Exits process on allocation failure. */
+CC_API void* Mem_MapAlloc(cc_uint32 numElems, cc_uint32 elemsSize, const char* place);
+/* Allocates a block of memory from the map arena, with contents of all 0. Exits process on allocation failure. */
+CC_API void* Mem_MapAllocCleared(cc_uint32 numElems, cc_uint32 elemsSize, const char* place);
+/* Frees a block of memory allocated from the map arena. Does nothing when passed NULL. */
+/* NOTE: The space is only reused before the next Mem_ResetMapArena once all later allocations are freed too */
+CC_API void  Mem_MapFree(void* mem);
+/* Reclaims all memory allocated from the map arena. */
+/* NOTE: Called when a new map starts loading, after components have been notified through WorldEvents.NewMap */
+void Mem_ResetMapArena(void);
+
+
+/*########################################################################################################################*
+*---------------------------------------------------Memory accounting-----------------------------------------------------*
+*#########################################################################################################################*/
+/* Kinds of resources that memory accounting tallies. Keys of different kinds never clash */
+enum MemStatsKind { MEMSTATS_HEAP, MEMSTATS_ARENA, MEMSTATS_VERTEXBUFFER, MEMSTATS_TEXTURE };
+/* Current and peak memory used by everything allocated from the same place */
+struct MemStatsPlace { const char* name; cc_uint64 curBytes, peakBytes; int count; };
+
+#ifdef CC_BUILD_MEMSTATS
+/* Tallies size bytes under the given place, until the resource identified by key is untracked. */
+/* NOTE: Mem_Alloc/Mem_MapAlloc and graphics resource creation already do this */
+CC_API void MemStats_Track(int kind, const void* key, cc_uint32 size, const char* place);
+/* Removes the resource identified by key from the tallies. Does nothing if it isn't tracked. */
+CC_API void MemStats_Untrack(int kind, const void* key);
+#else
+#define MemStats_Track(kind, key, size, place)
+#define MemStats_Untrack(kind, key)
+#endif
+/* Whether memory used by the top consumer is shown in the top left */
+extern cc_bool MemStats_ShowOverlay;
+/* Copies the tallies of up to maxPlaces places, from most to least memory currently used. */
+/* Returns the number of places copied, which is always 0 when memory accounting isn't compiled in. */
+CC_API int MemStats_Get(struct MemStatsPlace* places, int maxPlaces);
+
 
 /*########################################################################################################################*
 *----------------------------------------------------Memory modification--------------------------------------------------*
@@ -201,7 +242,11 @@ int Mem_Equal(const void* a, const void* b, cc_uint32 numBytes);
 *-----------------------------------------------------Logging functions---------------------------------------------------*
 *#########################################################################################################################*/
 /* Logs a debug message to console. */
+/* NOTE: The message may be written to the console later by a background thread */
 void Platform_Log(const char* msg, int len);
+/* Immediately writes out any log messages that have not been written to the console yet, */
+/*  then writes all further log messages immediately too. Used when the game crashes. */
+void Platform_FlushLog(void);
 void Platform_LogConst(const char* message);
 void Platform_Log1(const char* format, const void* a1);
 void Platform_Log2(const char* format, const void* a1, const void* a2);
@@ -271,6 +316,13 @@ void Directory_GetCachePath(cc_string* path);
 cc_result File_Create(cc_file* file, const cc_filepath* path);
 /* Attempts to open an existing file for reading. */
 cc_result File_Open(cc_file* file, const cc_filepath* path);
+/* Attempts to open an existing file for reading, that will mostly be read from start to end. */
+/* NOTE: This hints to the OS that it can read further ahead than usual, e.g. for zip and map files */
+#if defined CC_BUILD_POSIX || defined CC_BUILD_WIN
+cc_result File_OpenSequential(cc_file* file, const cc_filepath* path);
+#else
+#define   File_OpenSequential File_Open
+#endif
 /* Attempts to open an existing or create a new file for reading and writing. */
 cc_result File_OpenOrCreate(cc_file* file, const cc_filepath* path);
 /* Attempts to read data from the file. */
@@ -363,6 +415,9 @@ extern const cc_result ReturnCode_SocketDropped;
 /* Checks if the given socket is currently readable (i.e. has data available to read) */
 /* NOTE: A closed socket is also considered readable */
 cc_result Socket_CheckReadable(cc_socket s, cc_bool* readable);
+/* Blocks the calling thread until the socket is readable, or the given time has elapsed */
+/* NOTE: Only implemented on platforms with real threads (Windows and POSIX) */
+cc_result Socket_WaitReadable(cc_socket s, int milliseconds, cc_bool* readable);
 /* Checks if the given socket is currently writable (i.e. has finished connecting) */
 cc_result Socket_CheckWritable(cc_socket s, cc_bool* writable);
 /* If the input represents an IP address, then parses the input into a single IP address */
@@ -397,6 +452,8 @@ extern jclass  App_Class;
 extern jobject App_Instance;
 extern JavaVM* VM_Ptr;
 void Platform_TryLogJavaError(void);
+/* Returns how thermally throttled the device is (or soon will be), from 0 (not at all) to 3 (severely) */
+int Platform_GetThermalLevel(void);
 
 #define JavaGetCurrentEnv(env) (*VM_Ptr)->AttachCurrentThread(VM_Ptr, &env, NULL)
 #define JavaMakeConst(env, str) (*env)->NewStringUTF(env, str)
@@ -55,6 +55,7 @@ void* Mem_TryRealloc(void* mem, cc_uint32 numElems, cc_uint32 elemsSize) {
 }
 
 void Mem_Free(void* mem) {
+	MemStats_Untrack(MEMSTATS_HEAP, mem);
 	if (mem) ta_free(mem);
 }
 
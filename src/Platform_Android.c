@@ -167,6 +167,15 @@ jobject JavaCallObject(JNIEnv* env, const char* name, const char* sig, jvalue* a
 	return (*env)->CallObjectMethodA(env, App_Instance, method, args);
 }
 
+int Platform_GetThermalLevel(void) {
+	static jmethodID method;
+	JNIEnv* env;
+	JavaGetCurrentEnv(env);
+
+	if (!method) method = JavaGetIMethod(env, "getThermalLevel", "()I");
+	return JavaICall_Int(env, method, NULL);
+}
+
 void JavaCall_String_Void(const char* name, const cc_string* value) {
 	JNIEnv* env;
 	jvalue args[1];
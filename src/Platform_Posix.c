@@ -95,6 +95,7 @@ void* Mem_TryRealloc(void* mem, cc_uint32 numElems, cc_uint32 elemsSize) {
 }
 
 void Mem_Free(void* mem) {
+	MemStats_Untrack(MEMSTATS_HEAP, mem);
 	if (mem) free(mem);
 }
 
@@ -106,6 +107,13 @@ void Mem_Free(void* mem) {
 /* implemented in Platform_Android.c */
 #elif defined CC_BUILD_IOS
 /* implemented in interop_ios.m */
+#elif defined CC_BUILD_ASYNCLOG
+/* Platform_Log is implemented in _PlatformBase.h */
+static void Platform_WriteLog(const char* text, int len) {
+	int ret;
+	/* Avoid "ignoring return value of 'write' declared with attribute 'warn_unused_result'" warning */
+	ret = write(STDOUT_FILENO, text, len);
+}
 #else
 void Platform_Log(const char* msg, int len) {
 	int ret;
@@ -348,6 +356,19 @@ cc_result File_Open(cc_file* file, const cc_filepath* path) {
 	return File_Do(file, path->buffer, O_RDONLY | O_BINARY);
 #endif
 }
+cc_result File_OpenSequential(cc_file* file, const cc_filepath* path) {
+	cc_result res = File_Open(file, path);
+	if (res) return res;
+
+	/* Failing to apply the hint doesn't matter, reading still works as normal */
+	/* (posix_fadvise is only available from API level 21 on Android) */
+#if defined POSIX_FADV_SEQUENTIAL && !defined CC_BUILD_ANDROID
+	posix_fadvise(*file, 0, 0, POSIX_FADV_SEQUENTIAL);
+#elif defined F_RDAHEAD
+	fcntl(*file, F_RDAHEAD, 1);
+#endif
+	return 0;
+}
 cc_result File_Create(cc_file* file, const cc_filepath* path) {
 #if !defined CC_BUILD_OS2
 	return File_Do(file, path->buffer, O_RDWR | O_CREAT | O_TRUNC);
@@ -779,11 +800,13 @@ void Socket_Close(cc_socket s) {
 #if defined CC_BUILD_DARWIN || defined CC_BUILD_BEOS
 /* poll is broken on old OSX apparently https://daniel.haxx.se/docs/poll-vs-select.html */
 /* BeOS lacks support for poll */
-static cc_result Socket_Poll(cc_socket s, int mode, cc_bool* success) {
+static cc_result Socket_Poll(cc_socket s, int mode, int timeoutMS, cc_bool* success) {
 	fd_set set;
-	struct timeval time = { 0 };
+	struct timeval time;
 	int selectCount;
 
+	time.tv_sec  = timeoutMS / 1000;
+	time.tv_usec = (timeoutMS % 1000) * 1000;
 	FD_ZERO(&set);
 	FD_SET(s, &set);
 
@@ -798,13 +821,13 @@ static cc_result Socket_Poll(cc_socket s, int mode, cc_bool* success) {
 }
 #else
 #include <poll.h>
-static cc_result Socket_Poll(cc_socket s, int mode, cc_bool* success) {
+static cc_result Socket_Poll(cc_socket s, int mode, int timeoutMS, cc_bool* success) {
 	struct pollfd pfd;
 	int flags;
 
 	pfd.fd     = s;
 	pfd.events = mode == SOCKET_POLL_READ ? POLLIN : POLLOUT;
-	if (poll(&pfd, 1, 0) == -1) { *success = false; return errno; }
+	if (poll(&pfd, 1, timeoutMS) == -1) { *success = false; return errno; }
 	
 	/* to match select, closed socket still counts as readable */
 	flags    = mode == SOCKET_POLL_READ ? (POLLIN | POLLHUP) : POLLOUT;
@@ -814,12 +837,16 @@ static cc_result Socket_Poll(cc_socket s, int mode, cc_bool* success) {
 #endif
 
 cc_result Socket_CheckReadable(cc_socket s, cc_bool* readable) {
-	return Socket_Poll(s, SOCKET_POLL_READ, readable);
+	return Socket_Poll(s, SOCKET_POLL_READ, 0, readable);
+}
+
+cc_result Socket_WaitReadable(cc_socket s, int milliseconds, cc_bool* readable) {
+	return Socket_Poll(s, SOCKET_POLL_READ, milliseconds, readable);
 }
 
 cc_result Socket_CheckWritable(cc_socket s, cc_bool* writable) {
 	socklen_t resultSize = sizeof(socklen_t);
-	cc_result res = Socket_Poll(s, SOCKET_POLL_WRITE, writable);
+	cc_result res = Socket_Poll(s, SOCKET_POLL_WRITE, 0, writable);
 	if (res || *writable) return res;
 
 	/* https://stackoverflow.com/questions/29479953/so-error-value-after-successful-socket-operation */
@@ -882,7 +909,10 @@ cc_result Process_StartGame2(const cc_string* args, int numArgs) {
 	return Process_RawStart(path, argv);
 }
 #endif
-void Process_Exit(cc_result code) { exit(code); }
+void Process_Exit(cc_result code) { 
+	LogThread_Stop();
+	exit(code); 
+}
 
 /* Opening browser/starting shell is not really standardised */
 #if defined CC_BUILD_ANDROID
@@ -1370,6 +1400,7 @@ void Platform_Init(void) {
 	#endif
 	
 	Platform_InitPosix();
+	LogThread_Start();
 }
 #endif
 
@@ -98,6 +98,7 @@ void* Mem_TryRealloc(void* mem, cc_uint32 numElems, cc_uint32 elemsSize) {
 }
 
 void Mem_Free(void* mem) {
+	MemStats_Untrack(MEMSTATS_HEAP, mem);
 	if (mem) HeapFree(heap, 0, mem);
 }
 
@@ -115,22 +116,29 @@ cc_uint64 Stopwatch_ElapsedMicroseconds(cc_uint64 beg, cc_uint64 end) {
 static HANDLE conHandle;
 static BOOL hasDebugger;
 
-void Platform_Log(const char* msg, int len) {
+static void Platform_WriteLog(const char* text, int len) {
 	char tmp[2048 + 1];
 	DWORD wrote;
+	int part;
 
-	if (conHandle) {
-		WriteFile(conHandle, msg,  len, &wrote, NULL);
-		WriteFile(conHandle, "\n",   1, &wrote, NULL);
-	}
-
+	if (conHandle) WriteFile(conHandle, text, len, &wrote, NULL);
 	if (!hasDebugger) return;
-	len = min(len, 2048);
-	Mem_Copy(tmp, msg, len); tmp[len] = '\0';
 
-	OutputDebugStringA(tmp);
-	OutputDebugStringA("\n");
+	/* Several messages may be written out at once */
+	for (; len > 0; len -= part, text += part) 
+	{
+		part = min(len, 2048);
+		Mem_Copy(tmp, text, part); tmp[part] = '\0';
+		OutputDebugStringA(tmp);
+	}
+}
+
+#ifndef CC_BUILD_ASYNCLOG
+void Platform_Log(const char* msg, int len) {
+	Platform_WriteLog(msg,  len);
+	Platform_WriteLog("\n", 1);
 }
+#endif
 
 #define FILETIME_EPOCH      50491123200ULL
 #define FILETIME_UNIX_EPOCH 11644473600ULL
@@ -354,26 +362,29 @@ cc_result Directory_Enum(const cc_string* dirPath, void* obj, Directory_EnumCall
 	return res == ERROR_NO_MORE_FILES ? 0 : res;
 }
 
-static cc_result DoFile(cc_file* file, const cc_filepath* path, DWORD access, DWORD createMode) {
+static cc_result DoFile(cc_file* file, const cc_filepath* path, DWORD access, DWORD createMode, DWORD flags) {
 	cc_result res;
 
-	*file = CreateFileW(path->uni,  access, FILE_SHARE_READ, NULL, createMode, 0, NULL);
+	*file = CreateFileW(path->uni,  access, FILE_SHARE_READ, NULL, createMode, flags, NULL);
 	if (*file && *file != INVALID_HANDLE_VALUE) return 0;
 	if ((res = GetLastError()) != ERROR_CALL_NOT_IMPLEMENTED) return res;
 
 	/* Windows 9x does not support W API functions */
-	*file = CreateFileA(path->ansi, access, FILE_SHARE_READ, NULL, createMode, 0, NULL);
+	*file = CreateFileA(path->ansi, access, FILE_SHARE_READ, NULL, createMode, flags, NULL);
 	return *file != INVALID_HANDLE_VALUE ? 0 : GetLastError();
 }
 
 cc_result File_Open(cc_file* file, const cc_filepath* path) {
-	return DoFile(file, path, GENERIC_READ, OPEN_EXISTING);
+	return DoFile(file, path, GENERIC_READ, OPEN_EXISTING, 0);
+}
+cc_result File_OpenSequential(cc_file* file, const cc_filepath* path) {
+	return DoFile(file, path, GENERIC_READ, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN);
 }
 cc_result File_Create(cc_file* file, const cc_filepath* path) {
-	return DoFile(file, path, GENERIC_WRITE | GENERIC_READ, CREATE_ALWAYS);
+	return DoFile(file, path, GENERIC_WRITE | GENERIC_READ, CREATE_ALWAYS, 0);
 }
 cc_result File_OpenOrCreate(cc_file* file, const cc_filepath* path) {
-	return DoFile(file, path, GENERIC_WRITE | GENERIC_READ, OPEN_ALWAYS);
+	return DoFile(file, path, GENERIC_WRITE | GENERIC_READ, OPEN_ALWAYS, 0);
 }
 
 cc_result File_Read(cc_file file, void* data, cc_uint32 count, cc_uint32* bytesRead) {
@@ -690,11 +701,14 @@ void Socket_Close(cc_socket s) {
 	_closesocket(s);
 }
 
-static cc_result Socket_Poll(cc_socket s, int mode, cc_bool* success) {
+static cc_result Socket_Poll(cc_socket s, int mode, int timeoutMS, cc_bool* success) {
 	fd_set set;
-	struct timeval time = { 0 };
+	struct timeval time;
 	int selectCount;
 
+	time.tv_sec  = timeoutMS / 1000;
+	time.tv_usec = (timeoutMS % 1000) * 1000;
+
 	set.fd_count    = 1;
 	set.fd_array[0] = s;
 
@@ -710,12 +724,16 @@ static cc_result Socket_Poll(cc_socket s, int mode, cc_bool* success) {
 }
 
 cc_result Socket_CheckReadable(cc_socket s, cc_bool* readable) {
-	return Socket_Poll(s, SOCKET_POLL_READ, readable);
+	return Socket_Poll(s, SOCKET_POLL_READ, 0, readable);
+}
+
+cc_result Socket_WaitReadable(cc_socket s, int milliseconds, cc_bool* readable) {
+	return Socket_Poll(s, SOCKET_POLL_READ, milliseconds, readable);
 }
 
 cc_result Socket_CheckWritable(cc_socket s, cc_bool* writable) {
 	int resultSize = sizeof(cc_result);
-	cc_result res  = Socket_Poll(s, SOCKET_POLL_WRITE, writable);
+	cc_result res  = Socket_Poll(s, SOCKET_POLL_WRITE, 0, writable);
 	if (res || *writable) return res;
 
 	/* https://stackoverflow.com/questions/29479953/so-error-value-after-successful-socket-operation */
@@ -792,7 +810,10 @@ cc_result Process_StartGame2(const cc_string* args, int numArgs) {
 	return 0;
 }
 
-void Process_Exit(cc_result code) { ExitProcess(code); }
+void Process_Exit(cc_result code) { 
+	LogThread_Stop();
+	ExitProcess(code); 
+}
 cc_result Process_StartOpen(const cc_string* args) {
 	cc_winstring str;
 	cc_uintptr res;
@@ -1024,6 +1045,7 @@ void Platform_Init(void) {
 	
 	res = _WSAStartup(MAKEWORD(2, 2), &wsaData);
 	if (res) Logger_SysWarn(res, "starting WSA");
+	LogThread_Start();
 }
 
 void Platform_Free(void) {
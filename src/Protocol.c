@@ -33,6 +33,7 @@
 #include "InputHandler.h"
 #include "HeldBlockRenderer.h"
 #include "Options.h"
+#include "Queue.h"
 
 struct _ProtocolData Protocol;
 
@@ -94,6 +95,7 @@ static struct CpeExt
 	lightingMode_Ext    = { "LightingMode", 1 },
 	cinematicGui_Ext    = { "CinematicGui", 1 },
 	notifyAction_Ext    = { "NotifyAction", 1 },
+	compressedStream_Ext = { "CompressedStream", 1 },
 	extTextures_Ext     = { "ExtendedTextures", 1 },
 	extBlocks_Ext       = { "ExtendedBlocks", 1 };
 
@@ -104,6 +106,7 @@ static struct CpeExt* cpe_clientExtensions[] = {
 	&blockDefsExt_Ext, &bulkBlockUpdate_Ext, &textColors_Ext, &envMapAspect_Ext, &entityProperty_Ext, &extEntityPos_Ext,
 	&twoWayPing_Ext, &invOrder_Ext, &instantMOTD_Ext, &fastMap_Ext, &setHotbar_Ext, &setSpawnpoint_Ext, &velControl_Ext,
 	&customParticles_Ext, &pluginMessages_Ext, &extTeleport_Ext, &lightingMode_Ext, &cinematicGui_Ext, &notifyAction_Ext,
+	&compressedStream_Ext,
 #ifdef CUSTOM_MODELS
 	&customModels_Ext,
 #endif
@@ -201,17 +204,123 @@ static void CheckName(EntityID id, cc_string* name, cc_string* skin) {
 	RemoveEndPlus(skin);
 }
 
+static void ApplyLocation(EntityID id, struct LocationUpdate* update) {
+	struct Entity* e = Entities.List[id];
+	if (e) { e->VTABLE->SetLocation(e, update); }
+}
+
+/* Servers often send several movement packets for the same entity together (e.g. after lag), */
+/*  so while batching, these are combined into one location update per entity instead */
+static struct LocationUpdate movement_pending[MAX_NET_PLAYERS];
+static cc_bool movement_queued[MAX_NET_PLAYERS];
+static EntityID movement_ids[MAX_NET_PLAYERS];
+static int movement_count;
+static cc_bool movement_batching;
+
+#define LU_HAS_ANGLES (LU_HAS_PITCH | LU_HAS_YAW | LU_HAS_ROTX | LU_HAS_ROTZ)
+/* Whether the given update only smoothly moves and/or rotates an entity */
+static cc_bool CanCombineLocation(struct LocationUpdate* update) {
+	cc_uint8 mode = update->flags & LU_POS_MODEMASK;
+	return !(update->flags & LU_HAS_POS) || mode == LU_POS_ABSOLUTE_SMOOTH || mode == LU_POS_RELATIVE_SMOOTH;
+}
+
+/* Combines a later location update into an earlier one, returning false if not possible */
+static cc_bool CombineLocation(struct LocationUpdate* dst, struct LocationUpdate* src) {
+	cc_uint8 mode = src->flags & LU_POS_MODEMASK;
+	if ((dst->flags ^ src->flags) & LU_ORI_INTERPOLATE) return false;
+
+	if (src->flags & LU_HAS_POS) {
+		if (mode == LU_POS_RELATIVE_SMOOTH && (dst->flags & LU_HAS_POS)) {
+			/* Relative movement works the same from either an absolute or relative earlier position */
+			Vec3_AddBy(&dst->pos, &src->pos);
+		} else {
+			dst->pos   = src->pos;
+			dst->flags = (dst->flags & ~LU_POS_MODEMASK) | LU_HAS_POS | mode;
+		}
+	}
+
+	if (src->flags & LU_HAS_PITCH) dst->pitch = src->pitch;
+	if (src->flags & LU_HAS_YAW)   dst->yaw   = src->yaw;
+	if (src->flags & LU_HAS_ROTX)  dst->rotX  = src->rotX;
+	if (src->flags & LU_HAS_ROTZ)  dst->rotZ  = src->rotZ;
+	dst->flags |= src->flags & LU_HAS_ANGLES;
+	return true;
+}
+
+static void FlushLocation(EntityID id) {
+	struct LocationUpdate* pending = &movement_pending[id];
+	if (!pending->flags) return;
+
+	ApplyLocation(id, pending);
+	pending->flags = 0;
+}
+
+static void UpdateLocation(EntityID id, struct LocationUpdate* update) {
+	struct LocationUpdate* pending;
+	if (!movement_batching || id == ENTITIES_SELF_ID) { ApplyLocation(id, update); return; }
+
+	if (!CanCombineLocation(update)) {
+		FlushLocation(id);
+		ApplyLocation(id, update); return;
+	}
+
+	pending = &movement_pending[id];
+	if (pending->flags && CombineLocation(pending, update)) return;
+	FlushLocation(id);
+	*pending = *update;
+
+	if (movement_queued[id]) return;
+	movement_queued[id] = true;
+	movement_ids[movement_count++] = id;
+}
+
+/* Forgets about movement of an entity that is about to be removed */
+static void DiscardLocation(EntityID id) {
+	if (id == ENTITIES_SELF_ID) return;
+	movement_pending[id].flags = 0;
+}
+
+void Protocol_BeginMovementBatch(void) {
+	movement_batching = true;
+}
+
+void Protocol_EndMovementBatch(void) {
+	EntityID id;
+	int i;
+	movement_batching = false;
+
+	for (i = 0; i < movement_count; i++)
+	{
+		id = movement_ids[i];
+		movement_queued[id] = false;
+		FlushLocation(id);
+	}
+	movement_count = 0;
+}
+
+static void ResetMovementBatch(void) {
+	int i;
+	for (i = 0; i < MAX_NET_PLAYERS; i++) 
+	{
+		movement_pending[i].flags = 0;
+		movement_queued[i]        = false;
+	}
+	movement_count    = 0;
+	movement_batching = false;
+}
+
 static void Classic_ReadAbsoluteLocation(cc_uint8* data, EntityID id, cc_uint8 flags);
 static void AddEntity(cc_uint8* data, EntityID id, const cc_string* name, const cc_string* skin, cc_bool readPosition) {
 	struct LocalPlayer* p = Entities.CurPlayer;
 	struct Entity* e;
 
 	if (id != ENTITIES_SELF_ID) {
+		DiscardLocation(id);
 		Entities_Remove(id);
 		e = &NetPlayers_List[id].Base;
 
 		NetPlayer_Init((struct NetPlayer*)e);
-		Entities.List[id] = e;
+		Entities_Add(id, e);
 		Event_RaiseInt(&EntityEvents.Added, id);
 	} else {
 		e = &Entities.CurPlayer->Base;
@@ -229,11 +338,6 @@ static void AddEntity(cc_uint8* data, EntityID id, const cc_string* name, const
 	p->SpawnPitch = p->Base.Pitch;
 }
 
-static void UpdateLocation(EntityID id, struct LocationUpdate* update) {
-	struct Entity* e = Entities.List[id];
-	if (e) { e->VTABLE->SetLocation(e, update); }
-}
-
 static void UpdateUserType(struct HacksComp* hacks, cc_uint8 value) {
 	cc_bool isOp = value >= 100 && value <= 127;
 	hacks->IsOp  = isOp;
@@ -383,7 +487,9 @@ static CC_INLINE void MapState_SkipHeader(struct MapState* m) {
 	m->sizeIndex     = MAP_SIZE_LEN;
 }
 
+static void MapWorker_Stop(void);
 static void FreeMapStates(void) {
+	MapWorker_Stop();
 	Mem_Free(map1.blocks);
 	map1.blocks = NULL;
 #ifdef EXTENDED_BLOCKS
@@ -414,7 +520,6 @@ static cc_result MapState_Read(struct MapState* m) {
 		m->blocks = (BlockRaw*)Mem_TryAlloc(map_volume, 1);
 		/* unlikely but possible */
 		if (!m->blocks) {
-			Window_ShowDialog("Out of memory", "Not enough free memory to join that map.\nTry joining a different map.");
 			m->allocFailed = true;
 			return 0;
 		}
@@ -427,6 +532,266 @@ static cc_result MapState_Read(struct MapState* m) {
 	return res;
 }
 
+/* Shown here instead of in MapState_Read, as that may not be running on the main thread */
+static void MapState_ShowAllocFailed(void) {
+	Window_ShowDialog("Out of memory", "Not enough free memory to join that map.\nTry joining a different map.");
+}
+
+/* Decompresses the given chunk of compressed map data */
+static cc_result MapState_Process(struct MapState* m, cc_uint8* data, int length) {
+	cc_result res;
+	map_part.meta.mem.cur    = data;
+	map_part.meta.mem.base   = data;
+	map_part.meta.mem.left   = length;
+	map_part.meta.mem.length = length;
+
+	if (!m->gzHeader.done) {
+		res = GZipHeader_Read(&map_part, &m->gzHeader);
+		if (res && res != ERR_END_OF_STREAM) return res;
+	}
+
+	if (m->gzHeader.done) return MapState_Read(m);
+	return 0;
+}
+
+static float MapState_Progress(void) {
+	return !map_volume ? 0.0f : (float)map1.index / map_volume;
+}
+
+#ifdef CC_BUILD_BUILDERTHREADS
+/* Decompressing is done on a separate thread, so the network thread is free to keep receiving chunks */
+/* NOTE: While the thread is running, it exclusively owns map_part, map_volume and the map states */
+struct MapChunk { cc_uint8 data[1024]; int length; cc_bool upper; };
+
+static struct MapWorker {
+	void* thread;
+	void* lock;
+	void* pending; /* Signalled when chunks are queued, or when the thread should stop */
+	void* idle;    /* Signalled when the thread runs out of queued chunks */
+	struct Queue chunks;
+	cc_bool busy, stop;
+	cc_result res; /* First error decompressing, after which further chunks are skipped */
+	float progress;
+} map_worker;
+
+static void MapWorker_Run(void) {
+	struct MapChunk chunk;
+	struct MapState* m;
+	cc_result res;
+
+	for (;;) {
+		Mutex_Lock(map_worker.lock);
+		if (map_worker.stop) { Mutex_Unlock(map_worker.lock); return; }
+
+		if (!map_worker.chunks.count) {
+			map_worker.busy = false;
+			Mutex_Unlock(map_worker.lock);
+
+			Waitable_Signal(map_worker.idle);
+			Waitable_Wait(map_worker.pending);
+			continue;
+		}
+
+		/* Dequeued entry may be overwritten by next Queue_Enqueue, so copy it */
+		Mem_Copy(&chunk, Queue_Dequeue(&map_worker.chunks), sizeof(chunk));
+		map_worker.busy = true;
+		res = map_worker.res;
+		Mutex_Unlock(map_worker.lock);
+
+#ifdef EXTENDED_BLOCKS
+		m = chunk.upper ? &map2 : &map1;
+#else
+		m = &map1;
+#endif
+		if (!res) res = MapState_Process(m, chunk.data, chunk.length);
+
+		Mutex_Lock(map_worker.lock);
+		map_worker.res      = res;
+		map_worker.progress = MapState_Progress();
+		Mutex_Unlock(map_worker.lock);
+	}
+}
+
+static void MapWorker_Start(void) {
+	map_worker.lock    = Mutex_Create("Map decompressor lock");
+	map_worker.pending = Waitable_Create("Map decompressor pending");
+	map_worker.idle    = Waitable_Create("Map decompressor idle");
+	Queue_Init(&map_worker.chunks, sizeof(struct MapChunk));
+
+	map_worker.busy     = false;
+	map_worker.stop     = false;
+	map_worker.res      = 0;
+	map_worker.progress = 0.0f;
+	Thread_Run(&map_worker.thread, MapWorker_Run, 128 * 1024, "Map decompressor");
+}
+
+static void MapWorker_Stop(void) {
+	if (!map_worker.thread) return;
+
+	Mutex_Lock(map_worker.lock);
+	map_worker.stop = true;
+	Mutex_Unlock(map_worker.lock);
+
+	Waitable_Signal(map_worker.pending);
+	Thread_Join(map_worker.thread);
+	map_worker.thread = NULL;
+
+	Queue_Clear(&map_worker.chunks);
+	Mutex_Free(map_worker.lock);
+	Waitable_Free(map_worker.pending);
+	Waitable_Free(map_worker.idle);
+}
+
+/* Blocks until all queued chunks have been decompressed, then stops the thread */
+static cc_result MapWorker_Finish(void) {
+	cc_bool done;
+	if (!map_worker.thread) return 0;
+
+	for (;;) {
+		Mutex_Lock(map_worker.lock);
+		done = !map_worker.chunks.count && !map_worker.busy;
+		Mutex_Unlock(map_worker.lock);
+
+		if (done) break;
+		Waitable_Wait(map_worker.idle);
+	}
+
+	MapWorker_Stop();
+	return map_worker.res;
+}
+
+/* Queues the given chunk to be decompressed, returning any earlier decompression error */
+static cc_result MapWorker_Submit(struct MapState* m, cc_uint8* data, int length, float* progress) {
+	struct MapChunk chunk;
+	cc_result res;
+
+	Mem_Copy(chunk.data, data, length);
+	chunk.length = length;
+	chunk.upper  = m != &map1;
+
+	Mutex_Lock(map_worker.lock);
+	Queue_Enqueue(&map_worker.chunks, &chunk);
+	res       = map_worker.res;
+	*progress = map_worker.progress;
+	Mutex_Unlock(map_worker.lock);
+
+	Waitable_Signal(map_worker.pending);
+	return res;
+}
+#else
+static void MapWorker_Start(void) { }
+static void MapWorker_Stop(void)  { }
+static cc_result MapWorker_Finish(void) { return 0; }
+
+static cc_result MapWorker_Submit(struct MapState* m, cc_uint8* data, int length, float* progress) {
+	cc_result res = MapState_Process(m, data, length);
+	*progress     = MapState_Progress();
+	return res;
+}
+#endif
+
+
+/*########################################################################################################################*
+*---------------------------------------------------Block predictions-----------------------------------------------------*
+*#########################################################################################################################*/
+/* Blocks the player changes are applied to the world straight away, without waiting for the server. */
+/* The classic protocol has no acknowledgements, so servers only send the block back if they rejected */
+/*  or modified the change, and an unanswered prediction is eventually assumed to have been accepted. */
+/* Remembering unanswered predictions allows ignoring replies that would only redo the block already */
+/*  shown, or would briefly revert a block that the player has changed again since */
+#define PREDICTIONS_MAX 256 /* Must be a power of two */
+/* Minimum seconds before an unanswered prediction is assumed to have been accepted */
+#define PREDICTION_MIN_TIMEOUT 1.0
+
+struct BlockPrediction { int x, y, z; BlockID block; double time; };
+/* Unanswered predictions, from oldest to newest */
+static struct BlockPrediction predictions[PREDICTIONS_MAX];
+static int predictions_head, predictions_count;
+#define Predictions_Get(i) (&predictions[(predictions_head + (i)) & (PREDICTIONS_MAX - 1)])
+
+static void Predictions_Clear(void) {
+	predictions_head  = 0;
+	predictions_count = 0;
+}
+
+static void Predictions_RemoveOldest(void) {
+	predictions_head = (predictions_head + 1) & (PREDICTIONS_MAX - 1);
+	predictions_count--;
+}
+
+static void Predictions_Add(int x, int y, int z, BlockID block) {
+	struct BlockPrediction* p;
+	/* Too many to keep track of, so assume the oldest was accepted */
+	if (predictions_count == PREDICTIONS_MAX) Predictions_RemoveOldest();
+
+	p = Predictions_Get(predictions_count++);
+	p->x = x; p->y = y; p->z = z;
+	p->block = block;
+	p->time  = Game.Time;
+	Server_Stats.blocksPredicted++;
+}
+
+/* Assumes predictions that have gone unanswered for much longer than a round trip were accepted */
+static void Predictions_Expire(void) {
+	double timeout = PREDICTION_MIN_TIMEOUT + Ping_AveragePingMS() * 2 / 1000.0;
+
+	while (predictions_count && Game.Time - Predictions_Get(0)->time >= timeout) {
+		Predictions_RemoveOldest();
+	}
+}
+
+/* Removes the predictions at the given coordinates, up to and including the one at the given index */
+static void Predictions_RemoveAt(int x, int y, int z, int last) {
+	struct BlockPrediction* p;
+	int i, j = 0, count = predictions_count;
+
+	for (i = 0; i < count; i++) 
+	{
+		p = Predictions_Get(i);
+		if (i <= last && p->x == x && p->y == y && p->z == z) continue;
+
+		if (i != j) *Predictions_Get(j) = *p;
+		j++;
+	}
+	predictions_count = j;
+}
+
+/* Matches up a block sent by the server with the oldest prediction of that block at the same coordinates */
+/* Returns whether the block should actually be applied to the world */
+static cc_bool Predictions_Reconcile(int x, int y, int z, BlockID block) {
+	struct BlockPrediction* p;
+	int i, found = -1, match = -1, newer = 0;
+	if (!predictions_count) return true;
+
+	for (i = 0; i < predictions_count; i++) 
+	{
+		p = Predictions_Get(i);
+		if (p->x != x || p->y != y || p->z != z) continue;
+
+		if (found == -1) found = i;
+		if (match == -1 && p->block == block) { match = i; } else if (match >= 0) { newer++; }
+	}
+	if (found == -1) return true;
+
+	/* Block differs from every prediction, so is e.g. a change made by another player or plugin */
+	/*  (or a rejection) - the predictions can no longer be trusted, so the server's block wins */
+	if (match == -1) {
+		Predictions_RemoveAt(x, y, z, predictions_count - 1);
+		Server_Stats.blocksCorrected++;
+		return true;
+	}
+	Predictions_RemoveAt(x, y, z, match);
+
+	/* Reply is about an older change, and the server hasn't processed the newer ones yet */
+	/*  (if it rejects them, it'll send back a block that differs from the newer predictions) */
+	if (newer) { Server_Stats.blocksIgnored++; return false; }
+	/* Server just echoed back the predicted block */
+	if (World_GetBlock(x, y, z) == block) { Server_Stats.blocksIgnored++; return false; }
+
+	Server_Stats.blocksCorrected++;
+	return true;
+}
+
 
 /*########################################################################################################################*
 *----------------------------------------------------Classic protocol-----------------------------------------------------*
@@ -504,6 +869,7 @@ void Classic_SendSetBlock(int x, int y, int z, cc_bool place, BlockID block) {
 		WriteBlock(data, block);
 	}
 	Server.SendData(tmp, (cc_uint32)(data - tmp));
+	Predictions_Add(x, y, z, place ? block : BLOCK_AIR);
 }
 
 static void Classic_Handshake(cc_uint8* data) {
@@ -532,7 +898,9 @@ static void Classic_StartLoading(void) {
 	LoadingScreen_Show(&Server.Name, &Server.MOTD);
 	WoM_CheckMotd();
 	classic_receivedFirstPos = false;
+	Predictions_Clear();
 
+	MapWorker_Stop();
 	map_begunLoading = true;
 	map_receiveBeg   = Stopwatch_Measure();
 	map_volume       = 0;
@@ -541,6 +909,7 @@ static void Classic_StartLoading(void) {
 #ifdef EXTENDED_BLOCKS
 	MapState_Init(&map2);
 #endif
+	MapWorker_Start();
 }
 
 static void Classic_LevelInit(cc_uint8* data) {
@@ -567,11 +936,7 @@ static void Classic_LevelDataChunk(cc_uint8* data) {
 	/* Workaround for some servers that send LevelDataChunk before LevelInit due to their async sending behaviour */
 	if (!map_begunLoading) Classic_StartLoading();
 	usedLength = Stream_GetU16_BE(data);
-
-	map_part.meta.mem.cur    = data + 2;
-	map_part.meta.mem.base   = data + 2;
-	map_part.meta.mem.left   = usedLength;
-	map_part.meta.mem.length = usedLength;
+	usedLength = min(usedLength, 1024);
 
 #ifndef EXTENDED_BLOCKS
 	m = &map1;
@@ -584,33 +949,29 @@ static void Classic_LevelDataChunk(cc_uint8* data) {
 	}
 #endif
 
-	if (!m->gzHeader.done) {
-		res = GZipHeader_Read(&map_part, &m->gzHeader);
-		if (res && res != ERR_END_OF_STREAM) { DisconnectInvalidMap(res); return; }
-	}
-
-	if (m->gzHeader.done) {
-		res = MapState_Read(m);
-		if (res) { DisconnectInvalidMap(res); return; }
-	}
-
-	progress = !map_volume ? 0.0f : (float)map1.index / map_volume;
+	res = MapWorker_Submit(m, data + 2, usedLength, &progress);
+	if (res) { DisconnectInvalidMap(res); return; }
 	Event_RaiseFloat(&WorldEvents.Loading, progress);
 }
 
 static void Classic_LevelFinalise(cc_uint8* data) {
 	int width, height, length, volume;
 	cc_uint64 end;
+	cc_result res;
 	int delta;
 
+	res = MapWorker_Finish();
+	if (res) { map_begunLoading = false; DisconnectInvalidMap(res); return; }
+
 	end   = Stopwatch_Measure();
 	delta = Stopwatch_ElapsedMS(map_receiveBeg, end);
 	Platform_Log1("map loading took: %i", &delta);
 	map_begunLoading = false;
 	WoM_CheckSendWomID();
 
+	if (map1.allocFailed) MapState_ShowAllocFailed();
 #ifdef EXTENDED_BLOCKS
-	if (map2.allocFailed) FreeMapStates();
+	if (map2.allocFailed) { MapState_ShowAllocFailed(); FreeMapStates(); }
 #endif
 
 	width  = Stream_GetU16_BE(data + 0);
@@ -655,7 +1016,7 @@ static void Classic_SetBlock(cc_uint8* data) {
 	data += 6;
 
 	ReadBlock(data, block);
-	if (World_Contains(x, y, z)) {
+	if (World_Contains(x, y, z) && Predictions_Reconcile(x, y, z, block)) {
 		Game_UpdateBlock(x, y, z, block);
 	}
 }
@@ -720,7 +1081,10 @@ static void Classic_OrientationUpdate(cc_uint8* data) {
 
 static void Classic_RemoveEntity(cc_uint8* data) {
 	EntityID id = data[0];
-	if (id != ENTITIES_SELF_ID) Entities_Remove(id);
+	if (id == ENTITIES_SELF_ID) return;
+
+	DiscardLocation(id);
+	Entities_Remove(id);
 }
 
 static void Classic_Message(cc_uint8* data) {
@@ -799,9 +1163,11 @@ static void Classic_ReadAbsoluteLocation(cc_uint8* data, EntityID id, cc_uint8 f
 
 #define Classic_HandshakeSize() (Game_Version.Protocol > PROTOCOL_0019 ? 131 : 130)
 static void Classic_Reset(void) {
+	MapWorker_Stop();
 	Stream_ReadonlyMemory(&map_part, NULL, 0);
 	map_begunLoading = false;
 	classic_receivedFirstPos = false;
+	Predictions_Clear();
 
 	Net_Set(OPCODE_HANDSHAKE, Classic_Handshake, Classic_HandshakeSize());
 	Net_Set(OPCODE_PING, Classic_Ping, 1);
@@ -824,7 +1190,10 @@ static void Classic_Reset(void) {
 
 static cc_uint8* Classic_Tick(cc_uint8* data) {
 	struct Entity* e = &Entities.CurPlayer->Base;
+	Predictions_Expire();
 	if (!classic_receivedFirstPos) return data;
+	/* Position updates are sent again soon anyways, so don't add to a backlog */
+	if (Server_IsSendBacklogged()) return data;
 
 	/* Report end position of each physics tick, rather than current position */
 	/*  (otherwise can miss landing on a block then jumping off of it again) */
@@ -1286,6 +1655,7 @@ static void CPE_ExtAddEntity2(cc_uint8* data) {
 static void CPE_BulkBlockUpdate(cc_uint8* data) {
 	cc_int32 indices[BULK_MAX_BLOCKS];
 	BlockID blocks[BULK_MAX_BLOCKS];
+	BlockID block;
 	int index, i;
 	int x, y, z;
 	int count = 1 + *data++;
@@ -1311,17 +1681,20 @@ static void CPE_BulkBlockUpdate(cc_uint8* data) {
 		data += BULK_MAX_BLOCKS / 4;
 	}
 
+	Lighting_BeginBatch();
 	for (i = 0; i < count; i++) {
 		index = indices[i];
 		if (index < 0 || index >= World.Volume) continue;
 		World_Unpack(index, x, y, z);
 
 #ifdef EXTENDED_BLOCKS
-		Game_UpdateBlock(x, y, z, blocks[i] % BLOCK_COUNT);
+		block = blocks[i] % BLOCK_COUNT;
 #else
-		Game_UpdateBlock(x, y, z, blocks[i]);
+		block = blocks[i];
 #endif
+		if (Predictions_Reconcile(x, y, z, block)) Game_UpdateBlock(x, y, z, block);
 	}
+	Lighting_EndBatch();
 }
 
 static void CPE_SetTextColor(cc_uint8* data) {
@@ -1429,7 +1802,7 @@ static void CPE_SetEntityProperty(cc_uint8* data) {
 	default:
 		return;
 	}
-	e->VTABLE->SetLocation(e, &update);
+	UpdateLocation(id, &update);
 }
 
 static void CPE_TwoWayPing(cc_uint8* data) {
@@ -1605,6 +1978,12 @@ static void CPE_CinematicGui(cc_uint8* data) {
 	Gui.BarSize = (float)barSize / UInt16_MaxValue;
 }
 
+/* All data the server sends after this packet is a raw DEFLATE stream (no zlib/gzip header), */
+/*  which the server flushes (e.g. using Z_SYNC_FLUSH) at the end of each of its ticks */
+static void CPE_BeginCompressedStream(cc_uint8* data) {
+	Server_BeginCompressedStream();
+}
+
 static void CPE_Reset(void) {
 	cpe_serverExtensionsCount = 0; cpe_pingTicks = 0;
 	CPEExtensions_Reset();
@@ -1649,6 +2028,7 @@ static void CPE_Reset(void) {
 	Net_Set(OPCODE_ENTITY_TELEPORT_EXT, CPE_ExtEntityTeleport, 11);
 	Net_Set(OPCODE_LIGHTING_MODE, CPE_LightingMode, 3);
 	Net_Set(OPCODE_CINEMATIC_GUI, CPE_CinematicGui, 10);
+	Net_Set(OPCODE_BEGIN_COMPRESSED_STREAM, CPE_BeginCompressedStream, 1);
 }
 
 static cc_uint8* CPE_Tick(cc_uint8* data) {
@@ -1935,6 +2315,7 @@ static void BlockDefs_Reset(void) {
 *-----------------------------------------------------Public handlers-----------------------------------------------------*
 *#########################################################################################################################*/
 static void Protocol_Reset(void) {
+	ResetMovementBatch();
 	Classic_Reset();
 	CPE_Reset();
 	BlockDefs_Reset();
@@ -1970,6 +2351,8 @@ static void OnReset(void) {
 void CPE_SendPlayerClick(int button, cc_bool pressed, cc_uint8 targetId, struct RayTracer* t) { }
 void CPE_SendNotifyAction(int action, cc_uint16 value) { }
 void CPE_SendNotifyPositionAction(int action, int x, int y, int z) { }
+void Protocol_BeginMovementBatch(void) { }
+void Protocol_EndMovementBatch(void) { }
 
 static void OnInit(void) { }
 
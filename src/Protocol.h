@@ -40,7 +40,7 @@ enum OPCODE_ {
 	OPCODE_DEFINE_MODEL, OPCODE_DEFINE_MODEL_PART, OPCODE_UNDEFINE_MODEL,
 	OPCODE_PLUGIN_MESSAGE, OPCODE_ENTITY_TELEPORT_EXT,
 	OPCODE_LIGHTING_MODE, OPCODE_CINEMATIC_GUI, OPCODE_NOTIFY_ACTION,
-	OPCODE_NOTIFY_POSITION_ACTION,
+	OPCODE_NOTIFY_POSITION_ACTION, OPCODE_BEGIN_COMPRESSED_STREAM,
 
 	OPCODE_COUNT
 };
@@ -71,6 +71,10 @@ struct IGameComponent;
 extern struct IGameComponent Protocol_Component;
 
 void Protocol_Tick(void);
+/* Begins combining movement packets received for each entity into one location update */
+void Protocol_BeginMovementBatch(void);
+/* Applies the location updates combined since Protocol_BeginMovementBatch */
+void Protocol_EndMovementBatch(void);
 
 extern cc_bool cpe_needD3Fix;
 void Classic_SendChat(const cc_string* text, cc_bool partial);
@@ -4,69 +4,177 @@
 #include "Platform.h"
 #include "Queue.h"
 
+/* Number of entries in each block of a queue */
+#define QUEUE_BLOCK_ENTRIES 1024
+/* Entries of a block are stored directly after this header */
+struct QueueBlock { struct QueueBlock* next; };
+#define Queue_BlockEntry(queue, block, i) ((cc_uint8*)((block) + 1) + (i) * (queue)->structSize)
+
 void Queue_Init(struct Queue* queue, cc_uint32 structSize) {
-	queue->entries = NULL;
+	queue->head  = NULL;
+	queue->tail  = NULL;
+	queue->spare = NULL;
 	queue->structSize = structSize;
-	queue->capacity = 0;
-	queue->mask = 0;
 	queue->count = 0;
-	queue->head = 0;
-	queue->tail = 0;
+	queue->headIndex = 0;
+	queue->tailIndex = 0;
+
+	queue->getKey = NULL;
+	queue->keys   = NULL;
+	queue->keysCapacity = 0;
+	queue->keysCount    = 0;
+}
+
+void Queue_SetDedupe(struct Queue* queue, Queue_KeyFunc getKey) {
+	queue->getKey = getKey;
+}
+
+static void Queue_FreeBlocks(struct QueueBlock* block) {
+	struct QueueBlock* next;
+	for (; block; block = next) {
+		next = block->next;
+		Mem_Free(block);
+	}
 }
 
 void Queue_Clear(struct Queue* queue) {
-	if (!queue->entries) return;
-	Mem_Free(queue->entries);
+	Queue_KeyFunc getKey = queue->getKey;
+	Queue_FreeBlocks(queue->head);
+	Queue_FreeBlocks(queue->spare);
+	Mem_Free(queue->keys);
+
 	Queue_Init(queue, queue->structSize);
+	queue->getKey = getKey;
+}
+
+
+/*########################################################################################################################*
+*--------------------------------------------------------Queue keys-------------------------------------------------------*
+*#########################################################################################################################*/
+/* Keys are stored with 1 added, so that 0 can be used to mark empty slots */
+static cc_uint32 Queue_HashKey(cc_uint64 stored) {
+	cc_uint32 hash = (cc_uint32)stored ^ ((cc_uint32)(stored >> 32) * 31);
+	return hash * 2654435761U;
 }
 
-static void Queue_Resize(struct Queue* queue) {
-	cc_uint8* entries;
-	int capacity, headToEndSize, byteOffsetToHead;
+/* Returns false if the key was already in the set */
+static cc_bool Queue_InsertKey(struct Queue* queue, cc_uint64 stored) {
+	int mask = queue->keysCapacity - 1;
+	int i    = (int)(Queue_HashKey(stored) & mask);
 
-	if (queue->capacity >= (Int32_MaxValue / 4)) {
-		Chat_AddRaw("&cToo many generic queue entries, clearing");
-		Queue_Clear(queue);
-		return;
+	for (; queue->keys[i]; i = (i + 1) & mask) {
+		if (queue->keys[i] == stored) return false;
 	}
-	capacity = queue->capacity * 2;
-	if (capacity < 32) capacity = 32;
-	entries = (cc_uint8*)Mem_Alloc(capacity, queue->structSize, "Generic queue");
-
-	/* Elements must be readjusted to avoid index wrapping issues */
-	headToEndSize = (queue->capacity - queue->head) * queue->structSize;
-	byteOffsetToHead = queue->head * queue->structSize;
-	/* Copy from head to end */
-	Mem_Copy(entries, queue->entries + byteOffsetToHead, headToEndSize);
-	if (queue->head != 0) {
-		/* If there's any leftover before the head, copy that bit too */
-		Mem_Copy(entries + headToEndSize, queue->entries, byteOffsetToHead);
+	queue->keys[i] = stored;
+	queue->keysCount++;
+	return true;
+}
+
+static void Queue_ResizeKeys(struct Queue* queue) {
+	cc_uint64* keys = queue->keys;
+	int i, capacity = queue->keysCapacity;
+
+	queue->keysCapacity = capacity ? capacity * 2 : 256;
+	queue->keysCount    = 0;
+	queue->keys = (cc_uint64*)Mem_AllocCleared(queue->keysCapacity, sizeof(cc_uint64), "queue keys");
+
+	for (i = 0; i < capacity; i++) {
+		if (keys[i]) Queue_InsertKey(queue, keys[i]);
 	}
+	Mem_Free(keys);
+}
+
+static cc_bool Queue_AddKey(struct Queue* queue, cc_uint64 key) {
+	/* Keep the set at most half full, so probe sequences stay short */
+	if ((queue->keysCount + 1) * 2 > queue->keysCapacity) Queue_ResizeKeys(queue);
+	return Queue_InsertKey(queue, key + 1);
+}
 
-	Mem_Free(queue->entries);
+static void Queue_RemoveKey(struct Queue* queue, cc_uint64 key) {
+	cc_uint64 stored = key + 1, cur;
+	int mask = queue->keysCapacity - 1;
+	int i    = (int)(Queue_HashKey(stored) & mask);
+	int j, home;
 
-	queue->entries = entries;
-	queue->capacity = capacity;
-	queue->mask = capacity - 1; /* capacity is power of two */
-	queue->head = 0;
-	queue->tail = queue->count;
+	for (; queue->keys[i] != stored; i = (i + 1) & mask) {
+		if (!queue->keys[i]) return;
+	}
+
+	/* Shift back later keys in the same probe sequence, so that lookups don't stop early at the gap */
+	for (j = (i + 1) & mask; (cur = queue->keys[j]); j = (j + 1) & mask) {
+		home = (int)(Queue_HashKey(cur) & mask);
+		if (((j - home) & mask) < ((j - i) & mask)) continue;
+
+		queue->keys[i] = cur;
+		i = j;
+	}
+	queue->keys[i] = 0;
+	queue->keysCount--;
 }
 
-/* Appends an entry to the end of the queue, resizing if necessary. */
+
+/*########################################################################################################################*
+*-------------------------------------------------------Queue entries-----------------------------------------------------*
+*#########################################################################################################################*/
+static cc_bool Queue_AddBlock(struct Queue* queue) {
+	struct QueueBlock* block = queue->spare;
+
+	if (block) {
+		queue->spare = block->next;
+	} else {
+		block = (struct QueueBlock*)Mem_TryAlloc(1, sizeof(struct QueueBlock) + QUEUE_BLOCK_ENTRIES * queue->structSize);
+		if (!block) return false;
+	}
+	block->next = NULL;
+
+	if (queue->tail) {
+		queue->tail->next = block;
+	} else {
+		queue->head = block;
+	}
+	queue->tail      = block;
+	queue->tailIndex = 0;
+	return true;
+}
+
+/* Appends an entry to the end of the queue, allocating another block if necessary. */
 void Queue_Enqueue(struct Queue* queue, void* item) {
-	if (queue->count == queue->capacity)
-		Queue_Resize(queue);
+	if (queue->getKey && !Queue_AddKey(queue, queue->getKey(item))) return;
+
+	if (!queue->tail || queue->tailIndex == QUEUE_BLOCK_ENTRIES) {
+		if (!Queue_AddBlock(queue)) {
+			Chat_AddRaw("&cToo many generic queue entries, clearing");
+			Queue_Clear(queue);
+			return;
+		}
+	}
 
-	//queue->entries[queue->tail] = item;
-	Mem_Copy(queue->entries + queue->tail * queue->structSize, item, queue->structSize);
-	queue->tail = (queue->tail + 1) & queue->mask;
+	Mem_Copy(Queue_BlockEntry(queue, queue->tail, queue->tailIndex), item, queue->structSize);
+	queue->tailIndex++;
 	queue->count++;
 }
 
 /* Retrieves the entry from the front of the queue. */
 void* Queue_Dequeue(struct Queue* queue) {
-	void* result = queue->entries + queue->head * queue->structSize;
-	queue->head = (queue->head + 1) & queue->mask;
+	struct QueueBlock* block = queue->head;
+	void* result = Queue_BlockEntry(queue, block, queue->headIndex);
+
+	queue->headIndex++;
 	queue->count--;
+	if (queue->getKey) Queue_RemoveKey(queue, queue->getKey(result));
+
+	if (queue->headIndex == QUEUE_BLOCK_ENTRIES) {
+		/* Block is only reused by a later Queue_Enqueue, so result stays valid until then */
+		queue->head = block->next;
+		if (!queue->head) queue->tail = NULL;
+
+		block->next  = queue->spare;
+		queue->spare = block;
+		queue->headIndex = 0;
+	} else if (!queue->count) {
+		/* Start from the beginning of the block again */
+		queue->headIndex = 0;
+		queue->tailIndex = 0;
+	}
 	return result;
 }
@@ -3,21 +3,35 @@
 #include "Core.h"
 CC_BEGIN_HEADER
 
+/* Returns the key used to identify duplicate entries in a queue */
+typedef cc_uint64 (*Queue_KeyFunc)(const void* item);
+struct QueueBlock;
+
+/* First in first out queue, made up of fixed size blocks of entries */
+/* Emptied blocks are kept around for reuse, so a queue doesn't need resizing once it has grown */
 struct Queue {
-	cc_uint8* entries;    /* Buffer holding the bytes of the queue */
+	struct QueueBlock* head;  /* Block holding the entries at the front of the queue */
+	struct QueueBlock* tail;  /* Block holding the entries at the end of the queue */
+	struct QueueBlock* spare; /* Emptied blocks that can be reused */
 	int structSize; /* Size in bytes of the type of structure this queue holds */
-	int capacity;        /* Max number of elements in the buffer */
-	int mask;            /* capacity - 1, as capacity is always a power of two */
-	int count;           /* Number of used elements */
-	int head;            /* Head index into the buffer */
-	int tail;            /* Tail index into the buffer */
+	int count;      /* Number of used elements */
+	int headIndex;  /* Index of the front entry in the head block */
+	int tailIndex;  /* Index after the last entry in the tail block */
+
+	Queue_KeyFunc getKey; /* Used to ignore entries already in the queue, NULL if disabled */
+	cc_uint64* keys;      /* Open addressing hash set of the keys of entries in the queue */
+	int keysCapacity, keysCount;
 };
 void Queue_Init(struct Queue* queue, cc_uint32 structSize);
-/* Appends an entry to the end of the queue, resizing if necessary. */
+/* Makes Queue_Enqueue ignore entries whose key matches one already in the queue. */
+/* NOTE: The key must uniquely identify an entry, and must not be 0xFFFFFFFFFFFFFFFF */
+void Queue_SetDedupe(struct Queue* queue, Queue_KeyFunc getKey);
+/* Appends an entry to the end of the queue, allocating another block if necessary. */
 void Queue_Enqueue(struct Queue* queue, void* item);
 /* Retrieves the entry from the front of the queue. */
+/* NOTE: The returned pointer is only valid until the next Queue_Enqueue call */
 void* Queue_Dequeue(struct Queue* queue);
-/* Frees the memory of the queue and resets the members to 0. */
+/* Frees the memory of the queue and removes all entries. */
 void Queue_Clear(struct Queue* queue);
 
 CC_END_HEADER
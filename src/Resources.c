@@ -78,6 +78,76 @@ static void ZipFile_InspectEntries(const cc_string* path, Zip_SelectEntry select
 	(void)stream.Close(&stream);
 }
 
+/* Caches the results of inspecting resource zips, so they don't need to be parsed on every launch */
+#define MANIFEST_FILE "resources.txt"
+static struct StringsBuffer manifest;
+static cc_bool manifestLoaded, manifestChanged;
+
+/* Calculates a signature that changes whenever the file does, from its length and */
+/*  the CRC32 of its last bytes (which for a zip includes the central directory end record) */
+static cc_result ZipFile_GetSignature(const cc_string* path, cc_uint32* length, cc_uint32* crc) {
+	cc_uint8 tail[1024];
+	struct Stream stream;
+	cc_uint32 count;
+	cc_result res;
+
+	res = Stream_OpenFile(&stream, path);
+	if (res) return res;
+
+	if (!(res = stream.Length(&stream, length))) {
+		count = min(*length, sizeof(tail));
+		if (!(res = stream.Seek(&stream, *length - count))) {
+			res  = Stream_Read(&stream, tail, count);
+			*crc = Utils_CRC32(tail, count);
+		}
+	}
+
+	/* No point logging error for closing readonly file */
+	(void)stream.Close(&stream);
+	return res;
+}
+
+/* Inspects the entries of the zip file, unless the manifest has the number of entries */
+/*  found by the selector from when the zip file was last inspected */
+/* NOTE: expected is also stored, so that the cached count is ignored if the wanted entries change */
+static void ZipFile_InspectCached(const cc_string* path, Zip_SelectEntry selector, int expected, int* found) {
+	cc_string value; char valueBuffer[STRING_SIZE];
+	cc_string parts[4];
+	int length, crc, count, cachedLen, cachedCrc, cachedExpected;
+
+	if (!manifestLoaded) {
+		manifestLoaded = true;
+		StringsBuffer_Init(&manifest);
+		EntryList_Load(&manifest, MANIFEST_FILE, '=', NULL);
+	}
+
+	if (ZipFile_GetSignature(path, (cc_uint32*)&length, (cc_uint32*)&crc)) {
+		ZipFile_InspectEntries(path, selector); return;
+	}
+	value = EntryList_UNSAFE_Get(&manifest, path, '=');
+
+	if (String_UNSAFE_Split(&value, ',', parts, 4) == 4
+			&& Convert_ParseInt(&parts[0], &cachedLen) && cachedLen == length
+			&& Convert_ParseInt(&parts[1], &cachedCrc) && cachedCrc == crc
+			&& Convert_ParseInt(&parts[2], &cachedExpected) && cachedExpected == expected
+			&& Convert_ParseInt(&parts[3], &count)) {
+		*found = count; return;
+	}
+
+	ZipFile_InspectEntries(path, selector);
+	String_InitArray(value, valueBuffer);
+	String_Format4(&value, "%i,%i,%i,%i", &length, &crc, &expected, found);
+
+	EntryList_Set(&manifest, path, &value, '=');
+	manifestChanged = true;
+}
+
+static void Manifest_SaveIfChanged(void) {
+	if (!manifestChanged) return;
+	manifestChanged = false;
+	EntryList_Save(&manifest, MANIFEST_FILE);
+}
+
 static cc_result ZipEntry_ExtractData(struct ResourceZipEntry* e, struct Stream* data, struct ZipEntry* source) {
 	cc_uint32 size = source->UncompressedSize;
 	e->value.data  = Mem_TryAlloc(size, 1);
@@ -175,7 +245,7 @@ static cc_result ZipWriter_FixupLocalFile(struct Stream* s, struct ResourceZipEn
 	int filenameLen = String_Length(e->filename);
 	cc_uint8 tmp[2048];
 	cc_uint32 dataBeg, dataEnd;
-	cc_uint32 i, crc, toRead, read;
+	cc_uint32 crc, toRead, read;
 	cc_result res;
 
 	dataBeg = e->offset + 30 + filenameLen;
@@ -192,10 +262,7 @@ static cc_result ZipWriter_FixupLocalFile(struct Stream* s, struct ResourceZipEn
 
 		if ((res = s->Read(s, tmp, toRead, &read))) return res;
 		if (!read) return ERR_END_OF_STREAM;
-
-		for (i = 0; i < read; i++) {
-			crc = Utils_Crc32Table[(crc ^ tmp[i]) & 0xFF] ^ (crc >> 8);
-		}
+		crc = Utils_UpdateCRC32(crc, tmp, read);
 	}
 	e->crc32 = crc ^ 0xffffffffUL;
 
@@ -592,7 +659,8 @@ static cc_bool SoundAssets_CheckEntry(const cc_string* path) {
 
 static void SoundAssets_CheckExistence(void) {
 	soundEntriesFound = 0;
-	ZipFile_InspectEntries(&Sounds_ZipPathMC, SoundAssets_CheckEntry);
+	ZipFile_InspectCached(&Sounds_ZipPathMC, SoundAssets_CheckEntry,
+						Array_Elems(soundAssets), &soundEntriesFound);
 
 	/* >= in case somehow have say "gui.png", "GUI.png" */
 	allSoundsExist = soundEntriesFound >= Array_Elems(soundAssets);
@@ -1124,7 +1192,8 @@ static void MCCTextures_CheckExistence(void) {
 	cc_string path  = String_FromReadonly(Game_Version.DefaultTexpack);
 	zipEntriesFound = 0;
 
-	ZipFile_InspectEntries(&path, DefaultZip_SelectEntry);
+	ZipFile_InspectCached(&path, DefaultZip_SelectEntry,
+						Array_Elems(defaultZipEntries), &zipEntriesFound);
 	/* >= in case somehow have say "gui.png", "GUI.png" */
 	allZipEntriesExist = zipEntriesFound >= Array_Elems(defaultZipEntries);
 
@@ -1262,6 +1331,7 @@ void Resources_CheckExistence(void) {
 	{
 		asset_sets[i]->CheckExistence();
 	}
+	Manifest_SaveIfChanged();
 
 	for (i = 0; i < Array_Elems(asset_sets); i++)
 	{
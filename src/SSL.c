@@ -406,6 +406,8 @@ cc_result SSL_Free(void* ctx_) {
 }
 #elif CC_SSL_BACKEND == CC_SSL_BACKEND_BEARSSL
 #include "String.h"
+#include "Funcs.h"
+#include "Constants.h"
 #include "bearssl.h"
 #include "../misc/certs/certs.h"
 // https://github.com/unkaktus/bearssl/blob/master/samples/client_basic.c#L283
@@ -425,13 +427,77 @@ typedef struct SSLContext {
 	br_sslio_context ioc;
 	cc_result readError, writeError;
 	cc_socket socket;
+	cc_bool handshaked; /* Whether data has been successfully read yet, i.e. handshake completed */
+	cc_string host;
+	char _hostBuffer[STRING_SIZE];
 } SSLContext;
 
 static cc_bool _verifyCerts;
 
+/* Parameters of sessions previously negotiated with hosts, */
+/*  so that later connections can skip most of the full TLS handshake */
+static struct SSLSessionEntry {
+	cc_string host;
+	char _hostBuffer[STRING_SIZE];
+	br_ssl_session_parameters params;
+} ssl_sessions[8];
+static int ssl_nextSession;
+static void* ssl_sessionsMutex; /* Multiple HTTP worker threads may be connecting at once */
+
+static struct SSLSessionEntry* SSLSession_Find(const cc_string* host) {
+	int i;
+	for (i = 0; i < Array_Elems(ssl_sessions); i++)
+	{
+		if (!ssl_sessions[i].host.length) continue;
+		if (String_CaselessEquals(&ssl_sessions[i].host, host)) return &ssl_sessions[i];
+	}
+	return NULL;
+}
+
+static void SSLSession_Save(SSLContext* ctx) {
+	struct SSLSessionEntry* e;
+	br_ssl_session_parameters params;
+
+	br_ssl_engine_get_session_parameters(&ctx->sc.eng, &params);
+	if (!params.session_id_len) return;
+
+	Mutex_Lock(ssl_sessionsMutex);
+	e = SSLSession_Find(&ctx->host);
+	if (!e) {
+		e = &ssl_sessions[ssl_nextSession];
+		ssl_nextSession = (ssl_nextSession + 1) % Array_Elems(ssl_sessions);
+
+		String_InitArray(e->host, e->_hostBuffer);
+		String_Copy(&e->host, &ctx->host);
+	}
+	e->params = params;
+	Mutex_Unlock(ssl_sessionsMutex);
+}
+
+static void SSLSession_Forget(const cc_string* host) {
+	struct SSLSessionEntry* e;
+
+	Mutex_Lock(ssl_sessionsMutex);
+	e = SSLSession_Find(host);
+	if (e) e->host.length = 0;
+	Mutex_Unlock(ssl_sessionsMutex);
+}
+
+/* Tries to restore the previous session with the given host */
+static cc_bool SSLSession_Restore(SSLContext* ctx, const cc_string* host) {
+	struct SSLSessionEntry* e;
+
+	Mutex_Lock(ssl_sessionsMutex);
+	e = SSLSession_Find(host);
+	if (e) br_ssl_engine_set_session_parameters(&ctx->sc.eng, &e->params);
+	Mutex_Unlock(ssl_sessionsMutex);
+	return e != NULL;
+}
+
 
 void SSLBackend_Init(cc_bool verifyCerts) {
 	_verifyCerts = verifyCerts; // TODO support
+	ssl_sessionsMutex = Mutex_Create("SSL sessions");
 }
 
 cc_bool SSLBackend_DescribeError(cc_result res, cc_string* dst) {
@@ -454,6 +520,43 @@ static void InjectEntropy(SSLContext* ctx) {
 	br_ssl_engine_inject_entropy(&ctx->sc.eng, buf, 32);
 }
 
+static cc_bool IsChaChaSuite(uint16_t suite) {
+	return suite == BR_TLS_ECDHE_ECDSA_WITH_CHACHA20_POLY1305_SHA256 || suite == BR_TLS_ECDHE_RSA_WITH_CHACHA20_POLY1305_SHA256;
+}
+
+static cc_bool IsFastAESSuite(uint16_t suite) {
+	return suite == BR_TLS_ECDHE_ECDSA_WITH_AES_128_GCM_SHA256 || suite == BR_TLS_ECDHE_RSA_WITH_AES_128_GCM_SHA256
+		|| suite == BR_TLS_ECDHE_ECDSA_WITH_AES_256_GCM_SHA384 || suite == BR_TLS_ECDHE_RSA_WITH_AES_256_GCM_SHA384;
+}
+
+/* bearssl already picks the fastest AES/GHASH/ChaCha20/Poly1305 implementations for the CPU at runtime, */
+/*  but always prefers ChaCha20-Poly1305. That is only faster on CPUs without AES instructions though, */
+/*  so when the CPU has them (e.g. AES-NI with PCLMUL), ask for AES-GCM first instead */
+static void PreferFastestSuites(SSLContext* ctx) {
+	br_ssl_engine_context* eng = &ctx->sc.eng;
+	uint16_t suites[BR_MAX_CIPHER_SUITES];
+	int i, j, num = eng->suites_num, count = 0;
+
+	if (!br_aes_x86ni_ctr_get_vtable() || !br_ghash_pclmul_get()) return;
+
+	for (i = 0; i < num; i++)
+	{
+		if (IsChaChaSuite(eng->suites_buf[i])) continue;
+		suites[count++] = eng->suites_buf[i];
+
+		/* ChaCha20-Poly1305 suites go right after the last AES-GCM suite with forward secrecy */
+		if (!IsFastAESSuite(eng->suites_buf[i])) continue;
+		for (j = i + 1; j < num && !IsFastAESSuite(eng->suites_buf[j]); j++) { }
+		if (j < num) continue;
+
+		for (j = 0; j < num; j++)
+		{
+			if (IsChaChaSuite(eng->suites_buf[j])) suites[count++] = eng->suites_buf[j];
+		}
+	}
+	br_ssl_engine_set_suites(eng, suites, count);
+}
+
 static void SetCurrentTime(SSLContext* ctx) {
 	cc_uint64 cur = DateTime_CurrentUTC();
 	uint32_t days = (uint32_t)(cur / 86400) + 366;
@@ -499,12 +602,22 @@ cc_result SSL_Init(cc_socket socket, const cc_string* host_, void** out_ctx) {
 	*out_ctx = (void*)ctx;
 	
 	br_ssl_client_init_full(&ctx->sc, &ctx->xc, TAs, TAs_NUM);
+	PreferFastestSuites(ctx);
 	InjectEntropy(ctx);
 	SetCurrentTime(ctx);
 	ctx->socket = socket;
+	String_InitArray(ctx->host, ctx->_hostBuffer);
+	String_Copy(&ctx->host, host_);
 
 	br_ssl_engine_set_buffer(&ctx->sc.eng, ctx->iobuf, sizeof(ctx->iobuf), 1);
-	br_ssl_client_reset(&ctx->sc, host, 0);
+	
+	/* Try to resume the previous session with this host, which avoids the expensive key exchange */
+	/* If the server doesn't accept it, bearssl falls back to a full handshake */
+	if (SSLSession_Restore(ctx, host_)) {
+		br_ssl_client_reset(&ctx->sc, host, 1);
+	} else {
+		br_ssl_client_reset(&ctx->sc, host, 0);
+	}
 	
 	/* Account login must be done over TLS 1.2 */
 	if (String_CaselessEqualsConst(host_, "www.classicube.net")) {
@@ -525,6 +638,7 @@ cc_result SSL_Init(cc_socket socket, const cc_string* host_, void** out_ctx) {
 			
 	ctx->readError  = 0;
 	ctx->writeError = 0;
+	ctx->handshaked = false;
 	
 	return 0;
 }
@@ -538,15 +652,19 @@ cc_result SSL_Read(void* ctx_, cc_uint8* data, cc_uint32 count, cc_uint32* read)
 	if (res < 0) {
 		if (ctx->readError) return ctx->readError;
 		
-		// TODO session resumption, proper connection closing ??
+		// TODO proper connection closing ??
 		err = br_ssl_engine_last_error(&ctx->sc.eng);
 		if (err == 0 && br_ssl_engine_current_state(&ctx->sc.eng) == BR_SSL_CLOSED)
 			return SSL_ERR_CONTEXT_DEAD;
 		
+		/* Don't keep trying to resume a session that fails to negotiate */
+		SSLSession_Forget(&ctx->host);
 		return SSL_ERROR_SHIFT | (err & 0xFFFF);
 	}
 	
 	br_sslio_flush(&ctx->ioc);
+	if (!ctx->handshaked) SSLSession_Save(ctx);
+	ctx->handshaked = true;
 	*read = res;
 	return 0;
 }
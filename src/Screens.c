@@ -24,6 +24,7 @@
 #include "Options.h"
 #include "InputHandler.h"
 #include "Protocol.h"
+#include "MapRenderer.h"
 
 #define CHAT_MAX_STATUS Array_Elems(Chat_Status)
 #define CHAT_MAX_BOTTOMRIGHT Array_Elems(Chat_BottomRight)
@@ -87,8 +88,35 @@ static struct HUDScreen {
 #define POSITION_HUD_CHARS (1 + 1 + POSITION_VAL_CHARS + 1 + POSITION_VAL_CHARS + 1 + POSITION_VAL_CHARS + 1)
 #define HUD_MAX_VERTICES (4 + TEXTWIDGET_MAX * 2 + HOTBAR_MAX_VERTICES + POSITION_HUD_CHARS * 4)
 
+/* Appends the average time spent building and sorting chunks, and atlas binds, per frame over the last second */
+static void HUDScreen_AppendChunkStats(struct HUDScreen* s, cc_string* status) {
+	struct ChunkStats total, maximum;
+	int frames = max(1, min(s->frames, CHUNKSTATS_HISTORY - 1));
+	float buildMS, maxMS, sortMS;
+	int uploadKB, binds;
+
+	MapRenderer_GetStats(frames, &total, &maximum);
+	buildMS  = total.buildTime / 1000.0f / frames;
+	maxMS    = maximum.buildTime / 1000.0f;
+	sortMS   = total.sortTime / 1000.0f / frames;
+	uploadKB = total.uploadBytes / 1024;
+	binds    = total.textureBinds / frames;
+	String_Format4(status, ", build %f2 ms (max %f2), sort %f2 ms, %i KB/s", &buildMS, &maxMS, &sortMS, &uploadKB);
+	String_Format1(status, ", %i binds", &binds);
+}
+
+/* Appends how much memory the place using the most memory is currently using */
+static void HUDScreen_AppendMemStats(cc_string* status) {
+	struct MemStatsPlace top;
+	int curKB;
+	if (!MemStats_Get(&top, 1)) return;
+
+	curKB = (int)(top.curBytes / 1024);
+	String_Format2(status, ", top mem %c %i KB", top.name, &curKB);
+}
+
 static void HUDScreen_RemakeLine1(struct HUDScreen* s) {
-	cc_string status; char statusBuffer[STRING_SIZE * 2];
+	cc_string status; char statusBuffer[STRING_SIZE * 3];
 	int indices, ping, fps;
 	float real_fps;
 
@@ -120,6 +148,8 @@ static void HUDScreen_RemakeLine1(struct HUDScreen* s) {
 
 		ping = Ping_AveragePingMS();
 		if (ping) String_Format1(&status, ", ping %i ms", &ping);
+		if (MapRenderer_ShowStats) HUDScreen_AppendChunkStats(s, &status);
+		if (MemStats_ShowOverlay)  HUDScreen_AppendMemStats(&status);
 	}
 	TextWidget_Set(&s->line1, &status, &s->font);
 	s->dirty = true;
@@ -441,7 +471,6 @@ void HUDScreen_Show(void) {
 #define LIST_COLUMN_PADDING 5
 #define LIST_NAMES_PER_COLUMN 16
 #define TABLIST_MAX_ENTRIES (TABLIST_MAX_NAMES * 2)
-typedef int (*TabListEntryCompare)(int x, int y);
 
 static struct TabListOverlay {
 	Screen_Body
@@ -450,7 +479,6 @@ static struct TabListOverlay {
 	int usedCount, elementOffset;
 	struct TextWidget title;
 	struct FontDesc font;
-	TabListEntryCompare compare;
 	cc_uint16 ids[TABLIST_MAX_ENTRIES];
 	struct Texture textures[TABLIST_MAX_ENTRIES];
 } TabListOverlay_Instance;
@@ -558,14 +586,19 @@ static void TabListOverlay_Layout(void* screen) {
 	Widget_Layout(&s->title);
 }
 
-static void TabListOverlay_AddName(struct TabListOverlay* s, EntityID id, int index) {
-	cc_string name;
-	/* insert at end of list */
-	if (index == -1) { index = s->usedCount; s->usedCount++; }
+/* Inserts an entry at the given index, shifting later entries along */
+static void TabListOverlay_InsertAt(struct TabListOverlay* s, int index, int id, const cc_string* text) {
+	int i;
+	for (i = s->usedCount; i > index; i--)
+	{
+		s->ids[i]      = s->ids[i - 1];
+		s->textures[i] = s->textures[i - 1];
+	}
+	s->usedCount++;
 
-	name = TabList_UNSAFE_GetList(id);
 	s->ids[index] = id;
-	TabListOverlay_DrawText(&s->textures[index], s, &name);
+	s->textures[index].ID = 0;
+	TabListOverlay_DrawText(&s->textures[index], s, text);
 }
 
 static void TabListOverlay_DeleteAt(struct TabListOverlay* s, int i) {
@@ -582,25 +615,6 @@ static void TabListOverlay_DeleteAt(struct TabListOverlay* s, int i) {
 	s->textures[s->usedCount].ID = 0;
 }
 
-static void TabListOverlay_AddGroup(struct TabListOverlay* s, int id, int* index) {
-	cc_string group;
-	int i;
-	group = TabList_UNSAFE_GetGroup(id);
-
-	for (i = Array_Elems(s->ids) - 1; i > (*index); i--) 
-	{
-		s->ids[i]      = s->ids[i - 1];
-		s->textures[i] = s->textures[i - 1];
-	}
-	
-	s->ids[*index] = GROUP_NAME_ID;
-	s->textures[*index].ID = 0; /* TODO: TEMP HACK! */
-	TabListOverlay_DrawText(&s->textures[*index], s, &group);
-
-	(*index)++;
-	s->usedCount++;
-}
-
 static int TabListOverlay_GetGroupCount(struct TabListOverlay* s, int id, int i) {
 	cc_string group, curGroup;
 	int count;
@@ -608,6 +622,7 @@ static int TabListOverlay_GetGroupCount(struct TabListOverlay* s, int id, int i)
 
 	for (count = 0; i < s->usedCount; i++, count++)
 	{
+		if (s->ids[i] == GROUP_NAME_ID) break;
 		curGroup = TabList_UNSAFE_GetGroup(s->ids[i]);
 		if (!String_CaselessEquals(&group, &curGroup)) break;
 	}
@@ -643,69 +658,62 @@ static int TabListOverlay_GroupCompare(int x, int y) {
 	return String_Compare(&xGroup, &yGroup);
 }
 
-static void TabListOverlay_QuickSort(int left, int right) {
-	struct Texture* values = TabListOverlay_Instance.textures; struct Texture value;
-	cc_uint16* keys        = TabListOverlay_Instance.ids; cc_uint16 key;
-	TabListEntryCompare compareEntries = TabListOverlay_Instance.compare;
-
-	while (left < right) {
-		int i = left, j = right;
-		int pivot = keys[(i + j) / 2];
-
-		/* partition the list */
-		while (i <= j) {
-			while (compareEntries(pivot, keys[i]) > 0) i++;
-			while (compareEntries(pivot, keys[j]) < 0) j--;
-			QuickSort_Swap_KV_Maybe();
-		}
-		/* recurse into the smaller subset */
-		QuickSort_Recurse(TabListOverlay_QuickSort)
+/* Returns the index within the given range of players that the given player should be inserted at */
+static int TabListOverlay_FindPlayerPos(struct TabListOverlay* s, int id, int i, int end) {
+	for (; i < end; i++)
+	{
+		if (TabListOverlay_PlayerCompare(id, s->ids[i]) < 0) break;
 	}
+	return i;
 }
 
-static void TabListOverlay_SortEntries(struct TabListOverlay* s) {
-	int i, id, count;
-	if (!s->usedCount) return;
+/* Inserts the name of the given entry at the position that keeps the list sorted, */
+/*  so that only the texture of that entry (and possibly of its group) needs to be created */
+static void TabListOverlay_AddName(struct TabListOverlay* s, EntityID id) {
+	cc_string name  = TabList_UNSAFE_GetList(id);
+	cc_string group = TabList_UNSAFE_GetGroup(id);
+	int i, cmp, count;
 
 	if (s->classic) {
-		TabListOverlay_Instance.compare = TabListOverlay_PlayerCompare;
-		TabListOverlay_QuickSort(0, s->usedCount - 1);
+		i = TabListOverlay_FindPlayerPos(s, id, 0, s->usedCount);
+		TabListOverlay_InsertAt(s, i, id, &name);
 		return;
 	}
 
-	/* Sort the list by group */
-	/* Loop backwards, since DeleteAt() reduces NamesCount */
-	for (i = s->usedCount - 1; i >= 0; i--)
+	/* List is made up of each group name followed by the players in that group */
+	for (i = 0; i < s->usedCount; i += count + 1)
 	{
-		if (s->ids[i] != GROUP_NAME_ID) continue;
-		TabListOverlay_DeleteAt(s, i);
+		cmp   = TabListOverlay_GroupCompare(id, s->ids[i + 1]);
+		count = TabListOverlay_GetGroupCount(s, s->ids[i + 1], i + 1);
+		if (cmp < 0) break;
+		if (cmp > 0) continue;
+
+		i = TabListOverlay_FindPlayerPos(s, id, i + 1, i + 1 + count);
+		TabListOverlay_InsertAt(s, i, id, &name);
+		return;
 	}
-	TabListOverlay_Instance.compare = TabListOverlay_GroupCompare;
-	TabListOverlay_QuickSort(0, s->usedCount - 1);
 
-	/* Sort the entries in each group */
-	TabListOverlay_Instance.compare = TabListOverlay_PlayerCompare;
-	for (i = 0; i < s->usedCount; )
-	{
-		id = s->ids[i];
-		TabListOverlay_AddGroup(s, id, &i);
+	TabListOverlay_InsertAt(s, i,     GROUP_NAME_ID, &group);
+	TabListOverlay_InsertAt(s, i + 1, id,            &name);
+}
 
-		count = TabListOverlay_GetGroupCount(s, id, i);
-		TabListOverlay_QuickSort(i, i + (count - 1));
-		i += count;
-	}
+static void TabListOverlay_RemoveName(struct TabListOverlay* s, int i) {
+	TabListOverlay_DeleteAt(s, i);
+	if (s->classic || s->ids[i - 1] != GROUP_NAME_ID) return;
+
+	/* Also remove the group name when it was the only player in that group */
+	if (i == s->usedCount || s->ids[i] == GROUP_NAME_ID) TabListOverlay_DeleteAt(s, i - 1);
 }
 
-static void TabListOverlay_SortAndLayout(struct TabListOverlay* s) {
-	TabListOverlay_SortEntries(s);
+static void TabListOverlay_ChangedLayout(struct TabListOverlay* s) {
 	TabListOverlay_Layout(s);
 	s->dirty = true;
 }
 
 static void TabListOverlay_Add(void* obj, int id) {
 	struct TabListOverlay* s = (struct TabListOverlay*)obj;
-	TabListOverlay_AddName(s, id, -1);
-	TabListOverlay_SortAndLayout(s);
+	TabListOverlay_AddName(s, id);
+	TabListOverlay_ChangedLayout(s);
 }
 
 static void TabListOverlay_Update(void* obj, int id) {
@@ -714,10 +722,11 @@ static void TabListOverlay_Update(void* obj, int id) {
 	for (i = 0; i < s->usedCount; i++)
 	{
 		if (s->ids[i] != id) continue;
-		Gfx_DeleteTexture(&s->textures[i].ID);
 
-		TabListOverlay_AddName(s, id, i);
-		TabListOverlay_SortAndLayout(s);
+		/* Group or rank might have changed, so reinsert at the new sorted position */
+		TabListOverlay_RemoveName(s, i);
+		TabListOverlay_AddName(s, id);
+		TabListOverlay_ChangedLayout(s);
 		return;
 	}
 }
@@ -729,8 +738,8 @@ static void TabListOverlay_Remove(void* obj, int id) {
 	{
 		if (s->ids[i] != id) continue;
 
-		TabListOverlay_DeleteAt(s, i);
-		TabListOverlay_SortAndLayout(s);
+		TabListOverlay_RemoveName(s, i);
+		TabListOverlay_ChangedLayout(s);
 		return;
 	}
 }
@@ -794,9 +803,9 @@ static void TabListOverlay_ContextRecreated(void* screen) {
 	for (id = 0; id < TABLIST_MAX_NAMES; id++) 
 	{
 		if (!TabList.NameOffsets[id]) continue;
-		TabListOverlay_AddName(s, (EntityID)id, -1);
+		TabListOverlay_AddName(s, (EntityID)id);
 	}
-	TabListOverlay_SortAndLayout(s); /* TODO: Not do layout here too */
+	TabListOverlay_ChangedLayout(s); /* TODO: Not do layout here too */
 }
 
 static void TabListOverlay_BuildMesh(void* screen) {
@@ -1955,10 +1964,12 @@ static void LoadingScreen_Render(void* screen, float delta) {
 	offset = Widget_Render2(&s->message, offset);
 
 	filledWidth = (int)(s->progWidth * s->progress);
+	Gfx_Begin2DBatch();
 	Gfx_Draw2DFlat(s->progX, s->progY, s->progWidth, 
 					s->progHeight, PackedCol_Make(128, 128, 128, 255));
 	Gfx_Draw2DFlat(s->progX, s->progY, filledWidth,  
 					s->progHeight, PackedCol_Make(128, 255, 128, 255));
+	Gfx_End2DBatch();
 }
 
 static void LoadingScreen_Free(void* screen) {
@@ -103,12 +103,17 @@ static void CalcDists(struct SelectionBox* box, Vec3 P) {
 
 #define SELECTIONS_MAX 256
 #define SELECTIONS_VERTICES 24
-#define SELECTIONS_MAX_VERTICES SELECTIONS_MAX * SELECTIONS_VERTICES
 
 static int selections_count;
 static struct SelectionBox selections_list[SELECTIONS_MAX];
 static cc_uint8 selections_ids[SELECTIONS_MAX];
 static GfxResourceID selections_VB, selections_LineVB;
+/* Whether the vertex buffers need to be rebuilt, because boxes were added or removed */
+static cc_bool selections_changed;
+/* Camera position that the boxes were last sorted by */
+static Vec3 selections_sortPos;
+/* Boxes are only sorted again once the camera has moved at least this far (squared) */
+#define SELECTIONS_RESORT_DIST (1.0f * 1.0f)
 
 void Selections_Add(cc_uint8 id, const IVec3* p1, const IVec3* p2, PackedCol color) {
 	struct SelectionBox sel;
@@ -120,6 +125,7 @@ void Selections_Add(cc_uint8 id, const IVec3* p1, const IVec3* p2, PackedCol col
 	selections_list[selections_count] = sel;
 	selections_ids[selections_count]  = id;
 	selections_count++;
+	selections_changed = true;
 }
 
 void Selections_Remove(cc_uint8 id) {
@@ -133,18 +139,14 @@ void Selections_Remove(cc_uint8 id) {
 		}
 
 		selections_count--;
+		selections_changed = true;
 		return;
 	}
 }
 
 static void Selections_ContextLost(void* obj) {
-	Gfx_DeleteDynamicVb(&selections_VB);
-	Gfx_DeleteDynamicVb(&selections_LineVB);
-}
-
-static void AllocateVertexBuffers(void) {
-	selections_VB     = Gfx_CreateDynamicVb(VERTEX_FORMAT_COLOURED, SELECTIONS_MAX_VERTICES);
-	selections_LineVB = Gfx_CreateDynamicVb(VERTEX_FORMAT_COLOURED, SELECTIONS_MAX_VERTICES);
+	Gfx_DeleteVb(&selections_VB);
+	Gfx_DeleteVb(&selections_LineVB);
 }
 
 static void Selections_QuickSort(int left, int right) {
@@ -166,40 +168,54 @@ static void Selections_QuickSort(int left, int right) {
 	}
 }
 
-void Selections_Render(void) {
+/* Sorts the boxes by distance from the camera, then rebuilds the vertex buffers */
+static void UpdateVertexBuffers(Vec3 cameraPos) {
 	struct VertexColoured* data;
-	Vec3 cameraPos;
-	int i, count;
-	if (!selections_count) return;
+	int i, count = selections_count * SELECTIONS_VERTICES;
 
 	/* TODO: Proper selection box sorting. But this is very difficult because
 	   we can have boxes within boxes, intersecting boxes, etc. Probably not worth it. */
-	cameraPos = Camera.CurrentPos;
 	for (i = 0; i < selections_count; i++) {
 		CalcDists(&selections_list[i], cameraPos);
 	}
 	Selections_QuickSort(0, selections_count - 1);
 
-	/* lazy init as most servers don't use this */
-	if (!selections_VB) AllocateVertexBuffers();
-
-	count = selections_count * SELECTIONS_VERTICES;
-	Gfx_SetVertexFormat(VERTEX_FORMAT_COLOURED);
-
-	data = (struct VertexColoured*)Gfx_LockDynamicVb(selections_LineVB, 
+	data = (struct VertexColoured*)Gfx_RecreateAndLockVb(&selections_LineVB,
 										VERTEX_FORMAT_COLOURED, count);
 	for (i = 0; i < selections_count; i++, data += SELECTIONS_VERTICES) {
 		BuildEdges(&selections_list[i], data);
 	}
-	Gfx_UnlockDynamicVb(selections_LineVB);
-	Gfx_DrawVb_Lines(count);
+	Gfx_UnlockVb(selections_LineVB);
 
-	data = (struct VertexColoured*)Gfx_LockDynamicVb(selections_VB, 
+	data = (struct VertexColoured*)Gfx_RecreateAndLockVb(&selections_VB,
 										VERTEX_FORMAT_COLOURED, count);
 	for (i = 0; i < selections_count; i++, data += SELECTIONS_VERTICES) {
 		BuildFaces(&selections_list[i], data);
 	}
-	Gfx_UnlockDynamicVb(selections_VB);
+	Gfx_UnlockVb(selections_VB);
+
+	selections_changed = false;
+	selections_sortPos = cameraPos;
+}
+
+void Selections_Render(void) {
+	Vec3 cameraPos, delta;
+	int count;
+	if (!selections_count) return;
+
+	/* Boxes rarely change, so only rebuild when they do or the camera moved far enough to change the sort order */
+	cameraPos = Camera.CurrentPos;
+	Vec3_Sub(&delta, &cameraPos, &selections_sortPos);
+
+	if (selections_changed || !selections_VB || Vec3_LengthSquared(&delta) >= SELECTIONS_RESORT_DIST) {
+		UpdateVertexBuffers(cameraPos);
+	}
+
+	count = selections_count * SELECTIONS_VERTICES;
+	Gfx_SetVertexFormat(VERTEX_FORMAT_COLOURED);
+	Gfx_BindVb(selections_LineVB);
+	Gfx_DrawVb_Lines(count);
+	Gfx_BindVb(selections_VB);
 
 	Gfx_SetDepthWrite(false);
 	Gfx_SetAlphaBlending(true);
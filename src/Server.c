@@ -25,6 +25,9 @@
 #include "Input.h"
 #include "Errors.h"
 #include "Options.h"
+#include "Lighting.h"
+#include "Stream.h"
+#include "Deflate.h"
 
 static char nameBuffer[STRING_SIZE];
 static char motdBuffer[STRING_SIZE];
@@ -55,6 +58,59 @@ void Server_RetrieveTexturePack(const cc_string* url) {
 }
 
 
+/*########################################################################################################################*
+*-----------------------------------------------------Network statistics--------------------------------------------------*
+*#########################################################################################################################*/
+struct NetStats Server_Stats;
+int Server_StatsLogInterval;
+/* Statistics as of the last Server_LogStats call */
+static struct NetStats stats_logged;
+
+void Server_ResetStats(void) {
+	Mem_Set(&Server_Stats, 0, sizeof(Server_Stats));
+	Server_Stats.startTime = Game.Time;
+	stats_logged = Server_Stats;
+}
+
+static void NetStats_AddPing(cc_uint64 sent, cc_uint64 recv) {
+	int i, ms = Stopwatch_ElapsedMS(sent, recv), limit = 16;
+
+	for (i = 0; i < NETSTATS_PING_BUCKETS - 1; i++, limit *= 2) {
+		if (ms < limit) break;
+	}
+	Server_Stats.pingBuckets[i]++;
+}
+
+void Server_LogStats(void) {
+	cc_uint64 time, worstTime = 0;
+	float secs, recvKB, sentKB, worstMS;
+	int i, recvPackets, ping, worst = 0;
+	cc_uint8 opcode;
+
+	secs = (float)(Game.Time - stats_logged.startTime);
+	if (secs <= 0.0f) return;
+
+	for (i = 0; i < 256; i++) {
+		time = Server_Stats.opcodeTimes[i] - stats_logged.opcodeTimes[i];
+		if (time > worstTime) { worst = i; worstTime = time; }
+	}
+
+	recvKB  = (Server_Stats.bytesRecv - stats_logged.bytesRecv) / 1024.0f / secs;
+	sentKB  = (Server_Stats.bytesSent - stats_logged.bytesSent) / 1024.0f / secs;
+	worstMS = worstTime / 1000.0f;
+	recvPackets = (int)(Server_Stats.packetsRecv - stats_logged.packetsRecv);
+	opcode      = (cc_uint8)worst;
+	ping        = Ping_AveragePingMS();
+
+	Platform_Log4("Net: received %f2 KB/s (%i packets), sent %f2 KB/s, ping %i ms", 
+		&recvKB, &recvPackets, &sentKB, &ping);
+	Platform_Log2("Net: slowest packet handler was opcode %b (%f2 ms total)", &opcode, &worstMS);
+
+	stats_logged = Server_Stats;
+	stats_logged.startTime = Game.Time;
+}
+
+
 /*########################################################################################################################*
 *--------------------------------------------------------PingList---------------------------------------------------------*
 *#########################################################################################################################*/
@@ -81,6 +137,7 @@ void Ping_Update(int id) {
 		if (ping_entries[i].id != id) continue;
 
 		ping_entries[i].recv = Stopwatch_Measure();
+		NetStats_AddPing(ping_entries[i].sent, ping_entries[i].recv);
 		return;
 	}
 }
@@ -234,6 +291,10 @@ static cc_socket net_socket = -1;
 static cc_result net_writeFailure;
 static void OnClose(void);
 
+static char replayBuffer[FILENAME_SIZE];
+cc_string Server_ReplayFile = String_FromArray(replayBuffer);
+float Server_ReplaySpeed    = 1.0f;
+
 #ifdef CC_BUILD_NETWORKING
 static cc_uint8  net_readBuffer[4096 * 5];
 static cc_uint8* net_readCurrent;
@@ -244,6 +305,146 @@ static cc_bool net_connecting;
 static double net_connectTimeout;
 #define NET_TIMEOUT_SECS 15
 
+/* Data queued to be sent to the server, but not sent yet */
+static cc_uint8* net_writeBuffer;
+static cc_uint32 net_writeLength, net_writeCapacity;
+static double net_lastWrite;
+/* Once more than this many bytes are queued, non-essential packets (e.g. position updates) are skipped */
+#define NET_WRITE_BACKLOG (1024 * 16)
+static void MPConnection_FlushData(void);
+static void NetReader_Start(void);
+
+/* Captured data files are made up of a header and then a series of records */
+/*  Header: U8[4] "CCNC", U32 version */
+/*  Record: U32 milliseconds since connecting, U32 length, U8[length] data received from server */
+#define NETCAPTURE_VERSION 1
+#define NETCAPTURE_RECORD_SIZE 8
+static const cc_uint8 netCapture_sig[4] = { 'C','C','N','C' };
+
+static struct NetCapture {
+	struct Stream stream;
+	cc_uint64 start;
+	cc_bool active;
+} net_capture;
+
+static void NetCapture_End(void) {
+	if (!net_capture.active) return;
+	net_capture.active = false;
+	(void)net_capture.stream.Close(&net_capture.stream);
+}
+
+static void NetCapture_Begin(void) {
+	cc_string path; char pathBuffer[FILENAME_SIZE];
+	cc_uint8 header[8];
+	cc_result res;
+
+	String_InitArray(path, pathBuffer);
+	Options_Get(OPT_NET_CAPTURE, &path, "");
+	if (!path.length) return;
+
+	res = Stream_CreateFile(&net_capture.stream, &path);
+	if (res) { Logger_SysWarn2(res, "creating", &path); return; }
+
+	Mem_Copy(header, netCapture_sig, 4);
+	Stream_SetU32_LE(header + 4, NETCAPTURE_VERSION);
+	res = Stream_Write(&net_capture.stream, header, sizeof(header));
+
+	if (res) { Logger_SysWarn2(res, "writing", &path); (void)net_capture.stream.Close(&net_capture.stream); return; }
+	net_capture.active = true;
+	net_capture.start  = Stopwatch_Measure();
+}
+
+static void NetCapture_Write(const cc_uint8* data, cc_uint32 len) {
+	cc_uint8 record[NETCAPTURE_RECORD_SIZE];
+	cc_result res;
+	if (!net_capture.active) return;
+
+	Stream_SetU32_LE(record + 0, Stopwatch_ElapsedMS(net_capture.start, Stopwatch_Measure()));
+	Stream_SetU32_LE(record + 4, len);
+
+	if ((res = Stream_Write(&net_capture.stream, record, sizeof(record))) || (res = Stream_Write(&net_capture.stream, data, len))) {
+		Logger_SimpleWarn(res, "writing network capture");
+		NetCapture_End();
+	}
+}
+
+/* Replays data from a captured data file, instead of data received from a server */
+static struct NetReplay {
+	cc_uint8* data;
+	cc_uint8* cur;
+	cc_uint32 left, length;  /* Bytes remaining in file, total bytes in file */
+	cc_uint32 recordLeft;    /* Bytes remaining in the current record */
+	cc_uint64 start;
+	cc_bool active;
+} net_replay;
+
+static void NetReplay_End(void) {
+	Mem_Free(net_replay.data);
+	net_replay.data   = NULL;
+	net_replay.active = false;
+}
+
+static cc_result NetReplay_Begin(void) {
+	cc_result res = Stream_ReadAllFrom(&Server_ReplayFile, &net_replay.data, &net_replay.length);
+	if (res) return res;
+
+	if (net_replay.length < 8 || !Mem_Equal(net_replay.data, netCapture_sig, 4)) {
+		res = NETCAP_ERR_SIGNATURE;
+	} else if (Stream_GetU32_LE(net_replay.data + 4) != NETCAPTURE_VERSION) {
+		res = NETCAP_ERR_VERSION;
+	}
+	if (res) { NetReplay_End(); return res; }
+
+	net_replay.cur        = net_replay.data   + 8;
+	net_replay.left       = net_replay.length - 8;
+	net_replay.recordLeft = 0;
+	net_replay.start      = Stopwatch_Measure();
+	net_replay.active     = true;
+	return 0;
+}
+
+static void NetReplay_Finish(void) {
+	static const cc_string title = String_FromConst("Replay finished");
+	cc_string msg; char msgBuffer[STRING_SIZE];
+	float secs = Stopwatch_ElapsedMicroseconds(net_replay.start, Stopwatch_Measure()) / 1.0e6f;
+	float mb   = net_replay.length / (1024.0f * 1024.0f);
+
+	String_InitArray(msg, msgBuffer);
+	String_Format2(&msg, "Replayed %f2 MB of data in %f3 seconds", &mb, &secs);
+	Platform_Log(msg.buffer, msg.length);
+	Game_Disconnect(&title, &msg);
+}
+
+static cc_result NetReplay_Read(cc_uint8* dst, cc_uint32 count, cc_uint32* read) {
+	cc_uint32 time, elapsed;
+	*read = 0;
+
+	if (!net_replay.recordLeft) {
+		if (net_replay.left < NETCAPTURE_RECORD_SIZE) { NetReplay_Finish(); return 0; }
+		time = Stream_GetU32_LE(net_replay.cur);
+
+		/* Replay speed of 0 or less means to replay as fast as possible */
+		if (Server_ReplaySpeed > 0.0f) {
+			elapsed = Stopwatch_ElapsedMS(net_replay.start, Stopwatch_Measure());
+			if (elapsed * Server_ReplaySpeed < time) return ReturnCode_SocketWouldBlock;
+		}
+
+		net_replay.recordLeft = Stream_GetU32_LE(net_replay.cur + 4);
+		net_replay.cur  += NETCAPTURE_RECORD_SIZE;
+		net_replay.left -= NETCAPTURE_RECORD_SIZE;
+		if (net_replay.recordLeft > net_replay.left) return ERR_END_OF_STREAM;
+	}
+
+	count = min(count, net_replay.recordLeft);
+	Mem_Copy(dst, net_replay.cur, count);
+	*read = count;
+
+	net_replay.cur        += count;
+	net_replay.left       -= count;
+	net_replay.recordLeft -= count;
+	return 0;
+}
+
 static void MPConnection_FinishConnect(void) {
 	net_connecting = false;
 	Event_RaiseVoid(&NetEvents.Connected);
@@ -251,7 +452,14 @@ static void MPConnection_FinishConnect(void) {
 
 	net_readCurrent = net_readBuffer;
 	net_lastPacket  = Game.Time;
+	net_lastWrite   = Game.Time;
+	Server_ResetStats();
+	if (!net_replay.active) {
+		NetCapture_Begin();
+		NetReader_Start();
+	}
 	Classic_SendLogin();
+	MPConnection_FlushData();
 }
 
 static void MPConnection_Fail(const cc_string* reason) {
@@ -308,6 +516,15 @@ static void MPConnection_BeginConnect(void) {
 	Blocks.CanPlace[BLOCK_STILL_LAVA] = false;  Blocks.CanDelete[BLOCK_STILL_LAVA] = false;
 	Blocks.CanPlace[BLOCK_STILL_WATER] = false; Blocks.CanDelete[BLOCK_STILL_WATER] = false;
 	Blocks.CanPlace[BLOCK_BEDROCK] = false;     Blocks.CanDelete[BLOCK_BEDROCK] = false;
+
+	if (Server_ReplayFile.length) {
+		res = NetReplay_Begin();
+		if (res) { Logger_SysWarn2(res, "replaying", &Server_ReplayFile); MPConnection_FailConnect(0); return; }
+
+		Server.Disconnected = false;
+		MPConnection_FinishConnect();
+		return;
+	}
 	
 	res = Socket_ParseAddress(&Server.Address, Server.Port, addrs, &numValidAddrs);
 	if (res == ERR_INVALID_ARGUMENT) {
@@ -377,65 +594,345 @@ static void DisconnectInvalidOpcode(cc_uint8 opcode) {
 	Game_Disconnect(&title, &tmp); return;
 }
 
-static void MPConnection_Tick(struct ScheduledTask* task) {
+/* Once the server begins a compressed stream, all data received from it afterwards is DEFLATE compressed */
+static struct NetInflater {
+	struct InflateState* state;
+	struct Stream stream, source;
+	cc_uint8* pending;      /* Compressed data received together with the packet that began the stream */
+	cc_uint32 pendingLeft;
+	cc_uint32 pendingIndex;
+	cc_bool active, starting, wouldBlock;
+} net_inflate;
+
+void Server_BeginCompressedStream(void) {
+	/* Captured data is stored after decompression, so must not be decompressed again when replaying */
+	if (net_replay.active || net_inflate.active) return;
+	net_inflate.starting = true;
+}
+
+static void NetInflate_End(void) {
+	Mem_Free(net_inflate.state);
+	Mem_Free(net_inflate.pending);
+	net_inflate.state    = NULL;
+	net_inflate.pending  = NULL;
+	net_inflate.active   = false;
+	net_inflate.starting = false;
+}
+
+static void NetInflate_Start(cc_uint8* pending, cc_uint32 len);
+
+/* NOTE: using a read call that is a multiple of 4096 (appears to?) improve read performance */
+#define NET_READ_SIZE (4096 * 4)
+/* Maximum time spent reading and handling received data in one network tick */
+#define NET_READ_BUDGET_MS 10
+
+static void MPConnection_HandleData(cc_uint32 read) {
 	Net_Handler handler;
 	cc_uint8* readEnd;
 	cc_uint8* readCur;
-	cc_uint32 read;
 	int i, remaining;
+	cc_bool isBlock, batching = false;
+	cc_bool isBlockDef, batchingDefs = false;
+	cc_uint64 beg;
+
+	readCur        = net_readBuffer;
+	readEnd        = net_readCurrent + read;
+	net_lastPacket = Game.Time;
+	if (!net_inflate.active) Server_Stats.bytesRecv += read;
+	Protocol_BeginMovementBatch();
+
+	while (readCur < readEnd) {
+		cc_uint8 opcode = readCur[0];
+
+		/* Workaround for older D3 servers which wrote one byte too many for HackControl packets */
+		if (cpe_needD3Fix && lastOpcode == OPCODE_HACK_CONTROL && (opcode == 0x00 || opcode == 0xFF)) {
+			Platform_LogConst("Skipping invalid HackControl byte from D3 server");
+			readCur++;
+			LocalPlayer_ResetJumpVelocity(Entities.CurPlayer);
+			continue;
+		}
+
+		if (readCur + Protocol.Sizes[opcode] > readEnd) break;
+		handler = Protocol.Handlers[opcode];
+		isBlock = opcode == OPCODE_SET_BLOCK || opcode == OPCODE_BULK_BLOCK_UPDATE;
+
+		/* Servers often send many block changes in a row (e.g. /cuboid), so only */
+		/*  recalculate lighting once after the whole run of block change packets */
+		/* NOTE: Batch must be ended before any other packet, as it might e.g. change the map */
+		if (isBlock != batching) {
+			batching = isBlock;
+			if (batching) { Lighting_BeginBatch(); } else { Lighting_EndBatch(); }
+		}
+
+		/* Servers usually send hundreds of block definitions when joining, so likewise */
+		/*  only update culling and refresh the world once after the whole run of them */
+		isBlockDef = opcode == OPCODE_DEFINE_BLOCK || opcode == OPCODE_DEFINE_BLOCK_EXT || opcode == OPCODE_UNDEFINE_BLOCK;
+		if (isBlockDef != batchingDefs) {
+			batchingDefs = isBlockDef;
+			if (batchingDefs) { Block_BeginDefineBatch(); } else { Block_EndDefineBatch(); }
+		}
+		if (!handler) {
+			NetCapture_Write(net_readCurrent, (cc_uint32)(readEnd - net_readCurrent));
+			DisconnectInvalidOpcode(opcode); return;
+		}
+
+		lastOpcode = opcode;
+		beg = Stopwatch_Measure();
+		handler(readCur + 1); /* skip opcode */
+		readCur += Protocol.Sizes[opcode];
+
+		Server_Stats.packetsRecv++;
+		Server_Stats.opcodeCounts[opcode]++;
+		Server_Stats.opcodeTimes[opcode] += Stopwatch_ElapsedMicroseconds(beg, Stopwatch_Measure());
+
+		/* Rest of the received data belongs to the compressed stream */
+		if (net_inflate.starting) break;
+	}
+	if (batching) Lighting_EndBatch();
+	if (batchingDefs) Block_EndDefineBatch();
+	Protocol_EndMovementBatch();
+
+	/* Only the data before the compressed stream began is captured here, */
+	/*  as data from the compressed stream is captured after decompression */
+	NetCapture_Write(net_readCurrent, (cc_uint32)((net_inflate.starting ? readCur : readEnd) - net_readCurrent));
+	if (net_inflate.starting) {
+		NetInflate_Start(readCur, (cc_uint32)(readEnd - readCur));
+		net_readCurrent = net_readBuffer;
+		return;
+	}
+
+	/* Protocol packets might be split up across TCP packets */
+	/* If so, copy last few unprocessed bytes back to beginning of buffer */
+	/* These bytes are then later combined with subsequently read TCP packet data */
+	/* (this is always less than one packet, so is much cheaper than the read itself) */
+	remaining = (int)(readEnd - readCur);
+	for (i = 0; i < remaining; i++) 
+	{
+		net_readBuffer[i] = readCur[i];
+	}
+	net_readCurrent = net_readBuffer + remaining;
+}
+
+#if defined CC_BUILD_BUILDERTHREADS && !defined CC_BUILD_WEB
+/* Size of the buffer data received by the reader thread is stored in (must be power of two) */
+#define NET_RING_SIZE (1024 * 1024)
+#define NET_RING_MASK (NET_RING_SIZE - 1)
+/* How long the reader thread blocks waiting for data before checking whether it should stop */
+#define NET_READER_WAIT_MS 100
+
+/* When enabled, a background thread reads from the socket as soon as data arrives, */
+/*  so data is still received while the main thread is busy with a long frame */
+/* Packets are still framed and handled on the main thread, as the size of some packets */
+/*  (Protocol.Sizes) changes depending on what CPE extensions the server supports */
+static struct NetReader {
+	void* thread;
+	void* lock;
+	cc_uint8* ring;
+	cc_uint32 head; /* Total bytes written into ring by reader thread */
+	cc_uint32 tail; /* Total bytes read from ring by main thread */
+	cc_result res;  /* Error from socket read, 0 if none */
+	cc_bool closed; /* Whether socket read returned 0 bytes (socket closed) */
+	volatile cc_bool stop;
+} net_reader;
+
+static void NetReader_Run(void) {
+	cc_uint32 head, space, read;
+	cc_bool readable;
+	cc_result res;
+
+	while (!net_reader.stop) {
+		Mutex_Lock(net_reader.lock);
+		{
+			head = net_reader.head;
+			space = NET_RING_SIZE - (head - net_reader.tail);
+		}
+		Mutex_Unlock(net_reader.lock);
+
+		/* Main thread hasn't caught up yet */
+		if (!space) { Thread_Sleep(1); continue; }
+		/* Only read up to the end of the ring buffer, the rest is read next time */
+		space = min(space, NET_RING_SIZE - (head & NET_RING_MASK));
+
+		/* Sleep until data arrives, rather than repeatedly trying to read */
+		res = Socket_WaitReadable(net_socket, NET_READER_WAIT_MS, &readable);
+		if (!res && !readable) continue;
+		read = 0;
+
+		if (!res) {
+			res = Socket_Read(net_socket, net_reader.ring + (head & NET_RING_MASK), min(space, NET_READ_SIZE), &read);
+			if (res == ReturnCode_SocketInProgess || res == ReturnCode_SocketWouldBlock) continue;
+		}
+
+		Mutex_Lock(net_reader.lock);
+		{
+			net_reader.head   += read;
+			net_reader.res     = res;
+			net_reader.closed  = !res && !read;
+		}
+		Mutex_Unlock(net_reader.lock);
+		if (res || !read) return;
+	}
+}
+
+static void NetReader_Start(void) {
+	if (!Options_GetBool(OPT_NET_THREAD, false)) return;
+
+	net_reader.ring = (cc_uint8*)Mem_TryAlloc(NET_RING_SIZE, 1);
+	if (!net_reader.ring) return;
+
+	net_reader.lock   = Mutex_Create("Net reader");
+	net_reader.head   = 0;
+	net_reader.tail   = 0;
+	net_reader.res    = 0;
+	net_reader.closed = false;
+	net_reader.stop   = false;
+	Thread_Run(&net_reader.thread, NetReader_Run, 64 * 1024, "Net reader");
+}
+
+static void NetReader_Stop(void) {
+	if (!net_reader.thread) return;
+	net_reader.stop = true;
+	Thread_Join(net_reader.thread);
+
+	Mutex_Free(net_reader.lock);
+	Mem_Free(net_reader.ring);
+	net_reader.thread = NULL;
+	net_reader.lock   = NULL;
+	net_reader.ring   = NULL;
+}
+
+static cc_result MPConnection_ReadData(cc_uint8* dst, cc_uint32 count, cc_uint32* read) {
+	cc_uint32 tail, avail, len;
+	cc_result res;
+	cc_bool closed;
+	if (net_replay.active)  return NetReplay_Read(dst, count, read);
+	if (!net_reader.thread) return Socket_Read(net_socket, dst, count, read);
+
+	Mutex_Lock(net_reader.lock);
+	{
+		tail   = net_reader.tail;
+		avail  = net_reader.head - tail;
+		res    = net_reader.res;
+		closed = net_reader.closed;
+	}
+	Mutex_Unlock(net_reader.lock);
+
+	/* Report errors only after all the data received before them has been handled */
+	*read = 0;
+	if (!avail) return res ? res : (closed ? 0 : ReturnCode_SocketWouldBlock);
+
+	count = min(count, avail);
+	tail &= NET_RING_MASK;
+	len   = min(count, NET_RING_SIZE - tail);
+
+	Mem_Copy(dst,       net_reader.ring + tail, len);
+	Mem_Copy(dst + len, net_reader.ring,        count - len);
+	*read = count;
+
+	Mutex_Lock(net_reader.lock);
+	{
+		net_reader.tail += count;
+	}
+	Mutex_Unlock(net_reader.lock);
+	return 0;
+}
+#else
+static void NetReader_Start(void) { }
+static void NetReader_Stop(void)  { }
+
+static cc_result MPConnection_ReadData(cc_uint8* dst, cc_uint32 count, cc_uint32* read) {
+	if (net_replay.active) return NetReplay_Read(dst, count, read);
+	return Socket_Read(net_socket, dst, count, read);
+}
+#endif
+
+static cc_result NetInflate_ReadSource(struct Stream* s, cc_uint8* dst, cc_uint32 count, cc_uint32* read) {
+	cc_result res;
+
+	if (net_inflate.pendingLeft) {
+		count = min(count, net_inflate.pendingLeft);
+		Mem_Copy(dst, net_inflate.pending + net_inflate.pendingIndex, count);
+
+		net_inflate.pendingIndex += count;
+		net_inflate.pendingLeft  -= count;
+		*read = count;
+		return 0;
+	}
+
+	res = MPConnection_ReadData(dst, count, read);
+	Server_Stats.bytesRecv += *read;
+	/* Inflater stops once no more input is available, and continues from there on the next read */
+	if (res == ReturnCode_SocketInProgess || res == ReturnCode_SocketWouldBlock) {
+		net_inflate.wouldBlock = true;
+		*read = 0; return 0;
+	}
+	return res;
+}
+
+static void NetInflate_Start(cc_uint8* pending, cc_uint32 len) {
+	net_inflate.starting = false;
+	net_inflate.state    = (struct InflateState*)Mem_Alloc(1, sizeof(struct InflateState), "net inflate state");
+
+	if (len) {
+		net_inflate.pending = (cc_uint8*)Mem_Alloc(len, 1, "net inflate pending");
+		Mem_Copy(net_inflate.pending, pending, len);
+	}
+	net_inflate.pendingLeft  = len;
+	net_inflate.pendingIndex = 0;
+
+	Stream_Init(&net_inflate.source);
+	net_inflate.source.Read = NetInflate_ReadSource;
+	Inflate_MakeStream2(&net_inflate.stream, net_inflate.state, &net_inflate.source);
+	net_inflate.active = true;
+}
+
+static cc_result NetInflate_Read(cc_uint8* dst, cc_uint32 count, cc_uint32* read) {
+	cc_result res;
+	net_inflate.wouldBlock = false;
+
+	res = net_inflate.stream.Read(&net_inflate.stream, dst, count, read);
+	if (res) return res;
+
+	/* Report the same result as a socket read would when no data is available */
+	if (!*read && net_inflate.wouldBlock) return ReturnCode_SocketWouldBlock;
+	return 0;
+}
+
+static void MPConnection_DoTick(void) {
+	cc_uint64 beg = Stopwatch_Measure();
+	cc_uint32 read;
 	cc_result res;
 
 	if (Server.Disconnected) return;
 	if (net_connecting) { MPConnection_TickConnect(); return; }
 
-	/* NOTE: using a read call that is a multiple of 4096 (appears to?) improve read performance */	
-	res = Socket_Read(net_socket, net_readCurrent, 4096 * 4, &read);
+	/* Keep reading until there is no more data available, so that throughput */
+	/*  (e.g. when downloading a large map) isn't limited to one read per tick */
+	for (;;) {
+		if (net_inflate.active) {
+			res = NetInflate_Read(net_readCurrent, NET_READ_SIZE, &read);
+		} else {
+			res = MPConnection_ReadData(net_readCurrent, NET_READ_SIZE, &read);
+		}
 	
-	if (res) {
-		/* 'no data available for non-blocking read' is an expected error */
-		if (res == ReturnCode_SocketInProgess)  res = 0;
-		if (res == ReturnCode_SocketWouldBlock) res = 0;
-
-		if (res) { DisconnectReadFailed(res); return; }
-	} else if (read == 0) {
-		/* recv only returns 0 read when socket is closed.. probably? */
-		/* Over 30 seconds since last packet, connection probably dropped */
-		/* TODO: Should this be checked unconditonally instead of just when read = 0 ? */
-		if (net_lastPacket + 30 < Game.Time) { MPConnection_Disconnect(); return; }
-	} else {
-		readCur        = net_readBuffer;
-		readEnd        = net_readCurrent + read;
-		net_lastPacket = Game.Time;
-
-		while (readCur < readEnd) {
-			cc_uint8 opcode = readCur[0];
-
-			/* Workaround for older D3 servers which wrote one byte too many for HackControl packets */
-			if (cpe_needD3Fix && lastOpcode == OPCODE_HACK_CONTROL && (opcode == 0x00 || opcode == 0xFF)) {
-				Platform_LogConst("Skipping invalid HackControl byte from D3 server");
-				readCur++;
-				LocalPlayer_ResetJumpVelocity(Entities.CurPlayer);
-				continue;
-			}
-
-			if (readCur + Protocol.Sizes[opcode] > readEnd) break;
-			handler = Protocol.Handlers[opcode];
-			if (!handler) { DisconnectInvalidOpcode(opcode); return; }
-
-			lastOpcode = opcode;
-			handler(readCur + 1); /* skip opcode */
-			readCur += Protocol.Sizes[opcode];
+		if (res) {
+			/* 'no data available for non-blocking read' is an expected error */
+			if (res == ReturnCode_SocketInProgess)  break;
+			if (res == ReturnCode_SocketWouldBlock) break;
+
+			DisconnectReadFailed(res); return;
+		} else if (read == 0) {
+			/* recv only returns 0 read when socket is closed.. probably? */
+			/* Over 30 seconds since last packet, connection probably dropped */
+			/* TODO: Should this be checked unconditonally instead of just when read = 0 ? */
+			if (net_lastPacket + 30 < Game.Time) { MPConnection_Disconnect(); return; }
+			break;
 		}
 
-		/* Protocol packets might be split up across TCP packets */
-		/* If so, copy last few unprocessed bytes back to beginning of buffer */
-		/* These bytes are then later combined with subsequently read TCP packet data */
-		remaining = (int)(readEnd - readCur);
-		for (i = 0; i < remaining; i++) 
-		{
-			net_readBuffer[i] = readCur[i];
-		}
-		net_readCurrent = net_readBuffer + remaining;
+		MPConnection_HandleData(read);
+		if (Server.Disconnected) return;
+		/* Avoid stalling the game when the server is sending data faster than it can be handled */
+		if (Stopwatch_ElapsedMS(beg, Stopwatch_Measure()) >= NET_READ_BUDGET_MS) break;
 	}
 
 	if (net_writeFailure) {
@@ -444,33 +941,107 @@ static void MPConnection_Tick(struct ScheduledTask* task) {
 	}
 
 	/* Network is ticked 60 times a second. We only send position updates 20 times a second */
-	if ((ticks++ % 3) != 0) return;
+	if ((ticks++ % 3) == 0) {
+		TexturePack_CheckPending();
+		Protocol_Tick();
+	}
+	/* Send all the packets queued during this tick together */
+	MPConnection_FlushData();
 
-	TexturePack_CheckPending();
-	Protocol_Tick();
+	if (Server_StatsLogInterval && Game.Time >= stats_logged.startTime + Server_StatsLogInterval) {
+		Server_LogStats();
+	}
 }
 
-static void MPConnection_SendData(const cc_uint8* data, cc_uint32 len) {
-	cc_uint32 wrote;
+static void MPConnection_Tick(struct ScheduledTask* task) {
+	Tracer_Begin("MPConnection_Tick");
+	MPConnection_DoTick();
+	Tracer_End();
+}
+
+/* Sends as much of the queued data as possible without blocking */
+static void MPConnection_FlushData(void) {
+	cc_uint32 sent = 0, wrote;
 	cc_result res;
-	int tries = 0;
-	if (Server.Disconnected) return;
+	if (Server.Disconnected || net_connecting) return;
+	/* There's no server to send data to when replaying */
+	if (net_replay.active) { net_writeLength = 0; return; }
 
-	while (len) {
-		res = Socket_Write(net_socket, data, len, &wrote);
-		/* If sending would block (send buffer full), retry for a bit up to 10 seconds */
-		/* TODO: Avoid doing this and manually buffer data when this happens */
-		if (res && tries < 1000 && (res == ReturnCode_SocketInProgess || res == ReturnCode_SocketWouldBlock)) {
-			Thread_Sleep(10);
-			tries++;
-			continue;
-		}
+	while (sent < net_writeLength) {
+		res = Socket_Write(net_socket, net_writeBuffer + sent, net_writeLength - sent, &wrote);
+		/* Send buffer is full, so try sending the rest of the data next tick */
+		if (res == ReturnCode_SocketInProgess || res == ReturnCode_SocketWouldBlock) break;
 
 		/* NOTE: Not immediately disconnecting here, as otherwise we sometimes miss out on kick messages */
 		if (res)    { net_writeFailure = res;                  return; }
 		if (!wrote) { net_writeFailure = ERR_INVALID_ARGUMENT; return; }
+		sent += wrote;
+	}
+
+	if (sent) {
+		Server_Stats.bytesSent += sent;
+		net_writeLength -= sent;
+		Mem_Move(net_writeBuffer, net_writeBuffer + sent, net_writeLength);
+		net_lastWrite = Game.Time;
+	} else if (!net_writeLength) {
+		net_lastWrite = Game.Time;
+	} else if (net_lastWrite + 10 < Game.Time) {
+		/* Server hasn't accepted any data for over 10 seconds, connection probably dropped */
+		net_writeFailure = ReturnCode_SocketWouldBlock;
+	}
+}
+
+static void MPConnection_SendData(const cc_uint8* data, cc_uint32 len) {
+	cc_uint8* buffer;
+	cc_uint32 capacity;
+	if (Server.Disconnected) return;
+
+	if (net_writeLength + len > net_writeCapacity) {
+		capacity = max(net_writeCapacity * 2, net_writeLength + len);
+		capacity = max(capacity, 4096);
+
+		/* NOTE: Not all platforms support reallocating a NULL pointer */
+		if (net_writeBuffer) {
+			buffer = (cc_uint8*)Mem_TryRealloc(net_writeBuffer, capacity, 1);
+		} else {
+			buffer = (cc_uint8*)Mem_TryAlloc(capacity, 1);
+		}
+		if (!buffer) { net_writeFailure = ERR_OUT_OF_MEMORY; return; }
 
-		data += wrote; len -= wrote;
+		net_writeBuffer   = buffer;
+		net_writeCapacity = capacity;
+	}
+
+	/* Data is only actually sent in MPConnection_FlushData, so that small packets get combined */
+	Mem_Copy(net_writeBuffer + net_writeLength, data, len);
+	net_writeLength += len;
+	Server_Stats.packetsSent++;
+}
+
+static void MPConnection_ClearData(void) {
+	Mem_Free(net_writeBuffer);
+	net_writeBuffer   = NULL;
+	net_writeLength   = 0;
+	net_writeCapacity = 0;
+}
+
+cc_bool Server_IsSendBacklogged(void) {
+	return !Server.IsSinglePlayer && net_writeLength > NET_WRITE_BACKLOG;
+}
+
+static void MPConnection_Close(void) {
+	/* Try to send any remaining data (e.g. a final chat message) before closing */
+	MPConnection_FlushData();
+	MPConnection_ClearData();
+	/* Reader thread must be stopped first, as it uses the socket */
+	NetReader_Stop();
+	NetCapture_End();
+	NetInflate_End();
+
+	if (net_replay.active) {
+		NetReplay_End();
+	} else {
+		Socket_Close(net_socket);
 	}
 }
 
@@ -487,6 +1058,9 @@ static void MPConnection_Init(void) {
 }
 #else
 static void MPConnection_Init(void) { SPConnection_Init(); }
+static void MPConnection_Close(void) { Socket_Close(net_socket); }
+cc_bool Server_IsSendBacklogged(void) { return false; }
+void Server_BeginCompressedStream(void) { }
 #endif
 
 
@@ -517,6 +1091,7 @@ static void OnInit(void) {
 
 	ScheduledTask_Add(GAME_NET_TICKS, Server.Tick);
 	String_AppendConst(&Server.AppName, GAME_APP_NAME);
+	Server_StatsLogInterval = Options_GetInt(OPT_NET_STATS_LOG, 0, 3600, 0);
 	String_AppendConst(&Server.AppName, Platform_AppNameSuffix);
 
 #ifdef CC_BUILD_WEB
@@ -544,7 +1119,7 @@ static void OnClose(void) {
 		Ping_Reset();
 		if (Server.Disconnected) return;
 
-		Socket_Close(net_socket);
+		MPConnection_Close();
 		Server.Disconnected = true;
 	}
 }
@@ -74,6 +74,43 @@ CC_VAR extern struct _ServerConnectionData {
 /* Otherwise just calls TexturePack_Extract */
 void Server_RetrieveTexturePack(const cc_string* url);
 
+/* Number of round trip time ranges in the ping histogram, each range being twice as long as the last */
+#define NETSTATS_PING_BUCKETS 8
+/* Network traffic statistics for the current multiplayer connection */
+struct NetStats {
+	double startTime;        /* Game.Time when statistics were last reset */
+	cc_uint64 bytesRecv;     /* Number of bytes received from the server */
+	cc_uint64 bytesSent;     /* Number of bytes sent to the server */
+	cc_uint32 packetsRecv;   /* Number of packets received from the server */
+	cc_uint32 packetsSent;   /* Number of packets (or groups of packets) sent to the server */
+	cc_uint32 opcodeCounts[256]; /* Number of packets received of each opcode */
+	cc_uint64 opcodeTimes[256];  /* Total time spent in the handler of each opcode, in microseconds */
+	cc_uint32 pingBuckets[NETSTATS_PING_BUCKETS]; /* Histogram of ping round trip times, starting from under 16 ms */
+	cc_uint32 blocksPredicted; /* Number of block changes by the player applied before the server replied */
+	cc_uint32 blocksCorrected; /* Number of predicted blocks the server replied with a different block for */
+	cc_uint32 blocksIgnored;   /* Number of blocks from the server ignored, as they were already shown */
+};
+extern struct NetStats Server_Stats;
+/* Seconds between logging a summary of network statistics, 0 if disabled */
+extern int Server_StatsLogInterval;
+/* Resets all network statistics to 0 */
+void Server_ResetStats(void);
+/* Logs a one line summary of network statistics since the last time this was called */
+void Server_LogStats(void);
+
+/* Whether a lot of data is still waiting to be sent to the server */
+/* (e.g. when placing many blocks at once), so non-essential packets should be skipped */
+cc_bool Server_IsSendBacklogged(void);
+/* Makes all data received from the server after the current packet be decompressed using DEFLATE */
+/* NOTE: Only valid to call from within the handler of a received packet */
+void Server_BeginCompressedStream(void);
+
+/* Path of a file of previously captured server data (see the net-capture option), */
+/*  which is replayed instead of connecting to a server when not empty */
+extern cc_string Server_ReplayFile;
+/* Speed data is replayed at compared to when it was captured, 0 to replay as fast as possible */
+extern float Server_ReplaySpeed;
+
 /* Path of map to automatically load in singleplayer */
 extern cc_string SP_AutoloadMap;
 
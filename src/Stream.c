@@ -123,6 +123,17 @@ cc_result Stream_OpenFile(struct Stream* s, const cc_string* path) {
 	return res;
 }
 
+cc_result Stream_OpenSequentialFile(struct Stream* s, const cc_string* path) {
+	cc_filepath str;
+	cc_file file;
+	cc_result res;
+	Platform_EncodePath(&str, path);
+
+	res = File_OpenSequential(&file, &str);
+	Stream_FromFile(s, file);
+	return res;
+}
+
 cc_result Stream_CreateFile(struct Stream* s, const cc_string* path) {
 	cc_filepath str;
 	cc_file file;
@@ -158,6 +169,27 @@ cc_result Stream_WriteAllTo(const cc_string* path, const cc_uint8* data, cc_uint
 	return res ? res : closeRes;
 }
 
+cc_result Stream_ReadAllFrom(const cc_string* path, cc_uint8** data, cc_uint32* length) {
+	struct Stream stream;
+	cc_result res;
+	*data   = NULL;
+	*length = 0;
+
+	res = Stream_OpenSequentialFile(&stream, path);
+	if (res) return res;
+
+	if (!(res = stream.Length(&stream, length))) {
+		/* Always allocate at least 1 byte, so empty files still return a valid buffer */
+		*data = (cc_uint8*)Mem_TryAlloc(max(*length, 1), 1);
+		res   = *data ? Stream_Read(&stream, *data, *length) : ERR_OUT_OF_MEMORY;
+	}
+
+	/* No point checking error for closing readonly file */
+	(void)stream.Close(&stream);
+	if (res) { Mem_Free(*data); *data = NULL; }
+	return res;
+}
+
 void Stream_FromFile(struct Stream* s, cc_file file) {
 	Stream_Init(s);
 	s->meta.file = file;
@@ -172,6 +204,215 @@ void Stream_FromFile(struct Stream* s, cc_file file) {
 }
 
 
+/*########################################################################################################################*
+*---------------------------------------------------Background file ops---------------------------------------------------*
+*#########################################################################################################################*/
+struct FileOp {
+	struct FileOp* next;
+	cc_string path; char pathBuffer[FILENAME_SIZE];
+	cc_uint8* data;
+	cc_uint32 length;
+	cc_bool write;
+	cc_result res;
+	FileOp_Writer writer;
+	FileOp_Callback callback;
+	void* obj;
+};
+
+static cc_result FileOp_RunWriter(struct FileOp* op) {
+	struct Stream stream;
+	cc_result res, closeRes;
+
+	res = Stream_CreateFile(&stream, &op->path);
+	if (res) return res;
+
+	res      = op->writer(&stream, op->obj);
+	closeRes = stream.Close(&stream);
+	return res ? res : closeRes;
+}
+
+static void FileOp_Run(struct FileOp* op) {
+	if (op->writer) {
+		op->res = FileOp_RunWriter(op);
+	} else if (op->write) {
+		op->res = Stream_WriteAllTo(&op->path, op->data, op->length);
+	} else {
+		op->res = Stream_ReadAllFrom(&op->path, &op->data, &op->length);
+	}
+}
+
+static void FileOp_Complete(struct FileOp* op) {
+	if (op->callback && op->write) {
+		op->callback(&op->path, NULL, 0, op->res, op->obj);
+	} else if (op->callback) {
+		op->callback(&op->path, op->data, op->length, op->res, op->obj);
+	}
+	Mem_Free(op->data);
+	Mem_Free(op);
+}
+
+#ifndef CC_BUILD_COOPTHREADED
+/* Operations are run one at a time in submission order on a single thread, */
+/*  so that e.g. a later write to the same file always overwrites an earlier one */
+static void* fileops_thread;
+static void* fileops_mutex;
+static void* fileops_waitable;
+static cc_bool fileops_quit;
+static struct FileOp* pending_head;
+static struct FileOp* pending_tail;
+static struct FileOp* completed_head;
+static struct FileOp* completed_tail;
+
+static void FileOps_Append(struct FileOp** head, struct FileOp** tail, struct FileOp* op) {
+	op->next = NULL;
+	if (*tail) { (*tail)->next = op; } else { *head = op; }
+	*tail = op;
+}
+
+static void FileOps_RunLoop(void) {
+	struct FileOp* op;
+	cc_bool quit;
+
+	for (;;) {
+		Mutex_Lock(fileops_mutex);
+		{
+			op   = pending_head;
+			quit = fileops_quit;
+			if (op) {
+				pending_head = op->next;
+				if (!pending_head) pending_tail = NULL;
+			}
+		}
+		Mutex_Unlock(fileops_mutex);
+
+		if (!op) {
+			if (quit) return;
+			Waitable_Wait(fileops_waitable);
+			continue;
+		}
+		FileOp_Run(op);
+
+		Mutex_Lock(fileops_mutex);
+		{
+			FileOps_Append(&completed_head, &completed_tail, op);
+		}
+		Mutex_Unlock(fileops_mutex);
+	}
+}
+
+static void FileOps_Submit(struct FileOp* op) {
+	if (!fileops_thread) {
+		fileops_quit     = false;
+		fileops_mutex    = Mutex_Create("File ops");
+		fileops_waitable = Waitable_Create("File ops");
+		Thread_Run(&fileops_thread, FileOps_RunLoop, 64 * 1024, "File ops");
+	}
+
+	Mutex_Lock(fileops_mutex);
+	{
+		FileOps_Append(&pending_head, &pending_tail, op);
+	}
+	Mutex_Unlock(fileops_mutex);
+	Waitable_Signal(fileops_waitable);
+}
+
+void Stream_PollFileOps(void) {
+	struct FileOp* op;
+	struct FileOp* next;
+	if (!fileops_thread) return;
+
+	Mutex_Lock(fileops_mutex);
+	{
+		op = completed_head;
+		completed_head = NULL;
+		completed_tail = NULL;
+	}
+	Mutex_Unlock(fileops_mutex);
+
+	for (; op; op = next) {
+		next = op->next;
+		FileOp_Complete(op);
+	}
+}
+
+void Stream_FinishFileOps(void) {
+	if (!fileops_thread) return;
+
+	Mutex_Lock(fileops_mutex);
+	{
+		fileops_quit = true;
+	}
+	Mutex_Unlock(fileops_mutex);
+	Waitable_Signal(fileops_waitable);
+
+	Thread_Join(fileops_thread);
+	Stream_PollFileOps();
+
+	Waitable_Free(fileops_waitable);
+	Mutex_Free(fileops_mutex);
+	fileops_thread = NULL;
+	fileops_mutex  = NULL;
+}
+#else
+/* No real threads, so just run the operation immediately instead */
+static void FileOps_Submit(struct FileOp* op) {
+	FileOp_Run(op);
+	FileOp_Complete(op);
+}
+
+void Stream_PollFileOps(void)   { }
+void Stream_FinishFileOps(void) { }
+#endif
+
+static struct FileOp* FileOp_Make(const cc_string* path, FileOp_Callback callback, void* obj) {
+	struct FileOp* op = (struct FileOp*)Mem_TryAllocCleared(1, sizeof(struct FileOp));
+	if (!op) return NULL;
+
+	String_InitArray(op->path, op->pathBuffer);
+	String_Copy(&op->path, path);
+	op->callback = callback;
+	op->obj      = obj;
+	return op;
+}
+
+void Stream_ReadAllAsync(const cc_string* path, FileOp_Callback callback, void* obj) {
+	struct FileOp* op = FileOp_Make(path, callback, obj);
+	if (!op) { callback(path, NULL, 0, ERR_OUT_OF_MEMORY, obj); return; }
+
+	FileOps_Submit(op);
+}
+
+void Stream_WriteAllAsync(const cc_string* path, const cc_uint8* data, cc_uint32 length, FileOp_Callback callback, void* obj) {
+	struct FileOp* op = FileOp_Make(path, callback, obj);
+	cc_uint8* copy    = NULL;
+	cc_result res;
+
+	if (op) copy = (cc_uint8*)Mem_TryAlloc(max(length, 1), 1);
+	if (!copy) {
+		/* Out of memory, so just write on this thread instead */
+		Mem_Free(op);
+		res = Stream_WriteAllTo(path, data, length);
+		if (callback) callback(path, NULL, 0, res, obj);
+		return;
+	}
+
+	Mem_Copy(copy, data, length);
+	op->data   = copy;
+	op->length = length;
+	op->write  = true;
+	FileOps_Submit(op);
+}
+
+void Stream_CreateFileAsync(const cc_string* path, FileOp_Writer writer, FileOp_Callback callback, void* obj) {
+	struct FileOp* op = FileOp_Make(path, callback, obj);
+	if (!op) { callback(path, NULL, 0, ERR_OUT_OF_MEMORY, obj); return; }
+
+	op->writer = writer;
+	op->write  = true;
+	FileOps_Submit(op);
+}
+
+
 /*########################################################################################################################*
 *-----------------------------------------------------PortionStream-------------------------------------------------------*
 *#########################################################################################################################*/
@@ -373,13 +614,7 @@ void Stream_ReadonlyBuffered(struct Stream* s, struct Stream* source, void* data
 *#########################################################################################################################*/
 static cc_result Stream_Crc32Write(struct Stream* stream, const cc_uint8* data, cc_uint32 count, cc_uint32* modified) {
 	struct Stream* source;
-	cc_uint32 i, crc32 = stream->meta.crc32.crc32;
-
-	/* TODO: Optimise this calculation */
-	for (i = 0; i < count; i++) {
-		crc32 = Utils_Crc32Table[(crc32 ^ data[i]) & 0xFF] ^ (crc32 >> 8);
-	}
-	stream->meta.crc32.crc32 = crc32;
+	stream->meta.crc32.crc32 = Utils_UpdateCRC32(stream->meta.crc32.crc32, data, count);
 
 	source = stream->meta.crc32.source;
 	return source->Write(source, data, count, modified);
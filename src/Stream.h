@@ -10,6 +10,7 @@ CC_BEGIN_HEADER
 */
 
 struct Stream;
+struct PngDecoded;
 /* Represents a stream that can be written to and/or read from. */
 struct Stream {
 	/* Attempts to read some bytes from this stream. */
@@ -37,6 +38,7 @@ struct Stream {
 		struct { struct Stream* source; cc_uint32 left, length; } portion;
 		struct { cc_uint8* cur; cc_uint32 left, length; cc_uint8* base; struct Stream* source; cc_uint32 end; } buffered;
 		struct { struct Stream* source; cc_uint32 crc32; } crc32;
+		struct { cc_uint8* cur; cc_uint32 left, length; cc_uint8* base; struct PngDecoded* result; } decoded;
 	} meta;
 };
 
@@ -52,6 +54,8 @@ void Stream_Init(struct Stream* s);
 /* Wrapper for File_Open() then Stream_FromFile() */
 CC_API  cc_result Stream_OpenFile(      struct Stream* s, const cc_string* path);
 typedef cc_result (*FP_Stream_OpenFile)(struct Stream* s, const cc_string* path);
+/* Wrapper for File_OpenSequential() then Stream_FromFile() */
+cc_result Stream_OpenSequentialFile(struct Stream* s, const cc_string* path);
 /* Wrapper for File_Create() then Stream_FromFile() */
 CC_API  cc_result Stream_CreateFile(      struct Stream* s, const cc_string* path);
 typedef cc_result (*FP_Stream_CreateFile)(struct Stream* s, const cc_string* path);
@@ -59,6 +63,28 @@ typedef cc_result (*FP_Stream_CreateFile)(struct Stream* s, const cc_string* pat
 cc_result Stream_AppendFile(struct Stream* s, const cc_string* path);
 /* Creates or overwrites a file, setting the contents to the given data. */
 cc_result Stream_WriteAllTo(const cc_string* path, const cc_uint8* data, cc_uint32 length);
+/* Reads the entire contents of a file into a newly allocated buffer, which must be freed with Mem_Free. */
+/* NOTE: Returns ERR_OUT_OF_MEMORY if the buffer could not be allocated, in which case the file is left unread */
+cc_result Stream_ReadAllFrom(const cc_string* path, cc_uint8** data, cc_uint32* length);
+
+/* Called on the main thread once a background file operation has completed */
+/* NOTE: data is only valid until the callback returns, and is NULL for writes */
+typedef void (*FileOp_Callback)(const cc_string* path, cc_uint8* data, cc_uint32 length, cc_result res, void* obj);
+/* Reads the entire contents of a file on a background thread. */
+void Stream_ReadAllAsync(const cc_string* path, FileOp_Callback callback, void* obj);
+/* Creates or overwrites a file on a background thread, setting the contents to the given data. */
+/* NOTE: data is copied, so can be freed by the caller straight away. callback can be NULL. */
+void Stream_WriteAllAsync(const cc_string* path, const cc_uint8* data, cc_uint32 length, FileOp_Callback callback, void* obj);
+/* Writes the contents of a file created by Stream_CreateFileAsync */
+typedef cc_result (*FileOp_Writer)(struct Stream* s, void* obj);
+/* Creates or overwrites a file on a background thread, then calls writer on that thread to write its contents. */
+/* NOTE: callback is always called afterwards, even if the file couldn't be created */
+void Stream_CreateFileAsync(const cc_string* path, FileOp_Writer writer, FileOp_Callback callback, void* obj);
+/* Invokes the callbacks of background file operations which have completed. */
+void Stream_PollFileOps(void);
+/* Waits for all background file operations to complete, then invokes their callbacks. */
+void Stream_FinishFileOps(void);
+
 /* Wraps a file, allowing reading from/writing to/seeking in the file. */
 CC_API void Stream_FromFile(struct Stream* s, cc_file file);
 
@@ -812,6 +812,84 @@ cc_bool Convert_ParseBool(const cc_string* str, cc_bool* value) {
 #define StringsBuffer_GetOffset(raw)  ((raw) >> buffer->_lenShift)
 #define StringsBuffer_GetLength(raw)  ((raw)  & buffer->_lenMask)
 #define StringsBuffer_PackOffset(off) ((off) << buffer->_lenShift)
+/* Smaller buffers are just searched linearly */
+#define STRINGSBUFFER_INDEX_MIN_COUNT 32
+
+/* Hash table of 1 + index of each entry, keyed by the part of the entry before separator (unused slots are 0) */
+/* NOTE: slots is NULL until the buffer has at least STRINGSBUFFER_INDEX_MIN_COUNT entries */
+struct StringsBufferIndex { int* slots; int capacity; char separator; };
+
+static void StringsBuffer_FreeIndex(struct StringsBuffer* buffer) {
+	if (!buffer->_index) return;
+
+	Mem_Free(buffer->_index->slots);
+	Mem_Free(buffer->_index);
+	buffer->_index = NULL;
+}
+
+/* FNV-1a hash of the lowercased characters, so keys differing only in case have the same hash */
+static cc_uint32 StringsBuffer_HashKey(const cc_string* key) {
+	cc_uint32 hash = 2166136261UL;
+	char c;
+	int i;
+
+	for (i = 0; i < key->length; i++) {
+		c = key->buffer[i]; Char_MakeLower(c);
+		hash = (hash ^ (cc_uint8)c) * 16777619UL;
+	}
+	return hash;
+}
+
+static void StringsBuffer_GetKey(struct StringsBuffer* buffer, int i, char separator, cc_string* key) {
+	cc_string entry, value;
+	StringsBuffer_UNSAFE_GetRaw(buffer, i, &entry);
+	String_UNSAFE_Separate(&entry, separator, key, &value);
+}
+
+static void StringsBuffer_IndexInsert(struct StringsBuffer* buffer, struct StringsBufferIndex* index, int i) {
+	int mask = index->capacity - 1, slot;
+	cc_string key;
+
+	StringsBuffer_GetKey(buffer, i, index->separator, &key);
+	slot = (int)(StringsBuffer_HashKey(&key) & mask);
+
+	while (index->slots[slot]) slot = (slot + 1) & mask;
+	index->slots[slot] = i + 1;
+}
+
+static void StringsBuffer_BuildIndex(struct StringsBuffer* buffer, struct StringsBufferIndex* index) {
+	int i, capacity = 64;
+	/* Leave room for the buffer to double in size before the index needs rebuilding */
+	while (capacity < buffer->count * 4) capacity *= 2;
+
+	Mem_Free(index->slots);
+	index->slots = (int*)Mem_TryAllocCleared(capacity, sizeof(int));
+	if (!index->slots) return;
+
+	index->capacity = capacity;
+	for (i = 0; i < buffer->count; i++) StringsBuffer_IndexInsert(buffer, index, i);
+}
+
+static void StringsBuffer_IndexRemove(struct StringsBuffer* buffer, struct StringsBufferIndex* index, int i) {
+	int mask = index->capacity - 1;
+	int slot, next, home;
+	cc_string key;
+
+	StringsBuffer_GetKey(buffer, i, index->separator, &key);
+	slot = (int)(StringsBuffer_HashKey(&key) & mask);
+	while (index->slots[slot] != i + 1) slot = (slot + 1) & mask;
+
+	/* Shift back later entries in the same probe sequence, so that lookups don't stop early at the gap */
+	for (next = (slot + 1) & mask; index->slots[next]; next = (next + 1) & mask) {
+		StringsBuffer_GetKey(buffer, index->slots[next] - 1, index->separator, &key);
+		home = (int)(StringsBuffer_HashKey(&key) & mask);
+		if (((next - home) & mask) < ((next - slot) & mask)) continue;
+
+		index->slots[slot] = index->slots[next];
+		slot = next;
+	}
+	index->slots[slot] = 0;
+}
 
 void StringsBuffer_Init(struct StringsBuffer* buffer) {
 	buffer->count       = 0;
@@ -820,6 +898,7 @@ void StringsBuffer_Init(struct StringsBuffer* buffer) {
 	buffer->flagsBuffer    = buffer->_defaultFlags;
 	buffer->_textCapacity  = STRINGSBUFFER_BUFFER_DEF_SIZE;
 	buffer->_flagsCapacity = STRINGSBUFFER_FLAGS_DEF_ELEMS;
+	buffer->_index         = NULL;
 
 	if (buffer->_lenShift) return;
 	StringsBuffer_SetLengthBits(buffer, STRINGSBUFFER_DEF_LEN_SHIFT);
@@ -833,6 +912,7 @@ void StringsBuffer_SetLengthBits(struct StringsBuffer* buffer, int bits) {
 void StringsBuffer_Clear(struct StringsBuffer* buffer) {
 	/* Never initialised to begin with */
 	if (!buffer->_flagsCapacity) return;
+	StringsBuffer_FreeIndex(buffer);
 
 	if (buffer->textBuffer != buffer->_defaultBuffer) {
 		Mem_Free(buffer->textBuffer);
@@ -861,6 +941,7 @@ void StringsBuffer_UNSAFE_GetRaw(struct StringsBuffer* buffer, int i, cc_string*
 }
 
 void StringsBuffer_Add(struct StringsBuffer* buffer, const cc_string* str) {
+	struct StringsBufferIndex* index;
 	int textOffset;
 	/* StringsBuffer hasn't been initialised yet, do it here */
 	if (!buffer->_flagsCapacity) StringsBuffer_Init(buffer);
@@ -885,9 +966,20 @@ void StringsBuffer_Add(struct StringsBuffer* buffer, const cc_string* str) {
 
 	buffer->count++;
 	buffer->totalLength += str->length;
+
+	index = buffer->_index;
+	if (!index || buffer->count < STRINGSBUFFER_INDEX_MIN_COUNT) return;
+
+	/* Keep the index at most half full, so probe sequences stay short */
+	if (!index->slots || buffer->count * 2 > index->capacity) {
+		StringsBuffer_BuildIndex(buffer, index);
+	} else {
+		StringsBuffer_IndexInsert(buffer, index, buffer->count - 1);
+	}
 }
 
 void StringsBuffer_Remove(struct StringsBuffer* buffer, int index) {
+	struct StringsBufferIndex* hashIndex = buffer->_index;
 	cc_uint32 flags, offset, len;
 	cc_uint32 i, offsetAdj;
 	if (index < 0 || index >= buffer->count) Process_Abort("Tried to remove String past StringsBuffer end");
@@ -896,6 +988,9 @@ void StringsBuffer_Remove(struct StringsBuffer* buffer, int index) {
 	offset = StringsBuffer_GetOffset(flags);
 	len    = StringsBuffer_GetLength(flags);
 
+	if (hashIndex && !hashIndex->slots) hashIndex = NULL;
+	if (hashIndex) StringsBuffer_IndexRemove(buffer, hashIndex, index);
+
 	/* Imagine buffer is this: AAXXYYZZ, and want to delete XX */
 	/* We iterate from first char of Y to last char of Z, */
 	/* shifting each character two to the left. */
@@ -915,6 +1010,12 @@ void StringsBuffer_Remove(struct StringsBuffer* buffer, int index) {
 	
 	buffer->count--;
 	buffer->totalLength -= len;
+	if (!hashIndex || index == buffer->count) return;
+
+	/* Entries after the removed one have all moved down by one */
+	for (i = 0; i < hashIndex->capacity; i++) {
+		if (hashIndex->slots[i] > index + 1) hashIndex->slots[i]--;
+	}
 }
 
 static struct StringsBuffer* sort_buffer;
@@ -941,6 +1042,53 @@ static void StringsBuffer_QuickSort(int left, int right) {
 void StringsBuffer_Sort(struct StringsBuffer* buffer) {
 	sort_buffer = buffer;
 	StringsBuffer_QuickSort(0, buffer->count - 1);
+
+	/* Indices of entries have all changed */
+	if (buffer->_index && buffer->_index->slots) StringsBuffer_BuildIndex(buffer, buffer->_index);
+}
+
+void StringsBuffer_IndexKeys(struct StringsBuffer* buffer, char separator) {
+	struct StringsBufferIndex* index;
+	/* StringsBuffer hasn't been initialised yet, do it here */
+	if (!buffer->_flagsCapacity) StringsBuffer_Init(buffer);
+
+	index = buffer->_index;
+	if (index && index->separator == separator) return;
+
+	StringsBuffer_FreeIndex(buffer);
+	index = (struct StringsBufferIndex*)Mem_TryAllocCleared(1, sizeof(struct StringsBufferIndex));
+	if (!index) return;
+
+	index->separator = separator;
+	buffer->_index   = index;
+	if (buffer->count >= STRINGSBUFFER_INDEX_MIN_COUNT) StringsBuffer_BuildIndex(buffer, index);
+}
+
+int StringsBuffer_FindKey(struct StringsBuffer* buffer, const cc_string* key, char separator) {
+	struct StringsBufferIndex* index = buffer->_index;
+	cc_string curKey;
+	int mask, slot, i, found = -1;
+
+	if (!index || !index->slots || index->separator != separator) {
+		for (i = 0; i < buffer->count; i++) {
+			StringsBuffer_GetKey(buffer, i, separator, &curKey);
+			if (String_CaselessEquals(key, &curKey)) return i;
+		}
+		return -1;
+	}
+
+	mask = index->capacity - 1;
+	slot = (int)(StringsBuffer_HashKey(key) & mask);
+
+	for (; (i = index->slots[slot]); slot = (slot + 1) & mask) {
+		i--;
+		/* Prefer the earliest matching entry, same as a linear search would */
+		if (found >= 0 && i > found) continue;
+
+		StringsBuffer_GetKey(buffer, i, separator, &curKey);
+		if (String_CaselessEquals(key, &curKey)) found = i;
+	}
+	return found;
 }
 
 
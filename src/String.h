@@ -243,6 +243,10 @@ struct StringsBuffer {
 	int _lenShift;
 	/* Value to mask a flags value with to retrieve the length */
 	int _lenMask;
+	/* Hash index of entry keys, see StringsBuffer_IndexKeys */
+	/* NOTE: Added after all other fields, so their offsets are unchanged. However, this does change */
+	/*  the size of the struct, so plugins which declare their own StringsBuffer must be recompiled */
+	struct StringsBufferIndex* _index;
 };
 
 /* Resets counts to 0 and other state to default */
@@ -262,6 +266,13 @@ CC_API void StringsBuffer_Add(struct StringsBuffer* buffer, const cc_string* str
 CC_API void StringsBuffer_Remove(struct StringsBuffer* buffer, int index);
 /* Sorts all the entries in the given buffer using String_Compare */
 void StringsBuffer_Sort(struct StringsBuffer* buffer);
+/* Makes StringsBuffer_FindKey with the given separator look up keys through a hash index, */
+/*  which is then kept up to date as entries are added, removed, or sorted */
+/* NOTE: This changes the buffer, so must be protected the same way as StringsBuffer_Add */
+void StringsBuffer_IndexKeys(struct StringsBuffer* buffer, char separator);
+/* Returns index of the first entry whose key (the part before separator) caselessly equals the given key, or -1 if none */
+/* NOTE: Never changes the buffer, and searches linearly unless StringsBuffer_IndexKeys was called with separator */
+int StringsBuffer_FindKey(struct StringsBuffer* buffer, const cc_string* key, char separator);
 
 /* Performs line wrapping on the given string. */
 /* e.g. "some random tex|t* (| is lineLen) becomes "some random" "text" */
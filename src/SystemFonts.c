@@ -430,8 +430,18 @@ struct SysFont {
 #ifdef CC_BUILD_DARWIN
 	char filename[FILENAME_SIZE + 1];
 #endif
+	struct SysFont* next; /* next font in most recently used order */
+	int refCount;         /* number of FontDescs using this font */
+	int size, dpiX, dpiY;
+	cc_string key; char keyBuffer[FILENAME_SIZE]; /* path and face index of the font */
 };
 
+/* FontDescs with the same face, size and DPI share the same font, and so also its cached glyphs. */
+/* Some fonts are kept around after they stop being used, since e.g. menus make the same fonts every time they're opened */
+#define SYSFONT_MAX_UNUSED 8
+static struct SysFont* sysfonts_head;
+static int sysfonts_unused;
+
 static unsigned long SysFont_Read(FT_Stream s, unsigned long offset, unsigned char* buffer, unsigned long count) {
 	struct SysFont* font;
 	cc_result res;
@@ -576,6 +586,7 @@ static void SysFonts_LoadCached(void) {
 	loadedCachedFonts = true;
 
 	EntryList_UNSAFE_Load(&font_list, FONT_CACHE_FILE);
+	StringsBuffer_IndexKeys(&font_list, '=');
 }
 
 void SysFonts_SaveCache(void) {
@@ -732,20 +743,51 @@ void SysFonts_GetNames(struct StringsBuffer* buffer) {
 }
 
 #define TEXT_CEIL(x) (((x) + 63) >> 6)
-cc_result SysFont_Make(struct FontDesc* desc, const cc_string* fontName, int size, int flags) {
+static void SysFont_Unlink(struct SysFont* font) {
+	struct SysFont** link;
+	for (link = &sysfonts_head; *link; link = &(*link)->next) 
+	{
+		if (*link != font) continue;
+		*link = font->next; return;
+	}
+}
+
+static struct SysFont* SysFont_Find(const cc_string* key, int size, int dpiX, int dpiY) {
+	struct SysFont* font;
+	for (font = sysfonts_head; font; font = font->next) 
+	{
+		if (font->size != size || font->dpiX != dpiX || font->dpiY != dpiY) continue;
+		if (String_Equals(&font->key, key)) return font;
+	}
+	return NULL;
+}
+
+/* Frees the least recently used unused font, if too many unused fonts are being kept around */
+static void SysFont_TrimUnused(void) {
 	struct SysFont* font;
-	cc_string value, path, index;
-	int faceIndex, dpiX, dpiY;
+	struct SysFont* oldest = NULL;
+	if (sysfonts_unused <= SYSFONT_MAX_UNUSED) return;
+
+	for (font = sysfonts_head; font; font = font->next) 
+	{
+		if (!font->refCount) oldest = font;
+	}
+
+	SysFont_Unlink(oldest);
+	Drawer2D_ResetTextWidths();
+	FT_Done_Face(oldest->face);
+	Mem_Free(oldest);
+	sysfonts_unused--;
+}
+
+static cc_result SysFont_Load(struct SysFont** result, const cc_string* value, int size, int dpiX, int dpiY) {
+	struct SysFont* font;
+	cc_string path, index;
+	int faceIndex;
 	FT_Open_Args args;
 	FT_Error err;
 
-	desc->size   = size;
-	desc->flags  = flags;
-	desc->handle = NULL;
-
-	value = Font_Lookup(fontName, flags);
-	if (!value.length) return ERR_INVALID_ARGUMENT;
-	String_UNSAFE_Separate(&value, ',', &path, &index);
+	String_UNSAFE_Separate(value, ',', &path, &index);
 	Convert_ParseInt(&index, &faceIndex);
 
 	font = (struct SysFont*)Mem_TryAlloc(1, sizeof(struct SysFont));
@@ -753,14 +795,54 @@ cc_result SysFont_Make(struct FontDesc* desc, const cc_string* fontName, int siz
 
 	InitFreeTypeLibrary();
 	if ((err = SysFont_Init(&path, font, &args))) { Mem_Free(font); return err; }
-	desc->handle = font;
+
+	/* NOTE: FreeType closes the stream (and so the file) itself when this fails */
+	if ((err = FT_New_Face(ft_lib, &args, faceIndex, &font->face))) { Mem_Free(font); return err; }
+	if ((err = FT_Set_Char_Size(font->face, size * 64, 0, dpiX, dpiY))) {
+		FT_Done_Face(font->face); Mem_Free(font); return err;
+	}
+
+	font->refCount = 0;
+	font->size     = size;
+	font->dpiX     = dpiX;
+	font->dpiY     = dpiY;
+	/* Overly long keys are left empty instead, so the font just isn't shared */
+	String_InitArray(font->key, font->keyBuffer);
+	if (value->length <= font->key.capacity) String_Copy(&font->key, value);
+
+	*result = font;
+	return 0;
+}
+
+cc_result SysFont_Make(struct FontDesc* desc, const cc_string* fontName, int size, int flags) {
+	struct SysFont* font;
+	cc_string value;
+	int dpiX, dpiY;
+	cc_result res;
+
+	desc->size   = size;
+	desc->flags  = flags;
+	desc->handle = NULL;
+
+	value = Font_Lookup(fontName, flags);
+	if (!value.length) return ERR_INVALID_ARGUMENT;
 
 	/* TODO: Use 72 instead of 96 dpi for mobile devices */
 	dpiX = (int)(DisplayInfo.ScaleX * 96);
 	dpiY = (int)(DisplayInfo.ScaleY * 96);
 
-	if ((err = FT_New_Face(ft_lib, &args, faceIndex, &font->face)))     return err;
-	if ((err = FT_Set_Char_Size(font->face, size * 64, 0, dpiX, dpiY))) return err;
+	font = SysFont_Find(&value, size, dpiX, dpiY);
+	if (font) {
+		if (!font->refCount) sysfonts_unused--;
+		SysFont_Unlink(font);
+	} else if ((res = SysFont_Load(&font, &value, size, dpiX, dpiY))) {
+		return res;
+	}
+
+	font->refCount++;
+	font->next    = sysfonts_head;
+	sysfonts_head = font;
+	desc->handle  = font;
 
 	/* height of any text when drawn with the given system font */
 	desc->height = TEXT_CEIL(font->face->size->metrics.height);
@@ -802,8 +884,15 @@ void SysFont_MakeDefault(struct FontDesc* desc, int size, int flags) {
 
 void SysFont_Free(struct FontDesc* desc) {
 	struct SysFont* font = (struct SysFont*)desc->handle;
-	FT_Done_Face(font->face);
-	Mem_Free(font);
+	if (--font->refCount) return;
+
+	/* Move to the front, so it's the last of the unused fonts to be freed */
+	SysFont_Unlink(font);
+	font->next    = sysfonts_head;
+	sysfonts_head = font;
+
+	sysfonts_unused++;
+	SysFont_TrimUnused();
 }
 
 int SysFont_TextWidth(struct DrawTextArgs* args) {
@@ -1014,6 +1103,7 @@ void SysFont_MakeDefault(struct FontDesc* desc, int size, int flags) {
 }
 
 void SysFont_Free(struct FontDesc* desc) {
+	Drawer2D_ResetTextWidths();
 	Mem_Free(desc->handle);
 }
 
@@ -1104,6 +1194,7 @@ void SysFont_MakeDefault(struct FontDesc* desc, int size, int flags) {
 }
 
 void SysFont_Free(struct FontDesc* desc) {
+	Drawer2D_ResetTextWidths();
 	interop_SysFontFree(desc->handle);
 }
 
@@ -65,6 +65,8 @@ static void LoadFallbackAtlas(void) {
 struct _Atlas2DData Atlas2D;
 struct _Atlas1DData Atlas1D;
 int TexturePack_ReqID;
+/* Whether mipmaps were enabled when the 1D atlases were created */
+static cc_bool atlas_mipmaps;
 
 TextureRec Atlas1D_TexRec(TextureLoc texLoc, int uCount, int* index) {
 	TextureRec rec;
@@ -80,7 +82,7 @@ TextureRec Atlas1D_TexRec(TextureLoc texLoc, int uCount, int* index) {
 }
 
 
-static void Atlas1D_Load(int index, struct Bitmap* atlas1D) {
+static void Atlas1D_Copy(int index, struct Bitmap* atlas1D) {
 	int tileSize      = Atlas2D.TileSize;
 	int tilesPerAtlas = Atlas1D.TilesPerAtlas;
 	int y, tile = index * tilesPerAtlas;
@@ -94,7 +96,15 @@ static void Atlas1D_Load(int index, struct Bitmap* atlas1D) {
 		Bitmap_UNSAFE_CopyBlock(atlasX, atlasY, 0, y * tileSize,
 							&Atlas2D.Bmp, atlas1D, tileSize);
 	}
-	Gfx_RecreateTexture(&Atlas1D.TexIds[index], atlas1D, TEXTURE_FLAG_MANAGED | TEXTURE_FLAG_DYNAMIC, Gfx.Mipmaps);
+}
+
+static void Atlas1D_Load(int index, struct Bitmap* atlas1D) {
+	Atlas1D_Copy(index, atlas1D);
+	Gfx_RecreateTexture(&Atlas1D.TexIds[index], atlas1D, 
+						TEXTURE_FLAG_MANAGED | TEXTURE_FLAG_DYNAMIC | TEXTURE_FLAG_COMPRESSED, Gfx.Mipmaps);
+
+	if (!Atlas1D.ArrayTexId) return;
+	Gfx_UpdateTextureLayer(Atlas1D.ArrayTexId, index, 0, 0, atlas1D, atlas1D->width, Gfx.Mipmaps);
 }
 
 /* TODO: always do this? */
@@ -122,6 +132,8 @@ static void Atlas_Convert2DTo1D(void) {
 	int atlasesCount  = Atlas1D.Count;
 	Platform_Log2("Terrain atlas: %i bmps, %i per bmp", &atlasesCount, &tilesPerAtlas);
 }
+
+int Atlas1D_AddLayers(int count) { return -1; }
 #else
 void Atlas1D_Bind(int index) {
 	Gfx_BindTexture(Atlas1D.TexIds[index]);
@@ -136,6 +148,12 @@ static void Atlas_Convert2DTo1D(void) {
 
 	Platform_Log2("Loaded terrain atlas: %i bmps, %i per bmp", &atlasesCount, &tilesPerAtlas);
 	Bitmap_Allocate(&atlas1D, tileSize, tilesPerAtlas * tileSize);
+
+	/* Chunks can then be drawn using just one texture, instead of one batch per 1D atlas */
+	if (Gfx.SupportsTextureArrays && tilesPerAtlas > 1) {
+		Atlas1D.ArrayTexId = Gfx_CreateTextureArray(tileSize, tilesPerAtlas * tileSize, 
+													atlasesCount, TEXTURE_FLAG_COMPRESSED, Gfx.Mipmaps);
+	}
 	
 	for (i = 0; i < atlasesCount; i++) 
 	{
@@ -143,9 +161,39 @@ static void Atlas_Convert2DTo1D(void) {
 	}
 	Mem_Free(atlas1D.scan0);
 }
+
+int Atlas1D_AddLayers(int count) {
+	int tileSize      = Atlas2D.TileSize;
+	int tilesPerAtlas = Atlas1D.TilesPerAtlas;
+	struct Bitmap atlas1D;
+	int i;
+	if (!Atlas1D.ArrayTexId) return -1;
+
+	Gfx_DeleteTexture(&Atlas1D.ArrayTexId);
+	Atlas1D.ArrayTexId = Gfx_CreateTextureArray(tileSize, tilesPerAtlas * tileSize, 
+												Atlas1D.Count + count, TEXTURE_FLAG_COMPRESSED, Gfx.Mipmaps);
+	Bitmap_Allocate(&atlas1D, tileSize, tilesPerAtlas * tileSize);
+
+	for (i = 0; i < Atlas1D.Count; i++) 
+	{
+		Atlas1D_Copy(i, &atlas1D);
+		Gfx_UpdateTextureLayer(Atlas1D.ArrayTexId, i, 0, 0, &atlas1D, atlas1D.width, Gfx.Mipmaps);
+	}
+	Mem_Free(atlas1D.scan0);
+	return Atlas1D.Count;
+}
 #endif
 
-static void Atlas_Update1D(void) {
+void Atlas1D_ResetLayerV(void) {
+	int i;
+	for (i = 0; i < ATLAS1D_MAX_ATLASES; i++) 
+	{
+		Atlas1D.LayerV[i] = Atlas1D_RowId(i) * Atlas1D.InvTileSize + Atlas1D_Index(i) * 2;
+	}
+}
+
+/* Calculates how many tiles can be put in each 1D atlas, for the current 2D atlas */
+static int Atlas_CalcTilesPerAtlas(void) {
 	int maxAtlasHeight, maxTilesPerAtlas, maxTiles;
 	int maxTexHeight = Gfx.MaxTexHeight;
 
@@ -158,14 +206,24 @@ static void Atlas_Update1D(void) {
 
 	maxAtlasHeight   = min(4096, maxTexHeight);
 	maxTilesPerAtlas = maxAtlasHeight / Atlas2D.TileSize;
+
+	/* Faces can only be greedily merged in 2D when each 1D atlas has one tile, */
+	/*  as otherwise the V texture coordinate would bleed into the adjacent tile */
+	if (Options_GetBool(OPT_GREEDY_MESHING, false)) maxTilesPerAtlas = 1;
 	maxTiles         = Atlas2D.RowsCount * ATLAS2D_TILES_PER_ROW;
+	return min(maxTilesPerAtlas, maxTiles);
+}
 
-	Atlas1D.TilesPerAtlas = min(maxTilesPerAtlas, maxTiles);
+static void Atlas_Update1D(void) {
+	int maxTiles = Atlas2D.RowsCount * ATLAS2D_TILES_PER_ROW;
+
+	Atlas1D.TilesPerAtlas = Atlas_CalcTilesPerAtlas();
 	Atlas1D.Count = Math_CeilDiv(maxTiles, Atlas1D.TilesPerAtlas);
 
 	Atlas1D.InvTileSize = 1.0f / Atlas1D.TilesPerAtlas;
 	Atlas1D.Mask  = Atlas1D.TilesPerAtlas - 1;
 	Atlas1D.Shift = Math_ilog2(Atlas1D.TilesPerAtlas);
+	Atlas1D_ResetLayerV();
 }
 
 /* Loads the given atlas and converts it into an array of 1D atlases. */
@@ -177,8 +235,64 @@ static void Atlas_Update(struct Bitmap* bmp) {
 
 	Atlas_Update1D();
 	Atlas_Convert2DTo1D();
+	atlas_mipmaps = Gfx.Mipmaps;
 }
 
+#ifndef CC_BUILD_LOWMEM
+static cc_bool Atlas_TileEquals(struct Bitmap* a, struct Bitmap* b, int x, int y, int size) {
+	int i;
+	for (i = 0; i < size; i++) 
+	{
+		if (!Mem_Equal(Bitmap_GetRow(a, y + i) + x, Bitmap_GetRow(b, y + i) + x, size * BITMAPCOLOR_SIZE)) return false;
+	}
+	return true;
+}
+
+/* Re-uploads only the tiles that differ from the current atlas, when the new atlas has the same layout */
+/*  (e.g. reloading a texture pack where only a few tiles in terrain.png were changed) */
+/* Returns false when the 1D atlases need to be completely recreated instead */
+static cc_bool Atlas_TryUpdateTiles(struct Bitmap* bmp) {
+	int tileSize = Atlas2D.TileSize;
+	int i, x, y, tiles, index, changed = 0;
+	struct Bitmap tile;
+
+	if (!Atlas2D.Bmp.scan0 || Atlas2D.Bmp.scan0 == fallback_terrain || bmp->scan0 == fallback_terrain) return false;
+	if (bmp->width != Atlas2D.Bmp.width || bmp->height != Atlas2D.Bmp.height) return false;
+	if (!Atlas1D.TexIds[0] || atlas_mipmaps != Gfx.Mipmaps) return false;
+	/* Compressed textures can only be partially updated in blocks of 4x4 pixels */
+	if (tileSize % 4 || Atlas_CalcTilesPerAtlas() != Atlas1D.TilesPerAtlas) return false;
+
+	tiles = Atlas2D.RowsCount * ATLAS2D_TILES_PER_ROW;
+	tile.width  = tileSize;
+	tile.height = tileSize;
+
+	for (i = 0; i < tiles; i++) 
+	{
+		x = Atlas2D_TileX(i) * tileSize;
+		y = Atlas2D_TileY(i) * tileSize;
+		if (Atlas_TileEquals(bmp, &Atlas2D.Bmp, x, y, tileSize)) continue;
+
+		tile.scan0 = Bitmap_GetRow(bmp, y) + x;
+		index      = Atlas1D_Index(i);
+		y          = Atlas1D_RowId(i) * tileSize;
+
+		Gfx_UpdateTexture(Atlas1D.TexIds[index], 0, y, &tile, bmp->width, Gfx.Mipmaps);
+		if (Atlas1D.ArrayTexId) {
+			Gfx_UpdateTextureLayer(Atlas1D.ArrayTexId, index, 0, y, &tile, bmp->width, Gfx.Mipmaps);
+		}
+		changed++;
+	}
+
+	Mem_Free(Atlas2D.Bmp.scan0);
+	Atlas2D.Bmp = *bmp;
+
+	if (changed) Event_RaiseVoid(&TextureEvents.AtlasChanged);
+	return true;
+}
+#else
+static cc_bool Atlas_TryUpdateTiles(struct Bitmap* bmp) { return false; }
+#endif
+
 GfxResourceID Atlas2D_LoadTile(TextureLoc texLoc) {
 	int size = Atlas2D.TileSize;
 	struct Bitmap tile;
@@ -205,6 +319,7 @@ static void Atlas1D_Free(void) {
 	for (i = 0; i < Atlas1D.Count; i++) {
 		Gfx_DeleteTexture(&Atlas1D.TexIds[i]);
 	}
+	Gfx_DeleteTexture(&Atlas1D.ArrayTexId);
 }
 
 cc_bool Atlas_TryChange(struct Bitmap* atlas) {
@@ -245,6 +360,7 @@ cc_bool Atlas_TryChange(struct Bitmap* atlas) {
 	}
 
 	if (Gfx.LostContext) return false;
+	if (Atlas_TryUpdateTiles(atlas)) return true;
 	Atlas1D_Free();
 	Atlas2D_Free();
 
@@ -265,6 +381,8 @@ static struct StringsBuffer acceptedList, deniedList;
 static void TextureUrls_Init(void) {
 	EntryList_UNSAFE_Load(&acceptedList, ACCEPTED_TXT);
 	EntryList_UNSAFE_Load(&deniedList,   DENIED_TXT);
+	StringsBuffer_IndexKeys(&acceptedList, ' ');
+	StringsBuffer_IndexKeys(&deniedList,   ' ');
 }
 
 cc_bool TextureUrls_HasAccepted(const cc_string* url) { return EntryList_Find(&acceptedList, url, ' ') >= 0; }
@@ -310,6 +428,8 @@ static struct StringsBuffer etagCache, lastModCache;
 static void TextureCache_Init(void) {
 	EntryList_UNSAFE_Load(&etagCache,    ETAGS_TXT);
 	EntryList_UNSAFE_Load(&lastModCache, LASTMOD_TXT);
+	StringsBuffer_IndexKeys(&etagCache,    ' ');
+	StringsBuffer_IndexKeys(&lastModCache, ' ');
 }
 
 CC_INLINE static void HashUrl(cc_string* key, const cc_string* url) {
@@ -380,11 +500,11 @@ static cc_bool OpenCachedData(const cc_string* url, struct Stream* stream) {
 	
 
 	MakeCachePath(&mainPath, &altPath, url);
-	res = Stream_OpenFile(stream, &mainPath);
+	res = Stream_OpenSequentialFile(stream, &mainPath);
 
 	/* try fallback cache if can't find in main cache */
 	if (res == ReturnCode_FileNotFound && altPath.length)
-		res = Stream_OpenFile(stream, &altPath);
+		res = Stream_OpenSequentialFile(stream, &altPath);
 
 	if (res == ReturnCode_FileNotFound) return false;
 	if (res) { Logger_SysWarn2(res, "opening cache for", url); return false; }
@@ -427,11 +547,14 @@ CC_NOINLINE static void SetCachedTag(const cc_string* url, struct StringsBuffer*
 	EntryList_Save(list, file);
 }
 
+static void OnCacheWritten(const cc_string* path, cc_uint8* data, cc_uint32 length, cc_result res, void* obj) {
+	if (res) { Logger_SysWarn2(res, "caching", path); }
+}
+
 /* Updates cached data, ETag, and Last-Modified for the given URL */
 static void UpdateCache(struct HttpRequest* req) {
 	cc_string url, altPath, value;
 	cc_string path; char pathBuffer[FILENAME_SIZE];
-	cc_result res;
 	url = String_FromRawArray(req->url);
 
 	value = String_FromRawArray(req->etag);
@@ -443,8 +566,159 @@ static void UpdateCache(struct HttpRequest* req) {
 	altPath = String_Empty;
 	MakeCachePath(&path, &altPath, &url);
 
-	res = Stream_WriteAllTo(&path, req->data, req->size);
-	if (res) { Logger_SysWarn2(res, "caching", &url); }
+	/* Texture packs can be several megabytes, so avoid stalling the main thread on writing them */
+	Stream_WriteAllAsync(&path, req->data, req->size, OnCacheWritten, NULL);
+}
+
+
+/*########################################################################################################################*
+*------------------------------------------------------DecodedCache-------------------------------------------------------*
+*#########################################################################################################################*/
+/* Caches the decoded terrain atlas of texture packs, so rejoining doesn't need to decode terrain.png again */
+/* Format: "CCTA", U32 width, U32 height, U8 tag length, tag, then raw bitmap pixels */
+#ifndef CC_BUILD_LOWMEM
+#define DECODED_HEADER_SIZE 13
+#define DECODED_MAX_SIZE 8192
+
+/* Returns the ETag (or Last-Modified if no ETag) that identifies the cached data for the given url */
+static cc_string GetDecodedTag(const cc_string* url) {
+	cc_string tag = GetCachedETag(url);
+	if (!tag.length) tag = GetCachedLastModified(url);
+	
+	/* Longer tags could be truncated, so the cached atlas may be stale */
+	if (tag.length > 255) tag.length = 0;
+	return tag;
+}
+
+static void MakeDecodedPath(cc_string* path, const cc_string* url) {
+	cc_string altPath = String_Empty;
+	MakeCachePath(path, &altPath, url);
+	String_AppendConst(path, ".atlas");
+}
+
+static cc_bool DecodedCache_Load(const cc_string* url, struct Bitmap* bmp) {
+	cc_string path; char pathBuffer[FILENAME_SIZE];
+	cc_uint8 header[DECODED_HEADER_SIZE];
+	char tagBuffer[256];
+	cc_string tag, cachedTag;
+	struct Stream stream;
+	cc_uint32 size;
+	cc_result res;
+
+	tag = GetDecodedTag(url);
+	if (!tag.length) return false;
+
+	String_InitArray(path, pathBuffer);
+	MakeDecodedPath(&path, url);
+	if (Stream_OpenFile(&stream, &path)) return false;
+
+	bmp->scan0 = NULL;
+	res = Stream_Read(&stream, header, DECODED_HEADER_SIZE);
+	if (res || !Mem_Equal(header, "CCTA", 4)) goto failed;
+
+	bmp->width  = (int)Stream_GetU32_LE(&header[4]);
+	bmp->height = (int)Stream_GetU32_LE(&header[8]);
+	if (bmp->width  <= 0 || bmp->width  > DECODED_MAX_SIZE) goto failed;
+	if (bmp->height <= 0 || bmp->height > DECODED_MAX_SIZE) goto failed;
+
+	/* Check the atlas was decoded from the same texture pack that is cached now */
+	cachedTag = String_Init(tagBuffer, header[12], header[12]);
+	if (Stream_Read(&stream, (cc_uint8*)tagBuffer, cachedTag.length)) goto failed;
+	if (!String_Equals(&tag, &cachedTag)) goto failed;
+
+	size = Bitmap_DataSize(bmp->width, bmp->height);
+	bmp->scan0 = (BitmapCol*)Mem_TryAlloc(1, size);
+	if (!bmp->scan0) goto failed;
+
+	res = Stream_Read(&stream, (cc_uint8*)bmp->scan0, size);
+	if (res) goto failed;
+
+	(void)stream.Close(&stream);
+	return true;
+
+failed:
+	Mem_Free(bmp->scan0);
+	bmp->scan0 = NULL;
+	(void)stream.Close(&stream);
+	return false;
+}
+
+static void DecodedCache_Save(const cc_string* url, struct Bitmap* bmp) {
+	cc_string path; char pathBuffer[FILENAME_SIZE];
+	cc_uint8 header[DECODED_HEADER_SIZE];
+	struct Stream stream;
+	cc_string tag;
+	cc_result res;
+
+	if (Platform_ReadonlyFilesystem) return;
+	tag = GetDecodedTag(url);
+	if (!tag.length) return;
+
+	String_InitArray(path, pathBuffer);
+	MakeDecodedPath(&path, url);
+	res = Stream_CreateFile(&stream, &path);
+	if (res) { Logger_SysWarn2(res, "creating decoded cache for", url); return; }
+
+	Mem_Copy(header, "CCTA", 4);
+	Stream_SetU32_LE(&header[4], bmp->width);
+	Stream_SetU32_LE(&header[8], bmp->height);
+	header[12] = (cc_uint8)tag.length;
+
+	if (!(res = Stream_Write(&stream, header, DECODED_HEADER_SIZE))
+		&& !(res = Stream_Write(&stream, (const cc_uint8*)tag.buffer, tag.length))) {
+		res = Stream_Write(&stream, (const cc_uint8*)bmp->scan0, Bitmap_DataSize(bmp->width, bmp->height));
+	}
+	if (res) Logger_SysWarn2(res, "writing decoded cache for", url);
+
+	res = stream.Close(&stream);
+	if (res) Logger_SysWarn2(res, "closing decoded cache for", url);
+}
+#else
+static cc_bool DecodedCache_Load(const cc_string* url, struct Bitmap* bmp) { return false; }
+static void DecodedCache_Save(const cc_string* url, struct Bitmap* bmp) { }
+#endif
+
+
+/*########################################################################################################################*
+*-------------------------------------------------Extracted entry hashes--------------------------------------------------*
+*#########################################################################################################################*/
+/* CRC32 and size of the .zip entry that was last extracted for each filename, so that entries which */
+/*  haven't changed can be skipped when extracting again (e.g. reloading a texture pack while editing it, */
+/*  or a server changing to another texture pack that only differs in a few textures) */
+#define TEXPACK_MAX_HASHES 512
+static struct StringsBuffer hash_names;
+static struct EntryHash { cc_uint32 crc32, size; cc_bool known; } hash_values[TEXPACK_MAX_HASHES];
+
+/* Returns whether the given entry is the same as the entry last extracted with the same filename, */
+/*  otherwise remembers the given entry as the entry last extracted with that filename */
+static cc_bool EntryHashes_Unchanged(const cc_string* name, struct ZipEntry* source) {
+	struct EntryHash* hash;
+	int i = StringsBuffer_FindKey(&hash_names, name, '\0');
+
+	if (i == -1) {
+		if (hash_names.count == TEXPACK_MAX_HASHES || name->length > STRINGSBUFFER_DEF_LEN_MASK) return false;
+		i = hash_names.count;
+		StringsBuffer_IndexKeys(&hash_names, '\0');
+		StringsBuffer_Add(&hash_names, name);
+		hash_values[i].known = false;
+	}
+	hash = &hash_values[i];
+
+	if (hash->known && hash->crc32 == source->Crc32 && hash->size == source->UncompressedSize) return true;
+	hash->known = true;
+	hash->crc32 = source->Crc32;
+	hash->size  = source->UncompressedSize;
+	return false;
+}
+
+void TextureEntry_Forget(const char* filename) {
+	cc_string name = String_FromReadonly(filename);
+	int i = StringsBuffer_FindKey(&hash_names, &name, '\0');
+	if (i >= 0) hash_values[i].known = false;
+}
+
+static void EntryHashes_Clear(void) {
+	StringsBuffer_Clear(&hash_names);
 }
 
 
@@ -484,7 +758,22 @@ cc_result TexturePack_ExtractDefault(DefaultZipCallback callback) {
 }
 
 
-static cc_bool SelectZipEntry(const cc_string* path) { return true; }
+/* URL of the texture pack currently being extracted, NULL if extracting a local texture pack */
+static const cc_string* extractingUrl;
+/* Whether terrain.png was already loaded from the decoded cache */
+static cc_bool skipTerrain;
+/* Filenames of the entries in the user's selected texture pack, which replace the same entries from */
+/*  the default texture pack anyway, so don't need to be extracted from the default texture pack */
+static struct StringsBuffer userEntries;
+static cc_bool extractingDefault;
+
+static cc_bool SelectZipEntry(const cc_string* path) {
+	cc_string name = *path;
+	Utils_UNSAFE_GetFilename(&name);
+
+	if (extractingDefault && StringsBuffer_FindKey(&userEntries, &name, '\0') >= 0) return false;
+	return !skipTerrain || !String_CaselessEqualsConst(&name, "terrain.png");
+}
 static cc_result ProcessZipEntry(const cc_string* path, struct Stream* stream, struct ZipEntry* source) {
 	cc_string name = *path;
 	Utils_UNSAFE_GetFilename(&name);
@@ -492,18 +781,217 @@ static cc_result ProcessZipEntry(const cc_string* path, struct Stream* stream, s
 	return 0;
 }
 
+#define TEXPACK_MAX_ZIP_ENTRIES 512
+static struct TextureEntry* entries_head;
+static struct TextureEntry* entries_tail;
+
+#ifdef CC_BUILD_BUILDERTHREADS
+/* Zip entries for registered textures are read into memory, then any .png files among them are */
+/*  decoded on multiple threads. Only changing the textures needs to happen on the main thread. */
+#define ZIPDECODE_MAX_THREADS 4
+/* Only used to guess how much memory to initially allocate for an entry */
+#define ZIPDECODE_MAX_GUESS (16 * 1024 * 1024)
+struct ZipDecodeEntry { cc_uint8* data; cc_uint32 size; cc_bool png; struct PngDecoded decoded; };
+
+static struct ZipDecodeState {
+	struct ZipDecodeEntry entries[TEXPACK_MAX_ZIP_ENTRIES];
+	struct StringsBuffer names;
+	int count, next;
+	void* mutex;
+} zipDecode;
+
+static void ZipDecode_WorkerLoop(void) {
+	struct ZipDecodeEntry* e;
+	struct Stream mem;
+	int i;
+
+	for (;;) {
+		Mutex_Lock(zipDecode.mutex);
+		i = zipDecode.next++;
+		Mutex_Unlock(zipDecode.mutex);
+
+		if (i >= zipDecode.count) return;
+		e = &zipDecode.entries[i];
+		if (!e->png) continue;
+
+		Stream_ReadonlyMemory(&mem, e->data, e->size);
+		e->decoded.res = Png_Decode(&e->decoded.bmp, &mem);
+	}
+}
+
+/* Decodes all queued .png entries, then raises TextureEvents.FileChanged for all queued entries in order */
+static void ZipDecode_Flush(void) {
+	void* threads[ZIPDECODE_MAX_THREADS - 1];
+	struct ZipDecodeEntry* e;
+	struct Stream mem;
+	cc_string name;
+	int i, pngs = 0, numThreads;
+
+	for (i = 0; i < zipDecode.count; i++) {
+		if (zipDecode.entries[i].png) pngs++;
+	}
+	numThreads = min(pngs, ZIPDECODE_MAX_THREADS) - 1;
+	zipDecode.next = 0;
+
+	/* This thread decodes entries too, instead of just waiting for the others */
+	for (i = 0; i < numThreads; i++) {
+		Thread_Run(&threads[i], ZipDecode_WorkerLoop, 256 * 1024, "Texture decoder");
+	}
+	ZipDecode_WorkerLoop();
+	for (i = 0; i < numThreads; i++) { Thread_Join(threads[i]); }
+
+	for (i = 0; i < zipDecode.count; i++) {
+		e    = &zipDecode.entries[i];
+		name = StringsBuffer_UNSAFE_Get(&zipDecode.names, i);
+
+		if (e->png) {
+			Png_MakeDecodedStream(&mem, e->data, e->size, &e->decoded);
+		} else {
+			Stream_ReadonlyMemory(&mem, e->data, e->size);
+		}
+		Event_RaiseEntry(&TextureEvents.FileChanged, &mem, &name);
+
+		/* Decoded bitmap is only freed here if no texture took ownership of it */
+		Mem_Free(e->decoded.bmp.scan0);
+		Mem_Free(e->data);
+	}
+
+	zipDecode.count = 0;
+	StringsBuffer_Clear(&zipDecode.names);
+}
+
+static cc_bool ZipDecode_IsRegistered(const cc_string* name) {
+	struct TextureEntry* e;
+
+	for (e = entries_head; e; e = e->next) {
+		if (String_CaselessEqualsConst(name, e->filename)) return true;
+	}
+	return false;
+}
+
+static cc_result ZipDecode_ReadAll(struct ZipDecodeEntry* e, struct Stream* stream, cc_uint32 capacity) {
+	cc_uint8* data;
+	cc_uint32 read;
+	cc_result res;
+
+	for (;;) {
+		if (e->size == capacity) {
+			data = (cc_uint8*)Mem_TryRealloc(e->data, capacity * 2, 1);
+			if (!data) return ERR_OUT_OF_MEMORY;
+
+			e->data   = data;
+			capacity *= 2;
+		}
+
+		res = stream->Read(stream, e->data + e->size, capacity - e->size, &read);
+		if (res)   return res;
+		if (!read) return 0;
+		e->size += read;
+	}
+}
+
+static cc_result QueueZipEntry(const cc_string* path, struct Stream* stream, struct ZipEntry* source) {
+	struct ZipDecodeEntry* e;
+	cc_uint32 capacity;
+	cc_string name = *path;
+	cc_result res;
+	Utils_UNSAFE_GetFilename(&name);
+	if (EntryHashes_Unchanged(&name, source)) return 0;
+
+	/* Entries not used by any registered texture are only handled by plugins, so just pass them along */
+	if (!ZipDecode_IsRegistered(&name)) return ProcessZipEntry(path, stream, source);
+	if (zipDecode.count == TEXPACK_MAX_ZIP_ENTRIES) ZipDecode_Flush();
+
+	e = &zipDecode.entries[zipDecode.count];
+	/* + 1 so that the end of the data is found without having to resize */
+	capacity = min(source->UncompressedSize, ZIPDECODE_MAX_GUESS) + 1;
+	e->size  = 0;
+	e->data  = (cc_uint8*)Mem_TryAlloc(capacity, 1);
+
+	/* Fallback to changing the texture directly from the zip entry */
+	if (!e->data) {
+		ZipDecode_Flush();
+		return ProcessZipEntry(path, stream, source);
+	}
+
+	if ((res = ZipDecode_ReadAll(e, stream, capacity))) {
+		Mem_Free(e->data);
+		return res;
+	}
+
+	e->png = Png_Detect(e->data, e->size);
+	e->decoded.bmp.scan0 = NULL;
+	e->decoded.res       = 0;
+	e->decoded.taken     = false;
+
+	StringsBuffer_Add(&zipDecode.names, &name);
+	zipDecode.count++;
+	return 0;
+}
+
+static cc_result ExtractZip(struct Stream* stream) {
+	struct ZipEntry entries[TEXPACK_MAX_ZIP_ENTRIES];
+	cc_result res;
+	if (!zipDecode.mutex) zipDecode.mutex = Mutex_Create("Texture decoder");
+
+	res = Zip_Extract(stream, SelectZipEntry, QueueZipEntry,
+						entries, Array_Elems(entries));
+	/* Entries read before any error are still used, same as when extracting without threads */
+	ZipDecode_Flush();
+	return res;
+}
+#else
+static cc_result ProcessChangedEntry(const cc_string* path, struct Stream* stream, struct ZipEntry* source) {
+	cc_string name = *path;
+	Utils_UNSAFE_GetFilename(&name);
+
+	if (EntryHashes_Unchanged(&name, source)) return 0;
+	return ProcessZipEntry(path, stream, source);
+}
+
+static cc_result ExtractZip(struct Stream* stream) {
+	struct ZipEntry entries[TEXPACK_MAX_ZIP_ENTRIES];
+	return Zip_Extract(stream, SelectZipEntry, ProcessChangedEntry,
+						entries, Array_Elems(entries));
+}
+#endif
+
+/* Changes the terrain atlas, remembering it in the decoded cache if necessary */
+static cc_bool ChangeAtlas(struct Bitmap* bmp) {
+	if (!Atlas_TryChange(bmp)) return false;
+
+	if (extractingUrl) DecodedCache_Save(extractingUrl, bmp);
+	return true;
+}
+
 static cc_result ExtractPng(struct Stream* stream) {
 	struct Bitmap bmp;
 	cc_result res = Png_Decode(&bmp, stream);
-	if (!res && Atlas_TryChange(&bmp)) return 0;
+	/* terrain.png no longer necessarily matches the .zip entry last extracted with that name */
+	if (!res && ChangeAtlas(&bmp)) { TextureEntry_Forget("terrain.png"); return 0; }
 
 	Mem_Free(bmp.scan0);
 	return res;
 }
 
+/* Tries to use the previously decoded terrain atlas of the given texture pack */
+static cc_bool ExtractDecodedAtlas(struct Stream* stream, const cc_string* url) {
+	cc_uint8 sig[PNG_SIG_SIZE];
+	struct Bitmap bmp;
+
+	if (!DecodedCache_Load(url, &bmp)) return false;
+	if (!Atlas_TryChange(&bmp)) { Mem_Free(bmp.scan0); return false; }
+	TextureEntry_Forget("terrain.png");
+	skipTerrain = true;
+
+	/* Texture pack might be just a terrain.png, in which case there's nothing else to load */
+	if (Stream_Read(stream, sig, PNG_SIG_SIZE)) return false;
+	if (stream->Seek(stream, 0)) return false;
+	return Png_Detect(sig, PNG_SIG_SIZE);
+}
+
 static cc_bool needReload;
-static cc_result ExtractFrom(struct Stream* stream, const cc_string* path) {
-	struct ZipEntry entries[512];
+static cc_result ExtractFrom(struct Stream* stream, const cc_string* path, const cc_string* url) {
 	cc_result res;
 
 	Event_RaiseVoid(&TextureEvents.PackChanged);
@@ -512,16 +1000,23 @@ static cc_result ExtractFrom(struct Stream* stream, const cc_string* path) {
 	if (Gfx.LostContext) { needReload = true; return 0; }
 	needReload = false;
 
-	res = ExtractPng(stream);
+	if (url && ExtractDecodedAtlas(stream, url)) {
+		skipTerrain = false;
+		return 0;
+	}
+	extractingUrl = url;
+
+	res = skipTerrain ? PNG_ERR_INVALID_SIG : ExtractPng(stream);
 	if (res == PNG_ERR_INVALID_SIG) {
 		/* file isn't a .png image, probably a .zip archive then */
-		res = Zip_Extract(stream, SelectZipEntry, ProcessZipEntry,
-							entries, Array_Elems(entries));
-
+		res = ExtractZip(stream);
 		if (res) Logger_SysWarn2(res, "extracting", path);
 	} else if (res) {
 		Logger_SysWarn2(res, "decoding", path);
 	}
+
+	extractingUrl = NULL;
+	skipTerrain   = false;
 	return res;
 }
 
@@ -532,35 +1027,70 @@ static cc_result ExtractFromFile(const cc_string* path) {
 	struct Stream stream;
 	Stream_ReadonlyMemory(&stream, ccTextures, ccTextures_length);
 
-	return ExtractFrom(&stream, path);
+	return ExtractFrom(&stream, path, NULL);
 }
 #else
 static cc_result ExtractFromFile(const cc_string* path) {
 	struct Stream stream;
 	cc_result res;
 
-	res = Stream_OpenFile(&stream, path);
+	res = Stream_OpenSequentialFile(&stream, path);
 	if (res) { Logger_SysWarn2(res, "opening", path); return res; }
 
-	res = ExtractFrom(&stream, path);
+	res = ExtractFrom(&stream, path, NULL);
 	/* No point logging error for closing readonly file */
 	(void)stream.Close(&stream);
 	return res;
 }
 #endif
 
+/* Remembers the filenames of the entries in the given texture pack (see userEntries) */
+static void ScanUserEntries(const cc_string* path) {
+	static const cc_string terrain = String_FromConst("terrain.png");
+	cc_uint8 sig[PNG_SIG_SIZE];
+	struct ZipIndex index;
+	struct Stream stream;
+	cc_string name;
+	int i;
+
+	if (Stream_OpenFile(&stream, path)) return;
+	StringsBuffer_IndexKeys(&userEntries, '\0');
+
+	if (!Stream_Read(&stream, sig, PNG_SIG_SIZE) && Png_Detect(sig, PNG_SIG_SIZE)) {
+		StringsBuffer_Add(&userEntries, &terrain);
+	} else {
+		if (!ZipIndex_Open(&index, &stream)) {
+			for (i = 0; i < index.count; i++) 
+			{
+				name = StringsBuffer_UNSAFE_Get(&index.paths, i);
+				Utils_UNSAFE_GetFilename(&name);
+				if (name.length <= STRINGSBUFFER_DEF_LEN_MASK) StringsBuffer_Add(&userEntries, &name);
+			}
+		}
+		ZipIndex_Free(&index);
+	}
+	/* No point logging error for closing readonly file */
+	(void)stream.Close(&stream);
+}
+
 static cc_result ExtractUserTextures(void) {
 	cc_string path;
 	cc_result res;
 
+	path = TexturePack_Path;
+	if (String_CaselessEqualsConst(&path, "texpacks/default.zip")) path.length = 0;
+	if (Game_ClassicMode) path.length = 0;
+	if (path.length) ScanUserEntries(&path);
+
 	/* TODO: Log error for multiple default texture pack extract failure */
+	extractingDefault = true;
 	res = TexturePack_ExtractDefault(ExtractFromFile);
+	extractingDefault = false;
+	StringsBuffer_Clear(&userEntries);
+
 	/* Game shows a warning dialog if default textures are missing */
 	TexturePack_DefaultMissing = res == ReturnCode_FileNotFound;
-
-	path = TexturePack_Path;
-	if (String_CaselessEqualsConst(&path, "texpacks/default.zip")) path.length = 0;
-	if (Game_ClassicMode || path.length == 0) return res;
+	if (path.length == 0) return res;
 
 	/* override default textures with user's selected texture pack */
 	return ExtractFromFile(&path);
@@ -579,7 +1109,7 @@ cc_result TexturePack_ExtractCurrent(cc_bool forceReload) {
 	}
 
 	if (url.length && OpenCachedData(&url, &stream)) {
-		res = ExtractFrom(&stream, &url);
+		res = ExtractFrom(&stream, &url, &url);
 		usingDefault = false;
 
 		/* No point logging error for closing readonly file */
@@ -602,7 +1132,7 @@ static void ApplyDownloaded(struct HttpRequest* item) {
 	if (!String_Equals(&TexturePack_Url, &url)) return;
 
 	Stream_ReadonlyMemory(&mem, item->data, item->size);
-	ExtractFrom(&mem, &url);
+	ExtractFrom(&mem, &url, &url);
 	usingDefault = false;
 }
 
@@ -652,9 +1182,6 @@ void TexturePack_Extract(const cc_string* url) {
 	TexturePack_ExtractCurrent(false);
 }
 
-static struct TextureEntry* entries_head;
-static struct TextureEntry* entries_tail;
-
 void TextureEntry_Register(struct TextureEntry* entry) {
 	LinkedList_Append(entry, entries_head, entries_tail);
 }
@@ -670,7 +1197,7 @@ static void TerrainPngProcess(struct Stream* stream, const cc_string* name) {
 	if (res) {
 		Logger_SysWarn2(res, "decoding", name);
 		Mem_Free(bmp.scan0);
-	} else if (!Atlas_TryChange(&bmp)) {
+	} else if (!ChangeAtlas(&bmp)) {
 		Mem_Free(bmp.scan0);
 	}
 }
@@ -689,7 +1216,10 @@ static void OnFileChanged(void* obj, struct Stream* stream, const cc_string* nam
 }
 
 static void OnContextLost(void* obj) {
-	if (!Gfx.ManagedTextures) Atlas1D_Free();
+	if (Gfx.ManagedTextures) return;
+	Atlas1D_Free();
+	/* All textures get recreated when the context is restored, so every entry must be extracted again */
+	EntryHashes_Clear();
 }
 
 static void OnContextRecreated(void* obj) {
@@ -730,6 +1260,7 @@ static void OnReset(void) {
 static void OnFree(void) {
 	OnContextLost(NULL);
 	Atlas2D_Free();
+	EntryHashes_Clear();
 	TexturePack_Url.length = 0;
 	entries_head = NULL;
 }
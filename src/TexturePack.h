@@ -53,6 +53,12 @@ CC_VAR extern struct _Atlas1DData {
 	float InvTileSize;
 	/* Textures for each 1D atlas. Only Atlas1D_Count of these are valid. */
 	GfxResourceID TexIds[ATLAS1D_MAX_ATLASES];
+	/* Texture array with one layer for each 1D atlas, used for drawing chunks. */
+	/* NOTE: 0 when Gfx.SupportsTextureArrays is false, or in CC_BUILD_LOWMEM builds */
+	GfxResourceID ArrayTexId;
+	/* Texture V coord of the top of each tile when drawing using ArrayTexId. (See Atlas1D_TileV) */
+	/* NOTE: Usually 2 * the index of the 1D atlas + the V coord of the tile within that atlas */
+	float LayerV[ATLAS1D_MAX_ATLASES];
 } Atlas1D;
 
 /* URL of the current custom texture pack, can be empty */
@@ -68,6 +74,10 @@ extern cc_bool TexturePack_DefaultMissing;
 #define Atlas1D_RowId(texLoc) ((texLoc)  & Atlas1D.Mask)  /* texLoc % Atlas1D_TilesPerAtlas */
 /* Returns the index of the 1D atlas within the array of 1D atlases that contains the given tile id */
 #define Atlas1D_Index(texLoc) ((texLoc) >> Atlas1D.Shift) /* texLoc / Atlas1D_TilesPerAtlas */
+/* Returns the texture V coord of the top of the given tile id within a 1D atlas */
+/* When layered, 2 * the texture array layer is also added, for drawing with Atlas1D.ArrayTexId */
+/* NOTE: 2 * so the layer can still be recovered from V coords on the bottom edge of a 1D atlas */
+#define Atlas1D_TileV(texLoc, layered) ((layered) ? Atlas1D.LayerV[texLoc] : Atlas1D_RowId(texLoc) * Atlas1D.InvTileSize)
 
 /* Loads the given tile into a new separate texture. */
 GfxResourceID Atlas2D_LoadTile(TextureLoc texLoc);
@@ -78,6 +88,11 @@ cc_bool Atlas_TryChange(struct Bitmap* bmp);
 /* index is set to the index of the 1D atlas that the tile is in. */
 TextureRec Atlas1D_TexRec(TextureLoc texLoc, int uCount, int* index);
 void Atlas1D_Bind(int index);
+/* Recreates Atlas1D.ArrayTexId with extra layers after the layers for the 1D atlases. */
+/* Returns the index of the first extra layer, or -1 if Atlas1D.ArrayTexId is not used. */
+int  Atlas1D_AddLayers(int count);
+/* Resets Atlas1D.LayerV back to the positions of the tiles in the 1D atlases */
+void Atlas1D_ResetLayerV(void);
 
 /* Whether the given URL is in list of accepted URLs. */
 cc_bool TextureUrls_HasAccepted(const cc_string* url);
@@ -117,6 +132,10 @@ struct TextureEntry {
 	struct TextureEntry* next;
 };
 void TextureEntry_Register(struct TextureEntry* entry);
+/* Makes the next extracted entry with the given filename always be processed, even if it is unchanged */
+/* NOTE: Entries are otherwise skipped when identical to the last extracted entry with the same filename, */
+/*  so textures whose state is reset by TextureEvents.PackChanged must call this from that handler */
+CC_API void TextureEntry_Forget(const char* filename);
 
 CC_END_HEADER
 #endif
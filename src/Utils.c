@@ -1,4 +1,12 @@
 #include "Utils.h"
+#if defined __GNUC__ && (defined __x86_64__ || defined __i386__) && (defined __clang__ || __GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))
+	#include <emmintrin.h>
+	#include <wmmintrin.h>
+	#define CRC32_CLMUL
+#elif defined __ARM_FEATURE_CRC32
+	#include <arm_acle.h>
+	#define CRC32_ARMV8
+#endif
 #include "String.h"
 #include "Bitmap.h"
 #include "Platform.h"
@@ -100,35 +108,6 @@ cc_uint8 Utils_CalcSkinType(const struct Bitmap* bmp) {
 		&& IsAllBlack(bmp, 50 * scale, 16 * scale, 2 * scale,  4 * scale) ? SKIN_64x64_SLIM : SKIN_64x64;
 }
 
-cc_uint32 Utils_CRC32(const cc_uint8* data, cc_uint32 length) {
-	cc_uint32 crc = 0xffffffffUL;
-	int i;
-
-	for (i = 0; i < length; i++) {
-		crc = Utils_Crc32Table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
-	}
-	return crc ^ 0xffffffffUL;
-}
-
-const cc_uint32 Utils_Crc32Table[256] = {
-	0x00000000, 0x77073096, 0xEE0E612C, 0x990951BA, 0x076DC419, 0x706AF48F, 0xE963A535, 0x9E6495A3, 0x0EDB8832, 0x79DCB8A4, 0xE0D5E91E, 0x97D2D988, 0x09B64C2B, 0x7EB17CBD, 0xE7B82D07, 0x90BF1D91,
-	0x1DB71064, 0x6AB020F2, 0xF3B97148, 0x84BE41DE, 0x1ADAD47D, 0x6DDDE4EB, 0xF4D4B551, 0x83D385C7, 0x136C9856, 0x646BA8C0, 0xFD62F97A, 0x8A65C9EC, 0x14015C4F, 0x63066CD9, 0xFA0F3D63, 0x8D080DF5,
-	0x3B6E20C8, 0x4C69105E, 0xD56041E4, 0xA2677172, 0x3C03E4D1, 0x4B04D447, 0xD20D85FD, 0xA50AB56B, 0x35B5A8FA, 0x42B2986C, 0xDBBBC9D6, 0xACBCF940, 0x32D86CE3, 0x45DF5C75, 0xDCD60DCF, 0xABD13D59,
-	0x26D930AC, 0x51DE003A, 0xC8D75180, 0xBFD06116, 0x21B4F4B5, 0x56B3C423, 0xCFBA9599, 0xB8BDA50F, 0x2802B89E, 0x5F058808, 0xC60CD9B2, 0xB10BE924, 0x2F6F7C87, 0x58684C11, 0xC1611DAB, 0xB6662D3D,
-	0x76DC4190, 0x01DB7106, 0x98D220BC, 0xEFD5102A, 0x71B18589, 0x06B6B51F, 0x9FBFE4A5, 0xE8B8D433, 0x7807C9A2, 0x0F00F934, 0x9609A88E, 0xE10E9818, 0x7F6A0DBB, 0x086D3D2D, 0x91646C97, 0xE6635C01,
-	0x6B6B51F4, 0x1C6C6162, 0x856530D8, 0xF262004E, 0x6C0695ED, 0x1B01A57B, 0x8208F4C1, 0xF50FC457, 0x65B0D9C6, 0x12B7E950, 0x8BBEB8EA, 0xFCB9887C, 0x62DD1DDF, 0x15DA2D49, 0x8CD37CF3, 0xFBD44C65,
-	0x4DB26158, 0x3AB551CE, 0xA3BC0074, 0xD4BB30E2, 0x4ADFA541, 0x3DD895D7, 0xA4D1C46D, 0xD3D6F4FB, 0x4369E96A, 0x346ED9FC, 0xAD678846, 0xDA60B8D0, 0x44042D73, 0x33031DE5, 0xAA0A4C5F, 0xDD0D7CC9,
-	0x5005713C, 0x270241AA, 0xBE0B1010, 0xC90C2086, 0x5768B525, 0x206F85B3, 0xB966D409, 0xCE61E49F, 0x5EDEF90E, 0x29D9C998, 0xB0D09822, 0xC7D7A8B4, 0x59B33D17, 0x2EB40D81, 0xB7BD5C3B, 0xC0BA6CAD,
-	0xEDB88320, 0x9ABFB3B6, 0x03B6E20C, 0x74B1D29A, 0xEAD54739, 0x9DD277AF, 0x04DB2615, 0x73DC1683, 0xE3630B12, 0x94643B84, 0x0D6D6A3E, 0x7A6A5AA8, 0xE40ECF0B, 0x9309FF9D, 0x0A00AE27, 0x7D079EB1,
-	0xF00F9344, 0x8708A3D2, 0x1E01F268, 0x6906C2FE, 0xF762575D, 0x806567CB, 0x196C3671, 0x6E6B06E7, 0xFED41B76, 0x89D32BE0, 0x10DA7A5A, 0x67DD4ACC, 0xF9B9DF6F, 0x8EBEEFF9, 0x17B7BE43, 0x60B08ED5,
-	0xD6D6A3E8, 0xA1D1937E, 0x38D8C2C4, 0x4FDFF252, 0xD1BB67F1, 0xA6BC5767, 0x3FB506DD, 0x48B2364B, 0xD80D2BDA, 0xAF0A1B4C, 0x36034AF6, 0x41047A60, 0xDF60EFC3, 0xA867DF55, 0x316E8EEF, 0x4669BE79,
-	0xCB61B38C, 0xBC66831A, 0x256FD2A0, 0x5268E236, 0xCC0C7795, 0xBB0B4703, 0x220216B9, 0x5505262F, 0xC5BA3BBE, 0xB2BD0B28, 0x2BB45A92, 0x5CB36A04, 0xC2D7FFA7, 0xB5D0CF31, 0x2CD99E8B, 0x5BDEAE1D,
-	0x9B64C2B0, 0xEC63F226, 0x756AA39C, 0x026D930A, 0x9C0906A9, 0xEB0E363F, 0x72076785, 0x05005713, 0x95BF4A82, 0xE2B87A14, 0x7BB12BAE, 0x0CB61B38, 0x92D28E9B, 0xE5D5BE0D, 0x7CDCEFB7, 0x0BDBDF21,
-	0x86D3D2D4, 0xF1D4E242, 0x68DDB3F8, 0x1FDA836E, 0x81BE16CD, 0xF6B9265B, 0x6FB077E1, 0x18B74777, 0x88085AE6, 0xFF0F6A70, 0x66063BCA, 0x11010B5C, 0x8F659EFF, 0xF862AE69, 0x616BFFD3, 0x166CCF45,
-	0xA00AE278, 0xD70DD2EE, 0x4E048354, 0x3903B3C2, 0xA7672661, 0xD06016F7, 0x4969474D, 0x3E6E77DB, 0xAED16A4A, 0xD9D65ADC, 0x40DF0B66, 0x37D83BF0, 0xA9BCAE53, 0xDEBB9EC5, 0x47B2CF7F, 0x30B5FFE9,
-	0xBDBDF21C, 0xCABAC28A, 0x53B39330, 0x24B4A3A6, 0xBAD03605, 0xCDD70693, 0x54DE5729, 0x23D967BF, 0xB3667A2E, 0xC4614AB8, 0x5D681B02, 0x2A6F2B94, 0xB40BBE37, 0xC30C8EA1, 0x5A05DF1B, 0x2D02EF8D,
-};
-
 void Utils_Resize(void** buffer, int* capacity, cc_uint32 elemSize, int defCapacity, int expandElems) {
 	/* We use a statically allocated buffer initially, so can't realloc first time */
 	int curCapacity = *capacity, newCapacity = curCapacity + expandElems;
@@ -228,6 +207,151 @@ int Convert_FromBase64(const char* src, int len, cc_uint8* dst) {
 }
 
 
+/*########################################################################################################################*
+*----------------------------------------------------------CRC32----------------------------------------------------------*
+*#########################################################################################################################*/
+const cc_uint32 Utils_Crc32Table[256] = {
+	0x00000000, 0x77073096, 0xEE0E612C, 0x990951BA, 0x076DC419, 0x706AF48F, 0xE963A535, 0x9E6495A3, 0x0EDB8832, 0x79DCB8A4, 0xE0D5E91E, 0x97D2D988, 0x09B64C2B, 0x7EB17CBD, 0xE7B82D07, 0x90BF1D91,
+	0x1DB71064, 0x6AB020F2, 0xF3B97148, 0x84BE41DE, 0x1ADAD47D, 0x6DDDE4EB, 0xF4D4B551, 0x83D385C7, 0x136C9856, 0x646BA8C0, 0xFD62F97A, 0x8A65C9EC, 0x14015C4F, 0x63066CD9, 0xFA0F3D63, 0x8D080DF5,
+	0x3B6E20C8, 0x4C69105E, 0xD56041E4, 0xA2677172, 0x3C03E4D1, 0x4B04D447, 0xD20D85FD, 0xA50AB56B, 0x35B5A8FA, 0x42B2986C, 0xDBBBC9D6, 0xACBCF940, 0x32D86CE3, 0x45DF5C75, 0xDCD60DCF, 0xABD13D59,
+	0x26D930AC, 0x51DE003A, 0xC8D75180, 0xBFD06116, 0x21B4F4B5, 0x56B3C423, 0xCFBA9599, 0xB8BDA50F, 0x2802B89E, 0x5F058808, 0xC60CD9B2, 0xB10BE924, 0x2F6F7C87, 0x58684C11, 0xC1611DAB, 0xB6662D3D,
+	0x76DC4190, 0x01DB7106, 0x98D220BC, 0xEFD5102A, 0x71B18589, 0x06B6B51F, 0x9FBFE4A5, 0xE8B8D433, 0x7807C9A2, 0x0F00F934, 0x9609A88E, 0xE10E9818, 0x7F6A0DBB, 0x086D3D2D, 0x91646C97, 0xE6635C01,
+	0x6B6B51F4, 0x1C6C6162, 0x856530D8, 0xF262004E, 0x6C0695ED, 0x1B01A57B, 0x8208F4C1, 0xF50FC457, 0x65B0D9C6, 0x12B7E950, 0x8BBEB8EA, 0xFCB9887C, 0x62DD1DDF, 0x15DA2D49, 0x8CD37CF3, 0xFBD44C65,
+	0x4DB26158, 0x3AB551CE, 0xA3BC0074, 0xD4BB30E2, 0x4ADFA541, 0x3DD895D7, 0xA4D1C46D, 0xD3D6F4FB, 0x4369E96A, 0x346ED9FC, 0xAD678846, 0xDA60B8D0, 0x44042D73, 0x33031DE5, 0xAA0A4C5F, 0xDD0D7CC9,
+	0x5005713C, 0x270241AA, 0xBE0B1010, 0xC90C2086, 0x5768B525, 0x206F85B3, 0xB966D409, 0xCE61E49F, 0x5EDEF90E, 0x29D9C998, 0xB0D09822, 0xC7D7A8B4, 0x59B33D17, 0x2EB40D81, 0xB7BD5C3B, 0xC0BA6CAD,
+	0xEDB88320, 0x9ABFB3B6, 0x03B6E20C, 0x74B1D29A, 0xEAD54739, 0x9DD277AF, 0x04DB2615, 0x73DC1683, 0xE3630B12, 0x94643B84, 0x0D6D6A3E, 0x7A6A5AA8, 0xE40ECF0B, 0x9309FF9D, 0x0A00AE27, 0x7D079EB1,
+	0xF00F9344, 0x8708A3D2, 0x1E01F268, 0x6906C2FE, 0xF762575D, 0x806567CB, 0x196C3671, 0x6E6B06E7, 0xFED41B76, 0x89D32BE0, 0x10DA7A5A, 0x67DD4ACC, 0xF9B9DF6F, 0x8EBEEFF9, 0x17B7BE43, 0x60B08ED5,
+	0xD6D6A3E8, 0xA1D1937E, 0x38D8C2C4, 0x4FDFF252, 0xD1BB67F1, 0xA6BC5767, 0x3FB506DD, 0x48B2364B, 0xD80D2BDA, 0xAF0A1B4C, 0x36034AF6, 0x41047A60, 0xDF60EFC3, 0xA867DF55, 0x316E8EEF, 0x4669BE79,
+	0xCB61B38C, 0xBC66831A, 0x256FD2A0, 0x5268E236, 0xCC0C7795, 0xBB0B4703, 0x220216B9, 0x5505262F, 0xC5BA3BBE, 0xB2BD0B28, 0x2BB45A92, 0x5CB36A04, 0xC2D7FFA7, 0xB5D0CF31, 0x2CD99E8B, 0x5BDEAE1D,
+	0x9B64C2B0, 0xEC63F226, 0x756AA39C, 0x026D930A, 0x9C0906A9, 0xEB0E363F, 0x72076785, 0x05005713, 0x95BF4A82, 0xE2B87A14, 0x7BB12BAE, 0x0CB61B38, 0x92D28E9B, 0xE5D5BE0D, 0x7CDCEFB7, 0x0BDBDF21,
+	0x86D3D2D4, 0xF1D4E242, 0x68DDB3F8, 0x1FDA836E, 0x81BE16CD, 0xF6B9265B, 0x6FB077E1, 0x18B74777, 0x88085AE6, 0xFF0F6A70, 0x66063BCA, 0x11010B5C, 0x8F659EFF, 0xF862AE69, 0x616BFFD3, 0x166CCF45,
+	0xA00AE278, 0xD70DD2EE, 0x4E048354, 0x3903B3C2, 0xA7672661, 0xD06016F7, 0x4969474D, 0x3E6E77DB, 0xAED16A4A, 0xD9D65ADC, 0x40DF0B66, 0x37D83BF0, 0xA9BCAE53, 0xDEBB9EC5, 0x47B2CF7F, 0x30B5FFE9,
+	0xBDBDF21C, 0xCABAC28A, 0x53B39330, 0x24B4A3A6, 0xBAD03605, 0xCDD70693, 0x54DE5729, 0x23D967BF, 0xB3667A2E, 0xC4614AB8, 0x5D681B02, 0x2A6F2B94, 0xB40BBE37, 0xC30C8EA1, 0x5A05DF1B, 0x2D02EF8D,
+};
+
+/* crc32_slices[n][i] = CRC of byte i followed by n zero bytes, so 8 bytes can be processed at once */
+static cc_uint32 crc32_slices[8][256];
+static cc_bool crc32_inited, crc32_hasClmul;
+
+#ifdef CRC32_CLMUL
+/* Folding constants for the reflected CRC32 polynomial, from Intel's */
+/* "Fast CRC Computation for Generic Polynomials Using PCLMULQDQ Instruction" paper */
+static const cc_uint64 crc32_k1k2[2] = { 0x0154442bd4ULL, 0x01c6e41596ULL };
+static const cc_uint64 crc32_k3k4[2] = { 0x01751997d0ULL, 0x00ccaa009eULL };
+static const cc_uint64 crc32_k5k0[2] = { 0x0163cd6124ULL, 0x0000000000ULL };
+static const cc_uint64 crc32_poly[2] = { 0x01db710641ULL, 0x01f7011641ULL };
+
+#define Crc32_Fold(x, k, y) _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(x, k, 0x00), _mm_clmulepi64_si128(x, k, 0x11)), y)
+
+/* NOTE: length must be at least 64, and a multiple of 16 */
+static __attribute__((target("pclmul,sse2"))) cc_uint32 Crc32_Clmul(cc_uint32 crc, const cc_uint8* data, cc_uint32 length) {
+	__m128i x0, x1, x2, x3, x4, mask;
+
+	x1 = _mm_xor_si128(_mm_loadu_si128((const __m128i*)(data + 0x00)), _mm_cvtsi32_si128((int)crc));
+	x2 = _mm_loadu_si128((const __m128i*)(data + 0x10));
+	x3 = _mm_loadu_si128((const __m128i*)(data + 0x20));
+	x4 = _mm_loadu_si128((const __m128i*)(data + 0x30));
+	data += 64; length -= 64;
+
+	/* Fold 4 blocks of 128 bits at once */
+	x0 = _mm_loadu_si128((const __m128i*)crc32_k1k2);
+	for (; length >= 64; data += 64, length -= 64) {
+		x1 = Crc32_Fold(x1, x0, _mm_loadu_si128((const __m128i*)(data + 0x00)));
+		x2 = Crc32_Fold(x2, x0, _mm_loadu_si128((const __m128i*)(data + 0x10)));
+		x3 = Crc32_Fold(x3, x0, _mm_loadu_si128((const __m128i*)(data + 0x20)));
+		x4 = Crc32_Fold(x4, x0, _mm_loadu_si128((const __m128i*)(data + 0x30)));
+	}
+
+	/* Fold the 4 blocks into 128 bits, then any remaining blocks of 128 bits */
+	x0 = _mm_loadu_si128((const __m128i*)crc32_k3k4);
+	x1 = Crc32_Fold(x1, x0, x2);
+	x1 = Crc32_Fold(x1, x0, x3);
+	x1 = Crc32_Fold(x1, x0, x4);
+	for (; length >= 16; data += 16, length -= 16) {
+		x1 = Crc32_Fold(x1, x0, _mm_loadu_si128((const __m128i*)data));
+	}
+
+	/* Fold 128 bits into 64 bits */
+	mask = _mm_setr_epi32(~0, 0, ~0, 0);
+	x2 = _mm_clmulepi64_si128(x1, x0, 0x10);
+	x1 = _mm_xor_si128(_mm_srli_si128(x1, 8), x2);
+	x0 = _mm_loadl_epi64((const __m128i*)crc32_k5k0);
+	x2 = _mm_srli_si128(x1, 4);
+	x1 = _mm_clmulepi64_si128(_mm_and_si128(x1, mask), x0, 0x00);
+	x1 = _mm_xor_si128(x1, x2);
+
+	/* Barrett reduce to 32 bits */
+	x0 = _mm_loadu_si128((const __m128i*)crc32_poly);
+	x2 = _mm_clmulepi64_si128(_mm_and_si128(x1, mask), x0, 0x10);
+	x2 = _mm_clmulepi64_si128(_mm_and_si128(x2, mask), x0, 0x00);
+	x1 = _mm_xor_si128(x1, x2);
+	return (cc_uint32)_mm_cvtsi128_si32(_mm_srli_si128(x1, 4));
+}
+#endif
+
+static void Crc32_Init(void) {
+	cc_uint32 crc;
+	int i, n;
+
+	for (i = 0; i < 256; i++) {
+		crc = Utils_Crc32Table[i];
+		crc32_slices[0][i] = crc;
+
+		for (n = 1; n < 8; n++) {
+			crc = Utils_Crc32Table[crc & 0xFF] ^ (crc >> 8);
+			crc32_slices[n][i] = crc;
+		}
+	}
+
+#ifdef CRC32_CLMUL
+	crc32_hasClmul = __builtin_cpu_supports("pclmul") && __builtin_cpu_supports("sse2");
+#endif
+	crc32_inited = true;
+}
+
+cc_uint32 Utils_UpdateCRC32(cc_uint32 crc, const cc_uint8* data, cc_uint32 length) {
+	cc_uint32 hi;
+#ifdef CRC32_CLMUL
+	cc_uint32 len;
+#endif
+	if (!crc32_inited) Crc32_Init();
+
+#ifdef CRC32_CLMUL
+	if (crc32_hasClmul && length >= 64) {
+		len = length & ~15;
+		crc = Crc32_Clmul(crc, data, len);
+		data += len; length -= len;
+	}
+#elif defined CRC32_ARMV8
+	for (; length >= 8; data += 8, length -= 8) {
+		cc_uint64 word;
+		Mem_Copy(&word, data, 8);
+		crc = __crc32d(crc, word);
+	}
+#endif
+
+	/* Slice by 8 */
+	for (; length >= 8; data += 8, length -= 8) {
+		crc ^= data[0] | (data[1] << 8) | (data[2] << 16) | ((cc_uint32)data[3] << 24);
+		hi   = data[4] | (data[5] << 8) | (data[6] << 16) | ((cc_uint32)data[7] << 24);
+
+		crc = crc32_slices[7][crc & 0xFF] ^ crc32_slices[6][(crc >> 8) & 0xFF] ^ 
+			  crc32_slices[5][(crc >> 16) & 0xFF] ^ crc32_slices[4][crc >> 24] ^
+			  crc32_slices[3][hi  & 0xFF] ^ crc32_slices[2][(hi  >> 8) & 0xFF] ^
+			  crc32_slices[1][(hi >> 16) & 0xFF] ^ crc32_slices[0][hi  >> 24];
+	}
+
+	for (; length; data++, length--) {
+		crc = Utils_Crc32Table[(crc ^ *data) & 0xFF] ^ (crc >> 8);
+	}
+	return crc;
+}
+
+cc_uint32 Utils_CRC32(const cc_uint8* data, cc_uint32 length) {
+	return Utils_UpdateCRC32(0xffffffffUL, data, length) ^ 0xffffffffUL;
+}
+
+
 /*########################################################################################################################*
 *--------------------------------------------------------EntryList--------------------------------------------------------*
 *#########################################################################################################################*/
@@ -250,6 +374,7 @@ cc_result EntryList_Load(struct StringsBuffer* list, const char* file, char sepa
 
 	/* ReadLine reads single byte at a time */
 	Stream_ReadonlyBuffered(&buffered, &stream, buffer, sizeof(buffer));
+	if (separator) StringsBuffer_IndexKeys(list, separator);
 	for (;;) {
 		/* Must be re-initialised each time as String_UNSAFE_TrimStart adjusts entry.buffer */
 		String_InitArray(entry, entryBuffer);
@@ -315,6 +440,7 @@ void EntryList_Save(struct StringsBuffer* list, const char* file) {
 
 cc_bool EntryList_Remove(struct StringsBuffer* list, const cc_string* key, char separator) {
 	cc_bool found = false;
+	StringsBuffer_IndexKeys(list, separator);
 	/* Have to use a for loop, because may be multiple entries with same key */
 	for (;;) {
 		int i = EntryList_Find(list, key, separator);
@@ -341,28 +467,16 @@ void EntryList_Set(struct StringsBuffer* list, const cc_string* key, const cc_st
 }
 
 cc_string EntryList_UNSAFE_Get(struct StringsBuffer* list, const cc_string* key, char separator) {
-	cc_string curEntry, curKey, curValue;
-	int i;
-
-	for (i = 0; i < list->count; i++) {
-		StringsBuffer_UNSAFE_GetRaw(list, i, &curEntry);
-		String_UNSAFE_Separate(&curEntry, separator, &curKey, &curValue);
+	cc_string entry, curKey, curValue;
+	int i = StringsBuffer_FindKey(list, key, separator);
+	if (i == -1) return String_Empty;
 
-		if (String_CaselessEquals(key, &curKey)) return curValue;
-	}
-	return String_Empty;
+	StringsBuffer_UNSAFE_GetRaw(list, i, &entry);
+	String_UNSAFE_Separate(&entry, separator, &curKey, &curValue);
+	return curValue;
 }
 
 int EntryList_Find(struct StringsBuffer* list, const cc_string* key, char separator) {
-	cc_string curEntry, curKey, curValue;
-	int i;
-
-	for (i = 0; i < list->count; i++) {
-		StringsBuffer_UNSAFE_GetRaw(list, i, &curEntry);
-		String_UNSAFE_Separate(&curEntry, separator, &curKey, &curValue);
-
-		if (String_CaselessEquals(key, &curKey)) return i;
-	}
-	return -1;
+	return StringsBuffer_FindKey(list, key, separator);
 }
 
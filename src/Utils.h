@@ -43,6 +43,9 @@ int Utils_AccumulateWheelDelta(float* accumulator, float delta);
 
 cc_uint8 Utils_CalcSkinType(const struct Bitmap* bmp);
 cc_uint32 Utils_CRC32(const cc_uint8* data, cc_uint32 length);
+/* Updates a running CRC32 with the given data, using hardware acceleration when available. */
+/* NOTE: The running CRC32 starts as 0xFFFFFFFF, and must be inverted once all data has been processed. */
+cc_uint32 Utils_UpdateCRC32(cc_uint32 crc, const cc_uint8* data, cc_uint32 length);
 /* CRC32 lookup table, for faster CRC32 calculations. */
 /* NOTE: This cannot be just indexed by byte value - see Utils_CRC32 implementation. */
 extern const cc_uint32 Utils_Crc32Table[256];
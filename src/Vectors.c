@@ -1,4 +1,12 @@
 #include "Vectors.h"
+#if defined CC_BUILD_NEON
+	#include <arm_neon.h>
+	#define MATRIX_NEON
+#elif defined CC_BUILD_SSE2_MATH
+	/* Only used when float math is SSE anyways, so results are identical to the scalar version */
+	#include <emmintrin.h>
+	#define MATRIX_SSE
+#endif
 #include "ExtMath.h"
 #include "Funcs.h"
 #include "Constants.h"
@@ -132,6 +140,49 @@ void Matrix_Scale(struct Matrix* result, float x, float y, float z) {
 	result->row1.x = x; result->row2.y = y; result->row3.z = z;
 }
 
+#ifdef MATRIX_NEON
+/* Each row of result is a sum of the rows of right, scaled by the values in that row of left */
+/* NOTE: Multiplies and adds in the same order as the scalar version, so gives identical results */
+#define Matrix_MulRowNEON(dst, row) \
+	l = vld1q_f32(&left->row.x); \
+	r = vmulq_n_f32(   r1, vgetq_lane_f32(l, 0)); \
+	r = vmlaq_n_f32(r, r2, vgetq_lane_f32(l, 1)); \
+	r = vmlaq_n_f32(r, r3, vgetq_lane_f32(l, 2)); \
+	r = vmlaq_n_f32(r, r4, vgetq_lane_f32(l, 3)); \
+	vst1q_f32(&result->row.x, r);
+
+void Matrix_Mul(struct Matrix* result, const struct Matrix* left, const struct Matrix* right) {
+	/* Load all of right first, as result can be the same matrix as left or right */
+	float32x4_t r1 = vld1q_f32(&right->row1.x), r2 = vld1q_f32(&right->row2.x);
+	float32x4_t r3 = vld1q_f32(&right->row3.x), r4 = vld1q_f32(&right->row4.x);
+	float32x4_t l, r;
+
+	Matrix_MulRowNEON(result, row1)
+	Matrix_MulRowNEON(result, row2)
+	Matrix_MulRowNEON(result, row3)
+	Matrix_MulRowNEON(result, row4)
+}
+#elif defined MATRIX_SSE
+/* Same approach as the NEON version above */
+#define Matrix_MulRowSSE(dst, row) \
+	r = _mm_mul_ps(      r1, _mm_set1_ps(left->row.x)); \
+	r = _mm_add_ps(r, _mm_mul_ps(r2, _mm_set1_ps(left->row.y))); \
+	r = _mm_add_ps(r, _mm_mul_ps(r3, _mm_set1_ps(left->row.z))); \
+	r = _mm_add_ps(r, _mm_mul_ps(r4, _mm_set1_ps(left->row.w))); \
+	_mm_storeu_ps(&result->row.x, r);
+
+void Matrix_Mul(struct Matrix* result, const struct Matrix* left, const struct Matrix* right) {
+	/* Load all of right first, as result can be the same matrix as left or right */
+	__m128 r1 = _mm_loadu_ps(&right->row1.x), r2 = _mm_loadu_ps(&right->row2.x);
+	__m128 r3 = _mm_loadu_ps(&right->row3.x), r4 = _mm_loadu_ps(&right->row4.x);
+	__m128 r;
+
+	Matrix_MulRowSSE(result, row1)
+	Matrix_MulRowSSE(result, row2)
+	Matrix_MulRowSSE(result, row3)
+	Matrix_MulRowSSE(result, row4)
+}
+#else
 void Matrix_Mul(struct Matrix* result, const struct Matrix* left, const struct Matrix* right) {
 	/* Originally from http://www.edais.co.uk/blog/?p=27 */
 	float
@@ -165,6 +216,7 @@ void Matrix_Mul(struct Matrix* result, const struct Matrix* left, const struct M
 	result->row4.z = (((lM41 * rM13) + (lM42 * rM23)) + (lM43 * rM33)) + (lM44 * rM43);
 	result->row4.w = (((lM41 * rM14) + (lM42 * rM24)) + (lM43 * rM34)) + (lM44 * rM44);
 }
+#endif
 
 void Matrix_LookRot(struct Matrix* result, Vec3 pos, Vec2 rot) {
 	struct Matrix rotX, rotY, trans;
@@ -179,6 +231,7 @@ void Matrix_LookRot(struct Matrix* result, Vec3 pos, Vec2 rot) {
 
 struct Plane { float a, b, c, d; };
 static struct Plane frustumR, frustumL, frustumB, frustumT, frustumF;
+static const struct Plane* const frustumPlanes[] = { &frustumR, &frustumL, &frustumB, &frustumT, &frustumF };
 
 static void FrustumCulling_Normalise(struct Plane* plane) {
 	float val1 = plane->a, val2 = plane->b, val3 = plane->c;
@@ -186,6 +239,133 @@ static void FrustumCulling_Normalise(struct Plane* plane) {
 	plane->a /= t; plane->b /= t; plane->c /= t; plane->d /= t;
 }
 
+static int FrustumCulling_ClassifyPlane(const struct Plane* plane, float x, float y, float z, float radius) {
+	float d = plane->a * x + plane->b * y + plane->c * z + plane->d;
+	if (d <= -radius) return FRUSTUM_OUTSIDE;
+	return d >= radius ? FRUSTUM_INSIDE : FRUSTUM_INTERSECTS;
+}
+
+#if defined MATRIX_NEON || defined MATRIX_SSE
+/* Operations on 4 floats at once, so that multiple planes or spheres can be tested at once */
+/* NOTE: Multiplies and adds in the same order as the scalar versions, so gives identical results */
+#ifdef MATRIX_NEON
+typedef float32x4_t FVec4;
+typedef uint32x4_t  FMask4;
+#define FVec4_Set1(v)   vdupq_n_f32(v)
+#define FVec4_Load(p)   vld1q_f32(p)
+#define FVec4_Add(a, b) vaddq_f32(a, b)
+#define FVec4_Mul(a, b) vmulq_f32(a, b)
+#define FVec4_LE(a, b)  vcleq_f32(a, b)
+#define FVec4_GE(a, b)  vcgeq_f32(a, b)
+#define FMask4_Or(a, b)  vorrq_u32(a, b)
+#define FMask4_And(a, b) vandq_u32(a, b)
+#define FMask4_None()    vdupq_n_u32(0)
+#define FMask4_All()     vdupq_n_u32(0xFFFFFFFFU)
+#define FMask4_Bits(m) \
+	((vgetq_lane_u32(m, 0) & 1) | (vgetq_lane_u32(m, 1) & 2) | (vgetq_lane_u32(m, 2) & 4) | (vgetq_lane_u32(m, 3) & 8))
+#else
+typedef __m128 FVec4;
+typedef __m128 FMask4;
+#define FVec4_Set1(v)   _mm_set1_ps(v)
+#define FVec4_Load(p)   _mm_loadu_ps(p)
+#define FVec4_Add(a, b) _mm_add_ps(a, b)
+#define FVec4_Mul(a, b) _mm_mul_ps(a, b)
+#define FVec4_LE(a, b)  _mm_cmple_ps(a, b)
+#define FVec4_GE(a, b)  _mm_cmpge_ps(a, b)
+#define FMask4_Or(a, b)  _mm_or_ps(a, b)
+#define FMask4_And(a, b) _mm_and_ps(a, b)
+#define FMask4_None()    _mm_setzero_ps()
+#define FMask4_All()     _mm_cmpeq_ps(_mm_setzero_ps(), _mm_setzero_ps())
+#define FMask4_Bits(m)   _mm_movemask_ps(m)
+#endif
+
+/* Coefficients of the right, left, bottom and top planes, stored so all 4 can be tested at once */
+static float sidesA[4], sidesB[4], sidesC[4], sidesD[4];
+
+static void FrustumCulling_StoreSides(void) {
+	int i;
+	for (i = 0; i < 4; i++) {
+		sidesA[i] = frustumPlanes[i]->a; sidesB[i] = frustumPlanes[i]->b;
+		sidesC[i] = frustumPlanes[i]->c; sidesD[i] = frustumPlanes[i]->d;
+	}
+}
+
+/* Returns non-zero if the sphere is completely outside any of the 4 side planes */
+/* If inside is not NULL, sets it to whether the sphere is completely inside all of them */
+static int FrustumCulling_TestSides(float x, float y, float z, float radius, int* inside) {
+	FVec4 d = FVec4_Mul(FVec4_Load(sidesA), FVec4_Set1(x));
+	d = FVec4_Add(d, FVec4_Mul(FVec4_Load(sidesB), FVec4_Set1(y)));
+	d = FVec4_Add(d, FVec4_Mul(FVec4_Load(sidesC), FVec4_Set1(z)));
+	d = FVec4_Add(d, FVec4_Load(sidesD));
+
+	if (inside) *inside = FMask4_Bits(FVec4_GE(d, FVec4_Set1(radius))) == 0xF;
+	return FMask4_Bits(FVec4_LE(d, FVec4_Set1(-radius)));
+}
+
+cc_bool FrustumCulling_SphereInFrustum(float x, float y, float z, float radius) {
+	float d;
+	if (FrustumCulling_TestSides(x, y, z, radius, NULL)) return false;
+
+	d = frustumF.a * x + frustumF.b * y + frustumF.c * z + frustumF.d;
+	if (d <= -radius) return false;
+	/* Don't test NEAR plane, it's pointless */
+	return true;
+}
+
+int FrustumCulling_ClassifySphere(float x, float y, float z, float radius) {
+	int inside, planeResult;
+	if (FrustumCulling_TestSides(x, y, z, radius, &inside)) return FRUSTUM_OUTSIDE;
+
+	planeResult = FrustumCulling_ClassifyPlane(&frustumF, x, y, z, radius);
+	if (planeResult == FRUSTUM_OUTSIDE) return FRUSTUM_OUTSIDE;
+	/* Don't test NEAR plane, it's pointless */
+	return inside ? planeResult : FRUSTUM_INTERSECTS;
+}
+
+void FrustumCulling_ClassifyRow(float x, float y, float z, float step, int count, float radius, cc_uint8* results) {
+	const struct Plane* plane;
+	FVec4 xs, d, rad = FVec4_Set1(radius), negRad = FVec4_Set1(-radius);
+	FMask4 outside, inside;
+	float xBuffer[4];
+	int i, j, p, out, in;
+
+	/* Tests 4 spheres at once against each plane */
+	for (i = 0; i + 4 <= count; i += 4) 
+	{
+		for (j = 0; j < 4; j++) xBuffer[j] = x + (i + j) * step;
+		xs = FVec4_Load(xBuffer);
+		outside = FMask4_None();
+		inside  = FMask4_All();
+
+		for (p = 0; p < Array_Elems(frustumPlanes); p++) 
+		{
+			plane = frustumPlanes[p];
+			d = FVec4_Add(FVec4_Mul(FVec4_Set1(plane->a), xs), FVec4_Set1(plane->b * y));
+			d = FVec4_Add(d, FVec4_Set1(plane->c * z));
+			d = FVec4_Add(d, FVec4_Set1(plane->d));
+
+			outside = FMask4_Or(outside, FVec4_LE(d, negRad));
+			inside  = FMask4_And(inside, FVec4_GE(d, rad));
+		}
+
+		out = FMask4_Bits(outside);
+		in  = FMask4_Bits(inside);
+		for (j = 0; j < 4; j++) 
+		{
+			if (out & (1 << j)) {
+				results[i + j] = FRUSTUM_OUTSIDE;
+			} else {
+				results[i + j] = (in & (1 << j)) ? FRUSTUM_INSIDE : FRUSTUM_INTERSECTS;
+			}
+		}
+	}
+
+	for (; i < count; i++) 
+	{
+		results[i] = FrustumCulling_ClassifySphere(x + i * step, y, z, radius);
+	}
+}
+#else
 cc_bool FrustumCulling_SphereInFrustum(float x, float y, float z, float radius) {
 	float d;
 
@@ -212,6 +392,40 @@ cc_bool FrustumCulling_SphereInFrustum(float x, float y, float z, float radius)
 	return true;
 }
 
+int FrustumCulling_ClassifySphere(float x, float y, float z, float radius) {
+	int result = FRUSTUM_INSIDE, planeResult;
+
+	planeResult = FrustumCulling_ClassifyPlane(&frustumR, x, y, z, radius);
+	if (planeResult == FRUSTUM_OUTSIDE) return FRUSTUM_OUTSIDE;
+	result = min(result, planeResult);
+
+	planeResult = FrustumCulling_ClassifyPlane(&frustumL, x, y, z, radius);
+	if (planeResult == FRUSTUM_OUTSIDE) return FRUSTUM_OUTSIDE;
+	result = min(result, planeResult);
+
+	planeResult = FrustumCulling_ClassifyPlane(&frustumB, x, y, z, radius);
+	if (planeResult == FRUSTUM_OUTSIDE) return FRUSTUM_OUTSIDE;
+	result = min(result, planeResult);
+
+	planeResult = FrustumCulling_ClassifyPlane(&frustumT, x, y, z, radius);
+	if (planeResult == FRUSTUM_OUTSIDE) return FRUSTUM_OUTSIDE;
+	result = min(result, planeResult);
+
+	planeResult = FrustumCulling_ClassifyPlane(&frustumF, x, y, z, radius);
+	if (planeResult == FRUSTUM_OUTSIDE) return FRUSTUM_OUTSIDE;
+	/* Don't test NEAR plane, it's pointless */
+	return min(result, planeResult);
+}
+
+void FrustumCulling_ClassifyRow(float x, float y, float z, float step, int count, float radius, cc_uint8* results) {
+	int i;
+	for (i = 0; i < count; i++) 
+	{
+		results[i] = FrustumCulling_ClassifySphere(x + i * step, y, z, radius);
+	}
+}
+#endif
+
 void FrustumCulling_CalcFrustumEquations(struct Matrix* clip) {
 	/* Extract the RIGHT plane */
 	frustumR.a = clip->row1.w - clip->row1.x;
@@ -257,4 +471,8 @@ void FrustumCulling_CalcFrustumEquations(struct Matrix* clip) {
 	frustumF.d = clip->row4.w - clip->row4.z;
 #endif
 	FrustumCulling_Normalise(&frustumF);
+
+#if defined MATRIX_NEON || defined MATRIX_SSE
+	FrustumCulling_StoreSides();
+#endif
 }
@@ -135,6 +135,12 @@ CC_API void Matrix_Mul(struct Matrix* result, const struct Matrix* left, const s
 void Matrix_LookRot(struct Matrix* result, Vec3 pos, Vec2 rot);
 
 cc_bool FrustumCulling_SphereInFrustum(float x, float y, float z, float radius);
+enum FRUSTUM_RESULT { FRUSTUM_OUTSIDE, FRUSTUM_INTERSECTS, FRUSTUM_INSIDE };
+/* Returns whether the given sphere is completely outside, partially inside, or completely inside the frustum. */
+int FrustumCulling_ClassifySphere(float x, float y, float z, float radius);
+/* Classifies 'count' spheres, centred 'step' apart along the X axis starting from the given centre. */
+/* NOTE: Faster than calling FrustumCulling_ClassifySphere for each sphere, as multiple spheres are tested at once */
+void FrustumCulling_ClassifyRow(float x, float y, float z, float step, int count, float radius, cc_uint8* results);
 /* Calculates the clipping planes from the combined modelview and projection matrices */
 /* Matrix_Mul(&clip, modelView, projection); */
 void FrustumCulling_CalcFrustumEquations(struct Matrix* clip);
@@ -27,7 +27,7 @@ static void VirtualCursor_Display2D(struct Context2D* ctx) {
 
 static void VirtualCursor_MakeTexture(void) {
 	struct Context2D ctx;
-	Context2D_Alloc(&ctx, CURSOR_EXTENT * 2, CURSOR_EXTENT * 2);
+	Context2D_AllocTemp(&ctx, CURSOR_EXTENT * 2, CURSOR_EXTENT * 2);
 	{
 		VirtualCursor_Draw(&ctx, CURSOR_EXTENT, CURSOR_EXTENT);
 		Context2D_MakeTexture(&vc_texture, &ctx);
@@ -391,7 +391,7 @@ static void VirtualKeyboard_MakeTexture(void) {
 	struct Context2D ctx;
 	int width  = VirtualKeyboard_Width();
 	int height = VirtualKeyboard_Height();
-	Context2D_Alloc(&ctx, width, height);
+	Context2D_AllocTemp(&ctx, width, height);
 	{
 		VirtualKeyboard_Draw(&ctx);
 		Context2D_MakeTexture(&kb_texture, &ctx);
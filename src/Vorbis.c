@@ -1,4 +1,11 @@
 #include "Vorbis.h"
+#if defined CC_BUILD_SSE2
+	#include <emmintrin.h>
+	#define VORBIS_SSE2
+#elif defined CC_BUILD_NEON
+	#include <arm_neon.h>
+	#define VORBIS_NEON
+#endif
 #include "Logger.h"
 #include "Platform.h"
 #include "Event.h"
@@ -1096,6 +1103,59 @@ void imdct_init(struct imdct_state* state, int n) {
 	}
 }
 
+#if defined VORBIS_SSE2
+typedef __m128 VorbisVec;
+#define VorbisVec_Load(p)     _mm_loadu_ps(p)
+#define VorbisVec_Store(p, v) _mm_storeu_ps(p, v)
+#define VorbisVec_Add(a, b)   _mm_add_ps(a, b)
+#define VorbisVec_Sub(a, b)   _mm_sub_ps(a, b)
+#define VorbisVec_Mul(a, b)   _mm_mul_ps(a, b)
+#define VorbisVec_Min(a, b)   _mm_min_ps(a, b)
+#define VorbisVec_Max(a, b)   _mm_max_ps(a, b)
+#define VorbisVec_Set1(v)     _mm_set1_ps(v)
+#define VorbisVec_SwapPairs(v) _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 3, 0, 1))
+#define VORBIS_SIMD
+#elif defined VORBIS_NEON
+typedef float32x4_t VorbisVec;
+#define VorbisVec_Load(p)     vld1q_f32(p)
+#define VorbisVec_Store(p, v) vst1q_f32(p, v)
+#define VorbisVec_Add(a, b)   vaddq_f32(a, b)
+#define VorbisVec_Sub(a, b)   vsubq_f32(a, b)
+#define VorbisVec_Mul(a, b)   vmulq_f32(a, b)
+#define VorbisVec_Min(a, b)   vminq_f32(a, b)
+#define VorbisVec_Max(a, b)   vmaxq_f32(a, b)
+#define VorbisVec_Set1(v)     vdupq_n_f32(v)
+#define VorbisVec_SwapPairs(v) vrev64q_f32(v)
+#define VORBIS_SIMD
+#endif
+
+#ifdef VORBIS_SIMD
+/* Calculates step 3 butterflies of imdct_calc for both r and r + 1 at once */
+static void imdct_step3_pair(const float* w, float* u, const float* A, int n2, int k0, int k1, int r, int s2Max) {
+	float a0[4], a1[4];
+	VorbisVec t0, t1, e, f, d;
+	int s2, e_i, f_i;
+
+	/* Each vector holds e_2/e_1 for r + 1, then e_2/e_1 for r */
+	a0[0] = A[(r+1)*k1];   a0[1] =  a0[0]; a0[2] = A[r*k1];   a0[3] =  a0[2];
+	a1[0] = A[(r+1)*k1+1]; a1[1] = -a1[0]; a1[2] = A[r*k1+1]; a1[3] = -a1[2];
+	t0 = VorbisVec_Load(a0);
+	t1 = VorbisVec_Load(a1);
+
+	for (s2 = 0; s2 < s2Max; s2 += 2) 
+	{
+		e_i = n2-4-k0*s2-r*2;
+		f_i = n2-4-k0*(s2+1)-r*2;
+		e   = VorbisVec_Load(w + e_i);
+		f   = VorbisVec_Load(w + f_i);
+
+		VorbisVec_Store(u + e_i, VorbisVec_Add(e, f));
+		d = VorbisVec_Sub(e, f);
+		VorbisVec_Store(u + f_i, VorbisVec_Add(VorbisVec_Mul(d, t0), VorbisVec_Mul(VorbisVec_SwapPairs(d), t1)));
+	}
+}
+#endif
+
 void imdct_calc(float* in, float* out, struct imdct_state* state) {
 	int k, k2, k4, n = state->n;
 	int n2 = n >> 1, n4 = n >> 2, n8 = n >> 3, n3_4 = n - n4;
@@ -1136,9 +1196,15 @@ void imdct_calc(float* in, float* out, struct imdct_state* state) {
 	for (l = 0; l <= log2_n - 4; l++) 
 	{
 		int k0 = n >> (l+3), k1 = 1 << (l+3);
-		int r, r2, rMax = n >> (l+4), s2, s2Max = 1 << (l+2);
+		int r = 0, r2, rMax = n >> (l+4), s2, s2Max = 1 << (l+2);
 
-		for (r = 0, r2 = 0; r < rMax; r++, r2 += 2) 
+#ifdef VORBIS_SIMD
+		for (; r + 2 <= rMax; r += 2) 
+		{
+			imdct_step3_pair(w, u, A, n2, k0, k1, r, s2Max);
+		}
+#endif
+		for (r2 = r * 2; r < rMax; r++, r2 += 2) 
 		{
 			for (s2 = 0; s2 < s2Max; s2 += 2) 
 			{
@@ -1585,6 +1651,64 @@ cc_result Vorbis_DecodeFrame(struct VorbisState* ctx) {
 	return 0;
 }
 
+#if defined VORBIS_SSE2
+static void Vorbis_StoreMono(cc_int16* data, VorbisVec v) {
+	__m128i s = _mm_cvttps_epi32(v);
+	_mm_storel_epi64((__m128i*)data, _mm_packs_epi32(s, s));
+}
+
+static void Vorbis_StoreStereo(cc_int16* data, VorbisVec l, VorbisVec r) {
+	__m128i lo = _mm_cvttps_epi32(_mm_unpacklo_ps(l, r));
+	__m128i hi = _mm_cvttps_epi32(_mm_unpackhi_ps(l, r));
+	_mm_storeu_si128((__m128i*)data, _mm_packs_epi32(lo, hi));
+}
+#elif defined VORBIS_NEON
+static void Vorbis_StoreMono(cc_int16* data, VorbisVec v) {
+	vst1_s16(data, vqmovn_s32(vcvtq_s32_f32(v)));
+}
+
+static void Vorbis_StoreStereo(cc_int16* data, VorbisVec l, VorbisVec r) {
+	int16x4x2_t s;
+	s.val[0] = vqmovn_s32(vcvtq_s32_f32(l));
+	s.val[1] = vqmovn_s32(vcvtq_s32_f32(r));
+	vst2_s16(data, s);
+}
+#endif
+
+#ifdef VORBIS_SIMD
+/* Windows and adds together 4 overlapping samples, then scales them to 16 bit range */
+static VorbisVec Vorbis_Overlap4(const float* prev, const float* cur, const struct VorbisWindow* window, int i) {
+	VorbisVec sample = VorbisVec_Add(
+		VorbisVec_Mul(VorbisVec_Load(prev + i), VorbisVec_Load(window->Prev + i)),
+		VorbisVec_Mul(VorbisVec_Load(cur  + i), VorbisVec_Load(window->Cur  + i)));
+
+	/* Same as clamping to -1..1 first, then scaling */
+	sample = VorbisVec_Mul(sample, VorbisVec_Set1(32767.0f));
+	sample = VorbisVec_Max(sample, VorbisVec_Set1(-32767.0f));
+	return   VorbisVec_Min(sample, VorbisVec_Set1( 32767.0f));
+}
+
+/* Overlaps and adds mono or stereo samples 4 at a time, returning how many samples were output */
+static int Vorbis_OverlapSIMD(struct VorbisState* ctx, cc_int16* data, float** prev, float** cur, 
+							const struct VorbisWindow* window, int count) {
+	int i = 0;
+
+	if (ctx->channels == 1) {
+		for (; i + 4 <= count; i += 4, data += 4) 
+		{
+			Vorbis_StoreMono(data, Vorbis_Overlap4(prev[0], cur[0], window, i));
+		}
+	} else if (ctx->channels == 2) {
+		for (; i + 4 <= count; i += 4, data += 8) 
+		{
+			Vorbis_StoreStereo(data, Vorbis_Overlap4(prev[0], cur[0], window, i),
+									 Vorbis_Overlap4(prev[1], cur[1], window, i));
+		}
+	}
+	return i;
+}
+#endif
+
 int Vorbis_OutputFrame(struct VorbisState* ctx, cc_int16* data) {
 	struct VorbisWindow window;
 	float* prev[VORBIS_MAX_CHANS];
@@ -1647,7 +1771,12 @@ int Vorbis_OutputFrame(struct VorbisState* ctx, cc_int16* data) {
 
 	/* overlap and add data */
 	/* also perform windowing here */
-	for (i = 0; i < overlapSize; i++) 
+	i = 0;
+#ifdef VORBIS_SIMD
+	i = Vorbis_OverlapSIMD(ctx, data, prev, cur, &window, overlapSize);
+	data += i * ctx->channels;
+#endif
+	for (; i < overlapSize; i++) 
 	{
 		for (ch = 0; ch < ctx->channels; ch++) 
 		{
@@ -301,6 +301,7 @@ static void ScrollbarWidget_Render(void* widget, float delta) {
 	cc_bool hovered;
 
 	x = w->x; width = w->width;
+	Gfx_Begin2DBatch();
 	Gfx_Draw2DFlat(x, w->y, width, w->height, SCROLL_BACK_COL);
 
 	ScrollbarWidget_GetScrollbarCoords(w, &y, &height);
@@ -311,13 +312,15 @@ static void ScrollbarWidget_Render(void* widget, float delta) {
 	barCol  = hovered ? SCROLL_HOVER_COL : SCROLL_BAR_COL;
 	Gfx_Draw2DFlat(x, y, width, height, barCol);
 
-	if (height < 20) return;
-	x += w->nubsWidth; y += (height / 2);
-	width -= w->nubsWidth * 2;
+	if (height >= 20) {
+		x += w->nubsWidth; y += (height / 2);
+		width -= w->nubsWidth * 2;
 
-	Gfx_Draw2DFlat(x, y + w->offsets[0], width, w->borderY, SCROLL_BACK_COL);
-	Gfx_Draw2DFlat(x, y + w->offsets[1], width, w->borderY, SCROLL_BACK_COL);
-	Gfx_Draw2DFlat(x, y + w->offsets[2], width, w->borderY, SCROLL_BACK_COL);
+		Gfx_Draw2DFlat(x, y + w->offsets[0], width, w->borderY, SCROLL_BACK_COL);
+		Gfx_Draw2DFlat(x, y + w->offsets[1], width, w->borderY, SCROLL_BACK_COL);
+		Gfx_Draw2DFlat(x, y + w->offsets[2], width, w->borderY, SCROLL_BACK_COL);
+	}
+	Gfx_End2DBatch();
 }
 
 static int ScrollbarWidget_PointerDown(void* widget, int id, int x, int y) {
@@ -790,6 +793,7 @@ static void TableWidget_BuildMesh(void* widget, struct VertexTextured** vertices
 	i = w->selectedIndex;
 	if (i != -1) {
 		TableWidget_GetCoords(w, i, &x, &y);
+		IsometricDrawer_BeginOverlay();
 
 		IsometricDrawer_AddBatch(w->blocks[i],
 			w->selBlockSize, x + cellSizeX / 2, y + cellSizeY / 2);
@@ -1632,7 +1636,7 @@ static void TextInputWidget_RemakeTexture(void* widget) {
 	width  = max(textWidth,  w->minWidth);  w->base.width  = width;
 	height = max(lineHeight, w->minHeight); w->base.height = height;
 
-	Context2D_Alloc(&ctx, width, height);
+	Context2D_AllocTemp(&ctx, width, height);
 	{
 		/* Centre text vertically */
 		y = 0;
@@ -1762,7 +1766,7 @@ static void ChatInputWidget_MakeTexture(struct InputWidget* w, int width, int he
 	char lastCol;
 	int i, x, y;
 
-	Context2D_Alloc(&ctx, width, height);
+	Context2D_AllocTemp(&ctx, width, height);
 
 	DrawTextArgs_Make(&args, &chatInputPrefix, w->font, true);
 	Context2D_DrawText(&ctx, &args, 0, 0);
@@ -1825,6 +1829,7 @@ static void ChatInputWidget_Render(void* widget, float delta) {
 	cc_bool caretAtEnd;
 	int i, width;
 	if (w->flags & WIDGET_FLAG_DISABLED) return;
+	Gfx_Begin2DBatch();
 
 	for (i = 0; i < INPUTWIDGET_MAX_LINES; i++) {
 		if (i > 0 && !w->lines[i].length) break;
@@ -1840,6 +1845,7 @@ static void ChatInputWidget_Render(void* widget, float delta) {
 
 	Texture_Render(&w->inputTex);
 	InputWidget_RenderCaret(w, delta);
+	Gfx_End2DBatch();
 }
 
 static void ChatInputWidget_OnPressedEnter(void* widget) {
@@ -2334,7 +2340,7 @@ static void TextGroupWidget_DrawAdvanced(struct TextGroupWidget* w, struct Textu
 		width += partWidths[i];
 	}
 	
-	Context2D_Alloc(&ctx, width, height);
+	Context2D_AllocTemp(&ctx, width, height);
 	{
 		x = 0;
 		for (i = 0; i < portionsCount; i++) {
@@ -2657,7 +2663,7 @@ static void SpecialInputWidget_Make(struct SpecialInputWidget* w, struct Special
 	height = titlesHeight + contentHeight;
 	Gfx_DeleteTexture(&w->tex.ID);
 
-	Context2D_Alloc(&ctx, width, height);
+	Context2D_AllocTemp(&ctx, width, height);
 	{
 		SpecialInputWidget_DrawTitles(w, &ctx);
 		Context2D_Clear(&ctx, color, 0, titlesHeight, width, contentHeight);
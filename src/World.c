@@ -7,12 +7,600 @@
 #include "Entity.h"
 #include "ExtMath.h"
 #include "Physics.h"
+#include "BlockPhysics.h"
 #include "Game.h"
 #include "TexturePack.h"
 #include "Window.h"
+#include "Funcs.h"
+#include "Errors.h"
 
 struct _WorldData World;
 static char nameBuffer[STRING_SIZE];
+#ifdef CC_BUILD_BUILDERTHREADS
+/*########################################################################################################################*
+*-----------------------------------------------------World snapshot------------------------------------------------------*
+*#########################################################################################################################*/
+/* Pages of the block arrays are only copied the first time they are changed after the snapshot was taken */
+#define SNAPSHOT_PAGE_SHIFT 16
+enum SNAPSHOT_PAGE { PAGE_LIVE, PAGE_COPIED, PAGE_READ };
+
+static struct WorldSnapshot {
+	void* lock;
+	BlockRaw* arrays[2]; /* Block arrays of the world the snapshot was taken from */
+	BlockRaw** copies;   /* Preserved copy of each page, for each array */
+	cc_uint8* states;    /* SNAPSHOT_PAGE state of each page, for each array */
+	int volume, numArrays, numPages;
+	cc_bool active;
+	cc_bool live; /* Whether unchanged pages are still read directly from the world's block arrays */
+} snapshot;
+
+/* NOTE: Must be called while holding the snapshot lock */
+static cc_bool Snapshot_CopyPage(int array, int page) {
+	int i      = array * snapshot.numPages + page;
+	int offset = page << SNAPSHOT_PAGE_SHIFT;
+	int count  = min(WORLD_SNAPSHOT_PAGE_SIZE, snapshot.volume - offset);
+	BlockRaw* copy;
+	if (snapshot.states[i] != PAGE_LIVE) return true;
+
+	copy = (BlockRaw*)Mem_TryAlloc(count, 1);
+	if (!copy) return false;
+
+	Mem_Copy(copy, snapshot.arrays[array] + offset, count);
+	snapshot.copies[i] = copy;
+	snapshot.states[i] = PAGE_COPIED;
+	return true;
+}
+
+static CC_NOINLINE void Snapshot_PreservePage(int index) {
+	int a, page = index >> SNAPSHOT_PAGE_SHIFT;
+	cc_bool ok  = true;
+
+	Mutex_Lock(snapshot.lock);
+	for (a = 0; a < snapshot.numArrays; a++) {
+		ok &= Snapshot_CopyPage(a, page);
+	}
+	/* Not enough memory to preserve the page, so reading it later will fail */
+	if (!ok) snapshot.live = false;
+	Mutex_Unlock(snapshot.lock);
+}
+
+/* Copies all the remaining pages, so the world's block arrays can be freed */
+static void Snapshot_Detach(void) {
+	int a, page;
+	if (!snapshot.live) return;
+
+	Mutex_Lock(snapshot.lock);
+	for (a = 0; a < snapshot.numArrays; a++) {
+		for (page = 0; page < snapshot.numPages; page++) {
+			if (!Snapshot_CopyPage(a, page)) goto done;
+		}
+	}
+done:
+	snapshot.live = false;
+	Mutex_Unlock(snapshot.lock);
+}
+
+int World_BeginSnapshot(void) {
+	int count;
+	if (snapshot.active || !World.Blocks) return 0;
+
+	snapshot.arrays[0] = World.Blocks;
+	snapshot.numArrays = 1;
+#ifdef EXTENDED_BLOCKS
+	if (World.Blocks2 != World.Blocks) {
+		snapshot.arrays[1] = World.Blocks2;
+		snapshot.numArrays = 2;
+	}
+#endif
+
+	snapshot.volume   = World.Volume;
+	snapshot.numPages = (World.Volume + (WORLD_SNAPSHOT_PAGE_SIZE - 1)) >> SNAPSHOT_PAGE_SHIFT;
+	count = snapshot.numArrays * snapshot.numPages;
+
+	snapshot.states = (cc_uint8*)Mem_TryAllocCleared(count, 1);
+	snapshot.copies = (BlockRaw**)Mem_TryAllocCleared(count, sizeof(BlockRaw*));
+	if (!snapshot.states || !snapshot.copies) {
+		Mem_Free(snapshot.states);
+		Mem_Free(snapshot.copies);
+		return 0;
+	}
+
+	snapshot.lock   = Mutex_Create("World snapshot");
+	snapshot.active = true;
+	snapshot.live   = true;
+	return snapshot.numArrays;
+}
+
+cc_result World_ReadSnapshot(int array, int page, BlockRaw* data, int* count) {
+	int i      = array * snapshot.numPages + page;
+	int offset = page << SNAPSHOT_PAGE_SHIFT;
+	cc_result res = 0;
+	*count = min(WORLD_SNAPSHOT_PAGE_SIZE, snapshot.volume - offset);
+
+	Mutex_Lock(snapshot.lock);
+	if (snapshot.states[i] == PAGE_COPIED) {
+		Mem_Copy(data, snapshot.copies[i], *count);
+		Mem_Free(snapshot.copies[i]);
+		snapshot.copies[i] = NULL;
+	} else if (snapshot.states[i] == PAGE_LIVE && snapshot.live) {
+		Mem_Copy(data, snapshot.arrays[array] + offset, *count);
+	} else {
+		res = ERR_OUT_OF_MEMORY;
+	}
+
+	snapshot.states[i] = PAGE_READ;
+	Mutex_Unlock(snapshot.lock);
+	return res;
+}
+
+void World_EndSnapshot(void) {
+	int i;
+	if (!snapshot.active) return;
+
+	for (i = 0; i < snapshot.numArrays * snapshot.numPages; i++) {
+		Mem_Free(snapshot.copies[i]);
+	}
+	Mem_Free(snapshot.copies);
+	Mem_Free(snapshot.states);
+	Mutex_Free(snapshot.lock);
+	Mem_Set(&snapshot, 0, sizeof(snapshot));
+}
+#else
+static void Snapshot_Detach(void) { }
+#endif
+
+
+/*########################################################################################################################*
+*------------------------------------------------------Dirty chunks-------------------------------------------------------*
+*#########################################################################################################################*/
+/* One bit per chunk, set when a block in that chunk changes. NULL means every chunk is treated as changed. */
+static cc_uint8* dirtyChunks;
+static CC_INLINE void Dirty_Mark(int x, int y, int z) {
+	int index;
+	if (!dirtyChunks) return;
+
+	index = World_ChunkPack(x >> CHUNK_SHIFT, y >> CHUNK_SHIFT, z >> CHUNK_SHIFT);
+	dirtyChunks[index >> 3] |= (cc_uint8)(1 << (index & 7));
+}
+
+static void Dirty_Free(void) {
+	Mem_MapFree(dirtyChunks);
+	dirtyChunks = NULL;
+}
+
+/* A newly loaded world has not been saved anywhere yet, so every chunk starts off as changed */
+static void Dirty_Reset(void) {
+	int size = (World.ChunksCount + 7) >> 3;
+	Dirty_Free();
+	if (!World.ChunksCount) return;
+
+	dirtyChunks = (cc_uint8*)Mem_TryMapAlloc(size, 1);
+	if (dirtyChunks) Mem_Set(dirtyChunks, 0xFF, size);
+}
+
+cc_bool World_IsChunkDirty(int cx, int cy, int cz) {
+	int index = World_ChunkPack(cx, cy, cz);
+	return !dirtyChunks || (dirtyChunks[index >> 3] & (1 << (index & 7)));
+}
+
+void World_ClearDirtyChunks(void) {
+	if (!dirtyChunks) dirtyChunks = (cc_uint8*)Mem_TryMapAlloc((World.ChunksCount + 7) >> 3, 1);
+	if (dirtyChunks) Mem_Set(dirtyChunks, 0, (World.ChunksCount + 7) >> 3);
+}
+
+
+/*########################################################################################################################*
+*-----------------------------------------------------Column heights------------------------------------------------------*
+*#########################################################################################################################*/
+#define COLUMN_VISIBLE 0 /* Highest block that is not gas or a sprite */
+#define COLUMN_SOLID   1 /* Highest block with solid collision */
+#define COLUMN_KINDS   2
+
+/* Height of the highest matching block of each kind in each column, or -1 if none */
+/* Columns not yet (re)calculated store Column_Unknown(maxY), where maxY is an upper bound for the height */
+/* NOTE: Only allocated once first used, and NULL if allocation failed */
+static cc_int16* columnHeights;
+static int columnsCount;
+static cc_bool columnsAllocFailed;
+#define Column_Unknown(maxY) (-2 - (maxY))
+#define Column_Index(x, z) (((z) * World.Width + (x)) * COLUMN_KINDS)
+
+static CC_INLINE cc_bool Column_Matches(int kind, BlockID block) {
+	if (kind == COLUMN_SOLID) return Blocks.Collide[block] == COLLIDE_SOLID;
+	return !(Blocks.Draw[block] == DRAW_GAS || Blocks.Draw[block] == DRAW_SPRITE);
+}
+
+int World_ColumnsVersion;
+
+static void Columns_Free(void) {
+	World_ColumnsVersion++;
+	Mem_MapFree(columnHeights);
+	columnHeights = NULL;
+	columnsCount  = 0;
+	columnsAllocFailed = false;
+}
+
+static void Columns_Invalidate(void) {
+	int i;
+	World_ColumnsVersion++;
+	for (i = 0; i < columnsCount * COLUMN_KINDS; i++) 
+	{
+		columnHeights[i] = Column_Unknown(World.MaxY);
+	}
+}
+
+
+/* Updates the column heights affected by changing the block at the given coordinates */
+/* NOTE: Rescanning columns is deferred until the height is next needed */
+static CC_INLINE void Columns_Update(int x, int y, int z, BlockID block) {
+	cc_int16* heights;
+	int kind, height;
+	/* Heights aren't tracked, so any change might have changed the highest block */
+	if (!columnHeights) { World_ColumnsVersion++; return; }
+	heights = &columnHeights[Column_Index(x, z)];
+
+	for (kind = 0; kind < COLUMN_KINDS; kind++) 
+	{
+		height = heights[kind];
+		if (height < -1) {
+			/* Unknown height, but matching block at or above the upper bound must be the highest */
+			if (y >= Column_Unknown(height) && Column_Matches(kind, block)) {
+				heights[kind] = y; World_ColumnsVersion++;
+			}
+		} else if (y > height) {
+			if (Column_Matches(kind, block)) {
+				heights[kind] = y; World_ColumnsVersion++;
+			}
+		} else if (y == height && !Column_Matches(kind, block)) {
+			heights[kind] = Column_Unknown(y - 1); World_ColumnsVersion++;
+		}
+	}
+}
+
+static int Columns_Calculate(int kind, int x, int maxY, int z) {
+	int i = World_Pack(x, maxY, z), y;
+
+	for (y = maxY; y >= 0; y--, i -= World.OneY) 
+	{
+		if (Column_Matches(kind, World_GetRawBlock(i))) return y;
+	}
+	return -1;
+}
+
+static void Columns_Alloc(void) {
+	columnHeights = (cc_int16*)Mem_TryMapAlloc(World.Width * World.Length, COLUMN_KINDS * 2);
+	columnsAllocFailed = !columnHeights;
+	if (!columnHeights) return;
+
+	columnsCount = World.Width * World.Length;
+	Columns_Invalidate();
+}
+
+static int Columns_Get(int kind, int x, int z) {
+	int index, height;
+	if (!World_HasBlocks()) return -1;
+
+	if (!columnHeights && !columnsAllocFailed) Columns_Alloc();
+	/* Not enough memory, so just always scan the column instead */
+	if (!columnHeights) return Columns_Calculate(kind, x, World.MaxY, z);
+
+	index  = Column_Index(x, z) + kind;
+	height = columnHeights[index];
+	if (height >= -1) return height;
+
+	height = Columns_Calculate(kind, x, Column_Unknown(height), z);
+	columnHeights[index] = (cc_int16)height;
+	return height;
+}
+
+int World_GetTopVisibleY(int x, int z) { return Columns_Get(COLUMN_VISIBLE, x, z); }
+int World_GetTopSolidY(int x, int z)   { return Columns_Get(COLUMN_SOLID,   x, z); }
+
+
+/*########################################################################################################################*
+*----------------------------------------------------Chunk occupancy------------------------------------------------------*
+*#########################################################################################################################*/
+#define OCCUPANCY_UNKNOWN 0 /* Chunk needs to be (re)checked */
+#define OCCUPANCY_EMPTY   1 /* Chunk only contains empty blocks */
+#define OCCUPANCY_BLOCKS  2 /* Chunk contains at least one non empty block */
+/* Whether the given block is invisible and can't be collided with (e.g. air) */
+#define Occupancy_IsEmpty(block) (Blocks.Draw[block] == DRAW_GAS && Blocks.Collide[block] != COLLIDE_SOLID)
+
+/* Occupancy state of each chunk, only allocated once first used (and NULL if allocation failed) */
+static cc_uint8* chunkOccupancy;
+static cc_bool occupancyAllocFailed;
+
+static void Occupancy_Free(void) {
+	Mem_MapFree(chunkOccupancy);
+	chunkOccupancy = NULL;
+	occupancyAllocFailed = false;
+}
+
+static void Occupancy_Invalidate(void) {
+	if (chunkOccupancy) Mem_Set(chunkOccupancy, OCCUPANCY_UNKNOWN, World.ChunksCount);
+}
+
+static CC_INLINE void Occupancy_Update(int x, int y, int z, BlockID block) {
+	int index;
+	if (!chunkOccupancy) return;
+	index = World_ChunkPack(x >> CHUNK_SHIFT, y >> CHUNK_SHIFT, z >> CHUNK_SHIFT);
+
+	if (!Occupancy_IsEmpty(block)) {
+		chunkOccupancy[index] = OCCUPANCY_BLOCKS;
+	} else if (chunkOccupancy[index] == OCCUPANCY_BLOCKS) {
+		/* Might have been the last non empty block in the chunk */
+		chunkOccupancy[index] = OCCUPANCY_UNKNOWN;
+	}
+}
+
+static cc_uint8 Occupancy_Calculate(int cx, int cy, int cz) {
+	int x1 = cx << CHUNK_SHIFT, x2 = min(World.Width,  x1 + CHUNK_SIZE);
+	int y1 = cy << CHUNK_SHIFT, y2 = min(World.Height, y1 + CHUNK_SIZE);
+	int z1 = cz << CHUNK_SHIFT, z2 = min(World.Length, z1 + CHUNK_SIZE);
+	int x, y, z, i;
+
+	for (y = y1; y < y2; y++)
+		for (z = z1; z < z2; z++)
+		{
+			i = World_Pack(x1, y, z);
+			for (x = x1; x < x2; x++, i++) 
+			{
+				if (!Occupancy_IsEmpty(World_GetRawBlock(i))) return OCCUPANCY_BLOCKS;
+			}
+		}
+	return OCCUPANCY_EMPTY;
+}
+
+cc_bool World_IsChunkEmpty(int cx, int cy, int cz) {
+	int index = World_ChunkPack(cx, cy, cz);
+	if (!World_HasBlocks()) return true;
+
+	if (!chunkOccupancy && !occupancyAllocFailed) {
+		chunkOccupancy = (cc_uint8*)Mem_TryMapAlloc(World.ChunksCount, 1);
+		occupancyAllocFailed = !chunkOccupancy;
+		if (chunkOccupancy) Mem_Set(chunkOccupancy, 0, World.ChunksCount);
+	}
+	/* Not enough memory, so just always scan the chunk instead */
+	if (!chunkOccupancy) return Occupancy_Calculate(cx, cy, cz) == OCCUPANCY_EMPTY;
+
+	if (chunkOccupancy[index] == OCCUPANCY_UNKNOWN) {
+		chunkOccupancy[index] = Occupancy_Calculate(cx, cy, cz);
+	}
+	return chunkOccupancy[index] == OCCUPANCY_EMPTY;
+}
+
+
+#ifdef CC_BUILD_PALETTEWORLD
+/*########################################################################################################################*
+*-----------------------------------------------------Paletted chunks-----------------------------------------------------*
+*#########################################################################################################################*/
+/* Each chunk stores bit-packed indices into a palette of the blocks used in that chunk. */
+/* Chunks made of only one block (e.g. all air) store no indices at all, so that */
+/*  memory usage depends on how varied the blocks in the world are, instead of its volume. */
+#define PALETTE_DIRECT_BITS 16 /* Too many different blocks for a palette, so block IDs are stored directly */
+#define PALETTE_MAX_ENTRIES 256
+#define PALETTE_MAX_BLOCKS  1024
+
+struct WorldChunk {
+	cc_uint32* data;  /* Packed palette indices, followed by the palette. NULL if bits is 0 */
+	BlockID* palette; /* Blocks that the packed indices refer to */
+	int count;        /* Number of blocks in the palette */
+	int bits;         /* Bits per packed index, or 0 if the chunk is made of a single block */
+	BlockID single;   /* The block the chunk is made of, when bits is 0 */
+};
+#define Chunk_Index(x, y, z) ((((y) & CHUNK_MASK) << 8) | (((z) & CHUNK_MASK) << 4) | ((x) & CHUNK_MASK))
+#define Chunk_Get(x, y, z) (&World.Chunks[World_ChunkPack((x) >> CHUNK_SHIFT, (y) >> CHUNK_SHIFT, (z) >> CHUNK_SHIFT)])
+
+static CC_INLINE int Chunk_GetIndex(const struct WorldChunk* c, int i) {
+	int bit = i * c->bits;
+	return (c->data[bit >> 5] >> (bit & 31)) & ((1 << c->bits) - 1);
+}
+
+static CC_INLINE BlockID Chunk_GetBlock(const struct WorldChunk* c, int i) {
+	if (!c->bits) return c->single;
+	if (c->bits == PALETTE_DIRECT_BITS) return ((cc_uint16*)c->data)[i];
+	return c->palette[Chunk_GetIndex(c, i)];
+}
+
+/* Stores either a palette index, or a block ID when the chunk doesn't use a palette */
+static void Chunk_PutIndex(struct WorldChunk* c, int i, int value) {
+	int bit;
+	if (c->bits == PALETTE_DIRECT_BITS) { ((cc_uint16*)c->data)[i] = value; return; }
+
+	bit = i * c->bits;
+	c->data[bit >> 5] &= ~(((1U << c->bits) - 1) << (bit & 31));
+	c->data[bit >> 5] |= (cc_uint32)value << (bit & 31);
+}
+
+static cc_bool Chunk_Alloc(struct WorldChunk* c, int bits) {
+	int words   = CHUNK_SIZE_3 / 32 * bits;
+	int entries = bits == PALETTE_DIRECT_BITS ? 0 : 1 << bits;
+
+	c->data = (cc_uint32*)Mem_TryAllocCleared(words * 4 + entries * sizeof(BlockID), 1);
+	if (!c->data) return false;
+
+	c->bits    = bits;
+	c->palette = (BlockID*)(c->data + words);
+	return true;
+}
+
+/* Reallocates the chunk to use more bits per packed index */
+static cc_bool Chunk_Grow(struct WorldChunk* c) {
+	struct WorldChunk old = *c;
+	int i, bits = !c->bits ? 1 : (c->bits == 8 ? PALETTE_DIRECT_BITS : c->bits * 2);
+	if (!Chunk_Alloc(c, bits)) { *c = old; return false; }
+
+	if (!old.bits) {
+		/* Packed indices are all 0 already */
+		c->palette[0] = old.single;
+		c->count = 1;
+		return true;
+	}
+
+	if (bits == PALETTE_DIRECT_BITS) {
+		for (i = 0; i < CHUNK_SIZE_3; i++) Chunk_PutIndex(c, i, Chunk_GetBlock(&old, i));
+	} else {
+		Mem_Copy(c->palette, old.palette, old.count * sizeof(BlockID));
+		for (i = 0; i < CHUNK_SIZE_3; i++) Chunk_PutIndex(c, i, Chunk_GetIndex(&old, i));
+	}
+	Mem_Free(old.data);
+	return true;
+}
+
+static void Chunk_SetBlock(struct WorldChunk* c, int i, BlockID block) {
+	int p;
+	if (!c->bits && block == c->single) return;
+	if (!c->bits && !Chunk_Grow(c)) { World_OutOfMemory(); return; }
+	if (c->bits == PALETTE_DIRECT_BITS) { Chunk_PutIndex(c, i, block); return; }
+
+	for (p = 0; p < c->count; p++) {
+		if (c->palette[p] == block) break;
+	}
+
+	if (p == c->count) {
+		if (c->count == (1 << c->bits)) {
+			if (!Chunk_Grow(c)) { World_OutOfMemory(); return; }
+			if (c->bits == PALETTE_DIRECT_BITS) { Chunk_PutIndex(c, i, block); return; }
+		}
+		c->palette[c->count++] = block;
+	}
+	Chunk_PutIndex(c, i, p);
+}
+
+static void Chunks_Free(void) {
+	int i;
+	if (!World.Chunks) return;
+
+	for (i = 0; i < World.ChunksCount; i++) {
+		Mem_Free(World.Chunks[i].data);
+	}
+	Mem_Free(World.Chunks);
+	World.Chunks = NULL;
+}
+
+#ifdef EXTENDED_BLOCKS
+#define Chunks_FlatBlock(i) ((World.Blocks[i] | (World.Blocks2[i] << 8)) & World.IDMask)
+#else
+#define Chunks_FlatBlock(i) World.Blocks[i]
+#endif
+
+/* Gets the blocks of the given chunk from the flat block arrays being imported */
+/* Parts of the chunk outside the world use the chunk's first block, so they don't affect the palette */
+static void Chunks_ReadFlat(int cx, int cy, int cz, BlockID* blocks) {
+	int x1 = cx << CHUNK_SHIFT, y1 = cy << CHUNK_SHIFT, z1 = cz << CHUNK_SHIFT;
+	int x2 = min(x1 + CHUNK_SIZE, World.Width);
+	int y2 = min(y1 + CHUNK_SIZE, World.Height);
+	int z2 = min(z1 + CHUNK_SIZE, World.Length);
+	int x, y, z, i, index;
+	BlockID first = (BlockID)Chunks_FlatBlock(World_Pack(x1, y1, z1));
+
+	for (i = 0; i < CHUNK_SIZE_3; i++) blocks[i] = first;
+
+	for (y = y1; y < y2; y++) {
+		for (z = z1; z < z2; z++) {
+			index = World_Pack(x1, y, z);
+			i     = Chunk_Index(x1, y, z);
+
+			for (x = x1; x < x2; x++, index++, i++) {
+				blocks[i] = (BlockID)Chunks_FlatBlock(index);
+			}
+		}
+	}
+}
+
+static cc_bool Chunks_Encode(struct WorldChunk* c, const BlockID* blocks) {
+	static BlockID palette[PALETTE_MAX_ENTRIES];
+	static cc_int16 lookup[PALETTE_MAX_BLOCKS];
+	int i, count = 0, bits;
+
+	for (i = 0; i < CHUNK_SIZE_3; i++) {
+		if (lookup[blocks[i]]) continue;
+		if (count < PALETTE_MAX_ENTRIES) palette[count] = blocks[i];
+		lookup[blocks[i]] = ++count;
+	}
+
+	if (count == 1) {
+		c->single = blocks[0];
+		c->bits   = 0;
+		c->data   = NULL;
+		lookup[blocks[0]] = 0;
+		return true;
+	}
+
+	if (count <= 2) {        bits = 1;
+	} else if (count <= 4)  { bits = 2;
+	} else if (count <= 16) { bits = 4;
+	} else if (count <= PALETTE_MAX_ENTRIES) { bits = 8;
+	} else { bits = PALETTE_DIRECT_BITS; }
+
+	if (!Chunk_Alloc(c, bits)) {
+		Mem_Set(lookup, 0, sizeof(lookup));
+		return false;
+	}
+
+	if (bits == PALETTE_DIRECT_BITS) {
+		for (i = 0; i < CHUNK_SIZE_3; i++) Chunk_PutIndex(c, i, blocks[i]);
+		Mem_Set(lookup, 0, sizeof(lookup));
+		return true;
+	}
+
+	Mem_Copy(c->palette, palette, count * sizeof(BlockID));
+	c->count = count;
+	for (i = 0; i < CHUNK_SIZE_3; i++) Chunk_PutIndex(c, i, lookup[blocks[i]] - 1);
+	for (i = 0; i < count; i++) lookup[palette[i]] = 0;
+	return true;
+}
+
+/* Converts the flat block arrays being imported into paletted chunks */
+static cc_bool Chunks_Convert(void) {
+	static BlockID blocks[CHUNK_SIZE_3];
+	int cx, cy, cz;
+	struct WorldChunk* c;
+
+	World.Chunks = (struct WorldChunk*)Mem_TryAllocCleared(World.ChunksCount, sizeof(struct WorldChunk));
+	if (!World.Chunks) return false;
+
+	for (cy = 0; cy < World.ChunksY; cy++)
+		for (cz = 0; cz < World.ChunksZ; cz++)
+			for (cx = 0; cx < World.ChunksX; cx++)
+	{
+		c = &World.Chunks[World_ChunkPack(cx, cy, cz)];
+		Chunks_ReadFlat(cx, cy, cz, blocks);
+		if (!Chunks_Encode(c, blocks)) return false;
+	}
+
+#ifdef EXTENDED_BLOCKS
+	if (World.Blocks2 != World.Blocks) Mem_Free(World.Blocks2);
+	World.Blocks2 = NULL;
+#endif
+	Mem_Free(World.Blocks);
+	World.Blocks = NULL;
+	return true;
+}
+
+BlockID World_GetBlock(int x, int y, int z) {
+	return Chunk_GetBlock(Chunk_Get(x, y, z), Chunk_Index(x, y, z));
+}
+
+BlockID World_GetRawBlock(int index) {
+	int x, y, z;
+	World_Unpack(index, x, y, z);
+	return World_GetBlock(x, y, z);
+}
+
+void World_CopyRawBlocks(int index, int count, BlockRaw* blocks, int shift) {
+	int i, x, y, z;
+	World_Unpack(index, x, y, z);
+
+	for (i = 0; i < count; i++) {
+		blocks[i] = (BlockRaw)(World_GetBlock(x, y, z) >> shift);
+		if (++x < World.Width)  continue;
+		x = 0;
+		if (++z < World.Length) continue;
+		z = 0; y++;
+	}
+}
+#endif
 /*########################################################################################################################*
 *----------------------------------------------------------World----------------------------------------------------------*
 *#########################################################################################################################*/
@@ -38,6 +626,14 @@ static void GenerateNewUuid(void) {
 }
 
 void World_Reset(void) {
+	Physics_WaitForThread();
+	Snapshot_Detach();
+	Dirty_Free();
+	Columns_Free();
+	Occupancy_Free();
+#ifdef CC_BUILD_PALETTEWORLD
+	Chunks_Free();
+#endif
 #ifdef EXTENDED_BLOCKS
 	if (World.Blocks != World.Blocks2) Mem_Free(World.Blocks2);
 	World.Blocks2 = NULL;
@@ -57,11 +653,15 @@ void World_Reset(void) {
 void World_NewMap(void) {
 	World_Reset();
 	Event_RaiseVoid(&WorldEvents.NewMap);
+	/* All components have now released their state for the previous map */
+	Mem_ResetMapArena();
 }
 
 void World_SetNewMap(BlockRaw* blocks, int width, int height, int length) {
 	/* TODO: TEMP HACK */
 	if (!blocks) { width = 0; height = 0; length = 0; }
+	Physics_WaitForThread();
+	Snapshot_Detach();
 
 	World_SetDimensions(width, height, length);
 	World.Blocks      = blocks;
@@ -75,6 +675,15 @@ void World_SetNewMap(BlockRaw* blocks, int width, int height, int length) {
 		World.IDMask  = 0xFF;
 	}
 #endif
+#ifdef CC_BUILD_PALETTEWORLD
+	if (World.Blocks && !Chunks_Convert()) {
+		World_OutOfMemory();
+		width = 0; height = 0; length = 0;
+	}
+#endif
+	Dirty_Reset();
+	Columns_Free();
+	Occupancy_Free();
 
 	if (Env.EdgeHeight == -1)   { Env.EdgeHeight   = height / 2; }
 	if (Env.CloudsHeight == -1) { Env.CloudsHeight = height + 2; }
@@ -113,7 +722,17 @@ void World_OutOfMemory(void) {
 }
 
 
+#if defined CC_BUILD_PALETTEWORLD
+void World_SetBlock(int x, int y, int z, BlockID block) {
 #ifdef EXTENDED_BLOCKS
+	if (block > 0xFF) World.IDMask = 0x3FF;
+#endif
+	Dirty_Mark(x, y, z);
+	Columns_Update(x, y, z, block);
+	Occupancy_Update(x, y, z, block);
+	Chunk_SetBlock(Chunk_Get(x, y, z), Chunk_Index(x, y, z), block);
+}
+#elif defined EXTENDED_BLOCKS
 static CC_NOINLINE void LazyInitUpper(int i, BlockID block) {
 	BlockRaw* data = (BlockRaw*)Mem_TryAllocCleared(World.Volume, 1);
 	if (!data) { World_OutOfMemory(); return; }
@@ -124,6 +743,12 @@ static CC_NOINLINE void LazyInitUpper(int i, BlockID block) {
 
 void World_SetBlock(int x, int y, int z, BlockID block) {
 	int i = World_Pack(x, y, z);
+#ifdef CC_BUILD_BUILDERTHREADS
+	if (snapshot.live) Snapshot_PreservePage(i);
+#endif
+	Dirty_Mark(x, y, z);
+	Columns_Update(x, y, z, block);
+	Occupancy_Update(x, y, z, block);
 	World.Blocks[i] = (BlockRaw)block;
 
 	/* defer allocation of second map array if possible */
@@ -136,7 +761,14 @@ void World_SetBlock(int x, int y, int z, BlockID block) {
 }
 #else
 void World_SetBlock(int x, int y, int z, BlockID block) {
-	World.Blocks[World_Pack(x, y, z)] = block; 
+	int i = World_Pack(x, y, z);
+#ifdef CC_BUILD_BUILDERTHREADS
+	if (snapshot.live) Snapshot_PreservePage(i);
+#endif
+	Dirty_Mark(x, y, z);
+	Columns_Update(x, y, z, block);
+	Occupancy_Update(x, y, z, block);
+	World.Blocks[i] = block;
 }
 #endif
 
@@ -300,17 +932,37 @@ float Respawn_HighestSolidY(struct AABB* bb) {
 	return highestY;
 }
 
+/* Returns the highest y of any solid block in the columns the given bounding box covers */
+static int Respawn_HighestColumn(struct AABB* bb) {
+	int minX = max(0, Math_Floor(bb->Min.x)), maxX = min(World.MaxX, Math_Floor(bb->Max.x));
+	int minZ = max(0, Math_Floor(bb->Min.z)), maxZ = min(World.MaxZ, Math_Floor(bb->Max.z));
+	int x, z, highest = -1;
+
+	for (z = minZ; z <= maxZ; z++)
+		for (x = minX; x <= maxX; x++)
+		{
+			highest = max(highest, World_GetTopSolidY(x, z));
+		}
+	return highest;
+}
+
 Vec3 Respawn_FindSpawnPosition(float x, float z, Vec3 modelSize) {
 	Vec3 spawn;
 	struct AABB bb;
 	float highestY;
-	int y;
+	int y, top;
 
 	Vec3_Set(spawn, x, World.Height + ENTITY_ADJUSTMENT, z);
 	AABB_Make(&bb, &spawn, &modelSize);
 	spawn.y = 0.0f;
+	top = Respawn_HighestColumn(&bb);
 	
 	for (y = World.Height; y >= 0; y--) {
+		/* No solid blocks this high up in any of the columns */
+		if (Math_Floor(bb.Min.y) > top) {
+			bb.Min.y -= 1.0f; bb.Max.y -= 1.0f; continue;
+		}
+
 		highestY = Respawn_HighestSolidY(&bb);
 		if (highestY != RESPAWN_NOT_FOUND) {
 			spawn.y = highestY; break;
@@ -320,7 +972,17 @@ Vec3 Respawn_FindSpawnPosition(float x, float z, Vec3 modelSize) {
 	return spawn;
 }
 
+static void OnBlockDefChanged(void* obj) {
+	Columns_Invalidate();
+	Occupancy_Invalidate();
+}
+
+static void OnInit(void) {
+	World_Reset();
+	Event_Register_(&BlockEvents.BlockDefChanged, NULL, OnBlockDefChanged);
+}
+
 struct IGameComponent World_Component = {
-	World_Reset, /* Init  */
+	OnInit,      /* Init  */
 	World_Reset  /* Free  */
 };
@@ -9,6 +9,7 @@ Represents a fixed size 3D array of blocks and associated metadata
 Copyright 2014-2025 ClassiCube | Licensed under BSD-3
 */
 struct AABB;
+struct WorldChunk;
 extern struct IGameComponent World_Component;
 
 /* Unpacka an index into x,y,z (slow!) */
@@ -23,6 +24,8 @@ extern struct IGameComponent World_Component;
 
 CC_VAR extern struct _WorldData {
 	/* The blocks in the world. */
+	/* NOTE: In CC_BUILD_PALETTEWORLD builds, this and Blocks2 are only used while importing a map, */
+	/*  and are converted into paletted chunks (then freed) by World_SetNewMap */
 	BlockRaw* Blocks;
 #ifdef EXTENDED_BLOCKS
 	/* The upper 8 bit of blocks in the world. */
@@ -60,6 +63,10 @@ CC_VAR extern struct _WorldData {
 	int ChunksCount;
 	/* Seed world was generated with. May be 0 (unknown) */
 	int Seed;
+#ifdef CC_BUILD_PALETTEWORLD
+	/* Blocks in each chunk of the world, stored using a palette of the blocks used in that chunk */
+	struct WorldChunk* Chunks;
+#endif
 } World;
 
 /* Frees the blocks array, sets dimensions to 0, resets environment to default. */
@@ -75,10 +82,37 @@ CC_API void World_SetNewMap(BlockRaw* blocks, int width, int height, int length)
 CC_NOINLINE void World_SetDimensions(int width, int height, int length);
 void World_OutOfMemory(void);
 
+#ifdef CC_BUILD_BUILDERTHREADS
+/* Number of blocks in each page of a world snapshot */
+#define WORLD_SNAPSHOT_PAGE_SIZE (1 << 16)
+/* Takes a copy-on-write snapshot of the blocks in the world, so they can be read from another thread */
+/* while the world keeps being modified. Returns number of block arrays in the snapshot, or 0 on failure. */
+/* NOTE: Only one snapshot can be active at a time */
+int World_BeginSnapshot(void);
+/* Copies the blocks in the given page of a snapshot's block array into data. */
+/* NOTE: Each page can only be read once. Can be called from any thread. */
+cc_result World_ReadSnapshot(int array, int page, BlockRaw* data, int* count);
+/* Frees the active snapshot. */
+/* NOTE: The snapshot must no longer be being read from on another thread */
+void World_EndSnapshot(void);
+#endif
+
 #ifdef EXTENDED_BLOCKS
 /* Sets World.Blocks2 and updates internal state for more than 256 blocks. */
 void World_SetMapUpper(BlockRaw* blocks);
+#endif
 
+#if defined CC_BUILD_PALETTEWORLD
+/* Gets the block at the given coordinates. */
+/* NOTE: Does NOT check that the coordinates are inside the map. */
+CC_API BlockID World_GetBlock(int x, int y, int z);
+/* Gets the block at the given packed index. (slow!) */
+BlockID World_GetRawBlock(int index);
+/* Stores (block >> shift) of each of the count blocks from the given packed index onwards */
+void World_CopyRawBlocks(int index, int count, BlockRaw* blocks, int shift);
+/* Whether the world currently has any blocks */
+#define World_HasBlocks() (World.Chunks != NULL)
+#elif defined EXTENDED_BLOCKS
 #define World_GetRawBlock(idx) ((World.Blocks[idx] | (World.Blocks2[idx] << 8)) & World.IDMask)
 
 /* Gets the block at the given coordinates. */
@@ -91,6 +125,10 @@ static CC_INLINE BlockID World_GetBlock(int x, int y, int z) {
 #define World_GetBlock(x, y, z) World.Blocks[World_Pack(x, y, z)]
 #define World_GetRawBlock(idx)  World.Blocks[idx]
 #endif
+#ifndef CC_BUILD_PALETTEWORLD
+/* Whether the world currently has any blocks */
+#define World_HasBlocks() (World.Blocks != NULL)
+#endif
 
 /* If Y is above the map, returns BLOCK_AIR. */
 /* If coordinates are outside the map, returns BLOCK_AIR. */
@@ -102,6 +140,24 @@ void World_SetBlock(int x, int y, int z, BlockID block);
 /* If coordinates are outside the map, returns BLOCK_AIR. */
 /* Otherwise returns the block at the given coordinates. */
 BlockID World_SafeGetBlock(int x, int y, int z);
+/* Incremented whenever the highest block of a column may have changed, so that callers can cache heights */
+/* NOTE: Changes to columns whose height is currently unknown (i.e. not calculated yet) are not counted */
+extern int World_ColumnsVersion;
+/* Returns y of the highest block in the column that is not gas or a sprite (i.e. stops rain), or -1 if none */
+/* NOTE: Does NOT check that the coordinates are inside the map. */
+int World_GetTopVisibleY(int x, int z);
+/* Returns y of the highest block in the column with solid collision, or -1 if none */
+/* NOTE: Does NOT check that the coordinates are inside the map. */
+int World_GetTopSolidY(int x, int z);
+/* Whether the given chunk only contains gas blocks that can't be collided with (e.g. air) */
+/* NOTE: Does NOT check that the coordinates are inside the map. */
+cc_bool World_IsChunkEmpty(int cx, int cy, int cz);
+
+/* Whether any blocks in the given chunk have changed since World_ClearDirtyChunks was last called. */
+/* NOTE: All chunks are dirty after World_SetNewMap */
+cc_bool World_IsChunkDirty(int cx, int cy, int cz);
+/* Marks all chunks as unchanged, e.g. after the world has been saved */
+void World_ClearDirtyChunks(void);
 
 /* Whether the given coordinates lie inside the map. */
 static CC_INLINE cc_bool World_Contains(int x, int y, int z) {
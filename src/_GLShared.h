@@ -33,9 +33,15 @@ static void GLContext_GetAll(const struct DynamicLibSym* syms, int count) {
 	}
 }
 
+static void GL_InitCompression(void);
+static void GL_InitMipmaps(void);
+static void GL_InitTimestamps(void);
 static void GL_InitCommon(void) {
 	_glGetIntegerv(GL_MAX_TEXTURE_SIZE, &Gfx.MaxTexWidth);
 	Gfx.MaxTexHeight = Gfx.MaxTexWidth;
+	GL_InitCompression();
+	GL_InitMipmaps();
+	GL_InitTimestamps();
 	Gfx.Created      = true;
 	/* necessary for android which "loses" context when window is closed */
 	Gfx.LostContext  = false;
@@ -64,35 +70,470 @@ static void* FastAllocTempMem(int size) {
 }
 
 
+/*########################################################################################################################*
+*--------------------------------------------------Texture compression----------------------------------------------------*
+*#########################################################################################################################*/
+#ifndef CC_BUILD_GLES
+#define _GL_TEXTURE_INTERNAL_FORMAT       0x1003
+#define _GL_COMPRESSED_RGBA_S3TC_DXT1_EXT 0x83F1
+#define _GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+
+static void (APIENTRY *_glCompressedTexImage2D)(GLenum target, GLint level, GLenum internalFormat, GLsizei width, GLsizei height, 
+								GLint border, GLsizei imageSize, const void* data);
+static void (APIENTRY *_glCompressedTexSubImage2D)(GLenum target, GLint level, GLint xoffset, GLint yoffset, GLsizei width, GLsizei height, 
+								GLenum format, GLsizei imageSize, const void* data);
+static void (APIENTRY *_glGetTexLevelParameteriv)(GLenum target, GLint level, GLenum pname, GLint* params);
+
+static void GL_InitCompression(void) {
+	static const struct DynamicLibSym funcs[] = {
+		DynamicLib_ReqSym(glCompressedTexImage2D),   DynamicLib_ReqSym(glCompressedTexSubImage2D),
+		DynamicLib_ReqSym(glGetTexLevelParameteriv)
+	};
+	static const cc_string s3tcExt = String_FromConst("GL_EXT_texture_compression_s3tc");
+	cc_string extensions = String_FromReadonly((const char*)_glGetString(GL_EXTENSIONS));
+
+	if (!String_CaselessContains(&extensions, &s3tcExt)) return;
+	GLContext_GetAll(funcs, Array_Elems(funcs));
+	Gfx.SupportsCompressedTextures = _glCompressedTexImage2D && _glCompressedTexSubImage2D && _glGetTexLevelParameteriv;
+}
+
+/* Returns number of bytes needed to store an image of the given size in the given S3TC format */
+static int DXT_CalcSize(GLenum format, int width, int height) {
+	int blockSize = format == _GL_COMPRESSED_RGBA_S3TC_DXT1_EXT ? 8 : 16;
+	return ((width + 3) / 4) * ((height + 3) / 4) * blockSize;
+}
+
+static cc_uint16 DXT_Pack565(const int* rgb) {
+	return (cc_uint16)(((rgb[0] >> 3) << 11) | ((rgb[1] >> 2) << 5) | (rgb[2] >> 3));
+}
+
+static void DXT_Unpack565(cc_uint16 value, int* rgb) {
+	int r = (value >> 11) & 0x1F, g = (value >> 5) & 0x3F, b = value & 0x1F;
+	rgb[0] = (r << 3) | (r >> 2);
+	rgb[1] = (g << 2) | (g >> 4);
+	rgb[2] = (b << 3) | (b >> 2);
+}
+
+/* Encodes a 4x4 block of pixels into a BC1 colour block */
+/* NOTE: Endpoints are picked from the bounding box of the colours, which is fast but lower */
+/*  quality than the exhaustive search that offline texture compressors usually perform */
+static void DXT_EncodeColors(cc_uint8 px[16][4], cc_bool punchthrough, cc_uint8* dst) {
+	int mn[3] = { 255, 255, 255 }, mx[3] = { 0, 0, 0 }, pal[4][3];
+	int i, j, tmp, total = 0, colors, best, bestDist, dist, d;
+	int cen[3], covRB = 0, covGB = 0;
+	cc_uint16 c0, c1;
+	cc_uint32 indices = 0;
+
+	for (i = 0; i < 16; i++) 
+	{
+		if (punchthrough && px[i][3] < 128) continue;
+		for (j = 0; j < 3; j++) { mn[j] = min(mn[j], px[i][j]); mx[j] = max(mx[j], px[i][j]); }
+		total++;
+	}
+	/* Only need to use 3 colour mode when some pixels are actually transparent */
+	if (total == 16) punchthrough = false;
+
+	if (!total) {
+		/* c0 <= c1 with every index being 3 decodes as fully transparent */
+		dst[0] = 0; dst[1] = 0; dst[2] = 0; dst[3] = 0;
+		dst[4] = 0xFF; dst[5] = 0xFF; dst[6] = 0xFF; dst[7] = 0xFF;
+		return;
+	}
+
+	/* The bounding box diagonal from min to max might go the wrong way for red and green */
+	for (j = 0; j < 3; j++) cen[j] = (mn[j] + mx[j]) >> 1;
+	for (i = 0; i < 16; i++) 
+	{
+		if (punchthrough && px[i][3] < 128) continue;
+		covRB += (px[i][0] - cen[0]) * (px[i][2] - cen[2]);
+		covGB += (px[i][1] - cen[1]) * (px[i][2] - cen[2]);
+	}
+	if (covRB < 0) { tmp = mn[0]; mn[0] = mx[0]; mx[0] = tmp; }
+	if (covGB < 0) { tmp = mn[1]; mn[1] = mx[1]; mx[1] = tmp; }
+
+	/* Move endpoints slightly inwards, since the extreme colours are usually outliers */
+	for (j = 0; j < 3; j++) 
+	{
+		tmp     = (mx[j] - mn[j]) / 16;
+		mx[j]  -= tmp; mn[j] += tmp;
+	}
+
+	c0 = DXT_Pack565(mx); c1 = DXT_Pack565(mn);
+	/* c0 > c1 selects 4 colour mode, c0 <= c1 selects 3 colour + transparent mode */
+	if (punchthrough ? c0 > c1 : c0 < c1) { tmp = c0; c0 = c1; c1 = (cc_uint16)tmp; }
+
+	DXT_Unpack565(c0, pal[0]);
+	DXT_Unpack565(c1, pal[1]);
+	for (j = 0; j < 3; j++) 
+	{
+		if (c0 > c1) {
+			pal[2][j] = (pal[0][j] * 2 + pal[1][j]) / 3;
+			pal[3][j] = (pal[0][j] + pal[1][j] * 2) / 3;
+		} else {
+			pal[2][j] = (pal[0][j] + pal[1][j]) / 2;
+		}
+	}
+	colors = c0 > c1 ? 4 : 3;
+
+	for (i = 15; i >= 0; i--) 
+	{
+		if (punchthrough && px[i][3] < 128) { 
+			best = 3; 
+		} else {
+			best = 0; bestDist = 3 * 256 * 256;
+			for (j = 0; j < colors; j++) 
+			{
+				d = px[i][0] - pal[j][0]; dist  = d * d;
+				d = px[i][1] - pal[j][1]; dist += d * d;
+				d = px[i][2] - pal[j][2]; dist += d * d;
+				if (dist < bestDist) { best = j; bestDist = dist; }
+			}
+		}
+		indices = (indices << 2) | best;
+	}
+
+	dst[0] = (cc_uint8)c0;      dst[1] = (cc_uint8)(c0 >> 8);
+	dst[2] = (cc_uint8)c1;      dst[3] = (cc_uint8)(c1 >> 8);
+	dst[4] = (cc_uint8)indices; dst[5] = (cc_uint8)(indices >> 8);
+	dst[6] = (cc_uint8)(indices >> 16); dst[7] = (cc_uint8)(indices >> 24);
+}
+
+/* Encodes the alpha of a 4x4 block of pixels into a BC3 alpha block */
+static void DXT_EncodeAlpha(cc_uint8 px[16][4], cc_uint8* dst) {
+	int i, mn = 255, mx = 0, range, level;
+	cc_uint32 bits = 0, count = 0;
+	dst += 2;
+
+	for (i = 0; i < 16; i++) 
+	{
+		mn = min(mn, px[i][3]); mx = max(mx, px[i][3]);
+	}
+	dst[-2] = (cc_uint8)mx; dst[-1] = (cc_uint8)mn;
+	range   = mx - mn;
+
+	/* Index 0 is a0, index 1 is a1, and indices 2 to 7 are interpolated between them */
+	for (i = 0; i < 16; i++) 
+	{
+		level = range ? ((mx - px[i][3]) * 7 + range / 2) / range : 0;
+		level = level == 0 ? 0 : (level == 7 ? 1 : level + 1);
+		bits |= (cc_uint32)level << count;
+		count += 3;
+
+		/* Each group of 8 indices is stored in 3 bytes */
+		if (count < 24) continue;
+		dst[0] = (cc_uint8)bits; dst[1] = (cc_uint8)(bits >> 8); dst[2] = (cc_uint8)(bits >> 16);
+		dst += 3; bits = 0; count = 0;
+	}
+}
+
+static void DXT_Encode(GLenum format, struct Bitmap* bmp, int rowWidth, cc_uint8* dst) {
+	cc_uint8 px[16][4];
+	BitmapCol col;
+	int bx, by, x, y, i;
+
+	for (by = 0; by < bmp->height; by += 4) 
+	{
+		for (bx = 0; bx < bmp->width; bx += 4) 
+		{
+			/* Edge pixels are repeated for blocks partially outside the image */
+			for (i = 0; i < 16; i++) 
+			{
+				x   = min(bx + (i & 3),  bmp->width  - 1);
+				y   = min(by + (i >> 2), bmp->height - 1);
+				col = bmp->scan0[y * rowWidth + x];
+
+				px[i][0] = BitmapCol_R(col); px[i][1] = BitmapCol_G(col);
+				px[i][2] = BitmapCol_B(col); px[i][3] = BitmapCol_A(col);
+			}
+
+			if (format == _GL_COMPRESSED_RGBA_S3TC_DXT1_EXT) {
+				DXT_EncodeColors(px, true, dst); dst += 8;
+			} else {
+				DXT_EncodeAlpha(px, dst);
+				DXT_EncodeColors(px, false, dst + 8); dst += 16;
+			}
+		}
+	}
+}
+
+/* Returns the S3TC format that the given image should be compressed using, or 0 if none */
+static GLenum DXT_ChooseFormat(struct Bitmap* bmp, int rowWidth, cc_uint8 flags) {
+	int x, y;
+	cc_uint8 a;
+	if (!(flags & TEXTURE_FLAG_COMPRESSED) || !Gfx.CompressTextures || !Gfx.SupportsCompressedTextures) return 0;
+
+	/* DXT1 only supports fully transparent or fully opaque pixels */
+	for (y = 0; y < bmp->height; y++) 
+	{
+		for (x = 0; x < bmp->width; x++) 
+		{
+			a = BitmapCol_A(bmp->scan0[y * rowWidth + x]);
+			if (a != 0 && a != 255) return _GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+		}
+	}
+	return _GL_COMPRESSED_RGBA_S3TC_DXT1_EXT;
+}
+
+/* Returns the S3TC format of the currently bound texture, or 0 if it is not compressed */
+static GLenum DXT_GetFormat(GLenum target) {
+	GLint format = 0;
+	if (!Gfx.CompressTextures || !Gfx.SupportsCompressedTextures) return 0;
+
+	_glGetTexLevelParameteriv(target, 0, _GL_TEXTURE_INTERNAL_FORMAT, &format);
+	if (format == _GL_COMPRESSED_RGBA_S3TC_DXT1_EXT || format == _GL_COMPRESSED_RGBA_S3TC_DXT5_EXT) return format;
+	return 0;
+}
+
+/* Compresses the given image, returning NULL if it is a partial update that isn't aligned to 4x4 blocks */
+static cc_uint8* DXT_EncodeTemp(GLenum format, int x, int y, struct Bitmap* part, int rowWidth, cc_bool full, int* size) {
+	cc_uint8* data;
+	if (!full && ((x | y | part->width | part->height) & 3)) return NULL;
+
+	*size = DXT_CalcSize(format, part->width, part->height);
+	data  = (cc_uint8*)Mem_Alloc(*size, 1, "compressed texture");
+	DXT_Encode(format, part, rowWidth, data);
+	return data;
+}
+
+static void UploadCompressed(GLenum format, int lvl, int x, int y, struct Bitmap* part, int rowWidth, cc_bool full) {
+	int size;
+	cc_uint8* data = DXT_EncodeTemp(format, x, y, part, rowWidth, full, &size);
+	if (!data) return;
+
+	if (full) {
+		_glCompressedTexImage2D(GL_TEXTURE_2D, lvl, format, part->width, part->height, 0, size, data);
+	} else {
+		_glCompressedTexSubImage2D(GL_TEXTURE_2D, lvl, x, y, part->width, part->height, format, size, data);
+	}
+	Mem_Free(data);
+}
+#else
+static void GL_InitCompression(void) { }
+#define DXT_ChooseFormat(bmp, rowWidth, flags) 0
+#define DXT_GetFormat(target) 0
+static void UploadCompressed(GLenum format, int lvl, int x, int y, struct Bitmap* part, int rowWidth, cc_bool full) { }
+#endif
+
+
+/*########################################################################################################################*
+*---------------------------------------------------------Mipmaps---------------------------------------------------------*
+*#########################################################################################################################*/
+#ifndef CC_BUILD_GLES
+static void (APIENTRY *_glGenerateMipmap)(GLenum target);
+
+static void GL_InitMipmaps(void) {
+	static const struct DynamicLibSym coreFuncs[] = { DynamicLib_ReqSym(glGenerateMipmap) };
+	static const struct DynamicLibSym extFuncs[]  = { DynamicLib_ReqSym2("glGenerateMipmapEXT", glGenerateMipmap) };
+	static const cc_string arbExt = String_FromConst("GL_ARB_framebuffer_object");
+	static const cc_string extExt = String_FromConst("GL_EXT_framebuffer_object");
+	cc_string extensions;
+	const GLubyte* ver;
+
+	/* GPU generated mipmaps don't weight colours by alpha like GenMipmaps does */
+	if (!Options_GetBool(OPT_GPU_MIPMAPS, false)) return;
+	extensions = String_FromReadonly((const char*)_glGetString(GL_EXTENSIONS));
+	ver        = _glGetString(GL_VERSION);
+
+	/* Supported in core since 3.0 */
+	if (ver[0] >= '3' || String_CaselessContains(&extensions, &arbExt)) {
+		GLContext_GetAll(coreFuncs, Array_Elems(coreFuncs));
+	} else if (String_CaselessContains(&extensions, &extExt)) {
+		GLContext_GetAll(extFuncs,  Array_Elems(extFuncs));
+	}
+}
+
+/* Regenerates all mipmap levels of the bound texture on the GPU, returning false if unsupported */
+static cc_bool GL_GenerateMipmaps(GLenum target, GLenum format) {
+	/* Compressed formats can't be rendered to, so could only be downsampled on the CPU */
+	if (!_glGenerateMipmap || format) return false;
+
+	_glGenerateMipmap(target);
+	return true;
+}
+#else
+static void GL_InitMipmaps(void) { }
+#define GL_GenerateMipmaps(target, format) false
+#endif
+
+
+/*########################################################################################################################*
+*-------------------------------------------------------GPU timestamps----------------------------------------------------*
+*#########################################################################################################################*/
+#define _GL_QUERY_RESULT           0x8866
+#define _GL_QUERY_RESULT_AVAILABLE 0x8867
+#define _GL_TIMESTAMP              0x8E28
+#define _GL_GPU_DISJOINT_EXT       0x8FBB
+
+static void (APIENTRY *_glGenQueries)(GLsizei n, GLuint* ids);
+static void (APIENTRY *_glDeleteQueries)(GLsizei n, const GLuint* ids);
+static void (APIENTRY *_glQueryCounter)(GLuint id, GLenum target);
+static void (APIENTRY *_glGetQueryObjectiv)(GLuint id, GLenum pname, GLint* params);
+static void (APIENTRY *_glGetQueryObjectui64v)(GLuint id, GLenum pname, cc_uint64* params);
+
+static GLuint ts_queries[GFX_TIMESTAMP_FRAMES][GFX_MAX_TIMESTAMPS];
+static int ts_counts[GFX_TIMESTAMP_FRAMES];
+static int ts_frame;
+
+#ifdef CC_BUILD_GLES
+static void GL_InitTimestamps(void) {
+	static const struct DynamicLibSym funcs[] = {
+		DynamicLib_ReqSym2("glGenQueriesEXT",          glGenQueries),
+		DynamicLib_ReqSym2("glDeleteQueriesEXT",       glDeleteQueries),
+		DynamicLib_ReqSym2("glQueryCounterEXT",        glQueryCounter),
+		DynamicLib_ReqSym2("glGetQueryObjectivEXT",    glGetQueryObjectiv),
+		DynamicLib_ReqSym2("glGetQueryObjectui64vEXT", glGetQueryObjectui64v)
+	};
+	static const cc_string extExt = String_FromConst("GL_EXT_disjoint_timer_query");
+	cc_string extensions = String_FromReadonly((const char*)_glGetString(GL_EXTENSIONS));
+
+	if (String_CaselessContains(&extensions, &extExt)) {
+		GLContext_GetAll(funcs, Array_Elems(funcs));
+	}
+#else
+static void GL_InitTimestamps(void) {
+	static const struct DynamicLibSym funcs[] = {
+		DynamicLib_ReqSym(glGenQueries),        DynamicLib_ReqSym(glDeleteQueries),
+		DynamicLib_ReqSym(glQueryCounter),      DynamicLib_ReqSym(glGetQueryObjectiv),
+		DynamicLib_ReqSym(glGetQueryObjectui64v)
+	};
+	static const cc_string arbExt = String_FromConst("GL_ARB_timer_query");
+	cc_string extensions = String_FromReadonly((const char*)_glGetString(GL_EXTENSIONS));
+	const GLubyte* ver   = _glGetString(GL_VERSION);
+
+	/* Supported in core since 3.3 */
+	if (ver[0] > '3' || (ver[0] == '3' && ver[2] >= '3') || String_CaselessContains(&extensions, &arbExt)) {
+		GLContext_GetAll(funcs, Array_Elems(funcs));
+	}
+#endif
+	Gfx.SupportsTimestamps = _glGenQueries && _glDeleteQueries && _glQueryCounter 
+							&& _glGetQueryObjectiv && _glGetQueryObjectui64v;
+}
+
+static void GL_FreeTimestamps(void) {
+	int i;
+	if (!ts_queries[0][0]) return;
+
+	for (i = 0; i < GFX_TIMESTAMP_FRAMES; i++) 
+	{
+		_glDeleteQueries(GFX_MAX_TIMESTAMPS, ts_queries[i]);
+		ts_queries[i][0] = 0;
+		ts_counts[i]     = 0;
+	}
+}
+
+void Gfx_BeginTimestamps(void) {
+	int i;
+	if (!Gfx.SupportsTimestamps) return;
+
+	if (!ts_queries[0][0]) {
+		for (i = 0; i < GFX_TIMESTAMP_FRAMES; i++) _glGenQueries(GFX_MAX_TIMESTAMPS, ts_queries[i]);
+	}
+	ts_frame = (ts_frame + 1) % GFX_TIMESTAMP_FRAMES;
+	ts_counts[ts_frame] = 0;
+
+#ifdef CC_BUILD_GLES
+	/* Reading GPU_DISJOINT_EXT resets it, so later checks only cover timestamps recorded from now */
+	{ GLint disjoint; _glGetIntegerv(_GL_GPU_DISJOINT_EXT, &disjoint); }
+#endif
+}
+
+void Gfx_RecordTimestamp(int slot) {
+	if (!Gfx.SupportsTimestamps || !ts_queries[0][0]) return;
+
+	_glQueryCounter(ts_queries[ts_frame][slot], _GL_TIMESTAMP);
+	ts_counts[ts_frame] = max(ts_counts[ts_frame], slot + 1);
+}
+
+void Gfx_EndTimestamps(void) { }
+
+int Gfx_ReadTimestamps(float* times, int maxCount) {
+	int i, frame = (ts_frame + 1) % GFX_TIMESTAMP_FRAMES;
+	int count    = min(maxCount, ts_counts[frame]);
+	cc_uint64 first, value;
+	GLint available = 0;
+	if (!count) return 0;
+
+	/* Queries complete in order, so if the last one is done then the others are too */
+	_glGetQueryObjectiv(ts_queries[frame][count - 1], _GL_QUERY_RESULT_AVAILABLE, &available);
+	if (!available) return 0;
+
+#ifdef CC_BUILD_GLES
+	{
+		/* e.g. GPU clock frequency changed, so results are meaningless */
+		GLint disjoint = 0;
+		_glGetIntegerv(_GL_GPU_DISJOINT_EXT, &disjoint);
+		if (disjoint) { ts_counts[frame] = 0; return 0; }
+	}
+#endif
+
+	_glGetQueryObjectui64v(ts_queries[frame][0], _GL_QUERY_RESULT, &first);
+	for (i = 0; i < count; i++) 
+	{
+		_glGetQueryObjectui64v(ts_queries[frame][i], _GL_QUERY_RESULT, &value);
+		/* Timestamps are in nanoseconds */
+		times[i] = (int)((value - first) / 1000) / 1000.0f;
+	}
+	ts_counts[frame] = 0;
+	return count;
+}
+
+static BitmapCol* mipmapsData;
+static int mipmapsSize;
+
+/* Returns storage for all mipmap levels of a bitmap of the given size, reused between calls */
+static BitmapCol* GetMipmapsTemp(int width, int height) {
+	int lvl, lvls = CalcMipmapsLevels(width, height), count = 0;
+
+	for (lvl = 1; lvl <= lvls; lvl++) {
+		if (width > 1)  width /= 2;
+		if (height > 1) height /= 2;
+		count += width * height;
+	}
+
+	if (count > mipmapsSize) {
+		Mem_Free(mipmapsData);
+		mipmapsData = (BitmapCol*)Mem_Alloc(count, BITMAPCOLOR_SIZE, "mipmaps");
+		mipmapsSize = count;
+	}
+	return mipmapsData;
+}
+
+
 /*########################################################################################################################*
 *---------------------------------------------------------Textures--------------------------------------------------------*
 *#########################################################################################################################*/
-static void Gfx_DoMipmaps(int x, int y, struct Bitmap* bmp, int rowWidth, cc_bool partial) {
+static void Gfx_DoMipmaps(int x, int y, struct Bitmap* bmp, int rowWidth, cc_bool partial, GLenum format) {
 	BitmapCol* prev = bmp->scan0;
 	BitmapCol* cur;
+	struct Bitmap mip;
 
 	int lvls = CalcMipmapsLevels(bmp->width, bmp->height);
 	int lvl, width = bmp->width, height = bmp->height;
+	if (GL_GenerateMipmaps(GL_TEXTURE_2D, format)) return;
 
+	/* Each level is stored after the previous level, so prev is never overwritten */
+	cur = GetMipmapsTemp(width, height);
 	for (lvl = 1; lvl <= lvls; lvl++) {
 		x /= 2; y /= 2;
 		if (width > 1)  width /= 2;
 		if (height > 1) height /= 2;
 
-		cur = (BitmapCol*)Mem_Alloc(width * height, BITMAPCOLOR_SIZE, "mipmaps");
 		GenMipmaps(width, height, cur, prev, rowWidth);
 
-		if (partial) {
+		if (format) {
+			/* Levels no longer aligned to 4x4 blocks are left as is by partial updates */
+			Bitmap_Init(mip, width, height, cur);
+			UploadCompressed(format, lvl, x, y, &mip, width, !partial);
+		} else if (partial) {
 			_glTexSubImage2D(GL_TEXTURE_2D, lvl, x, y, width, height, PIXEL_FORMAT, TRANSFER_FORMAT, cur);
 		} else {
 			_glTexImage2D(GL_TEXTURE_2D, lvl, GL_RGBA, width, height, 0, PIXEL_FORMAT, TRANSFER_FORMAT, cur);
 		}
 
-		if (prev != bmp->scan0) Mem_Free(prev);
-		prev    = cur;
+		prev     = cur;
+		cur     += width * height;
 		rowWidth = width;
 	}
-	if (prev != bmp->scan0) Mem_Free(prev);
 }
 
 /* TODO: Use GL_UNPACK_ROW_LENGTH for Desktop OpenGL instead */
@@ -119,6 +560,7 @@ static CC_NOINLINE void UpdateTextureSlow(int x, int y, struct Bitmap* part, int
 }
 
 GfxResourceID Gfx_AllocTexture(struct Bitmap* bmp, int rowWidth, cc_uint8 flags, cc_bool mipmaps) {
+	GLenum format = DXT_ChooseFormat(bmp, rowWidth, flags);
 	GfxResourceID texId = NULL;
 	_glGenTextures(1, (GLuint*)&texId);
 	_glBindTexture(GL_TEXTURE_2D, ptr_to_uint(texId));
@@ -134,30 +576,37 @@ GfxResourceID Gfx_AllocTexture(struct Bitmap* bmp, int rowWidth, cc_uint8 flags,
 		_glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, (flags & TEXTURE_FLAG_BILINEAR) ? GL_LINEAR : GL_NEAREST);
 	}
 
-	if (bmp->width == rowWidth) {
+	if (format) {
+		UploadCompressed(format, 0, 0, 0, bmp, rowWidth, true);
+	} else if (bmp->width == rowWidth) {
 		_glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, bmp->width, bmp->height, 0, PIXEL_FORMAT, TRANSFER_FORMAT, bmp->scan0);
 	} else {
 		UpdateTextureSlow(0, 0, bmp, rowWidth, true);
 	}
 
-	if (mipmaps) Gfx_DoMipmaps(0, 0, bmp, rowWidth, false);
+	if (mipmaps) Gfx_DoMipmaps(0, 0, bmp, rowWidth, false, format);
 	return texId;
 }
 
 void Gfx_UpdateTexture(GfxResourceID texId, int x, int y, struct Bitmap* part, int rowWidth, cc_bool mipmaps) {
+	GLenum format;
 	_glBindTexture(GL_TEXTURE_2D, ptr_to_uint(texId));
+	format = DXT_GetFormat(GL_TEXTURE_2D);
 
-	if (part->width == rowWidth) {
+	if (format) {
+		UploadCompressed(format, 0, x, y, part, rowWidth, false);
+	} else if (part->width == rowWidth) {
 		_glTexSubImage2D(GL_TEXTURE_2D, 0, x, y, part->width, part->height, PIXEL_FORMAT, TRANSFER_FORMAT, part->scan0);
 	} else {
 		UpdateTextureSlow(x, y, part, rowWidth, false);
 	}
 
-	if (mipmaps) Gfx_DoMipmaps(x, y, part, rowWidth, true);
+	if (mipmaps) Gfx_DoMipmaps(x, y, part, rowWidth, true, format);
 }
 
 void Gfx_DeleteTexture(GfxResourceID* texId) {
 	GLuint id = ptr_to_uint(*texId);
+	MemStats_Untrack(MEMSTATS_TEXTURE, *texId);
 	if (id) _glDeleteTextures(1, &id);
 	*texId = 0;
 }
@@ -265,6 +714,157 @@ cc_result Gfx_TakeScreenshot(struct Stream* output) {
 	return res;
 }
 
+#ifdef CC_GFX_SCREENSHOT_READBACK
+/* Flips rows into top to bottom order, as OpenGL stores bitmaps in bottom-up order */
+static void GL_FlipRows(struct Bitmap* bmp) {
+	BitmapCol* top;
+	BitmapCol* bottom;
+	BitmapCol tmp;
+	int x, y;
+
+	for (y = 0; y < bmp->height / 2; y++) 
+	{
+		top    = Bitmap_GetRow(bmp, y);
+		bottom = Bitmap_GetRow(bmp, (bmp->height - 1) - y);
+
+		for (x = 0; x < bmp->width; x++) 
+		{
+			tmp = top[x]; top[x] = bottom[x]; bottom[x] = tmp;
+		}
+	}
+}
+
+#if CC_GFX_BACKEND == CC_GFX_BACKEND_GL2
+#define _GL_PIXEL_PACK_BUFFER 0x88EB
+#define _GL_STREAM_READ       0x88E1
+#define _GL_READ_ONLY         0x88B8
+#define _GL_MAP_READ_BIT      0x0001
+
+static void*     (APIENTRY *_glMapBuffer)(GLenum target, GLenum access);
+static void*     (APIENTRY *_glMapBufferRange)(GLenum target, cc_uintptr offset, cc_uintptr length, GLuint access);
+static GLboolean (APIENTRY *_glUnmapBuffer)(GLenum target);
+static cc_bool readback_checked, readback_waited;
+static GLuint readback_pbo;
+static Gfx_ReadbackCallback readback_callback;
+static struct Bitmap readback_bmp;
+
+/* Reading into a pixel pack buffer lets glReadPixels return without waiting for the GPU to finish the frame */
+static cc_bool GL_CanReadbackAsync(void) {
+	const GLubyte* ver = glGetString(GL_VERSION);
+#ifdef CC_BUILD_GLES
+	static const struct DynamicLibSym funcs[] = {
+		DynamicLib_ReqSym(glMapBufferRange), DynamicLib_ReqSym(glUnmapBuffer)
+	};
+	/* e.g. "OpenGL ES 3.0 ..." */
+	static const cc_string esVer = String_FromConst("OpenGL ES ");
+	cc_string version = String_FromReadonly((const char*)ver);
+	if (readback_checked) return _glUnmapBuffer != NULL;
+	readback_checked = true;
+
+	/* Supported in core since OpenGL ES 3.0 */
+	if (String_CaselessStarts(&version, &esVer) && version.length > 10 && ver[10] >= '3') {
+		GLContext_GetAll(funcs, Array_Elems(funcs));
+	}
+	if (!_glMapBufferRange) _glUnmapBuffer = NULL;
+#else
+	static const struct DynamicLibSym funcs[] = {
+		DynamicLib_ReqSym(glMapBuffer), DynamicLib_ReqSym(glUnmapBuffer)
+	};
+	static const cc_string pboExt = String_FromConst("GL_ARB_pixel_buffer_object");
+	cc_string extensions = String_FromReadonly((const char*)glGetString(GL_EXTENSIONS));
+	if (readback_checked) return _glUnmapBuffer != NULL;
+	readback_checked = true;
+
+	/* Supported in core since 2.1 */
+	if (ver[0] > '2' || (ver[0] == '2' && ver[2] >= '1') || String_CaselessContains(&extensions, &pboExt)) {
+		GLContext_GetAll(funcs, Array_Elems(funcs));
+	}
+	if (!_glMapBuffer) _glUnmapBuffer = NULL;
+#endif
+	return _glUnmapBuffer != NULL;
+}
+
+static void GL_FinishReadback(void) {
+	Gfx_ReadbackCallback callback = readback_callback;
+	struct Bitmap bmp = readback_bmp;
+	cc_uint32 size    = bmp.width * bmp.height * BITMAPCOLOR_SIZE;
+	cc_result res     = 0;
+	void* src;
+	readback_callback = NULL;
+
+	glBindBuffer(_GL_PIXEL_PACK_BUFFER, readback_pbo);
+#ifdef CC_BUILD_GLES
+	src = _glMapBufferRange(_GL_PIXEL_PACK_BUFFER, 0, size, _GL_MAP_READ_BIT);
+#else
+	src = _glMapBuffer(_GL_PIXEL_PACK_BUFFER, _GL_READ_ONLY);
+#endif
+	bmp.scan0 = (BitmapCol*)Mem_TryAlloc(bmp.width * bmp.height, BITMAPCOLOR_SIZE);
+
+	if (!bmp.scan0) {
+		res = ERR_OUT_OF_MEMORY;
+	} else if (!src) {
+		res = ERR_NOT_SUPPORTED;
+	} else {
+		Mem_Copy(bmp.scan0, src, size);
+		GL_FlipRows(&bmp);
+	}
+
+	if (src) _glUnmapBuffer(_GL_PIXEL_PACK_BUFFER);
+	glBindBuffer(_GL_PIXEL_PACK_BUFFER, 0);
+	glDeleteBuffers(1, &readback_pbo);
+	readback_pbo = 0;
+	callback(&bmp, res);
+}
+
+static void GL_TickReadback(void) {
+	if (!readback_callback) return;
+
+	/* Give the GPU a whole frame to finish copying, so mapping the buffer doesn't stall */
+	if (readback_waited) {
+		GL_FinishReadback();
+	} else {
+		readback_waited = true;
+	}
+}
+#else
+static void GL_TickReadback(void) { }
+#endif
+
+void Gfx_ReadbackScreenshot(Gfx_ReadbackCallback callback) {
+	struct Bitmap bmp;
+	GLint vp[4];
+	
+	_glGetIntegerv(GL_VIEWPORT, vp); /* { x, y, width, height } */
+	bmp.width  = vp[2]; 
+	bmp.height = vp[3];
+
+#if CC_GFX_BACKEND == CC_GFX_BACKEND_GL2
+	/* Only one readback can be in progress at a time */
+	if (readback_callback) GL_FinishReadback();
+
+	if (GL_CanReadbackAsync()) {
+		glGenBuffers(1, &readback_pbo);
+		glBindBuffer(_GL_PIXEL_PACK_BUFFER, readback_pbo);
+		glBufferData(_GL_PIXEL_PACK_BUFFER, bmp.width * bmp.height * BITMAPCOLOR_SIZE, NULL, _GL_STREAM_READ);
+		_glReadPixels(0, 0, bmp.width, bmp.height, PIXEL_FORMAT, TRANSFER_FORMAT, NULL);
+		glBindBuffer(_GL_PIXEL_PACK_BUFFER, 0);
+
+		readback_bmp      = bmp;
+		readback_waited   = false;
+		readback_callback = callback;
+		return;
+	}
+#endif
+
+	bmp.scan0 = (BitmapCol*)Mem_TryAlloc(bmp.width * bmp.height, BITMAPCOLOR_SIZE);
+	if (!bmp.scan0) { callback(&bmp, ERR_OUT_OF_MEMORY); return; }
+
+	_glReadPixels(0, 0, bmp.width, bmp.height, PIXEL_FORMAT, TRANSFER_FORMAT, bmp.scan0);
+	GL_FlipRows(&bmp);
+	callback(&bmp, 0);
+}
+#endif
+
 static void AppendVRAMStats(cc_string* info) {
 	static const cc_string memExt = String_FromConst("GL_NVX_gpu_memory_info");
 	GLint totalKb, curKb;
@@ -322,6 +922,9 @@ void Gfx_EndFrame(void) {
 	} else {
 		EndReducedPerformance();
 	}
+#endif
+#ifdef CC_GFX_SCREENSHOT_READBACK
+	GL_TickReadback();
 #endif
 	/* TODO always run ?? */
 
@@ -1,3 +1,8 @@
+#include "Bitmap.h"
+#if defined CC_BUILD_SSE2 && !defined BITMAP_16BPP
+	#include <emmintrin.h>
+	#define MIPMAPS_SSE2
+#endif
 #include "Graphics.h"
 #include "String.h"
 #include "Platform.h"
@@ -7,7 +12,6 @@
 #include "Event.h"
 #include "Block.h"
 #include "Options.h"
-#include "Bitmap.h"
 #include "Chat.h"
 #include "Logger.h"
 
@@ -15,12 +19,19 @@ struct _GfxData Gfx;
 static GfxResourceID Gfx_quadVb, Gfx_texVb;
 const cc_string Gfx_LowPerfMessage = String_FromConst("&eRunning in reduced performance mode (game minimised or hidden)");
 
-static const int strideSizes[] = { SIZEOF_VERTEX_COLOURED, SIZEOF_VERTEX_TEXTURED };
+static const int strideSizes[] = { SIZEOF_VERTEX_COLOURED, SIZEOF_VERTEX_TEXTURED, SIZEOF_VERTEX_CHUNK };
 /* Whether mipmaps must be created for all dimensions down to 1x1 or not */
 static cc_bool customMipmapsLevels;
 /* Current format and size of vertices */
 static int gfx_stride, gfx_format = -1;
 
+/* Only these backends untrack resources when they are deleted */
+#if CC_GFX_BACKEND_IS_GL() || (CC_GFX_BACKEND == CC_GFX_BACKEND_D3D9) || (CC_GFX_BACKEND == CC_GFX_BACKEND_D3D11)
+	#define Gfx_TrackMemory(kind, res, size, place) MemStats_Track(kind, res, size, place)
+#else
+	#define Gfx_TrackMemory(kind, res, size, place)
+#endif
+
 static cc_bool gfx_vsync, gfx_fogEnabled;
 static cc_bool gfx_rendering2D;
 
@@ -31,10 +42,18 @@ static cc_bool gfx_rendering2D;
 static cc_bool gfx_colorMask[4] = { true, true, true, true };
 cc_bool Gfx_GetFog(void) { return gfx_fogEnabled; }
 static cc_bool gfx_alphaTest, gfx_alphaBlend;
+struct GfxStateCounts Gfx_StateCounts;
+
+/* Returns whether a state change needs to be passed on to the backend, */
+/*  counting how many redundant state changes were skipped */
+static CC_INLINE cc_bool StateChanged(cc_bool changed) {
+	if (changed) { Gfx_StateCounts.applied++; } else { Gfx_StateCounts.skipped++; }
+	return changed;
+}
 
 static void SetAlphaTest(cc_bool enabled);
 void Gfx_SetAlphaTest(cc_bool enabled) {
-	if (gfx_alphaTest == enabled) return;
+	if (!StateChanged(gfx_alphaTest != enabled)) return;
 	
 	gfx_alphaTest = enabled;
 	SetAlphaTest(enabled);
@@ -42,12 +61,27 @@ void Gfx_SetAlphaTest(cc_bool enabled) {
 
 static void SetAlphaBlend(cc_bool enabled);
 void Gfx_SetAlphaBlending(cc_bool enabled) {
-	if (gfx_alphaBlend == enabled) return;
+	if (!StateChanged(gfx_alphaBlend != enabled)) return;
 	
 	gfx_alphaBlend = enabled;
 	SetAlphaBlend(enabled);
 }
 
+static void SetFog(cc_bool enabled);
+void Gfx_SetFog(cc_bool enabled) {
+	if (!StateChanged(gfx_fogEnabled != enabled)) return;
+
+	gfx_fogEnabled = enabled;
+	SetFog(enabled);
+}
+
+/* NOTE: Backends must update gfx_format and gfx_stride */
+static void SetVertexFormat(VertexFormat fmt);
+void Gfx_SetVertexFormat(VertexFormat fmt) {
+	if (!StateChanged(gfx_format != fmt)) return;
+	SetVertexFormat(fmt);
+}
+
 /* Initialises/Restores render state */
 CC_NOINLINE static void Gfx_RestoreState(void);
 /* Destroys render state, but can be restored later */
@@ -127,8 +161,8 @@ static void RecreateDynamicVb(GfxResourceID* vb, VertexFormat fmt, int maxVertic
 static void InitDefaultResources(void) {
 	Gfx.DefaultIb = Gfx_CreateIb2(GFX_MAX_INDICES, MakeIndices, NULL);
 
-	RecreateDynamicVb(&Gfx_quadVb, VERTEX_FORMAT_COLOURED, 4);
-	RecreateDynamicVb(&Gfx_texVb,  VERTEX_FORMAT_TEXTURED, 4);
+	RecreateDynamicVb(&Gfx_quadVb, VERTEX_FORMAT_COLOURED, GFX_2D_BATCH_QUADS * 4);
+	RecreateDynamicVb(&Gfx_texVb,  VERTEX_FORMAT_TEXTURED, GFX_2D_BATCH_QUADS * 4);
 }
 
 static void FreeDefaultResources(void) {
@@ -175,34 +209,83 @@ static CC_INLINE void EndReducedPerformance(void) {
 *--------------------------------------------------------2D drawing-------------------------------------------------------*
 *#########################################################################################################################*/
 #ifndef CC_BUILD_3DS
-void Gfx_Draw2DFlat(int x, int y, int width, int height, PackedCol color) {
-	struct VertexColoured* v;
+static struct VertexColoured batch2D_colVertices[GFX_2D_BATCH_QUADS * 4];
+static struct VertexTextured batch2D_texVertices[GFX_2D_BATCH_QUADS * 4];
+static GfxResourceID batch2D_texID;
+static VertexFormat batch2D_format;
+static int batch2D_count, batch2D_depth;
+
+static void Flush2DBatch(void) {
+	GfxResourceID vb = batch2D_format == VERTEX_FORMAT_TEXTURED ? Gfx_texVb : Gfx_quadVb;
+	void* src        = batch2D_format == VERTEX_FORMAT_TEXTURED ? (void*)batch2D_texVertices : (void*)batch2D_colVertices;
+	int count = batch2D_count * 4;
+	void* dst;
+	if (!batch2D_count) return;
+
+	if (batch2D_format == VERTEX_FORMAT_TEXTURED) Gfx_BindTexture(batch2D_texID);
+	Gfx_SetVertexFormat(batch2D_format);
+
+	dst = Gfx_LockDynamicVb(vb, batch2D_format, count);
+	Mem_Copy(dst, src, count * strideSizes[batch2D_format]);
+	Gfx_UnlockDynamicVb(vb);
+	Gfx_DrawVb_IndexedTris(count);
+	batch2D_count = 0;
+}
+
+/* Returns storage for the 4 vertices of another quad in the current batch */
+/* Quads are drawn in the same order they are added, so the batch is flushed when the format or texture changes */
+static void* Add2DBatchQuad(VertexFormat fmt, GfxResourceID texID) {
+	if (batch2D_format != fmt || batch2D_texID != texID || batch2D_count == GFX_2D_BATCH_QUADS) {
+		Flush2DBatch();
+	}
+	batch2D_format = fmt;
+	batch2D_texID  = texID;
+
+	if (fmt == VERTEX_FORMAT_TEXTURED) return &batch2D_texVertices[batch2D_count++ * 4];
+	return &batch2D_colVertices[batch2D_count++ * 4];
+}
+
+void Gfx_Begin2DBatch(void) { batch2D_depth++; }
+
+void Gfx_End2DBatch(void) {
+	if (!batch2D_depth || --batch2D_depth) return;
+	Flush2DBatch();
+}
+
+static struct VertexColoured* Lock2DColoured(void) {
+	if (batch2D_depth) return (struct VertexColoured*)Add2DBatchQuad(VERTEX_FORMAT_COLOURED, 0);
 
 	Gfx_SetVertexFormat(VERTEX_FORMAT_COLOURED);
-	v = (struct VertexColoured*)Gfx_LockDynamicVb(Gfx_quadVb, VERTEX_FORMAT_COLOURED, 4);
+	return (struct VertexColoured*)Gfx_LockDynamicVb(Gfx_quadVb, VERTEX_FORMAT_COLOURED, 4);
+}
+
+static void Draw2DColoured(void) {
+	if (batch2D_depth) return;
+
+	Gfx_UnlockDynamicVb(Gfx_quadVb);
+	Gfx_DrawVb_IndexedTris(4);
+}
+
+void Gfx_Draw2DFlat(int x, int y, int width, int height, PackedCol color) {
+	struct VertexColoured* v = Lock2DColoured();
 
 	v->x = (float)x;           v->y = (float)y;            v->z = 0; v->Col = color; v++;
 	v->x = (float)(x + width); v->y = (float)y;            v->z = 0; v->Col = color; v++;
 	v->x = (float)(x + width); v->y = (float)(y + height); v->z = 0; v->Col = color; v++;
 	v->x = (float)x;           v->y = (float)(y + height); v->z = 0; v->Col = color; v++;
 
-	Gfx_UnlockDynamicVb(Gfx_quadVb);
-	Gfx_DrawVb_IndexedTris(4);
+	Draw2DColoured();
 }
 
 void Gfx_Draw2DGradient(int x, int y, int width, int height, PackedCol top, PackedCol bottom) {
-	struct VertexColoured* v;
-
-	Gfx_SetVertexFormat(VERTEX_FORMAT_COLOURED);
-	v = (struct VertexColoured*)Gfx_LockDynamicVb(Gfx_quadVb, VERTEX_FORMAT_COLOURED, 4);
+	struct VertexColoured* v = Lock2DColoured();
 
 	v->x = (float)x;           v->y = (float)y;            v->z = 0; v->Col = top; v++;
 	v->x = (float)(x + width); v->y = (float)y;            v->z = 0; v->Col = top; v++;
 	v->x = (float)(x + width); v->y = (float)(y + height); v->z = 0; v->Col = bottom; v++;
 	v->x = (float)x;           v->y = (float)(y + height); v->z = 0; v->Col = bottom; v++;
 
-	Gfx_UnlockDynamicVb(Gfx_quadVb);
-	Gfx_DrawVb_IndexedTris(4);
+	Draw2DColoured();
 }
 
 void Gfx_Draw2DTexture(const struct Texture* tex, PackedCol color) {
@@ -216,6 +299,20 @@ void Gfx_Draw2DTexture(const struct Texture* tex, PackedCol color) {
 	Gfx_UnlockDynamicVb(Gfx_texVb);
 	Gfx_DrawVb_IndexedTris(4);
 }
+
+static cc_bool Batch2DTexture(const struct Texture* tex, PackedCol color) {
+	struct VertexTextured* v;
+	if (!batch2D_depth) return false;
+
+	v = (struct VertexTextured*)Add2DBatchQuad(VERTEX_FORMAT_TEXTURED, tex->ID);
+	Gfx_Make2DQuad(tex, color, &v);
+	return true;
+}
+#else
+/* Batching is not implemented for the custom 2D drawing of the 3DS backend */
+void Gfx_Begin2DBatch(void) { }
+void Gfx_End2DBatch(void)   { }
+#define Batch2DTexture(tex, color) false
 #endif
 
 void Gfx_Make2DQuad(const struct Texture* tex, PackedCol color, struct VertexTextured** vertices) {
@@ -365,9 +462,53 @@ static BitmapCol AverageColor(BitmapCol p1, BitmapCol p2) {
 		aSum >> 1);
 }
 
+#ifdef MIPMAPS_SSE2
+#define MIPMAPS_A_LANE (BITMAPCOLOR_A_SHIFT / 8)
+#define MIPMAPS_A_SPLAT(v) _mm_shuffle_ps(v, v, _MM_SHUFFLE(MIPMAPS_A_LANE, MIPMAPS_A_LANE, MIPMAPS_A_LANE, MIPMAPS_A_LANE))
+
+/* Same filtering as AverageColor on 2x2 pixels, but with all 4 components of a pixel computed at once */
+static void GenMipmapsRow(int width, BitmapCol* dst, BitmapCol* src0, BitmapCol* src1) {
+	const __m128i zero  = _mm_setzero_si128();
+	const __m128  one   = _mm_set1_ps(1.0f);
+	const __m128  quart = _mm_set1_ps(0.25f);
+	const __m128  aMask = _mm_castsi128_ps(_mm_slli_si128(_mm_cvtsi32_si128(-1), MIPMAPS_A_LANE * 4));
+	__m128i row0, row1, res;
+	__m128 p0, p1, p2, p3, a0, a1, a2, a3;
+	__m128 sum, aSum;
+	int x;
+
+	for (x = 0; x < width; x++) {
+		row0 = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(src0 + (x << 1))), zero);
+		row1 = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(src1 + (x << 1))), zero);
+
+		p0 = _mm_cvtepi32_ps(_mm_unpacklo_epi16(row0, zero));
+		p1 = _mm_cvtepi32_ps(_mm_unpackhi_epi16(row0, zero));
+		p2 = _mm_cvtepi32_ps(_mm_unpacklo_epi16(row1, zero));
+		p3 = _mm_cvtepi32_ps(_mm_unpackhi_epi16(row1, zero));
+		a0 = MIPMAPS_A_SPLAT(p0); a1 = MIPMAPS_A_SPLAT(p1);
+		a2 = MIPMAPS_A_SPLAT(p2); a3 = MIPMAPS_A_SPLAT(p3);
+
+		/* Average of pre-multiplied RGB, converted back to normal form */
+		sum  = _mm_add_ps(_mm_add_ps(_mm_mul_ps(p0, a0), _mm_mul_ps(p1, a1)),
+						  _mm_add_ps(_mm_mul_ps(p2, a2), _mm_mul_ps(p3, a3)));
+		aSum = _mm_add_ps(_mm_add_ps(a0, a1), _mm_add_ps(a2, a3));
+		sum  = _mm_div_ps(sum, _mm_max_ps(aSum, one));
+
+		/* Alpha is just the average of the alphas */
+		sum = _mm_or_ps(_mm_andnot_ps(aMask, sum), _mm_and_ps(aMask, _mm_mul_ps(aSum, quart)));
+		res = _mm_cvttps_epi32(sum);
+		res = _mm_packus_epi16(_mm_packs_epi32(res, zero), zero);
+		dst[x] = (BitmapCol)_mm_cvtsi128_si32(res);
+	}
+}
+#endif
+
 /* Generates the next mipmaps level bitmap by downsampling from the given bitmap. */
 static void GenMipmaps(int width, int height, BitmapCol* dst, BitmapCol* src, int srcWidth) {
-	int x, y;
+	int y;
+#ifndef MIPMAPS_SSE2
+	int x;
+#endif
 	/* Downsampling from a 1 pixel wide bitmap requires simpler filtering */
 	if (srcWidth == 1) {
 		for (y = 0; y < height; y++) {
@@ -384,6 +525,9 @@ static void GenMipmaps(int width, int height, BitmapCol* dst, BitmapCol* src, in
 		BitmapCol* src0 = src;
 		BitmapCol* src1 = src + srcWidth;
 
+#ifdef MIPMAPS_SSE2
+		GenMipmapsRow(width, dst, src0, src1);
+#else
 		for (x = 0; x < width; x++) {
 			int srcX = (x << 1);
 			/* 2x2 bilinear filter */
@@ -391,6 +535,7 @@ static void GenMipmaps(int width, int height, BitmapCol* dst, BitmapCol* src, in
 			BitmapCol ave1 = AverageColor(src1[srcX], src1[srcX + 1]);
 			dst[x] = AverageColor(ave0, ave1);
 		}
+#endif
 		src += (srcWidth << 1);
 		dst += width;
 	}
@@ -428,6 +573,7 @@ GfxResourceID Gfx_CreateTexture(struct Bitmap* bmp, cc_uint8 flags, cc_bool mipm
 }
 
 GfxResourceID Gfx_CreateTexture2(struct Bitmap* bmp, int rowWidth, cc_uint8 flags, cc_bool mipmaps) {
+	GfxResourceID tex;
 	if (Gfx.SupportsNonPowTwoTextures && (flags & TEXTURE_FLAG_NONPOW2)) {
 		/* Texture is being deliberately created and can be successfully created */
 		/* with non power of two dimensions. Typically used for UI textures */
@@ -438,15 +584,20 @@ GfxResourceID Gfx_CreateTexture2(struct Bitmap* bmp, int rowWidth, cc_uint8 flag
 	if (Gfx.LostContext) return 0;
 	if (!Gfx_CheckTextureSize(bmp->width, bmp->height, flags)) return 0;
 
-	return Gfx_AllocTexture(bmp, rowWidth, flags, mipmaps);
+	tex = Gfx_AllocTexture(bmp, rowWidth, flags, mipmaps);
+	/* Estimated as 32 bits per pixel, with mipmaps using up to another third on top of that */
+	Gfx_TrackMemory(MEMSTATS_TEXTURE, tex, bmp->width * bmp->height * (mipmaps ? 16 : 12) / 3, "GPU textures");
+	return tex;
 }
 
 void Texture_Render(const struct Texture* tex) {
+	if (Batch2DTexture(tex, PACKEDCOL_WHITE)) return;
 	Gfx_BindTexture(tex->ID);
 	Gfx_Draw2DTexture(tex, PACKEDCOL_WHITE);
 }
 
 void Texture_RenderShaded(const struct Texture* tex, PackedCol shadeColor) {
+	if (Batch2DTexture(tex, shadeColor)) return;
 	Gfx_BindTexture(tex->ID);
 	Gfx_Draw2DTexture(tex, shadeColor);
 }
@@ -470,7 +621,10 @@ GfxResourceID Gfx_CreateVb(VertexFormat fmt, int count) {
 
 	for (;;)
 	{
-		if ((vb = Gfx_AllocStaticVb(fmt, count))) return vb;
+		if ((vb = Gfx_AllocStaticVb(fmt, count))) {
+			Gfx_TrackMemory(MEMSTATS_VERTEXBUFFER, vb, count * strideSizes[fmt], "GPU vertex buffers");
+			return vb;
+		}
 
 		if (!Game_ReduceVRAM()) Process_Abort("Out of video memory! (allocating static VB)");
 	}
@@ -482,7 +636,10 @@ GfxResourceID Gfx_CreateDynamicVb(VertexFormat fmt, int maxVertices) {
 
 	for (;;)
 	{
-		if ((vb = Gfx_AllocDynamicVb(fmt, maxVertices))) return vb;
+		if ((vb = Gfx_AllocDynamicVb(fmt, maxVertices))) {
+			Gfx_TrackMemory(MEMSTATS_VERTEXBUFFER, vb, maxVertices * strideSizes[fmt], "GPU dynamic vertex buffers");
+			return vb;
+		}
 
 		if (!Game_ReduceVRAM()) Process_Abort("Out of video memory! (allocating dynamic VB)");
 	}
@@ -498,6 +655,30 @@ void Gfx_SetDynamicVbData(GfxResourceID vb, void* vertices, int vCount) {
 }
 #endif
 
+#if CC_GFX_BACKEND == CC_GFX_BACKEND_GL2
+/* Texture arrays, model parts and billboards are only implemented in the modern OpenGL backend */
+#else
+GfxResourceID Gfx_CreateTextureArray(int width, int height, int layers, cc_uint8 flags, cc_bool mipmaps) { return 0; }
+void Gfx_UpdateTextureLayer(GfxResourceID texId, int layer, int x, int y, struct Bitmap* part, int rowWidth, cc_bool mipmaps) { }
+void Gfx_BindTextureArray(GfxResourceID texId) { }
+void Gfx_SetLayerOffsets(int first, const float* offsets, int count) { }
+void Gfx_SetChunkLightColors(PackedCol sun, PackedCol shadow) { }
+
+void Gfx_SetModelParts(const struct Matrix* parts, int count, const PackedCol* faceCols, 
+						float uScale, float vScale, float uOffset, float vOffset) { }
+void Gfx_DisableModelParts(void) { }
+void Gfx_DrawBillboards(const struct GfxBillboard* items, int count) { }
+#endif
+
+#if CC_GFX_BACKEND_IS_GL() || (CC_GFX_BACKEND == CC_GFX_BACKEND_D3D11)
+/* GPU timestamps are only implemented in the OpenGL and Direct3D11 backends */
+#else
+void Gfx_BeginTimestamps(void) { }
+void Gfx_RecordTimestamp(int slot) { }
+void Gfx_EndTimestamps(void) { }
+int  Gfx_ReadTimestamps(float* times, int maxCount) { return 0; }
+#endif
+
 
 /*########################################################################################################################*
 *----------------------------------------------------Graphics component---------------------------------------------------*
@@ -510,6 +691,7 @@ static void OnInit(void) {
 	Event_Register_(&GfxEvents.ContextRecreated, NULL, OnContextRecreated);
 
 	Gfx.Mipmaps = Options_GetBool(OPT_MIPMAPS, false);
+	Gfx.CompressTextures = Options_GetBool(OPT_COMPRESSED_TEXTURES, false);
 	if (Gfx.LostContext) return;
 	OnContextRecreated(NULL);
 }
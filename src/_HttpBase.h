@@ -22,6 +22,36 @@ void HttpRequest_Free(struct HttpRequest* request) {
 }
 #define HttpRequest_Copy(dst, src) Mem_Copy(dst, src, sizeof(struct HttpRequest))
 
+/* Whether response contents should be written to the sink, instead of kept in data */
+#define Http_IsStreaming(req) ((req)->sink && (req)->statusCode == 200)
+
+/* Writes the response contents received so far to the sink, then discards them */
+static void Http_FlushSink(struct HttpRequest* req) {
+	if (!req->size) return;
+	/* After an error, just discard the rest of the response */
+	if (!req->_sinkResult) req->_sinkResult = Stream_Write(req->sink, req->data, req->size);
+
+	req->_streamed += req->size;
+	req->size       = 0;
+}
+
+static void Http_CloseSink(struct HttpRequest* req) {
+	cc_result res;
+	if (!req->sink) return;
+
+	res = req->sink->Close(req->sink);
+	if (!req->_sinkResult) req->_sinkResult = res;
+
+	Mem_Free(req->sink);
+	req->sink = NULL;
+}
+
+/* Closes the sinks of requests which will now never be processed */
+static void Http_CloseAllSinks(struct HttpRequest* reqs, int count) {
+	int i;
+	for (i = 0; i < count; i++) Http_CloseSink(&reqs[i]);
+}
+
 /*########################################################################################################################*
 *----------------------------------------------------Http requests list---------------------------------------------------*
 *#########################################################################################################################*/
@@ -44,22 +74,17 @@ static void RequestList_EnsureSpace(struct RequestList* list) {
 				sizeof(struct HttpRequest), HTTP_DEF_ELEMS, 10);
 }
 
-/* Adds a request to the list */
-static void RequestList_Append(struct RequestList* list, struct HttpRequest* item, cc_uint8 flags) {
+enum HttpPriority { HTTP_PRIORITY_LOW, HTTP_PRIORITY_NORMAL, HTTP_PRIORITY_HIGH };
+
+/* Adds a request to the list, after all requests with the same or higher priority */
+static void RequestList_Append(struct RequestList* list, struct HttpRequest* item) {
 	int i;
 	RequestList_EnsureSpace(list);
 
-	if (flags & HTTP_FLAG_PRIORITY) {
-		/* Shift all requests right one place */
-		for (i = list->count; i > 0; i--) 
-		{
-			HttpRequest_Copy(&list->entries[i], &list->entries[i - 1]);
-		}
-		/* Insert new request at front/start */
-		i = 0;
-	} else {
-		/* Insert new request at end */
-		i = list->count;
+	/* Shift lower priority requests right one place */
+	for (i = list->count; i > 0 && list->entries[i - 1].priority < item->priority; i--)
+	{
+		HttpRequest_Copy(&list->entries[i], &list->entries[i - 1]);
 	}
 
 	HttpRequest_Copy(&list->entries[i], item);
@@ -92,6 +117,7 @@ static void RequestList_TryFree(struct RequestList* list, int id) {
 	int i = RequestList_Find(list, id);
 	if (i < 0) return;
 
+	Http_CloseSink(&list->entries[i]);
 	HttpRequest_Free(&list->entries[i]);
 	RequestList_RemoveAt(list, i);
 }
@@ -116,11 +142,39 @@ static void RequestList_Free(struct RequestList* list) {
 static void* processedMutex;
 static struct RequestList processedReqs;
 static int nextReqID;
+
+/* Number of processed requests whose ID maps to each slot, so that polling a request which */
+/*  hasn't finished yet can almost always return without locking or searching processedReqs */
+/* NOTE: Only modified with processedMutex locked, but may be read without locking it */
+#define HTTP_PROCESSED_SLOTS 256
+static volatile int processedSlots[HTTP_PROCESSED_SLOTS];
+#define Http_ProcessedSlot(id) processedSlots[(id) & (HTTP_PROCESSED_SLOTS - 1)]
+
+/* Returns whether a request with the given ID might have been processed */
+#define Http_MaybeProcessed(id) (Http_ProcessedSlot(id) > 0)
+
+/* Removes the processed request at the given index */
+/* NOTE: processedMutex must be locked */
+static void Http_RemoveProcessed(int i) {
+	Http_ProcessedSlot(processedReqs.entries[i].id)--;
+	RequestList_RemoveAt(&processedReqs, i);
+}
+
+/* Tries to remove and free the given processed request */
+/* NOTE: processedMutex must be locked */
+static void Http_TryFreeProcessed(int id) {
+	int i = RequestList_Find(&processedReqs, id);
+	if (i < 0) return;
+
+	Http_CloseSink(&processedReqs.entries[i]);
+	HttpRequest_Free(&processedReqs.entries[i]);
+	Http_RemoveProcessed(i);
+}
 static void HttpBackend_Add(struct HttpRequest* req, cc_uint8 flags);
 
 /* Adds a req to the list of pending requests, waking up worker thread if needed. */
 static int Http_Add(const cc_string* url, cc_uint8 flags, cc_uint8 type, const cc_string* lastModified,
-					const cc_string* etag, const void* data, cc_uint32 size, struct StringsBuffer* cookies) {
+					const cc_string* etag, const void* data, cc_uint32 size, struct StringsBuffer* cookies, struct Stream* sink) {
 	static const cc_string https = String_FromConst("https://");
 	static const cc_string http  = String_FromConst("http://");
 	struct HttpRequest req = { 0 };
@@ -131,6 +185,14 @@ static int Http_Add(const cc_string* url, cc_uint8 flags, cc_uint8 type, const c
 	req.id = ++nextReqID;
 	req.requestType = type;
 
+	if (flags & HTTP_FLAG_PRIORITY) {
+		req.priority = HTTP_PRIORITY_HIGH;
+	} else if (flags & HTTP_FLAG_LOW_PRIORITY) {
+		req.priority = HTTP_PRIORITY_LOW;
+	} else {
+		req.priority = HTTP_PRIORITY_NORMAL;
+	}
+
 	/* Change http:// to https:// if required */
 	if (httpsOnly) {
 		cc_string url_ = String_FromRawArray(req.url);
@@ -154,6 +216,10 @@ static int Http_Add(const cc_string* url, cc_uint8 flags, cc_uint8 type, const c
 		Mem_Copy(req.data, data, size);
 		req.size = size;
 	}
+	if (sink) {
+		req.sink = (struct Stream*)Mem_Alloc(1, sizeof(struct Stream), "Http sink");
+		*req.sink = *sink;
+	}
 	req.cookies  = cookies;
 	req.progress = HTTP_PROGRESS_NOT_WORKING_ON;
 
@@ -186,7 +252,23 @@ static void Http_GetUrl(struct HttpRequest* req, cc_string* dst) {
 
 /* Updates state after a completed http request */
 static void Http_FinishRequest(struct HttpRequest* req) {
-	req->success = !req->result && req->statusCode == 200 && req->data && req->size;
+	cc_bool streamed = req->sink != NULL;
+
+	if (streamed) {
+		/* Some backends only provide the response contents once the request has finished */
+		if (Http_IsStreaming(req)) Http_FlushSink(req);
+		Http_CloseSink(req);
+		if (!req->result) req->result = req->_sinkResult;
+
+		req->success = !req->result && req->statusCode == 200 && req->_streamed;
+		if (req->success) {
+			Mem_Free(req->data);
+			req->data = NULL;
+			req->size = req->_streamed;
+		}
+	} else {
+		req->success = !req->result && req->statusCode == 200 && req->data && req->size;
+	}
 
 	if (!req->success) {
 		char* error = req->error; req->error = NULL;
@@ -198,7 +280,8 @@ static void Http_FinishRequest(struct HttpRequest* req) {
 	Mutex_Lock(processedMutex);
 	{
 		req->timeDownloaded = Stopwatch_Measure();
-		RequestList_Append(&processedReqs, req, false);
+		RequestList_Append(&processedReqs, req);
+		Http_ProcessedSlot(req->id)++;
 	}
 	Mutex_Unlock(processedMutex);
 }
@@ -218,7 +301,7 @@ static void Http_CleanCacheTask(struct ScheduledTask* task) {
 
 			Platform_Log1("Cleaning up forgotten download for %c", item->url);
 			HttpRequest_Free(item);
-			RequestList_RemoveAt(&processedReqs, i);
+			Http_RemoveProcessed(i);
 		}
 	}
 	Mutex_Unlock(processedMutex);
@@ -241,16 +324,19 @@ int Http_AsyncGetSkin(const cc_string* skinName, cc_uint8 flags) {
 }
 
 int Http_AsyncGetData(const cc_string* url, cc_uint8 flags) {
-	return Http_Add(url, flags, REQUEST_TYPE_GET, NULL, NULL, NULL, 0, NULL);
+	return Http_Add(url, flags, REQUEST_TYPE_GET, NULL, NULL, NULL, 0, NULL, NULL);
 }
 int Http_AsyncGetHeaders(const cc_string* url, cc_uint8 flags) {
-	return Http_Add(url, flags, REQUEST_TYPE_HEAD, NULL, NULL, NULL, 0, NULL);
+	return Http_Add(url, flags, REQUEST_TYPE_HEAD, NULL, NULL, NULL, 0, NULL, NULL);
 }
 int Http_AsyncPostData(const cc_string* url, cc_uint8 flags, const void* data, cc_uint32 size, struct StringsBuffer* cookies) {
-	return Http_Add(url, flags, REQUEST_TYPE_POST, NULL, NULL, data, size, cookies);
+	return Http_Add(url, flags, REQUEST_TYPE_POST, NULL, NULL, data, size, cookies, NULL);
 }
 int Http_AsyncGetDataEx(const cc_string* url, cc_uint8 flags, const cc_string* lastModified, const cc_string* etag, struct StringsBuffer* cookies) {
-	return Http_Add(url, flags, REQUEST_TYPE_GET, lastModified, etag, NULL, 0, cookies);
+	return Http_Add(url, flags, REQUEST_TYPE_GET, lastModified, etag, NULL, 0, cookies, NULL);
+}
+int Http_AsyncGetDataToStream(const cc_string* url, cc_uint8 flags, const cc_string* lastModified, const cc_string* etag, struct Stream* sink) {
+	return Http_Add(url, flags, REQUEST_TYPE_GET, lastModified, etag, NULL, 0, NULL, sink);
 }
 
 static cc_bool Http_UrlDirect(cc_uint8 c) {
@@ -3,6 +3,7 @@
 #include "Logger.h"
 #include "Constants.h"
 #include "Errors.h"
+#include "Funcs.h"
 
 /*########################################################################################################################*
 *---------------------------------------------------------Memory----------------------------------------------------------*
@@ -29,18 +30,26 @@ CC_NOINLINE static void AbortOnAllocFailed(const char* place) {
 void* Mem_Alloc(cc_uint32 numElems, cc_uint32 elemsSize, const char* place) {
 	void* ptr = Mem_TryAlloc(numElems, elemsSize);
 	if (!ptr) AbortOnAllocFailed(place);
+
+	MemStats_Track(MEMSTATS_HEAP, ptr, numElems * elemsSize, place);
 	return ptr;
 }
 
 void* Mem_AllocCleared(cc_uint32 numElems, cc_uint32 elemsSize, const char* place) {
 	void* ptr = Mem_TryAllocCleared(numElems, elemsSize);
 	if (!ptr) AbortOnAllocFailed(place);
+
+	MemStats_Track(MEMSTATS_HEAP, ptr, numElems * elemsSize, place);
 	return ptr;
 }
 
 void* Mem_Realloc(void* mem, cc_uint32 numElems, cc_uint32 elemsSize, const char* place) {
-	void* ptr = Mem_TryRealloc(mem, numElems, elemsSize);
+	void* ptr;
+	MemStats_Untrack(MEMSTATS_HEAP, mem);
+	ptr = Mem_TryRealloc(mem, numElems, elemsSize);
 	if (!ptr) AbortOnAllocFailed(place);
+
+	MemStats_Track(MEMSTATS_HEAP, ptr, numElems * elemsSize, place);
 	return ptr;
 }
 
@@ -54,9 +63,492 @@ static CC_NOINLINE cc_uint32 CalcMemSize(cc_uint32 numElems, cc_uint32 elemsSize
 }
 
 
+/*########################################################################################################################*
+*---------------------------------------------------Memory accounting-----------------------------------------------------*
+*#########################################################################################################################*/
+cc_bool MemStats_ShowOverlay;
+#ifdef CC_BUILD_MEMSTATS
+/* Places past this limit are all tallied together in the last place */
+#define MEMSTATS_MAX_PLACES 256
+static struct MemStatsPlace stats_places[MEMSTATS_MAX_PLACES];
+static int stats_placesCount;
+
+/* Open addressing hash table of tracked resources, with NULL keys marking empty slots */
+struct MemStatsEntry { const void* key; cc_uint32 size; cc_uint16 place, kind; };
+static struct MemStatsEntry* stats_entries;
+static int stats_capacity, stats_count;
+
+static void* stats_mutex;
+static cc_bool stats_creatingMutex;
+
+static void MemStats_Lock(void) {
+	/* Creating the mutex allocates memory too, but only the main thread is running at that point */
+	if (!stats_mutex && !stats_creatingMutex) {
+		stats_creatingMutex = true;
+		stats_mutex = Mutex_Create("Memory stats");
+	}
+	if (stats_mutex) Mutex_Lock(stats_mutex);
+}
+
+static void MemStats_Unlock(void) {
+	if (stats_mutex) Mutex_Unlock(stats_mutex);
+}
+
+static int MemStats_FindPlace(const char* name) {
+	const char* a;
+	const char* b;
+	int i;
+
+	for (i = 0; i < stats_placesCount; i++) {
+		/* Literals of the same name may have different addresses in different files */
+		a = stats_places[i].name; b = name;
+		if (a == b) return i;
+
+		for (; *a && *a == *b; a++, b++) { }
+		if (*a == *b) return i;
+	}
+
+	if (i == MEMSTATS_MAX_PLACES - 1) {
+		stats_places[i].name = "(other places)";
+		stats_placesCount = MEMSTATS_MAX_PLACES;
+	} else if (i == MEMSTATS_MAX_PLACES) {
+		return MEMSTATS_MAX_PLACES - 1;
+	} else {
+		stats_places[i].name = name;
+		stats_placesCount++;
+	}
+	return i;
+}
+
+static void MemStats_Adjust(int place, cc_uint32 size, int delta) {
+	struct MemStatsPlace* p = &stats_places[place];
+	if (delta > 0) {
+		p->curBytes += size;
+		p->peakBytes = max(p->peakBytes, p->curBytes);
+	} else {
+		p->curBytes -= size;
+	}
+	p->count += delta;
+}
+
+static int MemStats_Home(int kind, const void* key) {
+	cc_uintptr addr = (cc_uintptr)key;
+	cc_uint32 hash  = ((cc_uint32)addr ^ (cc_uint32)((cc_uint64)addr >> 32) ^ ((cc_uint32)kind << 28)) * 2654435761U;
+	return (int)((hash >> 8) & (stats_capacity - 1));
+}
+
+static int MemStats_Probe(int kind, const void* key) {
+	int mask = stats_capacity - 1;
+	int i    = MemStats_Home(kind, key);
+
+	/* Stops at either the matching entry or an empty slot */
+	for (; stats_entries[i].key; i = (i + 1) & mask) {
+		if (stats_entries[i].key == key && stats_entries[i].kind == kind) break;
+	}
+	return i;
+}
+
+static cc_bool MemStats_Resize(void) {
+	struct MemStatsEntry* entries = stats_entries;
+	struct MemStatsEntry* entry;
+	int i, capacity = stats_capacity;
+
+	entry = (struct MemStatsEntry*)Mem_TryAllocCleared(capacity ? capacity * 2 : 1024, sizeof(struct MemStatsEntry));
+	if (!entry) return false;
+
+	stats_entries  = entry;
+	stats_capacity = capacity ? capacity * 2 : 1024;
+	for (i = 0; i < capacity; i++) {
+		if (!entries[i].key) continue;
+		stats_entries[MemStats_Probe(entries[i].kind, entries[i].key)] = entries[i];
+	}
+	return true;
+}
+
+/* Deletes the entry in the given slot, then shifts back later entries in the same probe sequence */
+static void MemStats_RemoveAt(int i) {
+	int mask = stats_capacity - 1;
+	int j, home;
+	struct MemStatsEntry* cur;
+
+	for (j = (i + 1) & mask; stats_entries[j].key; j = (j + 1) & mask) {
+		cur  = &stats_entries[j];
+		home = MemStats_Home(cur->kind, cur->key);
+		if (((j - home) & mask) < ((j - i) & mask)) continue;
+
+		stats_entries[i] = *cur;
+		i = j;
+	}
+	stats_entries[i].key = NULL;
+	stats_count--;
+}
+
+void MemStats_Track(int kind, const void* key, cc_uint32 size, const char* place) {
+	struct MemStatsEntry* oldEntries = NULL;
+	struct MemStatsEntry* entry;
+	if (!key) return;
+	MemStats_Lock();
+
+	/* Keep the table at most half full, so probe sequences stay short */
+	if ((stats_count + 1) * 2 > stats_capacity) {
+		oldEntries = stats_entries;
+		if (!MemStats_Resize()) { MemStats_Unlock(); return; }
+	}
+	entry = &stats_entries[MemStats_Probe(kind, key)];
+
+	/* Freed without being untracked (e.g. by Mem_TryRealloc), and then the address was reused */
+	if (entry->key) {
+		MemStats_Adjust(entry->place, entry->size, -1);
+	} else {
+		stats_count++;
+	}
+
+	entry->key   = key;
+	entry->size  = size;
+	entry->place = MemStats_FindPlace(place);
+	entry->kind  = kind;
+	MemStats_Adjust(entry->place, size, 1);
+	MemStats_Unlock();
+	/* Mem_Free untracks, so must be called outside the lock */
+	Mem_Free(oldEntries);
+}
+
+void MemStats_Untrack(int kind, const void* key) {
+	struct MemStatsEntry* entry;
+	int i;
+	if (!key || !stats_capacity) return;
+	MemStats_Lock();
+
+	i     = MemStats_Probe(kind, key);
+	entry = &stats_entries[i];
+	if (entry->key) {
+		MemStats_Adjust(entry->place, entry->size, -1);
+		MemStats_RemoveAt(i);
+	}
+	MemStats_Unlock();
+}
+
+/* Untracks every resource of the given kind */
+static void MemStats_UntrackAll(int kind) {
+	struct MemStatsEntry* entry;
+	int i;
+	if (!stats_capacity) return;
+	MemStats_Lock();
+
+	/* Removing shifts later entries back into the slot, hence why it is checked again */
+	for (i = 0; i < stats_capacity; ) {
+		entry = &stats_entries[i];
+		if (entry->key && entry->kind == kind) {
+			MemStats_Adjust(entry->place, entry->size, -1);
+			MemStats_RemoveAt(i);
+		} else {
+			i++;
+		}
+	}
+	MemStats_Unlock();
+}
+
+int MemStats_Get(struct MemStatsPlace* places, int maxPlaces) {
+	struct MemStatsPlace tmp;
+	int i, j, count = 0;
+	MemStats_Lock();
+
+	/* Insertion sort is fine, since there are only a few hundred places at most */
+	for (i = 0; i < stats_placesCount; i++) {
+		tmp = stats_places[i];
+		if (!tmp.peakBytes || !maxPlaces) continue;
+
+		if (count == maxPlaces) {
+			if (places[count - 1].curBytes >= tmp.curBytes) continue;
+			count--; /* Drop the place currently using the least memory */
+		}
+
+		for (j = count; j > 0 && places[j - 1].curBytes < tmp.curBytes; j--) {
+			places[j] = places[j - 1];
+		}
+		places[j] = tmp;
+		count++;
+	}
+	MemStats_Unlock();
+	return count;
+}
+#else
+int MemStats_Get(struct MemStatsPlace* places, int maxPlaces) { return 0; }
+#endif
+
+
+/*########################################################################################################################*
+*--------------------------------------------------------Map arena--------------------------------------------------------*
+*#########################################################################################################################*/
+#define MAP_ARENA_ALIGN 16
+#define MAP_ARENA_MIN_BLOCK (256 * 1024)
+#define MapArena_Align(size) (((size) + (MAP_ARENA_ALIGN - 1)) & ~(MAP_ARENA_ALIGN - 1))
+#define MAP_ARENA_NONE 0xFFFFFFFFUL
+
+/* Allocations are bumped from the end of the current block */
+struct MapArenaBlock { struct MapArenaBlock* prev; cc_uint32 size, used, last; };
+/* Stored just before each allocation, so that Mem_MapFree can reclaim it once it is at the end of the block */
+/* (prev is the offset of the previous allocation in the same block, or MAP_ARENA_NONE) */
+struct MapArenaHeader { cc_uint32 offset, size, prev, freed; };
+#define MAP_ARENA_BLOCK_HEADER  MapArena_Align(sizeof(struct MapArenaBlock))
+#define MAP_ARENA_ALLOC_HEADER  MapArena_Align(sizeof(struct MapArenaHeader))
+#define MapArena_Data(block) ((cc_uint8*)(block) + MAP_ARENA_BLOCK_HEADER)
+#define MapArena_Header(block, offset) ((struct MapArenaHeader*)(MapArena_Data(block) + (offset)))
+
+static struct MapArenaBlock* arena_cur;
+/* Size of the block to allocate for the next map, based on how much the previous map needed */
+static cc_uint32 arena_nextSize;
+/* Bytes currently allocated across all blocks, and the most that has been allocated since the last reset */
+static cc_uint32 arena_used, arena_peak;
+
+static struct MapArenaBlock* MapArena_AddBlock(cc_uint32 size) {
+	struct MapArenaBlock* block;
+	size = max(size, MAP_ARENA_MIN_BLOCK);
+	size = max(size, arena_nextSize);
+
+	block = (struct MapArenaBlock*)Mem_TryAlloc(1, MAP_ARENA_BLOCK_HEADER + size);
+	if (!block) return NULL;
+
+	block->prev = arena_cur;
+	block->size = size;
+	block->used = 0;
+	block->last = MAP_ARENA_NONE;
+	arena_cur      = block;
+	arena_nextSize = 0;
+	return block;
+}
+
+void* Mem_TryMapAlloc(cc_uint32 numElems, cc_uint32 elemsSize) {
+	struct MapArenaBlock* block = arena_cur;
+	struct MapArenaHeader* header;
+	cc_uint32 size = CalcMemSize(numElems, elemsSize);
+	cc_uint32 total;
+	/* Overflow, either in CalcMemSize or when adding header/alignment */
+	if (!size || size > 0x7FFFFFFFUL) return NULL;
+
+	size  = MapArena_Align(size);
+	total = MAP_ARENA_ALLOC_HEADER + size;
+
+	if (!block || block->size - block->used < total) {
+		block = MapArena_AddBlock(total);
+		if (!block) return NULL;
+	}
+
+	header = MapArena_Header(block, block->used);
+	header->offset = block->used;
+	header->size   = total;
+	header->prev   = block->last;
+	header->freed  = false;
+
+	block->last  = block->used;
+	block->used += total;
+	arena_used  += total;
+	arena_peak   = max(arena_peak, arena_used);
+	return (cc_uint8*)header + MAP_ARENA_ALLOC_HEADER;
+}
+
+void* Mem_MapAlloc(cc_uint32 numElems, cc_uint32 elemsSize, const char* place) {
+	void* ptr = Mem_TryMapAlloc(numElems, elemsSize);
+	if (!ptr) AbortOnAllocFailed(place);
+
+	MemStats_Track(MEMSTATS_ARENA, ptr, numElems * elemsSize, place);
+	return ptr;
+}
+
+void* Mem_MapAllocCleared(cc_uint32 numElems, cc_uint32 elemsSize, const char* place) {
+	void* ptr = Mem_MapAlloc(numElems, elemsSize, place);
+	Mem_Set(ptr, 0, numElems * elemsSize);
+	return ptr;
+}
+
+void Mem_MapFree(void* mem) {
+	struct MapArenaBlock* block;
+	struct MapArenaHeader* header;
+	cc_uint8* data;
+	if (!mem) return;
+	MemStats_Untrack(MEMSTATS_ARENA, mem);
+
+	/* Ignore memory that isn't currently allocated from the arena (e.g. from before the last reset) */
+	for (block = arena_cur; block; block = block->prev) 
+	{
+		data = MapArena_Data(block);
+		if ((cc_uint8*)mem >= data && (cc_uint8*)mem < data + block->used) break;
+	}
+	if (!block) return;
+
+	header = (struct MapArenaHeader*)((cc_uint8*)mem - MAP_ARENA_ALLOC_HEADER);
+	if (header->freed) Process_Abort("Map arena memory freed twice");
+	header->freed = true;
+
+	/* Space can only be reclaimed from the end of the current block, so allocations freed */
+	/*  out of order are just marked as freed, and reclaimed once everything after them is */
+	for (block = arena_cur; block->last != MAP_ARENA_NONE; ) 
+	{
+		header = MapArena_Header(block, block->last);
+		if (!header->freed) return;
+
+		block->used = header->offset;
+		block->last = header->prev;
+		arena_used -= header->size;
+
+		/* Go back to allocating from the previous block once this one is completely empty */
+		if (block->last == MAP_ARENA_NONE && block->prev) {
+			arena_cur = block->prev;
+			Mem_Free(block);
+			block = arena_cur;
+		}
+	}
+}
+
+void Mem_ResetMapArena(void) {
+	struct MapArenaBlock* block;
+	struct MapArenaBlock* prev;
+	cc_uint32 peak = arena_peak;
+	if (!arena_cur) return;
+#ifdef CC_BUILD_MEMSTATS
+	MemStats_UntrackAll(MEMSTATS_ARENA);
+#endif
+	arena_used = 0;
+	arena_peak = 0;
+
+	/* Most maps need the same amount of memory as the previous map, so keep the block if it was enough */
+	/* However, don't keep holding onto a much larger block than is needed after e.g. one very large map */
+	if (!arena_cur->prev && (peak >= arena_cur->size / 4 || arena_cur->size <= MAP_ARENA_MIN_BLOCK)) {
+		arena_cur->used = 0;
+		arena_cur->last = MAP_ARENA_NONE;
+		return;
+	}
+
+	for (block = arena_cur; block; block = prev) {
+		prev = block->prev;
+		Mem_Free(block);
+	}
+	/* Size the next block so that a map needing as much as the previous map fits into just one block */
+	arena_cur      = NULL;
+	arena_nextSize = peak;
+}
+
+
 /*########################################################################################################################*
 *--------------------------------------------------------Logging----------------------------------------------------------*
 *#########################################################################################################################*/
+#ifdef CC_BUILD_ASYNCLOG
+/* Messages are appended to a ring buffer, which a background thread writes out to the console */
+/* If the buffer fills up, the logging thread writes out all the messages itself instead */
+#define LOG_BUFFER_SIZE (64 * 1024)
+/* Writes the given text as is to the console (implemented by the platform) */
+static void Platform_WriteLog(const char* text, int len);
+
+static char log_buffer[LOG_BUFFER_SIZE];
+static char log_pending[LOG_BUFFER_SIZE]; /* Messages taken from log_buffer that are being written out */
+static int log_head, log_used;  /* Start and length of the not yet written messages in log_buffer */
+static void* log_mutex;         /* Protects log_buffer */
+static void* log_writeMutex;    /* Ensures messages are written out in the order they were logged */
+static void* log_signal;
+static void* log_thread;
+static volatile cc_bool log_async, log_quit;
+
+static void LogBuffer_Append(const char* text, int len) {
+	int tail = (log_head + log_used) % LOG_BUFFER_SIZE;
+	int part = min(len, LOG_BUFFER_SIZE - tail);
+
+	Mem_Copy(log_buffer + tail, text, part);
+	Mem_Copy(log_buffer, text + part, len - part);
+	log_used += len;
+}
+
+/* Moves all messages in the ring buffer into log_pending */
+static int LogBuffer_Take(void) {
+	int len  = log_used;
+	int part = min(len, LOG_BUFFER_SIZE - log_head);
+
+	Mem_Copy(log_pending, log_buffer + log_head, part);
+	Mem_Copy(log_pending + part, log_buffer, len - part);
+	log_head = 0;
+	log_used = 0;
+	return len;
+}
+
+static void LogThread_Flush(void) {
+	int len;
+	Mutex_Lock(log_mutex);
+	Mutex_Lock(log_writeMutex);
+	len = LogBuffer_Take();
+	/* Writing to console is slow, so other threads can keep logging into the buffer meanwhile */
+	Mutex_Unlock(log_mutex);
+
+	if (len) Platform_WriteLog(log_pending, len);
+	Mutex_Unlock(log_writeMutex);
+}
+
+static void LogThread_Run(void) {
+	while (!log_quit) 
+	{
+		Waitable_Wait(log_signal);
+		LogThread_Flush();
+	}
+}
+
+static void LogThread_Start(void) {
+	log_mutex      = Mutex_Create("Log buffer");
+	log_writeMutex = Mutex_Create("Log write");
+	log_signal     = Waitable_Create("Log signal");
+
+	Thread_Run(&log_thread, LogThread_Run, 64 * 1024, "Logger");
+	log_async = true;
+}
+
+/* Stops the background thread, after writing out any remaining messages */
+static void LogThread_Stop(void) {
+	if (!log_async) return;
+	log_quit = true;
+	Waitable_Signal(log_signal);
+	Thread_Join(log_thread);
+
+	log_async = false;
+	LogThread_Flush();
+}
+
+void Platform_Log(const char* msg, int len) {
+	if (!log_async) {
+		Platform_WriteLog(msg, len);
+		Platform_WriteLog("\n", 1);
+		return;
+	}
+	Mutex_Lock(log_mutex);
+
+	if (log_used + len + 1 > LOG_BUFFER_SIZE) {
+		Mutex_Lock(log_writeMutex);
+		Platform_WriteLog(log_pending, LogBuffer_Take());
+		Platform_WriteLog(msg, len);
+		Platform_WriteLog("\n", 1);
+		Mutex_Unlock(log_writeMutex);
+	} else {
+		/* Background thread empties the buffer whenever it is woken up */
+		if (!log_used) Waitable_Signal(log_signal);
+		LogBuffer_Append(msg,  len);
+		LogBuffer_Append("\n", 1);
+	}
+	Mutex_Unlock(log_mutex);
+}
+
+void Platform_FlushLog(void) {
+	int part;
+	if (!log_async) return;
+	log_async = false;
+
+	/* The crashing thread may have been holding the lock, so just write out whatever is there */
+	part = min(log_used, LOG_BUFFER_SIZE - log_head);
+	Platform_WriteLog(log_buffer + log_head, part);
+	Platform_WriteLog(log_buffer, log_used - part);
+	log_used = 0;
+}
+#else
+static CC_INLINE void LogThread_Start(void) { }
+static CC_INLINE void LogThread_Stop(void)  { }
+void Platform_FlushLog(void) { }
+#endif
+
 void Platform_Log1(const char* format, const void* a1) {
 	Platform_Log4(format, a1, NULL, NULL, NULL);
 }
@@ -57,6 +57,7 @@ mergeInto(LibraryManager.library, {
 //########################################################################################################################
 //-----------------------------------------------------------Http---------------------------------------------------------
 //########################################################################################################################
+  interop_DownloadAsync__deps: ['httpCache_canUse', 'httpCache_get', 'httpCache_put'],
   interop_DownloadAsync: function(urlStr, method, reqID) {
     // onFinished = FUNC(data, len, status)
     // onProgress = FUNC(read, total)
@@ -64,6 +65,7 @@ mergeInto(LibraryManager.library, {
     var reqMethod  = method == 1 ? 'HEAD' : 'GET';  
     var onFinished = Module["_Http_OnFinishedAsync"];
     var onProgress = Module["_Http_OnUpdateProgress"];
+    var useCache   = reqMethod == 'GET' && _httpCache_canUse(url);
 
     var xhr = new XMLHttpRequest();
     try {
@@ -85,19 +87,37 @@ mergeInto(LibraryManager.library, {
         return parseInt(len, 10);
       } catch (ex) { return 0; }
     };
-    
-    xhr.onload = function(e) {
-      var src  = new Uint8Array(xhr.response);
+    var finish = function(buffer, status, e) {
+      var src  = new Uint8Array(buffer);
       var len  = src.byteLength;
       var data = _malloc(len);
       HEAPU8.set(src, data);
-      onFinished(reqID, data, len || getContentLength(e), xhr.status);
+      onFinished(reqID, data, len || getContentLength(e), status);
+    };
+    var cached = null;
+    
+    xhr.onload = function(e) {
+      // Server says cached copy is still the latest version
+      if (xhr.status == 304 && cached) {
+        finish(cached.data, 200, e); return;
+      }
+      if (useCache && xhr.status == 200) _httpCache_put(url, xhr.getResponseHeader('ETag'), xhr.response);
+      finish(xhr.response, xhr.status, e);
     };
     xhr.onerror    = function(e) { onFinished(reqID, 0, 0, xhr.status);  };
     xhr.ontimeout  = function(e) { onFinished(reqID, 0, 0, xhr.status);  };
     xhr.onprogress = function(e) { onProgress(reqID, e.loaded, e.total); };
 
-    try { xhr.send(); } catch (e) { onFinished(reqID, 0, 0, 0); }
+    var send = function() {
+      try { xhr.send(); } catch (e) { onFinished(reqID, 0, 0, 0); }
+    };
+    if (!useCache) { send(); return 0; }
+    
+    _httpCache_get(url, function(entry) {
+      cached = entry;
+      if (entry) xhr.setRequestHeader('If-None-Match', entry.etag);
+      send();
+    });
     return 0;
   },
   interop_IsHttpsOnly : function() {
@@ -106,6 +126,63 @@ mergeInto(LibraryManager.library, {
   },
 
 
+//########################################################################################################################
+//--------------------------------------------------------Http cache------------------------------------------------------
+//########################################################################################################################
+  // Responses with an ETag are stored in IndexedDB, then revalidated with 'If-None-Match' on later visits
+  //  - so unchanged assets (e.g. texture packs) don't need to be downloaded again
+  // NOTE: Only same origin URLs are cached, as cross origin 'If-None-Match' requests need CORS preflighting
+  httpCache_canUse: function(url) {
+    try {
+      return new URL(url, location.href).origin === location.origin;
+    } catch (e) { return false; }
+  },
+  httpCache_getDB: function(callback) {
+    if (window.cc_httpCacheDB !== undefined) return callback(window.cc_httpCacheDB);
+    var idb = window.indexedDB || window.mozIndexedDB || window.webkitIndexedDB || window.msIndexedDB;
+    var req;
+    
+    var failed = function() { window.cc_httpCacheDB = null; callback(null); };
+    if (!idb) return failed();
+    try {
+      req = idb.open('/classicube-http', 1);
+    } catch (e) { return failed(); }
+
+    req.onupgradeneeded = function(e) {
+      e.target.result.createObjectStore('RESPONSES');
+    };
+    req.onsuccess = function() {
+      var db = req.result;
+      window.cc_httpCacheDB = db;
+      db.onclose = function() { window.cc_httpCacheDB = undefined; };
+      callback(db);
+    };
+    req.onerror = function(e) { e.preventDefault(); failed(); };
+  },
+  httpCache_get__deps: ['httpCache_getDB'],
+  httpCache_get: function(url, callback) {
+    if (!url) return callback(null);
+    _httpCache_getDB(function(db) {
+      if (!db) return callback(null);
+      try {
+        var req = db.transaction(['RESPONSES'], 'readonly').objectStore('RESPONSES').get(url);
+        req.onsuccess = function() { callback(req.result || null); };
+        req.onerror   = function(e) { e.preventDefault(); callback(null); };
+      } catch (e) { callback(null); }
+    });
+  },
+  httpCache_put__deps: ['httpCache_getDB'],
+  httpCache_put: function(url, etag, data) {
+    if (!etag || !data) return;
+    _httpCache_getDB(function(db) {
+      if (!db) return;
+      try {
+        db.transaction(['RESPONSES'], 'readwrite').objectStore('RESPONSES').put({ etag: etag, data: data }, url);
+      } catch (e) { console.log(e); }
+    });
+  },
+
+
 //########################################################################################################################
 //---------------------------------------------------------Dialogs--------------------------------------------------------
 //########################################################################################################################
@@ -178,20 +255,29 @@ mergeInto(LibraryManager.library, {
 //########################################################################################################################
 //-------------------------------------------------------Main driver------------------------------------------------------
 //########################################################################################################################
+  fetchTexturePackAsync__deps: ['httpCache_canUse', 'httpCache_get', 'httpCache_put'],
   fetchTexturePackAsync: function(url, onload, onerror) {
     var xhr = new XMLHttpRequest();
+    var useCache = _httpCache_canUse(url);
     xhr.open('GET', url);
     xhr.responseType = 'arraybuffer';
     xhr.onerror = onerror;
     
-    xhr.onload = function() {
-      if (xhr.status == 200) {
-        onload(xhr.response);
-      } else {
-        onerror();
-      }
-    };
-    xhr.send();
+    _httpCache_get(useCache ? url : null, function(cached) {
+      xhr.onload = function() {
+        if (xhr.status == 304 && cached) {
+          onload(cached.data);
+        } else if (xhr.status == 200) {
+          if (useCache) _httpCache_put(url, xhr.getResponseHeader('ETag'), xhr.response);
+          onload(xhr.response);
+        } else {
+          onerror();
+        }
+      };
+      
+      if (cached) xhr.setRequestHeader('If-None-Match', cached.etag);
+      xhr.send();
+    });
   },
   interop_AsyncDownloadTexturePack__deps: ['fetchTexturePackAsync'],
   interop_AsyncDownloadTexturePack: function (rawPath) {
@@ -200,6 +200,19 @@ static int RunProgram(int argc, char** argv) {
 	} else if (argsCount == 1) {
 		String_Copy(&Game_Username, &args[0]);
 		RunGame();
+#ifdef CC_BUILD_NETWORKING
+	/* --replay [file] <speed> - replay data previously captured from a server */
+	} else if (argsCount <= 3 && String_CaselessEqualsConst(&args[0], DEFAULT_REPLAY_ARG)) {
+		if (argsCount == 3 && !Convert_ParseFloat(&args[2], &Server_ReplaySpeed)) {
+			WarnInvalidArg("Invalid replay speed", &args[2]);
+			return 1;
+		}
+		
+		Options_Get(LOPT_USERNAME, &Game_Username, DEFAULT_USERNAME);
+		String_Copy(&Server_ReplayFile, &args[1]);
+		String_AppendConst(&Server.Address, "replay");
+		RunGame();
+#endif
 	/* 2 to 3 arguments - unsupported at present */
 	} else if (argsCount < 4) {
 		WarnMissingArgs(argsCount, args);